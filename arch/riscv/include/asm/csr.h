@@ -101,6 +101,7 @@
 #define CSR_CYCLE		0xc00
 #define CSR_TIME		0xc01
 #define CSR_INSTRET		0xc02
+#define CSR_HPMCOUNTER3		0xc03
 #define CSR_SSTATUS		0x100
 #define CSR_SIE			0x104
 #define CSR_STVEC		0x105
@@ -125,7 +126,9 @@
 #define CSR_MHCOUNTEREN         0x322
 #else
 #define CSR_MCOUNTEREN		0x306
+#define CSR_MCOUNTINHIBIT	0x320
 #endif
+#define CSR_MHPMEVENT3		0x323
 #define CSR_MSCRATCH		0x340
 #define CSR_MEPC		0x341
 #define CSR_MCAUSE		0x342
@@ -142,6 +145,7 @@
 #define CSR_CYCLEH		0xc80
 #define CSR_TIMEH		0xc81
 #define CSR_INSTRETH		0xc82
+#define CSR_HPMCOUNTER3H	0xc83
 #define CSR_MHARTID		0xf14
 
 #ifndef __ASSEMBLY__
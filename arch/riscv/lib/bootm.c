@@ -13,6 +13,7 @@
 #include <fdt_support.h>
 #include <hang.h>
 #include <log.h>
+#include <serial.h>
 #include <asm/global_data.h>
 #include <dm/root.h>
 #include <image.h>
@@ -59,6 +60,7 @@ static void announce_and_cleanup(int fake)
 	 */
 	dm_remove_devices_flags(DM_REMOVE_ACTIVE_ALL);
 
+	serial_flush();
 	cleanup_before_linux();
 }
 
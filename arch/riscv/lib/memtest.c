@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Run memory tests on the secondary harts, which wait for an IPI in
+ * secondary_hart_loop until the OS is started
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#include <common.h>
+#include <log.h>
+#include <memtest.h>
+#include <time.h>
+#include <asm/global_data.h>
+#include <asm/smp.h>
+#include <linux/bitops.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Time to wait for secondary harts once the calling hart has finished */
+#define MEMTEST_HART_TIMEOUT_MS	10000
+
+/**
+ * struct memtest_harts - work for the secondary harts
+ *
+ * @func:	Function to call
+ * @ctx:	Context for @func
+ * @slots:	Number of secondary harts which may still join in
+ * @done:	Number of secondary harts which have finished
+ */
+struct memtest_harts {
+	void (*func)(void *ctx, int cpu);
+	void *ctx;
+	uint slots;
+	uint done;
+};
+
+static void memtest_hart_entry(ulong hart, ulong arg0, ulong arg1)
+{
+	struct memtest_harts *harts = (struct memtest_harts *)arg0;
+
+	/* Harts beyond the number requested still have to report in */
+	if ((int)__atomic_sub_fetch(&harts->slots, 1, __ATOMIC_ACQUIRE) >= 0)
+		harts->func(harts->ctx, hart + 1);
+	__atomic_add_fetch(&harts->done, 1, __ATOMIC_RELEASE);
+}
+
+uint arch_memtest_cpus(void)
+{
+#ifdef CONFIG_XIP
+	return 1;
+#else
+	return hweight_long(gd->arch.available_harts);
+#endif
+}
+
+int arch_memtest_run(void (*func)(void *ctx, int cpu), void *ctx, uint cpus)
+{
+	/* Not on the stack, in case a hart is too late to respond */
+	static struct memtest_harts harts;
+	uint others = arch_memtest_cpus() - 1;
+	ulong start;
+	int ret;
+
+	if (cpus < 2 || !others) {
+		func(ctx, 0);
+		return 0;
+	}
+
+	harts.func = func;
+	harts.ctx = ctx;
+	harts.slots = cpus - 1;
+	harts.done = 0;
+	ret = smp_call_function((ulong)memtest_hart_entry, (ulong)&harts, 0,
+				0);
+
+	/* The work is shared out on demand, so this finishes it if need be */
+	func(ctx, 0);
+	if (ret)
+		return ret;
+
+	start = get_timer(0);
+	while (__atomic_load_n(&harts.done, __ATOMIC_ACQUIRE) < others) {
+		if (get_timer(start) > MEMTEST_HART_TIMEOUT_MS) {
+			log_err("Only %u of %u harts finished\n", harts.done,
+				others);
+			return -ETIMEDOUT;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Sampling profiler timer, using the supervisor timer via SBI
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#include <common.h>
+#include <irq_func.h>
+#include <prof.h>
+#include <time.h>
+#include <asm/csr.h>
+#include <asm/ptrace.h>
+#include <asm/sbi.h>
+
+/* Timer ticks between samples */
+static ulong prof_period;
+
+void timer_interrupt(struct pt_regs *regs)
+{
+	prof_sample(regs->sepc);
+
+	/* Setting the next deadline also clears the pending interrupt */
+	sbi_set_timer(get_ticks() + prof_period);
+}
+
+int arch_prof_start(uint hz)
+{
+	ulong rate = get_tbclk();
+
+	if (!rate)
+		return -ENODEV;
+	prof_period = max(rate / hz, 1UL);
+	sbi_set_timer(get_ticks() + prof_period);
+
+	/* Only the timer is unmasked, so nothing else can interrupt us */
+	csr_set(CSR_SIE, SIE_STIE);
+	csr_set(CSR_SSTATUS, SR_SIE);
+
+	return 0;
+}
+
+void arch_prof_stop(void)
+{
+	csr_clear(CSR_SSTATUS, SR_SIE);
+	csr_clear(CSR_SIE, SIE_STIE);
+	sbi_set_timer(~0ULL);
+}
@@ -61,3 +61,22 @@ void __noreturn jump_to_image_no_args(struct spl_image_info *spl_image)
 #endif
 	image_entry(gd->arch.boot_hart, fdt_blob);
 }
+
+#if CONFIG_IS_ENABLED(OS_BOOT)
+/*
+ * Linux must be started in S-mode, so this is for an SPL which itself runs in
+ * S-mode on top of SBI firmware. Otherwise OpenSBI is started first, from
+ * spl_invoke_opensbi().
+ */
+void __noreturn jump_to_image_linux(struct spl_image_info *spl_image)
+{
+	typedef void __noreturn (*image_entry_riscv_t)(ulong hart, void *dtb);
+	image_entry_riscv_t image_entry =
+		(image_entry_riscv_t)spl_image->entry_point;
+
+	invalidate_icache_all();
+
+	debug("Linux entry point: 0x%lX\n", spl_image->entry_point);
+	image_entry(gd->arch.boot_hart, spl_os_fdt(spl_image));
+}
+#endif
@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Hardware counters for function tracing
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#include <common.h>
+#include <trace.h>
+#include <asm/csr.h>
+
+#if __riscv_xlen == 32
+#define read_counter(lo, hi)					\
+({								\
+	ulong __hi, __lo;					\
+								\
+	do {							\
+		__hi = csr_read(hi);				\
+		__lo = csr_read(lo);				\
+	} while (__hi != csr_read(hi));				\
+	((u64)__hi << 32) | __lo;				\
+})
+#else
+#define read_counter(lo, hi)	((u64)csr_read(lo))
+#endif
+
+void __attribute__((no_instrument_function)) trace_hw_read(u64 vals[TRACE_HW_COUNT])
+{
+	vals[TRACE_HW_CYCLES] = read_counter(CSR_CYCLE, CSR_CYCLEH);
+	vals[TRACE_HW_INSTRET] = read_counter(CSR_INSTRET, CSR_INSTRETH);
+	if (CONFIG_IS_ENABLED(RISCV_MMODE) || CONFIG_TRACE_HW_RISCV_EVENT)
+		vals[TRACE_HW_EVENT] = read_counter(CSR_HPMCOUNTER3,
+						    CSR_HPMCOUNTER3H);
+	else
+		vals[TRACE_HW_EVENT] = 0;
+}
+
+void trace_hw_start(void)
+{
+	/*
+	 * In supervisor mode the counters are owned by the SBI firmware, which
+	 * must have set up hpmcounter3 and enabled it in mcounteren
+	 */
+	if (!CONFIG_IS_ENABLED(RISCV_MMODE))
+		return;
+	if (CONFIG_TRACE_HW_RISCV_EVENT)
+		csr_write(CSR_MHPMEVENT3, CONFIG_TRACE_HW_RISCV_EVENT);
+#ifndef CONFIG_RISCV_PRIV_1_9
+	/* Let cycle, instret and hpmcounter3 run */
+	csr_clear(CSR_MCOUNTINHIBIT, BIT(0) | BIT(2) | BIT(3));
+#endif
+}
@@ -21,11 +21,14 @@
 #include <time.h>
 #include <ucontext.h>
 #include <unistd.h>
+#include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <linux/compiler_attributes.h>
+#include <linux/perf_event.h>
 #include <linux/types.h>
 
 #include <asm/fuzzing_engine.h>
@@ -263,24 +266,32 @@ static void os_sigint_handler(int sig)
 	raise(SIGINT);
 }
 
-static void os_signal_handler(int sig, siginfo_t *info, void *con)
+/* Get the program counter from a signal context */
+static unsigned long os_context_pc(void *con)
 {
 	ucontext_t __maybe_unused *context = con;
-	unsigned long pc;
 
 #if defined(__x86_64__)
-	pc = context->uc_mcontext.gregs[REG_RIP];
+	return context->uc_mcontext.gregs[REG_RIP];
 #elif defined(__aarch64__)
-	pc = context->uc_mcontext.pc;
+	return context->uc_mcontext.pc;
 #elif defined(__riscv)
-	pc = context->uc_mcontext.__gregs[REG_PC];
+	return context->uc_mcontext.__gregs[REG_PC];
 #else
-	const char msg[] =
-		"\nUnsupported architecture, cannot read program counter\n";
-
-	os_write(1, msg, sizeof(msg));
-	pc = 0;
+	return 0;
 #endif
+}
+
+static void os_signal_handler(int sig, siginfo_t *info, void *con)
+{
+	unsigned long pc = os_context_pc(con);
+
+	if (!pc) {
+		const char msg[] =
+			"\nUnsupported architecture, cannot read program counter\n";
+
+		os_write(1, msg, sizeof(msg));
+	}
 
 	os_signal_action(sig, pc);
 }
@@ -299,6 +310,102 @@ int os_setup_signal_handlers(void)
 	return 0;
 }
 
+static void (*os_prof_func)(unsigned long pc);
+
+static void os_prof_handler(int sig, siginfo_t *info, void *con)
+{
+	os_prof_func(os_context_pc(con));
+}
+
+int os_prof_start(unsigned int hz, void (*func)(unsigned long pc))
+{
+	struct itimerval timer;
+	struct sigaction act;
+
+	os_prof_func = func;
+	act.sa_sigaction = os_prof_handler;
+	sigemptyset(&act.sa_mask);
+	act.sa_flags = SA_SIGINFO | SA_RESTART;
+	if (sigaction(SIGPROF, &act, NULL))
+		return -errno;
+
+	timer.it_interval.tv_sec = 0;
+	timer.it_interval.tv_usec = 1000000 / hz;
+	timer.it_value = timer.it_interval;
+	if (setitimer(ITIMER_PROF, &timer, NULL))
+		return -errno;
+
+	return 0;
+}
+
+void os_prof_stop(void)
+{
+	struct itimerval timer;
+
+	memset(&timer, '\0', sizeof(timer));
+	setitimer(ITIMER_PROF, &timer, NULL);
+	signal(SIGPROF, SIG_IGN);
+}
+
+unsigned int os_num_cpus(void)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return cpus > 0 ? cpus : 1;
+}
+
+struct os_thread {
+	pthread_t tid;
+	void (*func)(void *ctx, int cpu);
+	void *ctx;
+	int cpu;
+	bool started;
+};
+
+static void *os_thread_start(void *arg)
+{
+	struct os_thread *thread = arg;
+
+	thread->func(thread->ctx, thread->cpu);
+
+	return NULL;
+}
+
+int os_run_threads(void (*func)(void *ctx, int cpu), void *ctx,
+		   unsigned int count)
+{
+	struct os_thread *threads;
+	unsigned int i;
+
+	if (count < 2) {
+		func(ctx, 0);
+		return 0;
+	}
+
+	threads = os_malloc(sizeof(*threads) * count);
+	if (!threads)
+		return -ENOMEM;
+	for (i = 1; i < count; i++) {
+		struct os_thread *thread = &threads[i];
+
+		thread->func = func;
+		thread->ctx = ctx;
+		thread->cpu = i;
+		thread->started = !pthread_create(&thread->tid, NULL,
+						  os_thread_start, thread);
+	}
+	func(ctx, 0);
+	for (i = 1; i < count; i++) {
+		if (threads[i].started)
+			pthread_join(threads[i].tid, NULL);
+		else
+			func(ctx, i);
+	}
+	os_free(threads);
+
+	return 0;
+}
+
 /* Put tty into raw mode so <tab> and <ctrl+c> work */
 void os_tty_raw(int fd, bool allow_sigs)
 {
@@ -435,6 +542,63 @@ uint64_t __attribute__((no_instrument_function)) os_get_nsec(void)
 #endif
 }
 
+/* Host perf counter group: cycles, instructions, cache misses */
+static int os_perf_fd = -1;
+
+int os_perf_open(void)
+{
+	static const uint64_t config[] = {
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_MISSES,
+	};
+	const int count = sizeof(config) / sizeof(config[0]);
+	struct perf_event_attr attr;
+	int fd[count];
+	int i, err;
+
+	if (os_perf_fd != -1)
+		return 0;
+	for (i = 0; i < count; i++) {
+		memset(&attr, '\0', sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = config[i];
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP;
+		attr.disabled = !i;
+		fd[i] = syscall(__NR_perf_event_open, &attr, 0, -1,
+				i ? fd[0] : -1, 0);
+		if (fd[i] < 0) {
+			err = -errno;
+			while (i--)
+				close(fd[i]);
+			return err;
+		}
+	}
+	os_perf_fd = fd[0];
+	ioctl(os_perf_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+	return 0;
+}
+
+void __attribute__((no_instrument_function)) os_perf_read(uint64_t *vals,
+							  int count)
+{
+	/* With PERF_FORMAT_GROUP the number of counters comes first */
+	uint64_t buf[4];
+	int i;
+
+	if (os_perf_fd == -1 || read(os_perf_fd, buf, sizeof(buf)) < 0) {
+		buf[1] = os_get_nsec();
+		buf[2] = 0;
+		buf[3] = 0;
+	}
+	for (i = 0; i < count && i < 3; i++)
+		vals[i] = buf[i + 1];
+}
+
 static char *short_opts;
 static struct option *long_opts;
 
@@ -107,6 +107,15 @@ void __noreturn jump_to_image_no_args(struct spl_image_info *spl_image)
 	hang();
 }
 
+#if CONFIG_IS_ENABLED(OS_BOOT)
+void __noreturn jump_to_image_linux(struct spl_image_info *spl_image)
+{
+	printf("Cannot start Linux on sandbox (fdt %p)\n",
+	       spl_os_fdt(spl_image));
+	hang();
+}
+#endif
+
 int handoff_arch_save(struct spl_handoff *ho)
 {
 	ho->arch.magic = TEST_HANDOFF_MAGIC;
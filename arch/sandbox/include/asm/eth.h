@@ -41,6 +41,47 @@ int sandbox_eth_arp_req_to_reply(struct udevice *dev, void *packet,
 int sandbox_eth_ping_req_to_reply(struct udevice *dev, void *packet,
 				  unsigned int len);
 
+/*
+ * sandbox_eth_dhcp_req_to_reply()
+ *
+ * Check for a DHCP request to be sent. If so, inject a reply offering, or
+ * acknowledging, the address in dhcp_ipaddr
+ *
+ * @dev: device that received the packet
+ * @packet: pointer to the received pacaket buffer
+ * @len: length of received packet
+ * Return: 0 if injected, -EAGAIN if not
+ */
+int sandbox_eth_dhcp_req_to_reply(struct udevice *dev, void *packet,
+				  unsigned int len);
+
+/*
+ * sandbox_eth_http_req_to_reply()
+ *
+ * Check for a TCP segment sent to the mock HTTP server. If so, inject the
+ * server's replies
+ *
+ * @dev: device that received the packet
+ * @packet: pointer to the received pacaket buffer
+ * @len: length of received packet
+ * Return: 0 if injected, -EAGAIN if not
+ */
+int sandbox_eth_http_req_to_reply(struct udevice *dev, void *packet,
+				  unsigned int len);
+
+/*
+ * sandbox_eth_http_byte()
+ *
+ * Get a byte of the file served by the mock HTTP server
+ *
+ * @offset: offset of the byte in the file
+ * Return: value of the byte
+ */
+static inline u8 sandbox_eth_http_byte(ulong offset)
+{
+	return offset ^ (offset >> 8) ^ (offset >> 16);
+}
+
 /*
  * sandbox_eth_recv_arp_req()
  *
@@ -71,11 +112,105 @@ int sandbox_eth_recv_ping_req(struct udevice *dev);
 typedef int sandbox_eth_tx_hand_f(struct udevice *dev, void *pkt,
 				   unsigned int len);
 
+/* Path of the file served by the mock HTTP server */
+#define SB_HTTP_PATH		"/sandbox.img"
+
+#define SB_HTTP_MAX_CONNS	8
+#define SB_HTTP_MAX_RESP	4
+
+/**
+ * struct eth_sandbox_http_resp - response queued by the mock HTTP server
+ *
+ * hdr - header of the response
+ * hdr_len - length of the header
+ * start - offset in the file of the first byte of the body
+ * len - length of the body
+ * seq - sequence number of the first byte of the header
+ */
+struct eth_sandbox_http_resp {
+	char hdr[160];
+	int hdr_len;
+	ulong start;
+	ulong len;
+	u32 seq;
+};
+
+/**
+ * struct eth_sandbox_http_conn - connection to the mock HTTP server
+ *
+ * port - client's port, 0 if not in use
+ * client_hwaddr - client's MAC address
+ * client_ip - client's IP address
+ * server_ip - IP address the client connected to
+ * snd_una - sequence number of the first byte not yet acknowledged
+ * snd_nxt - sequence number of the next byte the server sends
+ * snd_max - sequence number after the last byte sent so far
+ * rcv_nxt - sequence number of the next byte expected from the client
+ * wnd - client's receive window, in bytes
+ * wscale - scale factor of the window the client advertises
+ * dupacks - number of duplicate ACKs since the last new one
+ * timer - time when the retransmission timer was started
+ * held_seq - sequence number of a segment to send after the next one
+ * held_len - length of that segment, 0 if none
+ * syn_ack - the server has yet to accept the connection
+ * close - close the connection once all responses are sent
+ * fin_sent - the server has closed its side of the connection
+ * req - requests received but not yet answered
+ * req_len - number of bytes in req
+ * resp - responses not yet acknowledged, oldest first
+ * nresp - number of responses in resp
+ */
+struct eth_sandbox_http_conn {
+	u16 port;
+	uchar client_hwaddr[ARP_HLEN];
+	struct in_addr client_ip;
+	struct in_addr server_ip;
+	u32 snd_una;
+	u32 snd_nxt;
+	u32 snd_max;
+	u32 rcv_nxt;
+	u32 wnd;
+	int wscale;
+	int dupacks;
+	ulong timer;
+	u32 held_seq;
+	uint held_len;
+	bool syn_ack;
+	bool close;
+	bool fin_sent;
+	char req[512];
+	int req_len;
+	struct eth_sandbox_http_resp resp[SB_HTTP_MAX_RESP];
+	int nresp;
+};
+
 /**
  * struct eth_sandbox_priv - memory for sandbox mock driver
  *
  * fake_host_hwaddr - MAC address of mocked machine
  * fake_host_ipaddr - IP address of mocked machine
+ * dhcp_ipaddr - IP address handed out by the mocked DHCP server
+ * http_conns - connections to the mocked HTTP server
+ * http_next - connection the mocked HTTP server sends from first
+ * http_file_size - size of the file served by the mocked HTTP server
+ * http_ranges - the mocked HTTP server supports range requests
+ * http_keep_alive - the mocked HTTP server keeps connections open
+ * http_unknown_size - the mocked HTTP server gives '*' as the size of the
+ *	file in each Content-Range
+ * http_drop - the mocked HTTP server loses every http_drop'th new segment
+ * http_reorder - the mocked HTTP server sends every http_reorder'th new
+ *	segment after the one following it
+ * http_lose_reqs - number of segments from the client with data in them
+ *	which the mocked HTTP server ignores, as if they were lost
+ * http_segs - number of segments of new data the mocked HTTP server has sent
+ * http_syns - number of connections made to the mocked HTTP server
+ * http_reqs - number of requests to the mocked HTTP server
+ * http_dupacks - number of duplicate ACKs the mocked HTTP server received
+ * http_rexmits - number of segments the mocked HTTP server sent again
+ * http_max_wnd - largest receive window a client advertised
+ * http_mss - maximum segment size the mocked HTTP server advertises, 0 for
+ *	TCP_MSS
+ * http_max_seg - largest segment of data the mocked HTTP server received
  * disabled - Will not respond
  * recv_packet_buffer - buffers of the packet returned as received
  * recv_packet_length - lengths of the packet returned as received
@@ -86,6 +221,24 @@ typedef int sandbox_eth_tx_hand_f(struct udevice *dev, void *pkt,
 struct eth_sandbox_priv {
 	uchar fake_host_hwaddr[ARP_HLEN];
 	struct in_addr fake_host_ipaddr;
+	struct in_addr dhcp_ipaddr;
+	struct eth_sandbox_http_conn http_conns[SB_HTTP_MAX_CONNS];
+	int http_next;
+	ulong http_file_size;
+	bool http_ranges;
+	bool http_keep_alive;
+	bool http_unknown_size;
+	int http_drop;
+	int http_reorder;
+	int http_lose_reqs;
+	int http_segs;
+	int http_syns;
+	int http_reqs;
+	int http_dupacks;
+	int http_rexmits;
+	u32 http_max_wnd;
+	uint http_mss;
+	uint http_max_seg;
 	bool disabled;
 	uchar * recv_packet_buffer[PKTBUFSRX];
 	int recv_packet_length[PKTBUFSRX];
@@ -118,6 +118,83 @@ long sandbox_i2c_rtc_get_set_base_time(struct udevice *dev, long base_time);
 
 int sandbox_usb_keyb_add_string(struct udevice *dev, const char *str);
 
+/**
+ * sandbox_usb_get_bulk_queues() - Get the number of queued bulk transfers
+ *
+ * @bus:	USB controller to check
+ * Return: number of times a set of bulk messages has been queued on @bus
+ */
+int sandbox_usb_get_bulk_queues(struct udevice *bus);
+
+struct usb_device;
+
+/**
+ * sandbox_usb_get_streams() - Get the endpoints of a device with streams
+ *
+ * @bus:	USB controller to check
+ * @udev:	USB device to check
+ * Return: mask of the endpoint indexes of @udev which have streams set up
+ */
+u32 sandbox_usb_get_streams(struct udevice *bus, struct usb_device *udev);
+
+/**
+ * sandbox_flash_set_uas() - Set whether a USB flash emulator offers UAS
+ *
+ * This must be called before the USB bus is scanned
+ *
+ * @dev:	USB flash emulator
+ * @uas:	true to offer UAS in alternate setting 1
+ * @broken:	true to reject all UAS commands
+ * Return: 0 if OK, -ve on error
+ */
+int sandbox_flash_set_uas(struct udevice *dev, bool uas, bool broken);
+
+/**
+ * sandbox_flash_set_super_speed() - Set whether a USB flash emulator is USB 3.0
+ *
+ * A SuperSpeed device does UAS with streams. This must be called before the
+ * USB bus is scanned
+ *
+ * @dev:	USB flash emulator
+ * @super_speed: true to appear as a SuperSpeed device
+ * Return: 0 if OK, -ve on error
+ */
+int sandbox_flash_set_super_speed(struct udevice *dev, bool super_speed);
+
+/**
+ * sandbox_flash_get_uas_max_inflight() - Get the most UAS commands queued
+ *
+ * @dev:	USB flash emulator
+ * Return: largest number of UAS commands queued on the device at once
+ */
+int sandbox_flash_get_uas_max_inflight(struct udevice *dev);
+
+/**
+ * sandbox_flash_get_altsetting() - Get the interface setting in use
+ *
+ * @dev:	USB flash emulator
+ * Return: alternate setting selected by the host, 1 for UAS
+ */
+int sandbox_flash_get_altsetting(struct udevice *dev);
+
+/**
+ * sandbox_flash_stall_status() - Stall the status phase of the next command
+ *
+ * The IN endpoint stays halted until the host clears it, after which the
+ * status is sent as normal.
+ *
+ * @dev:	USB flash emulator
+ */
+void sandbox_flash_stall_status(struct udevice *dev);
+
+/**
+ * sandbox_flash_get_stalls() - Get the number of stalls sent by the emulator
+ *
+ * @dev:	USB flash emulator
+ * Return: number of times the IN endpoint has stalled
+ */
+int sandbox_flash_get_stalls(struct udevice *dev);
+
 /**
  * sandbox_osd_get_mem() - get the internal memory of a sandbox OSD
  *
@@ -315,4 +392,219 @@ int sandbox_sdl_set_bpp(struct udevice *dev, enum video_log2_bpp l2bpp);
  */
 void sandbox_set_fake_efi_mgr_dev(struct udevice *dev, bool fake_dev);
 
+/**
+ * sandbox_ram_set_train() - Set up emulated memory training
+ *
+ * The settings take effect when the device is next probed.
+ *
+ * @dev: RAM device
+ * @data_rate: Data rate to report in the training key, in MT/s
+ * @verify_fail: true to fail the check after restoring saved parameters
+ */
+void sandbox_ram_set_train(struct udevice *dev, u32 data_rate,
+			   bool verify_fail);
+
+/**
+ * sandbox_ram_get_train_counts() - Get the number of training operations
+ *
+ * @dev: RAM device
+ * @trainsp: Returns the number of times full training has been run
+ * @restoresp: Returns the number of times saved parameters were restored
+ */
+void sandbox_ram_get_train_counts(struct udevice *dev, uint *trainsp,
+				  uint *restoresp);
+
+/**
+ * sandbox_ram_get_busy_ms() - Get the emulated time spent in training
+ *
+ * Full training takes the time given by the "sandbox,train-ms" property,
+ * which is counted here rather than added to the sandbox timer.
+ *
+ * @dev: RAM device
+ * Return: total time spent in full training, in milliseconds
+ */
+ulong sandbox_ram_get_busy_ms(struct udevice *dev);
+
+/**
+ * sandbox_ram_train_storage() - Get the emulated reserved area for training
+ *
+ * Return: pointer to the area, CONFIG_RAM_TRAIN_CACHE_SIZE bytes long
+ */
+u8 *sandbox_ram_train_storage(void);
+
+/**
+ * sandbox_mmc_get_idents() - Get the number of times a card was identified
+ *
+ * This counts ALL_SEND_CID commands, which are only sent when the card is set
+ * up from scratch.
+ *
+ * @dev: MMC device
+ * Return: number of identifications since the device was probed
+ */
+uint sandbox_mmc_get_idents(struct udevice *dev);
+
+/**
+ * sandbox_mmc_set_latency() - Set the time taken by each command
+ *
+ * This emulates the time taken to set up a card, so that tests can see the
+ * effect of sending fewer commands.
+ *
+ * @dev: MMC device
+ * @cmd_ms: Time to add to the sandbox timer for each command, in ms
+ */
+void sandbox_mmc_set_latency(struct udevice *dev, uint cmd_ms);
+
+/**
+ * sandbox_mmc_set_write_busy() - Set how long the card programs each write
+ *
+ * After each write the card reports the programming state for this many
+ * SEND_STATUS commands, and fails any other command meanwhile.
+ *
+ * @dev: MMC device
+ * @polls: Number of SEND_STATUS commands, 0 to be ready at once
+ */
+void sandbox_mmc_set_write_busy(struct udevice *dev, uint polls);
+
+/**
+ * sandbox_mmc_get_write_busy() - Get the programming state of the card
+ *
+ * @dev: MMC device
+ * @errsp: Returns the number of commands sent while the card was busy
+ * Return: number of SEND_STATUS commands before the card is ready
+ */
+uint sandbox_mmc_get_write_busy(struct udevice *dev, uint *errsp);
+
+/**
+ * sandbox_mmc_set_b_max() - Set the largest transfer the host can do
+ *
+ * @dev: MMC device
+ * @b_max: Maximum number of blocks for each read or write command
+ */
+void sandbox_mmc_set_b_max(struct udevice *dev, uint b_max);
+
+/**
+ * sandbox_mmc_set_size() - Set the size of the emulated card
+ *
+ * This emulates putting in a different card, so it takes effect when the
+ * device is next probed, which identifies the card again. It is not used
+ * for a card backed by a file.
+ *
+ * @dev: MMC device, which must not be active
+ * @size_mb: Size in MiB, or 0 for the default of 1MiB
+ */
+void sandbox_mmc_set_size(struct udevice *dev, uint size_mb);
+
+/**
+ * sandbox_mmc_get_xfers() - Get the number of multiple-block transfers
+ *
+ * @dev: MMC device
+ * @errsp: Returns the number of transfers which did not match the count
+ *	given by SET_BLOCK_COUNT, or were not ended by STOP_TRANSMISSION
+ * Return: number of multiple-block read and write commands
+ */
+uint sandbox_mmc_get_xfers(struct udevice *dev, uint *errsp);
+
+/**
+ * sandbox_mmc_set_high_speed() - Set up the speeds the card supports
+ *
+ * This emulates a card which supports SD high speed but cannot be read
+ * reliably in that mode, to test falling back to a slower mode.
+ *
+ * @dev: MMC device
+ * @high_speed: true if the card supports SD high speed (50MHz)
+ * @read_max_clock: Fail reads when the bus clock is above this, 0 for never
+ */
+void sandbox_mmc_set_high_speed(struct udevice *dev, bool high_speed,
+				uint read_max_clock);
+
+/**
+ * sandbox_mmc_set_ecc_error() - Set a block which the card cannot read
+ *
+ * Reads which include the block report an ECC failure in the card status,
+ * which is an error with the media rather than the bus.
+ *
+ * @dev: MMC device
+ * @blk: Block number which fails, 0 for none
+ */
+void sandbox_mmc_set_ecc_error(struct udevice *dev, uint blk);
+
+/**
+ * sandbox_nvme_set_reorder() - Complete I/O commands out of order
+ *
+ * @dev: NVMe device
+ * @count: Hold back completions until there are this many, then post them
+ *	in reverse order; 0 to post each one at once
+ */
+void sandbox_nvme_set_reorder(struct udevice *dev, uint count);
+
+/**
+ * sandbox_nvme_set_hang() - Stop an I/O command from completing
+ *
+ * Any command already held is completed first.
+ *
+ * @dev: NVMe device
+ * @cmd: Number of the I/O command to hold, counting from 1 for the next one
+ *	sent, or 0 for none
+ */
+void sandbox_nvme_set_hang(struct udevice *dev, uint cmd);
+
+/**
+ * sandbox_nvme_set_max_depth() - Set a limit on the queue depth
+ *
+ * This acts like a controller which takes fewer queue entries than it
+ * reports in CAP.MQES, and which fails to create a larger queue. The
+ * driver is told the limit, as a controller driver would know it. This
+ * must be called before the device is probed.
+ *
+ * @dev: NVMe device
+ * @depth: Most entries in each queue, 0 for no limit
+ */
+void sandbox_nvme_set_max_depth(struct udevice *dev, int depth);
+
+/**
+ * sandbox_nvme_get_inflight() - Get the I/O commands which are in flight
+ *
+ * @dev: NVMe device
+ * @maxp: Returns the most commands which have been in flight at once
+ * @errsp: Returns the number of commands sent with the ID of a command
+ *	which had not completed
+ * Return: number of commands which have not completed
+ */
+uint sandbox_nvme_get_inflight(struct udevice *dev, uint *maxp, uint *errsp);
+
+/**
+ * sandbox_mmc_cache_storage() - Get the emulated storage for the MMC cache
+ *
+ * Return: pointer to the storage, which is a struct mmc_cache
+ */
+struct mmc_cache *sandbox_mmc_cache_storage(void);
+
+/**
+ * sandbox_virtio_get_notifies() - Get the number of queue notifications
+ *
+ * @dev: virtio transport device
+ * Return: number of times the driver has notified the device of new buffers
+ */
+uint sandbox_virtio_get_notifies(struct udevice *dev);
+
+/**
+ * sandbox_virtio_blk_set_fail() - Make a sector of the block device fail
+ *
+ * A request which includes the sector then reports an I/O error.
+ *
+ * @dev: virtio transport device, bound to the virtio-sandbox-blk driver
+ * @sector: Sector which fails, or -1 for none
+ */
+void sandbox_virtio_blk_set_fail(struct udevice *dev, long sector);
+
+/**
+ * sandbox_virtio_blk_get_reqs() - Get the number of block requests handled
+ *
+ * @dev: virtio transport device, bound to the virtio-sandbox-blk driver
+ * @errsp: Returns the number of requests which had more or larger data
+ *	segments than the device allows
+ * Return: number of requests handled
+ */
+uint sandbox_virtio_blk_get_reqs(struct udevice *dev, uint *errsp);
+
 #endif
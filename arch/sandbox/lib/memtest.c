@@ -0,0 +1,20 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Run memory tests on host threads
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#include <common.h>
+#include <memtest.h>
+#include <os.h>
+
+uint arch_memtest_cpus(void)
+{
+	return os_num_cpus();
+}
+
+int arch_memtest_run(void (*func)(void *ctx, int cpu), void *ctx, uint cpus)
+{
+	return os_run_threads(func, ctx, cpus);
+}
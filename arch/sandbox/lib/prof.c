@@ -0,0 +1,20 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Sampling profiler timer, using SIGPROF
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#include <common.h>
+#include <os.h>
+#include <prof.h>
+
+int arch_prof_start(uint hz)
+{
+	return os_prof_start(hz, prof_sample);
+}
+
+void arch_prof_stop(void)
+{
+	os_prof_stop();
+}
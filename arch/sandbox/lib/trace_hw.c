@@ -0,0 +1,25 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Hardware counters for function tracing, using the host's perf events
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#include <common.h>
+#include <os.h>
+#include <trace.h>
+
+void __attribute__((no_instrument_function)) trace_hw_read(u64 vals[TRACE_HW_COUNT])
+{
+	os_perf_read(vals, TRACE_HW_COUNT);
+}
+
+void trace_hw_start(void)
+{
+	int ret;
+
+	ret = os_perf_open();
+	if (ret)
+		printf("trace: host perf counters unavailable (err=%d), using time\n",
+		       ret);
+}
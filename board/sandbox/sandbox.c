@@ -13,7 +13,9 @@
 #include <env_internal.h>
 #include <init.h>
 #include <led.h>
+#include <mmc.h>
 #include <os.h>
+#include <ram.h>
 #include <asm/global_data.h>
 #include <asm/test.h>
 #include <asm/u-boot-sandbox.h>
@@ -100,6 +102,60 @@ enum env_location env_get_location(enum env_operation op, int prio)
 	return env_locations[prio];
 }
 
+#if CONFIG_IS_ENABLED(RAM_TRAIN_CACHE)
+/* Emulates the reserved area of the boot medium holding the training record */
+static u8 ram_train_storage[CONFIG_RAM_TRAIN_CACHE_SIZE];
+
+u8 *sandbox_ram_train_storage(void)
+{
+	return ram_train_storage;
+}
+
+int board_ram_train_read(void *buf, ulong size)
+{
+	size = min(size, (ulong)sizeof(ram_train_storage));
+	memcpy(buf, ram_train_storage, size);
+
+	return size;
+}
+
+int board_ram_train_write(const void *buf, ulong size)
+{
+	if (size > sizeof(ram_train_storage))
+		return -E2BIG;
+	memcpy(ram_train_storage, buf, size);
+
+	return 0;
+}
+#endif
+
+#if CONFIG_IS_ENABLED(MMC_STATE_CACHE)
+/* Emulates the scratch registers holding the MMC card-state cache */
+static struct mmc_cache mmc_cache_storage;
+
+struct mmc_cache *sandbox_mmc_cache_storage(void)
+{
+	return &mmc_cache_storage;
+}
+
+int board_mmc_cache_read(void *buf, ulong size)
+{
+	size = min(size, (ulong)sizeof(mmc_cache_storage));
+	memcpy(buf, &mmc_cache_storage, size);
+
+	return size;
+}
+
+int board_mmc_cache_write(const void *buf, ulong size)
+{
+	if (size > sizeof(mmc_cache_storage))
+		return -E2BIG;
+	memcpy(&mmc_cache_storage, buf, size);
+
+	return 0;
+}
+#endif
+
 int dram_init(void)
 {
 	gd->ram_size = CONFIG_SYS_SDRAM_SIZE;
@@ -37,8 +37,11 @@
 #include <dm/device-internal.h>
 #include <g_dnl.h>
 #include <fdt_simplefb.h>
+#include <mtd.h>
 #include <mtd_node.h>
 #include <misc.h>
+#include <cmd_spl.h>
+#include <ram.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 static char found_partition[64] = {0};
@@ -138,6 +141,7 @@ int mmc_get_env_dev(void)
 		return MMC_DEV_SD;
 }
 
+#if CONFIG_IS_ENABLED(RAM_TRAIN_CACHE)
 static bool write_boot_storage_emmc(ulong byte_addr, ulong byte_size, void *buff)
 {
 	struct blk_desc *dev_desc = blk_get_dev("mmc", MMC_DEV_EMMC);
@@ -207,17 +211,120 @@ static bool write_training_info(void *buff, ulong byte_size)
 	return false;
 }
 
-void save_ddr_training_info(void)
+int board_ram_train_write(const void *buf, ulong size)
 {
-	struct ddr_training_info_t *info;
-	info = (struct ddr_training_info_t*)map_sysmem(DDR_TRAINING_INFO_BUFF, 0);
+	// save DDR training info to boot storage
+	if (!write_training_info((void *)buf, size))
+		return -EIO;
 
-	if ((DDR_TRAINING_INFO_MAGIC == info->magic) &&
-		(info->crc32 == crc32(0, (const uchar *)&info->chipid, sizeof(*info) - 8))) {
-		// save DDR training info to boot storage
-		write_training_info(info, sizeof(*info));
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_SYS_MMCSD_RAW_MODE_ARGS_PARTITION_NAME
+int board_falcon_args_write(const void *buf, ulong size)
+{
+	const char *part = CONFIG_SYS_MMCSD_RAW_MODE_ARGS_PARTITION_NAME;
+	enum board_boot_mode boot_storage = get_boot_storage();
+	struct disk_partition info;
+	struct blk_desc *dev_desc;
+	ulong count;
+
+	// spl only loads falcon args from emmc or sdcard
+	if (BOOT_MODE_EMMC == boot_storage)
+		dev_desc = blk_get_dev("mmc", MMC_DEV_EMMC);
+	else if (BOOT_MODE_SD == boot_storage)
+		dev_desc = blk_get_dev("mmc", MMC_DEV_SD);
+	else
+		return -ENOSYS;
+	if (!dev_desc || dev_desc->type == DEV_TYPE_UNKNOWN || !*part)
+		return -ENOSYS;
+
+	blk_dselect_hwpart(dev_desc, 0);
+	if (part_get_info_by_name(dev_desc, part, &info) < 0) {
+		pr_err("partition %s not found\n", part);
+		return -ENOENT;
+	}
+	count = DIV_ROUND_UP(size, dev_desc->blksz);
+	if (count > info.size)
+		return -E2BIG;
+
+	pr_info("write %ldbyte to partition %s\n", size, part);
+	if (blk_dwrite(dev_desc, info.start, count, buf) != count)
+		return -EIO;
+
+	// spl only starts the os once boot_os is set, see spl_start_uboot()
+	if (env_set("boot_os", "1"))
+		return -EIO;
+
+	return env_save();
+}
+#endif
+
+#if !defined(CONFIG_SPL_BUILD) && CONFIG_IS_ENABLED(MMC_STATE_CACHE)
+/*
+ * The mmc card-state cache is kept in the spinor 'private' partition: it
+ * is too big for the pmic scratch registers and cannot live on the cards
+ * it is needed to set up. Boards without a spinor do the full set-up.
+ */
+static struct mtd_info *get_mmc_cache_mtd(void)
+{
+	struct mtd_info *mtd;
+
+	mtd_probe_devices();
+	mtd = get_mtd_device_nm("private");
+	if (IS_ERR_OR_NULL(mtd))
+		return NULL;
+	if (mtd->type != MTD_NORFLASH ||
+	    MMC_CACHE_SAVE_ADDR + mtd->erasesize > mtd->size) {
+		put_mtd_device(mtd);
+		return NULL;
+	}
+
+	return mtd;
+}
+
+int board_mmc_cache_read(void *buf, ulong size)
+{
+	struct mtd_info *mtd;
+	size_t retlen = 0;
+	int ret;
+
+	mtd = get_mmc_cache_mtd();
+	if (!mtd)
+		return -ENODEV;
+	ret = mtd_read(mtd, MMC_CACHE_SAVE_ADDR, size, &retlen, buf);
+	put_mtd_device(mtd);
+
+	return ret ? ret : retlen;
+}
+
+int board_mmc_cache_write(const void *buf, ulong size)
+{
+	struct erase_info erase_op = {};
+	struct mtd_info *mtd;
+	size_t retlen;
+	int ret;
+
+	mtd = get_mmc_cache_mtd();
+	if (!mtd)
+		return -ENOSYS;
+	if (size > mtd->erasesize) {
+		put_mtd_device(mtd);
+		return -E2BIG;
 	}
+
+	erase_op.mtd = mtd;
+	erase_op.addr = MMC_CACHE_SAVE_ADDR;
+	erase_op.len = mtd->erasesize;
+	ret = mtd_erase(mtd, &erase_op);
+	if (!ret)
+		ret = mtd_write(mtd, MMC_CACHE_SAVE_ADDR, size, &retlen, buf);
+	put_mtd_device(mtd);
+
+	return ret;
 }
+#endif
 
 void get_ddr_config_info(void)
 {
@@ -803,7 +910,10 @@ int board_late_init(void)
 	struct tlvinfo_header *tlv_hdr = NULL;
 	struct tlvinfo_tlv *first_entry = NULL;
 
-	// save_ddr_training_info();
+	// save the ddr training result if spl had to do full training
+	ret = ram_train_save();
+	if (ret)
+		pr_err("Failed to save DDR training info: %d\n", ret);
 
 	// it MAY be NULL when did NOT load build-in env and eeprom is empty
 	if (NULL == env_get("product_name"))
@@ -15,6 +15,7 @@
 #include <linux/delay.h>
 #include <linux/io.h>
 #include <env.h>
+#include <serial.h>
 #include <env_internal.h>
 #include <mapmem.h>
 #include <asm/global_data.h>
@@ -23,6 +24,7 @@
 #include <stdlib.h>
 #include <u-boot/crc.h>
 #include <cpu_func.h>
+#include <ram.h>
 #include <dt-bindings/soc/spacemit-k1x.h>
 #include <display_options.h>
 
@@ -78,7 +80,6 @@
 #define MMC1_CMD_OFFSET    0x10
 #define MMC1_CLK_OFFSET    0x14
 
-extern int __data_start[], __data_end[];
 extern int k1x_eeprom_init(void);
 extern int spacemit_eeprom_read(uint8_t *buffer, uint8_t id);
 extern bool get_mac_address(uint64_t *mac_addr);
@@ -88,6 +89,7 @@ extern int spl_mtd_read(struct mtd_info *mtd, ulong sector, ulong count, void *b
 char *product_name;
 extern u32 ddr_cs_num, ddr_datarate;;
 extern const char *ddr_type;
+extern u64 ddr_chip_id;
 
 int timer_init(void)
 {
@@ -307,6 +309,7 @@ void load_board_config(int *eeprom_i2c_index, int *eeprom_pin_group, int *pmic_t
 	pr_debug("pmic_type :%d\n", *pmic_type);
 }
 
+#if CONFIG_IS_ENABLED(RAM_TRAIN_CACHE)
 static ulong read_boot_storage_emmc(ulong byte_addr, ulong byte_size, void *buff)
 {
 	ulong ret;
@@ -375,59 +378,15 @@ static ulong read_training_info(void *buff, ulong byte_size)
 	return 0;
 }
 
-bool restore_ddr_training_info(uint64_t chipid, uint64_t mac_addr)
+int board_ram_train_read(void *buf, ulong size)
 {
-	bool success = true;
-	struct ddr_training_info_t *info;
-	ulong flush_start, flush_lenth;
-
-	pr_debug("chipid %llx\n", chipid);
-	pr_debug("mac_addr %llx\n", mac_addr);
-
-	info = (struct ddr_training_info_t*)map_sysmem(DDR_TRAINING_INFO_BUFF, 0);
-	// Force to do DDR software training while in USB download mode or info is invalid
-	if ((BOOT_MODE_USB == get_boot_mode()) ||
-		(sizeof(*info) != read_training_info(info, sizeof(*info))) ||
-		(DDR_TRAINING_INFO_MAGIC != info->magic) ||
-		(chipid != info->chipid) ||
-		(mac_addr != info->mac_addr) ||
-		(DDR_TRAINING_INFO_VER != info->version) ||
-		(info->crc32 != crc32(0, (const uchar *)&info->chipid, sizeof(*info) - 8))) {
-		// clear magic, set invalid
-		memset(info, 0, sizeof(*info));
-		success = false;
-	}
-
-	flush_start = round_down((size_t)info, CONFIG_RISCV_CBOM_BLOCK_SIZE);
-	flush_lenth = round_up(sizeof(*info), CONFIG_RISCV_CBOM_BLOCK_SIZE);
-	flush_dcache_range(flush_start, flush_start + flush_lenth);
-	return success;
-}
-
-void update_ddr_training_info(uint64_t chipid, uint64_t mac_addr)
-{
-	struct ddr_training_info_t *info;
-	// ulong flush_start, flush_lenth;
-
-	info = (struct ddr_training_info_t*)map_sysmem(DDR_TRAINING_INFO_BUFF, 0);
-	if ((DDR_TRAINING_INFO_MAGIC == info->magic) &&
-		(info->crc32 == crc32(0, (const uchar *)&info->chipid, sizeof(*info) - 8))) {
-		// NO need to save ddr trainig info
-		info->magic = 0;
-		}
-	else {
-		// first time to do ddr training or ddr training info is update
-		info->magic = DDR_TRAINING_INFO_MAGIC;
-		info->chipid = chipid;
-		info->mac_addr = mac_addr;
-		info->version = DDR_TRAINING_INFO_VER;
-		info->crc32 = crc32(0, (const uchar *)&info->chipid, sizeof(*info) - 8);
-	}
+	// Force to do DDR software training while in USB download mode
+	if (BOOT_MODE_USB == get_boot_mode())
+		return -ENODEV;
 
-	// flush_start = round_down((size_t)info, CONFIG_RISCV_CBOM_BLOCK_SIZE);
-	// flush_lenth = round_up(sizeof(*info), CONFIG_RISCV_CBOM_BLOCK_SIZE);
-	// flush_dcache_range(flush_start, flush_start + flush_lenth);
+	return read_training_info(buf, size);
 }
+#endif
 
 void update_ddr_config_info(uint32_t cs_num)
 {
@@ -445,8 +404,6 @@ int spl_board_init_f(void)
 {
 	int ret;
 	struct udevice *dev;
-	bool flag;
-	// uint64_t chipid = 0, mac_addr = 0;
 
 #if CONFIG_IS_ENABLED(SYS_I2C_LEGACY)
 	/* init i2c */
@@ -459,25 +416,12 @@ int spl_board_init_f(void)
 
 	raise_cpu_frequency();
 #if CONFIG_IS_ENABLED(SPACEMIT_K1X_EFUSE)
-	// load_chipid_from_efuse(&chipid);
+	// the saved ddr training result is only valid for this chip
+	load_chipid_from_efuse(&ddr_chip_id);
 #endif
-	// get_mac_address(&mac_addr);
 
 	update_ddr_info();
 
-	// restore prevous saved ddr training info data
-	// flag = restore_ddr_training_info(chipid, mac_addr);
-	flag = true;
-	if (!flag) {
-		// flush data and stack
-		flush_dcache_range(CONFIG_SPL_BSS_START_ADDR, CONFIG_SPL_STACK);
-		flush_dcache_range(round_down((size_t)__data_start, CONFIG_RISCV_CBOM_BLOCK_SIZE),
-		 	round_up((size_t)__data_end, CONFIG_RISCV_CBOM_BLOCK_SIZE));
-		icache_disable();
-		dcache_disable();
-		invalidate_dcache_range(CONFIG_SPL_BSS_START_ADDR, CONFIG_SPL_STACK);
-	}
-
 	/* DDR init */
 	ret = uclass_get_device(UCLASS_RAM, 0, &dev);
 	if (ret) {
@@ -485,12 +429,11 @@ int spl_board_init_f(void)
 		return ret;
 	}
 
-	if (!flag) {
-		icache_enable();
-		dcache_enable();
-	}
-
-	// update_ddr_training_info(chipid, mac_addr);
+#if CONFIG_IS_ENABLED(RAM_TRAIN_CACHE)
+	// u-boot writes a new ddr training result back to boot storage
+	flush_dcache_range(CONFIG_RAM_TRAIN_CACHE_ADDR,
+			   CONFIG_RAM_TRAIN_CACHE_ADDR + CONFIG_RAM_TRAIN_CACHE_SIZE);
+#endif
 	update_ddr_config_info(ddr_cs_num);
 	timer_init();
 
@@ -701,6 +644,21 @@ void spl_board_init(void)
 	product_name = get_product_name();
 }
 
+#if CONFIG_IS_ENABLED(OS_BOOT)
+int spl_start_uboot(void)
+{
+	// always start u-boot in USB download mode, and when 'c' is pressed
+	if (BOOT_MODE_USB == get_boot_mode())
+		return 1;
+	if (serial_tstc() && serial_getc() == 'c')
+		return 1;
+
+	// 'spl prepare' sets and saves boot_os once the falcon args are
+	// written, see board_falcon_args_write()
+	return env_get_yesno("boot_os") == 1 ? 0 : 1;
+}
+#endif
+
 struct image_header *spl_get_load_buffer(ssize_t offset, size_t size)
 {
 	return map_sysmem(CONFIG_SPL_LOAD_FIT_ADDRESS, 0);
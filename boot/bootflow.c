@@ -265,6 +265,35 @@ static int bootflow_check(struct bootflow_iter *iter, struct bootflow *bflow)
 	return 0;
 }
 
+/**
+ * bootflow_start_all() - Start up the media of all bootdevs to be scanned
+ *
+ * Bootdevs are scanned in priority order and bringing up the media of each
+ * one can take a while, e.g. waiting for a card to power up. This starts
+ * them all off first, so that the waits overlap. The scan then goes through
+ * them in order as usual, so the first valid bootflow is still the one with
+ * the highest priority.
+ *
+ * Errors are ignored here, since they are reported by the scan itself
+ *
+ * @iter: Iterator containing the bootdevs to start
+ */
+static void bootflow_start_all(struct bootflow_iter *iter)
+{
+	struct udevice *dev;
+	int ret, i;
+
+	for (i = 0; i < iter->num_devs; i++) {
+		dev = iter->dev_order[i];
+		ret = device_probe(dev);
+		if (!ret)
+			ret = bootdev_start(dev);
+		if (ret && ret != -ENOSYS)
+			log_debug("Cannot start bootdev '%s' (err=%d)\n",
+				  dev->name, ret);
+	}
+}
+
 int bootflow_scan_bootdev(struct udevice *dev, struct bootflow_iter *iter,
 			  int flags, struct bootflow *bflow)
 {
@@ -282,6 +311,10 @@ int bootflow_scan_bootdev(struct udevice *dev, struct bootflow_iter *iter,
 	if (ret)
 		return log_msg_ret("obmeth", -ENODEV);
 
+	if ((flags & BOOTFLOWF_PARALLEL) &&
+	    !(iter->flags & BOOTFLOWF_SINGLE_DEV))
+		bootflow_start_all(iter);
+
 	/* Find the first bootmeth (there must be at least one!) */
 	iter->method = iter->method_order[iter->cur_method];
 	if (!IS_ENABLED(CONFIG_BOOTMETH_GLOBAL) || !iter->doing_global)
@@ -382,6 +415,11 @@ int bootflow_run_boot(struct bootflow_iter *iter, struct bootflow *bflow)
 
 	printf("** Booting bootflow '%s' with %s\n", bflow->name,
 	       bflow->method->name);
+	if (CONFIG_IS_ENABLED(BOOTSTD_CACHE)) {
+		ret = bootflow_cache_update(bflow);
+		if (ret)
+			log_debug("Cannot record bootflow (err=%d)\n", ret);
+	}
 	ret = bootflow_boot(bflow);
 	if (!IS_ENABLED(CONFIG_BOOTSTD_FULL)) {
 		printf("Boot failed (err=%d)\n", ret);
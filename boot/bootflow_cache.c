@@ -0,0 +1,213 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Cache of the last bootflow booted
+ *
+ * Scanning for bootflows means probing each bootdev, partition and filesystem
+ * in turn, which on most boots finds the same file in the same place as last
+ * time. Before booting a bootflow its location is recorded in an environment
+ * variable, along with the size and CRC32 of the bootflow file. The next
+ * 'bootflow scan -b' goes straight there, reads the file and checks that it
+ * is unchanged, falling back to a full scan if anything does not match.
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#define LOG_CATEGORY UCLASS_BOOTSTD
+
+#include <common.h>
+#include <bootdev.h>
+#include <bootflow.h>
+#include <bootmeth.h>
+#include <dm.h>
+#include <env.h>
+#include <log.h>
+#include <malloc.h>
+#include <u-boot/crc.h>
+
+/* Environment variable holding the record */
+#define BOOTFLOW_CACHE_VAR	"bootflow_cache"
+
+/* Fields of the record, in order; the filename is last as it may hold spaces */
+enum {
+	BFC_BOOTDEV,
+	BFC_PART,
+	BFC_BOOTMETH,
+	BFC_SIZE,
+	BFC_CRC,
+	BFC_FNAME,
+
+	BFC_COUNT,
+};
+
+static u32 bootflow_cache_crc(const struct bootflow *bflow)
+{
+	return crc32(0, (uchar *)bflow->buf, bflow->size);
+}
+
+/**
+ * bootflow_cache_split() - Split a record into its fields
+ *
+ * @str: Record to split, which is updated
+ * @fields: Returns a pointer to each field
+ * Return: 0 if OK, -EINVAL if there are too few fields
+ */
+static int bootflow_cache_split(char *str, char *fields[BFC_COUNT])
+{
+	int i;
+
+	for (i = 0; i < BFC_FNAME; i++) {
+		fields[i] = str;
+		str = strchr(str, ' ');
+		if (!str)
+			return -EINVAL;
+		*str++ = '\0';
+	}
+	fields[BFC_FNAME] = str;
+
+	return 0;
+}
+
+/* Check that @dev is one of the @count devices in @list */
+static bool bootflow_cache_in_list(struct udevice *dev, struct udevice **list,
+				   int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (list[i] == dev)
+			return true;
+	}
+
+	return false;
+}
+
+int bootflow_cache_find(struct bootflow *bflow)
+{
+	struct bootflow_iter iter;
+	char *fields[BFC_COUNT];
+	struct udevice *dev;
+	const char *rec;
+	char *str;
+	int ret;
+
+	memset(bflow, '\0', sizeof(*bflow));
+	rec = env_get(BOOTFLOW_CACHE_VAR);
+	if (!rec)
+		return -ENOENT;
+	str = strdup(rec);
+	if (!str)
+		return log_msg_ret("dup", -ENOMEM);
+	ret = bootflow_cache_split(str, fields);
+	if (ret)
+		goto err;
+
+	/*
+	 * Only use the bootdev and bootmeth if a scan would use them, so that
+	 * changes to boot_targets or the bootmeth order are respected
+	 */
+	bootflow_iter_init(&iter, BOOTFLOWF_SKIP_GLOBAL);
+	dev = NULL;
+	ret = bootdev_setup_iter_order(&iter, &dev);
+	if (!ret)
+		ret = bootmeth_setup_iter_order(&iter, false);
+	if (ret)
+		goto err_iter;
+	ret = -ESTALE;
+	if (uclass_get_device_by_name(UCLASS_BOOTDEV, fields[BFC_BOOTDEV],
+				      &dev) ||
+	    !bootflow_cache_in_list(dev, iter.dev_order, iter.num_devs))
+		goto err_iter;
+	if (uclass_get_device_by_name(UCLASS_BOOTMETH, fields[BFC_BOOTMETH],
+				      &iter.method) ||
+	    !bootflow_cache_in_list(iter.method, iter.method_order,
+				    iter.num_methods))
+		goto err_iter;
+	iter.dev = dev;
+	iter.part = simple_strtoul(fields[BFC_PART], NULL, 16);
+
+	ret = bootdev_get_bootflow(dev, &iter, bflow);
+	if (ret) {
+		log_debug("Cached bootflow not found (err=%d)\n", ret);
+		ret = -ESTALE;
+		goto err_bflow;
+	}
+	if (strcmp(bflow->fname, fields[BFC_FNAME]) ||
+	    bflow->size != simple_strtoul(fields[BFC_SIZE], NULL, 16) ||
+	    bootflow_cache_crc(bflow) !=
+	    simple_strtoul(fields[BFC_CRC], NULL, 16)) {
+		log_debug("Cached bootflow '%s' has changed\n", bflow->name);
+		ret = -ESTALE;
+		goto err_bflow;
+	}
+	log_debug("Using cached bootflow '%s'\n", bflow->name);
+	bootflow_iter_uninit(&iter);
+	free(str);
+
+	return 0;
+
+err_bflow:
+	bootflow_free(bflow);
+	memset(bflow, '\0', sizeof(*bflow));
+err_iter:
+	bootflow_iter_uninit(&iter);
+err:
+	free(str);
+
+	return ret;
+}
+
+int bootflow_cache_update(const struct bootflow *bflow)
+{
+	const char *old;
+	char *rec;
+	int len, ret;
+
+	if (!bflow->dev || !bflow->fname || !bflow->buf ||
+	    bflow->state != BOOTFLOWST_READY)
+		return -EINVAL;
+
+	len = strlen(bflow->dev->name) + strlen(bflow->method->name) +
+		strlen(bflow->fname) + 40;
+	rec = malloc(len);
+	if (!rec)
+		return log_msg_ret("rec", -ENOMEM);
+	snprintf(rec, len, "%s %x %s %x %08x %s", bflow->dev->name, bflow->part,
+		 bflow->method->name, bflow->size, bootflow_cache_crc(bflow),
+		 bflow->fname);
+
+	/* Avoid writing the environment on every boot */
+	old = env_get(BOOTFLOW_CACHE_VAR);
+	if (old && !strcmp(old, rec)) {
+		free(rec);
+		return 0;
+	}
+	ret = env_set(BOOTFLOW_CACHE_VAR, rec);
+	free(rec);
+	if (ret)
+		return log_msg_ret("set", -EIO);
+	if (IS_ENABLED(CONFIG_BOOTSTD_CACHE_SAVEENV)) {
+		ret = env_save();
+		if (ret)
+			return log_msg_ret("save", ret);
+	}
+
+	return 0;
+}
+
+int bootflow_cache_clear(void)
+{
+	int ret;
+
+	if (!env_get(BOOTFLOW_CACHE_VAR))
+		return 0;
+	ret = env_set(BOOTFLOW_CACHE_VAR, NULL);
+	if (ret)
+		return log_msg_ret("clr", -EIO);
+	if (IS_ENABLED(CONFIG_BOOTSTD_CACHE_SAVEENV)) {
+		ret = env_save();
+		if (ret)
+			return log_msg_ret("save", ret);
+	}
+
+	return 0;
+}
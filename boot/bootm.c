@@ -17,7 +17,10 @@
 #include <log.h>
 #include <malloc.h>
 #include <mapmem.h>
+#include <mmc.h>
 #include <net.h>
+#include <prof.h>
+#include <sched.h>
 #include <asm/cache.h>
 #include <asm/global_data.h>
 #include <asm/io.h>
@@ -472,6 +475,11 @@ ulong bootm_disable_interrupts(void)
 	 * recover from any failures any more...
 	 */
 	iflag = disable_interrupts();
+	prof_stop();
+	/* The OS may reset a card which is still programming a write */
+	mmc_wait_writes_done();
+	/* Background tasks must not touch the hardware once the OS has it */
+	sched_cancel_all();
 #ifdef CONFIG_NETCONSOLE
 	/* Stop the ethernet stack if NetConsole could have left it up */
 	eth_halt();
@@ -118,8 +118,12 @@ static int distro_pxe_read_file(struct udevice *dev, struct bootflow *bflow,
 	tftp_argv[1] = file_addr;
 	tftp_argv[2] = (void *)file_path;
 
-	if (do_tftpb(ctx->cmdtp, 0, 3, tftp_argv))
+	if (IS_ENABLED(CONFIG_CMD_WGET) && !strncmp(file_path, "http://", 7)) {
+		if (do_wget(ctx->cmdtp, 0, 3, tftp_argv))
+			return -ENOENT;
+	} else if (do_tftpb(ctx->cmdtp, 0, 3, tftp_argv)) {
 		return -ENOENT;
+	}
 	ret = pxe_get_file_size(&size);
 	if (ret)
 		return log_msg_ret("tftp", ret);
@@ -641,6 +641,12 @@ int image_setup_libfdt(bootm_headers_t *images, void *blob,
 #if CONFIG_IS_ENABLED(CMD_PSTORE)
 	/* Append PStore configuration */
 	fdt_fixup_pstore(blob);
+#endif
+#if CONFIG_IS_ENABLED(LOG_RING)
+	/* Hand the U-Boot log to the OS */
+	fdt_ret = log_ring_fdt_fixup(blob);
+	if (fdt_ret)
+		printf("WARNING: cannot add U-Boot log to fdt: %d\n", fdt_ret);
 #endif
 	if (IS_ENABLED(CONFIG_OF_BOARD_SETUP)) {
 		const char *skip_board_fixup;
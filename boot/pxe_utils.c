@@ -107,7 +107,9 @@ static int get_relfile(struct pxe_context *ctx, const char *file_path,
 	ulong size;
 	int ret;
 
-	if (file_path[0] == '/' && ctx->allow_abs_path)
+	/* A URL is never relative to the boot directory */
+	if ((file_path[0] == '/' && ctx->allow_abs_path) ||
+	    !strncmp(file_path, "http://", 7))
 		*relfile = '\0';
 	else
 		strncpy(relfile, ctx->bootdir, MAX_TFTP_PATH_LEN);
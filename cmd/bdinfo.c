@@ -11,6 +11,7 @@
 #include <dm.h>
 #include <env.h>
 #include <lmb.h>
+#include <malloc.h>
 #include <net.h>
 #include <video.h>
 #include <vsprintf.h>
@@ -66,6 +67,25 @@ __weak void arch_print_bdinfo(void)
 {
 }
 
+static void show_malloc_info(void)
+{
+	struct malloc_heap_info info;
+
+	malloc_heap_info(&info);
+	bdinfo_print_num_l("malloc base", info.start);
+	bdinfo_print_num_l("malloc size", info.size);
+	bdinfo_print_num_l("malloc used", info.used);
+	bdinfo_print_num_l("malloc peak", info.peak);
+	if (CONFIG_IS_ENABLED(SYS_MALLOC_POOL)) {
+		struct malloc_pool_stats stats;
+
+		malloc_pool_get_stats(&stats);
+		bdinfo_print_num_l("malloc pool", stats.start);
+		bdinfo_print_num_l("-> size", stats.size);
+		bdinfo_print_num_l("-> used", stats.in_use);
+	}
+}
+
 static void show_video_info(void)
 {
 	const struct udevice *dev;
@@ -107,6 +127,8 @@ int do_bdinfo(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
 	bdinfo_print_num_l("relocaddr", gd->relocaddr);
 	bdinfo_print_num_l("reloc off", gd->reloc_off);
 	printf("%-12s= %u-bit\n", "Build", (uint)sizeof(void *) * 8);
+	if (!CONFIG_IS_ENABLED(SYS_MALLOC_SIMPLE))
+		show_malloc_info();
 	if (IS_ENABLED(CONFIG_CMD_NET)) {
 		printf("current eth = %s\n", eth_get_name());
 		print_eth(0);
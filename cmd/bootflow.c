@@ -88,6 +88,39 @@ static void show_footer(int count, int num_valid)
 	       num_valid);
 }
 
+/**
+ * boot_cached_bootflow() - Try to boot the bootflow booted last time
+ *
+ * If the bootflow fails to boot, the record is dropped so that the next boot
+ * does a full scan rather than trying it first again.
+ *
+ * @list: true to say which bootflow is being used
+ * Return: 0 if there was a bootflow to try (which failed, since we are still
+ *	here), -ve if there was none
+ */
+static int boot_cached_bootflow(bool list)
+{
+	struct bootflow bflow;
+	int ret;
+
+	ret = bootflow_cache_find(&bflow);
+	if (ret)
+		return ret;
+	if (list)
+		printf("Using bootflow '%s' from the last boot\n", bflow.name);
+	ret = bootdev_add_bootflow(&bflow);
+	if (ret) {
+		bootflow_free(&bflow);
+		return ret;
+	}
+	bootflow_run_boot(NULL, &bflow);
+	ret = bootflow_cache_clear();
+	if (ret)
+		log_debug("Cannot clear bootflow record (err=%d)\n", ret);
+
+	return 0;
+}
+
 static int do_bootflow_scan(struct cmd_tbl *cmdtp, int flag, int argc,
 			    char *const argv[])
 {
@@ -96,7 +129,7 @@ static int do_bootflow_scan(struct cmd_tbl *cmdtp, int flag, int argc,
 	struct udevice *dev;
 	struct bootflow bflow;
 	bool all = false, boot = false, errors = false, no_global = false;
-	bool list = false;
+	bool list = false, parallel = false;
 	int num_valid = 0;
 	bool has_args;
 	int ret, i;
@@ -115,6 +148,7 @@ static int do_bootflow_scan(struct cmd_tbl *cmdtp, int flag, int argc,
 			errors = strchr(argv[1], 'e');
 			no_global = strchr(argv[1], 'G');
 			list = strchr(argv[1], 'l');
+			parallel = strchr(argv[1], 'p');
 			argc--;
 			argv++;
 		}
@@ -141,6 +175,8 @@ static int do_bootflow_scan(struct cmd_tbl *cmdtp, int flag, int argc,
 		flags |= BOOTFLOWF_ALL;
 	if (no_global)
 		flags |= BOOTFLOWF_SKIP_GLOBAL;
+	if (parallel || IS_ENABLED(CONFIG_BOOTSTD_PARALLEL_START))
+		flags |= BOOTFLOWF_PARALLEL;
 
 	/*
 	 * If we have a device, just scan for bootflows attached to that device
@@ -170,11 +206,14 @@ static int do_bootflow_scan(struct cmd_tbl *cmdtp, int flag, int argc,
 				bootflow_run_boot(&iter, &bflow);
 		}
 	} else {
+		bootstd_clear_glob();
+		if (IS_ENABLED(CONFIG_BOOTSTD_CACHE) && boot && !all &&
+		    !boot_cached_bootflow(list))
+			bootstd_clear_glob();
 		if (list) {
 			printf("Scanning for bootflows in all bootdevs\n");
 			show_header();
 		}
-		bootstd_clear_glob();
 
 		for (i = 0,
 		     ret = bootflow_scan_first(&iter, flags, &bflow);
@@ -387,7 +426,7 @@ static int do_bootflow_boot(struct cmd_tbl *cmdtp, int flag, int argc,
 #ifdef CONFIG_SYS_LONGHELP
 static char bootflow_help_text[] =
 #ifdef CONFIG_CMD_BOOTFLOW_FULL
-	"scan [-abeGl] [bdev]  - scan for valid bootflows (-l list, -a all, -e errors, -b boot, -G no global)\n"
+	"scan [-abeGlp] [bdev]  - scan for valid bootflows (-l list, -a all, -e errors, -b boot, -G no global, -p start all bootdevs first)\n"
 	"bootflow list [-e]             - list scanned bootflows (-e errors)\n"
 	"bootflow select [<num>|<name>] - select a bootflow\n"
 	"bootflow info [-d]             - show info on current bootflow (-d dump bootflow)\n"
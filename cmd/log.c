@@ -375,6 +375,40 @@ static int do_log_rec(struct cmd_tbl *cmdtp, int flag, int argc,
 	return 0;
 }
 
+static int do_log_dump(struct cmd_tbl *cmdtp, int flag, int argc,
+		       char *const argv[])
+{
+	if (!CONFIG_IS_ENABLED(LOG_RING)) {
+		printf("Log ring not enabled\n");
+		return CMD_RET_FAILURE;
+	}
+	if (argc > 1 && !strcmp(argv[1], "-c")) {
+		log_ring_clear();
+		return CMD_RET_SUCCESS;
+	}
+	if (log_ring_dump()) {
+		printf("Log ring not available\n");
+		return CMD_RET_FAILURE;
+	}
+
+	return CMD_RET_SUCCESS;
+}
+
+static int do_log_stats(struct cmd_tbl *cmdtp, int flag, int argc,
+			char *const argv[])
+{
+	if (!CONFIG_IS_ENABLED(LOG_RING)) {
+		printf("Log ring not enabled\n");
+		return CMD_RET_FAILURE;
+	}
+	if (log_ring_stats()) {
+		printf("Log ring not available\n");
+		return CMD_RET_FAILURE;
+	}
+
+	return CMD_RET_SUCCESS;
+}
+
 #ifdef CONFIG_SYS_LONGHELP
 static char log_help_text[] =
 	"level [<level>] - get/set log level\n"
@@ -405,7 +439,9 @@ static char log_help_text[] =
 	"\tc=category, l=level, F=file, L=line number, f=function, m=msg\n"
 	"\tor 'default', or 'all' for all\n"
 	"log rec <category> <level> <file> <line> <func> <message> - "
-		"output a log record"
+		"output a log record\n"
+	"log dump [-c] - show the records in the log ring; -c clears it\n"
+	"log stats - show per-category record counts and rates in the log ring"
 	;
 #endif
 
@@ -419,4 +455,6 @@ U_BOOT_CMD_WITH_SUBCMDS(log, "log system", log_help_text,
 	U_BOOT_SUBCMD_MKENT(filter-remove, 4, 1, do_log_filter_remove),
 	U_BOOT_SUBCMD_MKENT(format, 2, 1, do_log_format),
 	U_BOOT_SUBCMD_MKENT(rec, 7, 1, do_log_rec),
+	U_BOOT_SUBCMD_MKENT(dump, 2, 1, do_log_dump),
+	U_BOOT_SUBCMD_MKENT(stats, 1, 1, do_log_stats),
 );
@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Show malloc() heap statistics
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#include <common.h>
+#include <command.h>
+#include <display_options.h>
+#include <malloc.h>
+
+/**
+ * malloc_frag_pct() - Work out heap fragmentation as a percentage
+ *
+ * This is the proportion of free space which cannot be used for a single
+ * allocation, computed in KiB to avoid overflow on 32-bit machines.
+ *
+ * @info: Heap information
+ * Return: 0 if all free space is in one block, up to 100 if scattered
+ */
+static uint malloc_frag_pct(const struct malloc_heap_info *info)
+{
+	ulong free_kb = info->free >> 10;
+
+	if (!free_kb)
+		return 0;
+
+	return ((info->free - info->largest_free) >> 10) * 100 / free_kb;
+}
+
+static void show_heap(void)
+{
+	struct malloc_heap_info info;
+
+	malloc_heap_info(&info);
+	printf("Heap:           %08lx, ", info.start);
+	print_size(info.size, "\n");
+	printf("Used:           ");
+	print_size(info.used, "\n");
+	printf("Peak:           ");
+	print_size(info.peak, "\n");
+	printf("Free:           ");
+	print_size(info.free, "");
+	printf(" in %u chunks + top, largest ", info.free_chunks);
+	print_size(info.largest_free, "\n");
+	printf("Fragmentation:  %u%%\n", malloc_frag_pct(&info));
+}
+
+static void show_pools(void)
+{
+	struct malloc_pool_stats stats;
+	uint i;
+
+	malloc_pool_get_stats(&stats);
+	printf("Pools:          %08lx, ", stats.start);
+	print_size(stats.size, stats.enabled ? "\n" : " (disabled)\n");
+	printf("Pages:          %u / %u of %u bytes\n", stats.used_pages,
+	       stats.num_pages, stats.page_size);
+	printf("In use:         ");
+	print_size(stats.in_use, "\n");
+	printf("Fallbacks:      %lu\n", stats.fallbacks);
+	printf("\n%5s  %-5s  %5s  %7s  %7s  %10s\n", "Size", "Pool", "Pages",
+	       "In use", "Peak", "Allocs");
+	for (i = 0; i < stats.num_classes; i++) {
+		struct malloc_pool_class_stats *cls = &stats.cls[i];
+
+		if (!cls->pages)
+			continue;
+		printf("%5u  %-5s  %5u  %7u  %7u  %10lu\n", cls->size,
+		       cls->dma ? "dma" : "small", cls->pages, cls->in_use,
+		       cls->peak, cls->allocs);
+	}
+}
+
+static int do_malloc_info(struct cmd_tbl *cmdtp, int flag, int argc,
+			  char *const argv[])
+{
+	show_heap();
+	if (CONFIG_IS_ENABLED(SYS_MALLOC_POOL))
+		show_pools();
+
+	return 0;
+}
+
+#ifdef CONFIG_SYS_LONGHELP
+static char malloc_help_text[] =
+	"info   - show heap usage, fragmentation and size-class pool usage";
+#endif
+
+U_BOOT_CMD_WITH_SUBCMDS(malloc, "malloc() heap information", malloc_help_text,
+	U_BOOT_SUBCMD_MKENT(info, 1, 1, do_malloc_info));
@@ -22,7 +22,9 @@
 #endif
 #include <hash.h>
 #include <log.h>
+#include <malloc.h>
 #include <mapmem.h>
+#include <memtest.h>
 #include <rand.h>
 #include <watchdog.h>
 #include <asm/global_data.h>
@@ -1060,6 +1062,86 @@ static ulong mem_test_quick(vu_long *buf, ulong start_addr, ulong end_addr,
 	return errs;
 }
 
+static int mem_test_step(struct memtest *mt, enum memtest_pattern_t pat,
+			 int pass)
+{
+	return ctrlc() ? -EINTR : 0;
+}
+
+static void mem_test_engine_report(struct memtest *mt)
+{
+	struct memtest_region *rg;
+	int pat;
+	uint i;
+
+	for (pat = 0; pat < MEMTEST_PATTERN_COUNT; pat++) {
+		if (!(mt->patterns & BIT(pat)))
+			continue;
+		printf("  %-8s %6lu MB/s\n", memtest_pattern_name(pat),
+		       memtest_mbps(mt->stats[pat].bytes,
+				    mt->stats[pat].time_us));
+	}
+	for (i = 0, rg = mt->region; i < mt->num_regions; i++, rg++) {
+		if (!rg->errors)
+			continue;
+		printf("Region %08lx-%08lx: %lu errors, map %016llx\n",
+		       mt->addr + rg->addr, mt->addr + rg->addr + rg->size - 1,
+		       rg->errors, rg->map);
+		printf("  first @ %08lx: found %016llx, expected %016llx\n",
+		       rg->first_addr, rg->actual, rg->expect);
+	}
+}
+
+/*
+ * Run all patterns of the memory test engine over the region, using all
+ * CPUs unless @cpus is non-zero, and show the throughput of each.
+ */
+static ulong mem_test_engine(vu_long *buf, ulong start_addr, ulong end_addr,
+			     ulong pattern, int iteration, bool lines,
+			     uint cpus)
+{
+	struct memtest *mt;
+	ulong errs;
+	int ret;
+
+	mt = calloc(1, sizeof(*mt));
+	if (!mt) {
+		printf("Out of memory\n");
+		return -1UL;
+	}
+	mt->buf = (void *)buf;
+	mt->addr = start_addr;
+	mt->size = end_addr - start_addr;
+	mt->patterns = MEMTEST_ALL;
+	mt->pattern = pattern ? (u64)pattern << 32 | pattern :
+		0x5555555555555555ULL;
+	if (iteration & 1)
+		mt->pattern = ~mt->pattern;
+	mt->seed = pattern + iteration;
+	mt->lines = lines;
+	mt->max_cpus = cpus;
+	mt->step = mem_test_step;
+
+	ret = memtest_run(mt);
+	if (ret) {
+		if (ret != -EINTR)
+			printf("Memory test failed (err=%d)\n", ret);
+		free(mt);
+		return -1UL;
+	}
+	if (!iteration)
+		printf("\nUsing %u CPU(s), %u region(s), %s accesses\n",
+		       mt->num_cpus, mt->num_regions,
+		       lines ? "cache-line" : "64-bit");
+	else
+		putc('\n');
+	mem_test_engine_report(mt);
+	errs = mt->errors;
+	free(mt);
+
+	return errs;
+}
+
 /*
  * Perform a memory test. A more complete alternative test can be
  * configured using CONFIG_SYS_ALT_MEMTEST. The complete test loops until
@@ -1076,10 +1158,28 @@ static int do_mem_mtest(struct cmd_tbl *cmdtp, int flag, int argc,
 	ulong errs = 0;	/* number of errors, or -1 if interrupted */
 	ulong pattern = 0;
 	int iteration;
+	bool lines = false;
+	ulong cpus = 0;
 
 	start = CONFIG_SYS_MEMTEST_START;
 	end = CONFIG_SYS_MEMTEST_END;
 
+	while (IS_ENABLED(CONFIG_SYS_MEMTEST_ENGINE) && argc > 1 &&
+	       *argv[1] == '-') {
+		if (!strcmp(argv[1], "-c")) {
+			lines = true;
+		} else if (!strcmp(argv[1], "-j") && argc > 2) {
+			if (strict_strtoul(argv[2], 10, &cpus) < 0)
+				return CMD_RET_USAGE;
+			argc--;
+			argv++;
+		} else {
+			return CMD_RET_USAGE;
+		}
+		argc--;
+		argv++;
+	}
+
 	if (argc > 1)
 		if (strict_strtoul(argv[1], 16, &start) < 0)
 			return CMD_RET_USAGE;
@@ -1116,7 +1216,10 @@ static int do_mem_mtest(struct cmd_tbl *cmdtp, int flag, int argc,
 
 		printf("Iteration: %6d\r", iteration + 1);
 		debug("\n");
-		if (IS_ENABLED(CONFIG_SYS_ALT_MEMTEST)) {
+		if (IS_ENABLED(CONFIG_SYS_MEMTEST_ENGINE)) {
+			errs = mem_test_engine(buf, start, end, pattern,
+					       iteration, lines, cpus);
+		} else if (IS_ENABLED(CONFIG_SYS_ALT_MEMTEST)) {
 			errs = mem_test_alt(buf, start, end, dummy);
 			if (errs == -1UL)
 				break;
@@ -1421,9 +1524,15 @@ U_BOOT_CMD(
 
 #ifdef CONFIG_CMD_MEMTEST
 U_BOOT_CMD(
-	mtest,	5,	1,	do_mem_mtest,
+	mtest,	8,	1,	do_mem_mtest,
 	"simple RAM read/write test",
+#ifdef CONFIG_SYS_MEMTEST_ENGINE
+	"[-c] [-j cpus] [start [end [pattern [iterations]]]]\n"
+	"    -c  use cache-line bursts rather than single 64-bit accesses\n"
+	"    -j  use at most 'cpus' CPUs (default all)"
+#else
 	"[start [end [pattern [iterations]]]]"
+#endif
 );
 #endif	/* CONFIG_CMD_MEMTEST */
 
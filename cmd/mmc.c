@@ -14,9 +14,44 @@
 #include <part.h>
 #include <sparse_format.h>
 #include <image-sparse.h>
+#include <linux/math64.h>
 
 static int curr_device = -1;
 
+static void print_mmc_xfer_hist(struct mmc *mmc)
+{
+#if CONFIG_IS_ENABLED(MMC_XFER_HISTOGRAM)
+	int i;
+
+	puts("Transfers (blocks: count):\n");
+	for (i = 0; i < MMC_XFER_HIST_SIZE; i++) {
+		if (!mmc->xfer_hist[i])
+			continue;
+		if (i == MMC_XFER_HIST_SIZE - 1)
+			printf("  %7u+        %u\n", 1 << i, mmc->xfer_hist[i]);
+		else
+			printf("  %7u-%-7u %u\n", 1 << i, (2 << i) - 1,
+			       mmc->xfer_hist[i]);
+	}
+#endif
+}
+
+static void print_mmc_read_speed(struct mmc *mmc)
+{
+#if CONFIG_IS_ENABLED(MMC_SPEED_REPORT)
+	u64 bytes = mmc->read_blocks * mmc->read_bl_len;
+	u64 tenths;
+
+	if (!mmc->read_us)
+		return;
+	/* One byte per microsecond is 1 MB/s */
+	tenths = div64_u64(bytes * 10, mmc->read_us);
+	printf("Read Speed: %llu.%llu MB/s (", tenths / 10, tenths % 10);
+	print_size(bytes, "");
+	printf(" in %llu ms)\n", div_u64(mmc->read_us, 1000));
+#endif
+}
+
 static void print_mmcinfo(struct mmc *mmc)
 {
 	int i;
@@ -62,6 +97,8 @@ static void print_mmcinfo(struct mmc *mmc)
 	puts("Erase Group Size: ");
 	print_size(((u64)mmc->erase_grp_size) << 9, "\n");
 #endif
+	print_mmc_xfer_hist(mmc);
+	print_mmc_read_speed(mmc);
 
 	if (!IS_SD(mmc) && mmc->version >= MMC_VERSION_4_41) {
 		bool has_enh = (mmc->part_support & ENHNCD_SUPPORT) != 0;
@@ -143,8 +180,13 @@ static struct mmc *__init_mmc_device(int dev, bool force_init,
 	if (!mmc_getcd(mmc))
 		force_init = true;
 
-	if (force_init)
+	if (force_init) {
 		mmc->has_init = 0;
+#if CONFIG_IS_ENABLED(MMC_MODE_FALLBACK)
+		/* Give bus modes which failed earlier another try */
+		mmc->bad_caps = 0;
+#endif
+	}
 
 	if (IS_ENABLED(CONFIG_MMC_SPEED_MODE_SET))
 		mmc->user_speed_mode = speed_mode;
@@ -496,6 +538,40 @@ static int do_mmc_erase(struct cmd_tbl *cmdtp, int flag,
 
 	return (n == cnt) ? CMD_RET_SUCCESS : CMD_RET_FAILURE;
 }
+
+static int do_mmc_trim(struct cmd_tbl *cmdtp, int flag,
+		       int argc, char *const argv[])
+{
+	struct mmc *mmc;
+	u32 blk, cnt;
+	int ret;
+
+	if (argc != 3)
+		return CMD_RET_USAGE;
+
+	blk = hextoul(argv[1], NULL);
+	cnt = hextoul(argv[2], NULL);
+
+	mmc = init_mmc_device(curr_device, false);
+	if (!mmc)
+		return CMD_RET_FAILURE;
+
+	printf("\nMMC trim: dev # %d, block # %d, count %d ... ",
+	       curr_device, blk, cnt);
+
+	if (mmc_getwp(mmc) == 1) {
+		printf("Error: card is write protected!\n");
+		return CMD_RET_FAILURE;
+	}
+	ret = mmc_trim(mmc_get_blk_desc(mmc), blk, cnt);
+	if (ret == -ENOTSUPP) {
+		printf("Error: card does not support TRIM\n");
+		return CMD_RET_FAILURE;
+	}
+	printf("%d blocks trimmed: %s\n", ret ? 0 : cnt, ret ? "ERROR" : "OK");
+
+	return ret ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
 #endif
 
 static int do_mmc_rescan(struct cmd_tbl *cmdtp, int flag,
@@ -1079,6 +1155,7 @@ static struct cmd_tbl cmd_mmc[] = {
 #if CONFIG_IS_ENABLED(MMC_WRITE)
 	U_BOOT_CMD_MKENT(write, 4, 0, do_mmc_write, "", ""),
 	U_BOOT_CMD_MKENT(erase, 3, 0, do_mmc_erase, "", ""),
+	U_BOOT_CMD_MKENT(trim, 3, 0, do_mmc_trim, "", ""),
 #endif
 #if CONFIG_IS_ENABLED(CMD_MMC_SWRITE)
 	U_BOOT_CMD_MKENT(swrite, 3, 0, do_mmc_sparse_write, "", ""),
@@ -1142,6 +1219,7 @@ U_BOOT_CMD(
 	"mmc swrite addr blk#\n"
 #endif
 	"mmc erase blk# cnt\n"
+	"mmc trim blk# cnt - erase exactly these blocks (eMMC with TRIM only)\n"
 	"mmc rescan [mode]\n"
 	"mmc part - lists available partition on current mmc device\n"
 	"mmc dev [dev] [part] [mode] - show or set current mmc device [partition] and set mode\n"
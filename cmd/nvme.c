@@ -9,9 +9,38 @@
 #include <command.h>
 #include <dm.h>
 #include <nvme.h>
+#include <time.h>
+#include <linux/math64.h>
 
 static int nvme_curr_dev;
 
+/* Time a read from the current device, to check the transfer rate */
+static int nvme_bench(ulong addr, lbaint_t blk, ulong cnt)
+{
+	struct blk_desc *desc;
+	ulong n, us;
+	u64 bytes;
+
+	desc = blk_get_devnum_by_type(IF_TYPE_NVME, nvme_curr_dev);
+	if (!desc)
+		return CMD_RET_FAILURE;
+
+	us = timer_get_us();
+	n = blk_dread(desc, blk, cnt, (void *)addr);
+	us = max(timer_get_us() - us, 1UL);
+	if (n != cnt) {
+		printf("%lu blocks read: ERROR\n", n);
+		return CMD_RET_FAILURE;
+	}
+
+	/* One byte per microsecond is 1 MB/s */
+	bytes = (u64)n * desc->blksz;
+	printf("%lu blocks read in %lu us: %llu MB/s\n", n, us,
+	       div64_u64(bytes, us));
+
+	return 0;
+}
+
 static int do_nvme(struct cmd_tbl *cmdtp, int flag, int argc,
 		   char *const argv[])
 {
@@ -38,6 +67,10 @@ static int do_nvme(struct cmd_tbl *cmdtp, int flag, int argc,
 			return ret;
 		}
 	}
+	if (argc == 5 && !strcmp(argv[1], "bench"))
+		return nvme_bench(hextoul(argv[2], NULL),
+				  hextoul(argv[3], NULL),
+				  hextoul(argv[4], NULL));
 
 	return blk_common_cmd(argc, argv, IF_TYPE_NVME, &nvme_curr_dev);
 }
@@ -53,5 +86,7 @@ U_BOOT_CMD(
 	"nvme read addr blk# cnt - read `cnt' blocks starting at block\n"
 	"     `blk#' to memory address `addr'\n"
 	"nvme write addr blk# cnt - write `cnt' blocks starting at block\n"
-	"     `blk#' from memory address `addr'"
+	"     `blk#' from memory address `addr'\n"
+	"nvme bench addr blk# cnt - time a read of `cnt' blocks starting at\n"
+	"     block `blk#' to memory address `addr'"
 );
@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Control the sampling profiler
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#include <common.h>
+#include <command.h>
+#include <prof.h>
+
+static int do_prof_start(struct cmd_tbl *cmdtp, int flag, int argc,
+			 char *const argv[])
+{
+	int ret;
+
+	ret = prof_start();
+	if (ret) {
+		printf("Cannot start profiler (err=%d)\n", ret);
+		return CMD_RET_FAILURE;
+	}
+
+	return 0;
+}
+
+static int do_prof_stop(struct cmd_tbl *cmdtp, int flag, int argc,
+			char *const argv[])
+{
+	prof_stop();
+
+	return 0;
+}
+
+static int do_prof_reset(struct cmd_tbl *cmdtp, int flag, int argc,
+			 char *const argv[])
+{
+	prof_reset();
+
+	return 0;
+}
+
+static int do_prof_info(struct cmd_tbl *cmdtp, int flag, int argc,
+			char *const argv[])
+{
+	struct prof_stats stats;
+
+	prof_get_stats(&stats);
+	printf("Status:  %s\n", stats.running ? "running" : "stopped");
+	printf("Rate:    %u Hz\n", stats.hz);
+	printf("Samples: %u / %u\n", stats.count, stats.size);
+	printf("Dropped: %lu\n", stats.dropped);
+
+	return 0;
+}
+
+static int do_prof_report(struct cmd_tbl *cmdtp, int flag, int argc,
+			  char *const argv[])
+{
+	int count = 20;
+	int ret;
+
+	if (argc > 1)
+		count = dectoul(argv[1], NULL);
+	ret = prof_report(count);
+	if (ret == -ENOENT) {
+		printf("No samples\n");
+		return 0;
+	} else if (ret) {
+		printf("Cannot produce report (err=%d)\n", ret);
+		return CMD_RET_FAILURE;
+	}
+
+	return 0;
+}
+
+#ifdef CONFIG_SYS_LONGHELP
+static char prof_help_text[] =
+	"start                         - start sampling\n"
+	"prof stop                          - stop sampling\n"
+	"prof reset                         - discard samples\n"
+	"prof info                          - show sampler status\n"
+	"prof report [<n>]                  "
+		"- show the <n> busiest functions (default 20)";
+#endif
+
+U_BOOT_CMD_WITH_SUBCMDS(prof, "Sampling profiler", prof_help_text,
+	U_BOOT_SUBCMD_MKENT(start, 1, 1, do_prof_start),
+	U_BOOT_SUBCMD_MKENT(stop, 1, 1, do_prof_stop),
+	U_BOOT_SUBCMD_MKENT(reset, 1, 1, do_prof_reset),
+	U_BOOT_SUBCMD_MKENT(info, 1, 1, do_prof_info),
+	U_BOOT_SUBCMD_MKENT(report, 2, 1, do_prof_report));
@@ -33,8 +33,12 @@ static int do_get_tftp(struct pxe_context *ctx, const char *file_path,
 	tftp_argv[1] = file_addr;
 	tftp_argv[2] = (void *)file_path;
 
-	if (do_tftpb(ctx->cmdtp, 0, 3, tftp_argv))
+	if (IS_ENABLED(CONFIG_CMD_WGET) && !strncmp(file_path, "http://", 7)) {
+		if (do_wget(ctx->cmdtp, 0, 3, tftp_argv))
+			return -ENOENT;
+	} else if (do_tftpb(ctx->cmdtp, 0, 3, tftp_argv)) {
 		return -ENOENT;
+	}
 	ret = pxe_get_file_size(sizep);
 	if (ret)
 		return log_msg_ret("tftp", ret);
@@ -10,6 +10,7 @@
 #include <env.h>
 #include <image.h>
 #include <log.h>
+#include <mapmem.h>
 #include <asm/global_data.h>
 #include <linux/libfdt.h>
 
@@ -141,8 +142,57 @@ static int spl_export(struct cmd_tbl *cmdtp, int flag, int argc,
 	return 0;
 }
 
+#if defined(CONFIG_OF_LIBFDT) && defined(CONFIG_SYS_SPL_ARGS_ADDR)
+__weak int board_falcon_args_write(const void *buf, ulong size)
+{
+	return -ENOSYS;
+}
+
+/*
+ * Export the FDT, as 'spl export fdt' does, then keep it where SPL expects
+ * it so that later boots can start the kernel directly
+ */
+static int spl_prepare(struct cmd_tbl *cmdtp, int flag, int argc,
+		       char *const argv[])
+{
+	void *args;
+	ulong size;
+	int ret;
+
+	/* skip 'prepare' */
+	argc--;
+	argv++;
+	if (call_bootm(argc, argv, subcmd_list[SPL_EXPORT_FDT]))
+		return -1;
+
+	size = fdt_totalsize(images.ft_addr);
+	args = map_sysmem(CONFIG_SYS_SPL_ARGS_ADDR, size);
+	memmove(args, images.ft_addr, size);
+	printf("Falcon args are now in RAM: 0x%lx, size 0x%lx\n",
+	       (ulong)CONFIG_SYS_SPL_ARGS_ADDR, size);
+	env_set_hex("fdtargsaddr", CONFIG_SYS_SPL_ARGS_ADDR);
+	env_set_hex("fdtargslen", size);
+
+	ret = board_falcon_args_write(args, size);
+	unmap_sysmem(args);
+	if (ret == -ENOSYS) {
+		puts("Write them to the boot medium to use Falcon boot\n");
+		return 0;
+	} else if (ret) {
+		printf("Failed to save Falcon args (err=%d)\n", ret);
+		return -1;
+	}
+	puts("Falcon args saved\n");
+
+	return 0;
+}
+#endif
+
 static struct cmd_tbl cmd_spl_sub[] = {
 	U_BOOT_CMD_MKENT(export, 0, 1, (void *)SPL_EXPORT, "", ""),
+#if defined(CONFIG_OF_LIBFDT) && defined(CONFIG_SYS_SPL_ARGS_ADDR)
+	U_BOOT_CMD_MKENT(prepare, 0, 1, (void *)SPL_PREPARE, "", ""),
+#endif
 };
 
 static int do_spl(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
@@ -163,6 +213,16 @@ static int do_spl(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
 			if (spl_export(cmdtp, flag, argc, argv))
 				printf("Subcommand failed\n");
 			break;
+#if defined(CONFIG_OF_LIBFDT) && defined(CONFIG_SYS_SPL_ARGS_ADDR)
+		case SPL_PREPARE:
+			argc--;
+			argv++;
+			if (spl_prepare(cmdtp, flag, argc, argv)) {
+				printf("Subcommand failed\n");
+				return CMD_RET_FAILURE;
+			}
+			break;
+#endif
 		default:
 			/* unrecognized command */
 			return cmd_usage(cmdtp);
@@ -183,4 +243,8 @@ U_BOOT_CMD(
 	"\tinitrd_addr\taddress of initial ramdisk\n"
 	"\t\t\tcan be set to \"-\" if fdt_addr without initrd_addr is used.\n"
 	"\tfdt_addr\tin case of fdt, the address of the device tree.\n"
+#if defined(CONFIG_OF_LIBFDT) && defined(CONFIG_SYS_SPL_ARGS_ADDR)
+	"spl prepare [kernel_addr] [initrd_addr] [fdt_addr]\n"
+	"\t- export the fdt and save it for Falcon boot\n"
+#endif
 	);
@@ -76,6 +76,59 @@ static int create_call_list(int argc, char *const argv[])
 	return 0;
 }
 
+static int create_counter_list(int argc, char *const argv[])
+{
+	size_t buff_size, avail, buff_ptr, needed, used;
+	char *buff;
+	int err;
+
+	if (get_args(argc, argv, &buff, &buff_ptr, &buff_size))
+		return -1;
+
+	avail = buff_size - buff_ptr;
+	err = trace_list_counters(buff + buff_ptr, avail, &needed);
+	if (err == -ENOSYS) {
+		printf("Hardware counters are disabled\n");
+		return 0;
+	}
+	if (err)
+		printf("Error: truncated (%#zx bytes needed)\n", needed);
+	used = min(avail, (size_t)needed);
+	printf("Counter list dumped to %08lx, size %#zx\n",
+	       (ulong)map_to_sysmem(buff + buff_ptr), used);
+
+	env_set_hex("profbase", map_to_sysmem(buff));
+	env_set_hex("profsize", buff_size);
+	env_set_hex("profoffset", buff_ptr + used);
+
+	return 0;
+}
+
+static int show_top(int argc, char *const argv[])
+{
+	static const char *const names[TRACE_HW_COUNT] = {
+		[TRACE_HW_CYCLES]	= "cycles",
+		[TRACE_HW_INSTRET]	= "instret",
+		[TRACE_HW_EVENT]	= "event",
+	};
+	enum trace_hw_counter counter = TRACE_HW_CYCLES;
+	int count = 20;
+
+	if (argc > 2)
+		count = dectoul(argv[2], NULL);
+	if (argc > 3) {
+		for (counter = 0; counter < TRACE_HW_COUNT; counter++) {
+			if (!strcmp(argv[3], names[counter]))
+				break;
+		}
+		if (counter == TRACE_HW_COUNT)
+			return -1;
+	}
+	trace_print_counters(counter, count);
+
+	return 0;
+}
+
 int do_trace(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
 {
 	const char *cmd = argc < 2 ? NULL : argv[1];
@@ -100,6 +153,14 @@ int do_trace(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
 	case 's':
 		trace_print_stats();
 		break;
+	case 'h':
+		if (create_counter_list(argc, argv))
+			return cmd_usage(cmdtp);
+		break;
+	case 't':
+		if (show_top(argc, argv))
+			return cmd_usage(cmdtp);
+		break;
 	default:
 		return CMD_RET_USAGE;
 	}
@@ -115,5 +176,10 @@ U_BOOT_CMD(
 	"trace resume                       - resume tracing\n"
 	"trace funclist [<addr> <size>]     - dump function list into buffer\n"
 	"trace calls  [<addr> <size>]       "
-		"- dump function call trace into buffer"
+		"- dump function call trace into buffer\n"
+	"trace hwlist [<addr> <size>]       "
+		"- dump hardware counter totals into buffer\n"
+	"trace top [<n> [cycles|instret|event]]\n"
+	"                                   "
+		"- show functions with the highest counts"
 );
@@ -46,6 +46,7 @@
 #include <nand.h>
 #include <of_live.h>
 #include <onenand_uboot.h>
+#include <prof.h>
 #include <pvblock.h>
 #include <scsi.h>
 #include <serial.h>
@@ -274,6 +275,20 @@ static int initr_dm_devices(void)
 	return 0;
 }
 
+#ifdef CONFIG_PROFILER_AUTOSTART
+static int initr_prof(void)
+{
+	int ret;
+
+	/* A profiler failure should not stop the boot */
+	ret = prof_start();
+	if (ret)
+		printf("Profiler: cannot start (err=%d)\n", ret);
+
+	return 0;
+}
+#endif
+
 static int initr_bootstage(void)
 {
 	bootstage_mark_name(BOOTSTAGE_ID_START_UBOOT_R, "board_init_r");
@@ -675,6 +690,9 @@ static init_fnc_t init_sequence_r[] = {
 	arch_fsp_init_r,
 #endif
 	initr_dm_devices,
+#ifdef CONFIG_PROFILER_AUTOSTART
+	initr_prof,
+#endif
 	stdio_init_tables,
 	serial_initialize,
 	initr_announce,
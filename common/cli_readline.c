@@ -12,6 +12,7 @@
 #include <bootretry.h>
 #include <cli.h>
 #include <command.h>
+#include <sched.h>
 #include <time.h>
 #include <watchdog.h>
 #include <asm/global_data.h>
@@ -270,6 +271,7 @@ static int cread_line(const char *const prompt, char *buf, unsigned int *len,
 				if (get_ticks() >= etime)
 					return -2;	/* timed out */
 				WATCHDOG_RESET();
+				sched_yield();
 			}
 			first = 0;
 		}
@@ -15,6 +15,7 @@
 #include <malloc.h>
 #include <mapmem.h>
 #include <os.h>
+#include <sched.h>
 #include <serial.h>
 #include <stdio_dev.h>
 #include <exports.h>
@@ -482,6 +483,7 @@ int fgetc(int file)
 		 */
 		for (;;) {
 			WATCHDOG_RESET();
+			sched_yield();
 			if (CONFIG_IS_ENABLED(CONSOLE_MUX)) {
 				/*
 				 * Upper layer may have already called tstc() so
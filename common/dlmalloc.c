@@ -630,6 +630,13 @@ void mem_malloc_init(ulong start, ulong size)
 	      mem_malloc_end);
 #ifdef CONFIG_SYS_MALLOC_CLEAR_ON_INIT
 	memset((void *)mem_malloc_start, 0x0, size);
+#endif
+#if CONFIG_IS_ENABLED(SYS_MALLOC_POOL)
+	/* Carve the size-class pools from the top, leaving most for dlmalloc */
+	if (CONFIG_SYS_MALLOC_POOL_LEN <= size / 2) {
+		mem_malloc_end -= CONFIG_SYS_MALLOC_POOL_LEN;
+		malloc_pool_init(mem_malloc_end, CONFIG_SYS_MALLOC_POOL_LEN);
+	}
 #endif
 	malloc_bin_reloc();
 }
@@ -1281,11 +1288,8 @@ static void malloc_extend_top(nb) INTERNAL_SIZE_T nb;
 
 */
 
-#if __STD_C
-Void_t* mALLOc(size_t bytes)
-#else
-Void_t* mALLOc(bytes) size_t bytes;
-#endif
+/* Allocate a chunk from the heap itself, bypassing any size-class pool */
+static Void_t *heap_malloc(size_t bytes)
 {
   mchunkptr victim;                  /* inspected/selected chunk */
   INTERNAL_SIZE_T victim_size;       /* its size */
@@ -1536,6 +1540,25 @@ Void_t* mALLOc(bytes) size_t bytes;
 
 }
 
+#if __STD_C
+Void_t* mALLOc(size_t bytes)
+#else
+Void_t* mALLOc(bytes) size_t bytes;
+#endif
+{
+#if CONFIG_IS_ENABLED(SYS_MALLOC_POOL)
+	if ((gd->flags & GD_FLG_FULL_MALLOC_INIT) &&
+	    bytes <= MALLOC_POOL_MAX_SMALL) {
+		Void_t *mem = malloc_pool_alloc(bytes);
+
+		if (mem)
+			return mem;
+	}
+#endif
+
+	return heap_malloc(bytes);
+}
+
 
 
 
@@ -1589,6 +1612,9 @@ void fREe(mem) Void_t* mem;
   if (mem == NULL)                              /* free(0) has no effect */
     return;
 
+	if (malloc_pool_free(mem))
+		return;
+
   p = mem2chunk(mem);
   hd = p->size;
 
@@ -1748,6 +1774,22 @@ Void_t* rEALLOc(oldmem, bytes) Void_t* oldmem; size_t bytes;
 	}
 #endif
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_POOL)
+	if (malloc_pool_owns(oldmem)) {
+		size_t oldbytes = malloc_pool_usable_size(oldmem);
+
+		/* Keep the object if it still fits its size class */
+		if (bytes <= oldbytes)
+			return oldmem;
+		newmem = mALLOc(bytes);
+		if (!newmem)
+			return NULL;
+		MALLOC_COPY(newmem, oldmem, oldbytes);
+		malloc_pool_free(oldmem);
+		return newmem;
+	}
+#endif
+
   newp    = oldp    = mem2chunk(oldmem);
   newsize = oldsize = chunksize(oldp);
 
@@ -1969,6 +2011,14 @@ Void_t* mEMALIGn(alignment, bytes) size_t alignment; size_t bytes;
 	}
 #endif
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_POOL)
+	if (alignment > MALLOC_ALIGNMENT) {
+		m = malloc_pool_memalign(alignment, bytes);
+		if (m)
+			return m;
+	}
+#endif
+
   /* If need less alignment than we give anyway, just relay to malloc */
 
   if (alignment <= MALLOC_ALIGNMENT) return mALLOc(bytes);
@@ -1980,7 +2030,7 @@ Void_t* mEMALIGn(alignment, bytes) size_t alignment; size_t bytes;
   /* Call malloc with worst case padding to hit alignment. */
 
   nb = request2size(bytes);
-  m  = (char*)(mALLOc(nb + alignment + MINSIZE));
+  m  = (char*)(heap_malloc(nb + alignment + MINSIZE));
 
   /*
   * The attempt to over-allocate (with a size large enough to guarantee the
@@ -1996,7 +2046,7 @@ Void_t* mEMALIGn(alignment, bytes) size_t alignment; size_t bytes;
      * Use bytes not nb, since mALLOc internally calls request2size too, and
      * each call increases the size to allocate, to account for the header.
      */
-    m  = (char*)(mALLOc(bytes));
+    m  = (char*)(heap_malloc(bytes));
     /* Aligned -> return it */
     if ((((unsigned long)(m)) % alignment) == 0)
       return m;
@@ -2007,7 +2057,7 @@ Void_t* mEMALIGn(alignment, bytes) size_t alignment; size_t bytes;
     fREe(m);
     /* Add in extra bytes to match misalignment of unexpanded allocation */
     extra = alignment - (((unsigned long)(m)) % alignment);
-    m  = (char*)(mALLOc(bytes + extra));
+    m  = (char*)(heap_malloc(bytes + extra));
     /*
      * m might not be the same as before. Validate that the previous value of
      * extra still works for the current value of m.
@@ -2165,6 +2215,10 @@ Void_t* cALLOc(n, elem_size) size_t n; size_t elem_size;
 		return mem;
 	}
 #endif
+	if (malloc_pool_owns(mem)) {
+		memset(mem, 0, sz);
+		return mem;
+	}
     p = mem2chunk(mem);
 
     /* Two optional cases in which clearing not necessary */
@@ -2313,6 +2367,8 @@ size_t malloc_usable_size(mem) Void_t* mem;
   mchunkptr p;
   if (mem == NULL)
     return 0;
+  else if (malloc_pool_owns(mem))
+    return malloc_pool_usable_size(mem);
   else
   {
     p = mem2chunk(mem);
@@ -2362,7 +2418,7 @@ static void malloc_update_mallinfo()
   }
 
   current_mallinfo.ordblks = navail;
-  current_mallinfo.uordblks = sbrked_mem - avail;
+  current_mallinfo.uordblks = sbrked_mem - avail + malloc_pool_in_use();
   current_mallinfo.fordblks = avail;
   current_mallinfo.hblks = n_mmaps;
   current_mallinfo.hblkhd = mmapped_mem;
@@ -2417,6 +2473,35 @@ struct mallinfo mALLINFo()
 }
 #endif	/* DEBUG */
 
+void malloc_heap_info(struct malloc_heap_info *info)
+{
+	ulong avail, largest, tail;
+	mchunkptr p;
+	mbinptr b;
+	int i;
+
+	info->start = mem_malloc_start;
+	info->size = mem_malloc_end - mem_malloc_start;
+	info->peak = max_sbrked_mem;
+	info->free_chunks = 0;
+
+	/* The top chunk can grow into the part of the heap not yet sbrk'd */
+	tail = mem_malloc_end - mem_malloc_brk;
+	avail = chunksize(top) + tail;
+	largest = avail;
+	for (i = 1; i < NAV; ++i) {
+		b = bin_at(i);
+		for (p = last(b); p != b; p = p->bk) {
+			avail += chunksize(p);
+			largest = max(largest, (ulong)chunksize(p));
+			info->free_chunks++;
+		}
+	}
+	info->free = avail;
+	info->used = info->size - avail;
+	info->largest_free = largest;
+}
+
 
 
 
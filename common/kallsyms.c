@@ -6,13 +6,14 @@
  */
 
 #include <common.h>
+#include <kallsyms.h>
 
 /* We need the weak marking as this symbol is provided specially */
 extern const char system_map[] __attribute__((weak));
 
 /* Given an address, return a pointer to the symbol name and store
  * the base address in caddr.  So if the symbol map had an entry:
- *		03fb9b7c_spi_cs_deactivate
+ *		03fb9b7c _spi_cs_deactivate
  * Then the following call:
  *		unsigned long base;
  *		const char *sym = symbol_lookup(0x03fb9b80, &base);
@@ -32,7 +33,7 @@ const char *symbol_lookup(unsigned long addr, unsigned long *caddr)
 
 	while (*sym) {
 		sym_addr = hextoul(sym, &esym);
-		sym = esym;
+		sym = esym + 1;
 		if (sym_addr > addr)
 			break;
 		*caddr = sym_addr;
@@ -42,3 +43,18 @@ const char *symbol_lookup(unsigned long addr, unsigned long *caddr)
 
 	return csym;
 }
+
+const char *symbol_next(const char *pos, unsigned long *addr,
+			const char **name)
+{
+	char *esym;
+
+	if (!pos)
+		pos = system_map;
+	if (!pos || !*pos)
+		return NULL;
+	*addr = hextoul(pos, &esym);
+	*name = esym + 1;
+
+	return *name + strlen(*name) + 1;
+}
@@ -219,10 +219,22 @@ static int log_dispatch(struct log_rec *rec, const char *fmt, va_list args)
 	list_for_each_entry(ldev, &gd->log_head, sibling_node) {
 		if ((ldev->flags & LOGDF_ENABLE) &&
 		    log_passes_filters(ldev, rec)) {
+			va_list args_copy;
+
+			/* Each driver may consume the arguments */
+			if (ldev->drv->emit_fmt) {
+				va_copy(args_copy, args);
+				ldev->drv->emit_fmt(ldev, rec, fmt, args_copy);
+				va_end(args_copy);
+				continue;
+			}
 			if (!rec->msg) {
 				int len;
 
-				len = vsnprintf(buf, sizeof(buf), fmt, args);
+				va_copy(args_copy, args);
+				len = vsnprintf(buf, sizeof(buf), fmt,
+						args_copy);
+				va_end(args_copy);
 				rec->msg = buf;
 				gd->log_cont = len && buf[len - 1] != '\n';
 			}
@@ -431,6 +443,7 @@ int log_init(void)
 	struct log_driver *drv = ll_entry_start(struct log_driver, log_driver);
 	const int count = ll_entry_count(struct log_driver, log_driver);
 	struct log_driver *end = drv + count;
+	struct log_device *ldev;
 
 	/*
 	 * We cannot add runtime data to the driver since it is likely stored
@@ -439,8 +452,6 @@ int log_init(void)
 	 */
 	INIT_LIST_HEAD((struct list_head *)&gd->log_head);
 	while (drv < end) {
-		struct log_device *ldev;
-
 		ldev = calloc(1, sizeof(*ldev));
 		if (!ldev) {
 			debug("%s: Cannot allocate memory\n", __func__);
@@ -460,5 +471,14 @@ int log_init(void)
 	gd->logc_prev = LOGC_NONE;
 	gd->logl_prev = LOGL_INFO;
 
+	list_for_each_entry(ldev, (struct list_head *)&gd->log_head,
+			    sibling_node) {
+		if (ldev->drv->probe && ldev->drv->probe(ldev)) {
+			debug("%s: Cannot probe log driver '%s'\n", __func__,
+			      ldev->drv->name);
+			ldev->flags &= ~LOGDF_ENABLE;
+		}
+	}
+
 	return 0;
 }
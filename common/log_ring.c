@@ -0,0 +1,675 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Log driver which keeps unformatted records in a memory ring
+ *
+ * Records are stored as a header (timestamp, category, level, format string)
+ * followed by the raw arguments, so no vsnprintf() is needed on the boot
+ * path. Formatting happens only when the log is dumped or handed to the OS.
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#include <common.h>
+#include <console.h>
+#include <div64.h>
+#include <fdtdec.h>
+#include <log.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <time.h>
+#include <asm/global_data.h>
+#include <linux/ctype.h>
+#include <linux/libfdt.h>
+#include <linux/sizes.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Longest string argument copied into the ring, including the terminator */
+#define LOG_RING_MAX_STR	64
+
+/* Largest single record, header included */
+#define LOG_RING_MAX_REC	512
+
+/* Size of the text buffer used to format one record */
+#define LOG_RING_MSG_SIZE	CONFIG_SYS_CBSIZE
+
+enum log_ring_arg {
+	ARG_INT,
+	ARG_LONG,
+	ARG_LLONG,
+	ARG_SIZE,
+	ARG_PTRDIFF,
+	ARG_PTR,
+	ARG_STR,
+};
+
+/* Record holds formatted text rather than arguments (in log_ring_hdr.flags) */
+#define LOG_RING_TEXT		BIT(7)
+
+/**
+ * struct log_ring_hdr - header of a record in the ring
+ *
+ * @size: Total size of the record in bytes, including this header. Always
+ *	a multiple of 8. A size of 0 marks the end of the used part of the
+ *	ring, continuing at offset 0
+ * @line: Line number where the record was generated
+ * @cat: Log category
+ * @level: Log level
+ * @flags: Flags from struct log_rec, plus LOG_RING_TEXT
+ * @time_us: Timestamp in microseconds
+ * @fmt: Format string (must remain valid, as it lives in rodata)
+ * @file: Source file name
+ * @func: Function name
+ */
+struct log_ring_hdr {
+	u16 size;
+	u16 line;
+	u16 cat;
+	u8 level;
+	u8 flags;
+	u64 time_us;
+	const char *fmt;
+	const char *file;
+	const char *func;
+} __aligned(8);
+
+/**
+ * struct log_ring_stat - statistics for a log category
+ *
+ * @count: Number of records stored
+ * @first_us: Timestamp of the first record
+ * @last_us: Timestamp of the most recent record
+ */
+struct log_ring_stat {
+	ulong count;
+	u64 first_us;
+	u64 last_us;
+};
+
+/**
+ * struct log_ring_priv - state of the log ring
+ *
+ * @buf: Ring buffer
+ * @size: Size of @buf in bytes
+ * @head: Offset of the oldest record
+ * @tail: Offset where the next record is written
+ * @used: Number of bytes in use, including wrap padding
+ * @dropped: Number of old records overwritten to make room
+ * @stats: Per-category counters
+ * @text: Buffer holding the formatted log for the OS, or NULL if not yet
+ *	allocated. It is reused each time the devicetree is fixed up.
+ * @text_size: Size of @text in bytes
+ */
+struct log_ring_priv {
+	char *buf;
+	uint size;
+	uint head;
+	uint tail;
+	uint used;
+	ulong dropped;
+	struct log_ring_stat stats[LOGC_COUNT];
+	char *text;
+	uint text_size;
+};
+
+static struct log_ring_priv *log_ring_get_priv(void)
+{
+	struct log_device *ldev;
+
+	if (!(gd->flags & GD_FLG_LOG_READY))
+		return NULL;
+	list_for_each_entry(ldev, (struct list_head *)&gd->log_head,
+			    sibling_node) {
+		if (ldev->drv == LOG_GET_DRIVER(ring))
+			return ldev->priv;
+	}
+
+	return NULL;
+}
+
+/**
+ * log_ring_parse_spec() - Parse a printf() conversion specification
+ *
+ * @fmt: Points to the character after '%'
+ * @typep: Returns the argument type
+ * @nstarp: Returns the number of '*' width/precision arguments
+ * Return: pointer to the conversion character, or NULL if the conversion
+ *	cannot be stored unformatted (e.g. %p with an extension)
+ */
+static const char *log_ring_parse_spec(const char *fmt,
+				       enum log_ring_arg *typep, int *nstarp)
+{
+	int qual = 0;
+
+	*nstarp = 0;
+	while (*fmt && strchr("-+ #0", *fmt))
+		fmt++;
+	for (; isdigit(*fmt) || *fmt == '*' || *fmt == '.'; fmt++) {
+		if (*fmt == '*')
+			(*nstarp)++;
+	}
+	while (*fmt && strchr("hlLqzZt", *fmt)) {
+		qual = qual == 'l' && *fmt == 'l' ? 'L' : *fmt;
+		fmt++;
+	}
+
+	switch (*fmt) {
+	case 'c':
+	case 'd':
+	case 'i':
+	case 'u':
+	case 'x':
+	case 'X':
+	case 'o':
+		switch (qual) {
+		case 'l':
+			*typep = ARG_LONG;
+			break;
+		case 'L':
+		case 'q':
+			*typep = ARG_LLONG;
+			break;
+		case 'z':
+		case 'Z':
+			*typep = ARG_SIZE;
+			break;
+		case 't':
+			*typep = ARG_PTRDIFF;
+			break;
+		default:
+			*typep = ARG_INT;
+			break;
+		}
+		return fmt;
+	case 's':
+		*typep = ARG_STR;
+		return fmt;
+	case 'p':
+		/* Extensions like %pU dereference data which may not last */
+		if (isalnum(fmt[1]))
+			return NULL;
+		*typep = ARG_PTR;
+		return fmt;
+	}
+
+	return NULL;
+}
+
+/**
+ * log_ring_pack() - Store printf() arguments in a record body
+ *
+ * @fmt: Format string
+ * @args: Arguments
+ * @body: Place to put the arguments
+ * @size: Space available in @body
+ * Return: number of bytes used, or -E2BIG if they do not fit, or -ENOTSUPP
+ *	if @fmt cannot be formatted later
+ */
+static int log_ring_pack(const char *fmt, va_list args, char *body, int size)
+{
+	char *ptr = body;
+
+	while ((fmt = strchr(fmt, '%'))) {
+		enum log_ring_arg type;
+		int nstar, i;
+		u64 val;
+
+		if (*++fmt == '%') {
+			fmt++;
+			continue;
+		}
+		fmt = log_ring_parse_spec(fmt, &type, &nstar);
+		if (!fmt)
+			return -ENOTSUPP;
+		fmt++;
+
+		if (ptr + (nstar + 1) * sizeof(u64) > body + size)
+			return -E2BIG;
+		for (i = 0; i < nstar; i++) {
+			*(u64 *)ptr = va_arg(args, int);
+			ptr += sizeof(u64);
+		}
+
+		switch (type) {
+		case ARG_INT:
+			val = va_arg(args, int);
+			break;
+		case ARG_LONG:
+			val = va_arg(args, long);
+			break;
+		case ARG_LLONG:
+			val = va_arg(args, long long);
+			break;
+		case ARG_SIZE:
+			val = va_arg(args, size_t);
+			break;
+		case ARG_PTRDIFF:
+			val = va_arg(args, ptrdiff_t);
+			break;
+		case ARG_PTR:
+			val = (ulong)va_arg(args, void *);
+			break;
+		case ARG_STR: {
+			const char *str = va_arg(args, const char *);
+			int len;
+
+			/* Strings are copied since they may be on the stack */
+			if (!str)
+				str = "(null)";
+			len = strnlen(str, LOG_RING_MAX_STR - 1);
+			if (ptr + ALIGN(len + 1, sizeof(u64)) > body + size)
+				return -E2BIG;
+			memcpy(ptr, str, len);
+			ptr[len] = '\0';
+			ptr += ALIGN(len + 1, sizeof(u64));
+			continue;
+		}
+		}
+		*(u64 *)ptr = val;
+		ptr += sizeof(u64);
+	}
+
+	return ptr - body;
+}
+
+/**
+ * log_ring_unpack() - Format a record body stored by log_ring_pack()
+ *
+ * Each conversion is formatted on its own with snprintf(), with any '*'
+ * replaced by the stored width or precision.
+ *
+ * @fmt: Format string
+ * @body: Arguments stored by log_ring_pack()
+ * @buf: Output buffer
+ * @size: Size of @buf
+ * Return: number of characters written to @buf, excluding the terminator
+ */
+static int log_ring_unpack(const char *fmt, const char *body, char *buf,
+			   int size)
+{
+	char *out = buf, *end = buf + size - 1;
+
+	while (*fmt && out < end) {
+		enum log_ring_arg type;
+		const char *conv, *p;
+		char spec[32], *sp;
+		int nstar, len;
+		u64 val;
+
+		if (*fmt != '%') {
+			*out++ = *fmt++;
+			continue;
+		}
+		if (fmt[1] == '%') {
+			*out++ = '%';
+			fmt += 2;
+			continue;
+		}
+		conv = log_ring_parse_spec(fmt + 1, &type, &nstar);
+		if (!conv || conv - fmt + 1 + nstar * 12 >= (int)sizeof(spec))
+			break;
+
+		/* Rebuild the specification, filling in any '*' values */
+		sp = spec;
+		for (p = fmt; p <= conv; p++) {
+			if (*p == '*') {
+				sp += sprintf(sp, "%d", (int)*(u64 *)body);
+				body += sizeof(u64);
+			} else {
+				*sp++ = *p;
+			}
+		}
+		*sp = '\0';
+		fmt = conv + 1;
+
+		if (type == ARG_STR) {
+			len = snprintf(out, end - out + 1, spec, body);
+			body += ALIGN(strlen(body) + 1, sizeof(u64));
+			out += min_t(int, len, end - out);
+			continue;
+		}
+
+		val = *(u64 *)body;
+		body += sizeof(u64);
+		switch (type) {
+		case ARG_INT:
+			len = snprintf(out, end - out + 1, spec, (int)val);
+			break;
+		case ARG_LONG:
+			len = snprintf(out, end - out + 1, spec, (long)val);
+			break;
+		case ARG_LLONG:
+			len = snprintf(out, end - out + 1, spec,
+				       (long long)val);
+			break;
+		case ARG_SIZE:
+			len = snprintf(out, end - out + 1, spec, (size_t)val);
+			break;
+		case ARG_PTRDIFF:
+			len = snprintf(out, end - out + 1, spec,
+				       (ptrdiff_t)val);
+			break;
+		default:
+			len = snprintf(out, end - out + 1, spec,
+				       (void *)(ulong)val);
+			break;
+		}
+		out += min_t(int, len, end - out);
+	}
+	*out = '\0';
+
+	return out - buf;
+}
+
+/* Drop the oldest record to make space */
+static void log_ring_drop_oldest(struct log_ring_priv *priv)
+{
+	struct log_ring_hdr *hdr = (void *)priv->buf + priv->head;
+
+	if (!hdr->size) {
+		/* Padding at the end of the buffer */
+		priv->used -= priv->size - priv->head;
+		priv->head = 0;
+		return;
+	}
+	priv->used -= hdr->size;
+	priv->head += hdr->size;
+	if (priv->head == priv->size)
+		priv->head = 0;
+	priv->dropped++;
+}
+
+/**
+ * log_ring_alloc() - Reserve space for a record at the end of the ring
+ *
+ * Old records are dropped as needed.
+ *
+ * @priv: Ring state
+ * @size: Record size (multiple of 8)
+ * Return: pointer to the space
+ */
+static void *log_ring_alloc(struct log_ring_priv *priv, uint size)
+{
+	void *ptr;
+
+	/* Records are never split, so pad out the end of the buffer if needed */
+	if (priv->tail + size > priv->size) {
+		while (priv->used && priv->head >= priv->tail)
+			log_ring_drop_oldest(priv);
+		((struct log_ring_hdr *)(priv->buf + priv->tail))->size = 0;
+		priv->used += priv->size - priv->tail;
+		priv->tail = 0;
+	}
+
+	/* Drop records which start where the new one goes */
+	while (priv->used && priv->head >= priv->tail &&
+	       priv->head < priv->tail + size)
+		log_ring_drop_oldest(priv);
+
+	ptr = priv->buf + priv->tail;
+	priv->tail += size;
+	if (priv->tail == priv->size)
+		priv->tail = 0;
+	priv->used += size;
+
+	return ptr;
+}
+
+static int log_ring_emit_fmt(struct log_device *ldev, struct log_rec *rec,
+			     const char *fmt, va_list args)
+{
+	struct log_ring_priv *priv = ldev->priv;
+	char body[LOG_RING_MAX_REC - sizeof(struct log_ring_hdr)];
+	struct log_ring_stat *stat;
+	struct log_ring_hdr *hdr;
+	va_list args_copy;
+	u8 flags = rec->flags;
+	u64 now;
+	int len;
+
+	if (!priv || !priv->buf)
+		return -ENOSPC;
+
+	va_copy(args_copy, args);
+	len = log_ring_pack(fmt, args_copy, body, sizeof(body));
+	va_end(args_copy);
+	if (len < 0) {
+		/* Fall back to formatting now */
+		len = vsnprintf(body, sizeof(body), fmt, args);
+		len = min(len, (int)sizeof(body) - 1) + 1;
+		flags |= LOG_RING_TEXT;
+	}
+
+	now = timer_get_us();
+	hdr = log_ring_alloc(priv, ALIGN(sizeof(*hdr) + len, sizeof(u64)));
+	hdr->size = ALIGN(sizeof(*hdr) + len, sizeof(u64));
+	hdr->line = rec->line;
+	hdr->cat = rec->cat;
+	hdr->level = rec->level;
+	hdr->flags = flags;
+	hdr->time_us = now;
+	hdr->fmt = fmt;
+	hdr->file = rec->file;
+	hdr->func = rec->func;
+	memcpy(hdr + 1, body, len);
+
+	if (rec->cat < LOGC_COUNT) {
+		stat = &priv->stats[rec->cat];
+		if (!stat->count++)
+			stat->first_us = now;
+		stat->last_us = now;
+	}
+
+	return 0;
+}
+
+/**
+ * log_ring_format_rec() - Turn a record into a line of text
+ *
+ * @hdr: Record to format
+ * @buf: Output buffer
+ * @size: Size of @buf
+ * Return: number of characters written to @buf, excluding the terminator
+ */
+static int log_ring_format_rec(struct log_ring_hdr *hdr, char *buf, int size)
+{
+	int len = 0;
+
+	if (!(hdr->flags & LOGRECF_CONT))
+		len = snprintf(buf, size, "[%5llu.%06llu] %s.%s ",
+			       hdr->time_us / 1000000, hdr->time_us % 1000000,
+			       log_get_level_name(hdr->level),
+			       log_get_cat_name(hdr->cat));
+	len = min(len, size - 1);
+	if (hdr->flags & LOG_RING_TEXT)
+		len += strlcpy(buf + len, (char *)(hdr + 1), size - len);
+	else
+		len += log_ring_unpack(hdr->fmt, (char *)(hdr + 1), buf + len,
+				       size - len);
+
+	return min(len, size - 1);
+}
+
+/**
+ * log_ring_for_each() - Call a function for each record, oldest first
+ *
+ * @priv: Ring state
+ * @func: Function to call with the formatted record; stop if it returns
+ *	non-zero
+ * @ctx: Context for @func
+ */
+static void log_ring_for_each(struct log_ring_priv *priv,
+			      int (*func)(void *ctx, const char *msg),
+			      void *ctx)
+{
+	char msg[LOG_RING_MSG_SIZE];
+	uint pos = priv->head, done = 0;
+
+	while (done < priv->used) {
+		struct log_ring_hdr *hdr = (void *)priv->buf + pos;
+
+		if (!hdr->size) {
+			done += priv->size - pos;
+			pos = 0;
+			continue;
+		}
+		log_ring_format_rec(hdr, msg, sizeof(msg));
+		if (func(ctx, msg))
+			return;
+		done += hdr->size;
+		pos += hdr->size;
+		if (pos == priv->size)
+			pos = 0;
+	}
+}
+
+static int log_ring_print(void *ctx, const char *msg)
+{
+	puts(msg);
+
+	return ctrlc();
+}
+
+int log_ring_dump(void)
+{
+	struct log_ring_priv *priv = log_ring_get_priv();
+
+	if (!priv || !priv->buf)
+		return -ENOENT;
+	if (priv->dropped)
+		printf("(%lu older records dropped)\n", priv->dropped);
+	log_ring_for_each(priv, log_ring_print, NULL);
+
+	return 0;
+}
+
+int log_ring_stats(void)
+{
+	struct log_ring_priv *priv = log_ring_get_priv();
+	int i;
+
+	if (!priv || !priv->buf)
+		return -ENOENT;
+	printf("Ring: %u of %u bytes used, %lu records dropped\n", priv->used,
+	       priv->size, priv->dropped);
+	printf("%-20s %10s %10s\n", "Category", "Records", "Per sec");
+	for (i = 0; i < LOGC_COUNT; i++) {
+		struct log_ring_stat *stat = &priv->stats[i];
+		u64 span = stat->last_us - stat->first_us;
+		ulong rate = 0;
+
+		if (!stat->count)
+			continue;
+		if (span)
+			rate = lldiv((u64)(stat->count - 1) * 1000000, span);
+		printf("%-20s %10lu %10lu\n", log_get_cat_name(i), stat->count,
+		       rate);
+	}
+
+	return 0;
+}
+
+void log_ring_clear(void)
+{
+	struct log_ring_priv *priv = log_ring_get_priv();
+
+	if (!priv)
+		return;
+	priv->head = 0;
+	priv->tail = 0;
+	priv->used = 0;
+	priv->dropped = 0;
+	memset(priv->stats, '\0', sizeof(priv->stats));
+}
+
+struct log_ring_text {
+	char *buf;
+	int size;
+	int len;
+};
+
+static int log_ring_add_text(void *ctx, const char *msg)
+{
+	struct log_ring_text *text = ctx;
+
+	text->len += strlcpy(text->buf + text->len, msg,
+			     text->size - text->len);
+	if (text->len >= text->size - 1) {
+		text->len = text->size - 1;
+		return 1;
+	}
+
+	return 0;
+}
+
+int log_ring_fdt_fixup(void *blob)
+{
+	struct log_ring_priv *priv = log_ring_get_priv();
+	struct fdt_memory mem;
+	struct log_ring_text text;
+	const char *compat = "u-boot,log";
+	int ret;
+
+	if (!priv || !priv->buf || !priv->used)
+		return 0;
+
+	/* Formatted text is larger than the binary records; allow for that */
+	if (!priv->text) {
+		priv->text_size = ALIGN(priv->size * 2, SZ_4K);
+		priv->text = memalign(SZ_4K, priv->text_size);
+		if (!priv->text)
+			return log_msg_ret("txt", -ENOMEM);
+	}
+	text.buf = priv->text;
+	text.size = priv->text_size;
+	text.len = 0;
+	text.buf[0] = '\0';
+	log_ring_for_each(priv, log_ring_add_text, &text);
+
+	mem.start = map_to_sysmem(text.buf);
+	mem.end = mem.start + ALIGN(text.len + 1, SZ_4K) - 1;
+	ret = fdtdec_add_reserved_memory(blob, "u-boot-log", &mem, &compat, 1,
+					 NULL, FDTDEC_RESERVED_MEMORY_NO_MAP);
+	if (ret)
+		return log_msg_ret("res", ret);
+
+	return 0;
+}
+
+static int log_ring_probe(struct log_device *ldev)
+{
+	struct log_ring_priv *priv;
+	int ret;
+
+	/*
+	 * Before relocation there is not enough memory for the ring. Records
+	 * are discarded until log_init() is called again from board_r.
+	 */
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return 0;
+
+	priv = calloc(1, sizeof(*priv));
+	if (!priv)
+		return -ENOMEM;
+	priv->size = ALIGN_DOWN(CONFIG_LOG_RING_SIZE, sizeof(u64));
+	priv->buf = malloc(priv->size);
+	if (!priv->buf) {
+		free(priv);
+		return -ENOMEM;
+	}
+	ldev->priv = priv;
+
+	/* Record more than the console shows, by default */
+	ret = log_add_filter("ring", NULL, CONFIG_LOG_RING_LEVEL, NULL);
+	if (ret < 0)
+		return ret;
+
+	return 0;
+}
+
+LOG_DRIVER(ring) = {
+	.name		= "ring",
+	.emit_fmt	= log_ring_emit_fmt,
+	.probe		= log_ring_probe,
+	.flags		= LOGDF_ENABLE,
+};
@@ -0,0 +1,270 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Size-class pools in front of dlmalloc
+ *
+ * Driver model allocates a large number of small, fixed-size objects (device
+ * and uclass private data, devres records, names) and drivers allocate many
+ * cache-aligned buffers with memalign(). Served from the general heap these
+ * are slow to split and leave it fragmented. Here they are instead taken from
+ * per-class free lists, each class owning whole pages of a region carved from
+ * the top of the malloc() area.
+ *
+ * Pages are assigned to a class on first use and are not returned when the
+ * class empties, so the region should be sized for the peak number of small
+ * objects. Requests which do not fit are passed on to dlmalloc.
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#define LOG_CATEGORY LOGC_ALLOC
+
+#include <common.h>
+#include <log.h>
+#include <malloc.h>
+#include <asm/cache.h>
+#include <linux/log2.h>
+
+#define POOL_PAGE_SHIFT		12
+#define POOL_PAGE_SIZE		(1UL << POOL_PAGE_SHIFT)
+#define POOL_PAGE_FREE		0xff
+
+/* Smallest object in the DMA-aligned pool */
+#define POOL_DMA_MIN		max(ARCH_DMA_MINALIGN, 16)
+
+static const ushort small_sizes[] = {
+	16, 32, 48, 64, 96, 128, 192, 256, 384, 512,
+};
+
+/**
+ * struct pool_class - a size class
+ *
+ * @free:	Singly linked list of free objects, most recently freed first
+ * @stats:	Statistics for this class
+ */
+struct pool_class {
+	void *free;
+	struct malloc_pool_class_stats stats;
+};
+
+/**
+ * struct pool_state - state of the size-class pools
+ *
+ * @start:	Start of the region passed to malloc_pool_init()
+ * @size:	Size of that region
+ * @base:	Address of the first page
+ * @num_pages:	Number of pages
+ * @next_page:	Index of the first page never assigned to a class
+ * @page_class:	Class index for each page, POOL_PAGE_FREE if not yet assigned
+ * @enabled:	true to serve new allocations
+ * @in_use:	Bytes currently allocated
+ * @fallbacks:	Requests which fitted a class but found no space
+ * @num_classes: Number of classes in @cls
+ * @first_dma:	Index of the first DMA-aligned class in @cls
+ * @small_class: Class index for each 16-byte step of a small request
+ * @cls:	Size classes, small-object classes first
+ */
+struct pool_state {
+	ulong start;
+	ulong size;
+	ulong base;
+	uint num_pages;
+	uint next_page;
+	u8 *page_class;
+	bool enabled;
+	ulong in_use;
+	ulong fallbacks;
+	uint num_classes;
+	uint first_dma;
+	u8 small_class[MALLOC_POOL_MAX_SMALL / 16 + 1];
+	struct pool_class cls[MALLOC_POOL_MAX_CLASSES];
+};
+
+static struct pool_state pool;
+
+/**
+ * pool_refill() - Assign a new page to a class and fill its free list
+ *
+ * @pc: Class to refill
+ * Return: 0 if OK, -ENOMEM if there are no pages left
+ */
+static int pool_refill(struct pool_class *pc)
+{
+	uint size = pc->stats.size;
+	char *page, *obj;
+	void **link;
+
+	if (pool.next_page == pool.num_pages)
+		return -ENOMEM;
+	pool.page_class[pool.next_page] = pc - pool.cls;
+	page = (char *)(pool.base + ((ulong)pool.next_page << POOL_PAGE_SHIFT));
+	pool.next_page++;
+	pc->stats.pages++;
+
+	/* Link the objects in address order so they are handed out that way */
+	link = &pc->free;
+	for (obj = page; obj + size <= page + POOL_PAGE_SIZE; obj += size) {
+		*link = obj;
+		link = (void **)obj;
+	}
+	*link = NULL;
+
+	return 0;
+}
+
+static void *pool_take(struct pool_class *pc)
+{
+	void *obj;
+
+	if (!pc->free && pool_refill(pc)) {
+		pool.fallbacks++;
+		return NULL;
+	}
+	obj = pc->free;
+	pc->free = *(void **)obj;
+	pc->stats.allocs++;
+	if (++pc->stats.in_use > pc->stats.peak)
+		pc->stats.peak = pc->stats.in_use;
+	pool.in_use += pc->stats.size;
+
+	return obj;
+}
+
+static struct pool_class *pool_class_of(const void *ptr)
+{
+	uint idx = ((ulong)ptr - pool.base) >> POOL_PAGE_SHIFT;
+
+	return &pool.cls[pool.page_class[idx]];
+}
+
+void *malloc_pool_alloc(size_t bytes)
+{
+	if (!pool.enabled || bytes > MALLOC_POOL_MAX_SMALL)
+		return NULL;
+
+	return pool_take(&pool.cls[pool.small_class[(bytes + 15) / 16]]);
+}
+
+void *malloc_pool_memalign(size_t alignment, size_t bytes)
+{
+	ulong size;
+
+	if (!pool.enabled || bytes > POOL_PAGE_SIZE ||
+	    alignment > POOL_PAGE_SIZE)
+		return NULL;
+	size = roundup_pow_of_two(max3((ulong)bytes, (ulong)alignment,
+				       (ulong)POOL_DMA_MIN));
+
+	return pool_take(&pool.cls[pool.first_dma +
+				   ilog2(size / POOL_DMA_MIN)]);
+}
+
+bool malloc_pool_owns(const void *ptr)
+{
+	ulong end = pool.base + ((ulong)pool.next_page << POOL_PAGE_SHIFT);
+
+	return (ulong)ptr >= pool.base && (ulong)ptr < end;
+}
+
+bool malloc_pool_free(void *ptr)
+{
+	struct pool_class *pc;
+
+	if (!malloc_pool_owns(ptr))
+		return false;
+	pc = pool_class_of(ptr);
+	*(void **)ptr = pc->free;
+	pc->free = ptr;
+	pc->stats.in_use--;
+	pool.in_use -= pc->stats.size;
+
+	return true;
+}
+
+size_t malloc_pool_usable_size(const void *ptr)
+{
+	if (!malloc_pool_owns(ptr))
+		return 0;
+
+	return pool_class_of(ptr)->stats.size;
+}
+
+ulong malloc_pool_in_use(void)
+{
+	return pool.in_use;
+}
+
+bool malloc_pool_set_enabled(bool enable)
+{
+	bool old = pool.enabled;
+
+	pool.enabled = enable && pool.num_pages;
+
+	return old;
+}
+
+void malloc_pool_get_stats(struct malloc_pool_stats *stats)
+{
+	uint i;
+
+	stats->start = pool.start;
+	stats->size = pool.size;
+	stats->enabled = pool.enabled;
+	stats->page_size = POOL_PAGE_SIZE;
+	stats->num_pages = pool.num_pages;
+	stats->used_pages = pool.next_page;
+	stats->in_use = pool.in_use;
+	stats->fallbacks = pool.fallbacks;
+	stats->num_classes = pool.num_classes;
+	for (i = 0; i < pool.num_classes; i++)
+		stats->cls[i] = pool.cls[i].stats;
+}
+
+static void pool_add_class(uint size, bool dma)
+{
+	struct pool_class *pc = &pool.cls[pool.num_classes++];
+
+	pc->free = NULL;
+	memset(&pc->stats, '\0', sizeof(pc->stats));
+	pc->stats.size = size;
+	pc->stats.dma = dma;
+}
+
+void malloc_pool_init(ulong start, ulong size)
+{
+	ulong end = start + size;
+	uint i, cls;
+
+	memset(&pool, '\0', sizeof(pool));
+	pool.start = start;
+	pool.size = size;
+
+	/* The page-class table sits below the first page */
+	pool.num_pages = size >> POOL_PAGE_SHIFT;
+	while (pool.num_pages &&
+	       ALIGN(start + pool.num_pages, POOL_PAGE_SIZE) +
+	       ((ulong)pool.num_pages << POOL_PAGE_SHIFT) > end)
+		pool.num_pages--;
+	if (!pool.num_pages) {
+		log_warning("No space for malloc() pools\n");
+		return;
+	}
+	pool.page_class = (u8 *)start;
+	memset(pool.page_class, POOL_PAGE_FREE, pool.num_pages);
+	pool.base = ALIGN(start + pool.num_pages, POOL_PAGE_SIZE);
+
+	for (i = 0; i < ARRAY_SIZE(small_sizes); i++)
+		pool_add_class(small_sizes[i], false);
+	for (i = 0, cls = 0; i <= MALLOC_POOL_MAX_SMALL / 16; i++) {
+		while (small_sizes[cls] < i * 16)
+			cls++;
+		pool.small_class[i] = cls;
+	}
+
+	pool.first_dma = pool.num_classes;
+	for (i = POOL_DMA_MIN; i <= POOL_PAGE_SIZE; i <<= 1)
+		pool_add_class(i, true);
+
+	pool.enabled = true;
+	log_debug("pools at %lx, %u pages of %lu bytes\n", pool.base,
+		  pool.num_pages, POOL_PAGE_SIZE);
+}
@@ -0,0 +1,156 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Cooperative scheduler for background tasks
+ *
+ * U-Boot runs a single thread and spends much of its time waiting: in
+ * udelay(), polling a register or waiting for a key press. Long operations
+ * such as PHY auto-negotiation can be written as a task, a state machine
+ * which is stepped from those waits, so that they carry on while U-Boot
+ * does something else. Tasks never pre-empt each other: each step runs to
+ * completion, and a step which waits itself does not run other tasks.
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#include <common.h>
+#include <log.h>
+#include <sched.h>
+#include <time.h>
+#include <asm/global_data.h>
+#include <linux/errno.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/*
+ * true while a task is being stepped, so that waits within the task do not
+ * step other tasks. This is in the data section as it is used before
+ * relocation when CONFIG_SCHED is not enabled.
+ */
+static bool sched_busy __section(".data");
+
+#if CONFIG_IS_ENABLED(SCHED)
+/* Running tasks, in the order they were started */
+static LIST_HEAD(sched_head);
+
+/* Number of calls to sched_yield(), to tell which tasks it has looked at */
+static uint sched_round;
+#endif
+
+void sched_task_init(struct sched_task *task, const char *name,
+		     sched_func_t func, void *ctx, ulong period_us)
+{
+	memset(task, '\0', sizeof(*task));
+	INIT_LIST_HEAD(&task->node);
+	task->name = name;
+	task->func = func;
+	task->ctx = ctx;
+	task->period_us = period_us;
+}
+
+/* Removes a task which is no longer running from the list */
+static void sched_finish(struct sched_task *task, int ret)
+{
+	task->ret = ret;
+	task->running = false;
+	list_del_init(&task->node);
+}
+
+/* Takes the next step of a task */
+static void sched_step(struct sched_task *task)
+{
+	bool busy = sched_busy;
+	int ret;
+
+	sched_busy = true;
+	task->calls++;
+	ret = task->func(task);
+	task->next_us = timer_get_us() + task->period_us;
+	sched_busy = busy;
+
+	/* The task may have been cancelled while it was running */
+	if (ret == SCHED_AGAIN || !task->running)
+		return;
+	if (ret)
+		log_debug("Task '%s' failed (err=%d)\n", task->name, ret);
+	sched_finish(task, ret);
+}
+
+int sched_start(struct sched_task *task)
+{
+	if (task->running)
+		return -EBUSY;
+#if CONFIG_IS_ENABLED(SCHED)
+	if (!(gd->flags & GD_FLG_RELOC))
+		return -EPERM;
+	list_add_tail(&task->node, &sched_head);
+	task->round = sched_round;
+#endif
+	task->running = true;
+	task->ret = 0;
+	sched_step(task);
+
+	return 0;
+}
+
+int sched_wait(struct sched_task *task, ulong timeout_ms)
+{
+	ulong start = get_timer(0);
+
+	while (task->running) {
+		if (get_timer(start) >= timeout_ms)
+			return -ETIMEDOUT;
+
+		/* Within a task, only this one can be stepped */
+		if (CONFIG_IS_ENABLED(SCHED) && !sched_busy)
+			sched_yield();
+		else if (timer_get_us() >= task->next_us)
+			sched_step(task);
+	}
+
+	return task->ret;
+}
+
+void sched_cancel(struct sched_task *task)
+{
+	if (task->running)
+		sched_finish(task, -ECANCELED);
+}
+
+#if CONFIG_IS_ENABLED(SCHED)
+void sched_yield(void)
+{
+	struct sched_task *task;
+	u64 now;
+
+	if (!(gd->flags & GD_FLG_RELOC) || sched_busy ||
+	    list_empty(&sched_head))
+		return;
+
+	/*
+	 * A step may start, finish or cancel tasks, so go back to the start of
+	 * the list after each one, skipping those already looked at
+	 */
+	sched_round++;
+	now = timer_get_us();
+restart:
+	list_for_each_entry(task, &sched_head, node) {
+		if (task->round == sched_round)
+			continue;
+		task->round = sched_round;
+		if (now < task->next_us)
+			continue;
+		sched_step(task);
+		goto restart;
+	}
+}
+
+void sched_cancel_all(void)
+{
+	struct sched_task *task, *next;
+
+	list_for_each_entry_safe(task, next, &sched_head, node) {
+		log_debug("Cancelling task '%s'\n", task->name);
+		sched_cancel(task);
+	}
+}
+#endif
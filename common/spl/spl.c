@@ -17,6 +17,7 @@
 #include <irq_func.h>
 #include <log.h>
 #include <mapmem.h>
+#include <mmc.h>
 #include <serial.h>
 #include <spl.h>
 #include <system-constants.h>
@@ -116,6 +117,56 @@ int __weak bootz_setup(ulong image, ulong *start, ulong *end)
 {
 	 return 1;
 }
+
+void *spl_os_fdt(struct spl_image_info *spl_image)
+{
+#ifdef CONFIG_SYS_SPL_ARGS_ADDR
+	void *args = map_sysmem(CONFIG_SYS_SPL_ARGS_ADDR, 0);
+
+	if (!fdt_check_header(args))
+		return args;
+#endif
+
+	return spl_image->fdt_addr;
+}
+
+#ifdef CONFIG_SYS_SPL_ARGS_ADDR
+int spl_load_os_args(struct spl_load_info *load, ulong sector, ulong max_size)
+{
+	void *args = map_sysmem(CONFIG_SYS_SPL_ARGS_ADDR, 0);
+	ulong count;
+	int ret;
+
+#ifdef CONFIG_SPL_LOAD_FIT_ADDRESS
+	/* The FIT is loaded next, so the devicetree must end before it */
+	if (CONFIG_SPL_LOAD_FIT_ADDRESS > CONFIG_SYS_SPL_ARGS_ADDR)
+		max_size = min_t(ulong, max_size, CONFIG_SPL_LOAD_FIT_ADDRESS -
+				 CONFIG_SYS_SPL_ARGS_ADDR);
+#endif
+	ret = -EIO;
+	if (load->bl_len > max_size || load->read(load, sector, 1, args) != 1)
+		goto err;
+	ret = -ENOENT;
+	if (fdt_check_header(args))
+		goto err;
+
+	/* The size comes from the medium, so check it before using it */
+	count = DIV_ROUND_UP(fdt_totalsize(args), load->bl_len);
+	ret = -E2BIG;
+	if (count > max_size / load->bl_len)
+		goto err;
+	ret = -EIO;
+	if (load->read(load, sector, count, args) != count)
+		goto err;
+
+	return 0;
+
+err:
+	memset(args, '\0', sizeof(struct fdt_header));
+
+	return ret;
+}
+#endif
 #endif
 
 /* Weak default function for arch/board-specific fixups to the spl_image_info */
@@ -823,6 +874,12 @@ void board_init_r(gd_t *dummy1, ulong dummy2)
 	}
 
 	spl_perform_fixups(&spl_image);
+	if (CONFIG_IS_ENABLED(MMC_HANDOFF)) {
+		ret = mmc_handoff_save();
+		if (ret)
+			pr_debug("%s: Failed to hand off MMC cards: ret=%d\n",
+				 __func__, ret);
+	}
 	if (CONFIG_IS_ENABLED(HANDOFF)) {
 		ret = write_spl_handoff();
 		if (ret){
@@ -866,7 +923,7 @@ void board_init_r(gd_t *dummy1, ulong dummy2)
 	case IH_OS_LINUX:
 		pr_debug("Jumping to Linux\n");
 #if defined(CONFIG_SYS_SPL_ARGS_ADDR)
-		spl_fixup_fdt((void *)CONFIG_SYS_SPL_ARGS_ADDR);
+		spl_fixup_fdt(map_sysmem(CONFIG_SYS_SPL_ARGS_ADDR, 0));
 #endif
 		spl_board_prepare_for_linux();
 		jump_to_image_linux(&spl_image);
@@ -26,15 +26,38 @@ DECLARE_GLOBAL_DATA_PTR;
 #define CONFIG_SPL_LOAD_FIT_APPLY_OVERLAY_BUF_SZ (64 * 1024)
 #endif
 
+#ifndef CONFIG_SPL_LOAD_FIT_BATCH_GAP
+#define CONFIG_SPL_LOAD_FIT_BATCH_GAP 0
+#endif
+
 #ifndef CONFIG_SYS_BOOTM_LEN
 #define CONFIG_SYS_BOOTM_LEN	(64 << 20)
 #endif
 
+/* Maximum number of images which spl_fit_batch_read() reads ahead */
+#define SPL_FIT_MAX_EXTENTS	8
+
+/**
+ * struct spl_fit_run - a run of image data read in one go
+ *
+ * @start:	FIT byte offset of the data at @buf
+ * @size:	Number of bytes valid at @buf
+ * @buf:	Where the data was read to
+ */
+struct spl_fit_run {
+	ulong start;
+	ulong size;
+	void *buf;
+};
+
 struct spl_fit_info {
 	const void *fit;	/* Pointer to a valid FIT blob */
 	size_t ext_data_offset;	/* Offset to FIT external data (end of FIT) */
 	int images_node;	/* FDT offset to "/images" node */
 	int conf_node;		/* FDT offset to selected configuration node */
+	void *batch_buf;	/* Buffer holding all runs, or NULL */
+	int num_runs;		/* Number of runs read by spl_fit_batch_read() */
+	struct spl_fit_run runs[SPL_FIT_MAX_EXTENTS];
 };
 
 __weak void board_spl_fit_post_load(const void *fit)
@@ -220,6 +243,176 @@ static int get_aligned_image_size(struct spl_load_info *info, int data_size,
 	return (data_size + info->bl_len - 1) / info->bl_len;
 }
 
+/**
+ * spl_fit_get_extent() - Find where an image's external data is in the FIT
+ *
+ * @ctx:	FIT context
+ * @node:	Image node
+ * @offsetp:	Returns the byte offset of the data from the start of the FIT
+ * @lenp:	Returns the size of the data in bytes
+ * Return: 0 if OK, -ENOENT if the image has no external data
+ */
+static int spl_fit_get_extent(const struct spl_fit_info *ctx, int node,
+			      int *offsetp, int *lenp)
+{
+	if (fit_image_get_data_position(ctx->fit, node, offsetp)) {
+		if (fit_image_get_data_offset(ctx->fit, node, offsetp))
+			return -ENOENT;
+		*offsetp += ctx->ext_data_offset;
+	}
+	if (fit_image_get_data_size(ctx->fit, node, lenp))
+		return -ENOENT;
+
+	return 0;
+}
+
+/**
+ * spl_fit_batch_add() - Add the images listed in a configuration property
+ *
+ * Images without external data, or already in the list, are skipped.
+ *
+ * @ctx:	FIT context
+ * @prop:	Property in the configuration node, e.g. "loadables"
+ * @ext:	List of extents to add to, sorted by offset
+ * @countp:	Number of entries in @ext, updated on exit
+ */
+static void spl_fit_batch_add(const struct spl_fit_info *ctx, const char *prop,
+			      struct spl_fit_run *ext, int *countp)
+{
+	int index, node, offset, len, i;
+
+	for (index = 0; *countp < SPL_FIT_MAX_EXTENTS; index++) {
+		node = spl_fit_get_image_node(ctx, prop, index);
+		if (node == -E2BIG || node == -EINVAL)
+			break;
+		if (node < 0 || spl_fit_get_extent(ctx, node, &offset, &len) ||
+		    !len)
+			continue;
+
+		/* The firmware is often listed in "loadables" as well */
+		for (i = 0; i < *countp && ext[i].start != offset; i++)
+			;
+		if (i < *countp)
+			continue;
+
+		/* Insert in order of offset */
+		for (i = *countp; i > 0 && ext[i - 1].start > offset; i--)
+			ext[i] = ext[i - 1];
+		ext[i].start = offset;
+		ext[i].size = len;
+		(*countp)++;
+	}
+}
+
+/**
+ * spl_fit_batch_read() - Read all images for the configuration up front
+ *
+ * This finds the external data of every image the configuration refers to,
+ * sorts it by position and merges images which are (nearly) adjacent into
+ * runs. Each run is then read with a single call to @info->read() into one
+ * staging buffer, so a FIT with U-Boot, OpenSBI and a devicetree stored one
+ * after the other is read with a single large transfer rather than three
+ * smaller ones, each rounded out to whole blocks.
+ *
+ * spl_load_fit_image() then verifies and copies each image from the staging
+ * buffer. If the buffer cannot be allocated, nothing is read here and each
+ * image is read separately as before.
+ *
+ * @ctx:	FIT context, updated with the runs that were read
+ * @info:	Device to read from
+ * @sector:	Start sector of the FIT on the device
+ * Return: 0 if OK (including if nothing was read), -EIO on read error
+ */
+static int spl_fit_batch_read(struct spl_fit_info *ctx,
+			      struct spl_load_info *info, ulong sector)
+{
+	struct spl_fit_run ext[SPL_FIT_MAX_EXTENTS];
+	int unit = info->filename ? 1 : info->bl_len;
+	int count = 0, i, nr_sectors;
+	ulong total = 0;
+	char *buf;
+
+	ctx->num_runs = 0;
+	spl_fit_batch_add(ctx, FIT_FIRMWARE_PROP, ext, &count);
+	if (IS_ENABLED(CONFIG_SPL_OS_BOOT))
+		spl_fit_batch_add(ctx, FIT_KERNEL_PROP, ext, &count);
+	spl_fit_batch_add(ctx, FIT_FDT_PROP, ext, &count);
+	spl_fit_batch_add(ctx, "loadables", ext, &count);
+	if (count < 2)
+		return 0;
+
+	/* Merge images separated by no more than the allowed gap */
+	ctx->runs[0] = ext[0];
+	ctx->num_runs = 1;
+	for (i = 1; i < count; i++) {
+		struct spl_fit_run *run = &ctx->runs[ctx->num_runs - 1];
+		ulong end = ext[i].start + ext[i].size;
+
+		if (ext[i].start <= run->start + run->size +
+		    CONFIG_SPL_LOAD_FIT_BATCH_GAP)
+			run->size = max(run->size, end - run->start);
+		else
+			ctx->runs[ctx->num_runs++] = ext[i];
+	}
+
+	for (i = 0; i < ctx->num_runs; i++)
+		total += get_aligned_image_size(info, ctx->runs[i].size,
+						ctx->runs[i].start) * unit;
+	buf = memalign(ARCH_DMA_MINALIGN, total);
+	if (!buf) {
+		pr_debug("No space to read %d images together\n", count);
+		ctx->num_runs = 0;
+		return 0;
+	}
+	ctx->batch_buf = buf;
+
+	for (i = 0; i < ctx->num_runs; i++) {
+		struct spl_fit_run *run = &ctx->runs[i];
+
+		nr_sectors = get_aligned_image_size(info, run->size,
+						    run->start);
+		if (info->read(info,
+			       sector + get_aligned_image_offset(info,
+								 run->start),
+			       nr_sectors, buf) != nr_sectors) {
+			ctx->num_runs = 0;
+			return -EIO;
+		}
+		pr_debug("FIT run %d: offset=%lx, size=%lx, dst=%p\n", i,
+			 run->start, run->size, buf);
+		run->buf = buf + get_aligned_image_overhead(info, run->start);
+		buf += nr_sectors * unit;
+	}
+	pr_debug("Read %d images in %d runs\n", count, ctx->num_runs);
+
+	return 0;
+}
+
+/**
+ * spl_fit_batch_find() - Find an image's data in the runs already read
+ *
+ * @ctx:	FIT context
+ * @offset:	Byte offset of the data from the start of the FIT
+ * @len:	Size of the data in bytes
+ * Return: pointer to the data, or NULL if it was not read by
+ *	spl_fit_batch_read()
+ */
+static void *spl_fit_batch_find(const struct spl_fit_info *ctx, ulong offset,
+				ulong len)
+{
+	const struct spl_fit_run *run;
+	int i;
+
+	for (i = 0; i < ctx->num_runs; i++) {
+		run = &ctx->runs[i];
+		if (offset >= run->start &&
+		    offset + len <= run->start + run->size)
+			return run->buf + (offset - run->start);
+	}
+
+	return NULL;
+}
+
 /**
  * spl_load_fit_image(): load the image described in a certain FIT node
  * @info:	points to information about the device to load data from
@@ -296,9 +489,14 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 				    __func__, fit_get_name(fit, node, NULL));
 			return 0;
 		}
+		length = len;
+
+		/* Use the copy from spl_fit_batch_read() if there is one */
+		src = spl_fit_batch_find(ctx, offset, length);
+		if (src)
+			goto verify;
 
 		src_ptr = map_sysmem(ALIGN(load_addr, ARCH_DMA_MINALIGN), len);
-		length = len;
 
 		overhead = get_aligned_image_overhead(info, offset);
 		nr_sectors = get_aligned_image_size(info, length, offset);
@@ -322,6 +520,7 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 		src = (void *)data;	/* cast away const */
 	}
 
+verify:
 	if (CONFIG_IS_ENABLED(FIT_SIGNATURE)) {
 		printf("## Checking hash(es) for Image %s ... ",
 		       fit_get_name(fit, node, NULL));
@@ -659,6 +858,8 @@ static int spl_simple_fit_read(struct spl_fit_info *ctx,
 	size = ALIGN(fdt_totalsize(fit_header), 4);
 	size = board_spl_fit_size_align(size);
 	ctx->ext_data_offset = ALIGN(size, 4);
+	ctx->batch_buf = NULL;
+	ctx->num_runs = 0;
 
 	/*
 	 * So far we only have one block of data from the FIT. Read the entire
@@ -704,32 +905,27 @@ static int spl_simple_fit_parse(struct spl_fit_info *ctx)
 	return 0;
 }
 
-int spl_load_simple_fit(struct spl_image_info *spl_image,
-			struct spl_load_info *info, ulong sector, void *fit)
+/**
+ * spl_fit_load_images() - Load the images for the selected configuration
+ *
+ * @spl_image:	Image description to set up
+ * @info:	Device to read from
+ * @sector:	Start sector of the FIT on the device
+ * @ctx:	FIT context
+ * Return: 0 if OK, -ve on error
+ */
+static int spl_fit_load_images(struct spl_image_info *spl_image,
+			       struct spl_load_info *info, ulong sector,
+			       struct spl_fit_info *ctx)
 {
 	struct spl_image_info image_info;
-	struct spl_fit_info ctx;
 	int node = -1;
 	int ret;
 	int index = 0;
 	int firmware_node;
 
-	ret = spl_simple_fit_read(&ctx, info, sector, fit);
-	if (ret < 0)
-		return ret;
-
-	/* skip further processing if requested to enable load-only use cases */
-	if (spl_load_simple_fit_skip_processing())
-		return 0;
-
-	ctx.fit = spl_load_simple_fit_fix_load(ctx.fit);
-
-	ret = spl_simple_fit_parse(&ctx);
-	if (ret < 0)
-		return ret;
-
 	if (IS_ENABLED(CONFIG_SPL_FPGA))
-		spl_fit_load_fpga(&ctx, info, sector);
+		spl_fit_load_fpga(ctx, info, sector);
 
 	/*
 	 * Find the U-Boot image using the following search order:
@@ -738,14 +934,14 @@ int spl_load_simple_fit(struct spl_image_info *spl_image,
 	 *   - fall back to using the first 'loadables' entry
 	 */
 	if (node < 0)
-		node = spl_fit_get_image_node(&ctx, FIT_FIRMWARE_PROP, 0);
+		node = spl_fit_get_image_node(ctx, FIT_FIRMWARE_PROP, 0);
 
 	if (node < 0 && IS_ENABLED(CONFIG_SPL_OS_BOOT))
-		node = spl_fit_get_image_node(&ctx, FIT_KERNEL_PROP, 0);
+		node = spl_fit_get_image_node(ctx, FIT_KERNEL_PROP, 0);
 
 	if (node < 0) {
 		pr_debug("could not find firmware image, trying loadables...\n");
-		node = spl_fit_get_image_node(&ctx, "loadables", 0);
+		node = spl_fit_get_image_node(ctx, "loadables", 0);
 		/*
 		 * If we pick the U-Boot image from "loadables", start at
 		 * the second image when later loading additional images.
@@ -759,7 +955,7 @@ int spl_load_simple_fit(struct spl_image_info *spl_image,
 	}
 
 	/* Load the image and set up the spl_image structure */
-	ret = spl_load_fit_image(info, sector, &ctx, node, spl_image);
+	ret = spl_load_fit_image(info, sector, ctx, node, spl_image);
 	if (ret)
 		return ret;
 
@@ -767,7 +963,7 @@ int spl_load_simple_fit(struct spl_image_info *spl_image,
 	 * For backward compatibility, we treat the first node that is
 	 * as a U-Boot image, if no OS-type has been declared.
 	 */
-	if (!spl_fit_image_get_os(ctx.fit, node, &spl_image->os))
+	if (!spl_fit_image_get_os(ctx->fit, node, &spl_image->os))
 		pr_debug("Image OS is %s\n", genimg_get_os_name(spl_image->os));
 	else if (!IS_ENABLED(CONFIG_SPL_OS_BOOT))
 		spl_image->os = IH_OS_U_BOOT;
@@ -777,7 +973,7 @@ int spl_load_simple_fit(struct spl_image_info *spl_image,
 	 * We allow this to fail, as the U-Boot image might embed its FDT.
 	 */
 	if (os_takes_devicetree(spl_image->os)) {
-		ret = spl_fit_append_fdt(spl_image, info, sector, &ctx);
+		ret = spl_fit_append_fdt(spl_image, info, sector, ctx);
 		if (ret < 0 && spl_image->os != IH_OS_U_BOOT)
 			return ret;
 	}
@@ -787,7 +983,7 @@ int spl_load_simple_fit(struct spl_image_info *spl_image,
 	for (; ; index++) {
 		uint8_t os_type = IH_OS_INVALID;
 
-		node = spl_fit_get_image_node(&ctx, "loadables", index);
+		node = spl_fit_get_image_node(ctx, "loadables", index);
 		if (node < 0)
 			break;
 
@@ -800,21 +996,21 @@ int spl_load_simple_fit(struct spl_image_info *spl_image,
 			continue;
 
 		image_info.load_addr = 0;
-		ret = spl_load_fit_image(info, sector, &ctx, node, &image_info);
+		ret = spl_load_fit_image(info, sector, ctx, node, &image_info);
 		if (ret < 0) {
 			pr_debug("%s: can't load image loadables index %d (ret = %d)\n",
 			       __func__, index, ret);
 			return ret;
 		}
 
-		if (spl_fit_image_is_fpga(ctx.fit, node))
-			spl_fit_upload_fpga(&ctx, node, &image_info);
+		if (spl_fit_image_is_fpga(ctx->fit, node))
+			spl_fit_upload_fpga(ctx, node, &image_info);
 
-		if (!spl_fit_image_get_os(ctx.fit, node, &os_type))
+		if (!spl_fit_image_get_os(ctx->fit, node, &os_type))
 			pr_debug("Loadable is %s\n", genimg_get_os_name(os_type));
 
 		if (os_takes_devicetree(os_type)) {
-			spl_fit_append_fdt(&image_info, info, sector, &ctx);
+			spl_fit_append_fdt(&image_info, info, sector, ctx);
 			spl_image->fdt_addr = image_info.fdt_addr;
 		}
 
@@ -828,7 +1024,7 @@ int spl_load_simple_fit(struct spl_image_info *spl_image,
 
 		/* Record our loadables into the FDT */
 		if (spl_image->fdt_addr)
-			spl_fit_record_loadable(&ctx, index,
+			spl_fit_record_loadable(ctx, index,
 						spl_image->fdt_addr,
 						&image_info);
 	}
@@ -844,7 +1040,36 @@ int spl_load_simple_fit(struct spl_image_info *spl_image,
 	spl_image->flags |= SPL_FIT_FOUND;
 
 	if (IS_ENABLED(CONFIG_IMX_HAB))
-		board_spl_fit_post_load(ctx.fit);
+		board_spl_fit_post_load(ctx->fit);
 
 	return 0;
 }
+
+int spl_load_simple_fit(struct spl_image_info *spl_image,
+			struct spl_load_info *info, ulong sector, void *fit)
+{
+	struct spl_fit_info ctx;
+	int ret;
+
+	ret = spl_simple_fit_read(&ctx, info, sector, fit);
+	if (ret < 0)
+		return ret;
+
+	/* skip further processing if requested to enable load-only use cases */
+	if (spl_load_simple_fit_skip_processing())
+		return 0;
+
+	ctx.fit = spl_load_simple_fit_fix_load(ctx.fit);
+
+	ret = spl_simple_fit_parse(&ctx);
+	if (ret < 0)
+		return ret;
+
+	if (IS_ENABLED(CONFIG_SPL_LOAD_FIT_BATCH))
+		ret = spl_fit_batch_read(&ctx, info, sector);
+	if (!ret)
+		ret = spl_fit_load_images(spl_image, info, sector, &ctx);
+	free(ctx.batch_buf);
+
+	return ret;
+}
@@ -8,6 +8,7 @@
 #include <common.h>
 #include <dm.h>
 #include <log.h>
+#include <mapmem.h>
 #include <part.h>
 #include <spl.h>
 #include <linux/compiler.h>
@@ -16,6 +17,7 @@
 #include <errno.h>
 #include <mmc.h>
 #include <image.h>
+#include <linux/libfdt.h>
 
 static int mmc_load_legacy(struct spl_image_info *spl_image,
 			   struct spl_boot_device *bootdev,
@@ -251,12 +253,64 @@ static int mmc_load_image_raw_partition(struct spl_image_info *spl_image,
 #endif
 
 #if CONFIG_IS_ENABLED(FALCON_BOOT_MMCSD)
+#ifdef CONFIG_SYS_MMCSD_RAW_MODE_KERNEL_PARTITION_NAME
+/**
+ * mmc_falcon_partition() - Find a Falcon-mode partition
+ *
+ * @mmc:	MMC device
+ * @name:	Partition name, or "" if none is configured
+ * @info:	Returns information about the partition
+ * Return: 0 if OK, -ENOENT if there is no such partition
+ */
+static int mmc_falcon_partition(struct mmc *mmc, const char *name,
+				struct disk_partition *info)
+{
+	if (!*name ||
+	    part_get_info_by_name(mmc_get_blk_desc(mmc), name, info) < 0)
+		return -ENOENT;
+
+	return 0;
+}
+
+/*
+ * Load the devicetree prepared by 'spl prepare'. If there is none, the
+ * devicetree from the FIT is used.
+ */
+static int mmc_load_falcon_args(struct mmc *mmc)
+{
+	struct spl_load_info load;
+	struct disk_partition info;
+
+	if (mmc_falcon_partition(mmc,
+				 CONFIG_SYS_MMCSD_RAW_MODE_ARGS_PARTITION_NAME,
+				 &info)) {
+		memset(map_sysmem(CONFIG_SYS_SPL_ARGS_ADDR, 0), '\0',
+		       sizeof(struct fdt_header));
+		return -ENOENT;
+	}
+	load.dev = mmc;
+	load.priv = NULL;
+	load.filename = NULL;
+	load.bl_len = mmc->read_bl_len;
+	load.read = h_spl_load_read;
+
+	return spl_load_os_args(&load, info.start, info.size * info.blksz);
+}
+#endif
+
 static int mmc_load_image_raw_os(struct spl_image_info *spl_image,
 				 struct spl_boot_device *bootdev,
 				 struct mmc *mmc)
 {
+	unsigned long sector;
 	int ret;
 
+#ifdef CONFIG_SYS_MMCSD_RAW_MODE_KERNEL_PARTITION_NAME
+	ret = mmc_load_falcon_args(mmc);
+	if (ret)
+		debug("spl: no prepared devicetree (err=%d)\n", ret);
+#endif
+
 #if CONFIG_VAL(SYS_MMCSD_RAW_MODE_ARGS_SECTOR)
 	unsigned long count;
 
@@ -272,12 +326,22 @@ static int mmc_load_image_raw_os(struct spl_image_info *spl_image,
 	}
 #endif	/* CONFIG_SYS_MMCSD_RAW_MODE_ARGS_SECTOR */
 
-	ret = mmc_load_image_raw_sector(spl_image, bootdev, mmc,
-		CONFIG_SYS_MMCSD_RAW_MODE_KERNEL_SECTOR);
+	sector = CONFIG_SYS_MMCSD_RAW_MODE_KERNEL_SECTOR;
+#ifdef CONFIG_SYS_MMCSD_RAW_MODE_KERNEL_PARTITION_NAME
+	struct disk_partition info;
+
+	if (!mmc_falcon_partition(mmc,
+				  CONFIG_SYS_MMCSD_RAW_MODE_KERNEL_PARTITION_NAME,
+				  &info))
+		sector = info.start;
+#endif
+	ret = mmc_load_image_raw_sector(spl_image, bootdev, mmc, sector);
 	if (ret)
 		return ret;
 
-	if (spl_image->os != IH_OS_LINUX && spl_image->os != IH_OS_TEE) {
+	/* A FIT may start Linux through OpenSBI */
+	if (spl_image->os != IH_OS_LINUX && spl_image->os != IH_OS_TEE &&
+	    !(CONFIG_IS_ENABLED(OPENSBI) && spl_image->os == IH_OS_OPENSBI)) {
 		puts("Expected image is not found. Trying to start U-boot\n");
 		return -ENOENT;
 	}
@@ -20,7 +20,7 @@ DECLARE_GLOBAL_DATA_PTR;
 
 struct fw_dynamic_info opensbi_info;
 
-static int spl_opensbi_find_uboot_node(void *blob, int *uboot_node)
+static int spl_opensbi_find_os_node(void *blob, int *os_node, u8 os)
 {
 	int fit_images_node, node;
 	const char *fit_os;
@@ -34,8 +34,8 @@ static int spl_opensbi_find_uboot_node(void *blob, int *uboot_node)
 		if (!fit_os)
 			continue;
 
-		if (genimg_get_os_id(fit_os) == IH_OS_U_BOOT) {
-			*uboot_node = node;
+		if (genimg_get_os_id(fit_os) == os) {
+			*os_node = node;
 			return 0;
 		}
 	}
@@ -45,8 +45,10 @@ static int spl_opensbi_find_uboot_node(void *blob, int *uboot_node)
 
 void spl_invoke_opensbi(struct spl_image_info *spl_image)
 {
-	int ret, uboot_node;
-	ulong uboot_entry;
+	int ret, os_node;
+	ulong next_entry;
+	__maybe_unused u8 next_os = IH_OS_U_BOOT;
+	void *fdt = spl_image->fdt_addr;
 	void (*opensbi_entry)(ulong hartid, ulong dtb, ulong info);
 
 	if (!spl_image->fdt_addr) {
@@ -54,8 +56,23 @@ void spl_invoke_opensbi(struct spl_image_info *spl_image)
 		hang();
 	}
 
-	/* Find U-Boot image in /fit-images */
-	ret = spl_opensbi_find_uboot_node(spl_image->fdt_addr, &uboot_node);
+	/*
+	 * Find U-Boot image in /fit-images, or in Falcon mode, a Linux image
+	 * which is started with the devicetree prepared for it
+	 */
+	ret = spl_opensbi_find_os_node(spl_image->fdt_addr, &os_node,
+				       IH_OS_U_BOOT);
+#if CONFIG_IS_ENABLED(OS_BOOT)
+	if (ret) {
+		ret = spl_opensbi_find_os_node(spl_image->fdt_addr, &os_node,
+					       IH_OS_LINUX);
+		if (!ret) {
+			debug("Falcon mode: next stage is Linux\n");
+			next_os = IH_OS_LINUX;
+			fdt = spl_os_fdt(spl_image);
+		}
+	}
+#endif
 	if (ret) {
 		debug("Can't find U-Boot node, %d\n", ret);
 #ifdef CONFIG_SYS_LOAD_IMAGE_SEC_PARTITION
@@ -65,19 +82,20 @@ void spl_invoke_opensbi(struct spl_image_info *spl_image)
 #endif
 	}
 
-	/* Get U-Boot entry point */
-	ret = fit_image_get_entry(spl_image->fdt_addr, uboot_node, &uboot_entry);
+	/* Get next-stage entry point */
+	ret = fit_image_get_entry(spl_image->fdt_addr, os_node, &next_entry);
 	if (ret)
-		ret = fit_image_get_load(spl_image->fdt_addr, uboot_node, &uboot_entry);
+		ret = fit_image_get_load(spl_image->fdt_addr, os_node, &next_entry);
 
 #ifdef CONFIG_SYS_LOAD_IMAGE_SEC_PARTITION
 	/*if load other image, uboot_entry maybe not true, set to TEXT_BASE directory*/
-	uboot_entry = CONFIG_SYS_TEXT_BASE;
+	if (next_os == IH_OS_U_BOOT)
+		next_entry = CONFIG_SYS_TEXT_BASE;
 #endif
 	/* Prepare opensbi_info object */
 	opensbi_info.magic = FW_DYNAMIC_INFO_MAGIC_VALUE;
 	opensbi_info.version = FW_DYNAMIC_INFO_VERSION;
-	opensbi_info.next_addr = uboot_entry;
+	opensbi_info.next_addr = next_entry;
 	opensbi_info.next_mode = FW_DYNAMIC_INFO_NEXT_MODE_S;
 	opensbi_info.options = CONFIG_SPL_OPENSBI_SCRATCH_OPTIONS;
 	opensbi_info.boot_hart = gd->arch.boot_hart;
@@ -96,12 +114,10 @@ void spl_invoke_opensbi(struct spl_image_info *spl_image)
 	 * Otherwise, code corruption can occur if the link address ranges of
 	 * U-Boot SPL and OpenSBI overlap.
 	 */
-	ret = smp_call_function((ulong)spl_image->entry_point,
-				(ulong)spl_image->fdt_addr,
+	ret = smp_call_function((ulong)spl_image->entry_point, (ulong)fdt,
 				(ulong)&opensbi_info, 1);
 	if (ret)
 		hang();
 #endif
-	opensbi_entry(gd->arch.boot_hart, (ulong)spl_image->fdt_addr,
-		      (ulong)&opensbi_info);
+	opensbi_entry(gd->arch.boot_hart, (ulong)fdt, (ulong)&opensbi_info);
 }
@@ -5,4 +5,11 @@
  * Licensed under the GPL-2 or later.
  */
 
-const char const system_map[] = SYSTEM_MAP;
+/*
+ * SYSTEM_MAP names a generated file with one string per text symbol, each
+ * holding the address in hex, a space and the name. It is included rather
+ * than passed on the command line, which limits a single argument to 128KB.
+ */
+const char system_map[] =
+#include SYSTEM_MAP
+;
@@ -290,6 +290,47 @@ int usb_bulk_msg(struct usb_device *dev, unsigned int pipe,
 		return -EIO;
 }
 
+/*-------------------------------------------------------------------
+ * submits several bulk messages together and waits for all of them.
+ * Falls back to sending them one at a time if the controller cannot
+ * queue them.
+ */
+int usb_bulk_msgs(struct usb_device *dev, struct usb_bulk_req *reqs, int count,
+		  int timeout)
+{
+	int i, ret;
+
+	for (i = 0; i < count; i++) {
+		if (reqs[i].length < 0)
+			return -EINVAL;
+		reqs[i].act_len = 0;
+		reqs[i].status = USB_ST_NOT_PROC;
+	}
+
+#if CONFIG_IS_ENABLED(DM_USB)
+	ret = submit_bulk_msgs(dev, reqs, count);
+	if (!ret) {
+		for (i = 0; i < count; i++) {
+			if (reqs[i].status)
+				return -EIO;
+		}
+		return 0;
+	}
+	if (ret != -ENOSYS && ret != -ENOSPC)
+		return ret;
+#endif
+
+	for (i = 0; i < count; i++) {
+		ret = usb_bulk_msg(dev, reqs[i].pipe, reqs[i].buffer,
+				   reqs[i].length, &reqs[i].act_len, timeout);
+		reqs[i].status = dev->status;
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
 
 /*-------------------------------------------------------------------
  * Max Packet stuff
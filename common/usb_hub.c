@@ -22,6 +22,7 @@
  */
 
 #include <common.h>
+#include <bootstage.h>
 #include <command.h>
 #include <dm.h>
 #include <env.h>
@@ -29,6 +30,7 @@
 #include <log.h>
 #include <malloc.h>
 #include <memalign.h>
+#include <time.h>
 #include <asm/processor.h>
 #include <asm/unaligned.h>
 #include <linux/ctype.h>
@@ -49,17 +51,49 @@
 
 #define HUB_DEBOUNCE_TIMEOUT	1000
 
+/* Time between checks of a port which is waiting for a device, in ms */
+#define HUB_POLL_TIME		10
+
 #define PORT_OVERCURRENT_MAX_SCAN_COUNT		3
 
+/* Most hubs given a bootstage record when they are first scanned */
+#define HUB_BOOTSTAGE_MAX	8
+
+/**
+ * enum usb_port_scan_state - what a port on the scanning list is waiting for
+ *
+ * @USB_PORT_SCAN_POWER:	Power to become good after the hub powered it
+ * @USB_PORT_SCAN_CONNECT:	A device to connect
+ * @USB_PORT_SCAN_RESET:	The port reset to finish
+ */
+enum usb_port_scan_state {
+	USB_PORT_SCAN_POWER,
+	USB_PORT_SCAN_CONNECT,
+	USB_PORT_SCAN_RESET,
+};
+
 struct usb_device_scan {
 	struct usb_device *dev;		/* USB hub device to scan */
 	struct usb_hub_device *hub;	/* USB hub struct */
 	int port;			/* USB port to scan */
+	enum usb_port_scan_state state;	/* What the port is waiting for */
+	ulong next;			/* Time to look at the port again (ms) */
+	int tries;			/* Number of resets issued */
+	unsigned short portstatus;	/* Status when a device was seen */
+	unsigned short portchange;	/* Changes when a device was seen */
 	struct list_head list;
 };
 
+/*
+ * Ports of all hubs being scanned, which are looked at in turn as each one
+ * becomes due. This lets power-on, connection and reset delays of different
+ * ports, hubs and controllers overlap.
+ */
 static LIST_HEAD(usb_scan_list);
 
+/* true to queue hub ports without scanning them yet */
+static bool usb_scan_deferred;
+
 __weak void usb_hub_reset_devices(struct usb_hub_device *hub, int port)
 {
 	return;
@@ -178,15 +212,6 @@ static void usb_hub_power_on(struct usb_hub_device *hub)
 		debug("port %d returns %lX\n", i + 1, dev->status);
 	}
 
-#ifdef CONFIG_SANDBOX
-	/*
-	 * Don't set timeout / delay values here. This results
-	 * in these values still being reset to 0.
-	 */
-	if (state_get_skip_delays())
-		return;
-#endif
-
 	/*
 	 * Wait for power to become stable,
 	 * plus spec-defined max time for device to connect
@@ -254,6 +279,61 @@ static inline const char *portspeed(int portstatus)
 	}
 }
 
+/**
+ * usb_hub_port_reset_done() - check whether a port has come out of reset
+ *
+ * @dev:	Hub device
+ * @port:	Port number (note ports are numbered from 0 here)
+ * @portstat:	Returns port status, if the port is now enabled
+ * Return: 0 if the port is enabled, -EAGAIN if not yet, other -ve on error
+ */
+static int usb_hub_port_reset_done(struct usb_device *dev, int port,
+				   unsigned short *portstat)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(struct usb_port_status, portsts, 1);
+	unsigned short portstatus, portchange;
+
+	if (usb_get_port_status(dev, port + 1, portsts) < 0) {
+		debug("get_port_status failed status %lX\n", dev->status);
+		return -1;
+	}
+	portstatus = le16_to_cpu(portsts->wPortStatus);
+	portchange = le16_to_cpu(portsts->wPortChange);
+
+	debug("portstatus %x, change %x, %s\n", portstatus, portchange,
+	      portspeed(portstatus));
+
+	debug("STAT_C_CONNECTION = %d STAT_CONNECTION = %d" \
+	      "  USB_PORT_STAT_ENABLE %d\n",
+	      (portchange & USB_PORT_STAT_C_CONNECTION) ? 1 : 0,
+	      (portstatus & USB_PORT_STAT_CONNECTION) ? 1 : 0,
+	      (portstatus & USB_PORT_STAT_ENABLE) ? 1 : 0);
+
+	/*
+	 * Perhaps we should check for the following here:
+	 * - C_CONNECTION hasn't been set.
+	 * - CONNECTION is still set.
+	 *
+	 * Doing so would ensure that the device is still connected
+	 * to the bus, and hasn't been unplugged or replaced while the
+	 * USB bus reset was going on.
+	 *
+	 * However, if we do that, then (at least) a San Disk Ultra
+	 * USB 3.0 16GB device fails to reset on (at least) an NVIDIA
+	 * Tegra Jetson TK1 board. For some reason, the device appears
+	 * to briefly drop off the bus when this second bus reset is
+	 * executed, yet if we retry this loop, it'll eventually come
+	 * back after another reset or two.
+	 */
+
+	if (!(portstatus & USB_PORT_STAT_ENABLE))
+		return -EAGAIN;
+
+	usb_clear_port_feature(dev, port + 1, USB_PORT_FEAT_C_RESET);
+	*portstat = portstatus;
+	return 0;
+}
+
 /**
  * usb_hub_port_reset() - reset a port given its usb_device pointer
  *
@@ -268,8 +348,6 @@ static int usb_hub_port_reset(struct usb_device *dev, int port,
 			      unsigned short *portstat)
 {
 	int err, tries;
-	ALLOC_CACHE_ALIGN_BUFFER(struct usb_port_status, portsts, 1);
-	unsigned short portstatus, portchange;
 	int delay = HUB_SHORT_RESET_TIME; /* start with short reset delay */
 
 #if CONFIG_IS_ENABLED(DM_USB)
@@ -285,64 +363,35 @@ static int usb_hub_port_reset(struct usb_device *dev, int port,
 
 		mdelay(delay);
 
-		if (usb_get_port_status(dev, port + 1, portsts) < 0) {
-			debug("get_port_status failed status %lX\n",
-			      dev->status);
-			return -1;
-		}
-		portstatus = le16_to_cpu(portsts->wPortStatus);
-		portchange = le16_to_cpu(portsts->wPortChange);
-
-		debug("portstatus %x, change %x, %s\n", portstatus, portchange,
-							portspeed(portstatus));
-
-		debug("STAT_C_CONNECTION = %d STAT_CONNECTION = %d" \
-		      "  USB_PORT_STAT_ENABLE %d\n",
-		      (portchange & USB_PORT_STAT_C_CONNECTION) ? 1 : 0,
-		      (portstatus & USB_PORT_STAT_CONNECTION) ? 1 : 0,
-		      (portstatus & USB_PORT_STAT_ENABLE) ? 1 : 0);
-
-		/*
-		 * Perhaps we should check for the following here:
-		 * - C_CONNECTION hasn't been set.
-		 * - CONNECTION is still set.
-		 *
-		 * Doing so would ensure that the device is still connected
-		 * to the bus, and hasn't been unplugged or replaced while the
-		 * USB bus reset was going on.
-		 *
-		 * However, if we do that, then (at least) a San Disk Ultra
-		 * USB 3.0 16GB device fails to reset on (at least) an NVIDIA
-		 * Tegra Jetson TK1 board. For some reason, the device appears
-		 * to briefly drop off the bus when this second bus reset is
-		 * executed, yet if we retry this loop, it'll eventually come
-		 * back after another reset or two.
-		 */
-
-		if (portstatus & USB_PORT_STAT_ENABLE)
-			break;
+		err = usb_hub_port_reset_done(dev, port, portstat);
+		if (err != -EAGAIN)
+			return err;
 
 		/* Switch to long reset delay for the next round */
 		delay = HUB_LONG_RESET_TIME;
 	}
 
-	if (tries == MAX_TRIES) {
-		debug("Cannot enable port %i after %i retries, " \
-		      "disabling port.\n", port + 1, MAX_TRIES);
-		debug("Maybe the USB cable is bad?\n");
-		return -1;
-	}
+	debug("Cannot enable port %i after %i retries, " \
+	      "disabling port.\n", port + 1, MAX_TRIES);
+	debug("Maybe the USB cable is bad?\n");
 
-	usb_clear_port_feature(dev, port + 1, USB_PORT_FEAT_C_RESET);
-	*portstat = portstatus;
-	return 0;
+	return -1;
 }
 
-int usb_hub_port_connect_change(struct usb_device *dev, int port)
+/**
+ * usb_hub_port_check() - check a port after its connection changed
+ *
+ * This clears the connection change, ready to reset the port.
+ *
+ * @dev:	Hub device
+ * @port:	Port number (note ports are numbered from 0 here)
+ * Return: 0 if a device is connected, -ENOTCONN if not, other -ve on error
+ */
+static int usb_hub_port_check(struct usb_device *dev, int port)
 {
 	ALLOC_CACHE_ALIGN_BUFFER(struct usb_port_status, portsts, 1);
 	unsigned short portstatus;
-	int ret, speed;
+	int ret;
 
 	/* Check status */
 	ret = usb_get_port_status(dev, port + 1, portsts);
@@ -370,13 +419,21 @@ int usb_hub_port_connect_change(struct usb_device *dev, int port)
 			return -ENOTCONN;
 	}
 
-	/* Reset the port */
-	ret = usb_hub_port_reset(dev, port, &portstatus);
-	if (ret < 0) {
-		if (ret != -ENXIO)
-			printf("cannot reset port %i!?\n", port + 1);
-		return ret;
-	}
+	return 0;
+}
+
+/**
+ * usb_hub_port_enumerate() - set up the device on a port which has been reset
+ *
+ * @dev:	Hub device
+ * @port:	Port number (note ports are numbered from 0 here)
+ * @portstatus:	Port status after the reset
+ * Return: 0 if OK, -ve on error
+ */
+static int usb_hub_port_enumerate(struct usb_device *dev, int port,
+				  unsigned short portstatus)
+{
+	int ret, speed;
 
 	switch (portstatus & USB_PORT_STAT_SPEED_MASK) {
 	case USB_PORT_STAT_SUPER_SPEED:
@@ -426,11 +483,200 @@ int usb_hub_port_connect_change(struct usb_device *dev, int port)
 	return ret;
 }
 
-static int usb_scan_port(struct usb_device_scan *usb_scan)
+int usb_hub_port_connect_change(struct usb_device *dev, int port)
+{
+	unsigned short portstatus;
+	int ret;
+
+	ret = usb_hub_port_check(dev, port);
+	if (ret)
+		return ret;
+
+	/* Reset the port */
+	ret = usb_hub_port_reset(dev, port, &portstatus);
+	if (ret < 0) {
+		if (ret != -ENXIO)
+			printf("cannot reset port %i!?\n", port + 1);
+		return ret;
+	}
+
+	return usb_hub_port_enumerate(dev, port, portstatus);
+}
+
+static void *usb_hub_controller(struct usb_device *dev)
+{
+#if CONFIG_IS_ENABLED(DM_USB)
+	return dev->controller_dev;
+#else
+	return dev->controller;
+#endif
+}
+
+/*
+ * Add a bootstage record for the first scan of a hub. Bootstage keeps a
+ * pointer to the name and the hub may be gone before the report, so the
+ * names are held here rather than allocated for each scan.
+ */
+static void usb_hub_bootstage_mark(const char *name)
+{
+	static char names[HUB_BOOTSTAGE_MAX][40];
+	int i;
+
+	for (i = 0; i < HUB_BOOTSTAGE_MAX; i++) {
+		if (!strcmp(names[i], name))
+			return;
+		if (!*names[i]) {
+			strlcpy(names[i], name, sizeof(names[i]));
+			bootstage_mark_name(BOOTSTAGE_ID_ALLOC, names[i]);
+			return;
+		}
+	}
+}
+
+/* Take a port off the scanning list, recording when its hub is finished */
+static void usb_scan_done(struct usb_device_scan *usb_scan)
+{
+	struct usb_hub_device *hub = usb_scan->hub;
+	struct usb_device_scan *other;
+
+	list_del(&usb_scan->list);
+	free(usb_scan);
+
+	list_for_each_entry(other, &usb_scan_list, list) {
+		if (other->hub == hub)
+			return;
+	}
+	debug("devnum=%d: all ports scanned\n", hub->pusb_dev->devnum);
+	if (CONFIG_IS_ENABLED(BOOTSTAGE)) {
+		char name[40];
+
+#if CONFIG_IS_ENABLED(DM_USB)
+		snprintf(name, sizeof(name), "usb_hub %s",
+			 hub->pusb_dev->dev->name);
+#else
+		snprintf(name, sizeof(name), "usb_hub %d",
+			 hub->pusb_dev->devnum);
+#endif
+		usb_hub_bootstage_mark(name);
+	}
+}
+
+/**
+ * usb_scan_resetting() - find another port being reset on the same controller
+ *
+ * A device answers at address 0 from its port reset until it is given an
+ * address, so only one port on each controller can be reset at a time.
+ *
+ * @usb_scan:	Port which is ready to be reset
+ * Return: port being reset, or NULL if none
+ */
+static struct usb_device_scan *usb_scan_resetting(struct usb_device_scan
+						 *usb_scan)
+{
+	void *controller = usb_hub_controller(usb_scan->dev);
+	struct usb_device_scan *other;
+
+	list_for_each_entry(other, &usb_scan_list, list) {
+		if (other != usb_scan && other->state == USB_PORT_SCAN_RESET &&
+		    usb_hub_controller(other->dev) == controller)
+			return other;
+	}
+
+	return NULL;
+}
+
+static int usb_scan_start_reset(struct usb_device_scan *usb_scan)
+{
+	struct usb_device *dev = usb_scan->dev;
+	int i = usb_scan->port;
+	int ret;
+
+	ret = usb_set_port_feature(dev, i + 1, USB_PORT_FEAT_RESET);
+	if (ret < 0)
+		return ret;
+	usb_scan->state = USB_PORT_SCAN_RESET;
+	usb_scan->next = get_timer(0) + (usb_scan->tries ?
+			HUB_LONG_RESET_TIME : HUB_SHORT_RESET_TIME);
+	usb_scan->tries++;
+
+	return 0;
+}
+
+
+/* Deal with any other changes on a port once its device is set up */
+static void usb_scan_port_finish(struct usb_device_scan *usb_scan)
+{
+	unsigned short portstatus = usb_scan->portstatus;
+	unsigned short portchange = usb_scan->portchange;
+	struct usb_device *dev = usb_scan->dev;
+	struct usb_hub_device *hub = usb_scan->hub;
+	int i = usb_scan->port;
+
+	if (portchange & USB_PORT_STAT_C_ENABLE) {
+		debug("port %d enable change, status %x\n", i + 1, portstatus);
+		usb_clear_port_feature(dev, i + 1, USB_PORT_FEAT_C_ENABLE);
+		/*
+		 * The following hack causes a ghost device problem
+		 * to Faraday EHCI
+		 */
+#ifndef CONFIG_USB_EHCI_FARADAY
+		/*
+		 * EM interference sometimes causes bad shielded USB
+		 * devices to be shutdown by the hub, this hack enables
+		 * them again. Works at least with mouse driver
+		 */
+		if (!(portstatus & USB_PORT_STAT_ENABLE) &&
+		    (portstatus & USB_PORT_STAT_CONNECTION) &&
+		    usb_device_has_child_on_port(dev, i)) {
+			debug("already running port %i disabled by hub (EMI?), re-enabling...\n",
+			      i + 1);
+			usb_hub_port_connect_change(dev, i);
+		}
+#endif
+	}
+
+	if (portstatus & USB_PORT_STAT_SUSPEND) {
+		debug("port %d suspend change\n", i + 1);
+		usb_clear_port_feature(dev, i + 1, USB_PORT_FEAT_SUSPEND);
+	}
+
+	if (portchange & USB_PORT_STAT_C_OVERCURRENT) {
+		debug("port %d over-current change\n", i + 1);
+		usb_clear_port_feature(dev, i + 1,
+				       USB_PORT_FEAT_C_OVER_CURRENT);
+		/* Only power-on this one port */
+		usb_set_port_feature(dev, i + 1, USB_PORT_FEAT_POWER);
+		hub->overcurrent_count[i]++;
+
+		/*
+		 * If the max-scan-count is not reached, return without removing
+		 * the device from scan-list. This will re-issue a new scan.
+		 */
+		if (hub->overcurrent_count[i] <=
+		    PORT_OVERCURRENT_MAX_SCAN_COUNT) {
+			usb_scan->state = USB_PORT_SCAN_CONNECT;
+			usb_scan->next = get_timer(0);
+			return;
+		}
+
+		/* Otherwise the device will get removed */
+		printf("Port %d over-current occurred %d times\n", i + 1,
+		       hub->overcurrent_count[i]);
+	}
+
+	/*
+	 * We're done with this device, so let's remove this device from
+	 * scanning list
+	 */
+	usb_scan_done(usb_scan);
+}
+
+static int usb_scan_port_connect(struct usb_device_scan *usb_scan)
 {
 	ALLOC_CACHE_ALIGN_BUFFER(struct usb_port_status, portsts, 1);
 	unsigned short portstatus;
 	unsigned short portchange;
+	struct usb_device_scan *other;
 	struct usb_device *dev;
 	struct usb_hub_device *hub;
 	int ret = 0;
@@ -444,8 +690,11 @@ static int usb_scan_port(struct usb_device_scan *usb_scan)
 	 * Don't talk to the device before the query delay is expired.
 	 * This is needed for voltages to stabalize.
 	 */
-	if (get_timer(0) < hub->query_delay)
+	if (get_timer(0) < hub->query_delay) {
+		usb_scan->next = hub->query_delay;
 		return 0;
+	}
+	usb_scan->state = USB_PORT_SCAN_CONNECT;
 
 	ret = usb_get_port_status(dev, i + 1, portsts);
 	if (ret < 0) {
@@ -454,10 +703,10 @@ static int usb_scan_port(struct usb_device_scan *usb_scan)
 			debug("devnum=%d port=%d: timeout\n",
 			      dev->devnum, i + 1);
 			/* Remove this device from scanning list */
-			list_del(&usb_scan->list);
-			free(usb_scan);
+			usb_scan_done(usb_scan);
 			return 0;
 		}
+		usb_scan->next = get_timer(0) + HUB_POLL_TIME;
 		return 0;
 	}
 
@@ -478,10 +727,10 @@ static int usb_scan_port(struct usb_device_scan *usb_scan)
 			debug("devnum=%d port=%d: timeout\n",
 			      dev->devnum, i + 1);
 			/* Remove this device from scanning list */
-			list_del(&usb_scan->list);
-			free(usb_scan);
+			usb_scan_done(usb_scan);
 			return 0;
 		}
+		usb_scan->next = get_timer(0) + HUB_POLL_TIME;
 		return 0;
 	}
 
@@ -498,68 +747,95 @@ static int usb_scan_port(struct usb_device_scan *usb_scan)
 
 	/* A new USB device is ready at this point */
 	debug("devnum=%d port=%d: USB dev found\n", dev->devnum, i + 1);
+	usb_scan->portstatus = portstatus;
+	usb_scan->portchange = portchange;
 
-	usb_hub_port_connect_change(dev, i);
-
-	if (portchange & USB_PORT_STAT_C_ENABLE) {
-		debug("port %d enable change, status %x\n", i + 1, portstatus);
-		usb_clear_port_feature(dev, i + 1, USB_PORT_FEAT_C_ENABLE);
-		/*
-		 * The following hack causes a ghost device problem
-		 * to Faraday EHCI
-		 */
-#ifndef CONFIG_USB_EHCI_FARADAY
-		/*
-		 * EM interference sometimes causes bad shielded USB
-		 * devices to be shutdown by the hub, this hack enables
-		 * them again. Works at least with mouse driver
-		 */
-		if (!(portstatus & USB_PORT_STAT_ENABLE) &&
-		    (portstatus & USB_PORT_STAT_CONNECTION) &&
-		    usb_device_has_child_on_port(dev, i)) {
-			debug("already running port %i disabled by hub (EMI?), re-enabling...\n",
-			      i + 1);
-			usb_hub_port_connect_change(dev, i);
-		}
-#endif
+	/* Wait for any other reset on this controller to finish first */
+	other = usb_scan_resetting(usb_scan);
+	if (other) {
+		usb_scan->next = other->next;
+		return 0;
 	}
 
-	if (portstatus & USB_PORT_STAT_SUSPEND) {
-		debug("port %d suspend change\n", i + 1);
-		usb_clear_port_feature(dev, i + 1, USB_PORT_FEAT_SUSPEND);
+	ret = usb_hub_port_check(dev, i);
+	if (!ret) {
+		usb_scan->tries = 0;
+		ret = usb_scan_start_reset(usb_scan);
+		if (!ret)
+			return 0;
+		if (ret != -ENXIO)
+			printf("cannot reset port %i!?\n", i + 1);
 	}
+	usb_scan_port_finish(usb_scan);
 
-	if (portchange & USB_PORT_STAT_C_OVERCURRENT) {
-		debug("port %d over-current change\n", i + 1);
-		usb_clear_port_feature(dev, i + 1,
-				       USB_PORT_FEAT_C_OVER_CURRENT);
-		/* Only power-on this one port */
-		usb_set_port_feature(dev, i + 1, USB_PORT_FEAT_POWER);
-		hub->overcurrent_count[i]++;
+	return 0;
+}
 
-		/*
-		 * If the max-scan-count is not reached, return without removing
-		 * the device from scan-list. This will re-issue a new scan.
-		 */
-		if (hub->overcurrent_count[i] <=
-		    PORT_OVERCURRENT_MAX_SCAN_COUNT)
+/* Check a port which has been reset, then set up its device */
+static int usb_scan_port_reset(struct usb_device_scan *usb_scan)
+{
+	struct usb_device *dev = usb_scan->dev;
+	unsigned short portstatus = 0;
+	int i = usb_scan->port;
+	int ret;
+
+	ret = usb_hub_port_reset_done(dev, i, &portstatus);
+	if (ret == -EAGAIN && usb_scan->tries < MAX_TRIES) {
+		/* Try again with the long reset delay */
+		ret = usb_scan_start_reset(usb_scan);
+		if (!ret)
 			return 0;
+	}
+	if (ret == -EAGAIN) {
+		debug("Cannot enable port %i after %i retries, disabling port.\n",
+		      i + 1, MAX_TRIES);
+		debug("Maybe the USB cable is bad?\n");
+		ret = -1;
+	}
 
-		/* Otherwise the device will get removed */
-		printf("Port %d over-current occurred %d times\n", i + 1,
-		       hub->overcurrent_count[i]);
+	/* Let any other port on this controller be reset */
+	usb_scan->state = USB_PORT_SCAN_CONNECT;
+	if (ret < 0) {
+		if (ret != -ENXIO)
+			printf("cannot reset port %i!?\n", i + 1);
+	} else {
+		usb_hub_port_enumerate(dev, i, portstatus);
 	}
+	usb_scan_port_finish(usb_scan);
 
-	/*
-	 * We're done with this device, so let's remove this device from
-	 * scanning list
-	 */
-	list_del(&usb_scan->list);
-	free(usb_scan);
+	return 0;
+}
+
+static int usb_scan_port(struct usb_device_scan *usb_scan)
+{
+	switch (usb_scan->state) {
+	case USB_PORT_SCAN_POWER:
+	case USB_PORT_SCAN_CONNECT:
+		return usb_scan_port_connect(usb_scan);
+	case USB_PORT_SCAN_RESET:
+		return usb_scan_port_reset(usb_scan);
+	}
 
 	return 0;
 }
 
+/* Wait until the given time, in ms since an arbitrary point */
+static void usb_scan_wait(ulong when)
+{
+	ulong now = get_timer(0);
+
+	if (when <= now)
+		return;
+#ifdef CONFIG_SANDBOX
+	/* Move the clock on so that tests see the same timing, but faster */
+	if (state_get_skip_delays()) {
+		timer_test_add_offset(when - now);
+		return;
+	}
+#endif
+	mdelay(when - now);
+}
+
 static int usb_device_list_scan(void)
 {
 	struct usb_device_scan *usb_scan;
@@ -568,24 +844,37 @@ static int usb_device_list_scan(void)
 	int ret = 0;
 
 	/* Only run this loop once for each controller */
-	if (running)
+	if (running || usb_scan_deferred)
 		return 0;
 
 	running = 1;
 
 	while (1) {
+		ulong now, next;
+
 		/* We're done, once the list is empty again */
 		if (list_empty(&usb_scan_list))
 			goto out;
 
+		now = get_timer(0);
 		list_for_each_entry_safe(usb_scan, tmp, &usb_scan_list, list) {
 			int ret;
 
+			if (usb_scan->next > now)
+				continue;
+
 			/* Scan this port */
 			ret = usb_scan_port(usb_scan);
 			if (ret)
 				goto out;
 		}
+
+		/* Sleep until the next port needs looking at */
+		next = ULONG_MAX;
+		list_for_each_entry(usb_scan, &usb_scan_list, list)
+			next = min(next, usb_scan->next);
+		if (next != ULONG_MAX)
+			usb_scan_wait(next);
 	}
 
 out:
@@ -599,6 +888,18 @@ out:
 	return ret;
 }
 
+void usb_hub_defer_scan(void)
+{
+	usb_scan_deferred = true;
+}
+
+int usb_hub_run_scan(void)
+{
+	usb_scan_deferred = false;
+
+	return usb_device_list_scan();
+}
+
 static struct usb_hub_device *usb_get_hub_device(struct usb_device *dev)
 {
 	struct usb_hub_device *hub;
@@ -867,6 +1168,8 @@ static int usb_hub_configure(struct usb_device *dev)
 		usb_scan->dev = dev;
 		usb_scan->hub = hub;
 		usb_scan->port = i;
+		usb_scan->state = USB_PORT_SCAN_POWER;
+		usb_scan->next = hub->query_delay;
 		list_add_tail(&usb_scan->list, &usb_scan_list);
 	}
 
@@ -50,6 +50,7 @@
 
 #include <part.h>
 #include <usb.h>
+#include <usb/uas.h>
 
 #undef BBB_COMDAT_TRACE
 #undef BBB_XPORT_TRACE
@@ -102,6 +103,9 @@ struct us_data {
 	trans_reset	transport_reset;	/* reset routine */
 	trans_cmnd	transport;		/* transport routine */
 	unsigned short	max_xfer_blk;		/* maximum transfer blocks */
+#if CONFIG_IS_ENABLED(USB_UAS)
+	struct usb_uas	*uas;			/* UAS state, if in use */
+#endif
 };
 
 #if !CONFIG_IS_ENABLED(BLK)
@@ -176,6 +180,11 @@ static unsigned int usb_get_max_lun(struct us_data *us)
 {
 	int len;
 	ALLOC_CACHE_ALIGN_BUFFER(unsigned char, result, 1);
+#if CONFIG_IS_ENABLED(USB_UAS)
+	/* This is a Bulk-Only request */
+	if (us->uas)
+		return 0;
+#endif
 	len = usb_control_msg(us->pusb_dev,
 			      usb_rcvctrlpipe(us->pusb_dev, 0),
 			      US_BBB_GET_MAX_LUN,
@@ -546,13 +555,13 @@ static int usb_stor_CB_reset(struct us_data *us)
  * Set up the command for a BBB device. Note that the actual SCSI
  * command is copied into cbw.CBWCDB.
  */
-static int usb_stor_BBB_comdat(struct scsi_cmd *srb, struct us_data *us)
+static int usb_stor_BBB_setup_cbw(struct scsi_cmd *srb,
+				  struct umass_bbb_cbw *cbw)
 {
-	int result;
-	int actlen;
 	int dir_in;
-	unsigned int pipe;
-	ALLOC_CACHE_ALIGN_BUFFER(struct umass_bbb_cbw, cbw, 1);
+#ifdef BBB_COMDAT_TRACE
+	int result;
+#endif
 
 	dir_in = US_DIRECTION(srb->cmd[0]);
 
@@ -572,9 +581,6 @@ static int usb_stor_BBB_comdat(struct scsi_cmd *srb, struct us_data *us)
 		return -1;
 	}
 
-	/* always OUT to the ep */
-	pipe = usb_sndbulkpipe(us->pusb_dev, us->ep_out);
-
 	cbw->dCBWSignature = cpu_to_le32(CBWSIGNATURE);
 	cbw->dCBWTag = cpu_to_le32(CBWTag++);
 	cbw->dCBWDataTransferLength = cpu_to_le32(srb->datalen);
@@ -585,6 +591,23 @@ static int usb_stor_BBB_comdat(struct scsi_cmd *srb, struct us_data *us)
 	/* DST SRC LEN!!! */
 
 	memcpy(cbw->CBWCDB, srb->cmd, srb->cmdlen);
+
+	return 0;
+}
+
+static int usb_stor_BBB_comdat(struct scsi_cmd *srb, struct us_data *us)
+{
+	int result;
+	int actlen;
+	unsigned int pipe;
+	ALLOC_CACHE_ALIGN_BUFFER(struct umass_bbb_cbw, cbw, 1);
+
+	result = usb_stor_BBB_setup_cbw(srb, cbw);
+	if (result < 0)
+		return result;
+
+	/* always OUT to the ep */
+	pipe = usb_sndbulkpipe(us->pusb_dev, us->ep_out);
 	result = usb_bulk_msg(us->pusb_dev, pipe, cbw, UMASS_BBB_CBW_SIZE,
 			      &actlen, USB_CNTL_TIMEOUT * 5);
 	if (result < 0)
@@ -719,12 +742,47 @@ static int usb_stor_BBB_clear_endpt_stall(struct us_data *us, __u8 endpt)
 			       endpt, NULL, 0, USB_CNTL_TIMEOUT * 5);
 }
 
+/*
+ * Queue the COMMAND, DATA and STATUS phases together, so that the host
+ * controller can run them back to back. If this fails the status of each
+ * request shows how far it got.
+ */
+static int usb_stor_BBB_queue(struct scsi_cmd *srb, struct us_data *us,
+			      struct umass_bbb_csw *csw,
+			      struct usb_bulk_req *reqs)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(struct umass_bbb_cbw, cbw, 1);
+	struct usb_device *udev = us->pusb_dev;
+	int result;
+
+	result = usb_stor_BBB_setup_cbw(srb, cbw);
+	if (result < 0)
+		return result;
+
+	memset(reqs, '\0', 3 * sizeof(*reqs));
+	reqs[0].pipe = usb_sndbulkpipe(udev, us->ep_out);
+	reqs[0].buffer = cbw;
+	reqs[0].length = UMASS_BBB_CBW_SIZE;
+	if (US_DIRECTION(srb->cmd[0]))
+		reqs[1].pipe = usb_rcvbulkpipe(udev, us->ep_in);
+	else
+		reqs[1].pipe = usb_sndbulkpipe(udev, us->ep_out);
+	reqs[1].buffer = srb->pdata;
+	reqs[1].length = srb->datalen;
+	reqs[2].pipe = usb_rcvbulkpipe(udev, us->ep_in);
+	reqs[2].buffer = csw;
+	reqs[2].length = UMASS_BBB_CSW_SIZE;
+
+	return usb_bulk_msgs(udev, reqs, 3, USB_CNTL_TIMEOUT * 5);
+}
+
 static int usb_stor_BBB_transport(struct scsi_cmd *srb, struct us_data *us)
 {
 	int result, retry;
 	int dir_in;
 	int actlen, data_actlen;
 	unsigned int pipe, pipein, pipeout;
+	struct usb_bulk_req reqs[3];
 	ALLOC_CACHE_ALIGN_BUFFER(struct umass_bbb_csw, csw, 1);
 #ifdef BBB_XPORT_TRACE
 	unsigned char *ptr;
@@ -732,6 +790,41 @@ static int usb_stor_BBB_transport(struct scsi_cmd *srb, struct us_data *us)
 #endif
 
 	dir_in = US_DIRECTION(srb->cmd[0]);
+	pipein = usb_rcvbulkpipe(us->pusb_dev, us->ep_in);
+	pipeout = usb_sndbulkpipe(us->pusb_dev, us->ep_out);
+
+	/*
+	 * Once the device is ready there is no need to wait between phases,
+	 * so hand them all to the controller at once
+	 */
+	if ((us->flags & USB_READY) && srb->datalen) {
+		debug("COMMAND, DATA and STATUS phases\n");
+		result = usb_stor_BBB_queue(srb, us, csw, reqs);
+		data_actlen = reqs[1].act_len;
+		if (!result)
+			goto check;
+
+		/* handle a STALL as if the phases had been run in turn */
+		if (!reqs[0].status && (reqs[1].status & USB_ST_STALLED)) {
+			debug("DATA:stall\n");
+			result = usb_stor_BBB_clear_endpt_stall(us,
+						dir_in ? us->ep_in : us->ep_out);
+			if (result >= 0)
+				goto st;
+		} else if (!reqs[0].status && !reqs[1].status &&
+			   (reqs[2].status & USB_ST_STALLED)) {
+			debug("STATUS:stall\n");
+			result = usb_stor_BBB_clear_endpt_stall(us, us->ep_in);
+			if (result >= 0) {
+				retry = 1;
+				goto again;
+			}
+		}
+		debug("queued phases failed, status %lx/%lx/%lx\n",
+		      reqs[0].status, reqs[1].status, reqs[2].status);
+		usb_stor_BBB_reset(us);
+		return USB_STOR_TRANSPORT_FAILED;
+	}
 
 	/* COMMAND phase */
 	debug("COMMAND phase\n");
@@ -744,8 +837,6 @@ static int usb_stor_BBB_transport(struct scsi_cmd *srb, struct us_data *us)
 	}
 	if (!(us->flags & USB_READY))
 		mdelay(5);
-	pipein = usb_rcvbulkpipe(us->pusb_dev, us->ep_in);
-	pipeout = usb_sndbulkpipe(us->pusb_dev, us->ep_out);
 	/* DATA phase + error handling */
 	data_actlen = 0;
 	/* no data, go immediately to the STATUS phase */
@@ -810,6 +901,7 @@ again:
 		printf("ptr[%d] %#x ", index, ptr[index]);
 	printf("\n");
 #endif
+check:
 	/* misuse pipe to get the residue */
 	pipe = le32_to_cpu(csw->dCSWDataResidue);
 	if (pipe == 0 && srb->datalen != 0 && srb->datalen - data_actlen != 0)
@@ -954,6 +1046,38 @@ do_retry:
 	return USB_STOR_TRANSPORT_FAILED;
 }
 
+#if CONFIG_IS_ENABLED(USB_UAS)
+static int usb_stor_UAS_transport(struct scsi_cmd *srb, struct us_data *us)
+{
+	int ret;
+
+	ret = usb_uas_command(us->uas, srb, !US_DIRECTION(srb->cmd[0]));
+	if (ret == -EREMOTEIO)
+		return USB_STOR_TRANSPORT_FAILED;
+	if (ret) {
+		debug("UAS command failed (err=%d)\n", ret);
+		usb_uas_reset(us->uas);
+		return USB_STOR_TRANSPORT_ERROR;
+	}
+
+	return USB_STOR_TRANSPORT_GOOD;
+}
+
+static int usb_stor_UAS_reset(struct us_data *us)
+{
+	return usb_uas_reset(us->uas);
+}
+
+/* Go back to Bulk-Only Transport, for devices whose UAS does not work */
+static void usb_stor_UAS_stop(struct us_data *us)
+{
+	usb_uas_stop(us->uas);
+	us->uas = NULL;
+	us->transport = usb_stor_BBB_transport;
+	us->transport_reset = usb_stor_BBB_reset;
+}
+#endif
+
 static void usb_stor_set_max_xfer_blk(struct usb_device *udev,
 				      struct us_data *us)
 {
@@ -973,9 +1097,15 @@ static void usb_stor_set_max_xfer_blk(struct usb_device *udev,
 	 * Windows 7 limiting transfers to 128 sectors for both USB2 and USB3
 	 * and Apple Mac OS X 10.11 limiting transfers to 256 sectors for USB2
 	 * and 2048 for USB3 devices.
+	 *
+	 * Follow the same approach, allowing SuperSpeed devices larger
+	 * transfers.
 	 */
 	unsigned short blk = 240;
 
+	if (udev->speed >= USB_SPEED_SUPER)
+		blk = CONFIG_USB_STORAGE_SS_MAX_BLK;
+
 #if CONFIG_IS_ENABLED(DM_USB)
 	size_t size;
 	int ret;
@@ -1149,7 +1279,7 @@ static unsigned long usb_stor_read(struct blk_desc *block_dev, lbaint_t blknr,
 {
 	lbaint_t start, blks;
 	uintptr_t buf_addr;
-	unsigned short smallblks;
+	unsigned short smallblks = 0;
 	struct usb_device *udev;
 	struct us_data *ss;
 	int retry;
@@ -1185,7 +1315,20 @@ static unsigned long usb_stor_read(struct blk_desc *block_dev, lbaint_t blknr,
 	debug("\nusb_read: dev %d startblk " LBAF ", blccnt " LBAF " buffer %lx\n",
 	      block_dev->devnum, start, blks, buf_addr);
 
-	do {
+#if CONFIG_IS_ENABLED(USB_UAS)
+	/* Anything left after an error is retried one command at a time */
+	if (ss->uas) {
+		lbaint_t done;
+
+		done = usb_uas_rw(ss->uas, srb->lun, false, start, blks,
+				  block_dev->blksz, ss->max_xfer_blk, buffer);
+		start += done;
+		blks -= done;
+		buf_addr += done * block_dev->blksz;
+	}
+#endif
+
+	while (blks != 0) {
 		/* XXX need some comment here */
 		retry = 2;
 		srb->pdata = (unsigned char *)buf_addr;
@@ -1210,7 +1353,7 @@ retry_it:
 		start += smallblks;
 		blks -= smallblks;
 		buf_addr += srb->datalen;
-	} while (blks != 0);
+	}
 
 	debug("usb_read: end startblk " LBAF ", blccnt %x buffer %lx\n",
 	      start, smallblks, buf_addr);
@@ -1232,7 +1375,7 @@ static unsigned long usb_stor_write(struct blk_desc *block_dev, lbaint_t blknr,
 {
 	lbaint_t start, blks;
 	uintptr_t buf_addr;
-	unsigned short smallblks;
+	unsigned short smallblks = 0;
 	struct usb_device *udev;
 	struct us_data *ss;
 	int retry;
@@ -1270,7 +1413,21 @@ static unsigned long usb_stor_write(struct blk_desc *block_dev, lbaint_t blknr,
 	debug("\nusb_write: dev %d startblk " LBAF ", blccnt " LBAF " buffer %lx\n",
 	      block_dev->devnum, start, blks, buf_addr);
 
-	do {
+#if CONFIG_IS_ENABLED(USB_UAS)
+	/* Anything left after an error is retried one command at a time */
+	if (ss->uas) {
+		lbaint_t done;
+
+		done = usb_uas_rw(ss->uas, srb->lun, true, start, blks,
+				  block_dev->blksz, ss->max_xfer_blk,
+				  (void *)buffer);
+		start += done;
+		blks -= done;
+		buf_addr += done * block_dev->blksz;
+	}
+#endif
+
+	while (blks != 0) {
 		/* If write fails retry for max retry count else
 		 * return with number of blocks written successfully.
 		 */
@@ -1297,7 +1454,7 @@ retry_it:
 		start += smallblks;
 		blks -= smallblks;
 		buf_addr += srb->datalen;
-	} while (blks != 0);
+	}
 
 	debug("usb_write: end startblk " LBAF ", blccnt %x buffer %lx\n",
 	      start, smallblks, buf_addr);
@@ -1416,6 +1573,14 @@ int usb_storage_probe(struct usb_device *dev, unsigned int ifnum,
 		printf("Sorry, protocol %d not yet supported.\n", ss->subclass);
 		return 0;
 	}
+#if CONFIG_IS_ENABLED(USB_UAS)
+	if (ss->protocol == US_PR_BULK && ss->subclass == US_SC_SCSI &&
+	    !usb_uas_probe(dev, iface->desc.bInterfaceNumber, &ss->uas)) {
+		debug("Using UAS\n");
+		ss->transport = usb_stor_UAS_transport;
+		ss->transport_reset = usb_stor_UAS_reset;
+	}
+#endif
 	if (ss->ep_int) {
 		/* we had found an interrupt endpoint, prepare irq pipe
 		 * set up the IRQ pipe and handler
@@ -1441,6 +1606,7 @@ int usb_stor_get_info(struct usb_device *dev, struct us_data *ss,
 	ALLOC_CACHE_ALIGN_BUFFER(u8, usb_stor_buf, 36);
 	u32 capacity, blksz;
 	struct scsi_cmd *pccb = &usb_ccb;
+	int ret;
 
 	pccb->pdata = usb_stor_buf;
 
@@ -1448,7 +1614,15 @@ int usb_stor_get_info(struct usb_device *dev, struct us_data *ss,
 	pccb->lun = dev_desc->lun;
 	debug(" address %d\n", dev_desc->target);
 
-	if (usb_inquiry(pccb, ss)) {
+	ret = usb_inquiry(pccb, ss);
+#if CONFIG_IS_ENABLED(USB_UAS)
+	if (ret && ss->uas) {
+		printf("UAS not working, using Bulk-Only Transport\n");
+		usb_stor_UAS_stop(ss);
+		ret = usb_inquiry(pccb, ss);
+	}
+#endif
+	if (ret) {
 		debug("%s: usb_inquiry() failed\n", __func__);
 		return -1;
 	}
@@ -1533,6 +1707,19 @@ static int usb_mass_storage_probe(struct udevice *dev)
 	return ret;
 }
 
+#if CONFIG_IS_ENABLED(USB_UAS)
+static int usb_mass_storage_remove(struct udevice *dev)
+{
+	struct us_data *ss = dev_get_plat(dev);
+
+	/* Put the device back as it was found, without streams */
+	if (ss->uas)
+		usb_stor_UAS_stop(ss);
+
+	return 0;
+}
+#endif
+
 static const struct udevice_id usb_mass_storage_ids[] = {
 	{ .compatible = "usb-mass-storage" },
 	{ }
@@ -1543,6 +1730,9 @@ U_BOOT_DRIVER(usb_mass_storage) = {
 	.id	= UCLASS_MASS_STORAGE,
 	.of_match = usb_mass_storage_ids,
 	.probe = usb_mass_storage_probe,
+#if CONFIG_IS_ENABLED(USB_UAS)
+	.remove = usb_mass_storage_remove,
+#endif
 #if CONFIG_IS_ENABLED(BLK)
 	.plat_auto	= sizeof(struct us_data),
 #endif
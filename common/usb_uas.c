@@ -0,0 +1,499 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * USB Attached SCSI (UAS) transport for USB mass storage
+ *
+ * Bulk-Only Transport carries one command at a time and waits for its status
+ * before the next can start. UAS tags each command and has separate pipes
+ * for commands, status and data, so the device can be handed a queue of
+ * commands to work through together. On SuperSpeed each tag has a stream of
+ * its own on the status and data pipes; at high speed the device says on the
+ * status pipe which command it is ready to move data for.
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#define LOG_CATEGORY UCLASS_MASS_STORAGE
+
+#include <common.h>
+#include <log.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <scsi.h>
+#include <usb.h>
+#include <usb/uas.h>
+#include <asm/byteorder.h>
+#include <asm/cache.h>
+#include <asm/unaligned.h>
+#include <linux/errno.h>
+
+#define UAS_TIMEOUT		(USB_CNTL_TIMEOUT * 5)
+
+/* SCSI status codes used here */
+#define UAS_STATUS_GOOD		0x00
+
+/* Number of pipes which carry streams: status, data-in and data-out */
+#define UAS_STREAM_PIPES	3
+
+/**
+ * struct uas_iu_buf - DMA buffers for the information units of one tag
+ *
+ * @cmd: Command IU
+ * @sense: Sense IU, received at the end of the command
+ */
+struct uas_iu_buf {
+	struct uas_cmd_iu cmd __aligned(ARCH_DMA_MINALIGN);
+	struct uas_sense_iu sense __aligned(ARCH_DMA_MINALIGN);
+} __aligned(ARCH_DMA_MINALIGN);
+
+/**
+ * struct uas_tag - State of the command using a tag
+ *
+ * @data: Data buffer
+ * @datalen: Number of bytes of data
+ * @write: true if the data goes to the device
+ * @act_len: Number of bytes of data transferred
+ * @blks: Number of blocks the command covers, for usb_uas_rw()
+ * @done: true once the sense IU has been received
+ */
+struct uas_tag {
+	void *data;
+	int datalen;
+	bool write;
+	int act_len;
+	uint blks;
+	bool done;
+};
+
+/**
+ * struct usb_uas - UAS state of a mass-storage interface
+ *
+ * @udev: USB device
+ * @ifnum: Interface number
+ * @cmd_pipe: Pipe for command IUs
+ * @status_pipe: Pipe for sense IUs and, at high speed, READ/WRITE READY
+ * @data_in_pipe: Pipe for data from the device
+ * @data_out_pipe: Pipe for data to the device
+ * @qdepth: Number of tags, which run from 1 to @qdepth
+ * @streams: true if each tag has its own stream on the status and data pipes
+ * @iu: IU buffers for each tag. Entry 0 receives status at high speed
+ * @tag: State of each tag, indexed as @iu
+ * @reqs: Transfers to hand to the host controller together
+ */
+struct usb_uas {
+	struct usb_device *udev;
+	int ifnum;
+	unsigned long cmd_pipe;
+	unsigned long status_pipe;
+	unsigned long data_in_pipe;
+	unsigned long data_out_pipe;
+	int qdepth;
+	bool streams;
+	struct uas_iu_buf *iu;
+	struct uas_tag *tag;
+	struct usb_bulk_req *reqs;
+};
+
+/**
+ * uas_find_setting() - Find the UAS alternate setting of an interface
+ *
+ * The pipe usage descriptors are not kept by usb_parse_config(), so this
+ * reads the configuration descriptor again.
+ *
+ * @udev: USB device
+ * @ifnum: Interface number
+ * @altp: Returns the alternate setting
+ * @eps: Returns the endpoint address of each pipe, indexed by pipe ID
+ * Return: 0 if OK, -ENOENT if there is no usable UAS setting
+ */
+static int uas_find_setting(struct usb_device *udev, int ifnum, int *altp,
+			    u8 eps[])
+{
+	struct usb_interface_descriptor *ifd;
+	bool in_uas = false;
+	int len, pos, id;
+	u8 *buf;
+	u8 ep = 0;
+	int ret;
+
+	len = usb_get_configuration_len(udev, 0);
+	if (len < 0)
+		return len;
+	buf = malloc_cache_aligned(len);
+	if (!buf)
+		return -ENOMEM;
+	ret = usb_get_configuration_no(udev, 0, buf, len);
+	if (ret < len) {
+		ret = -EIO;
+		goto out;
+	}
+
+	ret = -ENOENT;
+	for (pos = 0; pos + 2 <= len && buf[pos] >= 2; pos += buf[pos]) {
+		switch (buf[pos + 1]) {
+		case USB_DT_INTERFACE:
+			if (in_uas)
+				goto out;
+			ifd = (struct usb_interface_descriptor *)&buf[pos];
+			in_uas = ifd->bInterfaceNumber == ifnum &&
+				ifd->bInterfaceClass == USB_CLASS_MASS_STORAGE &&
+				ifd->bInterfaceSubClass == US_SC_SCSI &&
+				ifd->bInterfaceProtocol == US_PR_UAS;
+			if (in_uas) {
+				*altp = ifd->bAlternateSetting;
+				memset(eps, '\0', UAS_PIPE_ID_DATA_OUT + 1);
+			}
+			break;
+		case USB_DT_ENDPOINT:
+			ep = buf[pos + 2];
+			break;
+		case USB_DT_PIPE_USAGE:
+			id = buf[pos + 2];
+			if (!in_uas || id < UAS_PIPE_ID_CMD ||
+			    id > UAS_PIPE_ID_DATA_OUT)
+				break;
+			/* Pipes 2 and 3 go to the host, 1 and 4 to the device */
+			if (!(ep & USB_DIR_IN) !=
+			    (id == UAS_PIPE_ID_CMD || id == UAS_PIPE_ID_DATA_OUT))
+				break;
+			eps[id] = ep;
+			if (eps[UAS_PIPE_ID_CMD] && eps[UAS_PIPE_ID_STATUS] &&
+			    eps[UAS_PIPE_ID_DATA_IN] && eps[UAS_PIPE_ID_DATA_OUT])
+				ret = 0;
+			break;
+		}
+	}
+out:
+	free(buf);
+
+	return ret;
+}
+
+int usb_uas_probe(struct usb_device *udev, int ifnum, struct usb_uas **uasp)
+{
+	u8 eps[UAS_PIPE_ID_DATA_OUT + 1];
+	struct usb_uas *uas;
+	int alt, ret;
+
+	ret = uas_find_setting(udev, ifnum, &alt, eps);
+	if (ret)
+		return ret;
+
+	uas = calloc(1, sizeof(*uas));
+	if (!uas)
+		return -ENOMEM;
+	uas->udev = udev;
+	uas->ifnum = ifnum;
+	uas->cmd_pipe = usb_sndbulkpipe(udev, eps[UAS_PIPE_ID_CMD] &
+					USB_ENDPOINT_NUMBER_MASK);
+	uas->status_pipe = usb_rcvbulkpipe(udev, eps[UAS_PIPE_ID_STATUS] &
+					   USB_ENDPOINT_NUMBER_MASK);
+	uas->data_in_pipe = usb_rcvbulkpipe(udev, eps[UAS_PIPE_ID_DATA_IN] &
+					    USB_ENDPOINT_NUMBER_MASK);
+	uas->data_out_pipe = usb_sndbulkpipe(udev, eps[UAS_PIPE_ID_DATA_OUT] &
+					     USB_ENDPOINT_NUMBER_MASK);
+	uas->qdepth = CONFIG_USB_UAS_QUEUE_DEPTH;
+
+	ret = usb_set_interface(udev, ifnum, alt);
+	if (ret)
+		goto err;
+
+	/* SuperSpeed devices only do UAS with streams */
+	if (udev->speed >= USB_SPEED_SUPER) {
+		unsigned long pipes[UAS_STREAM_PIPES] = {
+			uas->status_pipe, uas->data_in_pipe, uas->data_out_pipe
+		};
+
+		ret = usb_alloc_streams(udev, pipes, UAS_STREAM_PIPES,
+					uas->qdepth);
+		if (ret < 0) {
+			log_debug("Cannot set up streams (err=%d)\n", ret);
+			goto err_alt;
+		}
+		uas->qdepth = min(uas->qdepth, ret);
+		uas->streams = true;
+	}
+
+	uas->iu = malloc_cache_aligned((uas->qdepth + 1) * sizeof(*uas->iu));
+	uas->tag = calloc(uas->qdepth + 1, sizeof(*uas->tag));
+	uas->reqs = calloc(uas->qdepth * UAS_STREAM_PIPES, sizeof(*uas->reqs));
+	if (!uas->iu || !uas->tag || !uas->reqs) {
+		ret = -ENOMEM;
+		goto err_mem;
+	}
+	log_debug("UAS on interface %d setting %d, %d tags%s\n", ifnum, alt,
+		  uas->qdepth, uas->streams ? " with streams" : "");
+	*uasp = uas;
+
+	return 0;
+
+err_mem:
+	if (uas->streams) {
+		unsigned long pipes[UAS_STREAM_PIPES] = {
+			uas->status_pipe, uas->data_in_pipe, uas->data_out_pipe
+		};
+
+		usb_free_streams(udev, pipes, UAS_STREAM_PIPES);
+	}
+err_alt:
+	usb_set_interface(udev, ifnum, 0);
+err:
+	usb_uas_free(uas);
+
+	return ret;
+}
+
+void usb_uas_free(struct usb_uas *uas)
+{
+	if (!uas)
+		return;
+	free(uas->reqs);
+	free(uas->tag);
+	free(uas->iu);
+	free(uas);
+}
+
+void usb_uas_stop(struct usb_uas *uas)
+{
+	if (uas->streams) {
+		unsigned long pipes[UAS_STREAM_PIPES] = {
+			uas->status_pipe, uas->data_in_pipe, uas->data_out_pipe
+		};
+
+		usb_free_streams(uas->udev, pipes, UAS_STREAM_PIPES);
+	}
+	usb_set_interface(uas->udev, uas->ifnum, 0);
+	usb_uas_free(uas);
+}
+
+int usb_uas_reset(struct usb_uas *uas)
+{
+	int ret;
+
+	ret = usb_clear_halt(uas->udev, uas->status_pipe);
+	if (!ret)
+		ret = usb_clear_halt(uas->udev, uas->data_in_pipe);
+	if (!ret)
+		ret = usb_clear_halt(uas->udev, uas->data_out_pipe);
+	if (!ret)
+		ret = usb_clear_halt(uas->udev, uas->cmd_pipe);
+
+	return ret;
+}
+
+/* Sets up the command IU and state of a tag */
+static void uas_prep(struct usb_uas *uas, int tag, int lun, const u8 *cdb,
+		     int cdblen, void *data, int datalen, bool write)
+{
+	struct uas_cmd_iu *iu = &uas->iu[tag].cmd;
+	struct uas_tag *t = &uas->tag[tag];
+
+	memset(iu, '\0', sizeof(*iu));
+	iu->iu_id = UAS_IU_ID_COMMAND;
+	iu->tag = cpu_to_be16(tag);
+	iu->lun[1] = lun;
+	memcpy(iu->cdb, cdb, min_t(int, cdblen, sizeof(iu->cdb)));
+
+	t->data = data;
+	t->datalen = datalen;
+	t->write = write;
+	t->act_len = 0;
+	t->done = false;
+}
+
+static void uas_req(struct usb_bulk_req *req, unsigned long pipe, void *buf,
+		    int length, int stream)
+{
+	req->pipe = pipe;
+	req->buffer = buf;
+	req->length = length;
+	req->stream = stream;
+}
+
+/*
+ * Runs commands without streams: all the command IUs go to the device, then
+ * it says on the status pipe which command to move data for next and when
+ * each is finished
+ */
+static int uas_run_ready(struct usb_uas *uas, int count)
+{
+	struct uas_sense_iu *iu = &uas->iu[0].sense;
+	struct usb_device *udev = uas->udev;
+	struct uas_tag *t;
+	int left, len, tag;
+	unsigned long pipe;
+	int ret;
+
+	for (tag = 1; tag <= count; tag++)
+		uas_req(&uas->reqs[tag - 1], uas->cmd_pipe, &uas->iu[tag].cmd,
+			sizeof(struct uas_cmd_iu), 0);
+	ret = usb_bulk_msgs(udev, uas->reqs, count, UAS_TIMEOUT);
+	if (ret)
+		return ret;
+
+	for (left = count; left;) {
+		ret = usb_bulk_msg(udev, uas->status_pipe, iu, sizeof(*iu),
+				   &len, UAS_TIMEOUT);
+		if (ret)
+			return ret;
+		tag = len >= sizeof(struct uas_iu_header) ?
+			be16_to_cpu(iu->tag) : 0;
+		if (tag < 1 || tag > count || uas->tag[tag].done)
+			return -EPROTO;
+		t = &uas->tag[tag];
+
+		switch (iu->iu_id) {
+		case UAS_IU_ID_READ_READY:
+		case UAS_IU_ID_WRITE_READY:
+			if (t->write != (iu->iu_id == UAS_IU_ID_WRITE_READY))
+				return -EPROTO;
+			pipe = t->write ? uas->data_out_pipe : uas->data_in_pipe;
+			ret = usb_bulk_msg(udev, pipe, t->data, t->datalen,
+					   &t->act_len, UAS_TIMEOUT);
+			if (ret)
+				return ret;
+			break;
+		case UAS_IU_ID_STATUS:
+			memcpy(&uas->iu[tag].sense, iu, min_t(int, len,
+							      sizeof(*iu)));
+			t->done = true;
+			left--;
+			break;
+		case UAS_IU_ID_RESPONSE:
+			log_debug("Tag %d rejected, response code %x\n", tag,
+				  ((struct uas_response_iu *)iu)->response_code);
+			return -EPROTO;
+		default:
+			return -EPROTO;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Runs commands using streams: the status and data transfers of each tag are
+ * queued on its stream before the command IUs, and the device picks between
+ * the streams as it goes
+ */
+static int uas_run_streams(struct usb_uas *uas, int count)
+{
+	struct usb_bulk_req *req;
+	struct uas_tag *t;
+	int tag, num, i;
+	int ret;
+
+	num = 0;
+	for (tag = 1; tag <= count; tag++) {
+		t = &uas->tag[tag];
+		uas_req(&uas->reqs[num++], uas->status_pipe, &uas->iu[tag].sense,
+			sizeof(struct uas_sense_iu), tag);
+		if (t->datalen)
+			uas_req(&uas->reqs[num++], t->write ? uas->data_out_pipe :
+				uas->data_in_pipe, t->data, t->datalen, tag);
+	}
+	for (tag = 1; tag <= count; tag++)
+		uas_req(&uas->reqs[num++], uas->cmd_pipe, &uas->iu[tag].cmd,
+			sizeof(struct uas_cmd_iu), 0);
+	ret = usb_bulk_msgs(uas->udev, uas->reqs, num, UAS_TIMEOUT);
+
+	/* Pick up how far each command got, even if another one failed */
+	for (i = 0; i < num; i++) {
+		req = &uas->reqs[i];
+		if (req->status || !req->stream)
+			continue;
+		t = &uas->tag[req->stream];
+		if (req->pipe == uas->status_pipe) {
+			struct uas_sense_iu *iu = req->buffer;
+
+			t->done = iu->iu_id == UAS_IU_ID_STATUS &&
+				be16_to_cpu(iu->tag) == req->stream;
+		} else {
+			t->act_len = req->act_len;
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * uas_status() - Check how a command finished
+ *
+ * @uas: UAS state
+ * @tag: Tag of the command
+ * Return: 0 if it finished with GOOD status, -EREMOTEIO if with another
+ * status, -EIO if it did not finish
+ */
+static int uas_status(struct usb_uas *uas, int tag)
+{
+	if (!uas->tag[tag].done)
+		return -EIO;
+	if (uas->iu[tag].sense.status != UAS_STATUS_GOOD)
+		return -EREMOTEIO;
+
+	return 0;
+}
+
+int usb_uas_command(struct usb_uas *uas, struct scsi_cmd *srb, bool write)
+{
+	struct uas_sense_iu *iu = &uas->iu[1].sense;
+	int ret;
+
+	uas_prep(uas, 1, srb->lun, srb->cmd, srb->cmdlen, srb->pdata,
+		 srb->datalen, write);
+	ret = uas->streams ? uas_run_streams(uas, 1) : uas_run_ready(uas, 1);
+	if (ret)
+		return ret;
+	ret = uas_status(uas, 1);
+	srb->status = iu->status;
+	srb->trans_bytes = uas->tag[1].act_len;
+	if (ret == -EREMOTEIO)
+		memcpy(srb->sense_buf, iu->sense,
+		       min_t(int, be16_to_cpu(iu->len), sizeof(srb->sense_buf)));
+
+	return ret;
+}
+
+lbaint_t usb_uas_rw(struct usb_uas *uas, int lun, bool write, lbaint_t start,
+		    lbaint_t blkcnt, uint blksz, uint max_blks, void *buffer)
+{
+	lbaint_t done = 0, pos;
+	struct uas_tag *t;
+	int count, tag;
+	int ret;
+
+	max_blks = min(max_blks, 0xffffU);
+	while (done < blkcnt) {
+		/* Fill the queue with commands */
+		pos = done;
+		for (tag = 1; tag <= uas->qdepth && pos < blkcnt; tag++) {
+			uint blks = min_t(lbaint_t, blkcnt - pos, max_blks);
+			u8 cdb[10];
+
+			memset(cdb, '\0', sizeof(cdb));
+			cdb[0] = write ? SCSI_WRITE10 : SCSI_READ10;
+			put_unaligned_be32(start + pos, &cdb[2]);
+			put_unaligned_be16(blks, &cdb[7]);
+			uas_prep(uas, tag, lun, cdb, sizeof(cdb),
+				 buffer + pos * blksz, blks * blksz, write);
+			uas->tag[tag].blks = blks;
+			pos += blks;
+		}
+		count = tag - 1;
+
+		ret = uas->streams ? uas_run_streams(uas, count) :
+			uas_run_ready(uas, count);
+		for (tag = 1; tag <= count; tag++) {
+			t = &uas->tag[tag];
+			if (uas_status(uas, tag) || t->act_len != t->datalen)
+				break;
+			done += t->blks;
+		}
+		if (ret || tag <= count) {
+			log_debug("Stopped at block " LBAF " (err=%d)\n",
+				  start + done, ret);
+			break;
+		}
+	}
+
+	return done;
+}
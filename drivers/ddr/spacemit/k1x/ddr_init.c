@@ -11,12 +11,14 @@
 #include <fdtdec.h>
 #include <init.h>
 #include <log.h>
+#include <mapmem.h>
 #include <ram.h>
 #include <asm/cache.h>
 #include <asm/global_data.h>
 #include <asm/io.h>
 #include <dm/device_compat.h>
 #include <linux/sizes.h>
+#include <u-boot/crc.h>
 #ifdef CONFIG_K1_X_BOARD_FPGA
 #include "ddr_init_fpga.h"
 #endif
@@ -26,12 +28,16 @@
 #define DDR_CHECK_CNT			(0x1000)
 #define TOP_DDR_NUM				1
 
+/* Size of the parameters produced by software training */
+#define DDR_TRAINING_PARA_SIZE		1024
+
 extern u32 ddr_cs_num;
 extern const char *ddr_type;
 extern int ddr_freq_change(u32 data_rate);
 extern void qos_set_default(void);
 
 u32 ddr_datarate;
+u64 ddr_chip_id;
 
 static int test_pattern(fdt_addr_t base, fdt_size_t size)
 {
@@ -119,7 +125,62 @@ ERR_HANDLE:
 }
 
 #ifdef CONFIG_K1_X_BOARD_ASIC
-extern void lpddr4_silicon_init(uint32_t base, const char *ddr_type, uint32_t data_rate);
+extern void lpddr4_silicon_init(uint32_t base, const char *ddr_type,
+				uint32_t data_rate, void *para);
+
+static void spacemit_ddr_silicon_init(struct udevice *dev, void *para)
+{
+	ulong start = get_timer(0);
+
+	lpddr4_silicon_init(dev_read_addr(dev), ddr_type, ddr_datarate, para);
+	printf("lpddr4_silicon_init consume %ldms\n", get_timer(start));
+}
+
+static int spacemit_ddr_get_train_key(struct udevice *dev,
+				      struct ram_train_key *key)
+{
+	key->chip_id = ddr_chip_id;
+	key->package_id = (u64)crc32(0, (const uchar *)ddr_type,
+				     strlen(ddr_type)) << 32 | ddr_cs_num;
+	key->data_rate = ddr_datarate;
+	key->version = DDR_TRAINING_INFO_VER;
+
+	return 0;
+}
+
+/* Full training starts from zeroed parameters and fills them in */
+static int spacemit_ddr_train(struct udevice *dev, void *data, int size)
+{
+	if (size < DDR_TRAINING_PARA_SIZE)
+		return -ENOSPC;
+	memset(data, '\0', DDR_TRAINING_PARA_SIZE);
+	spacemit_ddr_silicon_init(dev, data);
+
+	return DDR_TRAINING_PARA_SIZE;
+}
+
+/* Saved parameters let the training code skip the slow search */
+static int spacemit_ddr_restore(struct udevice *dev, const void *data,
+				int size)
+{
+	if (size != DDR_TRAINING_PARA_SIZE)
+		return -EINVAL;
+	spacemit_ddr_silicon_init(dev, (void *)data);
+
+	return 0;
+}
+
+static int spacemit_ddr_verify(struct udevice *dev)
+{
+	return test_pattern(CONFIG_SYS_SDRAM_BASE, DDR_CHECK_SIZE) ? -EIO : 0;
+}
+
+static const struct ram_ops spacemit_ddr_ops = {
+	.get_train_key	= spacemit_ddr_get_train_key,
+	.train		= spacemit_ddr_train,
+	.restore	= spacemit_ddr_restore,
+	.verify		= spacemit_ddr_verify,
+};
 #endif
 
 static int spacemit_ddr_probe(struct udevice *dev)
@@ -128,13 +189,7 @@ static int spacemit_ddr_probe(struct udevice *dev)
 
 #ifdef CONFIG_K1_X_BOARD_FPGA
 	void (*ddr_init)(void);
-#else
-	fdt_addr_t ddrc_base;
-
-	ddrc_base = dev_read_addr(dev);
-#endif
 
-#ifdef CONFIG_K1_X_BOARD_FPGA
 	ddr_init = (void(*)(void))(lpddr4_init_fpga_data + 0x144);
 	ddr_init();
 #else
@@ -158,11 +213,17 @@ static int spacemit_ddr_probe(struct udevice *dev)
 	}
 	printf("DDR type %s\n", ddr_type);
 
-	/* init dram */
-	uint64_t start = get_timer(0);
-	lpddr4_silicon_init(ddrc_base, ddr_type, ddr_datarate);
-	start = get_timer(start);
-	printf("lpddr4_silicon_init consume %lldms\n", start);
+	/* init dram, restoring the saved training result if possible */
+	ret = ram_train(dev);
+	if (ret == -ENOSYS) {
+		struct ddr_training_info_t *info;
+
+		info = map_sysmem(DDR_TRAINING_INFO_BUFF, 0);
+		spacemit_ddr_silicon_init(dev, info->para);
+	} else if (ret) {
+		pr_err("dram training failed: %d\n", ret);
+		return ret;
+	}
 #endif
 	ddr_freq_change(ddr_datarate);
 
@@ -189,4 +250,7 @@ U_BOOT_DRIVER(spacemit_ddr) = {
 	.id = UCLASS_RAM,
 	.of_match = spacemit_ddr_ids,
 	.probe = spacemit_ddr_probe,
+#ifdef CONFIG_K1_X_BOARD_ASIC
+	.ops = &spacemit_ddr_ops,
+#endif
 };
@@ -1198,14 +1198,13 @@ static void top_training_fp_all(u32 ddr_base, u32 cs_num, u32 boot_pp, void *inp
 	training(to_traning_param);
 }
 
-void lpddr4_silicon_init(u32 ddr_base, const char *ddr_type, u32 data_rate)
+void lpddr4_silicon_init(u32 ddr_base, const char *ddr_type, u32 data_rate,
+			 void *para)
 {
 	u32 fp=0;
 	u32 size_mb, mr8_value, cs_num;;
-	struct ddr_training_info_t *info;
 
 	cs_num = ddr_cs_num;
-	info = (struct ddr_training_info_t*)map_sysmem(DDR_TRAINING_INFO_BUFF, 0);
 	top_Common_config();
 
 	if (0 == strcasecmp(ddr_type, "LPDDR4"))
@@ -1225,15 +1224,15 @@ void lpddr4_silicon_init(u32 ddr_base, const char *ddr_type, u32 data_rate)
 	ddr_dfc_table_init(0xF0000000, size_mb);
 	init_table_mc_a0(0xF0000000);
 
-	top_training_fp_all(ddr_base, cs_num, 0, info->para);
+	top_training_fp_all(ddr_base, cs_num, 0, para);
 
 	fp=1;
 	ddr_dfc(fp);
-	top_training_fp_all(ddr_base, cs_num, fp, info->para);
+	top_training_fp_all(ddr_base, cs_num, fp, para);
 
 	fp=2;
 	ddr_dfc(fp);
-	top_training_fp_all(ddr_base, cs_num, fp, info->para);
+	top_training_fp_all(ddr_base, cs_num, fp, para);
 	if (16384 == size_mb)
 		REG32(ddr_base + 0x24) = (0x10020095 | (3 << 24)); //bit7 MR21 RFU
 
@@ -174,9 +174,35 @@ static lbaint_t fb_mmc_sparse_erase(struct sparse_storage *info,
 static lbaint_t fb_mmc_sparse_reserve(struct sparse_storage *info,
 		lbaint_t blk, lbaint_t blkcnt)
 {
+	struct fb_mmc_sparse *sparse = info->priv;
+	struct blk_desc *dev_desc = sparse->dev_desc;
+	struct mmc *mmc;
+
+	if (!IS_ENABLED(CONFIG_FASTBOOT_MMC_SPARSE_DISCARD))
+		return blkcnt;
+
+	/*
+	 * Nothing is written to don't-care blocks, so let the card drop what
+	 * they hold. Small ranges are not worth the extra commands.
+	 */
+	mmc = find_mmc_device(dev_desc->devnum);
+	if (mmc && blkcnt >= mmc->erase_grp_size)
+		mmc_discard(dev_desc, blk, blkcnt);
+
 	return blkcnt;
 }
 
+/* Wait for the card to finish programming an image before reporting back */
+static void fb_mmc_write_done(struct blk_desc *dev_desc, char *response)
+{
+	struct mmc *mmc = find_mmc_device(dev_desc->devnum);
+
+	if (mmc && mmc_wait_write_done(mmc)) {
+		pr_err("failed writing to device %d\n", dev_desc->devnum);
+		fastboot_fail("failed writing to device", response);
+	}
+}
+
 static void write_raw_image(struct blk_desc *dev_desc,
 			    struct disk_partition *info, const char *part_name,
 			    void *buffer, u32 download_bytes, char *response)
@@ -760,6 +786,7 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 #endif
 		part_offset_t += download_bytes;
 	}
+	fb_mmc_write_done(dev_desc, response);
 }
 
 /**
@@ -810,19 +837,31 @@ void fastboot_mmc_erase(const char *cmd, char *response)
 	if (fastboot_mmc_get_part_info(cmd, &dev_desc, &info, response) < 0)
 		return;
 
-	/* Align blocks to erase group size to avoid erasing other partitions */
-	grp_size = mmc->erase_grp_size;
-	blks_start = (info.start + grp_size - 1) & ~(grp_size - 1);
-	if (info.size >= grp_size)
-		blks_size = (info.size - (blks_start - info.start)) &
-				(~(grp_size - 1));
-	else
-		blks_size = 0;
+	if (IS_ENABLED(CONFIG_FASTBOOT_MMC_ERASE_TRIM) && mmc_can_trim(mmc)) {
+		/* TRIM needs no alignment, so erase the whole partition */
+		blks_start = info.start;
+		blks_size = info.size;
+		if (fastboot_progress_callback)
+			fastboot_progress_callback("erasing");
+		blks = mmc_trim(dev_desc, blks_start, blks_size) ? 0 : blks_size;
+	} else {
+		/*
+		 * Align blocks to erase group size to avoid erasing other
+		 * partitions
+		 */
+		grp_size = mmc->erase_grp_size;
+		blks_start = (info.start + grp_size - 1) & ~(grp_size - 1);
+		if (info.size >= grp_size)
+			blks_size = (info.size - (blks_start - info.start)) &
+					(~(grp_size - 1));
+		else
+			blks_size = 0;
 
-	printf("Erasing blocks " LBAFU " to " LBAFU " due to alignment\n",
-	       blks_start, blks_start + blks_size);
+		printf("Erasing blocks " LBAFU " to " LBAFU " due to alignment\n",
+		       blks_start, blks_start + blks_size);
 
-	blks = fb_mmc_blk_write(dev_desc, blks_start, blks_size, NULL);
+		blks = fb_mmc_blk_write(dev_desc, blks_start, blks_size, NULL);
+	}
 
 	if (blks != blks_size) {
 		pr_err("failed erasing from device %d\n", dev_desc->devnum);
@@ -279,6 +279,40 @@ int spacemit_set_sdh_74_clk(struct udevice *dev)
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(MMC_HS400_SUPPORT) || \
+    CONFIG_IS_ENABLED(MMC_HS400_ES_SUPPORT)
+/* The data strobe used in HS400 modes is sampled through the PHY DLL */
+static int spacemit_sdhci_phy_dll_init(struct sdhci_host *host)
+{
+	u32 reg;
+	int i;
+
+	/* config dll_reg1 & dll_reg2 */
+	reg = sdhci_readl(host, SDHC_PHY_DLLCFG);
+	reg |= (DLL_PREDLY_NUM | DLL_FULLDLY_RANGE | DLL_VREG_CTRL);
+	sdhci_writel(host, reg, SDHC_PHY_DLLCFG);
+
+	reg = sdhci_readl(host, SDHC_PHY_DLLCFG1);
+	reg |= (DLL_REG1_CTRL & DLL_REG1_CTRL_MASK);
+	sdhci_writel(host, reg, SDHC_PHY_DLLCFG1);
+
+	/* dll enable */
+	reg = sdhci_readl(host, SDHC_PHY_DLLCFG);
+	reg |= DLL_ENABLE;
+	sdhci_writel(host, reg, SDHC_PHY_DLLCFG);
+
+	/* wait dll lock */
+	for (i = 0; i < 100; i++) {
+		if (sdhci_readl(host, SDHC_PHY_DLLSTS) & DLL_LOCK_STATE)
+			return 0;
+		udelay(10);
+	}
+	pr_err("%s: phy dll lock timeout\n", host->name);
+
+	return -ETIMEDOUT;
+}
+#endif
+
 void spacemit_sdhci_set_control_reg(struct sdhci_host *host)
 {
 	struct mmc *mmc = (struct mmc *)host->mmc;
@@ -316,6 +350,9 @@ void spacemit_sdhci_set_control_reg(struct sdhci_host *host)
 	    (mmc->selected_mode == MMC_HS_400_ES)) {
 		reg = sdhci_readw(host, SDHC_MMC_CTRL_REG);
 		reg |= (mmc->selected_mode == MMC_HS_200) ? MMC_HS200 : MMC_HS400;
+		/* Enhanced strobe is only used in HS400ES mode */
+		if (mmc->selected_mode != MMC_HS_400_ES)
+			reg &= ~ENHANCE_STROBE_EN;
 		sdhci_writew(host, reg, SDHC_MMC_CTRL_REG);
 	} else {
 		reg = sdhci_readw(host, SDHC_MMC_CTRL_REG);
@@ -324,41 +361,21 @@ void spacemit_sdhci_set_control_reg(struct sdhci_host *host)
 	}
 }
 
-#if CONFIG_IS_ENABLED(MMC_HS400_ES_SUPPORT)
-static int spacemit_sdhci_phy_dll_init(struct sdhci_host *host)
+#if CONFIG_IS_ENABLED(MMC_HS400_SUPPORT)
+/*
+ * Lock the DLL once the HS400 clock is running. This is done here rather
+ * than in set_control_reg() so that a failure to lock fails the mode switch.
+ */
+static int spacemit_sdhci_set_ios_post(struct sdhci_host *host)
 {
-	u32 reg;
-	int i;
-
-	/* config dll_reg1 & dll_reg2 */
-	reg = sdhci_readl(host, SDHC_PHY_DLLCFG);
-	reg |= (DLL_PREDLY_NUM | DLL_FULLDLY_RANGE | DLL_VREG_CTRL);
-	sdhci_writel(host, reg, SDHC_PHY_DLLCFG);
-
-	reg = sdhci_readl(host, SDHC_PHY_DLLCFG1);
-	reg |= (DLL_REG1_CTRL & DLL_REG1_CTRL_MASK);
-	sdhci_writel(host, reg, SDHC_PHY_DLLCFG1);
-
-	/* dll enable */
-	reg = sdhci_readl(host, SDHC_PHY_DLLCFG);
-	reg |= DLL_ENABLE;
-	sdhci_writel(host, reg, SDHC_PHY_DLLCFG);
-
-	/* wait dll lock */
-	i = 0;
-	while (i++ < 100) {
-		if (sdhci_readl(host, SDHC_PHY_DLLSTS) & DLL_LOCK_STATE)
-			break;
-		udelay(10);
-	}
-	if (i == 100) {
-		pr_err("%s: phy dll lock timeout\n", host->name);
-		return 1;
-	}
+	if (host->mmc->selected_mode == MMC_HS_400)
+		return spacemit_sdhci_phy_dll_init(host);
 
 	return 0;
 }
+#endif
 
+#if CONFIG_IS_ENABLED(MMC_HS400_ES_SUPPORT)
 static int spacemit_sdhci_hs400_enhanced_strobe(struct sdhci_host *host)
 {
 	u32 reg;
@@ -371,6 +388,28 @@ static int spacemit_sdhci_hs400_enhanced_strobe(struct sdhci_host *host)
 }
 #endif
 
+#ifdef MMC_SUPPORTS_TUNING
+/* Tuning leaves its result in the receive clock and delay-line settings */
+static int spacemit_sdhci_get_tuning(struct sdhci_host *host, u32 *tuning)
+{
+	tuning[0] = sdhci_readl(host, SDHC_RX_CFG_REG);
+	tuning[1] = sdhci_readl(host, SDHC_DLINE_CTRL_REG);
+	tuning[2] = sdhci_readl(host, SDHC_DLINE_CFG_REG);
+
+	return 0;
+}
+
+static int spacemit_sdhci_set_tuning(struct sdhci_host *host,
+				     const u32 *tuning)
+{
+	sdhci_writel(host, tuning[0], SDHC_RX_CFG_REG);
+	sdhci_writel(host, tuning[2], SDHC_DLINE_CFG_REG);
+	sdhci_writel(host, tuning[1], SDHC_DLINE_CTRL_REG);
+
+	return 0;
+}
+#endif
+
 static int spacemit_sdhci_probe(struct udevice *dev)
 {
 	struct spacemit_sdhci_driver_data *drv_data =
@@ -482,9 +521,16 @@ static int spacemit_sdhci_bind(struct udevice *dev)
 
 const struct sdhci_ops spacemit_sdhci_ops = {
 	.set_control_reg = spacemit_sdhci_set_control_reg,
+#if CONFIG_IS_ENABLED(MMC_HS400_SUPPORT)
+	.set_ios_post = spacemit_sdhci_set_ios_post,
+#endif
 #if CONFIG_IS_ENABLED(MMC_HS400_ES_SUPPORT)
 	.set_enhanced_strobe = spacemit_sdhci_hs400_enhanced_strobe,
 #endif
+#ifdef MMC_SUPPORTS_TUNING
+	.get_tuning = spacemit_sdhci_get_tuning,
+	.set_tuning = spacemit_sdhci_set_tuning,
+#endif
 };
 
 const struct spacemit_sdhci_driver_data spacemit_sdhci_drv_data = {
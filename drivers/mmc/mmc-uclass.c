@@ -41,6 +41,9 @@ static int dm_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 	struct dm_mmc_ops *ops = mmc_get_ops(dev);
 	int ret;
 
+	ret = mmc_wait_before_cmd(mmc, cmd);
+	if (ret)
+		return ret;
 	mmmc_trace_before_send(mmc, cmd);
 	if (ops->send_cmd)
 		ret = ops->send_cmd(dev, cmd, data);
@@ -126,6 +129,34 @@ int mmc_execute_tuning(struct mmc *mmc, uint opcode)
 {
 	return dm_mmc_execute_tuning(mmc->dev, opcode);
 }
+
+static int dm_mmc_get_tuning(struct udevice *dev, u32 *tuning)
+{
+	struct dm_mmc_ops *ops = mmc_get_ops(dev);
+
+	if (!ops->get_tuning)
+		return -ENOSYS;
+	return ops->get_tuning(dev, tuning);
+}
+
+int mmc_get_tuning(struct mmc *mmc, u32 *tuning)
+{
+	return dm_mmc_get_tuning(mmc->dev, tuning);
+}
+
+static int dm_mmc_set_tuning(struct udevice *dev, const u32 *tuning)
+{
+	struct dm_mmc_ops *ops = mmc_get_ops(dev);
+
+	if (!ops->set_tuning)
+		return -ENOSYS;
+	return ops->set_tuning(dev, tuning);
+}
+
+int mmc_set_tuning(struct mmc *mmc, const u32 *tuning)
+{
+	return dm_mmc_set_tuning(mmc->dev, tuning);
+}
 #endif
 
 #if CONFIG_IS_ENABLED(MMC_HS400_ES_SUPPORT)
@@ -542,9 +573,47 @@ U_BOOT_DRIVER(mmc_blk) = {
 #endif /* CONFIG_BLK */
 
 
+#if CONFIG_IS_ENABLED(MMC_WRITE_DEFER_BUSY)
+int mmc_wait_writes_done(void)
+{
+	struct udevice *dev;
+	struct uclass *uc;
+	int ret = 0, err;
+
+	uclass_id_foreach_dev(UCLASS_MMC, dev, uc) {
+		struct mmc *mmc = mmc_get_mmc_dev(dev);
+
+		if (!mmc)
+			continue;
+		err = mmc_wait_write_done(mmc);
+		if (err) {
+			log_err("%s: Write did not complete (err=%d)\n",
+				dev->name, err);
+			ret = err;
+		}
+	}
+
+	return ret;
+}
+
+/* The card may lose power once the host is removed, so let it finish */
+static int mmc_pre_remove(struct udevice *dev)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+
+	if (mmc)
+		mmc_wait_write_done(mmc);
+
+	return 0;
+}
+#endif
+
 UCLASS_DRIVER(mmc) = {
 	.id		= UCLASS_MMC,
 	.name		= "mmc",
 	.flags		= DM_UC_FLAG_SEQ_ALIAS,
+#if CONFIG_IS_ENABLED(MMC_WRITE_DEFER_BUSY)
+	.pre_remove	= mmc_pre_remove,
+#endif
 	.per_device_auto	= sizeof(struct mmc_uclass_priv),
 };
@@ -30,6 +30,15 @@
 
 static int mmc_set_signal_voltage(struct mmc *mmc, uint signal_voltage);
 
+#if CONFIG_IS_ENABLED(MMC_MODE_FALLBACK)
+static int mmc_fall_back(struct mmc *mmc);
+#else
+static inline int mmc_fall_back(struct mmc *mmc)
+{
+	return -ENOSYS;
+}
+#endif
+
 #if !CONFIG_IS_ENABLED(DM_MMC)
 
 static int mmc_wait_dat0(struct mmc *mmc, int state, int timeout_us)
@@ -203,6 +212,9 @@ int mmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd, struct mmc_data *data)
 {
 	int ret;
 
+	ret = mmc_wait_before_cmd(mmc, cmd);
+	if (ret)
+		return ret;
 	mmmc_trace_before_send(mmc, cmd);
 	ret = mmc->cfg->ops->send_cmd(mmc, cmd, data);
 	mmmc_trace_after_send(mmc, cmd, ret);
@@ -314,6 +326,17 @@ int mmc_poll_for_busy(struct mmc *mmc, int timeout_ms)
 	return 0;
 }
 
+int mmc_send_stop(struct mmc *mmc)
+{
+	struct mmc_cmd cmd;
+
+	cmd.cmdidx = MMC_CMD_STOP_TRANSMISSION;
+	cmd.cmdarg = 0;
+	cmd.resp_type = MMC_RSP_R1b;
+
+	return mmc_send_cmd(mmc, &cmd, NULL);
+}
+
 int mmc_set_blocklen(struct mmc *mmc, int len)
 {
 	struct mmc_cmd cmd;
@@ -399,21 +422,27 @@ int mmc_send_tuning(struct mmc *mmc, u32 opcode, int *cmd_error)
 }
 #endif
 
+/*
+ * Read blocks from the card. This returns -EREMOTEIO if the card reports an
+ * error with the data itself, as opposed to an error on the bus.
+ */
 static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
 			   lbaint_t blkcnt)
 {
 	struct mmc_cmd cmd;
 	struct mmc_data data;
+	int err;
 
-	if (blkcnt > 1){
+	if (blkcnt > 1 && blkcnt <= MMC_SET_BLOCK_COUNT_MAX) {
 		cmd.cmdidx = MMC_CMD_SET_BLOCK_COUNT;
-		cmd.cmdarg = blkcnt & 0x0000FFFF;
+		cmd.cmdarg = blkcnt;
 		cmd.resp_type = MMC_RSP_R1;
-		if (mmc_send_cmd(mmc, &cmd, NULL)) {
+		err = mmc_send_cmd(mmc, &cmd, NULL);
+		if (err) {
 #if !defined(CONFIG_SPL_BUILD) || defined(CONFIG_SPL_LIBCOMMON_SUPPORT)
 			pr_err("mmc fail to set block count\n");
 #endif
-			return 0;
+			return err;
 		}
 	}
 
@@ -434,10 +463,24 @@ static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
 	data.blocksize = mmc->read_bl_len;
 	data.flags = MMC_DATA_READ;
 
-	if (mmc_send_cmd(mmc, &cmd, &data))
-		return 0;
+	err = mmc_send_cmd(mmc, &cmd, &data);
+	if (err)
+		return err;
+	if (!mmc_host_is_spi(mmc) && (cmd.response[0] & MMC_STATUS_MEDIA_ERROR))
+		return -EREMOTEIO;
 
-	return blkcnt;
+	if (blkcnt > MMC_SET_BLOCK_COUNT_MAX && !mmc_host_is_spi(mmc)) {
+		err = mmc_send_stop(mmc);
+		if (err) {
+#if !defined(CONFIG_SPL_BUILD) || defined(CONFIG_SPL_LIBCOMMON_SUPPORT)
+			pr_err("mmc fail to send stop cmd\n");
+#endif
+			return err;
+		}
+	}
+	mmc_xfer_record(mmc, blkcnt);
+
+	return 0;
 }
 
 #if !CONFIG_IS_ENABLED(DM_MMC)
@@ -464,6 +507,7 @@ ulong mmc_bread(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 	int err;
 	lbaint_t cur, blocks_todo = blkcnt;
 	uint b_max;
+	u64 start_us;
 
 	if (blkcnt == 0)
 		return 0;
@@ -494,17 +538,26 @@ ulong mmc_bread(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 	}
 
 	b_max = mmc_get_b_max(mmc, dst, blkcnt);
+	start_us = timer_get_us();
 
 	do {
 		cur = (blocks_todo > b_max) ? b_max : blocks_todo;
-		if (mmc_read_blocks(mmc, dst, start, cur) != cur) {
+		err = mmc_read_blocks(mmc, dst, start, cur);
+		if (err) {
 			pr_debug("%s: Failed to read blocks\n", __func__);
-			return 0;
+			/*
+			 * Try again in a slower mode, if there is one. This
+			 * does not help if the card cannot read the data.
+			 */
+			if (err == -EREMOTEIO || mmc_fall_back(mmc))
+				return 0;
+			continue;
 		}
 		blocks_todo -= cur;
 		start += cur;
 		dst += cur * mmc->read_bl_len;
 	} while (blocks_todo > 0);
+	mmc_read_record(mmc, blkcnt, timer_get_us() - start_us);
 
 	return blkcnt;
 }
@@ -1650,6 +1703,26 @@ static int mmc_set_bus_width(struct mmc *mmc, uint width)
 	return mmc_set_ios(mmc);
 }
 
+/* State of the card on an earlier boot, if it is being used to set it up */
+static inline const struct mmc_state *mmc_init_hint(struct mmc *mmc)
+{
+#if CONFIG_IS_ENABLED(MMC_STATE_CACHE)
+	return mmc->init_hint;
+#else
+	return NULL;
+#endif
+}
+
+/* Bus modes which gave errors on this card, see mmc_fall_back() */
+static inline uint mmc_bad_caps(struct mmc *mmc)
+{
+#if CONFIG_IS_ENABLED(MMC_MODE_FALLBACK)
+	return mmc->bad_caps;
+#else
+	return 0;
+#endif
+}
+
 #if CONFIG_IS_ENABLED(MMC_VERBOSE) || defined(DEBUG)
 /*
  * helper function to display the capabilities in a human
@@ -1717,6 +1790,23 @@ static inline int mmc_set_signal_voltage(struct mmc *mmc, uint signal_voltage)
 #endif
 
 #if !CONFIG_IS_ENABLED(MMC_TINY)
+#ifdef MMC_SUPPORTS_TUNING
+/* Tune the host, or use the tuning found on an earlier boot if there is one */
+static int mmc_tune(struct mmc *mmc, uint opcode)
+{
+#if CONFIG_IS_ENABLED(MMC_STATE_CACHE)
+	const struct mmc_state *hint = mmc->init_hint;
+
+	/* The read done after selecting the mode shows whether this works */
+	if (hint && (hint->flags & MMC_STATE_TUNING) &&
+	    !mmc_set_tuning(mmc, hint->tuning))
+		return 0;
+#endif
+
+	return mmc_execute_tuning(mmc, opcode);
+}
+#endif
+
 static const struct mode_width_tuning sd_modes_by_pref[] = {
 #if CONFIG_IS_ENABLED(MMC_UHS_SUPPORT)
 #ifdef MMC_SUPPORTS_TUNING
@@ -1791,9 +1881,12 @@ static int sd_select_mode_and_width(struct mmc *mmc, uint card_caps)
 	}
 
 #if CONFIG_IS_ENABLED(MMC_WRITE)
-	err = sd_read_ssr(mmc);
-	if (err)
-		pr_warn("unable to read ssr\n");
+	/* The SSR of a card set up on an earlier boot is already known */
+	if (!mmc_init_hint(mmc)) {
+		err = sd_read_ssr(mmc);
+		if (err)
+			pr_warn("unable to read ssr\n");
+	}
 #endif
 
 	/* Restrict card's capabilities by what the host can do */
@@ -1831,8 +1924,7 @@ static int sd_select_mode_and_width(struct mmc *mmc, uint card_caps)
 #ifdef MMC_SUPPORTS_TUNING
 				/* execute tuning if needed */
 				if (mwt->tuning && !mmc_host_is_spi(mmc)) {
-					err = mmc_execute_tuning(mmc,
-								 mwt->tuning);
+					err = mmc_tune(mmc, mwt->tuning);
 					if (err) {
 						pr_debug("tuning failed\n");
 						goto error;
@@ -2012,7 +2104,7 @@ static int mmc_select_hs400(struct mmc *mmc)
 
 	/* execute tuning if needed */
 	mmc->hs400_tuning = 1;
-	err = mmc_execute_tuning(mmc, MMC_CMD_SEND_TUNING_BLOCK_HS200);
+	err = mmc_tune(mmc, MMC_CMD_SEND_TUNING_BLOCK_HS200);
 	mmc->hs400_tuning = 0;
 	if (err) {
 		debug("tuning failed\n");
@@ -2205,8 +2297,7 @@ static int mmc_select_mode_and_width(struct mmc *mmc, uint card_caps)
 
 				/* execute tuning if needed */
 				if (mwt->tuning) {
-					err = mmc_execute_tuning(mmc,
-								 mwt->tuning);
+					err = mmc_tune(mmc, mwt->tuning);
 					if (err) {
 						pr_debug("tuning failed : %d\n", err);
 						goto error;
@@ -2233,6 +2324,47 @@ error:
 
 	return -ENOTSUPP;
 }
+
+#if CONFIG_IS_ENABLED(MMC_MODE_FALLBACK)
+/*
+ * Stop using the current bus mode after a bus error, such as a CRC error or
+ * timeout, and select the next best one, e.g. HS400ES -> HS400 -> HS200 ->
+ * DDR52 for an eMMC
+ */
+static int mmc_fall_back(struct mmc *mmc)
+{
+	enum bus_mode mode = mmc->selected_mode;
+	uint caps;
+	int err;
+
+	if (mode == MMC_LEGACY || mmc_host_is_spi(mmc))
+		return -ENOTSUPP;
+	mmc->bad_caps |= MMC_CAP(mode);
+	caps = mmc->card_caps & ~mmc->bad_caps;
+	log_warning("%s: Errors in %s mode, trying a slower one\n",
+		    mmc->cfg->name, mmc_mode_name(mode));
+
+	err = mmc_wait_write_done(mmc);
+	if (!err) {
+		if (IS_SD(mmc))
+			err = sd_select_mode_and_width(mmc, caps);
+		else
+			err = mmc_select_mode_and_width(mmc, caps);
+	}
+	if (err) {
+		/* Leave the card to be set up again from the start */
+		mmc->has_init = 0;
+		return err;
+	}
+	mmc->best_mode = mmc->selected_mode;
+#if CONFIG_IS_ENABLED(MMC_STATE_CACHE)
+	/* Record the mode which works, for the next boot */
+	mmc_cache_update(mmc);
+#endif
+
+	return 0;
+}
+#endif
 #endif
 
 #if CONFIG_IS_ENABLED(MMC_TINY)
@@ -2445,13 +2577,138 @@ error:
 	return err;
 }
 
+/* Fill in the block-device description once the card is set up */
+static void mmc_fill_blk_desc(struct mmc *mmc)
+{
+	struct blk_desc *bdesc;
+
+	bdesc = mmc_get_blk_desc(mmc);
+	bdesc->lun = 0;
+	bdesc->hwpart = 0;
+	bdesc->type = 0;
+	bdesc->blksz = mmc->read_bl_len;
+	bdesc->log2blksz = LOG2(bdesc->blksz);
+	bdesc->lba = lldiv(mmc->capacity, mmc->read_bl_len);
+#if !defined(CONFIG_SPL_BUILD) || \
+		(defined(CONFIG_SPL_LIBCOMMON_SUPPORT) && \
+		!CONFIG_IS_ENABLED(USE_TINY_PRINTF))
+	sprintf(bdesc->vendor, "Man %06x Snr %04x%04x",
+		mmc->cid[0] >> 24, (mmc->cid[2] & 0xffff),
+		(mmc->cid[3] >> 16) & 0xffff);
+	sprintf(bdesc->product, "%c%c%c%c%c%c", mmc->cid[0] & 0xff,
+		(mmc->cid[1] >> 24), (mmc->cid[1] >> 16) & 0xff,
+		(mmc->cid[1] >> 8) & 0xff, mmc->cid[1] & 0xff,
+		(mmc->cid[2] >> 24) & 0xff);
+	sprintf(bdesc->revision, "%d.%d", (mmc->cid[2] >> 20) & 0xf,
+		(mmc->cid[2] >> 16) & 0xf);
+#else
+	bdesc->vendor[0] = 0;
+	bdesc->product[0] = 0;
+	bdesc->revision[0] = 0;
+#endif
+
+#if !defined(CONFIG_DM_MMC) && (!defined(CONFIG_SPL_BUILD) || defined(CONFIG_SPL_LIBDISK_SUPPORT))
+	part_init(bdesc);
+#endif
+}
+
+#if CONFIG_IS_ENABLED(MMC_HANDOFF) || CONFIG_IS_ENABLED(MMC_STATE_CACHE)
+static u32 mmc_ext_csd_sec_count(const u8 *ext_csd)
+{
+	return ext_csd[EXT_CSD_SEC_CNT] |
+		ext_csd[EXT_CSD_SEC_CNT + 1] << 8 |
+		ext_csd[EXT_CSD_SEC_CNT + 2] << 16 |
+		ext_csd[EXT_CSD_SEC_CNT + 3] << 24;
+}
+#endif
+
+#if CONFIG_IS_ENABLED(MMC_STATE_CACHE)
+/*
+ * Check the state found by mmc_cache_find() against the EXT_CSD, since an
+ * eMMC may have been reconfigured since the state was recorded
+ */
+static const struct mmc_state *mmc_check_hint(struct mmc *mmc)
+{
+	const struct mmc_state *st = mmc->init_hint;
+
+	if (st && !IS_SD(mmc) && mmc->ext_csd &&
+	    (mmc->ext_csd[EXT_CSD_REV] != st->ext_csd_rev ||
+	     mmc_ext_csd_sec_count(mmc->ext_csd) != st->sec_count)) {
+		pr_debug("%s: EXT_CSD has changed\n", mmc->cfg->name);
+		mmc->init_hint = NULL;
+	}
+	if (st && (MMC_CAP(st->mode) & mmc_bad_caps(mmc)))
+		mmc->init_hint = NULL;
+
+	return mmc->init_hint;
+}
+
+/*
+ * Select the bus mode and width found on an earlier boot, instead of trying
+ * each one which the card and host support. For an SD card, the SCR, SSR
+ * and capabilities are taken from the cache rather than read again.
+ */
+static int mmc_select_cached_mode(struct mmc *mmc, const struct mmc_state *st)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(u8, buf, MMC_MAX_BLOCK_LEN);
+	uint caps = MMC_CAP(st->mode);
+	int err;
+
+	if (st->bus_width == 8)
+		caps |= MMC_MODE_8BIT;
+	else if (st->bus_width == 4)
+		caps |= MMC_MODE_4BIT;
+	else
+		caps |= MMC_MODE_1BIT;
+
+	if (!IS_SD(mmc)) {
+		err = mmc_get_capabilities(mmc);
+		if (err)
+			return err;
+
+		/* This checks the mode by reading the EXT_CSD again */
+		return mmc_select_mode_and_width(mmc, caps & mmc->card_caps);
+	}
+
+	mmc->version = st->version;
+	mmc->scr[0] = st->scr[0];
+	mmc->scr[1] = st->scr[1];
+	mmc->card_caps = st->card_caps;
+#if CONFIG_IS_ENABLED(MMC_WRITE)
+	mmc->ssr.au = st->ssr_au;
+	mmc->ssr.erase_timeout = st->ssr_erase_timeout;
+	mmc->ssr.erase_offset = st->ssr_erase_offset;
+#endif
+	err = sd_select_mode_and_width(mmc, caps & mmc->card_caps);
+	if (err)
+		return err;
+
+	/* Check the mode with a single read */
+	if (mmc_read_blocks(mmc, buf, 0, 1))
+		return -EIO;
+
+	return 0;
+}
+#else
+static inline const struct mmc_state *mmc_check_hint(struct mmc *mmc)
+{
+	return NULL;
+}
+
+static inline int mmc_select_cached_mode(struct mmc *mmc,
+					 const struct mmc_state *st)
+{
+	return -ENOSYS;
+}
+#endif
+
 static int mmc_startup(struct mmc *mmc)
 {
+	__maybe_unused const struct mmc_state *hint;
 	int err, i;
 	uint mult, freq;
 	u64 cmult, csize;
 	struct mmc_cmd cmd;
-	struct blk_desc *bdesc;
 
 #ifdef CONFIG_MMC_SPI_CRC_ON
 	if (mmc_host_is_spi(mmc)) { /* enable CRC check for spi */
@@ -2474,7 +2731,16 @@ static int mmc_startup(struct mmc *mmc)
 	if (err)
 		return err;
 
+#if CONFIG_IS_ENABLED(MMC_MODE_FALLBACK)
+	/* Bus modes which failed on another card may work on this one */
+	if (memcmp(mmc->cid, cmd.response, 16))
+		mmc->bad_caps = 0;
+#endif
 	memcpy(mmc->cid, cmd.response, 16);
+#if CONFIG_IS_ENABLED(MMC_STATE_CACHE)
+	/* Some steps are not needed if this card was set up on an earlier boot */
+	mmc->init_hint = mmc_cache_find(mmc);
+#endif
 
 	/*
 	 * For MMC cards, set the Relative Address.
@@ -2617,16 +2883,21 @@ static int mmc_startup(struct mmc *mmc)
 	mmc_select_mode(mmc, MMC_LEGACY);
 	mmc_set_bus_width(mmc, 1);
 #else
-	if (IS_SD(mmc)) {
+	hint = mmc_check_hint(mmc);
+	if (hint) {
+		err = mmc_select_cached_mode(mmc, hint);
+	} else if (IS_SD(mmc)) {
 		err = sd_get_capabilities(mmc);
 		if (err)
 			return err;
-		err = sd_select_mode_and_width(mmc, mmc->card_caps);
+		err = sd_select_mode_and_width(mmc, mmc->card_caps &
+					       ~mmc_bad_caps(mmc));
 	} else {
 		err = mmc_get_capabilities(mmc);
 		if (err)
 			return err;
-		err = mmc_select_mode_and_width(mmc, mmc->card_caps);
+		err = mmc_select_mode_and_width(mmc, mmc->card_caps &
+						~mmc_bad_caps(mmc));
 	}
 #endif
 	if (err)
@@ -2642,35 +2913,7 @@ static int mmc_startup(struct mmc *mmc)
 #endif
 	}
 
-	/* fill in device description */
-	bdesc = mmc_get_blk_desc(mmc);
-	bdesc->lun = 0;
-	bdesc->hwpart = 0;
-	bdesc->type = 0;
-	bdesc->blksz = mmc->read_bl_len;
-	bdesc->log2blksz = LOG2(bdesc->blksz);
-	bdesc->lba = lldiv(mmc->capacity, mmc->read_bl_len);
-#if !defined(CONFIG_SPL_BUILD) || \
-		(defined(CONFIG_SPL_LIBCOMMON_SUPPORT) && \
-		!CONFIG_IS_ENABLED(USE_TINY_PRINTF))
-	sprintf(bdesc->vendor, "Man %06x Snr %04x%04x",
-		mmc->cid[0] >> 24, (mmc->cid[2] & 0xffff),
-		(mmc->cid[3] >> 16) & 0xffff);
-	sprintf(bdesc->product, "%c%c%c%c%c%c", mmc->cid[0] & 0xff,
-		(mmc->cid[1] >> 24), (mmc->cid[1] >> 16) & 0xff,
-		(mmc->cid[1] >> 8) & 0xff, mmc->cid[1] & 0xff,
-		(mmc->cid[2] >> 24) & 0xff);
-	sprintf(bdesc->revision, "%d.%d", (mmc->cid[2] >> 20) & 0xf,
-		(mmc->cid[2] >> 16) & 0xf);
-#else
-	bdesc->vendor[0] = 0;
-	bdesc->product[0] = 0;
-	bdesc->revision[0] = 0;
-#endif
-
-#if !defined(CONFIG_DM_MMC) && (!defined(CONFIG_SPL_BUILD) || defined(CONFIG_SPL_LIBDISK_SUPPORT))
-	part_init(bdesc);
-#endif
+	mmc_fill_blk_desc(mmc);
 
 	return 0;
 }
@@ -2889,11 +3132,8 @@ retry:
 	return err;
 }
 
-int mmc_start_init(struct mmc *mmc)
+static int mmc_set_host_caps(struct mmc *mmc)
 {
-	bool no_card;
-	int err = 0;
-
 	/*
 	 * all hosts are capable of 1 bit bus-width and able to use the legacy
 	 * timings.
@@ -2918,6 +3158,21 @@ int mmc_start_init(struct mmc *mmc)
 			}
 		}
 	}
+
+	return 0;
+}
+
+int mmc_start_init(struct mmc *mmc)
+{
+	bool no_card;
+	int err;
+
+	/* Do not power-cycle the card while it is programming */
+	mmc_wait_write_done(mmc);
+
+	err = mmc_set_host_caps(mmc);
+	if (err)
+		return err;
 #if CONFIG_IS_ENABLED(DM_MMC)
 	mmc_deferred_probe(mmc);
 #endif
@@ -2932,6 +3187,9 @@ int mmc_start_init(struct mmc *mmc)
 #endif
 	if (no_card) {
 		mmc->has_init = 0;
+#if CONFIG_IS_ENABLED(MMC_MODE_FALLBACK)
+		mmc->bad_caps = 0;
+#endif
 #if !defined(CONFIG_SPL_BUILD) || defined(CONFIG_SPL_LIBCOMMON_SUPPORT)
 		pr_err("MMC: no card present\n");
 #endif
@@ -2977,27 +3235,257 @@ int mmc_init(struct mmc *mmc)
 
 	start = get_timer(0);
 
+	if (CONFIG_IS_ENABLED(MMC_HANDOFF) && !mmc->init_in_progress &&
+	    !mmc_handoff_adopt(mmc))
+		return 0;
+
+#if CONFIG_IS_ENABLED(MMC_STATE_CACHE)
+	mmc->init_hint = NULL;
+#endif
 	if (!mmc->init_in_progress)
 		err = mmc_start_init(mmc);
 
 	if (!err)
 		err = mmc_complete_init(mmc);
+#if CONFIG_IS_ENABLED(MMC_STATE_CACHE)
+	if (err && mmc->init_hint) {
+		/* What worked last time does not now, so start again */
+		pr_debug("%s: cached state failed (err=%d)\n", __func__, err);
+		mmc->init_hint = NULL;
+		mmc_cache_drop(mmc);
+		err = mmc_start_init(mmc);
+		if (!err)
+			err = mmc_complete_init(mmc);
+	}
+	mmc->init_hint = NULL;
+	if (!err)
+		mmc_cache_update(mmc);
+#endif
 	if (err)
 		pr_info("%s: %d, time %lu\n", __func__, err, get_timer(start));
+	else if (CONFIG_IS_ENABLED(MMC_SPEED_REPORT))
+		printf("%s: %s, %d-bit, %u MHz\n", mmc->cfg->name,
+		       mmc_mode_name(mmc->selected_mode), mmc->bus_width,
+		       mmc->clock / 1000000);
 
 	return err;
 }
 
+#if CONFIG_IS_ENABLED(MMC_HANDOFF) || CONFIG_IS_ENABLED(MMC_STATE_CACHE)
+#ifdef MMC_SUPPORTS_TUNING
+/* Tuning command needed after selecting a bus mode, 0 if none */
+static uint mmc_mode_tuning(enum bus_mode mode)
+{
+	switch (mode) {
+	case UHS_SDR104:
+		return MMC_CMD_SEND_TUNING_BLOCK;
+	case MMC_HS_200:
+	case MMC_HS_400:
+		return MMC_CMD_SEND_TUNING_BLOCK_HS200;
+	default:
+		return 0;
+	}
+}
+#endif
+
+int mmc_state_save(struct mmc *mmc, struct mmc_state *st)
+{
+	int i;
+
+	if (!mmc->has_init)
+		return -ENODEV;
+
+	memset(st, '\0', sizeof(*st));
+	st->version = mmc->version;
+	st->ocr = mmc->ocr;
+	st->rca = mmc->rca;
+	for (i = 0; i < 4; i++) {
+		st->cid[i] = mmc->cid[i];
+		st->csd[i] = mmc->csd[i];
+	}
+	st->scr[0] = mmc->scr[0];
+	st->scr[1] = mmc->scr[1];
+	st->high_capacity = mmc->high_capacity;
+	st->dsr_imp = mmc->dsr_imp;
+	st->read_bl_len = mmc->read_bl_len;
+#if CONFIG_IS_ENABLED(MMC_WRITE)
+	st->write_bl_len = mmc->write_bl_len;
+	st->erase_grp_size = mmc->erase_grp_size;
+	st->ssr_au = mmc->ssr.au;
+	st->ssr_erase_timeout = mmc->ssr.erase_timeout;
+	st->ssr_erase_offset = mmc->ssr.erase_offset;
+#endif
+	st->legacy_speed = mmc->legacy_speed;
+	st->card_caps = mmc->card_caps;
+	st->cardtype = mmc->cardtype;
+	st->mode = mmc->selected_mode;
+	st->best_mode = mmc->best_mode;
+	st->bus_width = mmc->bus_width;
+	st->signal_voltage = mmc->signal_voltage;
+	st->capacity_user = mmc->capacity_user;
+	if (mmc->ext_csd) {
+		st->sec_count = mmc_ext_csd_sec_count(mmc->ext_csd);
+		st->ext_csd_rev = mmc->ext_csd[EXT_CSD_REV];
+	}
+#ifdef MMC_SUPPORTS_TUNING
+	if (mmc_mode_tuning(mmc->selected_mode) &&
+	    !mmc_get_tuning(mmc, st->tuning))
+		st->flags |= MMC_STATE_TUNING;
+#endif
+
+	return 0;
+}
+
+#if CONFIG_IS_ENABLED(MMC_HANDOFF)
+/* Check that a card left set up by an earlier phase is working */
+static int mmc_state_check(struct mmc *mmc, const struct mmc_state *st)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(u8, buf, MMC_MAX_BLOCK_LEN);
+	uint status;
+	int err;
+
+	/* A card which has been reset or removed does not respond */
+	err = mmc_send_status(mmc, &status);
+	if (err)
+		return err;
+	if ((status & MMC_STATUS_CURR_STATE) != MMC_STATE_TRANS)
+		return -EIO;
+
+	/* Read some data to check the bus mode and tuning */
+	if (IS_SD(mmc) || mmc->version < MMC_VERSION_4) {
+		if (mmc_read_blocks(mmc, buf, 0, 1))
+			return -EIO;
+		return 0;
+	}
+
+	/* This works out the partitions as this phase needs them */
+	mmc->part_config = MMCPART_NOAVAILABLE;
+	err = mmc_startup_v4(mmc);
+	if (err)
+		return err;
+	if (mmc->ext_csd[EXT_CSD_REV] != st->ext_csd_rev ||
+	    mmc_ext_csd_sec_count(mmc->ext_csd) != st->sec_count)
+		return -EBADMSG;
+
+	return 0;
+}
+
+int mmc_state_restore(struct mmc *mmc, const struct mmc_state *st)
+{
+	__maybe_unused uint tuning;
+	int err, i;
+
+	err = mmc_set_host_caps(mmc);
+	if (err)
+		return err;
+	if (st->mode >= MMC_MODES_END ||
+	    !(mmc->host_caps & MMC_CAP(st->mode)))
+		return -ENOTSUPP;
+#if CONFIG_IS_ENABLED(DM_MMC)
+	mmc_deferred_probe(mmc);
+#endif
+#if !defined(CONFIG_MMC_BROKEN_CD)
+	if (!mmc_getcd(mmc))
+		return -ENOMEDIUM;
+#endif
+
+	mmc->version = st->version;
+	mmc->ocr = st->ocr;
+	mmc->rca = st->rca;
+	for (i = 0; i < 4; i++) {
+		mmc->cid[i] = st->cid[i];
+		mmc->csd[i] = st->csd[i];
+		mmc->capacity_gp[i] = 0;
+	}
+	mmc->scr[0] = st->scr[0];
+	mmc->scr[1] = st->scr[1];
+	mmc->high_capacity = st->high_capacity;
+	mmc->dsr_imp = st->dsr_imp;
+	mmc->read_bl_len = st->read_bl_len;
+#if CONFIG_IS_ENABLED(MMC_WRITE)
+	mmc->write_bl_len = st->write_bl_len;
+	mmc->erase_grp_size = st->erase_grp_size;
+	mmc->ssr.au = st->ssr_au;
+	mmc->ssr.erase_timeout = st->ssr_erase_timeout;
+	mmc->ssr.erase_offset = st->ssr_erase_offset;
+#endif
+	mmc->legacy_speed = st->legacy_speed;
+	mmc->card_caps = st->card_caps;
+	mmc->cardtype = st->cardtype;
+	mmc->best_mode = st->best_mode;
+	mmc->capacity_user = st->capacity_user;
+	mmc->capacity_boot = 0;
+	mmc->capacity_rpmb = 0;
+	mmc->part_config = MMCPART_NOAVAILABLE;
+
+	/* Set up the host as it was left; the card is already in this mode */
+	err = mmc_set_signal_voltage(mmc, st->signal_voltage);
+	if (err)
+		return err;
+	mmc_select_mode(mmc, st->mode);
+	mmc_set_bus_width(mmc, st->bus_width);
+	err = mmc_set_clock(mmc, mmc->tran_speed, MMC_CLK_ENABLE);
+	if (err)
+		return err;
+#if CONFIG_IS_ENABLED(MMC_HS400_ES_SUPPORT)
+	if (st->mode == MMC_HS_400_ES) {
+		err = mmc_set_enhanced_strobe(mmc);
+		if (err)
+			return err;
+	}
+#endif
+#ifdef MMC_SUPPORTS_TUNING
+	tuning = mmc_mode_tuning(st->mode);
+	if (tuning) {
+		err = -ENOENT;
+		if (st->flags & MMC_STATE_TUNING)
+			err = mmc_set_tuning(mmc, st->tuning);
+		/* HS400 is tuned in HS200 mode, so cannot be tuned here */
+		if (err && st->mode != MMC_HS_400)
+			err = mmc_execute_tuning(mmc, tuning);
+		if (err)
+			return err;
+	}
+#endif
+
+	err = mmc_state_check(mmc, st);
+	if (err)
+		return err;
+
+	err = mmc_set_capacity(mmc, 0);
+	if (err)
+		return err;
+	mmc_fill_blk_desc(mmc);
+
+	/* The earlier phase may have left another hardware partition selected */
+	if (mmc->part_config != MMCPART_NOAVAILABLE &&
+	    (mmc->part_config & PART_ACCESS_MASK)) {
+		err = mmc_switch_part(mmc, 0);
+		if (err)
+			return err;
+	}
+	mmc->has_init = 1;
+
+	return 0;
+}
+#endif /* MMC_HANDOFF */
+#endif
+
 #if CONFIG_IS_ENABLED(MMC_UHS_SUPPORT) || \
     CONFIG_IS_ENABLED(MMC_HS200_SUPPORT) || \
     CONFIG_IS_ENABLED(MMC_HS400_SUPPORT)
 int mmc_deinit(struct mmc *mmc)
 {
 	u32 caps_filtered;
+	int err;
 
 	if (!mmc->has_init)
 		return 0;
 
+	err = mmc_wait_write_done(mmc);
+	if (err)
+		return err;
+
 	if (IS_SD(mmc)) {
 		caps_filtered = mmc->card_caps &
 			~(MMC_CAP(UHS_SDR12) | MMC_CAP(UHS_SDR25) |
@@ -35,6 +35,25 @@ static int mmc_get_bootflow(struct udevice *dev, struct bootflow_iter *iter,
 	return 0;
 }
 
+static int mmc_bootdev_start(struct udevice *dev)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev_get_parent(dev));
+
+	if (!mmc || mmc->has_init || mmc->init_in_progress)
+		return 0;
+
+	/* A card set up by the previous phase is ready straight away */
+	if (CONFIG_IS_ENABLED(MMC_HANDOFF) && !mmc_handoff_adopt(mmc))
+		return 0;
+
+	/*
+	 * This powers up the card and, for eMMC, sends the first CMD1 without
+	 * waiting for it to finish. mmc_init() completes the rest when the
+	 * bootdev is scanned.
+	 */
+	return mmc_start_init(mmc);
+}
+
 static int mmc_bootdev_bind(struct udevice *dev)
 {
 	struct bootdev_uc_plat *ucp = dev_get_uclass_plat(dev);
@@ -46,6 +65,7 @@ static int mmc_bootdev_bind(struct udevice *dev)
 
 struct bootdev_ops mmc_bootdev_ops = {
 	.get_bootflow	= mmc_get_bootflow,
+	.start		= mmc_bootdev_start,
 };
 
 static const struct udevice_id mmc_bootdev_ids[] = {
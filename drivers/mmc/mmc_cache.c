@@ -0,0 +1,182 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Cache of the state of MMC cards across boots
+ *
+ * Setting up an eMMC in HS200/HS400 mode means trying each bus mode and width
+ * in turn and tuning the host, which gives the same result on every boot
+ * with the same card and board. The result is kept in a small CRC-protected
+ * record, keyed by the CID of the card, which the board saves somewhere that
+ * survives a reset. On the next boot mmc_startup() goes straight to that
+ * mode with the saved tuning and checks it with a single read, falling back
+ * to the full set-up if anything does not match.
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#define LOG_CATEGORY UCLASS_MMC
+
+#include <common.h>
+#include <dm.h>
+#include <log.h>
+#include <mapmem.h>
+#include <mmc.h>
+#include <u-boot/crc.h>
+
+#if !CONFIG_MMC_STATE_CACHE_ADDR
+static struct mmc_cache mmc_cache_buf;
+#endif
+
+/* true once mmc_cache_load() has been called */
+static bool mmc_cache_loaded;
+
+static struct mmc_cache *mmc_cache_get(void)
+{
+#if CONFIG_MMC_STATE_CACHE_ADDR
+	return map_sysmem(CONFIG_MMC_STATE_CACHE_ADDR, sizeof(struct mmc_cache));
+#else
+	return &mmc_cache_buf;
+#endif
+}
+
+/* An all-zero CID marks an entry which is not in use */
+static bool mmc_cache_no_cid(const u32 *cid)
+{
+	return !(cid[0] | cid[1] | cid[2] | cid[3]);
+}
+
+static u32 mmc_cache_crc(struct mmc_cache *cache)
+{
+	return crc32(0, (uchar *)cache->dev, sizeof(cache->dev));
+}
+
+int mmc_cache_load(void)
+{
+	struct mmc_cache *cache = mmc_cache_get();
+	int ret;
+
+	mmc_cache_loaded = true;
+	ret = board_mmc_cache_read(cache, sizeof(*cache));
+	if (ret >= 0) {
+		if (ret < (int)sizeof(*cache) || cache->magic != MMC_CACHE_MAGIC)
+			ret = -ENOENT;
+		else if (cache->version != MMC_CACHE_VERSION ||
+			 cache->size != sizeof(*cache) ||
+			 cache->crc32 != mmc_cache_crc(cache))
+			ret = -EBADMSG;
+		else
+			ret = 0;
+	}
+	if (ret) {
+		log_debug("No card-state cache (err=%d)\n", ret);
+		memset(cache, '\0', sizeof(*cache));
+		cache->magic = MMC_CACHE_MAGIC;
+		cache->version = MMC_CACHE_VERSION;
+		cache->size = sizeof(*cache);
+		return ret;
+	}
+
+	return 0;
+}
+
+/* Get the cache, reading it from the board on first use */
+static struct mmc_cache *mmc_cache_loaded_get(void)
+{
+	if (!mmc_cache_loaded)
+		mmc_cache_load();
+
+	return mmc_cache_get();
+}
+
+static struct mmc_cache_dev *mmc_cache_lookup(struct mmc_cache *cache,
+					      struct mmc *mmc)
+{
+	struct mmc_cache_dev *cdev;
+	int i;
+
+	for (i = 0; i < MMC_CACHE_MAX_DEVS; i++) {
+		cdev = &cache->dev[i];
+		if (cdev->seq == dev_seq(mmc->dev) &&
+		    !memcmp(cdev->state.cid, mmc->cid, sizeof(mmc->cid)))
+			return cdev;
+	}
+
+	return NULL;
+}
+
+const struct mmc_state *mmc_cache_find(struct mmc *mmc)
+{
+	struct mmc_cache_dev *cdev;
+
+	if (mmc_cache_no_cid(mmc->cid))
+		return NULL;
+	cdev = mmc_cache_lookup(mmc_cache_loaded_get(), mmc);
+	if (!cdev)
+		return NULL;
+	log_debug("%s: Using state from earlier boot (mode %d)\n",
+		  mmc->dev->name, cdev->state.mode);
+
+	return &cdev->state;
+}
+
+void mmc_cache_drop(struct mmc *mmc)
+{
+	struct mmc_cache *cache = mmc_cache_loaded_get();
+	int i;
+
+	for (i = 0; i < MMC_CACHE_MAX_DEVS; i++) {
+		if (cache->dev[i].seq == dev_seq(mmc->dev))
+			memset(&cache->dev[i], '\0', sizeof(cache->dev[i]));
+	}
+}
+
+int mmc_cache_update(struct mmc *mmc)
+{
+	struct mmc_cache *cache = mmc_cache_loaded_get();
+	struct mmc_cache_dev *cdev, new;
+	int i, ret;
+
+	memset(&new, '\0', sizeof(new));
+	new.seq = dev_seq(mmc->dev);
+	ret = mmc_state_save(mmc, &new.state);
+	if (ret)
+		return log_msg_ret("save", ret);
+	if (mmc_cache_no_cid(new.state.cid))
+		return 0;
+
+	/* Use this controller's entry, or else a free one, or else the first */
+	cdev = NULL;
+	for (i = 0; i < MMC_CACHE_MAX_DEVS; i++) {
+		struct mmc_cache_dev *try = &cache->dev[i];
+
+		if (mmc_cache_no_cid(try->state.cid)) {
+			if (!cdev)
+				cdev = try;
+		} else if (try->seq == new.seq) {
+			cdev = try;
+			break;
+		}
+	}
+	if (!cdev)
+		cdev = &cache->dev[0];
+	if (!memcmp(cdev, &new, sizeof(new)))
+		return 0;
+
+	*cdev = new;
+	cache->crc32 = mmc_cache_crc(cache);
+	ret = board_mmc_cache_write(cache, sizeof(*cache));
+	if (ret && ret != -ENOSYS)
+		return log_msg_ret("wr", ret);
+	log_debug("%s: Updated card-state cache\n", mmc->dev->name);
+
+	return 0;
+}
+
+__weak int board_mmc_cache_read(void *buf, ulong size)
+{
+	return -ENOSYS;
+}
+
+__weak int board_mmc_cache_write(const void *buf, ulong size)
+{
+	return -ENOSYS;
+}
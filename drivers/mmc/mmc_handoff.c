@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Hand-off of MMC cards from one phase to the next
+ *
+ * Identifying a card, selecting its bus mode and tuning the host take tens of
+ * milliseconds with an eMMC in HS200/HS400 mode. SPL records each card it has
+ * set up in the bloblist, so that U-Boot proper can carry on using it from
+ * the transfer state instead of doing all of that again.
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#define LOG_CATEGORY UCLASS_MMC
+
+#include <common.h>
+#include <bloblist.h>
+#include <dm.h>
+#include <log.h>
+#include <mmc.h>
+
+int mmc_handoff_save(void)
+{
+	struct mmc_handoff *ho;
+	struct udevice *dev;
+	struct uclass *uc;
+	struct mmc *mmc;
+	int ret;
+
+	ret = uclass_get(UCLASS_MMC, &uc);
+	if (ret)
+		return log_msg_ret("uc", ret);
+	ret = bloblist_ensure_size(BLOBLISTT_U_BOOT_MMC_HANDOFF, sizeof(*ho), 0,
+				   (void **)&ho);
+	if (ret)
+		return log_msg_ret("blob", ret);
+	memset(ho, '\0', sizeof(*ho));
+
+	uclass_foreach_dev(dev, uc) {
+		struct mmc_handoff_dev *hdev;
+
+		if (!device_active(dev))
+			continue;
+		mmc = mmc_get_mmc_dev(dev);
+		if (!mmc || !mmc->has_init)
+			continue;
+		if (ho->count == MMC_HANDOFF_MAX_DEVS) {
+			log_warning("Too many cards to hand off\n");
+			break;
+		}
+		hdev = &ho->dev[ho->count];
+		if (mmc_state_save(mmc, &hdev->state))
+			continue;
+		hdev->seq = dev_seq(dev);
+		log_debug("Handing off %s (mode %d)\n", dev->name,
+			  hdev->state.mode);
+		ho->count++;
+	}
+
+	return 0;
+}
+
+int mmc_handoff_adopt(struct mmc *mmc)
+{
+	struct mmc_handoff_dev *hdev;
+	struct mmc_handoff *ho;
+	int i, ret;
+
+	ho = bloblist_find(BLOBLISTT_U_BOOT_MMC_HANDOFF, sizeof(*ho));
+	if (!ho)
+		return -ENOENT;
+
+	for (i = 0; i < ho->count && i < MMC_HANDOFF_MAX_DEVS; i++) {
+		hdev = &ho->dev[i];
+		if (hdev->seq == dev_seq(mmc->dev) &&
+		    !(hdev->flags & MMC_HANDOFF_F_USED))
+			break;
+	}
+	if (i == ho->count || i == MMC_HANDOFF_MAX_DEVS)
+		return -ENOENT;
+
+	/* Whatever happens, the next mmc_init() starts from scratch */
+	hdev->flags |= MMC_HANDOFF_F_USED;
+	ret = mmc_state_restore(mmc, &hdev->state);
+	if (ret) {
+		log_warning("%s: Cannot use card from previous phase (err=%d)\n",
+			    mmc->dev->name, ret);
+		return ret;
+	}
+	log_debug("%s: Using card from previous phase\n", mmc->dev->name);
+
+	return 0;
+}
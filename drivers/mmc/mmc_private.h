@@ -12,11 +12,71 @@
 
 #include <mmc.h>
 
+/*
+ * Largest number of blocks which CMD23 (SET_BLOCK_COUNT) can give. Longer
+ * transfers are open-ended and ended by CMD12 (STOP_TRANSMISSION).
+ */
+#define MMC_SET_BLOCK_COUNT_MAX	0xffff
+
+/* CMD23 (SET_BLOCK_COUNT) flag asking for a reliable write */
+#define MMC_SET_BLOCK_COUNT_REL_WR	BIT(31)
+
 int mmc_send_status(struct mmc *mmc, unsigned int *status);
 int mmc_poll_for_busy(struct mmc *mmc, int timeout);
 
 int mmc_set_blocklen(struct mmc *mmc, int len);
 
+/**
+ * mmc_send_stop() - end an open-ended multiple-block transfer
+ *
+ * @mmc:	MMC device
+ * Return: 0 if OK, -ve on error
+ */
+int mmc_send_stop(struct mmc *mmc);
+
+#if CONFIG_IS_ENABLED(MMC_XFER_HISTOGRAM)
+/* Count a transfer of @blocks blocks in the histogram of transfer sizes */
+static inline void mmc_xfer_record(struct mmc *mmc, lbaint_t blocks)
+{
+	uint bucket = blocks > 1 ? __fls((ulong)blocks) : 0;
+
+	mmc->xfer_hist[min_t(uint, bucket, MMC_XFER_HIST_SIZE - 1)]++;
+}
+#else
+static inline void mmc_xfer_record(struct mmc *mmc, lbaint_t blocks)
+{
+}
+#endif
+
+#if CONFIG_IS_ENABLED(MMC_SPEED_REPORT)
+/* Count the blocks read by mmc_bread() and the time taken */
+static inline void mmc_read_record(struct mmc *mmc, lbaint_t blocks, u64 us)
+{
+	mmc->read_blocks += blocks;
+	mmc->read_us += us;
+}
+#else
+static inline void mmc_read_record(struct mmc *mmc, lbaint_t blocks, u64 us)
+{
+}
+#endif
+
+#if CONFIG_IS_ENABLED(MMC_WRITE_DEFER_BUSY)
+/* Wait for the last write to finish before sending anything but CMD13 */
+static inline int mmc_wait_before_cmd(struct mmc *mmc, struct mmc_cmd *cmd)
+{
+	if (!mmc->write_busy || cmd->cmdidx == MMC_CMD_SEND_STATUS)
+		return 0;
+
+	return mmc_wait_write_done(mmc);
+}
+#else
+static inline int mmc_wait_before_cmd(struct mmc *mmc, struct mmc_cmd *cmd)
+{
+	return 0;
+}
+#endif
+
 #if CONFIG_IS_ENABLED(BLK)
 ulong mmc_bread(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
 		void *dst);
@@ -15,7 +15,14 @@
 #include <linux/math64.h>
 #include "mmc_private.h"
 
-static ulong mmc_erase_t(struct mmc *mmc, ulong start, lbaint_t blkcnt)
+/* Time allowed for a card to program the data from a write */
+#define MMC_WRITE_TIMEOUT_MS	1000
+
+/* Number of erase groups to TRIM or DISCARD with each command */
+#define MMC_TRIM_MAX_GRPS	16
+
+static ulong mmc_erase_t(struct mmc *mmc, ulong start, lbaint_t blkcnt,
+			 uint arg)
 {
 	struct mmc_cmd cmd;
 	ulong end;
@@ -52,7 +59,7 @@ static ulong mmc_erase_t(struct mmc *mmc, ulong start, lbaint_t blkcnt)
 		goto err_out;
 
 	cmd.cmdidx = MMC_CMD_ERASE;
-	cmd.cmdarg = MMC_ERASE_ARG;
+	cmd.cmdarg = arg;
 	cmd.resp_type = MMC_RSP_R1b;
 
 	err = mmc_send_cmd(mmc, &cmd, NULL);
@@ -66,6 +73,66 @@ err_out:
 	return err;
 }
 
+bool mmc_can_trim(struct mmc *mmc)
+{
+	return !IS_SD(mmc) && mmc->version >= MMC_VERSION_4_41 &&
+		mmc->ext_csd &&
+		(mmc->ext_csd[EXT_CSD_SEC_FEATURE_SUPPORT] & EXT_CSD_SEC_GB_CL_EN);
+}
+
+/* Check whether writes can ask the card to keep each sector intact */
+static bool mmc_can_reliable_write(struct mmc *mmc)
+{
+	return CONFIG_IS_ENABLED(MMC_RELIABLE_WRITE) && !IS_SD(mmc) &&
+		!mmc_host_is_spi(mmc) && mmc->ext_csd &&
+		(mmc->ext_csd[EXT_CSD_WR_REL_PARAM] & EXT_CSD_EN_REL_WR);
+}
+
+static bool mmc_can_discard(struct mmc *mmc)
+{
+	return !IS_SD(mmc) && mmc->version >= MMC_VERSION_4_5 && mmc->ext_csd;
+}
+
+/**
+ * mmc_trim_blocks() - TRIM or DISCARD a range of blocks
+ *
+ * These work on write blocks, so the range need not be aligned to an erase
+ * group. The card is given TRIM_MULT x 300ms for each erase group covered by
+ * a command.
+ *
+ * @mmc:	MMC device
+ * @start:	First block
+ * @blkcnt:	Number of blocks
+ * @arg:	MMC_TRIM_ARG or MMC_DISCARD_ARG
+ * Return: number of blocks done
+ */
+static lbaint_t mmc_trim_blocks(struct mmc *mmc, lbaint_t start,
+				lbaint_t blkcnt, uint arg)
+{
+	uint grp = mmc->erase_grp_size;
+	uint trim_ms = 300 * max_t(uint, mmc->ext_csd[EXT_CSD_TRIM_MULT], 1);
+	lbaint_t blk = 0, blk_r;
+	u32 start_rem;
+	int timeout_ms;
+
+	while (blk < blkcnt) {
+		/* Stop each command at an erase-group boundary */
+		div_u64_rem(start + blk, grp, &start_rem);
+		blk_r = (lbaint_t)grp * MMC_TRIM_MAX_GRPS - start_rem;
+		if (blk_r > blkcnt - blk)
+			blk_r = blkcnt - blk;
+		timeout_ms = trim_ms * DIV_ROUND_UP(start_rem + blk_r, grp);
+
+		if (mmc_erase_t(mmc, start + blk, blk_r, arg))
+			break;
+		if (mmc_poll_for_busy(mmc, max(timeout_ms, 1000)))
+			break;
+		blk += blk_r;
+	}
+
+	return blk;
+}
+
 #if CONFIG_IS_ENABLED(BLK)
 ulong mmc_berase(struct udevice *dev, lbaint_t start, lbaint_t blkcnt)
 #else
@@ -113,7 +180,7 @@ ulong mmc_berase(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt)
 			blk_r = ((blkcnt - blk) > mmc->erase_grp_size) ?
 				mmc->erase_grp_size : (blkcnt - blk);
 		}
-		err = mmc_erase_t(mmc, start + blk, blk_r);
+		err = mmc_erase_t(mmc, start + blk, blk_r, MMC_ERASE_ARG);
 		if (err)
 			break;
 
@@ -127,12 +194,57 @@ ulong mmc_berase(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt)
 	return blk;
 }
 
+static int mmc_trim_range(struct blk_desc *desc, lbaint_t start,
+			  lbaint_t blkcnt, uint arg)
+{
+	struct mmc *mmc = find_mmc_device(desc->devnum);
+	bool supported;
+	int ret;
+
+	if (!mmc)
+		return -ENODEV;
+	if (arg == MMC_DISCARD_ARG)
+		supported = mmc_can_discard(mmc);
+	else
+		supported = mmc_can_trim(mmc);
+	if (!supported)
+		return -ENOTSUPP;
+	ret = blk_select_hwpart_devnum(IF_TYPE_MMC, desc->devnum, desc->hwpart);
+	if (ret < 0)
+		return ret;
+	if (mmc_trim_blocks(mmc, start, blkcnt, arg) != blkcnt)
+		return -EIO;
+
+	return 0;
+}
+
+int mmc_trim(struct blk_desc *desc, lbaint_t start, lbaint_t blkcnt)
+{
+	return mmc_trim_range(desc, start, blkcnt, MMC_TRIM_ARG);
+}
+
+int mmc_discard(struct blk_desc *desc, lbaint_t start, lbaint_t blkcnt)
+{
+	return mmc_trim_range(desc, start, blkcnt, MMC_DISCARD_ARG);
+}
+
+#if CONFIG_IS_ENABLED(MMC_WRITE_DEFER_BUSY)
+int mmc_wait_write_done(struct mmc *mmc)
+{
+	if (!mmc->write_busy)
+		return 0;
+	mmc->write_busy = false;
+
+	return mmc_poll_for_busy(mmc, MMC_WRITE_TIMEOUT_MS);
+}
+#endif
+
 static ulong mmc_write_blocks(struct mmc *mmc, lbaint_t start,
 		lbaint_t blkcnt, const void *src)
 {
+	bool rel_wr = mmc_can_reliable_write(mmc);
 	struct mmc_cmd cmd;
 	struct mmc_data data;
-	int timeout_ms = 1000;
 
 	if ((start + blkcnt) > mmc_get_blk_desc(mmc)->lba) {
 		printf("MMC: block number 0x" LBAF " exceeds max(0x" LBAF ")\n",
@@ -140,9 +252,12 @@ static ulong mmc_write_blocks(struct mmc *mmc, lbaint_t start,
 		return 0;
 	}
 
-	if (blkcnt > 1){
+	/* A reliable write needs CMD23, even for a single block */
+	if ((blkcnt > 1 || rel_wr) && blkcnt <= MMC_SET_BLOCK_COUNT_MAX) {
 		cmd.cmdidx = MMC_CMD_SET_BLOCK_COUNT;
-		cmd.cmdarg = blkcnt & 0x0000FFFF;
+		cmd.cmdarg = blkcnt;
+		if (rel_wr)
+			cmd.cmdarg |= MMC_SET_BLOCK_COUNT_REL_WR;
 		cmd.resp_type = MMC_RSP_R1;
 		if (mmc_send_cmd(mmc, &cmd, NULL)) {
 			printf("mmc fail to set block count\n");
@@ -152,7 +267,7 @@ static ulong mmc_write_blocks(struct mmc *mmc, lbaint_t start,
 
 	if (blkcnt == 0)
 		return 0;
-	else if (blkcnt == 1)
+	else if (blkcnt == 1 && !rel_wr)
 		cmd.cmdidx = MMC_CMD_WRITE_SINGLE_BLOCK;
 	else
 		cmd.cmdidx = MMC_CMD_WRITE_MULTIPLE_BLOCK;
@@ -174,9 +289,24 @@ static ulong mmc_write_blocks(struct mmc *mmc, lbaint_t start,
 		return 0;
 	}
 
+	if (blkcnt > MMC_SET_BLOCK_COUNT_MAX && !mmc_host_is_spi(mmc) &&
+	    mmc_send_stop(mmc)) {
+		printf("mmc fail to send stop cmd\n");
+		return 0;
+	}
+	mmc_xfer_record(mmc, blkcnt);
+
+#if CONFIG_IS_ENABLED(MMC_WRITE_DEFER_BUSY)
+	/*
+	 * Let the caller get on with preparing the next write while the card
+	 * programs this one; mmc_send_cmd() waits before the next command
+	 */
+	mmc->write_busy = true;
+#else
 	/* Waiting for the ready status */
-	if (mmc_poll_for_busy(mmc, timeout_ms))
+	if (mmc_poll_for_busy(mmc, MMC_WRITE_TIMEOUT_MS))
 		return 0;
+#endif
 
 	return blkcnt;
 }
@@ -193,7 +323,7 @@ ulong mmc_bwrite(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 	struct blk_desc *block_dev = dev_get_uclass_plat(dev);
 #endif
 	int dev_num = block_dev->devnum;
-	lbaint_t cur, blocks_todo = blkcnt;
+	lbaint_t cur, b_max, blocks_todo = blkcnt;
 	int err;
 
 	struct mmc *mmc = find_mmc_device(dev_num);
@@ -207,9 +337,13 @@ ulong mmc_bwrite(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 	if (mmc_set_blocklen(mmc, mmc->write_bl_len))
 		return 0;
 
+	b_max = mmc->cfg->b_max;
+	/* Each chunk must fit in the count given by CMD23 */
+	if (mmc_can_reliable_write(mmc))
+		b_max = min_t(lbaint_t, b_max, MMC_SET_BLOCK_COUNT_MAX);
+
 	do {
-		cur = (blocks_todo > mmc->cfg->b_max) ?
-			mmc->cfg->b_max : blocks_todo;
+		cur = (blocks_todo > b_max) ? b_max : blocks_todo;
 		if (mmc_write_blocks(mmc, start, cur, src) != cur)
 			return 0;
 		blocks_todo -= cur;
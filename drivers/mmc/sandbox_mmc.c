@@ -12,12 +12,14 @@
 #include <malloc.h>
 #include <mmc.h>
 #include <os.h>
+#include <time.h>
 #include <asm/test.h>
 
 struct sandbox_mmc_plat {
 	struct mmc_config cfg;
 	struct mmc mmc;
 	const char *fname;
+	uint size_mb;	/* Card size in MiB if there is no file, 0 for 1MiB */
 };
 
 #define MMC_CMULT		8 /* 8 because the card is high-capacity */
@@ -25,10 +27,27 @@ struct sandbox_mmc_plat {
 #define MMC_BL_LEN		BIT(MMC_BL_LEN_SHIFT)
 #define SIZE_MULTIPLE		((1 << (MMC_CMULT + 2)) * MMC_BL_LEN)
 
+/* Card states reported by SEND_STATUS, as in MMC_STATUS_CURR_STATE */
+#define SANDBOX_MMC_IDLE	(0 << 9)
+#define SANDBOX_MMC_STBY	(3 << 9)
+
 struct sandbox_mmc_priv {
 	char *buf;
 	int csize;	/* CSIZE value to report */
 	int size;
+	uint state;	/* Card state, SANDBOX_MMC_... or MMC_STATE_TRANS */
+	uint idents;	/* Number of ALL_SEND_CID commands */
+	uint cmd_ms;	/* Emulated time taken by each command */
+	uint busy_polls; /* SEND_STATUS polls for which a write keeps it busy */
+	uint busy;	/* Remaining polls before the card is ready */
+	uint busy_errs;	/* Commands other than SEND_STATUS while busy */
+	uint blk_count;	/* Count from SET_BLOCK_COUNT, 0 if none */
+	bool open_ended; /* Multiple-block transfer waiting for STOP */
+	uint xfers;	/* Number of multiple-block transfers */
+	uint xfer_errs;	/* Transfers not as set up by SET_BLOCK_COUNT */
+	bool high_speed; /* Card supports SD high speed */
+	uint read_max_clock; /* Reads fail above this bus clock, 0 for none */
+	uint ecc_blk;	/* Reads of this block fail ECC, 0 for none */
 };
 
 /**
@@ -44,21 +63,67 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 	struct mmc *mmc = mmc_get_mmc_dev(dev);
 	static ulong erase_start, erase_end;
 
+	if (priv->cmd_ms)
+		timer_test_add_offset(priv->cmd_ms);
+
+	/* A card which is programming data only answers SEND_STATUS */
+	if (priv->busy && cmd->cmdidx != MMC_CMD_SEND_STATUS) {
+		priv->busy_errs++;
+		return -ETIMEDOUT;
+	}
+
+	/* Emulate a card which cannot be read reliably at the current clock */
+	if ((cmd->cmdidx == MMC_CMD_READ_SINGLE_BLOCK ||
+	     cmd->cmdidx == MMC_CMD_READ_MULTIPLE_BLOCK) &&
+	    priv->read_max_clock &&
+	    mmc_get_mmc_dev(dev)->clock > priv->read_max_clock) {
+		priv->blk_count = 0;
+		return -EIO;
+	}
+
+	/* An open-ended transfer must be ended by STOP_TRANSMISSION */
+	if (priv->open_ended && cmd->cmdidx != MMC_CMD_STOP_TRANSMISSION &&
+	    cmd->cmdidx != MMC_CMD_SEND_STATUS) {
+		priv->xfer_errs++;
+		priv->open_ended = false;
+	}
+	if (cmd->cmdidx == MMC_CMD_READ_MULTIPLE_BLOCK ||
+	    cmd->cmdidx == MMC_CMD_WRITE_MULTIPLE_BLOCK) {
+		if (priv->blk_count && priv->blk_count != data->blocks)
+			priv->xfer_errs++;
+		priv->open_ended = !priv->blk_count;
+		priv->blk_count = 0;
+		priv->xfers++;
+	}
+
 	switch (cmd->cmdidx) {
 	case MMC_CMD_ALL_SEND_CID:
 		memset(cmd->response, '\0', sizeof(cmd->response));
+		/* Product serial number, which differs for each card */
+		cmd->response[2] = dev_seq(dev) + 1;
+		priv->idents++;
 		break;
 	case SD_CMD_SEND_RELATIVE_ADDR:
 		cmd->response[0] = 0 << 16; /* mmc->rca */
+		priv->state = SANDBOX_MMC_STBY;
+		break;
 	case MMC_CMD_GO_IDLE_STATE:
+		priv->state = SANDBOX_MMC_IDLE;
 		break;
 	case SD_CMD_SEND_IF_COND:
 		cmd->response[0] = 0xaa;
 		break;
 	case MMC_CMD_SEND_STATUS:
-		cmd->response[0] = MMC_STATUS_RDY_FOR_DATA;
+		if (priv->busy) {
+			cmd->response[0] = MMC_STATE_PRG;
+			priv->busy--;
+		} else {
+			cmd->response[0] = MMC_STATUS_RDY_FOR_DATA |
+				priv->state;
+		}
 		break;
 	case MMC_CMD_SELECT_CARD:
+		priv->state = MMC_STATE_TRANS;
 		break;
 	case MMC_CMD_SEND_CSD:
 		cmd->response[0] = 0;
@@ -71,9 +136,12 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 		if (!data)
 			break;
 		u32 *resp = (u32 *)data->dest;
-		resp[3] = 0;
+		resp[3] = priv->high_speed ?
+			cpu_to_be32(SD_HIGHSPEED_SUPPORTED) : 0;
 		resp[7] = cpu_to_be32(SD_HIGHSPEED_BUSY);
-		if ((cmd->cmdarg & 0xF) == UHS_SDR12_BUS_SPEED)
+		if ((cmd->cmdarg & 0xF) == UHS_SDR12_BUS_SPEED ||
+		    (priv->high_speed &&
+		     (cmd->cmdarg & 0xF) == HIGH_SPEED_BUS_SPEED))
 			resp[4] = (cmd->cmdarg & 0xF) << 24;
 		break;
 	}
@@ -81,13 +149,22 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 	case MMC_CMD_READ_MULTIPLE_BLOCK:
 		memcpy(data->dest, &priv->buf[cmd->cmdarg * data->blocksize],
 		       data->blocks * data->blocksize);
+		cmd->response[0] = priv->state;
+		if (priv->ecc_blk && priv->ecc_blk >= cmd->cmdarg &&
+		    priv->ecc_blk < cmd->cmdarg + data->blocks)
+			cmd->response[0] |= MMC_STATUS_CARD_ECC_FAILED;
 		break;
 	case MMC_CMD_WRITE_SINGLE_BLOCK:
 	case MMC_CMD_WRITE_MULTIPLE_BLOCK:
 		memcpy(&priv->buf[cmd->cmdarg * data->blocksize], data->src,
 		       data->blocks * data->blocksize);
+		priv->busy = priv->busy_polls;
+		break;
+	case MMC_CMD_SET_BLOCK_COUNT:
+		priv->blk_count = cmd->cmdarg & 0xffff;
 		break;
 	case MMC_CMD_STOP_TRANSMISSION:
+		priv->open_ended = false;
 		break;
 	case SD_CMD_ERASE_WR_BLK_START:
 		erase_start = cmd->cmdarg;
@@ -123,6 +200,76 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 	return 0;
 }
 
+uint sandbox_mmc_get_idents(struct udevice *dev)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+
+	return priv->idents;
+}
+
+void sandbox_mmc_set_latency(struct udevice *dev, uint cmd_ms)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+
+	priv->cmd_ms = cmd_ms;
+}
+
+void sandbox_mmc_set_write_busy(struct udevice *dev, uint polls)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+
+	priv->busy_polls = polls;
+}
+
+uint sandbox_mmc_get_write_busy(struct udevice *dev, uint *errsp)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+
+	*errsp = priv->busy_errs;
+
+	return priv->busy;
+}
+
+void sandbox_mmc_set_b_max(struct udevice *dev, uint b_max)
+{
+	struct sandbox_mmc_plat *plat = dev_get_plat(dev);
+
+	plat->cfg.b_max = b_max;
+}
+
+void sandbox_mmc_set_size(struct udevice *dev, uint size_mb)
+{
+	struct sandbox_mmc_plat *plat = dev_get_plat(dev);
+
+	plat->size_mb = size_mb;
+	plat->mmc.has_init = 0;
+}
+
+uint sandbox_mmc_get_xfers(struct udevice *dev, uint *errsp)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+
+	*errsp = priv->xfer_errs;
+
+	return priv->xfers;
+}
+
+void sandbox_mmc_set_high_speed(struct udevice *dev, bool high_speed,
+				uint read_max_clock)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+
+	priv->high_speed = high_speed;
+	priv->read_max_clock = read_max_clock;
+}
+
+void sandbox_mmc_set_ecc_error(struct udevice *dev, uint blk)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+
+	priv->ecc_blk = blk;
+}
+
 static int sandbox_mmc_set_ios(struct udevice *dev)
 {
 	return 0;
@@ -174,8 +321,8 @@ static int sandbox_mmc_probe(struct udevice *dev)
 		}
 		priv->csize = priv->size / SIZE_MULTIPLE - 1;
 	} else {
-		priv->csize = 0;
-		priv->size = (priv->csize + 1) * SIZE_MULTIPLE; /* 1 MiB */
+		priv->csize = plat->size_mb ? plat->size_mb - 1 : 0;
+		priv->size = (priv->csize + 1) * SIZE_MULTIPLE;
 
 		priv->buf = malloc(priv->size);
 		if (!priv->buf) {
@@ -10,7 +10,7 @@
 #include <asm/cache.h>
 
 static void sdhci_adma_desc(struct sdhci_adma_desc *desc,
-			    dma_addr_t addr, u16 len, bool end)
+			    dma_addr_t addr, uint len, bool end)
 {
 	u8 attr;
 
@@ -18,15 +18,42 @@ static void sdhci_adma_desc(struct sdhci_adma_desc *desc,
 	if (end)
 		attr |= ADMA_DESC_ATTR_END;
 
-	desc->attr = attr;
-	desc->len = len;
-	desc->reserved = 0;
+	/*
+	 * In 26-bit length mode bits 25:16 of the length go in bits 15:6 of
+	 * the attribute word; they are zero otherwise
+	 */
+	desc->attr = attr | ((len >> 10) & 0xc0);
+	desc->len = len & 0xffff;
+	desc->reserved = len >> 18;
 	desc->addr_lo = lower_32_bits(addr);
 #ifdef CONFIG_DMA_ADDR_T_64BIT
 	desc->addr_hi = upper_32_bits(addr);
 #endif
 }
 
+void sdhci_prepare_adma_table_len(struct sdhci_adma_desc *table,
+				  struct mmc_data *data, dma_addr_t addr,
+				  uint max_len)
+{
+	uint trans_bytes = data->blocksize * data->blocks;
+	uint desc_count = DIV_ROUND_UP(trans_bytes, max_len);
+	struct sdhci_adma_desc *desc = table;
+	int i = desc_count;
+
+	while (--i) {
+		sdhci_adma_desc(desc, addr, max_len, false);
+		addr += max_len;
+		trans_bytes -= max_len;
+		desc++;
+	}
+
+	sdhci_adma_desc(desc, addr, trans_bytes, true);
+
+	flush_cache((dma_addr_t)table,
+		    ROUND(desc_count * sizeof(struct sdhci_adma_desc),
+			  ARCH_DMA_MINALIGN));
+}
+
 /**
  * sdhci_prepare_adma_table() - Populate the ADMA table
  *
@@ -42,23 +69,12 @@ static void sdhci_adma_desc(struct sdhci_adma_desc *desc,
 void sdhci_prepare_adma_table(struct sdhci_adma_desc *table,
 			      struct mmc_data *data, dma_addr_t addr)
 {
-	uint trans_bytes = data->blocksize * data->blocks;
-	uint desc_count = DIV_ROUND_UP(trans_bytes, ADMA_MAX_LEN);
-	struct sdhci_adma_desc *desc = table;
-	int i = desc_count;
-
-	while (--i) {
-		sdhci_adma_desc(desc, addr, ADMA_MAX_LEN, false);
-		addr += ADMA_MAX_LEN;
-		trans_bytes -= ADMA_MAX_LEN;
-		desc++;
-	}
-
-	sdhci_adma_desc(desc, addr, trans_bytes, true);
+	sdhci_prepare_adma_table_len(table, data, addr, ADMA_MAX_LEN);
+}
 
-	flush_cache((dma_addr_t)table,
-		    ROUND(desc_count * sizeof(struct sdhci_adma_desc),
-			  ARCH_DMA_MINALIGN));
+struct sdhci_adma_desc *sdhci_adma_alloc(uint entries)
+{
+	return memalign(ARCH_DMA_MINALIGN, entries * ADMA_DESC_LEN);
 }
 
 /**
@@ -69,5 +85,5 @@ void sdhci_prepare_adma_table(struct sdhci_adma_desc *table,
  */
 struct sdhci_adma_desc *sdhci_adma_init(void)
 {
-	return memalign(ARCH_DMA_MINALIGN, ADMA_TABLE_SZ);
+	return sdhci_adma_alloc(ADMA_TABLE_NO_ENTRIES);
 }
@@ -110,8 +110,9 @@ static void sdhci_prepare_dma(struct sdhci_host *host, struct mmc_data *data,
 	}
 #if CONFIG_IS_ENABLED(MMC_SDHCI_ADMA)
 	else if (host->flags & (USE_ADMA | USE_ADMA64)) {
-		sdhci_prepare_adma_table(host->adma_desc_table, data,
-					 host->start_addr);
+		sdhci_prepare_adma_table_len(host->adma_desc_table, data,
+					     host->start_addr,
+					     host->adma_max_len);
 
 		sdhci_writel(host, lower_32_bits(host->adma_addr),
 			     SDHCI_ADMA_ADDRESS);
@@ -132,7 +133,8 @@ static int sdhci_transfer_data(struct sdhci_host *host, struct mmc_data *data)
 	unsigned int stat, rdy, mask, timeout, block = 0;
 	bool transfer_done = false;
 
-	timeout = 1000000;
+	/* Allow 10s, plus 1ms per block for large transfers */
+	timeout = 1000000 + data->blocks * 100;
 	rdy = SDHCI_INT_SPACE_AVAIL | SDHCI_INT_DATA_AVAIL;
 	mask = SDHCI_DATA_AVAILABLE | SDHCI_SPACE_AVAILABLE;
 	do {
@@ -289,7 +291,12 @@ static int sdhci_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
 		sdhci_writew(host, SDHCI_MAKE_BLKSZ(SDHCI_DEFAULT_BOUNDARY_ARG,
 				data->blocksize),
 				SDHCI_BLOCK_SIZE);
-		sdhci_writew(host, data->blocks, SDHCI_BLOCK_COUNT);
+		if (host->flags & USE_32BIT_BLK_CNT) {
+			sdhci_writew(host, 0, SDHCI_BLOCK_COUNT);
+			sdhci_writel(host, data->blocks, SDHCI_32BIT_BLK_CNT);
+		} else {
+			sdhci_writew(host, data->blocks, SDHCI_BLOCK_COUNT);
+		}
 		sdhci_writew(host, mode, SDHCI_TRANSFER_MODE);
 	} else if (cmd->resp_type & MMC_RSP_BUSY) {
 		sdhci_writeb(host, 0xe, SDHCI_TIMEOUT_CONTROL);
@@ -360,6 +367,28 @@ static int sdhci_execute_tuning(struct udevice *dev, uint opcode)
 	}
 	return 0;
 }
+
+static int sdhci_get_tuning(struct udevice *dev, u32 *tuning)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+	struct sdhci_host *host = mmc->priv;
+
+	if (host->ops && host->ops->get_tuning)
+		return host->ops->get_tuning(host, tuning);
+
+	return -ENOSYS;
+}
+
+static int sdhci_set_tuning(struct udevice *dev, const u32 *tuning)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev);
+	struct sdhci_host *host = mmc->priv;
+
+	if (host->ops && host->ops->set_tuning)
+		return host->ops->set_tuning(host, tuning);
+
+	return -ENOSYS;
+}
 #endif
 int sdhci_set_clock(struct mmc *mmc, unsigned int clock)
 {
@@ -821,6 +850,8 @@ const struct dm_mmc_ops sdhci_ops = {
 	.deferred_probe	= sdhci_deferred_probe,
 #ifdef MMC_SUPPORTS_TUNING
 	.execute_tuning	= sdhci_execute_tuning,
+	.get_tuning	= sdhci_get_tuning,
+	.set_tuning	= sdhci_set_tuning,
 #endif
 	.wait_dat0	= sdhci_wait_dat0,
 #if CONFIG_IS_ENABLED(MMC_HS400_ES_SUPPORT)
@@ -862,13 +893,30 @@ int sdhci_setup_cfg(struct mmc_config *cfg, struct sdhci_host *host,
 		      __func__);
 	}
 #endif
+	/* The 32-bit block count register is also the SDMA address */
+	if (host->flags & USE_SDMA)
+		host->flags &= ~USE_32BIT_BLK_CNT;
+	if (host->flags & USE_32BIT_BLK_CNT)
+		cfg->b_max = SDHCI_V4_MAX_BLK_COUNT;
+	else
+		cfg->b_max = CONFIG_SYS_MMC_MAX_BLK_COUNT;
+
 #if CONFIG_IS_ENABLED(MMC_SDHCI_ADMA)
 	if (!(caps & SDHCI_CAN_DO_ADMA2)) {
 		pr_err("%s: Your controller doesn't support SDMA!!\n",
 		       __func__);
 		return -EINVAL;
 	}
-	host->adma_desc_table = sdhci_adma_init();
+	host->adma_max_len = host->flags & USE_ADMA_26BIT_LEN ?
+		ADMA_MAX_LEN_26BIT : ADMA_MAX_LEN;
+	/* One table for the largest transfer, kept for the life of the host */
+	if (!host->adma_desc_table) {
+		host->adma_desc_table = sdhci_adma_alloc(
+			DIV_ROUND_UP(cfg->b_max * MMC_MAX_BLOCK_LEN,
+				     host->adma_max_len));
+		if (!host->adma_desc_table)
+			return -ENOMEM;
+	}
 	host->adma_addr = (dma_addr_t)host->adma_desc_table;
 
 #ifdef CONFIG_DMA_ADDR_T_64BIT
@@ -983,8 +1031,6 @@ int sdhci_setup_cfg(struct mmc_config *cfg, struct sdhci_host *host,
 	if (host->host_caps)
 		cfg->host_caps |= host->host_caps;
 
-	cfg->b_max = CONFIG_SYS_MMC_MAX_BLK_COUNT;
-
 	return 0;
 }
 
@@ -46,6 +46,19 @@ static void sdhci_do_enable_v4_mode(struct udevice *dev)
 	sdhci_writew(host, ctrl2, SDHCI_HOST_CONTROL2);
 }
 
+/* A full reset clears the version 4 mode, which transfers rely on */
+static int spacemit_sdhci_reinit(struct udevice *dev)
+{
+	int ret;
+
+	ret = sdhci_probe(dev);
+	if (ret)
+		return ret;
+	sdhci_do_enable_v4_mode(dev);
+
+	return 0;
+}
+
 static struct dm_mmc_ops spacemit_mmc_ops;
 
 static int spacemit_sdhci_probe(struct udevice *dev)
@@ -84,6 +97,7 @@ static int spacemit_sdhci_probe(struct udevice *dev)
 	host->ioaddr = dev_read_addr_ptr(dev);
 	host->ops = &spacemit_ops;
 	host->quirks = SDHCI_QUIRK_WAIT_SEND_CMD;
+	host->flags = USE_ADMA_26BIT_LEN | USE_32BIT_BLK_CNT;
 	host->bus_width	= fdtdec_get_int(gd->fdt_blob, dev_of_offset(dev),
 					 "bus-width", 4);
 
@@ -95,7 +109,7 @@ static int spacemit_sdhci_probe(struct udevice *dev)
 	host->mmc = &plat->mmc;
 	host->mmc->dev = dev;
 	spacemit_mmc_ops = sdhci_ops;
-	spacemit_mmc_ops.reinit = sdhci_probe;
+	spacemit_mmc_ops.reinit = spacemit_sdhci_reinit;
 
 	ret = sdhci_setup_cfg(&plat->cfg, host, max_clk, SPACEMIT_SDHC_MIN_FREQ);
 	if (ret)
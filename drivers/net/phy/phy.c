@@ -1076,12 +1076,77 @@ int phy_config(struct phy_device *phydev)
 
 int phy_shutdown(struct phy_device *phydev)
 {
+	sched_cancel(&phydev->aneg_task);
 	if (phydev->drv->shutdown)
 		phydev->drv->shutdown(phydev);
 
 	return 0;
 }
 
+/*
+ * Polls for auto-negotiation to complete, with one read of BMSR per step.
+ * The step may run while the bus is in use, e.g. when an MDIO driver waits
+ * part-way through a transaction, so it tries again later in that case.
+ */
+static int phy_aneg_step(struct sched_task *task)
+{
+	struct phy_device *phydev = task->ctx;
+	int mii_reg;
+
+	if (phydev->autoneg != AUTONEG_ENABLE)
+		return 0;
+	if (phydev->bus->busy)
+		return SCHED_AGAIN;
+
+	mii_reg = phy_read(phydev, MDIO_DEVAD_NONE, MII_BMSR);
+	if (mii_reg < 0)
+		return mii_reg;
+	if (!(mii_reg & BMSR_ANEGCOMPLETE)) {
+		/* Give up as genphy_update_link() would */
+		if (task->calls > PHY_ANEG_TIMEOUT / 50) {
+			debug("%s: auto-negotiation timed out\n",
+			      phydev->dev->name);
+			phydev->link = 0;
+			return -ETIMEDOUT;
+		}
+		return SCHED_AGAIN;
+	}
+
+	return 0;
+}
+
+int phy_aneg_start(struct phy_device *phydev)
+{
+	struct sched_task *task = &phydev->aneg_task;
+
+	if (!sched_done(task))
+		return -EBUSY;
+	sched_task_init(task, "phy-aneg", phy_aneg_step, phydev, 50 * 1000);
+
+	return sched_start(task);
+}
+
+int phy_aneg_wait(struct phy_device *phydev)
+{
+	struct sched_task *task = &phydev->aneg_task;
+	int ret;
+
+	if (!sched_done(task)) {
+		ret = sched_wait(task, PHY_ANEG_TIMEOUT * 2);
+		if (ret == -ETIMEDOUT)
+			sched_cancel(task);
+		if (ret)
+			return ret;
+	}
+
+	/*
+	 * Auto-negotiation has completed, or the task finished some time ago
+	 * and the link may have changed since, so this is quick unless the
+	 * link has gone down
+	 */
+	return phy_startup(phydev);
+}
+
 /**
  * phy_modify - Convenience function for modifying a given PHY register
  * @phydev: the phy_device struct
@@ -1112,13 +1177,18 @@ int phy_modify(struct phy_device *phydev, int devad, int regnum, u16 mask,
 int phy_read(struct phy_device *phydev, int devad, int regnum)
 {
 	struct mii_dev *bus = phydev->bus;
+	int ret;
 
 	if (!bus || !bus->read) {
 		debug("%s: No bus configured\n", __func__);
 		return -1;
 	}
 
-	return bus->read(bus, phydev->addr, devad, regnum);
+	bus->busy = true;
+	ret = bus->read(bus, phydev->addr, devad, regnum);
+	bus->busy = false;
+
+	return ret;
 }
 
 /**
@@ -1132,13 +1202,18 @@ int phy_read(struct phy_device *phydev, int devad, int regnum)
 int phy_write(struct phy_device *phydev, int devad, int regnum, u16 val)
 {
 	struct mii_dev *bus = phydev->bus;
+	int ret;
 
 	if (!bus || !bus->write) {
 		debug("%s: No bus configured\n", __func__);
 		return -1;
 	}
 
-	return bus->write(bus, phydev->addr, devad, regnum, val);
+	bus->busy = true;
+	ret = bus->write(bus, phydev->addr, devad, regnum, val);
+	bus->busy = false;
+
+	return ret;
 }
 
 /**
@@ -14,9 +14,22 @@
 #include <asm/eth.h>
 #include <asm/global_data.h>
 #include <asm/test.h>
+#include <asm/unaligned.h>
+#include <net/dhcp.h>
+#include <net/tcp.h>
+#include <linux/ctype.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
+/* Address and lease time of the mock DHCP server */
+#define SB_DHCP_SERVER_IP	"1.1.2.1"
+#define SB_DHCP_LEASE_SECS	3600
+
+/* Port of the mock HTTP server */
+#define SB_HTTP_PORT		80
+/* Time the mock HTTP server waits for an ACK before sending again */
+#define SB_HTTP_RTO_MS		200
+
 static bool skip_timeout;
 
 /*
@@ -162,6 +175,591 @@ int sandbox_eth_ping_req_to_reply(struct udevice *dev, void *packet,
 	return 0;
 }
 
+/*
+ * sandbox_eth_dhcp_req_to_reply()
+ *
+ * Check for a DHCP request to be sent. If so, inject a reply: an offer for a
+ * discover, an ack for a request for the address being handed out and a nak
+ * for a request for any other address
+ *
+ * returns 0 if injected, -EAGAIN if not
+ */
+int sandbox_eth_dhcp_req_to_reply(struct udevice *dev, void *packet,
+				  unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth = packet;
+	struct ip_udp_hdr *ip;
+	struct bootp_hdr *bp;
+	struct ethernet_hdr *eth_recv;
+	struct ip_udp_hdr *ipr;
+	struct bootp_hdr *bpr;
+	struct in_addr requested_ip, server_ip, bcast_ip;
+	u8 *opt, *end;
+	int type = 0, reply;
+	u32 lease;
+
+	if (ntohs(eth->et_protlen) != PROT_IP)
+		return -EAGAIN;
+
+	ip = packet + ETHER_HDR_SIZE;
+	if (ip->ip_p != IPPROTO_UDP || ntohs(ip->udp_dst) != 67)
+		return -EAGAIN;
+
+	/* Find the message type and the requested address */
+	bp = (void *)ip + IP_UDP_HDR_SIZE;
+	requested_ip = net_read_ip(&bp->bp_ciaddr);
+	opt = (u8 *)bp->bp_vend + 4;
+	end = packet + len;
+	while (opt + 2 <= end && *opt != 0xff) {
+		if (!*opt) {
+			opt++;
+			continue;
+		}
+		if (*opt == 53)
+			type = opt[2];
+		else if (*opt == 50)
+			requested_ip = net_read_ip(opt + 2);
+		opt += opt[1] + 2;
+	}
+
+	switch (type) {
+	case DHCP_DISCOVER:
+		reply = DHCP_OFFER;
+		break;
+	case DHCP_REQUEST:
+		reply = requested_ip.s_addr == priv->dhcp_ipaddr.s_addr ?
+			DHCP_ACK : DHCP_NAK;
+		break;
+	default:
+		return -EAGAIN;
+	}
+
+	/* Don't allow the buffer to overrun */
+	if (priv->recv_packets >= PKTBUFSRX)
+		return 0;
+
+	eth_recv = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	memset(eth_recv, '\0', ETHER_HDR_SIZE + IP_UDP_HDR_SIZE + BOOTP_HDR_SIZE);
+	memcpy(eth_recv->et_dest, eth->et_src, ARP_HLEN);
+	memcpy(eth_recv->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth_recv->et_protlen = htons(PROT_IP);
+
+	ipr = (void *)eth_recv + ETHER_HDR_SIZE;
+	bpr = (void *)ipr + IP_UDP_HDR_SIZE;
+	bpr->bp_op = OP_BOOTREPLY;
+	bpr->bp_htype = HWT_ETHER;
+	bpr->bp_hlen = HWL_ETHER;
+	bpr->bp_id = bp->bp_id;
+	memcpy(bpr->bp_chaddr, bp->bp_chaddr, sizeof(bpr->bp_chaddr));
+
+	server_ip = string_to_ip(SB_DHCP_SERVER_IP);
+	if (reply != DHCP_NAK) {
+		net_write_ip(&bpr->bp_yiaddr, priv->dhcp_ipaddr);
+		net_write_ip(&bpr->bp_siaddr, server_ip);
+	}
+
+	opt = (u8 *)bpr->bp_vend;
+	*opt++ = 99;		/* RFC1048 Magic Cookie */
+	*opt++ = 130;
+	*opt++ = 83;
+	*opt++ = 99;
+	*opt++ = 53;		/* DHCP Message Type */
+	*opt++ = 1;
+	*opt++ = reply;
+	*opt++ = 54;		/* Server ID */
+	*opt++ = 4;
+	net_write_ip(opt, server_ip);
+	opt += 4;
+	if (reply != DHCP_NAK) {
+		*opt++ = 51;	/* Lease Time */
+		*opt++ = 4;
+		lease = htonl(SB_DHCP_LEASE_SECS);
+		memcpy(opt, &lease, 4);
+		opt += 4;
+		*opt++ = 1;	/* Subnet Mask */
+		*opt++ = 4;
+		net_write_ip(opt, string_to_ip("255.255.255.0"));
+		opt += 4;
+	}
+	*opt++ = 255;
+
+	bcast_ip.s_addr = 0xffffffff;
+	net_set_ip_header((uchar *)ipr, bcast_ip, server_ip,
+			  IP_UDP_HDR_SIZE + BOOTP_HDR_SIZE, IPPROTO_UDP);
+	ipr->udp_src = htons(67);
+	ipr->udp_dst = htons(68);
+	ipr->udp_len = htons(UDP_HDR_SIZE + BOOTP_HDR_SIZE);
+	ipr->udp_xsum = 0;
+
+	priv->recv_packet_length[priv->recv_packets] =
+		ETHER_HDR_SIZE + IP_UDP_HDR_SIZE + BOOTP_HDR_SIZE;
+	++priv->recv_packets;
+
+	return 0;
+}
+
+/* Finds the connection to the mock HTTP server from a client port */
+static struct eth_sandbox_http_conn *sb_http_find(struct eth_sandbox_priv *priv,
+						  u16 port)
+{
+	int i;
+
+	for (i = 0; i < SB_HTTP_MAX_CONNS; i++) {
+		if (priv->http_conns[i].port == port)
+			return &priv->http_conns[i];
+	}
+
+	return NULL;
+}
+
+/* Check whether sequence number @a comes after @b */
+static bool sb_http_seq_after(u32 a, u32 b)
+{
+	return (s32)(a - b) > 0;
+}
+
+/* Finds the window scale in the options of a SYN from the client */
+static int sb_http_wscale(const u8 *opt, int len)
+{
+	while (len > 1 && *opt != TCP_OPT_END) {
+		if (*opt == TCP_OPT_NOP) {
+			opt++;
+			len--;
+			continue;
+		}
+		if (opt[1] < 2 || opt[1] > len)
+			break;
+		if (*opt == TCP_OPT_WS && opt[1] == 3)
+			return min_t(int, opt[2], 14);
+		len -= opt[1];
+		opt += opt[1];
+	}
+
+	return 0;
+}
+
+/* Injects a segment from the mock HTTP server */
+static void sb_http_output(struct eth_sandbox_priv *priv,
+			   struct eth_sandbox_http_conn *conn, u8 flags,
+			   u32 seq, const uchar *data, uint len)
+{
+	struct ethernet_hdr *eth_recv;
+	struct ip_tcp_hdr *ipr;
+	int opt_len = 0;
+	uchar *opt;
+
+	eth_recv = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	memcpy(eth_recv->et_dest, conn->client_hwaddr, ARP_HLEN);
+	memcpy(eth_recv->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth_recv->et_protlen = htons(PROT_IP);
+
+	ipr = (void *)eth_recv + ETHER_HDR_SIZE;
+	opt = (uchar *)ipr + IP_TCP_HDR_SIZE;
+	if (flags & TCP_SYN) {
+		opt[0] = TCP_OPT_MSS;
+		opt[1] = 4;
+		put_unaligned_be16(priv->http_mss ?: TCP_MSS, opt + 2);
+		opt[4] = TCP_OPT_NOP;
+		opt[5] = TCP_OPT_WS;
+		opt[6] = 3;
+		opt[7] = 7;
+		opt_len = TCP_SYN_OPT_SIZE;
+	}
+	if (len)
+		memcpy(opt + opt_len, data, len);
+
+	ipr->tcp_src = htons(SB_HTTP_PORT);
+	ipr->tcp_dst = htons(conn->port);
+	ipr->tcp_seq = htonl(seq);
+	ipr->tcp_ack = htonl(conn->rcv_nxt);
+	ipr->tcp_hlen = ((TCP_HDR_SIZE + opt_len) / 4) << 4;
+	ipr->tcp_flags = flags;
+	ipr->tcp_win = htons(0xffff);
+	ipr->tcp_xsum = 0;
+	ipr->tcp_urg = 0;
+	net_set_ip_header((uchar *)ipr, conn->client_ip, conn->server_ip,
+			  IP_TCP_HDR_SIZE + opt_len + len, IPPROTO_TCP);
+	ipr->tcp_xsum = tcp_checksum(ipr, TCP_HDR_SIZE + opt_len + len);
+
+	priv->recv_packet_length[priv->recv_packets] =
+		ETHER_HDR_SIZE + IP_TCP_HDR_SIZE + opt_len + len;
+	++priv->recv_packets;
+}
+
+/* Queues the response to a request to the mock HTTP server */
+static void sb_http_respond(struct eth_sandbox_priv *priv,
+			    struct eth_sandbox_http_conn *conn, const char *req)
+{
+	struct eth_sandbox_http_resp *resp, *prev;
+	char range_hdr[64] = "";
+	const char *status;
+	char *range, *end;
+	ulong last;
+
+	priv->http_reqs++;
+	if (conn->nresp == SB_HTTP_MAX_RESP)
+		return;
+	resp = &conn->resp[conn->nresp++];
+	memset(resp, '\0', sizeof(*resp));
+
+	/* Responses follow each other, after anything already acknowledged */
+	if (conn->nresp > 1) {
+		prev = resp - 1;
+		resp->seq = prev->seq + prev->hdr_len + prev->len;
+	} else {
+		resp->seq = conn->snd_max;
+	}
+
+	range = strstr(req, "\r\nRange: bytes=");
+	if (strncmp(req, "GET " SB_HTTP_PATH " ", strlen(SB_HTTP_PATH) + 5)) {
+		status = "404 Not Found";
+	} else if (range && priv->http_ranges) {
+		resp->start = dectoul(range + 15, &end);
+		last = *end == '-' && isdigit(end[1]) ?
+			dectoul(end + 1, NULL) : ULONG_MAX;
+		last = min(last, priv->http_file_size - 1);
+		if (resp->start >= priv->http_file_size || last < resp->start) {
+			status = "416 Range Not Satisfiable";
+			resp->start = 0;
+		} else {
+			status = "206 Partial Content";
+			resp->len = last - resp->start + 1;
+			if (priv->http_unknown_size)
+				snprintf(range_hdr, sizeof(range_hdr),
+					 "Content-Range: bytes %lu-%lu/*\r\n",
+					 resp->start, last);
+			else
+				snprintf(range_hdr, sizeof(range_hdr),
+					 "Content-Range: bytes %lu-%lu/%lu\r\n",
+					 resp->start, last,
+					 priv->http_file_size);
+		}
+	} else {
+		status = "200 OK";
+		resp->len = priv->http_file_size;
+	}
+	if (!priv->http_keep_alive)
+		conn->close = true;
+
+	resp->hdr_len = snprintf(resp->hdr, sizeof(resp->hdr),
+				 "HTTP/1.1 %s\r\nContent-Length: %lu\r\n%s%s\r\n",
+				 status, resp->len, range_hdr,
+				 conn->close ? "Connection: close\r\n" : "");
+}
+
+/*
+ * Copies up to @max bytes of the responses on a connection, from sequence
+ * number @seq to the end of the response it is in
+ *
+ * returns the number of bytes copied, 0 if everything has been sent
+ */
+static uint sb_http_data(struct eth_sandbox_http_conn *conn, u32 seq,
+			 uchar *buf, uint max)
+{
+	struct eth_sandbox_http_resp *resp;
+	uint i, count;
+	u32 off;
+
+	for (resp = conn->resp; resp < conn->resp + conn->nresp; resp++) {
+		off = seq - resp->seq;
+		if (off >= resp->hdr_len + resp->len)
+			continue;
+
+		count = min_t(ulong, resp->hdr_len + resp->len - off, max);
+		for (i = 0; i < count; i++, off++)
+			buf[i] = off < resp->hdr_len ? resp->hdr[off] :
+				sandbox_eth_http_byte(resp->start + off -
+						      resp->hdr_len);
+
+		return count;
+	}
+
+	return 0;
+}
+
+/* Moves on past @len sequence numbers, noting if they were sent before */
+static void sb_http_advance(struct eth_sandbox_priv *priv,
+			    struct eth_sandbox_http_conn *conn, uint len)
+{
+	if (sb_http_seq_after(conn->snd_max, conn->snd_nxt))
+		priv->http_rexmits++;
+	if (conn->snd_una == conn->snd_max)
+		conn->timer = get_timer(0);
+	conn->snd_nxt += len;
+	if (sb_http_seq_after(conn->snd_nxt, conn->snd_max))
+		conn->snd_max = conn->snd_nxt;
+}
+
+/* Goes back to send everything which is not acknowledged again */
+static void sb_http_rewind(struct eth_sandbox_http_conn *conn)
+{
+	conn->snd_nxt = conn->snd_una;
+	conn->fin_sent = false;
+	conn->held_len = 0;
+	conn->dupacks = 0;
+	conn->timer = get_timer(0);
+}
+
+/* Handles an acknowledgement from the client */
+static void sb_http_ack(struct eth_sandbox_priv *priv,
+			struct eth_sandbox_http_conn *conn, u32 ack, u16 win,
+			bool dup)
+{
+	struct eth_sandbox_http_resp *resp;
+
+	conn->wnd = (u32)win << conn->wscale;
+	priv->http_max_wnd = max(priv->http_max_wnd, conn->wnd);
+
+	if (sb_http_seq_after(ack, conn->snd_una) &&
+	    !sb_http_seq_after(ack, conn->snd_max)) {
+		conn->snd_una = ack;
+		if (sb_http_seq_after(ack, conn->snd_nxt))
+			conn->snd_nxt = ack;
+		conn->dupacks = 0;
+		conn->timer = get_timer(0);
+
+		/* Forget the responses which have all arrived */
+		while (conn->nresp) {
+			resp = &conn->resp[0];
+			if (sb_http_seq_after(resp->seq + resp->hdr_len +
+					      resp->len, ack))
+				break;
+			conn->nresp--;
+			memmove(conn->resp, conn->resp + 1,
+				conn->nresp * sizeof(conn->resp[0]));
+		}
+	} else if (dup && ack == conn->snd_una &&
+		   conn->snd_una != conn->snd_max) {
+		/* The client has missed a segment, so send it again */
+		priv->http_dupacks++;
+		if (++conn->dupacks == 3)
+			sb_http_rewind(conn);
+	}
+}
+
+/* Sends the next segment on a connection to the mock HTTP server, if any */
+static bool sb_http_push(struct eth_sandbox_priv *priv,
+			 struct eth_sandbox_http_conn *conn)
+{
+	uchar buf[TCP_MSS];
+	uint count, room;
+	bool rexmit;
+	u32 seq;
+
+	if (!conn->port || conn->fin_sent)
+		return false;
+	if (conn->syn_ack) {
+		sb_http_output(priv, conn, TCP_SYN | TCP_ACK, conn->snd_nxt - 1,
+			       NULL, 0);
+		conn->syn_ack = false;
+		return true;
+	}
+
+	/* Stay within the client's window */
+	room = conn->wnd - min(conn->snd_nxt - conn->snd_una, conn->wnd);
+	seq = conn->snd_nxt;
+	count = sb_http_data(conn, seq, buf, min_t(uint, room, TCP_MSS));
+	if (!count) {
+		if (conn->held_len) {
+			count = sb_http_data(conn, conn->held_seq, buf,
+					     conn->held_len);
+			sb_http_output(priv, conn, TCP_ACK | TCP_PUSH,
+				       conn->held_seq, buf, count);
+			conn->held_len = 0;
+			return true;
+		}
+		if (!room || !conn->close)
+			return false;
+		sb_http_advance(priv, conn, 1);
+		sb_http_output(priv, conn, TCP_FIN | TCP_ACK, seq, NULL, 0);
+		conn->fin_sent = true;
+		return true;
+	}
+	rexmit = sb_http_seq_after(conn->snd_max, seq);
+	sb_http_advance(priv, conn, count);
+
+	/* Lose or hold back some new segments, if the test asks for it */
+	if (!rexmit && (priv->http_drop || priv->http_reorder)) {
+		priv->http_segs++;
+		if (priv->http_drop && !(priv->http_segs % priv->http_drop))
+			return true;
+		if (priv->http_reorder && !conn->held_len &&
+		    !(priv->http_segs % priv->http_reorder)) {
+			conn->held_seq = seq;
+			conn->held_len = count;
+			return true;
+		}
+	}
+	sb_http_output(priv, conn, TCP_ACK | TCP_PUSH, seq, buf, count);
+
+	/* A segment held back follows straight after */
+	if (conn->held_len && priv->recv_packets < PKTBUFSRX) {
+		count = sb_http_data(conn, conn->held_seq, buf, conn->held_len);
+		sb_http_output(priv, conn, TCP_ACK | TCP_PUSH, conn->held_seq,
+			       buf, count);
+		conn->held_len = 0;
+	}
+
+	return true;
+}
+
+/* Sends from each connection in turn, while there is room */
+static void sb_http_send_all(struct eth_sandbox_priv *priv)
+{
+	struct eth_sandbox_http_conn *conn;
+	bool sent;
+	int i;
+
+	do {
+		sent = false;
+		for (i = 0; i < SB_HTTP_MAX_CONNS; i++) {
+			if (priv->recv_packets >= PKTBUFSRX)
+				return;
+			conn = &priv->http_conns[priv->http_next];
+			priv->http_next = (priv->http_next + 1) %
+				SB_HTTP_MAX_CONNS;
+			sent |= sb_http_push(priv, conn);
+		}
+	} while (sent);
+}
+
+/*
+ * sandbox_eth_http_req_to_reply()
+ *
+ * Check for a TCP segment sent to the mock HTTP server. If so, handle it and
+ * send whatever the server has ready, sharing the receive buffers between the
+ * connections in turn. Anything not acknowledged is sent again after three
+ * duplicate ACKs, or by sb_http_check_timeout().
+ *
+ * returns 0 if injected, -EAGAIN if not
+ */
+int sandbox_eth_http_req_to_reply(struct udevice *dev, void *packet,
+				  unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth = packet;
+	struct eth_sandbox_http_conn *conn, reset;
+	struct ip_tcp_hdr *ip;
+	char *data, *end;
+	int hdr_len;
+	uint dlen;
+	u32 seq;
+	u8 flags;
+
+	if (!IS_ENABLED(CONFIG_PROT_TCP))
+		return -EAGAIN;
+	if (ntohs(eth->et_protlen) != PROT_IP)
+		return -EAGAIN;
+
+	ip = packet + ETHER_HDR_SIZE;
+	if (ip->ip_p != IPPROTO_TCP || ntohs(ip->tcp_dst) != SB_HTTP_PORT)
+		return -EAGAIN;
+
+	hdr_len = (ip->tcp_hlen >> 4) * 4;
+	data = (void *)ip + IP_HDR_SIZE + hdr_len;
+	dlen = ntohs(ip->ip_len) - IP_HDR_SIZE - hdr_len;
+	seq = ntohl(ip->tcp_seq);
+	flags = ip->tcp_flags;
+	priv->http_max_seg = max(priv->http_max_seg, dlen);
+	conn = sb_http_find(priv, ntohs(ip->tcp_src));
+
+	if (flags & TCP_SYN) {
+		if (!conn)
+			conn = sb_http_find(priv, 0);
+		if (!conn)
+			return 0;
+		memset(conn, '\0', sizeof(*conn));
+		conn->port = ntohs(ip->tcp_src);
+		memcpy(conn->client_hwaddr, eth->et_src, ARP_HLEN);
+		conn->client_ip = net_read_ip(&ip->ip_src);
+		conn->server_ip = net_read_ip(&ip->ip_dst);
+
+		/* The SYN is sent again by the client if our reply is lost */
+		conn->snd_una = ++priv->http_syns * 100000 + 1;
+		conn->snd_nxt = conn->snd_una;
+		conn->snd_max = conn->snd_una;
+		conn->rcv_nxt = seq + 1;
+		conn->wnd = ntohs(ip->tcp_win);
+		conn->wscale = sb_http_wscale((u8 *)ip + IP_TCP_HDR_SIZE,
+					      hdr_len - TCP_HDR_SIZE);
+		conn->syn_ack = true;
+	} else if (!conn) {
+		/* Reset anything else sent to an unknown connection */
+		if ((flags & TCP_RST) || priv->recv_packets >= PKTBUFSRX)
+			return 0;
+		memset(&reset, '\0', sizeof(reset));
+		reset.port = ntohs(ip->tcp_src);
+		memcpy(reset.client_hwaddr, eth->et_src, ARP_HLEN);
+		reset.client_ip = net_read_ip(&ip->ip_src);
+		reset.server_ip = net_read_ip(&ip->ip_dst);
+		sb_http_output(priv, &reset, TCP_RST, ntohl(ip->tcp_ack), NULL,
+			       0);
+		return 0;
+	} else if (flags & TCP_RST) {
+		conn->port = 0;
+		return 0;
+	} else if (flags & TCP_ACK) {
+		sb_http_ack(priv, conn, ntohl(ip->tcp_ack), ntohs(ip->tcp_win),
+			    !dlen && !(flags & TCP_FIN));
+	}
+
+	if (dlen && seq == conn->rcv_nxt && priv->http_lose_reqs) {
+		priv->http_lose_reqs--;
+		return 0;
+	}
+
+	if (dlen && seq == conn->rcv_nxt &&
+	    conn->req_len + dlen < sizeof(conn->req)) {
+		memcpy(conn->req + conn->req_len, data, dlen);
+		conn->req_len += dlen;
+		conn->req[conn->req_len] = '\0';
+		conn->rcv_nxt += dlen;
+		while ((end = strstr(conn->req, "\r\n\r\n"))) {
+			end[2] = '\0';
+			sb_http_respond(priv, conn, conn->req);
+			conn->req_len -= end + 4 - conn->req;
+			memmove(conn->req, end + 4, conn->req_len + 1);
+		}
+	}
+
+	if ((flags & TCP_FIN) && seq + dlen == conn->rcv_nxt) {
+		if (priv->recv_packets >= PKTBUFSRX)
+			return 0;
+		conn->rcv_nxt++;
+		sb_http_output(priv, conn, conn->fin_sent ? TCP_ACK :
+			       TCP_FIN | TCP_ACK, conn->snd_nxt, NULL, 0);
+		conn->port = 0;
+		return 0;
+	}
+
+	sb_http_send_all(priv);
+
+	return 0;
+}
+
+/* Sends again what the clients of the mock HTTP server have not acknowledged */
+static void sb_http_check_timeout(struct eth_sandbox_priv *priv)
+{
+	struct eth_sandbox_http_conn *conn;
+	bool expired = false;
+	int i;
+
+	if (!IS_ENABLED(CONFIG_PROT_TCP))
+		return;
+
+	for (i = 0; i < SB_HTTP_MAX_CONNS; i++) {
+		conn = &priv->http_conns[i];
+		if (conn->port && conn->snd_una != conn->snd_max &&
+		    get_timer(conn->timer) > SB_HTTP_RTO_MS) {
+			sb_http_rewind(conn);
+			expired = true;
+		}
+	}
+	if (expired)
+		sb_http_send_all(priv);
+}
+
 /*
  * sandbox_eth_recv_arp_req()
  *
@@ -270,6 +868,10 @@ static int sb_default_handler(struct udevice *dev, void *packet,
 		return 0;
 	if (!sandbox_eth_ping_req_to_reply(dev, packet, len))
 		return 0;
+	if (!sandbox_eth_dhcp_req_to_reply(dev, packet, len))
+		return 0;
+	if (!sandbox_eth_http_req_to_reply(dev, packet, len))
+		return 0;
 
 	return 0;
 }
@@ -356,6 +958,9 @@ static int sb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 		skip_timeout = false;
 	}
 
+	if (!priv->recv_packets)
+		sb_http_check_timeout(priv);
+
 	if (priv->recv_packets) {
 		int lcl_recv_packet_length = priv->recv_packet_length[0];
 
@@ -425,6 +1030,10 @@ static int sb_eth_of_to_plat(struct udevice *dev)
 	pdata->iobase = dev_read_addr(dev);
 	priv->disabled = false;
 	priv->tx_handler = sb_default_handler;
+	priv->dhcp_ipaddr = string_to_ip("1.1.2.10");
+	priv->http_file_size = 0x1234;
+	priv->http_ranges = true;
+	priv->http_keep_alive = true;
 
 	return 0;
 }
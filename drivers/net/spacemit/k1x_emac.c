@@ -20,6 +20,7 @@
 #include <phy.h>
 #include <reset.h>
 #include <wait_bit.h>
+#include <linux/iopoll.h>
 #include "k1x_emac.h"
 
 #define TX_PHASE                1
@@ -27,6 +28,8 @@
 
 #define CLK_PHASE_REVERT        180
 
+#define EMAC_MDIO_TIMEOUT_US    10000
+
 
 /* Clock */
 #define K1X_APMU_BASE           0xd4282800
@@ -162,6 +165,7 @@ struct emac_priv {
     void *tx_dma_buf;
     void *rx_dma_buf;
     bool started;
+    bool phy_ready;
     int phy_reset_gpio;
     int ldo_gpio;
     int phy_addr;
@@ -414,26 +418,29 @@ static int emac_mdio_read(struct mii_dev *bus, int mdio_addr,
     struct emac_priv *priv = bus->priv;
     u32 cmd = 0;
     u32 val;
+    int ret;
 
     cmd |= mdio_addr & 0x1F;
     cmd |= (mdio_reg & 0x1F) << 5;
     cmd |= MREGBIT_START_MDIO_TRANS | MREGBIT_MDIO_READ_WRITE;
 
+    /*
+     * Background steps may run while this polls, so keep the PHY
+     * auto-negotiation task off the bus. Not all callers use phy_read().
+     */
+    bus->busy = true;
     emac_wr(priv, MAC_MDIO_DATA, 0x0);
     emac_wr(priv, MAC_MDIO_CONTROL, cmd);
 
-    val = emac_rd(priv, MAC_MDIO_CONTROL);
-    val = val >> 15 & 0x01;
-
-    while (val != 0) {
-        val = emac_rd(priv, MAC_MDIO_CONTROL);
-        val = val >> 15 & 0x01;
-        mdelay(5);
-    }
-
-    val = emac_rd(priv, MAC_MDIO_DATA);
+    /* A transaction takes tens of microseconds, so poll without sleeping */
+    ret = readl_poll_timeout(priv->io_base + MAC_MDIO_CONTROL, val,
+                             !(val & MREGBIT_START_MDIO_TRANS),
+                             EMAC_MDIO_TIMEOUT_US);
+    if (!ret)
+        ret = emac_rd(priv, MAC_MDIO_DATA);
+    bus->busy = false;
 
-    return val;
+    return ret;
 }
 
 static int emac_mdio_write(struct mii_dev *bus, int mdio_addr, int mdio_devad,
@@ -442,23 +449,23 @@ static int emac_mdio_write(struct mii_dev *bus, int mdio_addr, int mdio_devad,
     struct emac_priv *priv = bus->priv;
     u32 val;
     u32 cmd = 0;
-
-    emac_wr(priv, MAC_MDIO_DATA, mdio_val);
+    int ret;
 
     cmd |= mdio_addr & 0x1F;
     cmd |= (mdio_reg & 0x1F) << 5;
     cmd |= MREGBIT_START_MDIO_TRANS;
 
+    /* As emac_mdio_read() */
+    bus->busy = true;
+    emac_wr(priv, MAC_MDIO_DATA, mdio_val);
     emac_wr(priv, MAC_MDIO_CONTROL, cmd);
 
-    val = emac_rd(priv, MAC_MDIO_CONTROL);
-    val = val >> 15 & 0x01;
+    ret = readl_poll_timeout(priv->io_base + MAC_MDIO_CONTROL, val,
+                             !(val & MREGBIT_START_MDIO_TRANS),
+                             EMAC_MDIO_TIMEOUT_US);
+    bus->busy = false;
 
-    while (val != 0) {
-        val = emac_rd(priv, MAC_MDIO_CONTROL);
-        val = val >> 15 & 0x01;
-    }
-    return 0;
+    return ret;
 }
 
 static int emac_adjust_link(struct udevice *dev)
@@ -608,24 +615,19 @@ static int emac_phy_reset(struct emac_priv *priv)
     return 0;
 }
 
-static int emac_start(struct udevice *dev)
+/* Reset and configure the PHY, which starts auto-negotiation */
+static int emac_phy_init(struct udevice *dev)
 {
     struct emac_priv *priv = dev_get_priv(dev);
-    int ret, i;
-
-    debug("%s(dev=%p):\n", __func__, dev);
-
-    priv->tx_desc_idx = 0;
-    priv->rx_desc_idx = 0;
+    int ret;
 
     emac_phy_reset(priv);
 
     priv->phy = phy_connect(priv->mii, priv->phy_addr, dev,
                     priv->phy_interface);
     if (!priv->phy) {
-        ret = -1;
         pr_err("phy_connect() failed");
-        goto err_connect_phy;
+        return -ENODEV;
     }
 
     if (emac_is_rmii(priv))
@@ -634,10 +636,33 @@ static int emac_start(struct udevice *dev)
     ret = phy_config(priv->phy);
     if (ret < 0) {
         pr_err("phy_config() failed: %d", ret);
-        goto err_shutdown_phy;
+        phy_shutdown(priv->phy);
+        priv->phy = NULL;
+        return ret;
     }
+    priv->phy_ready = true;
+
+    return 0;
+}
+
+static int emac_start(struct udevice *dev)
+{
+    struct emac_priv *priv = dev_get_priv(dev);
+    int ret, i;
+
+    debug("%s(dev=%p):\n", __func__, dev);
 
-    ret = phy_startup(priv->phy);
+    priv->tx_desc_idx = 0;
+    priv->rx_desc_idx = 0;
+
+    /* With CONFIG_PHY_EARLY_ANEG this was done when probing */
+    if (!priv->phy_ready) {
+        ret = emac_phy_init(dev);
+        if (ret)
+            goto err_connect_phy;
+    }
+
+    ret = phy_aneg_wait(priv->phy);
     if (ret < 0) {
         pr_err("phy_startup() failed: %d", ret);
         goto err_shutdown_phy;
@@ -686,6 +711,7 @@ static int emac_start(struct udevice *dev)
 err_shutdown_phy:
     phy_shutdown(priv->phy);
     priv->phy = NULL;
+    priv->phy_ready = false;
 err_connect_phy:
     pr_err("FAILED: %d", ret);
     return ret;
@@ -701,9 +727,11 @@ void emac_stop(struct udevice *dev)
         return;
     priv->started = false;
 
+    /*
+     * Leave the PHY configured, so the link stays up for the next start.
+     * It is reset again only after an error or when the device is removed.
+     */
     emac_reset_hw(priv);
-    if (priv->phy)
-        phy_shutdown(priv->phy);
 
     priv->speed = -1;
     priv->duplex = -1;
@@ -1184,6 +1212,14 @@ static int emac_probe(struct udevice *dev)
         emac_set_clock_phase(dev, TX_PHASE);
         emac_set_clock_phase(dev, RX_PHASE);
     }
+
+    /*
+     * Let auto-negotiation run in the background. If this fails, it is
+     * tried again when the device is started.
+     */
+    if (IS_ENABLED(CONFIG_PHY_EARLY_ANEG) && !emac_phy_init(dev))
+        phy_aneg_start(priv->phy);
+
     debug("%s: OK\n", __func__);
     return 0;
 
@@ -1207,6 +1243,8 @@ static int emac_remove(struct udevice *dev)
 
     debug("%s(dev=%p):\n", __func__, dev);
 
+    if (priv->phy_ready)
+        phy_shutdown(priv->phy);
     emac_disable_clk(priv);
     mdio_unregister(priv->mii);
     mdio_free(priv->mii);
@@ -17,7 +17,7 @@
 #include <linux/compat.h>
 #include "nvme.h"
 
-#define NVME_Q_DEPTH		2
+#define NVME_Q_DEPTH		CONFIG_NVME_QUEUE_DEPTH
 #define NVME_AQ_DEPTH		2
 #define NVME_SQ_SIZE(depth)	(depth * sizeof(struct nvme_command))
 #define NVME_CQ_SIZE(depth)	(depth * sizeof(struct nvme_completion))
@@ -25,7 +25,8 @@
 				      ARCH_DMA_MINALIGN)
 #define ADMIN_TIMEOUT		60
 #define IO_TIMEOUT		30
-#define MAX_PRP_POOL		512
+/* Largest I/O command; larger transfers are split into several in flight */
+#define NVME_MAX_XFER_SHIFT	20
 
 static int nvme_wait_csts(struct nvme_dev *dev, u32 mask, u32 val)
 {
@@ -44,8 +45,23 @@ static int nvme_wait_csts(struct nvme_dev *dev, u32 mask, u32 val)
 	return -ETIME;
 }
 
-static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
-			   int total_len, u64 dma_addr)
+/* Number of pages of PRP lists needed for a transfer of 2^shift bytes */
+static u32 nvme_prp_pages(struct nvme_dev *dev, u32 shift)
+{
+	u32 prps_per_page = dev->page_size >> 3;
+	u32 nprps = max((1U << shift) / dev->page_size, 2U);
+
+	return DIV_ROUND_UP(nprps - 1, prps_per_page - 1);
+}
+
+/* PRP lists for the I/O command with a given ID */
+static u64 *nvme_prp_list(struct nvme_dev *dev, int slot)
+{
+	return (void *)dev->prp_pool + slot * dev->prp_pool_stride;
+}
+
+static void nvme_setup_prps(struct nvme_dev *dev, u64 *prp2, u64 *prp_list,
+			    int total_len, u64 dma_addr)
 {
 	u32 page_size = dev->page_size;
 	int offset = dma_addr & (page_size - 1);
@@ -59,7 +75,7 @@ static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
 
 	if (length <= 0) {
 		*prp2 = 0;
-		return 0;
+		return;
 	}
 
 	if (length)
@@ -67,45 +83,29 @@ static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
 
 	if (length <= page_size) {
 		*prp2 = dma_addr;
-		return 0;
+		return;
 	}
 
 	nprps = DIV_ROUND_UP(length, page_size);
 	num_pages = DIV_ROUND_UP(nprps - 1, prps_per_page - 1);
 
-	if (nprps > dev->prp_entry_num) {
-		free(dev->prp_pool);
-		/*
-		 * Always increase in increments of pages.  It doesn't waste
-		 * much memory and reduces the number of allocations.
-		 */
-		dev->prp_pool = memalign(page_size, num_pages * page_size);
-		if (!dev->prp_pool) {
-			printf("Error: malloc prp_pool fail\n");
-			return -ENOMEM;
-		}
-		dev->prp_entry_num = num_pages * (prps_per_page - 1) + 1;
-	}
-
-	prp_pool = dev->prp_pool;
+	prp_pool = prp_list;
 	i = 0;
 	while (nprps) {
 		if ((i == (prps_per_page - 1)) && nprps > 1) {
 			*(prp_pool + i) = cpu_to_le64((ulong)prp_pool +
 					page_size);
 			i = 0;
-			prp_pool += page_size;
+			prp_pool = (void *)prp_pool + page_size;
 		}
 		*(prp_pool + i++) = cpu_to_le64(dma_addr);
 		dma_addr += page_size;
 		nprps--;
 	}
-	*prp2 = (ulong)dev->prp_pool;
+	*prp2 = (ulong)prp_list;
 
-	flush_dcache_range((ulong)dev->prp_pool, (ulong)dev->prp_pool +
+	flush_dcache_range((ulong)prp_list, (ulong)prp_list +
 			   num_pages * page_size);
-
-	return 0;
 }
 
 static __le16 nvme_get_cmd_id(void)
@@ -217,6 +217,157 @@ static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
 	return status;
 }
 
+/**
+ * nvme_get_completion() - take the next entry from a completion queue
+ *
+ * @nvmeq:	The queue to check
+ * @cqe:	Returns a copy of the entry
+ * Return: 0 if OK, -EAGAIN if there is no new entry
+ */
+static int nvme_get_completion(struct nvme_queue *nvmeq,
+			       struct nvme_completion *cqe)
+{
+	u16 head = nvmeq->cq_head;
+	u16 status;
+
+	status = nvme_read_completion_status(nvmeq, head);
+	if ((status & 0x01) != nvmeq->cq_phase)
+		return -EAGAIN;
+	*cqe = nvmeq->cqes[head];
+
+	if (++head == nvmeq->q_depth) {
+		head = 0;
+		nvmeq->cq_phase = !nvmeq->cq_phase;
+	}
+	writel(head, nvmeq->q_db + nvmeq->dev->db_stride);
+	nvmeq->cq_head = head;
+
+	return 0;
+}
+
+/* Number of I/O commands which can be in flight at once on a queue */
+static int nvme_max_inflight(struct nvme_queue *nvmeq)
+{
+	struct nvme_ops *ops;
+
+	/* Controllers with their own completion handling take one at a time */
+	ops = (struct nvme_ops *)nvmeq->dev->udev->driver->ops;
+	if (ops && ops->complete_cmd)
+		return 1;
+
+	/* A full queue would look the same as an empty one */
+	return nvmeq->q_depth - 1;
+}
+
+/**
+ * nvme_submit_io_cmd() - start an I/O command without waiting for it
+ *
+ * The caller must make sure that fewer than nvme_max_inflight() commands
+ * are in flight.
+ *
+ * @nvmeq:	The queue to use
+ * @cmd:	The command to send, with the command ID set up by this function
+ * @slot:	ID of the command, as returned by nvme_get_slot()
+ */
+static void nvme_submit_io_cmd(struct nvme_queue *nvmeq,
+			       struct nvme_command *cmd, int slot)
+{
+	nvmeq->reqs[slot].busy = true;
+	nvmeq->reqs[slot].slba = le64_to_cpu(cmd->rw.slba);
+	nvmeq->inflight++;
+	cmd->common.command_id = cpu_to_le16(slot);
+	nvme_submit_cmd(nvmeq, cmd);
+}
+
+/* Get a free command ID, which is also the index of its PRP lists */
+static int nvme_get_slot(struct nvme_queue *nvmeq)
+{
+	int i;
+
+	for (i = 0; i < nvmeq->q_depth; i++) {
+		if (!nvmeq->reqs[i].busy)
+			return i;
+	}
+
+	return -ENOSPC;
+}
+
+/**
+ * nvme_wait_io_cmd() - wait for the next I/O command to complete
+ *
+ * Commands complete in any order, so this returns the ID of whichever one
+ * did.
+ *
+ * @nvmeq:	The queue to use
+ * @cmd:	The last command sent, for nvme_ops->complete_cmd()
+ * @failedp:	Returns true if the command failed
+ * Return: ID of the command which completed, -EAGAIN if a command abandoned
+ *	earlier completed, freeing its slot, -ETIMEDOUT if nothing completed
+ *	in time, -EBADMSG if the completion is not for a command in flight
+ */
+static int nvme_wait_io_cmd(struct nvme_queue *nvmeq,
+			    struct nvme_command *cmd, bool *failedp)
+{
+	ulong timeout_us = IO_TIMEOUT * 100000;
+	struct nvme_completion cqe;
+	struct nvme_ops *ops;
+	struct nvme_req *req;
+	ulong start_time;
+	u16 status;
+	int slot;
+
+	start_time = timer_get_us();
+	while (nvme_get_completion(nvmeq, &cqe)) {
+		if (timer_get_us() - start_time >= timeout_us)
+			return -ETIMEDOUT;
+	}
+
+	ops = (struct nvme_ops *)nvmeq->dev->udev->driver->ops;
+	if (ops && ops->complete_cmd)
+		ops->complete_cmd(nvmeq, cmd);
+
+	slot = le16_to_cpu(cqe.command_id);
+	if (slot >= nvmeq->q_depth || !nvmeq->reqs[slot].busy) {
+		printf("ERROR: unexpected command ID %x\n", slot);
+		return -EBADMSG;
+	}
+	req = &nvmeq->reqs[slot];
+	req->busy = false;
+	nvmeq->inflight--;
+	if (req->abandoned) {
+		req->abandoned = false;
+		return -EAGAIN;
+	}
+
+	status = le16_to_cpu(cqe.status) >> 1;
+	*failedp = status != 0;
+	if (status)
+		printf("ERROR: status = %x, lba = %llx\n", status, req->slba);
+
+	return slot;
+}
+
+/*
+ * Stop waiting for the I/O commands still in flight after an error, returning
+ * the lowest logical block they cover. Their slots are only freed when they
+ * complete, since until then the controller may use their PRP lists.
+ */
+static u64 nvme_abandon_io_cmds(struct nvme_queue *nvmeq, u64 end)
+{
+	struct nvme_req *req;
+	int i;
+
+	for (i = 0; i < nvmeq->q_depth; i++) {
+		req = &nvmeq->reqs[i];
+		if (req->busy && !req->abandoned) {
+			end = min(end, req->slba);
+			req->abandoned = true;
+		}
+	}
+
+	return end;
+}
+
 static int nvme_submit_admin_cmd(struct nvme_dev *dev, struct nvme_command *cmd,
 				 u32 *result)
 {
@@ -243,6 +394,10 @@ static struct nvme_queue *nvme_alloc_queue(struct nvme_dev *dev,
 		goto free_queue;
 	memset((void *)nvmeq->sq_cmds, 0, NVME_SQ_SIZE(depth));
 
+	nvmeq->reqs = calloc(depth, sizeof(struct nvme_req));
+	if (!nvmeq->reqs)
+		goto free_sq;
+
 	nvmeq->dev = dev;
 
 	nvmeq->cq_head = 0;
@@ -259,6 +414,8 @@ static struct nvme_queue *nvme_alloc_queue(struct nvme_dev *dev,
 
 	return nvmeq;
 
+ free_sq:
+	free(nvmeq->sq_cmds);
  free_queue:
 	free((void *)nvmeq->cqes);
  free_nvmeq:
@@ -317,6 +474,7 @@ static int nvme_shutdown_ctrl(struct nvme_dev *dev)
 
 static void nvme_free_queue(struct nvme_queue *nvmeq)
 {
+	free(nvmeq->reqs);
 	free((void *)nvmeq->cqes);
 	free(nvmeq->sq_cmds);
 	free(nvmeq);
@@ -342,6 +500,8 @@ static void nvme_init_queue(struct nvme_queue *nvmeq, u16 qid)
 	nvmeq->cq_head = 0;
 	nvmeq->cq_phase = 1;
 	nvmeq->q_db = &dev->dbs[qid * 2 * dev->db_stride];
+	nvmeq->inflight = 0;
+	memset(nvmeq->reqs, '\0', nvmeq->q_depth * sizeof(struct nvme_req));
 	memset((void *)nvmeq->cqes, 0, NVME_CQ_SIZE(nvmeq->q_depth));
 	flush_dcache_range((ulong)nvmeq->cqes,
 			   (ulong)nvmeq->cqes + NVME_CQ_ALLOCATION);
@@ -640,7 +800,8 @@ static int nvme_get_info_from_identify(struct nvme_dev *dev)
 	memcpy(dev->model, ctrl->mn, sizeof(ctrl->mn));
 	memcpy(dev->firmware_rev, ctrl->fr, sizeof(ctrl->fr));
 	if (ctrl->mdts)
-		dev->max_transfer_shift = (ctrl->mdts + shift);
+		dev->max_transfer_shift = min(ctrl->mdts + shift,
+					      NVME_MAX_XFER_SHIFT);
 	else {
 		/*
 		 * Maximum Data Transfer Size (MDTS) field indicates the maximum
@@ -650,17 +811,11 @@ static int nvme_get_info_from_identify(struct nvme_dev *dev)
 		 * and is reported as a power of two (2^n).
 		 *
 		 * The spec also says: a value of 0h indicates no restrictions
-		 * on transfer size. But in nvme_blk_read/write() below we have
-		 * the following algorithm for maximum number of logic blocks
-		 * per transfer:
-		 *
-		 * u16 lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
-		 *
-		 * In order for lbas not to overflow, the maximum number is 15
-		 * which means dev->max_transfer_shift = 15 + 9 (ns->lba_shift).
-		 * Let's use 20 which provides 1MB size.
+		 * on transfer size. Larger transfers are split into several
+		 * commands in flight at once, so there is little to gain from
+		 * commands larger than 1MB, and each needs a larger PRP list.
 		 */
-		dev->max_transfer_shift = 20;
+		dev->max_transfer_shift = NVME_MAX_XFER_SHIFT;
 	}
 
 	free(ctrl);
@@ -746,60 +901,70 @@ static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
 {
 	struct nvme_ns *ns = dev_get_priv(udev);
 	struct nvme_dev *dev = ns->dev;
+	struct nvme_queue *nvmeq = dev->queues[NVME_IO_Q];
 	struct nvme_command c;
 	struct blk_desc *desc = dev_get_uclass_plat(udev);
-	int status;
-	u64 prp2;
+	int max_inflight = nvme_max_inflight(nvmeq);
 	u64 total_len = blkcnt << desc->log2blksz;
-	u64 temp_len = total_len;
 	uintptr_t temp_buffer = (uintptr_t)buffer;
-
+	u32 max_lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
 	u64 slba = blknr;
-	u16 lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
-	u64 total_lbas = blkcnt;
+	u64 end = blknr + blkcnt;
+	int pending = 0;
+	bool failed;
+	int slot;
 
 	flush_dcache_range((unsigned long)buffer,
 			   (unsigned long)buffer + total_len);
 
+	memset(&c, '\0', sizeof(c));
 	c.rw.opcode = read ? nvme_cmd_read : nvme_cmd_write;
-	c.rw.flags = 0;
 	c.rw.nsid = cpu_to_le32(ns->ns_id);
-	c.rw.control = 0;
-	c.rw.dsmgmt = 0;
-	c.rw.reftag = 0;
-	c.rw.apptag = 0;
-	c.rw.appmask = 0;
-	c.rw.metadata = 0;
-
-	while (total_lbas) {
-		if (total_lbas < lbas) {
-			lbas = (u16)total_lbas;
-			total_lbas = 0;
-		} else {
-			total_lbas -= lbas;
+
+	/*
+	 * Keep up to max_inflight commands in flight, including any abandoned
+	 * by an earlier transfer. If one fails, stop at its first block and
+	 * report the blocks before that as done.
+	 */
+	while (slba < end || pending) {
+		if (slba < end && nvmeq->inflight < max_inflight) {
+			u32 lbas = min_t(u64, end - slba, max_lbas);
+			u64 prp2;
+
+			slot = nvme_get_slot(nvmeq);
+			nvme_setup_prps(dev, &prp2, nvme_prp_list(dev, slot),
+					lbas << ns->lba_shift, temp_buffer);
+			c.rw.slba = cpu_to_le64(slba);
+			c.rw.length = cpu_to_le16(lbas - 1);
+			c.rw.prp1 = cpu_to_le64(temp_buffer);
+			c.rw.prp2 = cpu_to_le64(prp2);
+			nvme_submit_io_cmd(nvmeq, &c, slot);
+			pending++;
+			slba += lbas;
+			temp_buffer += (ulong)lbas << ns->lba_shift;
+			continue;
 		}
 
-		if (nvme_setup_prps(dev, &prp2,
-				    lbas << ns->lba_shift, temp_buffer))
-			return -EIO;
-		c.rw.slba = cpu_to_le64(slba);
-		slba += lbas;
-		c.rw.length = cpu_to_le16(lbas - 1);
-		c.rw.prp1 = cpu_to_le64(temp_buffer);
-		c.rw.prp2 = cpu_to_le64(prp2);
-		status = nvme_submit_sync_cmd(dev->queues[NVME_IO_Q],
-				&c, NULL, IO_TIMEOUT);
-		if (status)
-			break;
-		temp_len -= (u32)lbas << ns->lba_shift;
-		temp_buffer += lbas << ns->lba_shift;
+		slot = nvme_wait_io_cmd(nvmeq, &c, &failed);
+		if (slot == -EAGAIN)
+			continue;
+		if (slot < 0) {
+			printf("ERROR: %s: I/O failed (err=%d)\n", udev->name,
+			       slot);
+			end = nvme_abandon_io_cmds(nvmeq, min(end, slba));
+			pending = 0;
+			continue;
+		}
+		pending--;
+		if (failed)
+			end = min(end, nvmeq->reqs[slot].slba);
 	}
 
 	if (read)
 		invalidate_dcache_range((unsigned long)buffer,
 					(unsigned long)buffer + total_len);
 
-	return (total_len - temp_len) >> desc->log2blksz;
+	return end - blknr;
 }
 
 static ulong nvme_blk_read(struct udevice *udev, lbaint_t blknr,
@@ -851,6 +1016,8 @@ int nvme_init(struct udevice *udev)
 
 	ndev->cap = nvme_readq(&ndev->bar->cap);
 	ndev->q_depth = min_t(int, NVME_CAP_MQES(ndev->cap) + 1, NVME_Q_DEPTH);
+	if (ndev->max_q_depth)
+		ndev->q_depth = min(ndev->q_depth, ndev->max_q_depth);
 	ndev->db_stride = 1 << NVME_CAP_STRIDE(ndev->cap);
 	ndev->dbs = ((void __iomem *)ndev->bar) + 4096;
 
@@ -860,23 +1027,26 @@ int nvme_init(struct udevice *udev)
 		goto free_queue;
 	}
 
-	/* Allocate after the page size is known */
-	ndev->prp_pool = memalign(ndev->page_size, MAX_PRP_POOL);
-	if (!ndev->prp_pool) {
-		ret = -ENOMEM;
-		printf("Error: %s: Out of memory!\n", udev->name);
-		goto free_nvme;
-	}
-	ndev->prp_entry_num = MAX_PRP_POOL >> 3;
-
 	ret = nvme_setup_io_queues(ndev);
 	if (ret) {
 		log_debug("Unable to setup I/O queues(err=%dE)\n", ret);
 		goto free_queue;
 	}
 
+	ndev->max_transfer_shift = NVME_MAX_XFER_SHIFT;
 	nvme_get_info_from_identify(ndev);
 
+	/* Allocate once the page size and largest transfer are known */
+	ndev->prp_pool_stride = nvme_prp_pages(ndev, ndev->max_transfer_shift) *
+		ndev->page_size;
+	ndev->prp_pool = memalign(ndev->page_size,
+				  ndev->q_depth * ndev->prp_pool_stride);
+	if (!ndev->prp_pool) {
+		ret = -ENOMEM;
+		printf("Error: %s: Out of memory!\n", udev->name);
+		goto free_queue;
+	}
+
 	/* Create a blk device for each namespace */
 
 	id = memalign(ndev->page_size, sizeof(struct nvme_id_ns));
@@ -605,6 +605,7 @@ struct nvme_dev {
 	unsigned online_queues;
 	unsigned max_qid;
 	int q_depth;
+	int max_q_depth;	/* limit of the controller, if CAP.MQES is not */
 	u32 db_stride;
 	u32 ctrl_config;
 	struct nvme_bar __iomem *bar;
@@ -618,8 +619,8 @@ struct nvme_dev {
 	u32 stripe_size;
 	u32 page_size;
 	u8 vwc;
-	u64 *prp_pool;
-	u32 prp_entry_num;
+	u64 *prp_pool;		/* PRP lists for each I/O queue entry */
+	u32 prp_pool_stride;	/* bytes of PRP lists for each entry */
 	u32 nn;
 };
 
@@ -630,6 +631,26 @@ enum nvme_queue_id {
 	NVME_Q_NUM,
 };
 
+/**
+ * struct nvme_req - an I/O command which has been submitted
+ *
+ * The command ID of each I/O command is the index of its request, which
+ * also selects its PRP lists in the pool.
+ *
+ * A command which times out is abandoned, but its command ID and PRP lists
+ * stay reserved until the controller completes it, since the controller may
+ * still be using them.
+ *
+ * @busy:	true if the command has not completed
+ * @abandoned:	true if the command timed out, so its completion is ignored
+ * @slba:	first logical block of the command
+ */
+struct nvme_req {
+	bool busy;
+	bool abandoned;
+	u64 slba;
+};
+
 /*
  * An NVM Express queue. Each device has at least two (one for admin
  * commands and one for I/O commands).
@@ -647,6 +668,8 @@ struct nvme_queue {
 	u16 qid;
 	u8 cq_phase;
 	u8 cqe_seen;
+	u16 inflight;		/* I/O commands submitted but not completed */
+	struct nvme_req *reqs;	/* one for each queue entry */
 	unsigned long cmdid_data[];
 };
 
@@ -248,6 +248,7 @@ static int apple_nvme_probe(struct udevice *dev)
 	       priv->base + ANS_UNKNOWN_CTRL);
 
 	strcpy(priv->ndev.vendor, "Apple");
+	priv->ndev.max_q_depth = ANS_MAX_QUEUE_DEPTH;
 
 	writel((ANS_NVMMU_TCB_SIZE / ANS_NVMMU_TCB_PITCH) - 1,
 	       priv->base + ANS_NVMMU_NUM);
@@ -0,0 +1,356 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Emulated NVMe controller for sandbox tests
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <malloc.h>
+#include <asm/test.h>
+#include <linux/kernel.h>
+#include "nvme.h"
+
+#define SANDBOX_NVME_LBA_SHIFT	9
+#define SANDBOX_NVME_BLOCKS	2048	/* 1MiB namespace */
+#define SANDBOX_NVME_MDTS	1	/* 8KiB per command, to use PRP lists */
+#define SANDBOX_NVME_REGS_SIZE	8192	/* registers, then the doorbells */
+
+/* A completion which the controller has not posted yet */
+struct sandbox_nvme_cqe {
+	u16 cid;
+	u16 status;
+};
+
+struct sandbox_nvme_priv {
+	struct nvme_dev ndev;
+	struct nvme_bar *bar;
+	char *buf;		/* Namespace contents */
+	struct nvme_queue *queues[NVME_Q_NUM];
+	u16 cq_tail[NVME_Q_NUM];
+	u8 cq_phase[NVME_Q_NUM];
+	bool busy[CONFIG_NVME_QUEUE_DEPTH];	/* I/O command IDs in use */
+	uint inflight;		/* I/O commands not yet completed */
+	uint max_inflight;	/* Most I/O commands in flight at once */
+	uint cid_errs;		/* I/O commands sent with an ID in use */
+	uint reorder;		/* I/O completions held to post in reverse */
+	uint nheld;
+	struct sandbox_nvme_cqe held[CONFIG_NVME_QUEUE_DEPTH];
+	uint hang_cmd;		/* I/O command to hold, counting from 1 */
+	bool hung;		/* hang_cqe is waiting to be posted */
+	struct sandbox_nvme_cqe hang_cqe;
+	int max_q_depth;	/* Most entries taken in a queue, 0 for no limit */
+};
+
+/**
+ * struct sandbox_nvme_plat - settings which must be made before probing
+ *
+ * @max_q_depth: Limit on queue entries to give the driver, 0 for none
+ */
+struct sandbox_nvme_plat {
+	int max_q_depth;
+};
+
+static struct sandbox_nvme_priv *sandbox_nvme_get_priv(struct nvme_queue *nvmeq)
+{
+	return container_of(nvmeq->dev, struct sandbox_nvme_priv, ndev);
+}
+
+/* Add a completion to a queue, as the controller does when it finishes */
+static void sandbox_nvme_post(struct sandbox_nvme_priv *priv, int qid,
+			      const struct sandbox_nvme_cqe *ent, u32 result)
+{
+	struct nvme_queue *nvmeq = priv->queues[qid];
+	struct nvme_completion *cqe = &nvmeq->cqes[priv->cq_tail[qid]];
+
+	cqe->result = cpu_to_le32(result);
+	cqe->sq_head = 0;
+	cqe->sq_id = cpu_to_le16(qid);
+	cqe->command_id = ent->cid;
+	cqe->status = cpu_to_le16(ent->status << 1 | priv->cq_phase[qid]);
+	if (++priv->cq_tail[qid] == nvmeq->q_depth) {
+		priv->cq_tail[qid] = 0;
+		priv->cq_phase[qid] = !priv->cq_phase[qid];
+	}
+
+	if (qid == NVME_IO_Q) {
+		priv->busy[le16_to_cpu(ent->cid)] = false;
+		priv->inflight--;
+	}
+}
+
+/*
+ * Copy data between the namespace and the host pages given by the PRP
+ * entries of a command, following PRP lists as the host sets them up
+ */
+static void sandbox_nvme_copy(struct sandbox_nvme_priv *priv,
+			      struct nvme_common_command *cmd, char *data,
+			      u32 len, bool to_host)
+{
+	u32 page_size = priv->ndev.page_size;
+	u32 prps_per_page = page_size >> 3;
+	u64 addr = le64_to_cpu(cmd->prp1);
+	u64 *list = NULL;
+	u32 chunk;
+	int i = 0;
+
+	while (len) {
+		chunk = min(len, page_size - (u32)(addr & (page_size - 1)));
+		if (to_host)
+			memcpy((void *)(uintptr_t)addr, data, chunk);
+		else
+			memcpy(data, (void *)(uintptr_t)addr, chunk);
+		data += chunk;
+		len -= chunk;
+		if (!len)
+			break;
+
+		if (!list) {
+			if (len <= page_size) {
+				addr = le64_to_cpu(cmd->prp2);
+				continue;
+			}
+			list = (u64 *)(uintptr_t)le64_to_cpu(cmd->prp2);
+		} else if (i == prps_per_page - 1 && len > page_size) {
+			list = (u64 *)(uintptr_t)le64_to_cpu(list[i]);
+			i = 0;
+		}
+		addr = le64_to_cpu(list[i++]);
+	}
+}
+
+static u16 sandbox_nvme_identify(struct sandbox_nvme_priv *priv,
+				 struct nvme_command *cmd)
+{
+	union {
+		struct nvme_id_ctrl ctrl;
+		struct nvme_id_ns ns;
+	} *id;
+
+	id = calloc(1, sizeof(*id));
+	if (!id)
+		return NVME_SC_INTERNAL;
+
+	if (le32_to_cpu(cmd->identify.cns)) {
+		id->ctrl.nn = cpu_to_le32(1);
+		id->ctrl.mdts = SANDBOX_NVME_MDTS;
+		memcpy(id->ctrl.sn, "SANDBOX1", 8);
+		memcpy(id->ctrl.mn, "Sandbox NVMe", 12);
+		memcpy(id->ctrl.fr, "1.0", 3);
+	} else if (le32_to_cpu(cmd->identify.nsid) == 1) {
+		id->ns.nsze = cpu_to_le64(SANDBOX_NVME_BLOCKS);
+		id->ns.ncap = id->ns.nsze;
+		id->ns.lbaf[0].ds = SANDBOX_NVME_LBA_SHIFT;
+	}
+	sandbox_nvme_copy(priv, &cmd->common, (char *)id,
+			  sizeof(struct nvme_id_ctrl), true);
+	free(id);
+
+	return NVME_SC_SUCCESS;
+}
+
+static u16 sandbox_nvme_admin(struct sandbox_nvme_priv *priv,
+			      struct nvme_command *cmd, u32 *resultp)
+{
+	switch (cmd->common.opcode) {
+	case nvme_admin_identify:
+		return sandbox_nvme_identify(priv, cmd);
+	case nvme_admin_set_features:
+		/* One I/O submission and completion queue */
+		*resultp = 0;
+		return NVME_SC_SUCCESS;
+	case nvme_admin_create_cq:
+	case nvme_admin_create_sq:
+		/* The qsize fields of both commands are in the same place */
+		if (priv->max_q_depth &&
+		    le16_to_cpu(cmd->create_cq.qsize) >= priv->max_q_depth)
+			return NVME_SC_QUEUE_SIZE;
+		return NVME_SC_SUCCESS;
+	case nvme_admin_delete_cq:
+	case nvme_admin_delete_sq:
+		return NVME_SC_SUCCESS;
+	default:
+		return NVME_SC_INVALID_OPCODE;
+	}
+}
+
+static u16 sandbox_nvme_rw(struct sandbox_nvme_priv *priv,
+			   struct nvme_rw_command *rw)
+{
+	u64 slba = le64_to_cpu(rw->slba);
+	u32 nlb = le16_to_cpu(rw->length) + 1;
+
+	if (slba + nlb > SANDBOX_NVME_BLOCKS)
+		return NVME_SC_LBA_RANGE;
+	sandbox_nvme_copy(priv, (struct nvme_common_command *)rw,
+			  priv->buf + (slba << SANDBOX_NVME_LBA_SHIFT),
+			  nlb << SANDBOX_NVME_LBA_SHIFT,
+			  rw->opcode == nvme_cmd_read);
+
+	return NVME_SC_SUCCESS;
+}
+
+/*
+ * Carry out each command as it is submitted. Completions are posted at once,
+ * unless the test has asked for them to be held back.
+ */
+static void sandbox_nvme_submit_cmd(struct nvme_queue *nvmeq,
+				    struct nvme_command *cmd)
+{
+	struct sandbox_nvme_priv *priv = sandbox_nvme_get_priv(nvmeq);
+	struct sandbox_nvme_cqe ent;
+	u32 result = 0;
+	int cid, i;
+
+	ent.cid = cmd->common.command_id;
+	if (nvmeq->qid == NVME_ADMIN_Q) {
+		ent.status = sandbox_nvme_admin(priv, cmd, &result);
+		sandbox_nvme_post(priv, NVME_ADMIN_Q, &ent, result);
+		return;
+	}
+
+	cid = le16_to_cpu(cmd->common.command_id);
+	if (cid >= nvmeq->q_depth || priv->busy[cid]) {
+		priv->cid_errs++;
+		return;
+	}
+	priv->busy[cid] = true;
+	priv->inflight++;
+	priv->max_inflight = max(priv->max_inflight, priv->inflight);
+
+	switch (cmd->common.opcode) {
+	case nvme_cmd_read:
+	case nvme_cmd_write:
+		ent.status = sandbox_nvme_rw(priv, &cmd->rw);
+		break;
+	default:
+		ent.status = NVME_SC_INVALID_OPCODE;
+		break;
+	}
+
+	if (priv->hang_cmd && !--priv->hang_cmd) {
+		priv->hang_cqe = ent;
+		priv->hung = true;
+	} else if (priv->reorder) {
+		priv->held[priv->nheld++] = ent;
+		if (priv->nheld == priv->reorder) {
+			for (i = priv->nheld - 1; i >= 0; i--)
+				sandbox_nvme_post(priv, NVME_IO_Q,
+						  &priv->held[i], 0);
+			priv->nheld = 0;
+		}
+	} else {
+		sandbox_nvme_post(priv, NVME_IO_Q, &ent, 0);
+	}
+}
+
+static int sandbox_nvme_setup_queue(struct nvme_queue *nvmeq)
+{
+	struct sandbox_nvme_priv *priv = sandbox_nvme_get_priv(nvmeq);
+
+	priv->queues[nvmeq->qid] = nvmeq;
+	priv->cq_tail[nvmeq->qid] = 0;
+	priv->cq_phase[nvmeq->qid] = 1;
+
+	/*
+	 * Register writes cannot be seen here, so report the controller as
+	 * ready once the admin queue is set up, which is between the driver
+	 * disabling and enabling it
+	 */
+	if (nvmeq->qid == NVME_ADMIN_Q)
+		priv->bar->csts = NVME_CSTS_RDY;
+
+	return 0;
+}
+
+void sandbox_nvme_set_reorder(struct udevice *dev, uint count)
+{
+	struct sandbox_nvme_priv *priv = dev_get_priv(dev);
+
+	priv->reorder = min(count, (uint)CONFIG_NVME_QUEUE_DEPTH);
+	priv->nheld = 0;
+}
+
+void sandbox_nvme_set_hang(struct udevice *dev, uint cmd)
+{
+	struct sandbox_nvme_priv *priv = dev_get_priv(dev);
+
+	if (priv->hung) {
+		sandbox_nvme_post(priv, NVME_IO_Q, &priv->hang_cqe, 0);
+		priv->hung = false;
+	}
+	priv->hang_cmd = cmd;
+}
+
+void sandbox_nvme_set_max_depth(struct udevice *dev, int depth)
+{
+	struct sandbox_nvme_plat *plat = dev_get_plat(dev);
+
+	plat->max_q_depth = depth;
+}
+
+uint sandbox_nvme_get_inflight(struct udevice *dev, uint *maxp, uint *errsp)
+{
+	struct sandbox_nvme_priv *priv = dev_get_priv(dev);
+
+	*maxp = priv->max_inflight;
+	*errsp = priv->cid_errs;
+
+	return priv->inflight;
+}
+
+static int sandbox_nvme_probe(struct udevice *dev)
+{
+	struct sandbox_nvme_plat *plat = dev_get_plat(dev);
+	struct sandbox_nvme_priv *priv = dev_get_priv(dev);
+
+	priv->bar = memalign(4096, SANDBOX_NVME_REGS_SIZE);
+	priv->buf = calloc(SANDBOX_NVME_BLOCKS, 1 << SANDBOX_NVME_LBA_SHIFT);
+	if (!priv->bar || !priv->buf)
+		return -ENOMEM;
+	memset(priv->bar, '\0', SANDBOX_NVME_REGS_SIZE);
+
+	/* Queues up to the configured depth, with a 500ms timeout */
+	priv->bar->cap = (CONFIG_NVME_QUEUE_DEPTH - 1) | 1 << 24;
+	priv->bar->vs = NVME_VS(1, 3);
+
+	strcpy(priv->ndev.vendor, "Sandbox");
+	priv->ndev.instance = dev_seq(dev);
+	priv->max_q_depth = plat->max_q_depth;
+	priv->ndev.max_q_depth = plat->max_q_depth;
+	priv->ndev.bar = priv->bar;
+
+	return nvme_init(dev);
+}
+
+static int sandbox_nvme_remove(struct udevice *dev)
+{
+	struct sandbox_nvme_priv *priv = dev_get_priv(dev);
+
+	free(priv->buf);
+	free(priv->bar);
+
+	return 0;
+}
+
+static const struct nvme_ops sandbox_nvme_ops = {
+	.setup_queue = sandbox_nvme_setup_queue,
+	.submit_cmd = sandbox_nvme_submit_cmd,
+};
+
+static const struct udevice_id sandbox_nvme_ids[] = {
+	{ .compatible = "sandbox,nvme" },
+	{ }
+};
+
+U_BOOT_DRIVER(sandbox_nvme) = {
+	.name		= "sandbox_nvme",
+	.id		= UCLASS_NVME,
+	.of_match	= sandbox_nvme_ids,
+	.ops		= &sandbox_nvme_ops,
+	.probe		= sandbox_nvme_probe,
+	.remove		= sandbox_nvme_remove,
+	.priv_auto	= sizeof(struct sandbox_nvme_priv),
+	.plat_auto	= sizeof(struct sandbox_nvme_plat),
+};
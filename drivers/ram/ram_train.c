@@ -0,0 +1,181 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Cache of memory training results
+ *
+ * Full training of LPDDR4 and similar memory takes a large part of the boot
+ * time, but gives the same result each time for a given chip, memory and
+ * data rate. The result is kept in a CRC-protected record in a reserved area
+ * of the boot medium and restored on later boots, falling back to full
+ * training if the record does not match or the memory fails a quick check.
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#define LOG_CATEGORY UCLASS_RAM
+
+#include <common.h>
+#include <dm.h>
+#include <log.h>
+#include <mapmem.h>
+#include <ram.h>
+#include <asm/cache.h>
+#include <u-boot/crc.h>
+
+#define RAM_TRAIN_DATA_MAX	(CONFIG_RAM_TRAIN_CACHE_SIZE - \
+				 sizeof(struct ram_train_hdr))
+
+#if !CONFIG_RAM_TRAIN_CACHE_ADDR
+static u8 ram_train_buf[CONFIG_RAM_TRAIN_CACHE_SIZE]
+	__aligned(ARCH_DMA_MINALIGN);
+#endif
+
+/* true once ram_train_load() has been called */
+static bool ram_train_loaded;
+
+static struct ram_train_hdr *ram_train_hdr(void)
+{
+#if CONFIG_RAM_TRAIN_CACHE_ADDR
+	return map_sysmem(CONFIG_RAM_TRAIN_CACHE_ADDR,
+			  CONFIG_RAM_TRAIN_CACHE_SIZE);
+#else
+	return (struct ram_train_hdr *)ram_train_buf;
+#endif
+}
+
+static u32 ram_train_crc(struct ram_train_hdr *hdr)
+{
+	ulong start = offsetof(struct ram_train_hdr, hdr_version);
+
+	return crc32(0, (uchar *)hdr + start,
+		     hdr->hdr_size - start + hdr->data_size);
+}
+
+static int ram_train_check(struct ram_train_hdr *hdr)
+{
+	if (hdr->magic != RAM_TRAIN_MAGIC)
+		return -ENOENT;
+	if (hdr->hdr_version != RAM_TRAIN_HDR_VERSION ||
+	    hdr->hdr_size != sizeof(*hdr) || hdr->data_size > RAM_TRAIN_DATA_MAX)
+		return -EBADMSG;
+	if (hdr->crc32 != ram_train_crc(hdr))
+		return -EBADMSG;
+
+	return 0;
+}
+
+int ram_train_load(void)
+{
+	struct ram_train_hdr *hdr = ram_train_hdr();
+	int ret;
+
+	ram_train_loaded = true;
+	ret = board_ram_train_read(hdr, CONFIG_RAM_TRAIN_CACHE_SIZE);
+	if (ret >= 0)
+		ret = ret < (int)sizeof(*hdr) ? -ENOENT : ram_train_check(hdr);
+	if (ret) {
+		log_debug("No training record (err=%d)\n", ret);
+		memset(hdr, '\0', sizeof(*hdr));
+		return ret;
+	}
+	hdr->flags = 0;
+
+	return 0;
+}
+
+void ram_train_invalidate(void)
+{
+	struct ram_train_hdr *hdr = ram_train_hdr();
+
+	memset(hdr, '\0', sizeof(*hdr));
+	hdr->flags = RAM_TRAIN_F_DIRTY;
+}
+
+int ram_train_save(void)
+{
+	struct ram_train_hdr *hdr = ram_train_hdr();
+	int ret;
+
+	if (!(hdr->flags & RAM_TRAIN_F_DIRTY))
+		return 0;
+
+	/* An invalidated record is written out as an empty header */
+	if (hdr->magic || hdr->flags != RAM_TRAIN_F_DIRTY) {
+		ret = ram_train_check(hdr);
+		if (ret)
+			return log_msg_ret("chk", ret);
+	}
+	hdr->flags = 0;
+	ret = board_ram_train_write(hdr, CONFIG_RAM_TRAIN_CACHE_SIZE);
+	if (ret) {
+		hdr->flags = RAM_TRAIN_F_DIRTY;
+		return log_msg_ret("wr", ret);
+	}
+
+	return 0;
+}
+
+int ram_train(struct udevice *dev)
+{
+	struct ram_ops *ops = ram_get_ops(dev);
+	struct ram_train_hdr *hdr = ram_train_hdr();
+	struct ram_train_key key;
+	void *data = hdr + 1;
+	int ret;
+
+	if (!ops || !ops->train)
+		return -ENOSYS;
+	memset(&key, '\0', sizeof(key));
+	if (ops->get_train_key) {
+		ret = ops->get_train_key(dev, &key);
+		if (ret)
+			return log_msg_ret("key", ret);
+	}
+	if (!ram_train_loaded)
+		ram_train_load();
+
+	if (hdr->magic == RAM_TRAIN_MAGIC) {
+		if (memcmp(&hdr->key, &key, sizeof(key))) {
+			log_info("RAM training record is for other memory\n");
+			ram_train_invalidate();
+		} else {
+			ret = ops->restore ? ops->restore(dev, data,
+							  hdr->data_size) :
+				-ENOSYS;
+			if (!ret && ops->verify)
+				ret = ops->verify(dev);
+			if (!ret) {
+				log_debug("Restored RAM training\n");
+				return 0;
+			}
+			log_warning("Saved RAM training failed (err=%d)\n", ret);
+			ram_train_invalidate();
+		}
+	}
+
+	ret = ops->train(dev, data, RAM_TRAIN_DATA_MAX);
+	if (ret < 0)
+		return log_msg_ret("train", ret);
+	if (ret > RAM_TRAIN_DATA_MAX)
+		return log_msg_ret("size", -ENOSPC);
+	memset(hdr, '\0', sizeof(*hdr));
+	hdr->magic = RAM_TRAIN_MAGIC;
+	hdr->hdr_version = RAM_TRAIN_HDR_VERSION;
+	hdr->hdr_size = sizeof(*hdr);
+	hdr->data_size = ret;
+	hdr->key = key;
+	hdr->crc32 = ram_train_crc(hdr);
+	hdr->flags = RAM_TRAIN_F_DIRTY;
+	log_debug("Trained RAM, %d bytes of parameters\n", ret);
+
+	return 0;
+}
+
+__weak int board_ram_train_read(void *buf, ulong size)
+{
+	return -ENOSYS;
+}
+
+__weak int board_ram_train_write(const void *buf, ulong size)
+{
+	return -ENOSYS;
+}
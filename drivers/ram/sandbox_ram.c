@@ -13,6 +13,36 @@
 
 DECLARE_GLOBAL_DATA_PTR;
 
+/* Version of the emulated training data */
+#define SANDBOX_RAM_TRAIN_VERSION	1
+
+/* Number of bytes of emulated training data */
+#define SANDBOX_RAM_TRAIN_SIZE		256
+
+/**
+ * struct sandbox_ram_plat - emulated memory controller
+ *
+ * This is kept across probe/remove so tests can emulate a reboot.
+ *
+ * @chip_id:	Chip ID to report in the training key
+ * @data_rate:	Data rate in MT/s
+ * @train_ms:	Time taken by full training
+ * @verify_fail: true to fail the quick check after restoring parameters
+ * @trains:	Number of times full training has been run
+ * @restores:	Number of times saved parameters have been restored
+ * @busy_ms:	Total time spent in full training. This is kept here rather
+ *		than added to the sandbox timer, which other tests rely on.
+ */
+struct sandbox_ram_plat {
+	u64 chip_id;
+	u32 data_rate;
+	uint train_ms;
+	bool verify_fail;
+	uint trains;
+	uint restores;
+	ulong busy_ms;
+};
+
 static int sandbox_get_info(struct udevice *dev, struct ram_info *info)
 {
 	info->base = 0;
@@ -21,8 +51,121 @@ static int sandbox_get_info(struct udevice *dev, struct ram_info *info)
 	return 0;
 }
 
+static int sandbox_ram_get_train_key(struct udevice *dev,
+				     struct ram_train_key *key)
+{
+	struct sandbox_ram_plat *plat = dev_get_plat(dev);
+
+	key->chip_id = plat->chip_id;
+	key->package_id = gd->ram_size;
+	key->data_rate = plat->data_rate;
+	key->version = SANDBOX_RAM_TRAIN_VERSION;
+
+	return 0;
+}
+
+/* The emulated parameters depend only on the data rate */
+static u8 sandbox_ram_param(struct sandbox_ram_plat *plat, int i)
+{
+	return (plat->data_rate + i) & 0xff;
+}
+
+static int sandbox_ram_train(struct udevice *dev, void *data, int size)
+{
+	struct sandbox_ram_plat *plat = dev_get_plat(dev);
+	u8 *param = data;
+	int i;
+
+	if (size < SANDBOX_RAM_TRAIN_SIZE)
+		return -ENOSPC;
+	for (i = 0; i < SANDBOX_RAM_TRAIN_SIZE; i++)
+		param[i] = sandbox_ram_param(plat, i);
+	plat->busy_ms += plat->train_ms;
+	plat->trains++;
+
+	return SANDBOX_RAM_TRAIN_SIZE;
+}
+
+static int sandbox_ram_restore(struct udevice *dev, const void *data, int size)
+{
+	struct sandbox_ram_plat *plat = dev_get_plat(dev);
+	const u8 *param = data;
+	int i;
+
+	if (size != SANDBOX_RAM_TRAIN_SIZE)
+		return -EINVAL;
+	for (i = 0; i < size; i++) {
+		if (param[i] != sandbox_ram_param(plat, i))
+			return -EIO;
+	}
+	plat->restores++;
+
+	return 0;
+}
+
+static int sandbox_ram_verify(struct udevice *dev)
+{
+	struct sandbox_ram_plat *plat = dev_get_plat(dev);
+
+	return plat->verify_fail ? -EIO : 0;
+}
+
+void sandbox_ram_set_train(struct udevice *dev, u32 data_rate,
+			   bool verify_fail)
+{
+	struct sandbox_ram_plat *plat = dev_get_plat(dev);
+
+	plat->data_rate = data_rate;
+	plat->verify_fail = verify_fail;
+}
+
+void sandbox_ram_get_train_counts(struct udevice *dev, uint *trainsp,
+				  uint *restoresp)
+{
+	struct sandbox_ram_plat *plat = dev_get_plat(dev);
+
+	*trainsp = plat->trains;
+	*restoresp = plat->restores;
+}
+
+ulong sandbox_ram_get_busy_ms(struct udevice *dev)
+{
+	struct sandbox_ram_plat *plat = dev_get_plat(dev);
+
+	return plat->busy_ms;
+}
+
+static int sandbox_ram_of_to_plat(struct udevice *dev)
+{
+	struct sandbox_ram_plat *plat = dev_get_plat(dev);
+
+	/* Keep any settings made by a test before the last remove */
+	if (plat->data_rate)
+		return 0;
+	plat->chip_id = dev_read_u64_default(dev, "sandbox,chip-id", 0);
+	plat->data_rate = dev_read_u32_default(dev, "sandbox,data-rate", 3200);
+	plat->train_ms = dev_read_u32_default(dev, "sandbox,train-ms", 0);
+
+	return 0;
+}
+
+static int sandbox_ram_probe(struct udevice *dev)
+{
+	int ret;
+
+	ret = ram_train(dev);
+	if (ret && ret != -ENOSYS)
+		return ret;
+
+	return 0;
+}
+
 static const struct ram_ops sandbox_ram_ops = {
 	.get_info	= sandbox_get_info,
+	.get_train_key	= sandbox_ram_get_train_key,
+	.train		= sandbox_ram_train,
+	.restore	= sandbox_ram_restore,
+	.verify		= sandbox_ram_verify,
 };
 
 static const struct udevice_id sandbox_ram_ids[] = {
@@ -34,5 +177,8 @@ U_BOOT_DRIVER(warm_ram_sandbox) = {
 	.name		= "ram_sandbox",
 	.id		= UCLASS_RAM,
 	.of_match	= sandbox_ram_ids,
+	.of_to_plat	= sandbox_ram_of_to_plat,
+	.probe		= sandbox_ram_probe,
 	.ops		= &sandbox_ram_ops,
+	.plat_auto	= sizeof(struct sandbox_ram_plat),
 };
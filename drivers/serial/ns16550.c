@@ -422,6 +422,37 @@ static int ns16550_serial_putc(struct udevice *dev, const char ch)
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(SERIAL_PUTS)
+static ssize_t ns16550_serial_puts(struct udevice *dev, const char *s,
+				   size_t len)
+{
+	struct ns16550 *const com_port = dev_get_priv(dev);
+	struct ns16550_plat *plat = com_port->plat;
+	int depth = 1;
+	bool newline = false;
+	size_t i;
+
+	/* THRE means the whole TX FIFO is free, so fill it in one burst */
+	if (!(serial_in(&com_port->lsr) & UART_LSR_THRE))
+		return 0;
+
+	if ((plat->fcr & UART_FCR_FIFO_EN) && plat->fifo_size > 1)
+		depth = plat->fifo_size;
+	len = min_t(size_t, len, depth);
+	for (i = 0; i < len; i++) {
+		serial_out(s[i], &com_port->thr);
+		if (s[i] == '\n')
+			newline = true;
+	}
+
+	/* See ns16550_serial_putc() */
+	if (newline)
+		WATCHDOG_RESET();
+
+	return len;
+}
+#endif
+
 static int ns16550_serial_pending(struct udevice *dev, bool input)
 {
 	struct ns16550 *const com_port = dev_get_priv(dev);
@@ -600,6 +631,7 @@ int ns16550_serial_of_to_plat(struct udevice *dev)
 	plat->fcr = UART_FCR_DEFVAL;
 	if (port_type == PORT_JZ4780)
 		plat->fcr |= UART_FCR_UME;
+	plat->fifo_size = dev_read_u32_default(dev, "fifo-size", 16);
 
 	return 0;
 }
@@ -607,6 +639,9 @@ int ns16550_serial_of_to_plat(struct udevice *dev)
 
 const struct dm_serial_ops ns16550_serial_ops = {
 	.putc = ns16550_serial_putc,
+#if CONFIG_IS_ENABLED(SERIAL_PUTS)
+	.puts = ns16550_serial_puts,
+#endif
 	.pending = ns16550_serial_pending,
 	.getc = ns16550_serial_getc,
 	.setbrg = ns16550_serial_setbrg,
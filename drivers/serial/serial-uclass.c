@@ -185,11 +185,147 @@ int serial_initialize(void)
 	return serial_init();
 }
 
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+#define SERIAL_TX_MASK		(CONFIG_SERIAL_TX_BUFFER_SIZE - 1)
+
+static uint serial_tx_used(struct serial_dev_priv *upriv)
+{
+	return (upriv->tx_wr - upriv->tx_rd) & SERIAL_TX_MASK;
+}
+
+/**
+ * serial_tx_push() - Move as much buffered output as the UART will take
+ *
+ * Contiguous runs of the ring are handed to the driver's puts() method when
+ * available, so drivers which can fill a FIFO (or start a DMA transfer) in
+ * one go get the whole run. Otherwise characters are written with putc()
+ * until the driver reports -EAGAIN.
+ *
+ * @dev: Serial device
+ * Return: number of characters moved to the UART, -ve on error
+ */
+static int serial_tx_push(struct udevice *dev)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+	struct dm_serial_ops *ops = serial_get_ops(dev);
+	int total = 0;
+
+	while (upriv->tx_rd != upriv->tx_wr) {
+		uint len;
+		int ret;
+
+		if (upriv->tx_wr > upriv->tx_rd)
+			len = upriv->tx_wr - upriv->tx_rd;
+		else
+			len = CONFIG_SERIAL_TX_BUFFER_SIZE - upriv->tx_rd;
+
+		if (CONFIG_IS_ENABLED(SERIAL_PUTS) && ops->puts) {
+			ret = ops->puts(dev, upriv->txbuf + upriv->tx_rd, len);
+		} else {
+			ret = ops->putc(dev, upriv->txbuf[upriv->tx_rd]);
+			if (!ret)
+				ret = 1;
+		}
+		if (ret == -EAGAIN || !ret)
+			break;
+		if (ret < 0) {
+			/* Drop the output rather than retrying forever */
+			upriv->tx_rd = upriv->tx_wr;
+			return ret;
+		}
+		upriv->tx_rd = (upriv->tx_rd + ret) & SERIAL_TX_MASK;
+		total += ret;
+	}
+
+	return total;
+}
+
+static void serial_tx_queue(struct udevice *dev, char ch)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+
+	/* Wait for the UART to make room if the ring is full */
+	while (serial_tx_used(upriv) == SERIAL_TX_MASK) {
+		if (serial_tx_push(dev) < 0)
+			break;
+		WATCHDOG_RESET();
+	}
+
+	upriv->txbuf[upriv->tx_wr] = ch;
+	upriv->tx_wr = (upriv->tx_wr + 1) & SERIAL_TX_MASK;
+}
+
+static void serial_tx_drain(struct udevice *dev, bool wait)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+	struct dm_serial_ops *ops = serial_get_ops(dev);
+
+	if (!upriv->txbuf)
+		return;
+
+	do {
+		if (serial_tx_push(dev) < 0)
+			return;
+		if (wait && upriv->tx_rd != upriv->tx_wr)
+			WATCHDOG_RESET();
+	} while (wait && upriv->tx_rd != upriv->tx_wr);
+
+	/* Let the last characters leave the UART's own FIFO */
+	if (wait && ops->pending) {
+		while (ops->pending(dev, false) > 0)
+			WATCHDOG_RESET();
+	}
+}
+
+static bool serial_tx_buffered(struct udevice *dev)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+
+	return upriv->txbuf;
+}
+
+int serial_dev_flush(struct udevice *dev)
+{
+	if (!dev)
+		return -ENODEV;
+
+	serial_tx_drain(dev, true);
+
+	return 0;
+}
+
+int serial_flush(void)
+{
+	return serial_dev_flush(gd->cur_serial_dev);
+}
+#else
+static inline void serial_tx_queue(struct udevice *dev, char ch)
+{
+}
+
+static inline void serial_tx_drain(struct udevice *dev, bool wait)
+{
+}
+
+static inline bool serial_tx_buffered(struct udevice *dev)
+{
+	return false;
+}
+#endif /* CONFIG_IS_ENABLED(SERIAL_TX_BUFFER) */
+
 static void _serial_putc(struct udevice *dev, char ch)
 {
 	struct dm_serial_ops *ops = serial_get_ops(dev);
 	int err;
 
+	if (serial_tx_buffered(dev)) {
+		if (ch == '\n')
+			serial_tx_queue(dev, '\r');
+		serial_tx_queue(dev, ch);
+		serial_tx_drain(dev, false);
+		return;
+	}
+
 	if (ch == '\n')
 		_serial_putc(dev, '\r');
 
@@ -218,6 +354,16 @@ static void _serial_puts(struct udevice *dev, const char *str)
 {
 	struct dm_serial_ops *ops = serial_get_ops(dev);
 
+	if (serial_tx_buffered(dev)) {
+		for (; *str; str++) {
+			if (*str == '\n')
+				serial_tx_queue(dev, '\r');
+			serial_tx_queue(dev, *str);
+		}
+		serial_tx_drain(dev, false);
+		return;
+	}
+
 	if (!CONFIG_IS_ENABLED(SERIAL_PUTS) || !ops->puts) {
 		while (*str)
 			_serial_putc(dev, *str++);
@@ -245,8 +391,11 @@ static int __serial_getc(struct udevice *dev)
 
 	do {
 		err = ops->getc(dev);
-		if (err == -EAGAIN)
+		if (err == -EAGAIN) {
+			/* Use the idle time to empty the output buffer */
+			serial_tx_drain(dev, false);
 			WATCHDOG_RESET();
+		}
 	} while (err == -EAGAIN);
 
 	return err >= 0 ? err : 0;
@@ -256,6 +405,7 @@ static int __serial_tstc(struct udevice *dev)
 {
 	struct dm_serial_ops *ops = serial_get_ops(dev);
 
+	serial_tx_drain(dev, false);
 	if (ops->pending)
 		return ops->pending(dev, true);
 
@@ -481,6 +631,20 @@ static int serial_post_probe(struct udevice *dev)
 #endif
 	int ret;
 
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+	/*
+	 * Only buffer output once relocated: the pre-relocation device is
+	 * thrown away and anything left in its buffer would be lost
+	 */
+	if (gd->flags & GD_FLG_RELOC) {
+		struct serial_dev_priv *tx_upriv = dev_get_uclass_priv(dev);
+
+		tx_upriv->txbuf = malloc(CONFIG_SERIAL_TX_BUFFER_SIZE);
+		tx_upriv->tx_rd = 0;
+		tx_upriv->tx_wr = 0;
+	}
+#endif
+
 #if defined(CONFIG_NEEDS_MANUAL_RELOC)
 	if (ops->setbrg)
 		ops->setbrg += gd->reloc_off;
@@ -535,12 +699,17 @@ static int serial_post_probe(struct udevice *dev)
 
 static int serial_pre_remove(struct udevice *dev)
 {
-#if CONFIG_IS_ENABLED(SYS_STDIO_DEREGISTER)
 	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
 
+#if CONFIG_IS_ENABLED(SYS_STDIO_DEREGISTER)
 	if (stdio_deregister_dev(upriv->sdev, true))
 		return -EPERM;
 #endif
+	if (serial_tx_buffered(dev)) {
+		serial_tx_drain(dev, true);
+		free(upriv->txbuf);
+		upriv->txbuf = NULL;
+	}
 
 	return 0;
 }
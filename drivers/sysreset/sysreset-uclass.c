@@ -13,7 +13,9 @@
 #include <errno.h>
 #include <hang.h>
 #include <log.h>
+#include <mmc.h>
 #include <regmap.h>
+#include <serial.h>
 #include <spl.h>
 #include <sysreset.h>
 #include <dm/device-internal.h>
@@ -58,6 +60,11 @@ int sysreset_walk(enum sysreset_t type)
 	struct udevice *dev;
 	int ret = -ENOSYS;
 
+	/* Anything still buffered for the console is lost over a reset */
+	serial_flush();
+	/* As is a write which a card has not finished programming */
+	mmc_wait_writes_done();
+
 	while (ret != -EINPROGRESS && type < SYSRESET_COUNT) {
 		for (uclass_first_device(UCLASS_SYSRESET, &dev);
 		     dev;
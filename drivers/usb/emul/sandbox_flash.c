@@ -10,17 +10,56 @@
 #include <os.h>
 #include <scsi.h>
 #include <usb.h>
+#include <asm/test.h>
+#include <usb/uas.h>
 
 /*
  * This driver emulates a flash stick using the UFI command specification and
  * the BBB (bulk/bulk/bulk) protocol. It supports only a single logical unit
  * number (LUN 0).
+ *
+ * A test can switch it to offer UAS (USB Attached SCSI) as well, in a second
+ * alternate setting. At high speed UAS works without streams: the device
+ * tells the host which command it wants to move data for with READ READY on
+ * the status pipe. It picks the most recent command first, to check that the
+ * host copes with commands finishing out of order.
+ *
+ * A test can also make it a SuperSpeed device, where UAS uses streams: the
+ * host queues the status and data transfers of each command on the stream
+ * for its tag, and the device serves the streams in reverse order.
  */
 
 enum {
 	SANDBOX_FLASH_EP_OUT		= 1,	/* endpoints */
 	SANDBOX_FLASH_EP_IN		= 2,
+	SANDBOX_FLASH_EP_UAS_DATA_IN	= 3,
+	SANDBOX_FLASH_EP_UAS_DATA_OUT	= 4,
 	SANDBOX_FLASH_BLOCK_LEN		= 512,
+	SANDBOX_FLASH_UAS_TAGS		= 32,
+};
+
+/* With UAS the command and status pipes use the Bulk-Only endpoints */
+#define SANDBOX_FLASH_EP_UAS_CMD	SANDBOX_FLASH_EP_OUT
+#define SANDBOX_FLASH_EP_UAS_STATUS	SANDBOX_FLASH_EP_IN
+
+enum uas_cmd_state {
+	UAS_CMD_FREE,
+	UAS_CMD_QUEUED,		/* received, not started */
+	UAS_CMD_DATA,		/* READ READY sent, waiting for the host */
+	UAS_CMD_DONE,		/* data sent, status to send */
+};
+
+/**
+ * struct sandbox_flash_uas_cmd - a UAS command queued on the device
+ *
+ * @state:	State of the command
+ * @failed:	true if the command has been started and failed
+ * @cdb:	SCSI command
+ */
+struct sandbox_flash_uas_cmd {
+	enum uas_cmd_state state;
+	bool failed;
+	u8 cdb[16];
 };
 
 enum cmd_phase {
@@ -50,6 +89,11 @@ enum {
  * @status_buff:	Data buffer for outgoing status
  * @buff_used:	Number of bytes ready to transfer back to host
  * @buff:	Data buffer for outgoing data
+ * @altsetting:	Alternate setting selected by the host, 1 for UAS
+ * @uas_cmd:	UAS commands, indexed by tag
+ * @uas_cur:	Tag of the UAS command whose data is being transferred
+ * @uas_inflight: Number of UAS commands queued on the device
+ * @halted:	true if the IN endpoint has stalled and not been cleared
  */
 struct sandbox_flash_priv {
 	bool error;
@@ -63,11 +107,34 @@ struct sandbox_flash_priv {
 	struct umass_bbb_csw status;
 	int buff_used;
 	u8 buff[512];
+	int altsetting;
+	struct sandbox_flash_uas_cmd uas_cmd[SANDBOX_FLASH_UAS_TAGS + 1];
+	int uas_cur;
+	int uas_inflight;
+	bool halted;
 };
 
+/**
+ * struct sandbox_flash_plat - settings for this driver, kept across probes
+ *
+ * @pathname:	Path of the backing file
+ * @flash_strings: USB strings
+ * @uas:	true to offer UAS as well as Bulk-Only Transport
+ * @uas_broken:	true to reject all UAS commands
+ * @super_speed: true to appear as a USB 3.0 device, so UAS uses streams
+ * @uas_max_inflight: Largest number of UAS commands queued at once
+ * @stall_status: true to stall the next status phase
+ * @stalls:	Number of times the IN endpoint has stalled
+ */
 struct sandbox_flash_plat {
 	const char *pathname;
 	struct usb_string flash_strings[STRINGID_COUNT];
+	bool uas;
+	bool uas_broken;
+	bool super_speed;
+	int uas_max_inflight;
+	bool stall_status;
+	int stalls;
 };
 
 struct scsi_inquiry_resp {
@@ -114,6 +181,24 @@ static struct usb_device_descriptor flash_device_desc = {
 	.bNumConfigurations =	1,
 };
 
+static struct usb_device_descriptor flash_ss_device_desc = {
+	.bLength =		sizeof(flash_ss_device_desc),
+	.bDescriptorType =	USB_DT_DEVICE,
+
+	.bcdUSB =		__constant_cpu_to_le16(0x0300),
+
+	.bDeviceClass =		0,
+	.bDeviceSubClass =	0,
+	.bDeviceProtocol =	0,
+
+	.idVendor =		__constant_cpu_to_le16(0x1234),
+	.idProduct =		__constant_cpu_to_le16(0x5678),
+	.iManufacturer =	STRINGID_MANUFACTURER,
+	.iProduct =		STRINGID_PRODUCT,
+	.iSerialNumber =	STRINGID_SERIAL,
+	.bNumConfigurations =	1,
+};
+
 static struct usb_config_descriptor flash_config0 = {
 	.bLength		= sizeof(flash_config0),
 	.bDescriptorType	= USB_DT_CONFIG,
@@ -145,7 +230,7 @@ static struct usb_endpoint_descriptor flash_endpoint0_out = {
 
 	.bEndpointAddress	= SANDBOX_FLASH_EP_OUT,
 	.bmAttributes		= USB_ENDPOINT_XFER_BULK,
-	.wMaxPacketSize		= __constant_cpu_to_le16(1024),
+	.wMaxPacketSize		= __constant_cpu_to_le16(512),
 	.bInterval		= 0,
 };
 
@@ -155,7 +240,7 @@ static struct usb_endpoint_descriptor flash_endpoint1_in = {
 
 	.bEndpointAddress	= SANDBOX_FLASH_EP_IN | USB_ENDPOINT_DIR_MASK,
 	.bmAttributes		= USB_ENDPOINT_XFER_BULK,
-	.wMaxPacketSize		= __constant_cpu_to_le16(1024),
+	.wMaxPacketSize		= __constant_cpu_to_le16(512),
 	.bInterval		= 0,
 };
 
@@ -168,6 +253,134 @@ static void *flash_desc_list[] = {
 	NULL,
 };
 
+static struct usb_config_descriptor flash_uas_config0 = {
+	.bLength		= sizeof(flash_uas_config0),
+	.bDescriptorType	= USB_DT_CONFIG,
+
+	/* wTotalLength is set up by usb-emul-uclass */
+	.bNumInterfaces		= 1,
+	.bConfigurationValue	= 0,
+	.iConfiguration		= 0,
+	.bmAttributes		= 1 << 7,
+	.bMaxPower		= 50,
+};
+
+static struct usb_interface_descriptor flash_uas_interface0_bot = {
+	.bLength		= sizeof(flash_uas_interface0_bot),
+	.bDescriptorType	= USB_DT_INTERFACE,
+
+	.bInterfaceNumber	= 0,
+	.bAlternateSetting	= 0,
+	.bNumEndpoints		= 2,
+	.bInterfaceClass	= USB_CLASS_MASS_STORAGE,
+	.bInterfaceSubClass	= US_SC_SCSI,
+	.bInterfaceProtocol	= US_PR_BULK,
+	.iInterface		= 0,
+};
+
+static struct usb_interface_descriptor flash_uas_interface0_uas = {
+	.bLength		= sizeof(flash_uas_interface0_uas),
+	.bDescriptorType	= USB_DT_INTERFACE,
+
+	.bInterfaceNumber	= 0,
+	.bAlternateSetting	= 1,
+	.bNumEndpoints		= 4,
+	.bInterfaceClass	= USB_CLASS_MASS_STORAGE,
+	.bInterfaceSubClass	= US_SC_SCSI,
+	.bInterfaceProtocol	= US_PR_UAS,
+	.iInterface		= 0,
+};
+
+static struct usb_endpoint_descriptor flash_endpoint2_in = {
+	.bLength		= USB_DT_ENDPOINT_SIZE,
+	.bDescriptorType	= USB_DT_ENDPOINT,
+
+	.bEndpointAddress	= SANDBOX_FLASH_EP_UAS_DATA_IN |
+				  USB_ENDPOINT_DIR_MASK,
+	.bmAttributes		= USB_ENDPOINT_XFER_BULK,
+	.wMaxPacketSize		= __constant_cpu_to_le16(512),
+	.bInterval		= 0,
+};
+
+static struct usb_endpoint_descriptor flash_endpoint3_out = {
+	.bLength		= USB_DT_ENDPOINT_SIZE,
+	.bDescriptorType	= USB_DT_ENDPOINT,
+
+	.bEndpointAddress	= SANDBOX_FLASH_EP_UAS_DATA_OUT,
+	.bmAttributes		= USB_ENDPOINT_XFER_BULK,
+	.wMaxPacketSize		= __constant_cpu_to_le16(512),
+	.bInterval		= 0,
+};
+
+static struct usb_pipe_usage_descriptor flash_pipe_cmd = {
+	.bLength		= sizeof(flash_pipe_cmd),
+	.bDescriptorType	= USB_DT_PIPE_USAGE,
+	.bPipeID		= UAS_PIPE_ID_CMD,
+};
+
+static struct usb_pipe_usage_descriptor flash_pipe_status = {
+	.bLength		= sizeof(flash_pipe_status),
+	.bDescriptorType	= USB_DT_PIPE_USAGE,
+	.bPipeID		= UAS_PIPE_ID_STATUS,
+};
+
+static struct usb_pipe_usage_descriptor flash_pipe_data_in = {
+	.bLength		= sizeof(flash_pipe_data_in),
+	.bDescriptorType	= USB_DT_PIPE_USAGE,
+	.bPipeID		= UAS_PIPE_ID_DATA_IN,
+};
+
+static struct usb_pipe_usage_descriptor flash_pipe_data_out = {
+	.bLength		= sizeof(flash_pipe_data_out),
+	.bDescriptorType	= USB_DT_PIPE_USAGE,
+	.bPipeID		= UAS_PIPE_ID_DATA_OUT,
+};
+
+static void *flash_uas_desc_list[] = {
+	&flash_device_desc,
+	&flash_uas_config0,
+	&flash_uas_interface0_bot,
+	&flash_endpoint0_out,
+	&flash_endpoint1_in,
+	&flash_uas_interface0_uas,
+	&flash_endpoint0_out,
+	&flash_pipe_cmd,
+	&flash_endpoint1_in,
+	&flash_pipe_status,
+	&flash_endpoint2_in,
+	&flash_pipe_data_in,
+	&flash_endpoint3_out,
+	&flash_pipe_data_out,
+	NULL,
+};
+
+/* The same, for a SuperSpeed device */
+static void *flash_uas_ss_desc_list[] = {
+	&flash_ss_device_desc,
+	&flash_uas_config0,
+	&flash_uas_interface0_bot,
+	&flash_endpoint0_out,
+	&flash_endpoint1_in,
+	&flash_uas_interface0_uas,
+	&flash_endpoint0_out,
+	&flash_pipe_cmd,
+	&flash_endpoint1_in,
+	&flash_pipe_status,
+	&flash_endpoint2_in,
+	&flash_pipe_data_in,
+	&flash_endpoint3_out,
+	&flash_pipe_data_out,
+	NULL,
+};
+
+static void **sandbox_flash_desc_list(struct sandbox_flash_plat *plat)
+{
+	if (!plat->uas)
+		return flash_desc_list;
+
+	return plat->super_speed ? flash_uas_ss_desc_list : flash_uas_desc_list;
+}
+
 static int sandbox_flash_control(struct udevice *dev, struct usb_device *udev,
 				 unsigned long pipe, void *buff, int len,
 				 struct devrequest *setup)
@@ -186,6 +399,21 @@ static int sandbox_flash_control(struct udevice *dev, struct usb_device *udev,
 			debug("request=%x\n", setup->request);
 			break;
 		}
+	} else if (pipe == usb_sndctrlpipe(udev, 0) &&
+		   setup->request == USB_REQ_CLEAR_FEATURE) {
+		priv->halted = false;
+		return 0;
+	} else if (pipe == usb_sndctrlpipe(udev, 0) &&
+		   setup->request == USB_REQ_SET_INTERFACE) {
+		struct sandbox_flash_plat *plat = dev_get_plat(dev);
+
+		if (setup->value > (plat->uas ? 1 : 0))
+			return -EIO;
+		priv->altsetting = setup->value;
+		memset(priv->uas_cmd, '\0', sizeof(priv->uas_cmd));
+		priv->uas_inflight = 0;
+		priv->phase = PHASE_START;
+		return 0;
 	}
 	debug("pipe=%lx\n", pipe);
 
@@ -294,6 +522,227 @@ static int handle_ufi_command(struct sandbox_flash_plat *plat,
 	return 0;
 }
 
+/* Sends data set up by handle_ufi_command() to the host */
+static int sandbox_flash_data_in(struct sandbox_flash_priv *priv, void *buff,
+				 int len)
+{
+	debug("data in, len=%x, alloc_len=%x, priv->read_len=%x\n",
+	      len, priv->alloc_len, priv->read_len);
+	if (priv->read_len) {
+		ulong bytes_read;
+
+		if (priv->fd == -1)
+			return -EIO;
+
+		bytes_read = os_read(priv->fd, buff, len);
+		if (bytes_read != len)
+			return -EIO;
+		priv->read_len -= len / SANDBOX_FLASH_BLOCK_LEN;
+		if (!priv->read_len)
+			priv->phase = PHASE_STATUS;
+	} else {
+		if (priv->alloc_len && len > priv->alloc_len)
+			len = priv->alloc_len;
+		if (len > sizeof(priv->buff))
+			len = sizeof(priv->buff);
+		memcpy(buff, priv->buff, len);
+		priv->phase = PHASE_STATUS;
+	}
+
+	return len;
+}
+
+/* Starts a queued UAS command, so it has data to move or is done */
+static void sandbox_flash_uas_start(struct sandbox_flash_plat *plat,
+				    struct sandbox_flash_priv *priv, int tag)
+{
+	struct sandbox_flash_uas_cmd *cmd = &priv->uas_cmd[tag];
+	int ret;
+
+	priv->alloc_len = 0;
+	priv->read_len = 0;
+	ret = handle_ufi_command(plat, priv, cmd->cdb, sizeof(cmd->cdb));
+	cmd->failed = ret || priv->status.bCSWStatus != CSWSTATUS_GOOD;
+	if (!cmd->failed && priv->buff_used) {
+		cmd->state = UAS_CMD_DATA;
+		priv->uas_cur = tag;
+	} else {
+		cmd->state = UAS_CMD_DONE;
+	}
+}
+
+/* Sends the sense IU of a finished UAS command and frees its tag */
+static int sandbox_flash_uas_sense(struct sandbox_flash_priv *priv, int tag,
+				   void *buff, int len)
+{
+	struct sandbox_flash_uas_cmd *cmd = &priv->uas_cmd[tag];
+	struct uas_sense_iu *iu = buff;
+
+	if (len < sizeof(*iu))
+		return -EIO;
+	memset(iu, '\0', sizeof(*iu));
+	iu->iu_id = UAS_IU_ID_STATUS;
+	iu->tag = cpu_to_be16(tag);
+	if (cmd->failed) {
+		/* Sense key ILLEGAL REQUEST */
+		iu->status = 2;
+		iu->len = cpu_to_be16(18);
+		iu->sense[0] = 0x70;
+		iu->sense[2] = 5;
+		iu->sense[7] = 10;
+	}
+	cmd->state = UAS_CMD_FREE;
+	priv->uas_inflight--;
+
+	return sizeof(*iu);
+}
+
+/* Rejects a UAS command with a RESPONSE IU and frees its tag */
+static int sandbox_flash_uas_reject(struct sandbox_flash_priv *priv, int tag,
+				    void *buff, int len)
+{
+	struct uas_response_iu *resp = buff;
+
+	if (len < sizeof(*resp))
+		return -EIO;
+	memset(resp, '\0', sizeof(*resp));
+	resp->iu_id = UAS_IU_ID_RESPONSE;
+	resp->tag = cpu_to_be16(tag);
+	resp->response_code = UAS_RC_INVALID_IU;
+	priv->uas_cmd[tag].state = UAS_CMD_FREE;
+	priv->uas_inflight--;
+
+	return sizeof(*resp);
+}
+
+/**
+ * sandbox_flash_uas_status() - Send the next IU on the UAS status pipe
+ *
+ * This picks the most recent command still queued. If it has data to send,
+ * the IU is READ READY and the command is started, else it is the command's
+ * sense IU.
+ */
+static int sandbox_flash_uas_status(struct udevice *dev, void *buff, int len)
+{
+	struct sandbox_flash_plat *plat = dev_get_plat(dev);
+	struct sandbox_flash_priv *priv = dev_get_priv(dev);
+	struct uas_sense_iu *iu = buff;
+	int tag;
+
+	for (tag = SANDBOX_FLASH_UAS_TAGS; tag; tag--) {
+		if (priv->uas_cmd[tag].state == UAS_CMD_QUEUED ||
+		    priv->uas_cmd[tag].state == UAS_CMD_DONE)
+			break;
+	}
+	if (!tag || len < sizeof(*iu))
+		return -EIO;
+	if (plat->uas_broken)
+		return sandbox_flash_uas_reject(priv, tag, buff, len);
+
+	if (priv->uas_cmd[tag].state == UAS_CMD_QUEUED)
+		sandbox_flash_uas_start(plat, priv, tag);
+	if (priv->uas_cmd[tag].state == UAS_CMD_DATA) {
+		memset(iu, '\0', sizeof(*iu));
+		iu->iu_id = UAS_IU_ID_READ_READY;
+		iu->tag = cpu_to_be16(tag);
+		return sizeof(struct uas_iu_header);
+	}
+
+	return sandbox_flash_uas_sense(priv, tag, buff, len);
+}
+
+/**
+ * sandbox_flash_uas_stream() - Handle a transfer on the stream of a UAS tag
+ *
+ * The host queues these before sending the command, so this holds them back
+ * with -EAGAIN until the command has got far enough. A command is started
+ * when the first of its transfers comes along, unless another command is
+ * still moving data.
+ */
+static int sandbox_flash_uas_stream(struct udevice *dev, int ep, int tag,
+				    void *buff, int len)
+{
+	struct sandbox_flash_plat *plat = dev_get_plat(dev);
+	struct sandbox_flash_priv *priv = dev_get_priv(dev);
+	struct sandbox_flash_uas_cmd *cmd;
+	bool busy;
+
+	if (!priv->altsetting || tag < 1 || tag > SANDBOX_FLASH_UAS_TAGS)
+		return -EIO;
+	cmd = &priv->uas_cmd[tag];
+	busy = priv->uas_cur && priv->uas_cmd[priv->uas_cur].state ==
+		UAS_CMD_DATA;
+	if (cmd->state == UAS_CMD_FREE ||
+	    (cmd->state == UAS_CMD_QUEUED && busy))
+		return -EAGAIN;
+	if (plat->uas_broken) {
+		if (ep != SANDBOX_FLASH_EP_UAS_STATUS)
+			return -EAGAIN;
+		return sandbox_flash_uas_reject(priv, tag, buff, len);
+	}
+	if (cmd->state == UAS_CMD_QUEUED)
+		sandbox_flash_uas_start(plat, priv, tag);
+
+	switch (ep) {
+	case SANDBOX_FLASH_EP_UAS_STATUS:
+		if (cmd->state == UAS_CMD_DATA)
+			return -EAGAIN;
+		return sandbox_flash_uas_sense(priv, tag, buff, len);
+	case SANDBOX_FLASH_EP_UAS_DATA_IN:
+		/* There is no data, so this never completes */
+		if (cmd->state != UAS_CMD_DATA)
+			return -EAGAIN;
+		len = sandbox_flash_data_in(priv, buff, len);
+		if (priv->phase == PHASE_STATUS)
+			cmd->state = UAS_CMD_DONE;
+		return len;
+	default:
+		/* Writing is not supported */
+		return -EIO;
+	}
+}
+
+/* Handles a bulk transfer in the UAS alternate setting */
+static int sandbox_flash_uas_bulk(struct udevice *dev, int ep, void *buff,
+				  int len)
+{
+	struct sandbox_flash_plat *plat = dev_get_plat(dev);
+	struct sandbox_flash_priv *priv = dev_get_priv(dev);
+	struct sandbox_flash_uas_cmd *cmd;
+	struct uas_cmd_iu *iu = buff;
+	int tag;
+
+	switch (ep) {
+	case SANDBOX_FLASH_EP_UAS_CMD:
+		tag = be16_to_cpu(iu->tag);
+		if (len != sizeof(*iu) || iu->iu_id != UAS_IU_ID_COMMAND ||
+		    tag < 1 || tag > SANDBOX_FLASH_UAS_TAGS)
+			return -EIO;
+		cmd = &priv->uas_cmd[tag];
+		if (cmd->state != UAS_CMD_FREE)
+			return -EIO;
+		memcpy(cmd->cdb, iu->cdb, sizeof(cmd->cdb));
+		cmd->state = UAS_CMD_QUEUED;
+		priv->uas_inflight++;
+		plat->uas_max_inflight = max(plat->uas_max_inflight,
+					     priv->uas_inflight);
+		return len;
+	case SANDBOX_FLASH_EP_UAS_STATUS:
+		return sandbox_flash_uas_status(dev, buff, len);
+	case SANDBOX_FLASH_EP_UAS_DATA_IN:
+		cmd = &priv->uas_cmd[priv->uas_cur];
+		if (!priv->uas_cur || cmd->state != UAS_CMD_DATA)
+			return -EIO;
+		len = sandbox_flash_data_in(priv, buff, len);
+		if (priv->phase == PHASE_STATUS)
+			cmd->state = UAS_CMD_DONE;
+		return len;
+	default:
+		/* Writing is not supported */
+		return -EIO;
+	}
+}
+
 static int sandbox_flash_bulk(struct udevice *dev, struct usb_device *udev,
 			      unsigned long pipe, void *buff, int len)
 {
@@ -304,6 +753,8 @@ static int sandbox_flash_bulk(struct udevice *dev, struct usb_device *udev,
 
 	debug("%s: dev=%s, pipe=%lx, ep=%x, len=%x, phase=%d\n", __func__,
 	      dev->name, pipe, ep, len, priv->phase);
+	if (priv->altsetting)
+		return sandbox_flash_uas_bulk(dev, ep, buff, len);
 	switch (ep) {
 	case SANDBOX_FLASH_EP_OUT:
 		switch (priv->phase) {
@@ -329,33 +780,19 @@ static int sandbox_flash_bulk(struct udevice *dev, struct usb_device *udev,
 			break;
 		}
 	case SANDBOX_FLASH_EP_IN:
+		if (priv->halted)
+			return -EPIPE;
 		switch (priv->phase) {
 		case PHASE_DATA:
-			debug("data in, len=%x, alloc_len=%x, priv->read_len=%x\n",
-			      len, priv->alloc_len, priv->read_len);
-			if (priv->read_len) {
-				ulong bytes_read;
-
-				if (priv->fd == -1)
-					return -EIO;
-
-				bytes_read = os_read(priv->fd, buff, len);
-				if (bytes_read != len)
-					return -EIO;
-				priv->read_len -= len / SANDBOX_FLASH_BLOCK_LEN;
-				if (!priv->read_len)
-					priv->phase = PHASE_STATUS;
-			} else {
-				if (priv->alloc_len && len > priv->alloc_len)
-					len = priv->alloc_len;
-				if (len > sizeof(priv->buff))
-					len = sizeof(priv->buff);
-				memcpy(buff, priv->buff, len);
-				priv->phase = PHASE_STATUS;
-			}
-			return len;
+			return sandbox_flash_data_in(priv, buff, len);
 		case PHASE_STATUS:
 			debug("status in, len=%x\n", len);
+			if (plat->stall_status) {
+				plat->stall_status = false;
+				plat->stalls++;
+				priv->halted = true;
+				return -EPIPE;
+			}
 			if (len > sizeof(priv->status))
 				len = sizeof(priv->status);
 			memcpy(buff, &priv->status, len);
@@ -371,6 +808,68 @@ err:
 	return 0;
 }
 
+/* Records how a queued transfer went, returning false if it failed */
+static bool sandbox_flash_req_done(struct usb_bulk_req *req, int ret)
+{
+	if (ret < 0) {
+		req->status = ret == -EPIPE ? USB_ST_STALLED : ret;
+		req->act_len = 0;
+		return false;
+	}
+	req->status = 0;
+	req->act_len = ret;
+
+	return true;
+}
+
+/*
+ * Carries out queued transfers. Those without a stream are done in order, as
+ * the host would do them one at a time. Those on a stream wait until their
+ * command is ready, so the queue is gone through until nothing more happens.
+ * The streams are tried from the last in the queue to the first, so commands
+ * finish out of order. A transfer which never becomes ready is left as
+ * USB_ST_NOT_PROC, as if it had timed out. Nothing more is done after a
+ * failure.
+ */
+static int sandbox_flash_bulk_queue(struct udevice *dev,
+				    struct usb_device *udev,
+				    struct usb_bulk_req *reqs, int count)
+{
+	struct usb_bulk_req *req;
+	bool progress;
+	int i, ret;
+
+	do {
+		progress = false;
+		for (i = 0; i < count; i++) {
+			req = &reqs[i];
+			if (req->stream || req->status != USB_ST_NOT_PROC)
+				continue;
+			ret = sandbox_flash_bulk(dev, udev, req->pipe,
+						 req->buffer, req->length);
+			if (!sandbox_flash_req_done(req, ret))
+				return 0;
+			progress = true;
+		}
+		for (i = count - 1; i >= 0; i--) {
+			req = &reqs[i];
+			if (!req->stream || req->status != USB_ST_NOT_PROC)
+				continue;
+			ret = sandbox_flash_uas_stream(dev,
+						       usb_pipeendpoint(req->pipe),
+						       req->stream, req->buffer,
+						       req->length);
+			if (ret == -EAGAIN)
+				continue;
+			if (!sandbox_flash_req_done(req, ret))
+				return 0;
+			progress = true;
+		}
+	} while (progress);
+
+	return 0;
+}
+
 static int sandbox_flash_of_to_plat(struct udevice *dev)
 {
 	struct sandbox_flash_plat *plat = dev_get_plat(dev);
@@ -393,7 +892,58 @@ static int sandbox_flash_bind(struct udevice *dev)
 	fs[2].id = STRINGID_SERIAL;
 	fs[2].s = dev->name;
 
-	return usb_emul_setup_device(dev, plat->flash_strings, flash_desc_list);
+	return usb_emul_setup_device(dev, plat->flash_strings,
+				     sandbox_flash_desc_list(plat));
+}
+
+int sandbox_flash_set_uas(struct udevice *dev, bool uas, bool broken)
+{
+	struct sandbox_flash_plat *plat = dev_get_plat(dev);
+
+	plat->uas = uas;
+	plat->uas_broken = broken;
+	plat->uas_max_inflight = 0;
+
+	return usb_emul_setup_device(dev, plat->flash_strings,
+				     sandbox_flash_desc_list(plat));
+}
+
+int sandbox_flash_set_super_speed(struct udevice *dev, bool super_speed)
+{
+	struct sandbox_flash_plat *plat = dev_get_plat(dev);
+
+	plat->super_speed = super_speed;
+
+	return usb_emul_setup_device(dev, plat->flash_strings,
+				     sandbox_flash_desc_list(plat));
+}
+
+int sandbox_flash_get_uas_max_inflight(struct udevice *dev)
+{
+	struct sandbox_flash_plat *plat = dev_get_plat(dev);
+
+	return plat->uas_max_inflight;
+}
+
+int sandbox_flash_get_altsetting(struct udevice *dev)
+{
+	struct sandbox_flash_priv *priv = dev_get_priv(dev);
+
+	return priv->altsetting;
+}
+
+void sandbox_flash_stall_status(struct udevice *dev)
+{
+	struct sandbox_flash_plat *plat = dev_get_plat(dev);
+
+	plat->stall_status = true;
+}
+
+int sandbox_flash_get_stalls(struct udevice *dev)
+{
+	struct sandbox_flash_plat *plat = dev_get_plat(dev);
+
+	return plat->stalls;
 }
 
 static int sandbox_flash_probe(struct udevice *dev)
@@ -411,6 +961,7 @@ static int sandbox_flash_probe(struct udevice *dev)
 static const struct dm_usb_ops sandbox_usb_flash_ops = {
 	.control	= sandbox_flash_control,
 	.bulk		= sandbox_flash_bulk,
+	.bulk_queue	= sandbox_flash_bulk_queue,
 };
 
 static const struct udevice_id sandbox_usb_flash_ids[] = {
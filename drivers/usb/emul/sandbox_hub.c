@@ -7,6 +7,7 @@
 #include <common.h>
 #include <dm.h>
 #include <log.h>
+#include <time.h>
 #include <usb.h>
 #include <dm/device-internal.h>
 
@@ -114,9 +115,23 @@ static void *hub_desc_list[] = {
 	NULL,
 };
 
+/**
+ * struct sandbox_hub_priv - emulated hub
+ *
+ * @status:	Status of each port (USB_PORT_STAT_...)
+ * @change:	Changes on each port (USB_PORT_STAT_C_...)
+ * @connect_ms:	Time from port power-on until a device shows as connected
+ * @reset_ms:	Time taken by a port reset
+ * @connect_at:	Time at which the device on each port connects, 0 if none
+ * @reset_at:	Time at which the reset of each port finishes, 0 if none
+ */
 struct sandbox_hub_priv {
 	int status[SANDBOX_NUM_PORTS];
 	int change[SANDBOX_NUM_PORTS];
+	uint connect_ms;
+	uint reset_ms;
+	ulong connect_at[SANDBOX_NUM_PORTS];
+	ulong reset_at[SANDBOX_NUM_PORTS];
 };
 
 static struct udevice *hub_find_device(struct udevice *hub, int port,
@@ -145,6 +160,9 @@ static struct udevice *hub_find_device(struct udevice *hub, int port,
 			case 0x0101:
 				*speed = USB_SPEED_FULL;
 				break;
+			case 0x0300:
+				*speed = USB_SPEED_SUPER;
+				break;
 			case 0x0200:
 			default:
 				*speed = USB_SPEED_HIGH;
@@ -175,12 +193,25 @@ static int clrset_post_state(struct udevice *hub, int port, int clear, int set)
 				debug("%s: %s: power on, probed, ret=%d\n",
 				      __func__, dev->name, ret);
 				if (!ret) {
-					set |= USB_PORT_STAT_CONNECTION |
-						USB_PORT_STAT_ENABLE;
+					/*
+					 * The device may take a while to
+					 * connect, and then need a port reset
+					 * before it is enabled
+					 */
+					if (priv->connect_ms)
+						priv->connect_at[port] =
+							get_timer(0) +
+							priv->connect_ms;
+					else
+						set |= USB_PORT_STAT_CONNECTION;
+					if (!priv->reset_ms)
+						set |= USB_PORT_STAT_ENABLE;
 					if (speed == USB_SPEED_LOW)
 						set |= USB_PORT_STAT_LOW_SPEED;
 					else if (speed == USB_SPEED_HIGH)
 						set |= USB_PORT_STAT_HIGH_SPEED;
+					else if (speed == USB_SPEED_SUPER)
+						set |= USB_PORT_STAT_SUPER_SPEED;
 				}
 
 			} else if (clear & USB_PORT_STAT_POWER) {
@@ -188,9 +219,12 @@ static int clrset_post_state(struct udevice *hub, int port, int clear, int set)
 				      __func__, dev->name, ret);
 				ret = device_remove(dev, DM_REMOVE_NORMAL);
 				clear |= USB_PORT_STAT_CONNECTION;
+				priv->connect_at[port] = 0;
 			}
 		}
 	}
+	if ((set & USB_PORT_STAT_RESET) && priv->reset_ms)
+		priv->reset_at[port] = get_timer(0) + priv->reset_ms;
 	*change |= *status & clear;
 	*change |= ~*status & set;
 	*change &= 0x1f;
@@ -199,6 +233,26 @@ static int clrset_post_state(struct udevice *hub, int port, int clear, int set)
 	return ret;
 }
 
+/* Bring the port up to date with any connection or reset which is due */
+static void sandbox_hub_update_port(struct udevice *hub, int port)
+{
+	struct sandbox_hub_priv *priv = dev_get_priv(hub);
+	ulong now = get_timer(0);
+
+	if (priv->connect_at[port] && now >= priv->connect_at[port]) {
+		priv->connect_at[port] = 0;
+		priv->status[port] |= USB_PORT_STAT_CONNECTION;
+		priv->change[port] |= USB_PORT_STAT_C_CONNECTION;
+	}
+	if (priv->reset_at[port] && now >= priv->reset_at[port]) {
+		priv->reset_at[port] = 0;
+		priv->status[port] &= ~USB_PORT_STAT_RESET;
+		if (priv->status[port] & USB_PORT_STAT_CONNECTION)
+			priv->status[port] |= USB_PORT_STAT_ENABLE;
+		priv->change[port] |= USB_PORT_STAT_C_RESET;
+	}
+}
+
 static int sandbox_hub_submit_control_msg(struct udevice *bus,
 					  struct usb_device *udev,
 					  unsigned long pipe,
@@ -234,6 +288,7 @@ static int sandbox_hub_submit_control_msg(struct udevice *bus,
 				int port;
 
 				port = (setup->index & USB_HUB_PORT_MASK) - 1;
+				sandbox_hub_update_port(bus, port);
 				portsts->wPortStatus = priv->status[port];
 				portsts->wPortChange = priv->change[port];
 				udev->status = 0;
@@ -302,6 +357,16 @@ static int sandbox_hub_bind(struct udevice *dev)
 	return usb_emul_setup_device(dev, hub_strings, hub_desc_list);
 }
 
+static int sandbox_hub_probe(struct udevice *dev)
+{
+	struct sandbox_hub_priv *priv = dev_get_priv(dev);
+
+	priv->connect_ms = dev_read_u32_default(dev, "sandbox,connect-ms", 0);
+	priv->reset_ms = dev_read_u32_default(dev, "sandbox,reset-ms", 0);
+
+	return 0;
+}
+
 static int sandbox_child_post_bind(struct udevice *dev)
 {
 	struct sandbox_hub_plat *plat = dev_get_parent_plat(dev);
@@ -327,6 +392,7 @@ U_BOOT_DRIVER(usb_sandbox_hub) = {
 	.id	= UCLASS_USB_EMUL,
 	.of_match = sandbox_usb_hub_ids,
 	.bind	= sandbox_hub_bind,
+	.probe	= sandbox_hub_probe,
 	.ops	= &sandbox_usb_hub_ops,
 	.priv_auto	= sizeof(struct sandbox_hub_priv),
 	.per_child_plat_auto	= sizeof(struct sandbox_hub_plat),
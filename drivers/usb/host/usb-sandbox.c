@@ -8,17 +8,31 @@
 #include <dm.h>
 #include <log.h>
 #include <usb.h>
+#include <asm/test.h>
 #include <dm/root.h>
 #include <linux/usb/gadget.h>
 
+/* Most streams recorded on an endpoint, not counting stream 0 */
+#define SANDBOX_USB_MAX_STREAMS	16
+
 struct sandbox_udc {
 	struct usb_gadget gadget;
 };
 
 struct sandbox_udc *this_controller;
 
+/**
+ * struct sandbox_usb_ctrl - Sandbox USB controller
+ *
+ * @rootdev: Address of the root hub
+ * @bulk_queues: Number of times a set of bulk messages has been queued
+ * @stream_eps: Endpoints of each device which have streams, as a mask of
+ *	endpoint indexes, indexed by device address
+ */
 struct sandbox_usb_ctrl {
 	int rootdev;
+	int bulk_queues;
+	u32 stream_eps[USB_MAX_DEVICE];
 };
 
 static void usbmon_trace(struct udevice *bus, ulong pipe,
@@ -95,7 +109,7 @@ static int sandbox_submit_bulk(struct udevice *bus, struct usb_device *udev,
 	ret = usb_emul_bulk(emul, udev, pipe, buffer, length);
 	if (ret < 0) {
 		debug("ret=%d\n", ret);
-		udev->status = ret;
+		udev->status = ret == -EPIPE ? USB_ST_STALLED : ret;
 		udev->act_len = 0;
 	} else {
 		udev->status = 0;
@@ -105,6 +119,99 @@ static int sandbox_submit_bulk(struct udevice *bus, struct usb_device *udev,
 	return ret;
 }
 
+static int sandbox_submit_bulk_queue(struct udevice *bus,
+				     struct usb_device *udev,
+				     struct usb_bulk_req *reqs, int count)
+{
+	struct sandbox_usb_ctrl *ctrl = dev_get_priv(bus);
+	struct udevice *emul;
+	int i, ret;
+
+	for (i = 0; i < count; i++) {
+		if (reqs[i].stream && !(sandbox_usb_get_streams(bus, udev) &
+					BIT(usb_pipe_ep_index(reqs[i].pipe))))
+			return -EINVAL;
+	}
+	ctrl->bulk_queues++;
+
+	/* An emulator which takes the whole queue picks between the streams */
+	ret = usb_emul_find(bus, reqs[0].pipe, udev->portnr, &emul);
+	if (ret)
+		return ret;
+	ret = usb_emul_bulk_queue(emul, udev, reqs, count);
+	if (ret != -ENOSYS)
+		return ret;
+
+	/* There is no hardware to queue to, so do each one in turn */
+	for (i = 0; i < count; i++) {
+		sandbox_submit_bulk(bus, udev, reqs[i].pipe, reqs[i].buffer,
+				    reqs[i].length);
+		reqs[i].act_len = udev->act_len;
+		reqs[i].status = udev->status;
+		if (reqs[i].status)
+			break;
+	}
+
+	return 0;
+}
+
+int sandbox_usb_get_bulk_queues(struct udevice *bus)
+{
+	struct sandbox_usb_ctrl *ctrl = dev_get_priv(bus);
+
+	return ctrl->bulk_queues;
+}
+
+/*
+ * Streams are only recorded, since the emulator picks between them when the
+ * transfers are queued. As on xHCI, an endpoint which already has streams is refused
+ * without changing the others.
+ */
+static int sandbox_alloc_streams(struct udevice *bus, struct usb_device *udev,
+				 unsigned long *pipes, int num_pipes,
+				 int num_streams)
+{
+	struct sandbox_usb_ctrl *ctrl = dev_get_priv(bus);
+	u32 eps = 0;
+	int i;
+
+	if (udev->devnum >= USB_MAX_DEVICE)
+		return -EINVAL;
+	for (i = 0; i < num_pipes; i++) {
+		if (usb_pipetype(pipes[i]) != PIPE_BULK)
+			return -EINVAL;
+		eps |= BIT(usb_pipe_ep_index(pipes[i]));
+	}
+	if (ctrl->stream_eps[udev->devnum] & eps)
+		return -EBUSY;
+	ctrl->stream_eps[udev->devnum] |= eps;
+
+	return min(num_streams, SANDBOX_USB_MAX_STREAMS);
+}
+
+static int sandbox_free_streams(struct udevice *bus, struct usb_device *udev,
+				unsigned long *pipes, int num_pipes)
+{
+	struct sandbox_usb_ctrl *ctrl = dev_get_priv(bus);
+	int i;
+
+	if (udev->devnum >= USB_MAX_DEVICE)
+		return -EINVAL;
+	for (i = 0; i < num_pipes; i++)
+		ctrl->stream_eps[udev->devnum] &=
+			~BIT(usb_pipe_ep_index(pipes[i]));
+
+	return 0;
+}
+
+u32 sandbox_usb_get_streams(struct udevice *bus, struct usb_device *udev)
+{
+	struct sandbox_usb_ctrl *ctrl = dev_get_priv(bus);
+
+	return udev->devnum < USB_MAX_DEVICE ?
+		ctrl->stream_eps[udev->devnum] : 0;
+}
+
 static int sandbox_submit_int(struct udevice *bus, struct usb_device *udev,
 			      unsigned long pipe, void *buffer, int length,
 			      int interval, bool nonblock)
@@ -168,6 +275,9 @@ static int sandbox_usb_probe(struct udevice *dev)
 static const struct dm_usb_ops sandbox_usb_ops = {
 	.control	= sandbox_submit_control,
 	.bulk		= sandbox_submit_bulk,
+	.bulk_queue	= sandbox_submit_bulk_queue,
+	.alloc_streams	= sandbox_alloc_streams,
+	.free_streams	= sandbox_free_streams,
 	.interrupt	= sandbox_submit_int,
 	.alloc_device	= sandbox_alloc_device,
 };
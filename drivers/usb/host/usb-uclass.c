@@ -92,6 +92,18 @@ int submit_bulk_msg(struct usb_device *udev, unsigned long pipe, void *buffer,
 	return ops->bulk(bus, udev, pipe, buffer, length);
 }
 
+int submit_bulk_msgs(struct usb_device *udev, struct usb_bulk_req *reqs,
+		     int count)
+{
+	struct udevice *bus = udev->controller_dev;
+	struct dm_usb_ops *ops = usb_get_ops(bus);
+
+	if (!ops->bulk_queue)
+		return -ENOSYS;
+
+	return ops->bulk_queue(bus, udev, reqs, count);
+}
+
 struct int_queue *create_int_queue(struct usb_device *udev,
 		unsigned long pipe, int queuesize, int elementsize,
 		void *buffer, int interval)
@@ -173,6 +185,30 @@ int usb_get_max_xfer_size(struct usb_device *udev, size_t *size)
 	return ops->get_max_xfer_size(bus, size);
 }
 
+int usb_alloc_streams(struct usb_device *udev, unsigned long *pipes,
+		      int num_pipes, int num_streams)
+{
+	struct udevice *bus = udev->controller_dev;
+	struct dm_usb_ops *ops = usb_get_ops(bus);
+
+	if (!ops->alloc_streams)
+		return -ENOSYS;
+
+	return ops->alloc_streams(bus, udev, pipes, num_pipes, num_streams);
+}
+
+int usb_free_streams(struct usb_device *udev, unsigned long *pipes,
+		     int num_pipes)
+{
+	struct udevice *bus = udev->controller_dev;
+	struct dm_usb_ops *ops = usb_get_ops(bus);
+
+	if (!ops->free_streams)
+		return -ENOSYS;
+
+	return ops->free_streams(bus, udev, pipes, num_pipes);
+}
+
 int usb_stop(void)
 {
 	struct udevice *bus;
@@ -217,25 +253,66 @@ int usb_stop(void)
 
 static void usb_scan_bus(struct udevice *bus, bool recurse)
 {
-	struct usb_bus_priv *priv;
 	struct udevice *dev;
 	int ret;
 
-	priv = dev_get_uclass_priv(bus);
-
 	assert(recurse);	/* TODO: Support non-recusive */
 
-	printf("scanning bus %s for devices... ", bus->name);
-	debug("\n");
+	debug("scanning bus %s for devices...\n", bus->name);
 	ret = usb_scan_device(bus, 0, USB_SPEED_FULL, &dev);
 	if (ret)
-		printf("failed, error %d\n", ret);
-	else if (priv->next_addr == 0)
+		printf("scanning bus %s for devices... failed, error %d\n",
+		       bus->name, ret);
+}
+
+static void usb_show_bus(struct udevice *bus)
+{
+	struct usb_bus_priv *priv = dev_get_uclass_priv(bus);
+	struct udevice *hub;
+
+	/* Skip buses whose root hub could not be set up */
+	device_find_first_child(bus, &hub);
+	if (!hub || !device_active(hub))
+		return;
+
+	printf("scanning bus %s for devices... ", bus->name);
+	if (priv->next_addr == 0)
 		printf("No USB Device found\n");
 	else
 		printf("%d USB Device(s) found\n", priv->next_addr);
 }
 
+/*
+ * Set up the root hubs of all primary (or all companion) controllers before
+ * scanning any of their ports, so that the power-on and connection delays
+ * of the controllers overlap instead of adding up
+ */
+static void usb_scan_buses(struct uclass *uc, bool companion)
+{
+	struct usb_bus_priv *priv;
+	struct udevice *bus;
+
+	usb_hub_defer_scan();
+	uclass_foreach_dev(bus, uc) {
+		if (!device_active(bus))
+			continue;
+
+		priv = dev_get_uclass_priv(bus);
+		if (priv->companion == companion)
+			usb_scan_bus(bus, true);
+	}
+	usb_hub_run_scan();
+
+	uclass_foreach_dev(bus, uc) {
+		if (!device_active(bus))
+			continue;
+
+		priv = dev_get_uclass_priv(bus);
+		if (priv->companion == companion)
+			usb_show_bus(bus);
+	}
+}
+
 static void remove_inactive_children(struct uclass *uc, struct udevice *bus)
 {
 	uclass_foreach_dev(bus, uc) {
@@ -254,7 +331,6 @@ int usb_init(void)
 {
 	int controllers_initialized = 0;
 	struct usb_uclass_priv *uc_priv;
-	struct usb_bus_priv *priv;
 	struct udevice *bus;
 	struct uclass *uc;
 	int ret;
@@ -304,30 +380,15 @@ int usb_init(void)
 	 * lowlevel init done, now scan the bus for devices i.e. search HUBs
 	 * and configure them, first scan primary controllers.
 	 */
-	uclass_foreach_dev(bus, uc) {
-		if (!device_active(bus))
-			continue;
-
-		priv = dev_get_uclass_priv(bus);
-		if (!priv->companion)
-			usb_scan_bus(bus, true);
-	}
+	usb_scan_buses(uc, false);
 
 	/*
 	 * Now that the primary controllers have been scanned and have handed
 	 * over any devices they do not understand to their companions, scan
 	 * the companions if necessary.
 	 */
-	if (uc_priv->companion_device_count) {
-		uclass_foreach_dev(bus, uc) {
-			if (!device_active(bus))
-				continue;
-
-			priv = dev_get_uclass_priv(bus);
-			if (priv->companion)
-				usb_scan_bus(bus, true);
-		}
-	}
+	if (uc_priv->companion_device_count)
+		usb_scan_buses(uc, true);
 
 	debug("scan end\n");
 
@@ -43,6 +43,12 @@ static int usb_bootdev_bind(struct udevice *dev)
 	return 0;
 }
 
+/*
+ * There is no start() method: the waits for USB devices to connect and
+ * settle happen in usb_init(), which brings up the ports of each hub
+ * together. A USB bootdev is only bound once that has found its storage
+ * device, so by the time a scan sees it the media is ready.
+ */
 struct bootdev_ops usb_bootdev_ops = {
 	.get_bootflow	= usb_get_bootflow,
 };
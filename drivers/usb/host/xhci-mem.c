@@ -151,9 +151,11 @@ static void xhci_free_virt_devices(struct xhci_ctrl *ctrl)
 
 		ctrl->dcbaa->dev_context_ptrs[slot_id] = 0;
 
-		for (i = 0; i < 31; ++i)
+		for (i = 0; i < 31; ++i) {
+			xhci_free_stream_rings(&virt_dev->eps[i]);
 			if (virt_dev->eps[i].ring)
 				xhci_ring_free(virt_dev->eps[i].ring);
+		}
 
 		if (virt_dev->in_ctx)
 			xhci_free_container_ctx(virt_dev->in_ctx);
@@ -342,6 +344,62 @@ struct xhci_ring *xhci_ring_alloc(struct xhci_ctrl *ctrl, unsigned int num_segs,
 	return ring;
 }
 
+/**
+ * Allocates the stream context array of an endpoint and a ring for each
+ * stream, other than stream 0 which is reserved. The context array is left
+ * pointing at the rings, ready for a Configure Endpoint command.
+ *
+ * @param ctrl		host controller data structure
+ * @param ep		endpoint to set up
+ * @param num_streams	number of entries in the array, a power of two
+ * Return: none
+ */
+void xhci_alloc_stream_rings(struct xhci_ctrl *ctrl, struct xhci_virt_ep *ep,
+			     unsigned int num_streams)
+{
+	struct xhci_ring *ring;
+	unsigned int i;
+	u64 val_64;
+
+	ep->stream_ctx = xhci_malloc(num_streams *
+				     sizeof(struct xhci_stream_ctx));
+	ep->stream_rings = calloc(num_streams, sizeof(struct xhci_ring *));
+	BUG_ON(!ep->stream_rings);
+	ep->num_streams = num_streams;
+
+	for (i = 1; i < num_streams; i++) {
+		ring = xhci_ring_alloc(ctrl, 1, true);
+		ep->stream_rings[i] = ring;
+		val_64 = xhci_virt_to_bus(ctrl, ring->first_seg->trbs);
+		ep->stream_ctx[i].stream_ring = cpu_to_le64(val_64 |
+				SCT_FOR_CTX(SCT_PRI_TR) | ring->cycle_state);
+	}
+	xhci_flush_cache((uintptr_t)ep->stream_ctx,
+			 num_streams * sizeof(struct xhci_stream_ctx));
+}
+
+/**
+ * Frees the stream context array and stream rings of an endpoint
+ *
+ * @param ep	endpoint to free
+ * Return: none
+ */
+void xhci_free_stream_rings(struct xhci_virt_ep *ep)
+{
+	unsigned int i;
+
+	if (!ep->stream_rings)
+		return;
+	for (i = 1; i < ep->num_streams; i++)
+		xhci_ring_free(ep->stream_rings[i]);
+	free(ep->stream_rings);
+	free(ep->stream_ctx);
+	ep->stream_rings = NULL;
+	ep->stream_ctx = NULL;
+	ep->num_streams = 0;
+	ep->ep_state &= ~EP_HAS_STREAMS;
+}
+
 /**
  * Set up the scratchpad buffer array and scratchpad buffers
  *
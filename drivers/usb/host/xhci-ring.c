@@ -268,11 +268,12 @@ static int prepare_ring(struct xhci_ctrl *ctrl, struct xhci_ring *ep_ring,
  * @param ptr		Pointer address to write in the first two fields (opt.)
  * @param slot_id	Slot ID to encode in the flags field (opt.)
  * @param ep_index	Endpoint index to encode in the flags field (opt.)
+ * @param stream_id	Stream ID to encode in the status field (opt.)
  * @param cmd		Command type to enqueue
  * Return: none
  */
-void xhci_queue_command(struct xhci_ctrl *ctrl, u8 *ptr, u32 slot_id,
-			u32 ep_index, trb_type cmd)
+static void queue_command(struct xhci_ctrl *ctrl, u8 *ptr, u32 slot_id,
+			  u32 ep_index, u32 stream_id, trb_type cmd)
 {
 	u32 fields[4];
 	u64 val_64 = 0;
@@ -284,7 +285,7 @@ void xhci_queue_command(struct xhci_ctrl *ctrl, u8 *ptr, u32 slot_id,
 
 	fields[0] = lower_32_bits(val_64);
 	fields[1] = upper_32_bits(val_64);
-	fields[2] = 0;
+	fields[2] = STREAM_ID_FOR_TRB(stream_id);
 	fields[3] = TRB_TYPE(cmd) | SLOT_ID_FOR_TRB(slot_id) |
 		    ctrl->cmd_ring->cycle_state;
 
@@ -301,6 +302,15 @@ void xhci_queue_command(struct xhci_ctrl *ctrl, u8 *ptr, u32 slot_id,
 	xhci_writel(&ctrl->dba->doorbell[0], DB_VALUE_HOST);
 }
 
+/**
+ * Queue a command which is not for a particular stream, see queue_command()
+ */
+void xhci_queue_command(struct xhci_ctrl *ctrl, u8 *ptr, u32 slot_id,
+			u32 ep_index, trb_type cmd)
+{
+	queue_command(ctrl, ptr, slot_id, ep_index, 0, cmd);
+}
+
 /*
  * For xHCI 1.0 host controllers, TD size is the number of max packet sized
  * packets remaining in the TD (*not* including this TRB).
@@ -359,12 +369,13 @@ static u32 xhci_td_remainder(struct xhci_ctrl *ctrl, int transferred,
  *
  * @param udev		pointer to the USB device structure
  * @param ep_index	index of the endpoint
+ * @param stream_id	stream of the TD, 0 if the endpoint has no streams
  * @param start_cycle	cycle flag of the first TRB
  * @param start_trb	pionter to the first TRB
  * Return: none
  */
 static void giveback_first_trb(struct usb_device *udev, int ep_index,
-				int start_cycle,
+				unsigned int stream_id, int start_cycle,
 				struct xhci_generic_trb *start_trb)
 {
 	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
@@ -382,7 +393,7 @@ static void giveback_first_trb(struct usb_device *udev, int ep_index,
 
 	/* Ringing EP doorbell here */
 	xhci_writel(&ctrl->dba->doorbell[udev->slot_id],
-				DB_VALUE(ep_index, 0));
+				DB_VALUE(ep_index, stream_id));
 
 	return;
 }
@@ -436,7 +447,8 @@ static int event_ready(struct xhci_ctrl *ctrl)
  * processing the event, and must not access the returned pointer afterwards.
  *
  * @param ctrl		Host controller data structure
- * @param expected	TRB type expected from Event TRB
+ * @param expected	TRB type expected from Event TRB, or TRB_NONE for any
+ *			event other than a port status change
  * Return: pointer to event trb
  */
 union xhci_trb *xhci_wait_for_event(struct xhci_ctrl *ctrl, trb_type expected)
@@ -451,7 +463,8 @@ union xhci_trb *xhci_wait_for_event(struct xhci_ctrl *ctrl, trb_type expected)
 			continue;
 
 		type = TRB_FIELD_TO_TYPE(le32_to_cpu(event->event_cmd.flags));
-		if (type == expected)
+		if (type == expected ||
+		    (expected == TRB_NONE && type != TRB_PORT_STATUS))
 			return event;
 
 		if (type == TRB_PORT_STATUS)
@@ -481,6 +494,65 @@ union xhci_trb *xhci_wait_for_event(struct xhci_ctrl *ctrl, trb_type expected)
 	BUG();
 }
 
+/**
+ * Gets the transfer ring for a stream of an endpoint
+ *
+ * @param ep		endpoint
+ * @param stream_id	stream, 0 if the endpoint does not use streams
+ * Return: the ring, or NULL if the endpoint has no such stream
+ */
+static struct xhci_ring *stream_ring(struct xhci_virt_ep *ep,
+				     unsigned int stream_id)
+{
+	if (!(ep->ep_state & EP_HAS_STREAMS))
+		return stream_id ? NULL : ep->ring;
+	if (!stream_id || stream_id >= ep->num_streams)
+		return NULL;
+
+	return ep->stream_rings[stream_id];
+}
+
+/*
+ * Moves the xHC's dequeue pointer for one stream of a stopped or halted
+ * endpoint on to our enqueue pointer, throwing away any TRBs not yet
+ * processed. Endpoints without streams use stream 0.
+ */
+static void set_deq(struct usb_device *udev, int ep_index,
+		    unsigned int stream_id)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	struct xhci_virt_ep *ep = &ctrl->devs[udev->slot_id]->eps[ep_index];
+	struct xhci_ring *ring = stream_ring(ep, stream_id);
+	union xhci_trb *event;
+	uintptr_t deq;
+
+	deq = (uintptr_t)ring->enqueue | ring->cycle_state;
+	if (stream_id)
+		deq |= SCT_FOR_CTX(SCT_PRI_TR);
+	queue_command(ctrl, (void *)deq, udev->slot_id, ep_index, stream_id,
+		      TRB_SET_DEQ);
+	event = xhci_wait_for_event(ctrl, TRB_COMPLETION);
+	BUG_ON(TRB_TO_SLOT_ID(le32_to_cpu(event->event_cmd.flags))
+		!= udev->slot_id || GET_COMP_CODE(le32_to_cpu(
+		event->event_cmd.status)) != COMP_SUCCESS);
+	xhci_acknowledge_event(ctrl);
+}
+
+/* Throws away the unprocessed TRBs on each of an endpoint's rings */
+static void set_deq_all(struct usb_device *udev, int ep_index)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	struct xhci_virt_ep *ep = &ctrl->devs[udev->slot_id]->eps[ep_index];
+	unsigned int i;
+
+	if (!(ep->ep_state & EP_HAS_STREAMS)) {
+		set_deq(udev, ep_index, 0);
+		return;
+	}
+	for (i = 1; i < ep->num_streams; i++)
+		set_deq(udev, ep_index, i);
+}
+
 /*
  * Send reset endpoint command for given endpoint. This recovers from a
  * halted endpoint (e.g. due to a stall error).
@@ -488,64 +560,83 @@ union xhci_trb *xhci_wait_for_event(struct xhci_ctrl *ctrl, trb_type expected)
 static void reset_ep(struct usb_device *udev, int ep_index)
 {
 	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
-	struct xhci_ring *ring =  ctrl->devs[udev->slot_id]->eps[ep_index].ring;
 	union xhci_trb *event;
 	u32 field;
 
-	printf("Resetting EP %d...\n", ep_index);
+	debug("Resetting EP %d...\n", ep_index);
 	xhci_queue_command(ctrl, NULL, udev->slot_id, ep_index, TRB_RESET_EP);
 	event = xhci_wait_for_event(ctrl, TRB_COMPLETION);
 	field = le32_to_cpu(event->trans_event.flags);
 	BUG_ON(TRB_TO_SLOT_ID(field) != udev->slot_id);
 	xhci_acknowledge_event(ctrl);
 
-	xhci_queue_command(ctrl, (void *)((uintptr_t)ring->enqueue |
-		ring->cycle_state), udev->slot_id, ep_index, TRB_SET_DEQ);
-	event = xhci_wait_for_event(ctrl, TRB_COMPLETION);
-	BUG_ON(TRB_TO_SLOT_ID(le32_to_cpu(event->event_cmd.flags))
-		!= udev->slot_id || GET_COMP_CODE(le32_to_cpu(
-		event->event_cmd.status)) != COMP_SUCCESS);
-	xhci_acknowledge_event(ctrl);
+	set_deq_all(udev, ep_index);
 }
 
+static struct usb_bulk_req *xhci_bulk_event(struct usb_device *udev,
+					    struct usb_bulk_req *reqs,
+					    int count, union xhci_trb *event);
+
 /*
  * Stops transfer processing for an endpoint and throws away all unprocessed
  * TRBs by setting the xHC's dequeue pointer to our enqueue pointer. The next
  * xhci_bulk_tx/xhci_ctrl_tx on this enpoint will add new transfers there and
  * ring the doorbell, causing this endpoint to start working again.
- * (Careful: This will BUG() when there was no transfer in progress. Shouldn't
- * happen in practice for current uses and is too complicated to fix right now.)
+ *
+ * A TD may complete before the endpoint stops, so the events which arrive
+ * before the command completes are not all for the stop itself. Those for
+ * BULK requests in @reqs are recorded as their results; others are dropped.
+ * An endpoint which has halted cannot be stopped, so it is reset instead.
  */
-static void abort_td(struct usb_device *udev, int ep_index)
+static void abort_td(struct usb_device *udev, int ep_index,
+		     struct usb_bulk_req *reqs, int count)
 {
 	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
-	struct xhci_ring *ring =  ctrl->devs[udev->slot_id]->eps[ep_index].ring;
 	union xhci_trb *event;
+	xhci_comp_code comp;
+	trb_type type;
 	u32 field;
 
 	xhci_queue_command(ctrl, NULL, udev->slot_id, ep_index, TRB_STOP_RING);
 
-	event = xhci_wait_for_event(ctrl, TRB_TRANSFER);
-	field = le32_to_cpu(event->trans_event.flags);
-	BUG_ON(TRB_TO_SLOT_ID(field) != udev->slot_id);
-	BUG_ON(TRB_TO_EP_INDEX(field) != ep_index);
-	BUG_ON(GET_COMP_CODE(le32_to_cpu(event->trans_event.transfer_len
-		!= COMP_STOP)));
-	xhci_acknowledge_event(ctrl);
+	/*
+	 * An endpoint which is between TDs, or which has streams and is
+	 * waiting for the device to pick one, gives no transfer event
+	 */
+	for (;;) {
+		event = xhci_wait_for_event(ctrl, TRB_NONE);
+		type = TRB_FIELD_TO_TYPE(le32_to_cpu(event->event_cmd.flags));
+		if (type == TRB_COMPLETION)
+			break;
+		if (type != TRB_TRANSFER) {
+			xhci_acknowledge_event(ctrl);
+			continue;
+		}
 
-	event = xhci_wait_for_event(ctrl, TRB_COMPLETION);
-	BUG_ON(TRB_TO_SLOT_ID(le32_to_cpu(event->event_cmd.flags))
-		!= udev->slot_id || GET_COMP_CODE(le32_to_cpu(
-		event->event_cmd.status)) != COMP_SUCCESS);
-	xhci_acknowledge_event(ctrl);
+		field = le32_to_cpu(event->trans_event.flags);
+		comp = GET_COMP_CODE(le32_to_cpu(
+				event->trans_event.transfer_len));
+		BUG_ON(TRB_TO_SLOT_ID(field) != udev->slot_id);
+		if (comp == COMP_STOP || comp == COMP_STOP_INVAL) {
+			BUG_ON(TRB_TO_EP_INDEX(field) != ep_index);
+			xhci_acknowledge_event(ctrl);
+		} else if (reqs) {
+			xhci_bulk_event(udev, reqs, count, event);
+		} else {
+			xhci_acknowledge_event(ctrl);
+		}
+	}
 
-	xhci_queue_command(ctrl, (void *)((uintptr_t)ring->enqueue |
-		ring->cycle_state), udev->slot_id, ep_index, TRB_SET_DEQ);
-	event = xhci_wait_for_event(ctrl, TRB_COMPLETION);
+	comp = GET_COMP_CODE(le32_to_cpu(event->event_cmd.status));
 	BUG_ON(TRB_TO_SLOT_ID(le32_to_cpu(event->event_cmd.flags))
-		!= udev->slot_id || GET_COMP_CODE(le32_to_cpu(
-		event->event_cmd.status)) != COMP_SUCCESS);
+		!= udev->slot_id ||
+		(comp != COMP_SUCCESS && comp != COMP_CTX_STATE));
 	xhci_acknowledge_event(ctrl);
+
+	if (comp == COMP_CTX_STATE)
+		reset_ep(udev, ep_index);
+	else
+		set_deq_all(udev, ep_index);
 }
 
 static void record_transfer_result(struct usb_device *udev,
@@ -578,18 +669,58 @@ static void record_transfer_result(struct usb_device *udev,
 
 /**** Bulk and Control transfer methods ****/
 /**
- * Queues up the BULK Request
+ * Works out the number of TRBs needed for a bulk TD
+ *
+ * XHCI Spec puts restriction( TABLE 49 and 6.4.1 section of XHCI Spec)
+ * that the buffer should not span 64KB boundary. if so
+ * we send request in more than 1 TRB by chaining them.
+ *
+ * @param addr		bus address of the buffer
+ * @param length	length of the buffer
+ * Return: number of TRBs
+ */
+static int xhci_bulk_num_trbs(u64 addr, int length)
+{
+	int running_total;
+	int num_trbs = 0;
+
+	/* How much data is (potentially) left before the 64KB boundary? */
+	running_total = TRB_MAX_BUFF_SIZE -
+			(lower_32_bits(addr) & (TRB_MAX_BUFF_SIZE - 1));
+	running_total &= TRB_MAX_BUFF_SIZE - 1;
+
+	/*
+	 * If there's some data on this 64KB chunk, or we have to send a
+	 * zero-length transfer, we need at least one TRB
+	 */
+	if (running_total != 0 || length == 0)
+		num_trbs++;
+
+	/* How many more 64KB chunks to transfer, how many more TRBs? */
+	while (running_total < length) {
+		num_trbs++;
+		running_total += TRB_MAX_BUFF_SIZE;
+	}
+
+	return num_trbs;
+}
+
+/**
+ * Queues up a BULK TD and hands it to the hardware, without waiting for it
  *
  * @param udev		pointer to the USB device structure
  * @param pipe		contains the DIR_IN or OUT , devnum
+ * @param stream	stream to queue the TD on, 0 if none
  * @param length	length of the buffer
  * @param buffer	buffer to be read/written based on the request
- * Return: returns 0 if successful else -1 on failure
+ * @param lastp		returns the last TRB of the TD, whose event marks
+ *			the end of the transfer
+ * Return: 0 if successful else error code on failure
  */
-int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
-			int length, void *buffer)
+static int xhci_bulk_queue(struct usb_device *udev, unsigned long pipe,
+			   int stream, int length, void *buffer, void **lastp)
 {
-	int num_trbs = 0;
+	int num_trbs;
 	struct xhci_generic_trb *start_trb;
 	bool first_trb = false;
 	int start_cycle;
@@ -601,7 +732,6 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 	struct xhci_virt_device *virt_dev;
 	struct xhci_ep_ctx *ep_ctx;
 	struct xhci_ring *ring;		/* EP transfer ring */
-	union xhci_trb *event;
 
 	int running_total, trb_buff_len;
 	bool more_trbs_coming = true;
@@ -610,13 +740,10 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 	int ret;
 	u32 trb_fields[4];
 	u64 val_64 = xhci_virt_to_bus(ctrl, buffer);
-	void *last_transfer_trb_addr;
-	int available_length;
 
 	debug("dev=%p, pipe=%lx, buffer=%p, length=%d\n",
 		udev, pipe, buffer, length);
 
-	available_length = length;
 	ep_index = usb_pipe_ep_index(pipe);
 	virt_dev = ctrl->devs[slot_id];
 
@@ -625,30 +752,10 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 
 	ep_ctx = xhci_get_ep_ctx(ctrl, virt_dev->out_ctx, ep_index);
 
-	ring = virt_dev->eps[ep_index].ring;
-	/*
-	 * How much data is (potentially) left before the 64KB boundary?
-	 * XHCI Spec puts restriction( TABLE 49 and 6.4.1 section of XHCI Spec)
-	 * that the buffer should not span 64KB boundary. if so
-	 * we send request in more than 1 TRB by chaining them.
-	 */
-	running_total = TRB_MAX_BUFF_SIZE -
-			(lower_32_bits(val_64) & (TRB_MAX_BUFF_SIZE - 1));
-	trb_buff_len = running_total;
-	running_total &= TRB_MAX_BUFF_SIZE - 1;
-
-	/*
-	 * If there's some data on this 64KB chunk, or we have to send a
-	 * zero-length transfer, we need at least one TRB
-	 */
-	if (running_total != 0 || length == 0)
-		num_trbs++;
-
-	/* How many more 64KB chunks to transfer, how many more TRBs? */
-	while (running_total < length) {
-		num_trbs++;
-		running_total += TRB_MAX_BUFF_SIZE;
-	}
+	ring = stream_ring(&virt_dev->eps[ep_index], stream);
+	if (!ring)
+		return -EINVAL;
+	num_trbs = xhci_bulk_num_trbs(val_64, length);
 
 	/*
 	 * XXX: Calling routine prepare_ring() called in place of
@@ -672,14 +779,9 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 	maxpacketsize = usb_maxpacket(udev, pipe);
 
 	/* How much data is in the first TRB? */
-	/*
-	 * How much data is (potentially) left before the 64KB boundary?
-	 * XHCI Spec puts restriction( TABLE 49 and 6.4.1 section of XHCI Spec)
-	 * that the buffer should not span 64KB boundary. if so
-	 * we send request in more than 1 TRB by chaining them.
-	 */
 	addr = val_64;
-
+	trb_buff_len = TRB_MAX_BUFF_SIZE -
+		       (lower_32_bits(val_64) & (TRB_MAX_BUFF_SIZE - 1));
 	if (trb_buff_len > length)
 		trb_buff_len = length;
 
@@ -730,7 +832,7 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 		trb_fields[2] = length_field;
 		trb_fields[3] = field | TRB_TYPE(TRB_NORMAL);
 
-		last_transfer_trb_addr = queue_trb(ctrl, ring, (num_trbs > 1), trb_fields);
+		*lastp = queue_trb(ctrl, ring, (num_trbs > 1), trb_fields);
 
 		--num_trbs;
 
@@ -741,33 +843,295 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 		trb_buff_len = min((length - running_total), TRB_MAX_BUFF_SIZE);
 	} while (running_total < length);
 
-	giveback_first_trb(udev, ep_index, start_cycle, start_trb);
+	giveback_first_trb(udev, ep_index, stream, start_cycle, start_trb);
 
-again:
-	event = xhci_wait_for_event(ctrl, TRB_TRANSFER);
-	if (!event) {
-		debug("XHCI bulk transfer timed out, aborting...\n");
-		abort_td(udev, ep_index);
-		udev->status = USB_ST_NAK_REC;  /* closest thing to a timeout */
-		udev->act_len = 0;
-		return -ETIMEDOUT;
+	return 0;
+}
+
+/**
+ * Gets the transfer ring used by a BULK request
+ *
+ * @param udev		pointer to the USB device structure
+ * @param req		request
+ * Return: the ring, or NULL if the request's stream is not set up
+ */
+static struct xhci_ring *xhci_bulk_ring(struct usb_device *udev,
+					struct usb_bulk_req *req)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	int ep_index = usb_pipe_ep_index(req->pipe);
+
+	return stream_ring(&ctrl->devs[udev->slot_id]->eps[ep_index],
+			   req->stream);
+}
+
+/**
+ * Checks whether a TRB, given by its bus address, is on a ring
+ *
+ * @param ctrl		host controller data structure
+ * @param ring		ring to check
+ * @param addr		bus address of the TRB
+ * Return: true if the TRB is in one of the ring's segments
+ */
+static bool xhci_ring_has_trb(struct xhci_ctrl *ctrl, struct xhci_ring *ring,
+			      u64 addr)
+{
+	struct xhci_segment *seg = ring->first_seg;
+	u64 start;
+
+	do {
+		start = xhci_virt_to_bus(ctrl, seg->trbs);
+		if (addr >= start && addr < start + SEGMENT_SIZE)
+			return true;
+		seg = seg->next;
+	} while (seg && seg != ring->first_seg);
+
+	return false;
+}
+
+/**
+ * Finds the BULK request that a transfer event is for: the first one still
+ * queued on the ring holding the event's TRB. A TD which stops with an
+ * error may not give a TRB, so fall back to the first one on the endpoint.
+ *
+ * @param udev		pointer to the USB device structure
+ * @param reqs		requests, with hcpriv set for those still queued
+ * @param count		number of requests
+ * @param event		transfer event
+ * Return: the request, or NULL if none is queued on the endpoint
+ */
+static struct usb_bulk_req *xhci_bulk_find(struct usb_device *udev,
+					   struct usb_bulk_req *reqs,
+					   int count, union xhci_trb *event)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	u32 field = le32_to_cpu(event->trans_event.flags);
+	u64 addr = le64_to_cpu(event->trans_event.buffer);
+	struct usb_bulk_req *first = NULL;
+	int ep_index;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		ep_index = usb_pipe_ep_index(reqs[i].pipe);
+		if (!reqs[i].hcpriv || ep_index != TRB_TO_EP_INDEX(field))
+			continue;
+		if (xhci_ring_has_trb(ctrl, xhci_bulk_ring(udev, &reqs[i]),
+				      addr))
+			return &reqs[i];
+		if (!first)
+			first = &reqs[i];
 	}
 
+	return first;
+}
+
+/**
+ * Records a transfer event against the BULK request it is for. An event for
+ * a TRB before the last one of a TD only counts what was not transferred.
+ *
+ * @param udev		pointer to the USB device structure
+ * @param reqs		requests, with hcpriv set for those still queued
+ * @param count		number of requests
+ * @param event		transfer event, which is acknowledged
+ * Return: the request which the event finished, else NULL
+ */
+static struct usb_bulk_req *xhci_bulk_event(struct usb_device *udev,
+					    struct usb_bulk_req *reqs,
+					    int count, union xhci_trb *event)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	struct usb_bulk_req *req;
+
+	/* Each ring completes its TDs in the order they were queued */
+	req = xhci_bulk_find(udev, reqs, count, event);
+	BUG_ON(!req);
+
 	if ((uintptr_t)(le64_to_cpu(event->trans_event.buffer)) !=
-	    (uintptr_t)xhci_virt_to_bus(ctrl, last_transfer_trb_addr)) {
-		available_length -=
-			(int)EVENT_TRB_LEN(le32_to_cpu(event->trans_event.transfer_len));
+	    (uintptr_t)xhci_virt_to_bus(ctrl, req->hcpriv)) {
+		req->act_len -= (int)EVENT_TRB_LEN(
+			le32_to_cpu(event->trans_event.transfer_len));
 		xhci_acknowledge_event(ctrl);
-		goto again;
+		return NULL;
 	}
 
-	field = le32_to_cpu(event->trans_event.flags);
-	BUG_ON(TRB_TO_SLOT_ID(field) != slot_id);
-	BUG_ON(TRB_TO_EP_INDEX(field) != ep_index);
-
-	record_transfer_result(udev, event, available_length);
+	record_transfer_result(udev, event, req->act_len);
 	xhci_acknowledge_event(ctrl);
-	xhci_inval_cache((uintptr_t)buffer, length);
+	xhci_inval_cache((uintptr_t)req->buffer, req->length);
+	req->act_len = udev->act_len;
+	req->status = udev->status;
+	req->hcpriv = NULL;
+
+	return req;
+}
+
+/**
+ * Marks the BULK requests still queued on an endpoint as dropped, once the
+ * endpoint's ring has been moved on past them
+ *
+ * @param reqs		requests, with hcpriv set for those still queued
+ * @param count		number of requests
+ * @param ep_index	index of the endpoint
+ * Return: none
+ */
+static void xhci_bulk_drop(struct usb_bulk_req *reqs, int count, int ep_index)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		int req_ep_index = usb_pipe_ep_index(reqs[i].pipe);
+
+		if (reqs[i].hcpriv && req_ep_index == ep_index) {
+			reqs[i].hcpriv = NULL;
+			reqs[i].act_len = 0;
+		}
+	}
+}
+
+/**
+ * Throws away the TDs still queued for a set of BULK requests, stopping
+ * each endpoint that has any
+ *
+ * @param udev		pointer to the USB device structure
+ * @param reqs		requests, with hcpriv set for those still queued
+ * @param count		number of requests
+ * Return: none
+ */
+static void xhci_bulk_cancel(struct usb_device *udev,
+			     struct usb_bulk_req *reqs, int count)
+{
+	int ep_index;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (!reqs[i].hcpriv)
+			continue;
+		ep_index = usb_pipe_ep_index(reqs[i].pipe);
+		abort_td(udev, ep_index, reqs, count);
+		xhci_bulk_drop(reqs, count, ep_index);
+	}
+}
+
+/**
+ * Queues up several BULK requests, letting the hardware run them back to
+ * back, and waits for them all to complete
+ *
+ * Requests on the same endpoint and stream are carried out in order. When
+ * one fails, the endpoint is reset, which drops any later requests on it,
+ * and those still queued on other endpoints are thrown away.
+ *
+ * @param udev		pointer to the USB device structure
+ * @param reqs		requests to carry out
+ * @param count		number of requests
+ * Return: 0 if the requests were processed (see the status of each),
+ *	-ENOSPC if they do not fit on the transfer rings, else error code
+ */
+int xhci_bulk_tx_queue(struct usb_device *udev, struct usb_bulk_req *reqs,
+		       int count)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	struct usb_bulk_req *req;
+	struct xhci_ring *ring;
+	union xhci_trb *event;
+	int ep_index;
+	int pending;
+	int ret = 0;
+	u32 field;
+	int trbs;
+	int i, j;
+
+	/*
+	 * Nothing is taken off the rings until the end, so check that it all
+	 * fits first. Each ring has one segment ending in a link TRB.
+	 */
+	for (i = 0; i < count; i++) {
+		req = &reqs[i];
+		if (usb_pipetype(req->pipe) != PIPE_BULK) {
+			printf("non-bulk pipe (type=%lu)", usb_pipetype(req->pipe));
+			return -EINVAL;
+		}
+		ring = xhci_bulk_ring(udev, req);
+		if (!ring)
+			return -EINVAL;
+		trbs = 0;
+		for (j = 0; j <= i; j++) {
+			if (xhci_bulk_ring(udev, &reqs[j]) == ring)
+				trbs += xhci_bulk_num_trbs(
+					xhci_virt_to_bus(ctrl, reqs[j].buffer),
+					reqs[j].length);
+		}
+		if (trbs > TRBS_PER_SEGMENT - 1)
+			return -ENOSPC;
+	}
+
+	for (pending = 0; pending < count; pending++) {
+		req = &reqs[pending];
+		req->status = USB_ST_NOT_PROC;
+		req->act_len = req->length;
+		ret = xhci_bulk_queue(udev, req->pipe, req->stream, req->length,
+				      req->buffer, &req->hcpriv);
+		if (ret) {
+			req->hcpriv = NULL;
+			xhci_bulk_cancel(udev, reqs, pending);
+			return ret;
+		}
+	}
+
+	while (pending) {
+		event = xhci_wait_for_event(ctrl, TRB_TRANSFER);
+		if (!event) {
+			debug("XHCI bulk transfer timed out, aborting...\n");
+			xhci_bulk_cancel(udev, reqs, count);
+			return -ETIMEDOUT;
+		}
+
+		field = le32_to_cpu(event->trans_event.flags);
+		BUG_ON(TRB_TO_SLOT_ID(field) != udev->slot_id);
+
+		req = xhci_bulk_event(udev, reqs, count, event);
+		if (!req)
+			continue;
+		pending--;
+
+		if (req->status) {
+			ep_index = usb_pipe_ep_index(req->pipe);
+			/* The endpoint has halted; resetting it drops its TDs */
+			reset_ep(udev, ep_index);
+			xhci_bulk_drop(reqs, count, ep_index);
+			xhci_bulk_cancel(udev, reqs, count);
+			break;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Queues up the BULK Request
+ *
+ * @param udev		pointer to the USB device structure
+ * @param pipe		contains the DIR_IN or OUT , devnum
+ * @param length	length of the buffer
+ * @param buffer	buffer to be read/written based on the request
+ * Return: returns 0 if successful else -1 on failure
+ */
+int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
+			int length, void *buffer)
+{
+	struct usb_bulk_req req = {
+		.pipe	= pipe,
+		.buffer	= buffer,
+		.length	= length,
+	};
+	int ret;
+
+	ret = xhci_bulk_tx_queue(udev, &req, 1);
+	if (ret == -ETIMEDOUT) {
+		udev->status = USB_ST_NAK_REC;  /* closest thing to a timeout */
+		udev->act_len = 0;
+		return ret;
+	} else if (ret) {
+		return ret;
+	}
 
 	return (udev->status != USB_ST_NOT_PROC) ? 0 : -1;
 }
@@ -943,7 +1307,7 @@ int xhci_ctrl_tx(struct usb_device *udev, unsigned long pipe,
 
 	queue_trb(ctrl, ep_ring, false, trb_fields);
 
-	giveback_first_trb(udev, ep_index, start_cycle, start_trb);
+	giveback_first_trb(udev, ep_index, 0, start_cycle, start_trb);
 
 	event = xhci_wait_for_event(ctrl, TRB_TRANSFER);
 	if (!event)
@@ -979,7 +1343,7 @@ int xhci_ctrl_tx(struct usb_device *udev, unsigned long pipe,
 
 abort:
 	debug("XHCI control transfer timed out, aborting...\n");
-	abort_td(udev, ep_index);
+	abort_td(udev, ep_index, NULL, 0);
 	udev->status = USB_ST_NAK_REC;
 	udev->act_len = 0;
 	return -ETIMEDOUT;
@@ -36,6 +36,7 @@
 #include <linux/delay.h>
 #include <linux/errno.h>
 #include <linux/iopoll.h>
+#include <linux/log2.h>
 
 static struct descriptor {
 	struct usb_hub_descriptor hub;
@@ -613,6 +614,188 @@ static int xhci_set_configuration(struct usb_device *udev)
 	return xhci_configure_endpoints(udev, false);
 }
 
+/**
+ * Gets the number of streams the device supports on an endpoint, from the
+ * SuperSpeed companion descriptor of the last interface setting using it
+ *
+ * @param udev		pointer to the USB device structure
+ * @param pipe		pipe of the endpoint
+ * Return: number of streams, not counting stream 0, or 0 if none
+ */
+static int xhci_get_endpoint_streams(struct usb_device *udev,
+				     unsigned long pipe)
+{
+	struct usb_interface *ifdesc;
+	int max_streams = 0;
+	int i, j;
+
+	for (i = 0; i < udev->config.no_of_if; i++) {
+		ifdesc = &udev->config.if_desc[i];
+		for (j = 0; j < ifdesc->no_of_ep; j++) {
+			struct usb_endpoint_descriptor *desc =
+				&ifdesc->ep_desc[j];
+
+			if (usb_endpoint_num(desc) != usb_pipeendpoint(pipe) ||
+			    !usb_endpoint_dir_in(desc) != !usb_pipein(pipe))
+				continue;
+			max_streams = (1 << (ifdesc->ss_ep_comp_desc[j].bmAttributes
+					     & 0x1f)) - 1;
+		}
+	}
+
+	return max_streams;
+}
+
+/**
+ * Re-adds a set of endpoints with a Configure Endpoint command, to change
+ * whether they use streams. The endpoint contexts must be set up in the
+ * input context.
+ *
+ * @param udev		pointer to the USB device structure
+ * @param ep_flags	add/drop flags of the endpoints
+ * Return: 0 if successful else error code on failure
+ */
+static int xhci_reconfigure_endpoints(struct usb_device *udev, u32 ep_flags)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	struct xhci_virt_device *virt_dev = ctrl->devs[udev->slot_id];
+	struct xhci_input_control_ctx *ctrl_ctx;
+	int ret;
+
+	ctrl_ctx = xhci_get_input_control_ctx(virt_dev->in_ctx);
+	xhci_slot_copy(ctrl, virt_dev->in_ctx, virt_dev->out_ctx);
+	ctrl_ctx->add_flags = cpu_to_le32(SLOT_FLAG | ep_flags);
+	ctrl_ctx->drop_flags = cpu_to_le32(ep_flags);
+	ret = xhci_configure_endpoints(udev, false);
+	ctrl_ctx->drop_flags = 0;
+
+	return ret;
+}
+
+/**
+ * Sets up streams on a set of bulk endpoints, giving each the same number
+ *
+ * @param udev		pointer to the USB device structure
+ * @param pipes		pipes of the endpoints
+ * @param num_pipes	number of pipes
+ * @param num_streams	number of streams wanted, not counting stream 0
+ * Return: number of streams set up, else error code on failure
+ */
+static int _xhci_alloc_streams(struct usb_device *udev, unsigned long *pipes,
+			       int num_pipes, int num_streams)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	struct xhci_virt_device *virt_dev = ctrl->devs[udev->slot_id];
+	u32 hcc_params = xhci_readl(&ctrl->hccr->cr_hccparams);
+	struct xhci_virt_ep *ep;
+	struct xhci_ep_ctx *ep_ctx;
+	unsigned int size;
+	u32 ep_flags = 0;
+	int ep_index;
+	int i, ret;
+
+	/* A Maximum Primary Stream Array Size of 0 means no streams */
+	if (udev->speed < USB_SPEED_SUPER || !((hcc_params >> 12) & 0xf))
+		return -ENOSYS;
+	for (i = 0; i < num_pipes; i++) {
+		if (usb_pipetype(pipes[i]) != PIPE_BULK)
+			return -EINVAL;
+		ep_index = usb_pipe_ep_index(pipes[i]);
+		if (virt_dev->eps[ep_index].ep_state & EP_HAS_STREAMS)
+			return -EBUSY;
+		num_streams = min(num_streams,
+				  xhci_get_endpoint_streams(udev, pipes[i]));
+	}
+	if (num_streams < 1)
+		return -ENOSYS;
+
+	/* The array holds the reserved stream 0 and is a power of two */
+	size = min_t(unsigned int, __roundup_pow_of_two(num_streams + 1),
+		     HCC_MAX_PSA(hcc_params));
+
+	xhci_inval_cache((uintptr_t)virt_dev->out_ctx->bytes,
+			 virt_dev->out_ctx->size);
+	for (i = 0; i < num_pipes; i++) {
+		ep_index = usb_pipe_ep_index(pipes[i]);
+		ep = &virt_dev->eps[ep_index];
+		xhci_alloc_stream_rings(ctrl, ep, size);
+		ep->ep_state |= EP_HAS_STREAMS;
+
+		xhci_endpoint_copy(ctrl, virt_dev->in_ctx, virt_dev->out_ctx,
+				   ep_index);
+		ep_ctx = xhci_get_ep_ctx(ctrl, virt_dev->in_ctx, ep_index);
+		ep_ctx->ep_info &= cpu_to_le32(~(EP_MAXPSTREAMS_MASK |
+						 EP_STATE_MASK));
+		ep_ctx->ep_info |= cpu_to_le32(EP_MAXPSTREAMS(ilog2(size) - 1) |
+					       EP_HAS_LSA);
+		ep_ctx->deq = cpu_to_le64(xhci_virt_to_bus(ctrl,
+							   ep->stream_ctx));
+		ep_flags |= 1 << (ep_index + 1);
+	}
+
+	ret = xhci_reconfigure_endpoints(udev, ep_flags);
+	if (ret) {
+		for (i = 0; i < num_pipes; i++) {
+			ep_index = usb_pipe_ep_index(pipes[i]);
+			xhci_free_stream_rings(&virt_dev->eps[ep_index]);
+		}
+		return ret;
+	}
+	debug("%d streams on %d endpoints\n", size - 1, num_pipes);
+
+	return size - 1;
+}
+
+/**
+ * Stops using streams on a set of bulk endpoints, going back to their
+ * normal transfer rings
+ *
+ * @param udev		pointer to the USB device structure
+ * @param pipes		pipes of the endpoints
+ * @param num_pipes	number of pipes
+ * Return: 0 if successful else error code on failure
+ */
+static int _xhci_free_streams(struct usb_device *udev, unsigned long *pipes,
+			      int num_pipes)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	struct xhci_virt_device *virt_dev = ctrl->devs[udev->slot_id];
+	struct xhci_virt_ep *ep;
+	struct xhci_ep_ctx *ep_ctx;
+	u32 ep_flags = 0;
+	int ep_index;
+	int i, ret;
+
+	xhci_inval_cache((uintptr_t)virt_dev->out_ctx->bytes,
+			 virt_dev->out_ctx->size);
+	for (i = 0; i < num_pipes; i++) {
+		ep_index = usb_pipe_ep_index(pipes[i]);
+		ep = &virt_dev->eps[ep_index];
+		if (!(ep->ep_state & EP_HAS_STREAMS))
+			continue;
+
+		xhci_endpoint_copy(ctrl, virt_dev->in_ctx, virt_dev->out_ctx,
+				   ep_index);
+		ep_ctx = xhci_get_ep_ctx(ctrl, virt_dev->in_ctx, ep_index);
+		ep_ctx->ep_info &= cpu_to_le32(~(EP_MAXPSTREAMS_MASK |
+						 EP_HAS_LSA | EP_STATE_MASK));
+		ep_ctx->deq = cpu_to_le64(xhci_virt_to_bus(ctrl,
+							   ep->ring->enqueue) |
+					  ep->ring->cycle_state);
+		ep_flags |= 1 << (ep_index + 1);
+	}
+	if (!ep_flags)
+		return 0;
+
+	ret = xhci_reconfigure_endpoints(udev, ep_flags);
+	for (i = 0; i < num_pipes; i++) {
+		ep_index = usb_pipe_ep_index(pipes[i]);
+		xhci_free_stream_rings(&virt_dev->eps[ep_index]);
+	}
+
+	return ret;
+}
+
 /**
  * Issue an Address Device command (which will issue a SetAddress request to
  * the device).
@@ -1288,6 +1471,28 @@ static int xhci_submit_bulk_msg(struct udevice *dev, struct usb_device *udev,
 	return _xhci_submit_bulk_msg(udev, pipe, buffer, length);
 }
 
+static int xhci_submit_bulk_queue(struct udevice *dev, struct usb_device *udev,
+				  struct usb_bulk_req *reqs, int count)
+{
+	debug("%s: dev='%s', udev=%p\n", __func__, dev->name, udev);
+	return xhci_bulk_tx_queue(udev, reqs, count);
+}
+
+static int xhci_alloc_streams(struct udevice *dev, struct usb_device *udev,
+			      unsigned long *pipes, int num_pipes,
+			      int num_streams)
+{
+	debug("%s: dev='%s', udev=%p\n", __func__, dev->name, udev);
+	return _xhci_alloc_streams(udev, pipes, num_pipes, num_streams);
+}
+
+static int xhci_free_streams(struct udevice *dev, struct usb_device *udev,
+			     unsigned long *pipes, int num_pipes)
+{
+	debug("%s: dev='%s', udev=%p\n", __func__, dev->name, udev);
+	return _xhci_free_streams(udev, pipes, num_pipes);
+}
+
 static int xhci_submit_int_msg(struct udevice *dev, struct usb_device *udev,
 			       unsigned long pipe, void *buffer, int length,
 			       int interval, bool nonblock)
@@ -1433,6 +1638,9 @@ int xhci_deregister(struct udevice *dev)
 struct dm_usb_ops xhci_usb_ops = {
 	.control = xhci_submit_control_msg,
 	.bulk = xhci_submit_bulk_msg,
+	.bulk_queue = xhci_submit_bulk_queue,
+	.alloc_streams = xhci_alloc_streams,
+	.free_streams = xhci_free_streams,
 	.interrupt = xhci_submit_int_msg,
 	.alloc_device = xhci_alloc_device,
 	.update_hub_device = xhci_update_hub_device,
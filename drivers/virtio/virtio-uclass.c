@@ -23,6 +23,7 @@
 #include <malloc.h>
 #include <virtio_types.h>
 #include <virtio.h>
+#include <virtio_ring.h>
 #include <dm/lists.h>
 #include <linux/bug.h>
 
@@ -335,10 +336,16 @@ static int virtio_uclass_child_pre_probe(struct udevice *vdev)
 		uc_priv->features = driver_features & device_features;
 	}
 
-	/* Transport features always preserved to pass to finalize_features */
+	/*
+	 * Transport features always preserved to pass to finalize_features.
+	 * The ring handles indirect descriptors and event indices for every
+	 * driver, so those are accepted whenever the device offers them.
+	 */
 	for (i = VIRTIO_TRANSPORT_F_START; i < VIRTIO_TRANSPORT_F_END; i++)
 		if ((device_features & (1ULL << i)) &&
-		    (i == VIRTIO_F_VERSION_1))
+		    (i == VIRTIO_F_VERSION_1 ||
+		     i == VIRTIO_RING_F_INDIRECT_DESC ||
+		     i == VIRTIO_RING_F_EVENT_IDX))
 			__virtio_set_bit(vdev->parent, i);
 
 	debug("(%s) final negotiated features supported %016llx\n",
@@ -7,52 +7,156 @@
 #include <common.h>
 #include <blk.h>
 #include <dm.h>
+#include <malloc.h>
 #include <part.h>
 #include <virtio_types.h>
 #include <virtio.h>
 #include <virtio_ring.h>
 #include "virtio_blk.h"
 
+/**
+ * struct virtio_blk_req - a request queued to the device
+ *
+ * @out_hdr:	Header of the request, read by the device
+ * @status:	Status of the request, written by the device
+ * @busy:	true if the request is queued to the device
+ */
+struct virtio_blk_req {
+	struct virtio_blk_outhdr out_hdr;
+	u8 status;
+	bool busy;
+};
+
+/**
+ * struct virtio_blk_priv - private data for the virtio block driver
+ *
+ * @vq:		Virtqueue used for all requests
+ * @reqs:	Requests, one for each entry in the virtqueue
+ * @num_reqs:	Number of entries in @reqs
+ * @inflight:	Number of requests queued to the device
+ * @sg:		Scatterlist used to build a request
+ * @sgs:	Pointers to each entry of @sg, as needed by virtqueue_add()
+ * @seg_size:	Largest data segment the device accepts
+ * @max_blks:	Largest number of blocks in each request
+ */
 struct virtio_blk_priv {
 	struct virtqueue *vq;
+	struct virtio_blk_req *reqs;
+	uint num_reqs;
+	uint inflight;
+	struct virtio_sg *sg;
+	struct virtio_sg **sgs;
+	u32 seg_size;
+	lbaint_t max_blks;
 };
 
-static ulong virtio_blk_do_req(struct udevice *dev, u64 sector,
-			       lbaint_t blkcnt, void *buffer, u32 type)
+static const u32 feature[] = {
+	VIRTIO_BLK_F_SIZE_MAX,
+	VIRTIO_BLK_F_SEG_MAX,
+};
+
+static int virtio_blk_queue_req(struct udevice *dev, u64 sector,
+				lbaint_t blkcnt, void *buffer, u32 type)
 {
 	struct virtio_blk_priv *priv = dev_get_priv(dev);
-	unsigned int num_out = 0, num_in = 0;
-	struct virtio_sg *sgs[3];
-	u8 status;
-	int ret;
+	struct virtio_blk_req *req = NULL;
+	ulong left = blkcnt * 512;
+	unsigned int num_out, n = 0;
+	int i, ret;
 
-	struct virtio_blk_outhdr out_hdr = {
-		.type = cpu_to_virtio32(dev, type),
-		.sector = cpu_to_virtio64(dev, sector),
-	};
-	struct virtio_sg hdr_sg = { &out_hdr, sizeof(out_hdr) };
-	struct virtio_sg data_sg = { buffer, blkcnt * 512 };
-	struct virtio_sg status_sg = { &status, sizeof(status) };
+	for (i = 0; i < priv->num_reqs; i++) {
+		if (!priv->reqs[i].busy) {
+			req = &priv->reqs[i];
+			break;
+		}
+	}
+	if (!req)
+		return -ENOSPC;
 
-	sgs[num_out++] = &hdr_sg;
+	req->out_hdr.type = cpu_to_virtio32(dev, type);
+	req->out_hdr.ioprio = 0;
+	req->out_hdr.sector = cpu_to_virtio64(dev, sector);
+	req->status = VIRTIO_BLK_S_IOERR;
 
-	if (type & VIRTIO_BLK_T_OUT)
-		sgs[num_out++] = &data_sg;
-	else
-		sgs[num_out + num_in++] = &data_sg;
+	priv->sg[n].addr = &req->out_hdr;
+	priv->sg[n++].length = sizeof(req->out_hdr);
+	while (left) {
+		ulong len = min_t(ulong, left, priv->seg_size);
 
-	sgs[num_out + num_in++] = &status_sg;
+		priv->sg[n].addr = buffer;
+		priv->sg[n++].length = len;
+		buffer += len;
+		left -= len;
+	}
+	priv->sg[n].addr = &req->status;
+	priv->sg[n++].length = sizeof(req->status);
+	for (i = 0; i < n; i++)
+		priv->sgs[i] = &priv->sg[i];
 
-	ret = virtqueue_add(priv->vq, sgs, num_out, num_in);
+	num_out = type & VIRTIO_BLK_T_OUT ? n - 1 : 1;
+	ret = virtqueue_add(priv->vq, priv->sgs, num_out, n - num_out);
 	if (ret)
 		return ret;
+	req->busy = true;
+	priv->inflight++;
+
+	return 0;
+}
 
-	virtqueue_kick(priv->vq);
+static int virtio_blk_wait_req(struct virtio_blk_priv *priv)
+{
+	struct virtio_blk_outhdr *hdr;
+	struct virtio_blk_req *req;
 
-	while (!virtqueue_get_buf(priv->vq, NULL))
+	while (!(hdr = virtqueue_get_buf(priv->vq, NULL)))
 		;
 
-	return status == VIRTIO_BLK_S_OK ? blkcnt : -EIO;
+	req = container_of(hdr, struct virtio_blk_req, out_hdr);
+	req->busy = false;
+	priv->inflight--;
+
+	return req->status == VIRTIO_BLK_S_OK ? 0 : -EIO;
+}
+
+static ulong virtio_blk_do_req(struct udevice *dev, u64 sector,
+			       lbaint_t blkcnt, void *buffer, u32 type)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	lbaint_t queued = 0;
+	bool failed = false;
+	int ret;
+
+	/*
+	 * Keep as many requests queued as the virtqueue has room for, with
+	 * one notification for each batch, and refill it as they complete.
+	 * After an error, wait for the requests already queued, since they
+	 * refer to the caller's buffer.
+	 */
+	do {
+		bool added = false;
+
+		while (!failed && queued < blkcnt) {
+			lbaint_t count = min(blkcnt - queued, priv->max_blks);
+
+			ret = virtio_blk_queue_req(dev, sector + queued, count,
+						   buffer + queued * 512, type);
+			if (ret == -ENOSPC && priv->inflight)
+				break;
+			if (ret) {
+				failed = true;
+				break;
+			}
+			queued += count;
+			added = true;
+		}
+		if (added)
+			virtqueue_kick(priv->vq);
+
+		if (priv->inflight && virtio_blk_wait_req(priv))
+			failed = true;
+	} while (priv->inflight || (!failed && queued < blkcnt));
+
+	return failed ? -EIO : blkcnt;
 }
 
 static ulong virtio_blk_read(struct udevice *dev, lbaint_t start,
@@ -98,7 +202,8 @@ static int virtio_blk_bind(struct udevice *dev)
 	desc->bdev = dev;
 
 	/* Indicate what driver features we support */
-	virtio_driver_features_init(uc_priv, NULL, 0, NULL, 0);
+	virtio_driver_features_init(uc_priv, feature, ARRAY_SIZE(feature),
+				    NULL, 0);
 
 	return 0;
 }
@@ -107,6 +212,9 @@ static int virtio_blk_probe(struct udevice *dev)
 {
 	struct virtio_blk_priv *priv = dev_get_priv(dev);
 	struct blk_desc *desc = dev_get_uclass_plat(dev);
+	u32 seg_max, size_max;
+	ulong max_bytes, max_segs;
+	uint num;
 	u64 cap;
 	int ret;
 
@@ -114,6 +222,39 @@ static int virtio_blk_probe(struct udevice *dev)
 	if (ret)
 		return ret;
 
+	/*
+	 * Each request takes a header and a status descriptor as well as its
+	 * data segments. Without indirect descriptors they must all fit in
+	 * the ring.
+	 */
+	num = virtqueue_get_vring_size(priv->vq);
+	if (virtio_cread_feature(dev, VIRTIO_BLK_F_SEG_MAX,
+				 struct virtio_blk_config, seg_max, &seg_max) ||
+	    !seg_max)
+		seg_max = 1;
+	if (!priv->vq->indirect && num > 2)
+		seg_max = min_t(u32, seg_max, num - 2);
+	if (virtio_cread_feature(dev, VIRTIO_BLK_F_SIZE_MAX,
+				 struct virtio_blk_config, size_max, &size_max) ||
+	    !size_max)
+		size_max = U32_MAX;
+
+	max_bytes = CONFIG_VIRTIO_BLK_MAX_REQ_SIZE;
+	if ((u64)seg_max * size_max < max_bytes)
+		max_bytes = seg_max * size_max;
+	priv->max_blks = max(max_bytes / 512, 1UL);
+	priv->seg_size = size_max;
+	max_segs = ((ulong)priv->max_blks * 512 - 1) / size_max + 1 + 2;
+	debug("%s: %u entries, %u segments of %u bytes, %lu blocks/request\n",
+	      dev->name, num, seg_max, size_max, (ulong)priv->max_blks);
+
+	priv->num_reqs = num;
+	priv->reqs = calloc(num, sizeof(*priv->reqs));
+	priv->sg = calloc(max_segs, sizeof(*priv->sg));
+	priv->sgs = calloc(max_segs, sizeof(*priv->sgs));
+	if (!priv->reqs || !priv->sg || !priv->sgs)
+		return -ENOMEM;
+
 	desc->blksz = 512;
 	desc->log2blksz = 9;
 	virtio_cread(dev, struct virtio_blk_config, capacity, &cap);
@@ -122,6 +263,19 @@ static int virtio_blk_probe(struct udevice *dev)
 	return 0;
 }
 
+static int virtio_blk_remove(struct udevice *dev)
+{
+	struct virtio_blk_priv *priv = dev_get_priv(dev);
+	int ret;
+
+	ret = virtio_reset(dev);
+	free(priv->reqs);
+	free(priv->sg);
+	free(priv->sgs);
+
+	return ret;
+}
+
 static const struct blk_ops virtio_blk_ops = {
 	.read	= virtio_blk_read,
 	.write	= virtio_blk_write,
@@ -133,7 +287,7 @@ U_BOOT_DRIVER(virtio_blk) = {
 	.ops	= &virtio_blk_ops,
 	.bind	= virtio_blk_bind,
 	.probe	= virtio_blk_probe,
-	.remove	= virtio_reset,
+	.remove	= virtio_blk_remove,
 	.priv_auto	= sizeof(struct virtio_blk_priv),
 	.flags	= DM_FLAG_ACTIVE_DMA,
 };
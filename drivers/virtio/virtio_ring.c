@@ -36,10 +36,37 @@ static unsigned int virtqueue_attach_desc(struct virtqueue *vq, unsigned int i,
 	return desc_shadow->next;
 }
 
+static struct vring_desc *virtqueue_alloc_indirect(struct virtqueue *vq,
+						   struct virtio_sg *sgs[],
+						   unsigned int out_sgs,
+						   unsigned int total_sg)
+{
+	struct vring_desc *indir;
+	unsigned int n;
+
+	indir = malloc(total_sg * sizeof(struct vring_desc));
+	if (!indir)
+		return NULL;
+
+	for (n = 0; n < total_sg; n++) {
+		u16 flags = n < total_sg - 1 ? VRING_DESC_F_NEXT : 0;
+
+		if (n >= out_sgs)
+			flags |= VRING_DESC_F_WRITE;
+		indir[n].addr = cpu_to_virtio64(vq->vdev,
+						(u64)(uintptr_t)sgs[n]->addr);
+		indir[n].len = cpu_to_virtio32(vq->vdev, sgs[n]->length);
+		indir[n].flags = cpu_to_virtio16(vq->vdev, flags);
+		indir[n].next = cpu_to_virtio16(vq->vdev, n + 1);
+	}
+
+	return indir;
+}
+
 int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 		  unsigned int out_sgs, unsigned int in_sgs)
 {
-	struct vring_desc *desc;
+	struct vring_desc *desc, *indir = NULL;
 	unsigned int descs_used = out_sgs + in_sgs;
 	unsigned int i, n, avail, uninitialized_var(prev);
 	int head;
@@ -51,9 +78,14 @@ int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 	desc = vq->vring.desc;
 	i = head;
 
-	if (vq->num_free < descs_used) {
+	/* Fall back to direct descriptors if there is no memory */
+	if (vq->indirect && descs_used > 1)
+		indir = virtqueue_alloc_indirect(vq, sgs, out_sgs, descs_used);
+
+	if (vq->num_free < (indir ? 1 : descs_used)) {
 		debug("Can't add buf len %i - avail = %i\n",
 		      descs_used, vq->num_free);
+		free(indir);
 		/*
 		 * FIXME: for historical reasons, we force a notify here if
 		 * there are outgoing parts to the buffer.  Presumably the
@@ -64,17 +96,29 @@ int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
 		return -ENOSPC;
 	}
 
-	for (n = 0; n < descs_used; n++) {
-		u16 flags = VRING_DESC_F_NEXT;
+	if (indir) {
+		struct virtio_sg indir_sg = {
+			indir, descs_used * sizeof(struct vring_desc)
+		};
 
-		if (n >= out_sgs)
-			flags |= VRING_DESC_F_WRITE;
-		prev = i;
-		i = virtqueue_attach_desc(vq, i, sgs[n], flags);
+		i = virtqueue_attach_desc(vq, i, &indir_sg,
+					  VRING_DESC_F_INDIRECT);
+		vq->vring_desc_shadow[head].indir = indir;
+		descs_used = 1;
+	} else {
+		for (n = 0; n < descs_used; n++) {
+			u16 flags = VRING_DESC_F_NEXT;
+
+			if (n >= out_sgs)
+				flags |= VRING_DESC_F_WRITE;
+			prev = i;
+			i = virtqueue_attach_desc(vq, i, sgs[n], flags);
+		}
+		/* Last one doesn't continue */
+		vq->vring_desc_shadow[prev].flags &= ~VRING_DESC_F_NEXT;
+		desc[prev].flags = cpu_to_virtio16(vq->vdev,
+						   vq->vring_desc_shadow[prev].flags);
 	}
-	/* Last one doesn't continue */
-	vq->vring_desc_shadow[prev].flags &= ~VRING_DESC_F_NEXT;
-	desc[prev].flags = cpu_to_virtio16(vq->vdev, vq->vring_desc_shadow[prev].flags);
 
 	/* We're using some buffers from the free list. */
 	vq->num_free -= descs_used;
@@ -149,6 +193,8 @@ static void detach_buf(struct virtqueue *vq, unsigned int head)
 
 	/* Unmark the descriptor as the head of a chain. */
 	vq->vring_desc_shadow[head].chain_head = false;
+	free(vq->vring_desc_shadow[head].indir);
+	vq->vring_desc_shadow[head].indir = NULL;
 
 	/* Put back on free list: unmap first-level descriptors and find end */
 	i = head;
@@ -173,8 +219,10 @@ static inline bool more_used(const struct virtqueue *vq)
 
 void *virtqueue_get_buf(struct virtqueue *vq, unsigned int *len)
 {
+	struct vring_desc *indir;
 	unsigned int i;
 	u16 last_used;
+	void *buf;
 
 	if (!more_used(vq)) {
 		debug("(%s.%d): No more buffers in queue\n",
@@ -206,6 +254,13 @@ void *virtqueue_get_buf(struct virtqueue *vq, unsigned int *len)
 		return NULL;
 	}
 
+	/* Hand back the first buffer, as given to virtqueue_add() */
+	indir = vq->vring_desc_shadow[i].indir;
+	if (indir)
+		buf = (void *)(uintptr_t)virtio64_to_cpu(vq->vdev, indir[0].addr);
+	else
+		buf = (void *)(uintptr_t)vq->vring_desc_shadow[i].addr;
+
 	detach_buf(vq, i);
 	vq->last_used_idx++;
 	/*
@@ -217,7 +272,7 @@ void *virtqueue_get_buf(struct virtqueue *vq, unsigned int *len)
 		virtio_store_mb(&vring_used_event(&vq->vring),
 				cpu_to_virtio16(vq->vdev, vq->last_used_idx));
 
-	return (void *)(uintptr_t)vq->vring_desc_shadow[i].addr;
+	return buf;
 }
 
 static struct virtqueue *__vring_new_virtqueue(unsigned int index,
@@ -252,6 +307,7 @@ static struct virtqueue *__vring_new_virtqueue(unsigned int index,
 	list_add_tail(&vq->list, &uc_priv->vqs);
 
 	vq->event = virtio_has_feature(vdev, VIRTIO_RING_F_EVENT_IDX);
+	vq->indirect = virtio_has_feature(vdev, VIRTIO_RING_F_INDIRECT_DESC);
 
 	/* Tell other side not to bother us */
 	vq->avail_flags_shadow |= VRING_AVAIL_F_NO_INTERRUPT;
@@ -314,6 +370,10 @@ struct virtqueue *vring_create_virtqueue(unsigned int index, unsigned int num,
 
 void vring_del_virtqueue(struct virtqueue *vq)
 {
+	unsigned int i;
+
+	for (i = 0; i < vq->vring.num; i++)
+		free(vq->vring_desc_shadow[i].indir);
 	free(vq->vring.desc);
 	free(vq->vring_desc_shadow);
 	list_del(&vq->list);
@@ -360,6 +420,7 @@ void virtqueue_dump(struct virtqueue *vq)
 	       vq->free_head, vq->num_added, vq->num_free);
 	printf("\tlast_used_idx %u, avail_flags_shadow %u, avail_idx_shadow %u\n",
 	       vq->last_used_idx, vq->avail_flags_shadow, vq->avail_idx_shadow);
+	printf("\tevent %d, indirect %d\n", vq->event, vq->indirect);
 
 	printf("Shadow descriptor dump:\n");
 	for (i = 0; i < vq->vring.num; i++) {
@@ -367,6 +428,8 @@ void virtqueue_dump(struct virtqueue *vq)
 
 		printf("\tdesc_shadow[%u] = { 0x%llx, len %u, flags %u, next %u }\n",
 		       i, desc->addr, desc->len, desc->flags, desc->next);
+		if (desc->indir)
+			printf("\t\tindirect table %p\n", desc->indir);
 	}
 
 	printf("Avail ring dump:\n");
@@ -7,13 +7,21 @@
 
 #include <common.h>
 #include <dm.h>
+#include <malloc.h>
 #include <virtio_types.h>
 #include <virtio.h>
 #include <virtio_ring.h>
+#include <asm/test.h>
 #include <linux/bug.h>
 #include <linux/compat.h>
 #include <linux/err.h>
 #include <linux/io.h>
+#include "virtio_blk.h"
+
+/* Size and limits of the emulated block device */
+#define SANDBOX_BLK_SECTORS	64
+#define SANDBOX_BLK_SIZE_MAX	1024
+#define SANDBOX_BLK_SEG_MAX	2
 
 struct virtio_sandbox_priv {
 	u8 id;
@@ -23,6 +31,14 @@ struct virtio_sandbox_priv {
 	ulong queue_desc;
 	ulong queue_available;
 	ulong queue_used;
+	uint notifies;
+	/* Emulated block device */
+	struct virtio_blk_config blk_config;
+	u8 *blk_data;		/* contents, SANDBOX_BLK_SECTORS sectors */
+	u16 blk_avail;		/* next entry to handle in the avail ring */
+	uint blk_reqs;		/* requests handled */
+	uint blk_errs;		/* requests which broke the device limits */
+	long blk_fail;		/* sector which fails to transfer, -1 for none */
 };
 
 static int virtio_sandbox_get_config(struct udevice *udev, unsigned int offset,
@@ -151,9 +167,140 @@ static int virtio_sandbox_find_vqs(struct udevice *udev, unsigned int nvqs,
 
 static int virtio_sandbox_notify(struct udevice *udev, struct virtqueue *vq)
 {
+	struct virtio_sandbox_priv *priv = dev_get_priv(udev);
+
+	priv->notifies++;
+
+	return 0;
+}
+
+uint sandbox_virtio_get_notifies(struct udevice *udev)
+{
+	struct virtio_sandbox_priv *priv = dev_get_priv(udev);
+
+	return priv->notifies;
+}
+
+static int virtio_sandbox_blk_get_config(struct udevice *udev,
+					 unsigned int offset, void *buf,
+					 unsigned int len)
+{
+	struct virtio_sandbox_priv *priv = dev_get_priv(udev);
+
+	if (offset + len > sizeof(priv->blk_config))
+		return -EINVAL;
+	memcpy(buf, (void *)&priv->blk_config + offset, len);
+
+	return 0;
+}
+
+/*
+ * Carry out a block request, which is a header, data segments and a status
+ * byte, each in its own descriptor. Returns the number of bytes written to
+ * the driver's buffers.
+ */
+static uint virtio_sandbox_blk_req(struct virtio_sandbox_priv *priv,
+				  struct virtqueue *vq, uint head)
+{
+	struct udevice *vdev = vq->vdev;
+	struct vring_desc *desc = vq->vring.desc;
+	struct virtio_blk_outhdr *hdr;
+	uint i = head, segs = 0, done = 0;
+	u8 status = VIRTIO_BLK_S_OK;
+	u8 *data;
+	void *buf;
+	u64 sector;
+	u32 len;
+	bool out;
+
+	if (virtio16_to_cpu(vdev, desc[head].flags) & VRING_DESC_F_INDIRECT) {
+		desc = (void *)(uintptr_t)virtio64_to_cpu(vdev,
+							  desc[head].addr);
+		i = 0;
+	}
+
+	priv->blk_reqs++;
+	hdr = (void *)(uintptr_t)virtio64_to_cpu(vdev, desc[i].addr);
+	out = virtio32_to_cpu(vdev, hdr->type) & VIRTIO_BLK_T_OUT;
+	sector = virtio64_to_cpu(vdev, hdr->sector);
+
+	/* Each descriptor after the header is data, except the last */
+	for (i = virtio16_to_cpu(vdev, desc[i].next);
+	     virtio16_to_cpu(vdev, desc[i].flags) & VRING_DESC_F_NEXT;
+	     i = virtio16_to_cpu(vdev, desc[i].next)) {
+		buf = (void *)(uintptr_t)virtio64_to_cpu(vdev, desc[i].addr);
+		len = virtio32_to_cpu(vdev, desc[i].len);
+		data = priv->blk_data + sector * 512;
+
+		if (++segs > SANDBOX_BLK_SEG_MAX || len > SANDBOX_BLK_SIZE_MAX ||
+		    len % 512 || sector + len / 512 > SANDBOX_BLK_SECTORS) {
+			priv->blk_errs++;
+			status = VIRTIO_BLK_S_IOERR;
+			break;
+		}
+		if (priv->blk_fail >= 0 && priv->blk_fail >= sector &&
+		    priv->blk_fail < sector + len / 512)
+			status = VIRTIO_BLK_S_IOERR;
+		if (out) {
+			memcpy(data, buf, len);
+		} else {
+			memcpy(buf, data, len);
+			done += len;
+		}
+		sector += len / 512;
+	}
+	/* The status goes in the last descriptor of the chain */
+	while (virtio16_to_cpu(vdev, desc[i].flags) & VRING_DESC_F_NEXT)
+		i = virtio16_to_cpu(vdev, desc[i].next);
+	*(u8 *)(uintptr_t)virtio64_to_cpu(vdev, desc[i].addr) = status;
+
+	return done + 1;
+}
+
+/* The device handles each request as soon as it is told about it */
+static int virtio_sandbox_blk_notify(struct udevice *udev,
+				     struct virtqueue *vq)
+{
+	struct virtio_sandbox_priv *priv = dev_get_priv(udev);
+	struct udevice *vdev = vq->vdev;
+	struct vring *vr = &vq->vring;
+	u16 used;
+
+	priv->notifies++;
+	used = virtio16_to_cpu(vdev, vr->used->idx);
+	while (priv->blk_avail != virtio16_to_cpu(vdev, vr->avail->idx)) {
+		struct vring_used_elem *elem = &vr->used->ring[used % vr->num];
+		uint head;
+
+		head = virtio16_to_cpu(vdev,
+				       vr->avail->ring[priv->blk_avail % vr->num]);
+		elem->id = cpu_to_virtio32(vdev, head);
+		elem->len = cpu_to_virtio32(vdev,
+					    virtio_sandbox_blk_req(priv, vq, head));
+		priv->blk_avail++;
+		used++;
+	}
+	vr->used->idx = cpu_to_virtio16(vdev, used);
+
 	return 0;
 }
 
+void sandbox_virtio_blk_set_fail(struct udevice *udev, long sector)
+{
+	struct virtio_sandbox_priv *priv = dev_get_priv(udev);
+
+	priv->blk_fail = sector;
+}
+
+uint sandbox_virtio_blk_get_reqs(struct udevice *udev, uint *errsp)
+{
+	struct virtio_sandbox_priv *priv = dev_get_priv(udev);
+
+	*errsp = priv->blk_errs;
+
+	return priv->blk_reqs;
+}
+
 static int virtio_sandbox_probe(struct udevice *udev)
 {
 	struct virtio_sandbox_priv *priv = dev_get_priv(udev);
@@ -167,6 +314,36 @@ static int virtio_sandbox_probe(struct udevice *udev)
 	return 0;
 }
 
+static int virtio_sandbox_blk_probe(struct udevice *udev)
+{
+	struct virtio_sandbox_priv *priv = dev_get_priv(udev);
+	struct virtio_dev_priv *uc_priv = dev_get_uclass_priv(udev);
+
+	priv->device_features = BIT_ULL(VIRTIO_F_VERSION_1) |
+		BIT_ULL(VIRTIO_RING_F_INDIRECT_DESC) |
+		BIT_ULL(VIRTIO_BLK_F_SIZE_MAX) | BIT_ULL(VIRTIO_BLK_F_SEG_MAX);
+	priv->blk_config.capacity = cpu_to_le64(SANDBOX_BLK_SECTORS);
+	priv->blk_config.size_max = cpu_to_le32(SANDBOX_BLK_SIZE_MAX);
+	priv->blk_config.seg_max = cpu_to_le32(SANDBOX_BLK_SEG_MAX);
+	priv->blk_fail = -1;
+	priv->blk_data = calloc(SANDBOX_BLK_SECTORS, 512);
+	if (!priv->blk_data)
+		return -ENOMEM;
+	uc_priv->device = VIRTIO_ID_BLOCK;
+	uc_priv->vendor = ('u' << 24) | ('b' << 16) | ('o' << 8) | 't';
+
+	return 0;
+}
+
+static int virtio_sandbox_blk_remove(struct udevice *udev)
+{
+	struct virtio_sandbox_priv *priv = dev_get_priv(udev);
+
+	free(priv->blk_data);
+
+	return 0;
+}
+
 /* check virtio device driver's remove routine was called to reset the device */
 static int virtio_sandbox_child_post_remove(struct udevice *vdev)
 {
@@ -233,3 +410,27 @@ U_BOOT_DRIVER(virtio_sandbox2) = {
 	.probe	= virtio_sandbox_probe,
 	.priv_auto	= sizeof(struct virtio_sandbox_priv),
 };
+
+/* emulates a block device; bound by tests which need one */
+static const struct dm_virtio_ops virtio_sandbox_blk_ops = {
+	.get_config	= virtio_sandbox_blk_get_config,
+	.set_config	= virtio_sandbox_set_config,
+	.get_status	= virtio_sandbox_get_status,
+	.set_status	= virtio_sandbox_set_status,
+	.reset		= virtio_sandbox_reset,
+	.get_features	= virtio_sandbox_get_features,
+	.set_features	= virtio_sandbox_set_features,
+	.find_vqs	= virtio_sandbox_find_vqs,
+	.del_vqs	= virtio_sandbox_del_vqs,
+	.notify		= virtio_sandbox_blk_notify,
+};
+
+U_BOOT_DRIVER(virtio_sandbox_blk) = {
+	.name	= "virtio-sandbox-blk",
+	.id	= UCLASS_VIRTIO,
+	.ops	= &virtio_sandbox_blk_ops,
+	.probe	= virtio_sandbox_blk_probe,
+	.remove	= virtio_sandbox_blk_remove,
+	.child_post_remove = virtio_sandbox_child_post_remove,
+	.priv_auto	= sizeof(struct virtio_sandbox_priv),
+};
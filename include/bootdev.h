@@ -63,6 +63,20 @@ struct bootdev_ops {
 	 */
 	int (*get_bootflow)(struct udevice *dev, struct bootflow_iter *iter,
 			    struct bootflow *bflow);
+
+	/**
+	 * start() - start getting the media ready, without waiting for it
+	 *
+	 * This is optional. It is used when scanning several bootdevs, so
+	 * that slow media (e.g. a card which takes a while to power up) get
+	 * ready while others are being looked at. The device is probed
+	 * before this is called. Whatever is left to do must be done by a
+	 * later get_bootflow()
+	 *
+	 * @dev:	Bootflow device to start
+	 * Return: 0 if OK, -ve on error
+	 */
+	int (*start)(struct udevice *dev);
 };
 
 #define bootdev_get_ops(dev)  ((struct bootdev_ops *)(dev)->driver->ops)
@@ -80,6 +94,15 @@ struct bootdev_ops {
 int bootdev_get_bootflow(struct udevice *dev, struct bootflow_iter *iter,
 			 struct bootflow *bflow);
 
+/**
+ * bootdev_start() - start getting a bootdev's media ready
+ *
+ * @dev:	Bootflow device to start, which must be probed
+ * Return: 0 if OK, -ENOSYS if the bootdev has nothing to start, other -ve
+ *	value on error
+ */
+int bootdev_start(struct udevice *dev);
+
 /**
  * bootdev_bind() - Bind a new named bootdev device
  *
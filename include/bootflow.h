@@ -78,6 +78,8 @@ struct bootflow {
  * @BOOTFLOWF_ALL: Return bootflows with errors as well
  * @BOOTFLOWF_SINGLE_DEV: Just scan one bootmeth
  * @BOOTFLOWF_SKIP_GLOBAL: Don't scan global bootmeths
+ * @BOOTFLOWF_PARALLEL: Start up the media of all bootdevs before scanning the
+ *	first one, so that they get ready together
  */
 enum bootflow_flags_t {
 	BOOTFLOWF_FIXED		= 1 << 0,
@@ -85,6 +87,7 @@ enum bootflow_flags_t {
 	BOOTFLOWF_ALL		= 1 << 2,
 	BOOTFLOWF_SINGLE_DEV	= 1 << 3,
 	BOOTFLOWF_SKIP_GLOBAL	= 1 << 4,
+	BOOTFLOWF_PARALLEL	= 1 << 5,
 };
 
 /**
@@ -271,6 +274,42 @@ int bootflow_boot(struct bootflow *bflow);
  */
 int bootflow_run_boot(struct bootflow_iter *iter, struct bootflow *bflow);
 
+/**
+ * bootflow_cache_find() - Find the bootflow booted last time
+ *
+ * This reads the bootflow recorded by bootflow_cache_update() and checks
+ * that its file is unchanged. The bootdev and bootmeth must also be ones
+ * that a scan would use.
+ *
+ * @bflow: Returns the bootflow, in state BOOTFLOWST_READY, if found
+ * Return: 0 if OK, -ENOENT if there is no record, -ESTALE if the bootflow
+ *	is no longer there or has changed, other -ve on other error
+ */
+int bootflow_cache_find(struct bootflow *bflow);
+
+/**
+ * bootflow_cache_update() - Record a bootflow which is about to be booted
+ *
+ * The record is kept in the environment, which is saved if
+ * CONFIG_BOOTSTD_CACHE_SAVEENV is enabled and the record has changed
+ *
+ * @bflow: Bootflow to record, which must be loaded
+ * Return: 0 if OK, -EINVAL if the bootflow cannot be recorded, other -ve on
+ *	other error
+ */
+int bootflow_cache_update(const struct bootflow *bflow);
+
+/**
+ * bootflow_cache_clear() - Forget the bootflow booted last time
+ *
+ * This is used when the recorded bootflow fails to boot, so that the next
+ * boot scans for bootflows again. The environment is saved as for
+ * bootflow_cache_update()
+ *
+ * Return: 0 if OK, -ve on error
+ */
+int bootflow_cache_clear(void);
+
 /**
  * bootflow_state_get_name() - Get the name of a bootflow state
  *
@@ -209,6 +209,10 @@ enum bootstage_id {
 	BOOTSTAGE_ID_ACCUM_FSP_M,
 	BOOTSTAGE_ID_ACCUM_FSP_S,
 	BOOTSTAGE_ID_ACCUM_MMAP_SPI,
+	BOOTSTAGE_ID_ACCUM_NET_ARP,
+	BOOTSTAGE_ID_ACCUM_NET_DHCP,
+	BOOTSTAGE_ID_ACCUM_NET_TFTP,
+	BOOTSTAGE_ID_ACCUM_NET_HTTP,
 
 	/* a few spare for the user, from here */
 	BOOTSTAGE_ID_USER,
@@ -6,9 +6,24 @@
 #define	_NAND_SPL_H_
 
 #define SPL_EXPORT	(0x00000001)
+#define SPL_PREPARE	(0x00000002)
 
 #define SPL_EXPORT_FDT		(0x00000001)
 #define SPL_EXPORT_ATAGS	(0x00000002)
 #define SPL_EXPORT_LAST		SPL_EXPORT_ATAGS
 
+/**
+ * board_falcon_args_write() - Save the devicetree for a Falcon-mode boot
+ *
+ * This is called by 'spl prepare' once the devicetree has been fixed up and
+ * copied to CONFIG_SYS_SPL_ARGS_ADDR. The board writes it to wherever its SPL
+ * loads it from. The default implementation returns -ENOSYS, leaving the user
+ * to write it.
+ *
+ * @buf:	Devicetree
+ * @size:	Size of the devicetree in bytes
+ * Return: 0 if OK, -ENOSYS if not supported, other -ve on error
+ */
+int board_falcon_args_write(const void *buf, ulong size);
+
 #endif /* _NAND_SPL_H_ */
@@ -32,6 +32,9 @@
 // sram buffer address that save the DDR software training result
 #define DDR_TRAINING_INFO_BUFF	(0xC0800000)
 #define DDR_TRAINING_INFO_SAVE_ADDR	(0)
+// offset in the spinor 'private' partition of the mmc card-state cache,
+// in its own erase block after the ddr training info
+#define MMC_CACHE_SAVE_ADDR	(0x10000)
 // magic string: "DDRT"
 #define DDR_TRAINING_INFO_MAGIC	(0x54524444)
 // ddr training software version: xx.xx.xxxx
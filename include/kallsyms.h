@@ -0,0 +1,34 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Builtin symbol table, enabled by CONFIG_KALLSYMS
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#ifndef __KALLSYMS_H
+#define __KALLSYMS_H
+
+/**
+ * symbol_lookup() - find the symbol containing an address
+ *
+ * Addresses are link-time addresses, i.e. before relocation.
+ *
+ * @addr:	Address to look up
+ * @caddr:	Returns the start address of the symbol, or 0 if none
+ * Return: symbol name, or NULL if @addr is before the first symbol
+ */
+const char *symbol_lookup(unsigned long addr, unsigned long *caddr);
+
+/**
+ * symbol_next() - step through the symbol table in address order
+ *
+ * @pos:	NULL to start, else the value returned by the previous call
+ * @addr:	Returns the start address of the symbol
+ * @name:	Returns the symbol name
+ * Return: position to pass to the next call, or NULL if there are no more
+ * symbols (in which case @addr and @name are not updated)
+ */
+const char *symbol_next(const char *pos, unsigned long *addr,
+			const char **name);
+
+#endif
@@ -9,6 +9,7 @@
 #include <linux/delay.h>
 #include <linux/errno.h>
 #include <linux/io.h>
+#include <sched.h>
 #include <time.h>
 
 /**
@@ -39,6 +40,8 @@
 		} \
 		if (sleep_us) \
 			udelay(sleep_us); \
+		else \
+			sched_yield(); \
 	} \
 	(cond) ? 0 : -ETIMEDOUT; \
 })
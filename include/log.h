@@ -13,6 +13,7 @@
 #include <linker_lists.h>
 #include <dm/uclass-id.h>
 #include <linux/bitops.h>
+#include <linux/errno.h>
 #include <linux/list.h>
 
 struct cmd_tbl;
@@ -413,6 +414,8 @@ enum log_device_flags {
  *
  * @name: Name of driver
  * @emit: Method to call to emit a log record via this device
+ * @emit_fmt: Method to call to emit an unformatted log record (optional)
+ * @probe: Method to call when the log device is set up (optional)
  * @flags: Initial value for flags (use LOGDF_ENABLE to enable on start-up)
  */
 struct log_driver {
@@ -425,6 +428,27 @@ struct log_driver {
 	 * for processing. The filter is checked before calling this function.
 	 */
 	int (*emit)(struct log_device *ldev, struct log_rec *rec);
+
+	/**
+	 * @emit_fmt: emit a log record without formatting it
+	 *
+	 * If provided, this is called instead of @emit. The record's @msg is
+	 * not set; the driver receives the format string and arguments and
+	 * may store them for formatting later. This avoids the cost of
+	 * vsnprintf() for records which no other driver wants. The filter is
+	 * checked before calling this function.
+	 */
+	int (*emit_fmt)(struct log_device *ldev, struct log_rec *rec,
+			const char *fmt, va_list args);
+
+	/**
+	 * @probe: set up a log device
+	 *
+	 * Called from log_init() once all devices are created, e.g. to add
+	 * default filters or allocate memory. Errors are not fatal: the device
+	 * is disabled instead.
+	 */
+	int (*probe)(struct log_device *ldev);
 	unsigned short flags;
 };
 
@@ -440,6 +464,7 @@ struct log_driver {
  *	decrements
  * @flags: Flags for this filter (enum log_device_flags)
  * @drv: Pointer to driver for this device
+ * @priv: Private data for the driver, set up by its probe() method
  * @filter_head: List of filters for this device
  * @sibling_node: Next device in the list of all devices
  */
@@ -447,6 +472,7 @@ struct log_device {
 	unsigned short next_filter_num;
 	unsigned short flags;
 	struct log_driver *drv;
+	void *priv;
 	struct list_head filter_head;
 	struct list_head sibling_node;
 };
@@ -665,6 +691,59 @@ static inline int log_init(void)
 }
 #endif
 
+#if CONFIG_IS_ENABLED(LOG_RING)
+/**
+ * log_ring_dump() - Format and print all records held in the log ring
+ *
+ * Return: 0 if OK, -ENOENT if the ring is not set up
+ */
+int log_ring_dump(void);
+
+/**
+ * log_ring_stats() - Print per-category record counts and rates
+ *
+ * Return: 0 if OK, -ENOENT if the ring is not set up
+ */
+int log_ring_stats(void);
+
+/**
+ * log_ring_clear() - Discard all records and statistics in the log ring
+ */
+void log_ring_clear(void);
+
+/**
+ * log_ring_fdt_fixup() - Hand the log ring over to the OS
+ *
+ * Formats the log ring into a text buffer and adds a /reserved-memory node
+ * with compatible "u-boot,log" covering it, so that the OS can read the
+ * U-Boot log. The text buffer is allocated on the first call and reused by
+ * later ones.
+ *
+ * @blob: Device tree to update
+ * Return: 0 if OK (or nothing to do), -ve on error
+ */
+int log_ring_fdt_fixup(void *blob);
+#else
+static inline int log_ring_dump(void)
+{
+	return -ENOSYS;
+}
+
+static inline int log_ring_stats(void)
+{
+	return -ENOSYS;
+}
+
+static inline void log_ring_clear(void)
+{
+}
+
+static inline int log_ring_fdt_fixup(void *blob)
+{
+	return 0;
+}
+#endif
+
 /**
  * log_get_default_format() - get default log format
  *
@@ -987,6 +987,212 @@ extern ulong mem_malloc_brk;
 
 void mem_malloc_init(ulong start, ulong size);
 
+/**
+ * struct malloc_heap_info - summary of the dlmalloc heap
+ *
+ * @start:	Start address of the heap
+ * @size:	Size of the heap in bytes (not including the size-class pools)
+ * @used:	Bytes currently allocated, including chunk overhead
+ * @free:	Bytes currently free, including space not yet claimed by sbrk()
+ * @largest_free: Largest block which can be allocated without growing the heap
+ *		past its end
+ * @peak:	Highest amount of the heap ever claimed by sbrk()
+ * @free_chunks: Number of free chunks in the bins
+ */
+struct malloc_heap_info {
+	ulong start;
+	ulong size;
+	ulong used;
+	ulong free;
+	ulong largest_free;
+	ulong peak;
+	uint free_chunks;
+};
+
+/**
+ * malloc_heap_info() - Obtain a summary of the dlmalloc heap
+ *
+ * This walks the free bins so takes time proportional to the number of free
+ * chunks. It is intended for diagnostics, not for use on a hot path.
+ *
+ * @info: Returns the heap information
+ */
+void malloc_heap_info(struct malloc_heap_info *info);
+
+/* Maximum number of size classes across both size-class pools */
+#define MALLOC_POOL_MAX_CLASSES	20
+
+/* Largest request served by the small-object pool */
+#define MALLOC_POOL_MAX_SMALL	512
+
+/**
+ * struct malloc_pool_class_stats - statistics for one size class
+ *
+ * @size:	Object size in bytes
+ * @dma:	true if this class belongs to the DMA-aligned pool
+ * @pages:	Number of pages assigned to this class
+ * @in_use:	Number of objects currently allocated
+ * @peak:	Highest value of @in_use
+ * @allocs:	Total number of allocations from this class
+ */
+struct malloc_pool_class_stats {
+	uint size;
+	bool dma;
+	uint pages;
+	uint in_use;
+	uint peak;
+	ulong allocs;
+};
+
+/**
+ * struct malloc_pool_stats - statistics for the size-class pools
+ *
+ * @start:	Start address of the pool region
+ * @size:	Size of the pool region in bytes
+ * @enabled:	true if new allocations are served from the pools
+ * @page_size:	Size of each pool page in bytes
+ * @num_pages:	Total number of pages in the region
+ * @used_pages:	Number of pages assigned to a size class
+ * @in_use:	Bytes currently allocated from the pools
+ * @fallbacks:	Number of requests which fitted a size class but were passed
+ *		to dlmalloc because no page was available
+ * @num_classes: Number of entries in @cls
+ * @cls:	Per-class statistics, small-object classes first
+ */
+struct malloc_pool_stats {
+	ulong start;
+	ulong size;
+	bool enabled;
+	uint page_size;
+	uint num_pages;
+	uint used_pages;
+	ulong in_use;
+	ulong fallbacks;
+	uint num_classes;
+	struct malloc_pool_class_stats cls[MALLOC_POOL_MAX_CLASSES];
+};
+
+/**
+ * malloc_pool_get_stats() - Get statistics for the pools
+ *
+ * @stats: Returns the statistics
+ */
+void malloc_pool_get_stats(struct malloc_pool_stats *stats);
+
+#if CONFIG_IS_ENABLED(SYS_MALLOC_POOL)
+/**
+ * malloc_pool_init() - Set up the size-class pools
+ *
+ * This is called by mem_malloc_init() with a region carved from the top of
+ * the malloc() area.
+ *
+ * @start: Start address of the region
+ * @size: Size of the region in bytes
+ */
+void malloc_pool_init(ulong start, ulong size);
+
+/**
+ * malloc_pool_alloc() - Allocate a small object from its size class
+ *
+ * @bytes: Number of bytes required
+ * Return: pointer to the object, or NULL if @bytes is too large for the pool,
+ *	the pool is disabled or it has no space left
+ */
+void *malloc_pool_alloc(size_t bytes);
+
+/**
+ * malloc_pool_memalign() - Allocate from the DMA-aligned pool
+ *
+ * Objects in this pool are a power of two in size, at least ARCH_DMA_MINALIGN
+ * bytes, and aligned to their size. They never share a cache line with
+ * another object, so can be passed to cache maintenance functions directly.
+ *
+ * @alignment: Alignment required in bytes
+ * @bytes: Number of bytes required
+ * Return: pointer to the object, or NULL if the request does not fit in a
+ *	page, the pool is disabled or it has no space left
+ */
+void *malloc_pool_memalign(size_t alignment, size_t bytes);
+
+/**
+ * malloc_pool_owns() - Check whether a pointer was allocated from the pools
+ *
+ * @ptr: Pointer to check
+ * Return: true if @ptr lies within the pool region
+ */
+bool malloc_pool_owns(const void *ptr);
+
+/**
+ * malloc_pool_free() - Free an object if it belongs to the pools
+ *
+ * @ptr: Pointer to free
+ * Return: true if @ptr was freed, false if it is not a pool object
+ */
+bool malloc_pool_free(void *ptr);
+
+/**
+ * malloc_pool_usable_size() - Get the size of a pool object
+ *
+ * @ptr: Pointer to an object allocated from the pools
+ * Return: size of the object's class in bytes, or 0 if not a pool object
+ */
+size_t malloc_pool_usable_size(const void *ptr);
+
+/**
+ * malloc_pool_in_use() - Get the number of bytes allocated from the pools
+ *
+ * Return: bytes in use, counting each object at its class size
+ */
+ulong malloc_pool_in_use(void);
+
+/**
+ * malloc_pool_set_enabled() - Enable or disable allocation from the pools
+ *
+ * Objects which are already allocated can still be freed while the pools are
+ * disabled.
+ *
+ * @enable: true to serve new allocations from the pools
+ * Return: previous setting
+ */
+bool malloc_pool_set_enabled(bool enable);
+
+#else
+static inline void *malloc_pool_alloc(size_t bytes)
+{
+	return NULL;
+}
+
+static inline void *malloc_pool_memalign(size_t alignment, size_t bytes)
+{
+	return NULL;
+}
+
+static inline bool malloc_pool_owns(const void *ptr)
+{
+	return false;
+}
+
+static inline bool malloc_pool_free(void *ptr)
+{
+	return false;
+}
+
+static inline size_t malloc_pool_usable_size(const void *ptr)
+{
+	return 0;
+}
+
+static inline ulong malloc_pool_in_use(void)
+{
+	return 0;
+}
+
+static inline bool malloc_pool_set_enabled(bool enable)
+{
+	return false;
+}
+#endif
+
 #ifdef __cplusplus
 };  /* end of extern "C" */
 #endif
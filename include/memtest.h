@@ -0,0 +1,180 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Parallel memory test engine
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#ifndef __MEMTEST_H
+#define __MEMTEST_H
+
+#include <linux/types.h>
+
+/**
+ * enum memtest_pattern_t - patterns supported by the engine
+ *
+ * @MEMTEST_ADDR:	Each 64-bit word holds its own address
+ * @MEMTEST_WALK_ONES:	A single set bit, moving one position per word
+ * @MEMTEST_WALK_ZEROS:	A single clear bit, moving one position per word
+ * @MEMTEST_MOVINV:	Moving inversions: fill with a pattern, then check and
+ *			invert each word going up, then check and restore each
+ *			word going down
+ * @MEMTEST_RANDOM:	Pseudo-random data, which is a function of the seed and
+ *			the word index so that it can be checked in any order
+ * @MEMTEST_PATTERN_COUNT: Number of patterns
+ */
+enum memtest_pattern_t {
+	MEMTEST_ADDR,
+	MEMTEST_WALK_ONES,
+	MEMTEST_WALK_ZEROS,
+	MEMTEST_MOVINV,
+	MEMTEST_RANDOM,
+
+	MEMTEST_PATTERN_COUNT,
+};
+
+/* Mask of all patterns, for memtest->patterns */
+#define MEMTEST_ALL		((1U << MEMTEST_PATTERN_COUNT) - 1)
+
+/* Maximum number of regions the memory under test is split into */
+#define MEMTEST_MAX_REGIONS	64
+
+/* Number of blocks in each region's error map */
+#define MEMTEST_MAP_BITS	64
+
+/**
+ * struct memtest_region - a part of the memory under test
+ *
+ * Each region is handled by one CPU at a time, so errors are recorded without
+ * locking.
+ *
+ * @addr:	Start address, relative to memtest->addr
+ * @size:	Size in bytes, a multiple of 8
+ * @errors:	Number of words which read back incorrectly
+ * @map:	Bit n is set if an error was found in block n of the region,
+ *		where the region is divided into MEMTEST_MAP_BITS equal blocks
+ * @first_addr:	Address of the first error found
+ * @expect:	Value expected at @first_addr
+ * @actual:	Value read from @first_addr
+ */
+struct memtest_region {
+	ulong addr;
+	ulong size;
+	ulong errors;
+	u64 map;
+	ulong first_addr;
+	u64 expect;
+	u64 actual;
+};
+
+/**
+ * struct memtest_pattern_stats - timing for one pattern
+ *
+ * @bytes:	Bytes read and written
+ * @time_us:	Time taken in microseconds
+ */
+struct memtest_pattern_stats {
+	u64 bytes;
+	ulong time_us;
+};
+
+/**
+ * struct memtest - a memory test
+ *
+ * Fill in the fields up to @priv (unused ones may be zero) and call
+ * memtest_run(). Results are placed in the remaining fields.
+ *
+ * @buf:	Memory to test, which must be 8-byte aligned
+ * @addr:	Address of @buf, as reported in errors
+ * @size:	Number of bytes to test; rounded down to a multiple of 8
+ * @patterns:	Bitmask of patterns to run, (1 << enum memtest_pattern_t)
+ * @pattern:	Value for MEMTEST_MOVINV
+ * @seed:	Seed for MEMTEST_RANDOM
+ * @lines:	true to use cache-line-sized bursts of stores and loads, false
+ *		to use single 64-bit accesses
+ * @max_cpus:	Maximum number of CPUs to use, 0 for all
+ * @step:	Function to call before each pass over memory, or NULL. This
+ *		runs on the calling CPU while no other CPU is touching the
+ *		memory. A non-zero return value aborts the test.
+ * @priv:	Private data for @step
+ * @num_cpus:	Number of CPUs used
+ * @num_regions: Number of entries in @region
+ * @errors:	Total number of errors found
+ * @stats:	Timing for each pattern
+ * @region:	Regions, in address order
+ */
+struct memtest {
+	void *buf;
+	ulong addr;
+	ulong size;
+	uint patterns;
+	u64 pattern;
+	u64 seed;
+	bool lines;
+	uint max_cpus;
+	int (*step)(struct memtest *mt, enum memtest_pattern_t pat, int pass);
+	void *priv;
+
+	uint num_cpus;
+	uint num_regions;
+	ulong errors;
+	struct memtest_pattern_stats stats[MEMTEST_PATTERN_COUNT];
+	struct memtest_region region[MEMTEST_MAX_REGIONS];
+};
+
+/**
+ * memtest_run() - run a memory test
+ *
+ * The memory is split into regions which are handed out to all available
+ * CPUs. Each pattern is made up of several passes over the whole memory;
+ * all CPUs finish one pass before the next is started.
+ *
+ * @mt:		Test to run
+ * Return: 0 if the test completed (even with errors), -EINVAL if the
+ * parameters are invalid, -EINTR if aborted by the step function, other -ve
+ * value if the other CPUs could not be used
+ */
+int memtest_run(struct memtest *mt);
+
+/**
+ * memtest_pattern_name() - get the name of a pattern
+ *
+ * @pat:	Pattern
+ * Return: name, e.g. "walk1"
+ */
+const char *memtest_pattern_name(enum memtest_pattern_t pat);
+
+/**
+ * memtest_mbps() - work out throughput
+ *
+ * @bytes:	Bytes transferred
+ * @time_us:	Time taken in microseconds
+ * Return: throughput in MB/s (where 1MB is 1000000 bytes)
+ */
+ulong memtest_mbps(u64 bytes, ulong time_us);
+
+/**
+ * arch_memtest_cpus() - get the number of CPUs available for memory tests
+ *
+ * The default implementation returns 1.
+ *
+ * Return: number of CPUs, including the calling one
+ */
+uint arch_memtest_cpus(void);
+
+/**
+ * arch_memtest_run() - run a function on several CPUs at once
+ *
+ * This calls @func on the calling CPU and on up to @cpus - 1 other CPUs, then
+ * waits for all calls to return. The default implementation calls it once,
+ * on the calling CPU.
+ *
+ * @func:	Function to call. @cpu is 0 on the calling CPU and non-zero on
+ *		others; only the calling CPU may use the console or drivers.
+ * @ctx:	Context to pass to @func
+ * @cpus:	Maximum number of CPUs to use
+ * Return: 0 if OK, -ve on error
+ */
+int arch_memtest_run(void (*func)(void *ctx, int cpu), void *ctx, uint cpus);
+
+#endif
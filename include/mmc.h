@@ -176,6 +176,13 @@ static inline bool mmc_is_tuning_cmd(uint cmdidx)
 #define MMC_STATUS_RDY_FOR_DATA (1 << 8)
 #define MMC_STATUS_CURR_STATE	(0xf << 9)
 #define MMC_STATUS_ERROR	(1 << 19)
+#define MMC_STATUS_CARD_ECC_FAILED	(1 << 21)
+#define MMC_STATUS_ADDRESS_ERROR	(1 << 30)
+#define MMC_STATUS_OUT_OF_RANGE	(1 << 31)
+/* Errors with the data or address of a transfer, rather than the bus */
+#define MMC_STATUS_MEDIA_ERROR	(MMC_STATUS_OUT_OF_RANGE | \
+				 MMC_STATUS_ADDRESS_ERROR | \
+				 MMC_STATUS_CARD_ECC_FAILED | MMC_STATUS_ERROR)
 
 #define MMC_STATE_PRG		(7 << 9)
 #define MMC_STATE_TRANS		(4 << 9)
@@ -240,6 +247,8 @@ static inline bool mmc_is_tuning_cmd(uint cmdidx)
 #define EXT_CSD_SEC_CNT			212	/* RO, 4 bytes */
 #define EXT_CSD_HC_WP_GRP_SIZE		221	/* RO */
 #define EXT_CSD_HC_ERASE_GRP_SIZE	224	/* RO */
+#define EXT_CSD_SEC_FEATURE_SUPPORT	231	/* RO */
+#define EXT_CSD_TRIM_MULT		232	/* RO */
 #define EXT_CSD_BOOT_MULT		226	/* RO */
 #define EXT_CSD_GENERIC_CMD6_TIME       248     /* RO */
 #define EXT_CSD_BKOPS_SUPPORT		502	/* RO */
@@ -248,6 +257,8 @@ static inline bool mmc_is_tuning_cmd(uint cmdidx)
  * EXT_CSD field definitions
  */
 
+#define EXT_CSD_SEC_GB_CL_EN		(1 << 4)	/* TRIM is supported */
+
 #define EXT_CSD_CMD_SET_NORMAL		(1 << 0)
 #define EXT_CSD_CMD_SET_SECURE		(1 << 1)
 #define EXT_CSD_CMD_SET_CPSECURE	(1 << 2)
@@ -307,6 +318,7 @@ static inline bool mmc_is_tuning_cmd(uint cmdidx)
 #define EXT_CSD_ENH_GP(x)	(1 << ((x)+1))	/* GP part (x+1) is enhanced */
 
 #define EXT_CSD_HS_CTRL_REL	(1 << 0)	/* host controlled WR_REL_SET */
+#define EXT_CSD_EN_REL_WR	(1 << 2)	/* enhanced reliable write */
 
 #define EXT_CSD_BOOT_WP_B_SEC_WP_SEL	(0x80)	/* enable partition selector */
 #define EXT_CSD_BOOT_WP_B_PWR_WP_SEC_SEL (0x02)	/* partition selector to protect */
@@ -359,6 +371,9 @@ enum mmc_voltage {
 /* Maximum block size for MMC */
 #define MMC_MAX_BLOCK_LEN	512
 
+/* Number of words of host tuning parameters, see get_tuning() */
+#define MMC_TUNING_WORDS	4
+
 /* The number of MMC physical partitions.  These consist of:
  * boot partitions (2), general purpose partitions (4) in MMC v4.4.
  */
@@ -491,6 +506,28 @@ struct dm_mmc_ops {
 	 * @return 0 if OK, -ve on error
 	 */
 	int (*execute_tuning)(struct udevice *dev, uint opcode);
+
+	/**
+	 * get_tuning() - Get the result of the last tuning
+	 *
+	 * This allows the card to be used again without tuning, e.g. in
+	 * U-Boot proper after SPL has tuned it, by passing the result to
+	 * set_tuning()
+	 *
+	 * @dev:	Device to check
+	 * @tuning:	Returns the tuning parameters, MMC_TUNING_WORDS words
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*get_tuning)(struct udevice *dev, u32 *tuning);
+
+	/**
+	 * set_tuning() - Restore the result of an earlier tuning
+	 *
+	 * @dev:	Device to update
+	 * @tuning:	Tuning parameters from get_tuning()
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*set_tuning)(struct udevice *dev, const u32 *tuning);
 #endif
 
 	/**
@@ -548,6 +585,8 @@ int mmc_set_ios(struct mmc *mmc);
 int mmc_getcd(struct mmc *mmc);
 int mmc_getwp(struct mmc *mmc);
 int mmc_execute_tuning(struct mmc *mmc, uint opcode);
+int mmc_get_tuning(struct mmc *mmc, u32 *tuning);
+int mmc_set_tuning(struct mmc *mmc, const u32 *tuning);
 int mmc_wait_dat0(struct mmc *mmc, int state, int timeout_us);
 int mmc_set_enhanced_strobe(struct mmc *mmc);
 int mmc_host_power_cycle(struct mmc *mmc);
@@ -649,6 +688,9 @@ static inline bool supports_uhs(uint caps)
 #endif
 }
 
+/* Number of buckets in the histogram of transfer sizes, the last for 128K+ */
+#define MMC_XFER_HIST_SIZE	18
+
 /*
  * With CONFIG_DM_MMC enabled, struct mmc can be accessed from the MMC device
  * with mmc_get_mmc_dev().
@@ -733,6 +775,27 @@ struct mmc {
 	u8 hs400_tuning;
 
 	enum bus_mode user_speed_mode; /* input speed mode from user */
+#if CONFIG_IS_ENABLED(MMC_STATE_CACHE)
+	/* State of the card on an earlier boot, used while setting it up */
+	const struct mmc_state *init_hint;
+#endif
+#if CONFIG_IS_ENABLED(MMC_WRITE_DEFER_BUSY)
+	/* The card may still be programming data from the last write */
+	bool write_busy;
+#endif
+#if CONFIG_IS_ENABLED(MMC_XFER_HISTOGRAM)
+	/* Number of reads and writes of 2^n to 2^(n+1) - 1 blocks */
+	u32 xfer_hist[MMC_XFER_HIST_SIZE];
+#endif
+#if CONFIG_IS_ENABLED(MMC_MODE_FALLBACK)
+	/* Bus modes which gave errors, and are not used again */
+	uint bad_caps;
+#endif
+#if CONFIG_IS_ENABLED(MMC_SPEED_REPORT)
+	/* Number of blocks read and time taken, to show the read speed */
+	u64 read_blocks;
+	u64 read_us;
+#endif
 };
 
 #if CONFIG_IS_ENABLED(DM_MMC)
@@ -793,6 +856,83 @@ int mmc_send_tuning(struct mmc *mmc, u32 opcode, int *cmd_error);
 int mmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd, struct mmc_data *data);
 int mmc_deinit(struct mmc *mmc);
 
+#if CONFIG_IS_ENABLED(MMC_WRITE_DEFER_BUSY)
+/**
+ * mmc_wait_write_done() - wait for the card to finish the last write
+ *
+ * A write returns as soon as the data has been sent, leaving the card busy
+ * programming it. This is waited for before the next command is sent to the
+ * card, so callers only need this before the card may lose power or be reset.
+ *
+ * @mmc:	MMC device
+ * Return: 0 if OK, -ve on error
+ */
+int mmc_wait_write_done(struct mmc *mmc);
+
+/**
+ * mmc_wait_writes_done() - wait for all cards to finish their last write
+ *
+ * This is called before the system is reset and before an OS is started,
+ * since either may cut the power to a card or reset it while it is still
+ * programming data. An error from a card is reported here, as the write
+ * which caused it has already returned.
+ *
+ * Return: 0 if OK, -ve if any card failed to finish its write
+ */
+int mmc_wait_writes_done(void);
+#else
+static inline int mmc_wait_write_done(struct mmc *mmc)
+{
+	return 0;
+}
+
+static inline int mmc_wait_writes_done(void)
+{
+	return 0;
+}
+#endif
+
+/**
+ * mmc_can_trim() - check whether a card supports the TRIM command
+ *
+ * TRIM erases single write blocks, so does not need the range to be aligned
+ * to an erase group. See mmc_trim().
+ *
+ * @mmc:	MMC device
+ * Return: true if the card supports TRIM
+ */
+bool mmc_can_trim(struct mmc *mmc);
+
+/**
+ * mmc_trim() - erase a range of blocks with the TRIM command
+ *
+ * Unlike mmc_berase(), which uses ERASE and so works on whole erase groups,
+ * this erases exactly the blocks given. It needs an eMMC which supports
+ * TRIM, see mmc_can_trim(). The blocks read back as erased afterwards.
+ *
+ * @desc:	Block device of the card, giving the hardware partition to use
+ * @start:	First block to trim
+ * @blkcnt:	Number of blocks to trim
+ * Return: 0 if OK, -ENOTSUPP if the card does not support TRIM, other -ve
+ *	on error
+ */
+int mmc_trim(struct blk_desc *desc, lbaint_t start, lbaint_t blkcnt);
+
+/**
+ * mmc_discard() - tell the card that some blocks are no longer needed
+ *
+ * This uses the DISCARD command of eMMC 4.5 and later, which lets the card
+ * drop the data without erasing it. The blocks then read back as either the
+ * old or the erased contents.
+ *
+ * @desc:	Block device of the card, giving the hardware partition to use
+ * @start:	First block to discard
+ * @blkcnt:	Number of blocks to discard
+ * Return: 0 if OK, -ENOTSUPP if the card does not support DISCARD, other -ve
+ *	on error
+ */
+int mmc_discard(struct blk_desc *desc, lbaint_t start, lbaint_t blkcnt);
+
 /**
  * mmc_of_parse() - Parse the device tree to get the capabilities of the host
  *
@@ -1007,6 +1147,244 @@ int mmc_boot_wp(struct mmc *mmc);
  */
 int mmc_boot_wp_single_partition(struct mmc *mmc, int partition);
 
+/* mmc_state->flags: @tuning holds the host tuning parameters */
+#define MMC_STATE_TUNING	BIT(0)
+
+/**
+ * struct mmc_state - state of a card which has been set up
+ *
+ * This holds what mmc_init() finds out about a card before reading its
+ * EXT_CSD, and how the host is set up to talk to it, so that a later phase
+ * can use the card without setting it up again. Fields are as in struct mmc
+ * unless noted. All fields have a fixed size since the record is passed
+ * between phases in a bloblist or kept across boots.
+ *
+ * @flags:	MMC_STATE_... flags
+ * @mode:	Bus mode in use (enum bus_mode)
+ * @sec_count:	SEC_COUNT from EXT_CSD, 0 for SD cards
+ * @ext_csd_rev: EXT_CSD_REV from EXT_CSD, 0 for SD cards
+ * @ssr_au:	SD allocation unit, from struct sd_ssr
+ * @ssr_erase_timeout: SD erase timeout, from struct sd_ssr
+ * @ssr_erase_offset: SD erase offset, from struct sd_ssr
+ * @tuning:	Host tuning parameters, if MMC_STATE_TUNING is set
+ * @reserved:	Must be zero
+ */
+struct mmc_state {
+	u32 flags;
+	u32 version;
+	u32 ocr;
+	u32 rca;
+	u32 cid[4];
+	u32 csd[4];
+	u32 scr[2];
+	u32 high_capacity;
+	u32 dsr_imp;
+	u32 read_bl_len;
+	u32 write_bl_len;
+	u32 erase_grp_size;
+	u32 legacy_speed;
+	u32 card_caps;
+	u32 cardtype;
+	u32 mode;
+	u32 best_mode;
+	u32 bus_width;
+	u32 signal_voltage;
+	u32 sec_count;
+	u32 ext_csd_rev;
+	u32 ssr_au;
+	u32 ssr_erase_timeout;
+	u32 ssr_erase_offset;
+	u32 tuning[MMC_TUNING_WORDS];
+	u32 reserved;
+	u64 capacity_user;
+};
+
+/**
+ * mmc_state_save() - record the state of a card which has been set up
+ *
+ * @mmc:	MMC device, which must have been set up with mmc_init()
+ * @st:		Returns the state
+ * Return: 0 if OK, -ENODEV if the card has not been set up
+ */
+int mmc_state_save(struct mmc *mmc, struct mmc_state *st);
+
+/**
+ * mmc_state_restore() - use a card left set up by an earlier phase
+ *
+ * This sets up the host for a card which is still in the transfer state,
+ * using the state recorded by mmc_state_save(), then checks that the card
+ * responds and that data can be read. Identification, bus-mode selection
+ * and (if the host can restore its tuning) tuning are skipped; the EXT_CSD
+ * of an eMMC is read again, which also checks that it is the same card.
+ *
+ * @mmc:	MMC device, which must not be set up yet
+ * @st:		State of the card
+ * Return: 0 if OK and the card is ready for use, -ve if it cannot be used
+ * this way, in which case mmc_init() must set it up from scratch
+ */
+int mmc_state_restore(struct mmc *mmc, const struct mmc_state *st);
+
+/* Maximum number of cards handed off from one phase to the next */
+#define MMC_HANDOFF_MAX_DEVS	3
+
+/* mmc_handoff_dev->flags: the record has been used */
+#define MMC_HANDOFF_F_USED	BIT(0)
+
+/**
+ * struct mmc_handoff_dev - a card handed off to the next phase
+ *
+ * @seq:	Sequence number of the MMC controller, from dev_seq()
+ * @flags:	MMC_HANDOFF_F_... flags
+ * @state:	State of the card
+ */
+struct mmc_handoff_dev {
+	u32 seq;
+	u32 flags;
+	struct mmc_state state;
+};
+
+/**
+ * struct mmc_handoff - cards handed off to the next phase
+ *
+ * This is the contents of the BLOBLISTT_U_BOOT_MMC_HANDOFF bloblist record.
+ *
+ * @count:	Number of entries in @dev
+ * @reserved:	Must be zero
+ * @dev:	Cards, in order of sequence number
+ */
+struct mmc_handoff {
+	u32 count;
+	u32 reserved;
+	struct mmc_handoff_dev dev[MMC_HANDOFF_MAX_DEVS];
+};
+
+/**
+ * mmc_handoff_save() - hand off all cards which are set up to the next phase
+ *
+ * This records each card which has been set up in the bloblist, so that the
+ * next phase can use it without identifying and tuning it again. It should
+ * be called just before the next phase is started.
+ *
+ * Return: 0 if OK, -ve on error
+ */
+int mmc_handoff_save(void);
+
+/**
+ * mmc_handoff_adopt() - use a card handed off by the previous phase
+ *
+ * Each record is used only once, so that a later mmc_init(), e.g. from
+ * 'mmc rescan', sets the card up from scratch.
+ *
+ * @mmc:	MMC device, which must not be set up yet
+ * Return: 0 if the card is ready for use, -ENOENT if there is no record for
+ * it, other -ve value if it could not be used
+ */
+int mmc_handoff_adopt(struct mmc *mmc);
+
+/* "MMCS" */
+#define MMC_CACHE_MAGIC		0x53434d4d
+#define MMC_CACHE_VERSION	1
+
+/* Maximum number of cards in the card-state cache */
+#define MMC_CACHE_MAX_DEVS	4
+
+/**
+ * struct mmc_cache_dev - state of a card on an earlier boot
+ *
+ * @seq:	Sequence number of the MMC controller, from dev_seq()
+ * @reserved:	Must be zero
+ * @state:	State of the card; state.cid identifies the card, all zero if
+ *		the entry is not in use
+ */
+struct mmc_cache_dev {
+	u32 seq;
+	u32 reserved;
+	struct mmc_state state;
+};
+
+/**
+ * struct mmc_cache - card-state cache
+ *
+ * This is kept by the board in a place which survives a reset.
+ *
+ * @magic:	MMC_CACHE_MAGIC
+ * @version:	MMC_CACHE_VERSION
+ * @size:	Size of this struct in bytes
+ * @crc32:	CRC32 of @dev
+ * @dev:	Cards, in no particular order
+ */
+struct mmc_cache {
+	u32 magic;
+	u32 version;
+	u32 size;
+	u32 crc32;
+	struct mmc_cache_dev dev[MMC_CACHE_MAX_DEVS];
+};
+
+/**
+ * mmc_cache_load() - read the card-state cache from the board
+ *
+ * This is done on first use of the cache. The cache is checked and emptied
+ * if it is not valid.
+ *
+ * Return: 0 if a valid cache was read, -ENOENT if there is none, -EBADMSG if
+ * it is corrupt, other -ve value if it could not be read
+ */
+int mmc_cache_load(void);
+
+/**
+ * mmc_cache_find() - find the state of a card on an earlier boot
+ *
+ * This is called by mmc_startup() once the CID of the card is known. The
+ * cache is loaded with board_mmc_cache_read() on first use.
+ *
+ * @mmc:	MMC device being set up
+ * Return: state of the card with the same CID on the same controller, or
+ * NULL if there is none
+ */
+const struct mmc_state *mmc_cache_find(struct mmc *mmc);
+
+/**
+ * mmc_cache_update() - record the state of a card which has been set up
+ *
+ * The cache is written with board_mmc_cache_write() if it has changed.
+ *
+ * @mmc:	MMC device, which must have been set up
+ * Return: 0 if OK, -ve on error
+ */
+int mmc_cache_update(struct mmc *mmc);
+
+/**
+ * mmc_cache_drop() - forget the state of the card on a controller
+ *
+ * This is used when the state found by mmc_cache_find() did not work. The
+ * cache in storage is updated by the next mmc_cache_update().
+ *
+ * @mmc:	MMC device
+ */
+void mmc_cache_drop(struct mmc *mmc);
+
+/**
+ * board_mmc_cache_read() - read the card-state cache
+ *
+ * This is provided by the board, e.g. using scratch registers in the RTC or
+ * PMIC, or a reserved area of a boot medium which is not an MMC card.
+ *
+ * @buf:	Place to put the cache
+ * @size:	Number of bytes to read (sizeof(struct mmc_cache))
+ * Return: number of bytes read, or -ve on error
+ */
+int board_mmc_cache_read(void *buf, ulong size);
+
+/**
+ * board_mmc_cache_write() - write the card-state cache
+ *
+ * @buf:	Cache to write
+ * @size:	Number of bytes to write (sizeof(struct mmc_cache))
+ * Return: 0 if OK, -ve on error
+ */
+int board_mmc_cache_write(const void *buf, ulong size);
+
 static inline enum dma_data_direction mmc_get_dma_dir(struct mmc_data *data)
 {
 	return data->flags & MMC_DATA_WRITE ? DMA_TO_DEVICE : DMA_FROM_DEVICE;
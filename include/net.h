@@ -15,9 +15,11 @@
 #include <linux/types.h>
 #include <asm/cache.h>
 #include <asm/byteorder.h>	/* for nton* / ntoh* stuff */
+#include <bootstage.h>
 #include <env.h>
 #include <log.h>
 #include <time.h>
+#include <linux/errno.h>
 #include <linux/if_ether.h>
 #include <rand.h>
 
@@ -65,6 +67,17 @@ struct in_addr {
  */
 int do_tftpb(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[]);
 
+/**
+ * do_wget - Run the wget command
+ *
+ * @cmdtp: Command information for wget
+ * @flag: Command flags (CMD_FLAG_...)
+ * @argc: Number of arguments
+ * @argv: List of arguments
+ * Return: result (see enum command_ret_t)
+ */
+int do_wget(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[]);
+
 /**
  * An incoming packet handler.
  * @param pkt    pointer to the application packet
@@ -365,6 +378,7 @@ struct vlan_ethernet_hdr {
 #define PROT_NCSI	0x88f8		/* NC-SI control packets        */
 
 #define IPPROTO_ICMP	 1	/* Internet Control Message Protocol	*/
+#define IPPROTO_TCP	 6	/* Transmission Control Protocol	*/
 #define IPPROTO_UDP	17	/* User Datagram Protocol		*/
 
 /*
@@ -560,7 +574,7 @@ extern int		net_restart_wrap;	/* Tried all network devices */
 
 enum proto_t {
 	BOOTP, RARP, ARP, TFTPGET, DHCP, PING, DNS, NFS, CDP, NETCONS, SNTP,
-	TFTPSRV, TFTPPUT, LINKLOCAL, FASTBOOT, WOL, UDP
+	TFTPSRV, TFTPPUT, LINKLOCAL, FASTBOOT, WOL, UDP, WGET
 };
 
 extern char	net_boot_file_name[1024];/* Boot File name */
@@ -605,6 +619,19 @@ extern int net_ntp_time_offset;			/* offset time from UTC */
 int net_init(void);
 int net_loop(enum proto_t);
 
+/**
+ * net_set_phase() - Start a new phase of network activity
+ *
+ * The time spent in each phase, such as DHCP or a TFTP transfer, is added up
+ * across commands and shown by 'bootstage report'. This ends the previous
+ * phase, if any. net_loop() ends the phase when it returns.
+ *
+ * @id: Bootstage ID to add the time to (BOOTSTAGE_ID_ACCUM_NET_...), or
+ *	BOOTSTAGE_ID_START to just end the previous phase
+ * @name: Name of the phase
+ */
+void net_set_phase(enum bootstage_id id, const char *name);
+
 /* Load failed.	 Start again. */
 int net_start_again(void);
 
@@ -657,6 +684,38 @@ void net_set_udp_handler(rxhand_f *);	/* Set UDP RX packet handler */
 rxhand_f *net_get_arp_handler(void);	/* Get ARP RX packet handler */
 void net_set_arp_handler(rxhand_f *);	/* Set ARP RX packet handler */
 bool arp_is_waiting(void);		/* Waiting for ARP reply? */
+
+#if CONFIG_IS_ENABLED(NET_ARP_CACHE)
+/**
+ * arp_cache_lookup() - Find the MAC address to send to, from earlier replies
+ *
+ * @dest: IP address to send to. If it is not on our subnet, the gateway's
+ *	MAC address is looked up instead
+ * @ethaddr: Returns the MAC address, if found
+ * Return: 0 if found, -ENOENT if not
+ */
+int arp_cache_lookup(struct in_addr dest, uchar *ethaddr);
+
+/**
+ * arp_cache_flush() - Forget all ARP replies
+ */
+void arp_cache_flush(void);
+#else
+static inline int arp_cache_lookup(struct in_addr dest, uchar *ethaddr)
+{
+	return -ENOENT;
+}
+
+static inline void arp_cache_flush(void)
+{
+}
+#endif
+
+/**
+ * dhcp_lease_clear() - Forget the DHCP lease, so the next request starts over
+ */
+void dhcp_lease_clear(void);
+
 void net_set_icmp_handler(rxhand_icmp_f *f); /* Set ICMP RX handler */
 void net_set_timeout_handler(ulong, thand_f *);/* Set timeout handler */
 
@@ -0,0 +1,280 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Minimal TCP client
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#ifndef __NET_TCP_H__
+#define __NET_TCP_H__
+
+#include <net.h>
+#include <linux/list.h>
+#include <linux/types.h>
+
+/* Header flags */
+#define TCP_FIN		0x01
+#define TCP_SYN		0x02
+#define TCP_RST		0x04
+#define TCP_PUSH	0x08
+#define TCP_ACK		0x10
+
+/* Options */
+#define TCP_OPT_END	0
+#define TCP_OPT_NOP	1
+#define TCP_OPT_MSS	2
+#define TCP_OPT_WS	3
+
+/**
+ * struct ip_tcp_hdr - IP and TCP header
+ *
+ * @tcp_hlen: Length of the TCP header in 32-bit words, in the top four bits
+ */
+struct ip_tcp_hdr {
+	u8		ip_hl_v;	/* header length and version	*/
+	u8		ip_tos;		/* type of service		*/
+	u16		ip_len;		/* total length			*/
+	u16		ip_id;		/* identification		*/
+	u16		ip_off;		/* fragment offset field	*/
+	u8		ip_ttl;		/* time to live			*/
+	u8		ip_p;		/* protocol			*/
+	u16		ip_sum;		/* checksum			*/
+	struct in_addr	ip_src;		/* Source IP address		*/
+	struct in_addr	ip_dst;		/* Destination IP address	*/
+	u16		tcp_src;	/* TCP source port		*/
+	u16		tcp_dst;	/* TCP destination port		*/
+	u32		tcp_seq;	/* Sequence number		*/
+	u32		tcp_ack;	/* Acknowledgement number	*/
+	u8		tcp_hlen;	/* Header length		*/
+	u8		tcp_flags;	/* TCP_...			*/
+	u16		tcp_win;	/* Receive window		*/
+	u16		tcp_xsum;	/* Checksum			*/
+	u16		tcp_urg;	/* Urgent pointer		*/
+} __packed;
+
+#define TCP_HDR_SIZE		20
+#define IP_TCP_HDR_SIZE		(IP_HDR_SIZE + TCP_HDR_SIZE)
+
+/* Options sent with a SYN: maximum segment size, no-op and window scale */
+#define TCP_SYN_OPT_SIZE	8
+
+/* Largest segment which fits in an Ethernet frame, and the default (RFC 879) */
+#define TCP_MSS			1460
+#define TCP_DEFAULT_MSS		536
+
+/* Most data which can be sent and not yet acknowledged */
+#define TCP_TX_BUF_SIZE		TCP_MSS
+
+/**
+ * enum tcp_state - State of a connection
+ *
+ * The TIME-WAIT state is not used: a connection is closed as soon as both
+ * sides have sent a FIN.
+ *
+ * @TCP_CLOSED: Not connected
+ * @TCP_SYN_SENT: Waiting for the server to accept the connection
+ * @TCP_ESTABLISHED: Connected
+ * @TCP_CLOSE_WAIT: The server has closed its side of the connection
+ * @TCP_FIN_WAIT: Closed by tcp_close(), waiting for the server to close
+ * @TCP_LAST_ACK: Both sides closed, waiting for our FIN to be acknowledged
+ */
+enum tcp_state {
+	TCP_CLOSED,
+	TCP_SYN_SENT,
+	TCP_ESTABLISHED,
+	TCP_CLOSE_WAIT,
+	TCP_FIN_WAIT,
+	TCP_LAST_ACK,
+};
+
+/**
+ * enum tcp_event - Something which happened to a connection
+ *
+ * @TCP_EV_CONNECTED: The connection is established and data can be sent
+ * @TCP_EV_CLOSED: The server has closed its side of the connection. The
+ *	connection should be closed with tcp_close()
+ * @TCP_EV_RESET: The server has reset the connection, which is now closed
+ * @TCP_EV_TIMEOUT: Nothing sent was acknowledged despite several tries, so
+ *	the connection has been given up
+ */
+enum tcp_event {
+	TCP_EV_CONNECTED,
+	TCP_EV_CLOSED,
+	TCP_EV_RESET,
+	TCP_EV_TIMEOUT,
+};
+
+struct tcp_conn;
+
+/**
+ * typedef tcp_rx_func_t - Handle data received on a connection
+ *
+ * Data is delivered in order, exactly once
+ *
+ * @conn: Connection
+ * @data: Received data
+ * @len: Number of bytes received
+ */
+typedef void (*tcp_rx_func_t)(struct tcp_conn *conn, const uchar *data,
+			      uint len);
+
+/**
+ * typedef tcp_event_func_t - Handle an event on a connection
+ *
+ * @conn: Connection
+ * @event: What happened
+ */
+typedef void (*tcp_event_func_t)(struct tcp_conn *conn, enum tcp_event event);
+
+/**
+ * struct tcp_conn - A connection to a server
+ *
+ * @node: Node in the list of connections which are not closed
+ * @state: State of the connection
+ * @local_ip: Our IP address when the connection was made
+ * @remote_ip: Server's IP address
+ * @ethaddr: Ethernet address of the server or gateway, zero until known
+ * @local_port: Our port
+ * @remote_port: Server's port
+ * @snd_una: Sequence number of the oldest byte not yet acknowledged
+ * @snd_nxt: Sequence number of the next byte to send
+ * @rcv_nxt: Sequence number of the next byte expected from the server
+ * @ack_sent: Last acknowledgement number sent
+ * @mss: Largest segment the server accepts
+ * @rcv_wscale: Scale factor of the window we advertise, 0 if not agreed
+ * @fin_sent: true if we have sent a FIN
+ * @txbuf: Data sent but not yet acknowledged, starting at @snd_una
+ * @tx_len: Number of bytes in @txbuf
+ * @timer: get_timer() value when the retransmission timer was started
+ * @rto: Retransmission timeout in milliseconds
+ * @tries: Number of times the oldest unacknowledged segment has been sent
+ * @rx: Function to call with received data
+ * @event: Function to call when something happens to the connection
+ * @ctx: Context for @rx and @event
+ */
+struct tcp_conn {
+	struct list_head node;
+	enum tcp_state state;
+	struct in_addr local_ip;
+	struct in_addr remote_ip;
+	uchar ethaddr[ARP_HLEN];
+	u16 local_port;
+	u16 remote_port;
+	u32 snd_una;
+	u32 snd_nxt;
+	u32 rcv_nxt;
+	u32 ack_sent;
+	u16 mss;
+	u8 rcv_wscale;
+	bool fin_sent;
+	uchar txbuf[TCP_TX_BUF_SIZE];
+	uint tx_len;
+	ulong timer;
+	ulong rto;
+	int tries;
+	tcp_rx_func_t rx;
+	tcp_event_func_t event;
+	void *ctx;
+};
+
+/**
+ * tcp_conn_init() - Set up a connection, ready to connect
+ *
+ * @conn: Connection to set up
+ * @rx: Function to call with received data
+ * @event: Function to call when something happens to the connection
+ * @ctx: Context for @rx and @event
+ */
+void tcp_conn_init(struct tcp_conn *conn, tcp_rx_func_t rx,
+		   tcp_event_func_t event, void *ctx);
+
+/**
+ * tcp_connect() - Connect to a server
+ *
+ * This sends a SYN and returns straight away. TCP_EV_CONNECTED is sent once
+ * the server accepts the connection. If @conn is already in use, it is
+ * reset first.
+ *
+ * @conn: Connection, set up by tcp_conn_init()
+ * @ip: Server's IP address
+ * @port: Server's port
+ */
+void tcp_connect(struct tcp_conn *conn, struct in_addr ip, int port);
+
+/**
+ * tcp_send() - Send data on a connection
+ *
+ * @conn: Connection
+ * @data: Data to send
+ * @len: Number of bytes to send
+ * Return: 0 if OK, -ENOTCONN if the connection is not established, -EAGAIN if
+ *	there is not enough room to keep the data until it is acknowledged
+ */
+int tcp_send(struct tcp_conn *conn, const void *data, uint len);
+
+/**
+ * tcp_close() - Close a connection
+ *
+ * This sends a FIN. No more data or events are delivered for the connection.
+ *
+ * @conn: Connection
+ */
+void tcp_close(struct tcp_conn *conn);
+
+/**
+ * tcp_abort() - Reset a connection
+ *
+ * This sends a RST and closes the connection straight away. No more data or
+ * events are delivered for the connection.
+ *
+ * @conn: Connection, which need not be open
+ */
+void tcp_abort(struct tcp_conn *conn);
+
+/**
+ * tcp_checksum() - Work out the checksum of a segment
+ *
+ * @ip: IP header of the segment, followed by the TCP header and data
+ * @tcp_len: Number of bytes in the TCP header and data
+ * Return: checksum to put in @ip->tcp_xsum, which must be 0 while this is
+ *	worked out. If @ip->tcp_xsum is already set, this is 0 or 0xffff if it
+ *	is correct
+ */
+uint tcp_checksum(const struct ip_tcp_hdr *ip, int tcp_len);
+
+/**
+ * tcp_set_tcp_header() - Set up the IP and TCP header of a segment
+ *
+ * This is called by net_send_ip_packet(). The data must already be in
+ * place, after a TCP header without options. A SYN has options but no data.
+ *
+ * @pkt: Place to put the IP header
+ * @dest: Destination IP address
+ * @dport: Destination port
+ * @sport: Source port
+ * @payload_len: Number of bytes of data
+ * @action: Header flags (TCP_...)
+ * @tcp_seq_num: Sequence number
+ * @tcp_ack_num: Acknowledgement number
+ * Return: number of bytes in the IP and TCP header
+ */
+int tcp_set_tcp_header(uchar *pkt, struct in_addr dest, int dport, int sport,
+		       int payload_len, u8 action, u32 tcp_seq_num,
+		       u32 tcp_ack_num);
+
+/**
+ * tcp_receive() - Handle a received segment
+ *
+ * @ip: IP header of the segment
+ * @len: Length of the IP packet
+ */
+void tcp_receive(struct ip_tcp_hdr *ip, int len);
+
+/**
+ * tcp_timeout_check() - Send again anything not acknowledged in time
+ *
+ * This is called from the main network loop
+ */
+void tcp_timeout_check(void);
+
+#endif /* __NET_TCP_H__ */
@@ -0,0 +1,36 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * HTTP/1.1 client
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#ifndef __NET_WGET_H__
+#define __NET_WGET_H__
+
+/* Well-known HTTP port */
+#define WGET_HTTP_PORT		80
+
+/* Most connections used for one file */
+#define WGET_MAX_CONNS		8
+
+/**
+ * wget_start() - Start loading a file over HTTP
+ *
+ * This is called by net_loop() to load net_boot_file_name to
+ * image_load_addr. The file name is either a URL such as
+ * http://192.168.1.1:8080/boot/Image or [hostIPaddr:]path, in which case
+ * the server is net_server_ip (if not given) and the port is 80.
+ */
+void wget_start(void);
+
+/**
+ * wget_stop() - Stop loading a file
+ *
+ * This is called when net_loop() finishes, e.g. if Ctrl-C is pressed, so
+ * that nothing more is written to memory. Connections with nothing
+ * outstanding are kept open for the next file.
+ */
+void wget_stop(void);
+
+#endif /* __NET_WGET_H__ */
@@ -67,6 +67,7 @@ enum ns16550_flags {
  * @reg_offset:		Offset to start of registers (normally 0)
  * @clock:		UART base clock speed in Hz
  * @fcr:		Offset of FCR register (normally UART_FCR_DEFVAL)
+ * @fifo_size:		Depth of the TX FIFO in bytes (1 if there is no FIFO)
  * @flags:		A few flags (enum ns16550_flags)
  * @bdf:		PCI slot/function (pci_dev_t)
  */
@@ -77,6 +78,7 @@ struct ns16550_plat {
 	int reg_offset;
 	int clock;
 	u32 fcr;
+	int fifo_size;
 	int flags;
 #if defined(CONFIG_PCI) && defined(CONFIG_SPL)
 	int bdf;
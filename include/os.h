@@ -169,6 +169,27 @@ void os_usleep(unsigned long usec);
  */
 uint64_t os_get_nsec(void);
 
+/**
+ * os_perf_open() - open the host's CPU performance counters
+ *
+ * This opens a group of three counters for the calling thread: CPU cycles,
+ * instructions retired and cache misses, counting user-space only.
+ *
+ * Return:	0 if OK, -ve on error (e.g. perf events are not permitted)
+ */
+int os_perf_open(void);
+
+/**
+ * os_perf_read() - read the host's CPU performance counters
+ *
+ * If the counters could not be opened, the first value is the time from
+ * os_get_nsec() and the rest are zero.
+ *
+ * @vals:	returns the counter values
+ * @count:	number of values to read (at most 3)
+ */
+void os_perf_read(uint64_t *vals, int count);
+
 /**
  * Parse arguments and update sandbox state.
  *
@@ -478,6 +499,46 @@ int os_setup_signal_handlers(void);
  */
 void os_signal_action(int sig, unsigned long pc);
 
+/**
+ * os_prof_start() - start a profiling timer
+ *
+ * This uses SIGPROF, so the timer only advances while sandbox is using the
+ * CPU. Slow system calls are restarted after the signal is handled.
+ *
+ * @hz:		number of times per second to call @func
+ * @func:	function to call with the interrupted program counter
+ * Return:	0 if OK, -ve on error
+ */
+int os_prof_start(unsigned int hz, void (*func)(unsigned long pc));
+
+/**
+ * os_prof_stop() - stop the profiling timer
+ */
+void os_prof_stop(void);
+
+/**
+ * os_num_cpus() - get the number of host CPUs which are online
+ *
+ * Return:	number of CPUs, at least 1
+ */
+unsigned int os_num_cpus(void);
+
+/**
+ * os_run_threads() - call a function on several host threads at once
+ *
+ * @func is called on the current thread with @cpu set to 0, and on @count - 1
+ * new threads with @cpu set to 1 onwards. This returns once all calls have
+ * returned. If a thread cannot be created its call is made on the current
+ * thread instead.
+ *
+ * @func:	function to call
+ * @ctx:	context to pass to @func
+ * @count:	number of calls to make
+ * Return:	0 if OK, -ve on error
+ */
+int os_run_threads(void (*func)(void *ctx, int cpu), void *ctx,
+		   unsigned int count);
+
 /**
  * os_get_time_offset() - get time offset
  *
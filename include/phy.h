@@ -11,6 +11,7 @@
 
 #include <log.h>
 #include <phy_interface.h>
+#include <sched.h>
 #include <dm/ofnode.h>
 #include <dm/read.h>
 #include <linux/errno.h>
@@ -80,6 +81,11 @@ struct mii_dev {
 	int (*reset)(struct mii_dev *bus);
 	struct phy_device *phymap[PHY_MAX_ADDR];
 	u32 phy_mask;
+	/*
+	 * Set during phy_read() and phy_write(), and by MDIO drivers whose
+	 * accesses may wait, see phy_aneg_start()
+	 */
+	bool busy;
 };
 
 /* struct phy_driver: a structure which defines PHY behavior
@@ -167,6 +173,9 @@ struct phy_device {
 	u32 phy_id;
 	bool is_c45;
 	u32 flags;
+
+	/* Background wait for auto-negotiation, see phy_aneg_start() */
+	struct sched_task aneg_task;
 };
 
 struct fixed_link {
@@ -340,6 +349,33 @@ int phy_clear_bits_mmd(struct phy_device *phydev, int devad, u32 regnum, u16 val
 int phy_startup(struct phy_device *phydev);
 int phy_config(struct phy_device *phydev);
 int phy_shutdown(struct phy_device *phydev);
+
+/**
+ * phy_aneg_start() - Bring the link up in the background
+ *
+ * This is for use after phy_config(), which starts auto-negotiation. Rather
+ * than waiting for it to complete in phy_startup(), a background task polls
+ * for it, so the link may already be up by the time the Ethernet device is
+ * used. The task leaves the bus alone while it is busy, see struct mii_dev.
+ *
+ * @phydev: PHY to start
+ * Return: 0 if OK, -ve on error
+ */
+int phy_aneg_start(struct phy_device *phydev);
+
+/**
+ * phy_aneg_wait() - Finish bringing the link up
+ *
+ * This is used in place of phy_startup(). If phy_aneg_start() was called, it
+ * waits for the background task to finish, returning any error. It then
+ * calls phy_startup() to read the state of the link, which does not wait
+ * once auto-negotiation is complete.
+ *
+ * @phydev: PHY to wait for
+ * Return: 0 if OK (check phydev->link to see if the link is up), -ve on error
+ */
+int phy_aneg_wait(struct phy_device *phydev);
+
 int phy_register(struct phy_driver *drv);
 int phy_set_supported(struct phy_device *phydev, u32 max_speed);
 int phy_modify(struct phy_device *phydev, int devad, int regnum, u16 mask,
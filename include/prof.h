@@ -0,0 +1,106 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Sampling profiler
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#ifndef __PROF_H
+#define __PROF_H
+
+#include <linux/errno.h>
+#include <linux/types.h>
+
+/**
+ * struct prof_stats - information about the samples collected so far
+ *
+ * @running:	true if the profiler is currently sampling
+ * @hz:		sampling rate in Hz
+ * @count:	number of samples recorded
+ * @size:	number of samples which fit in the buffer
+ * @dropped:	number of samples lost because the buffer was full
+ */
+struct prof_stats {
+	bool running;
+	uint hz;
+	uint count;
+	uint size;
+	ulong dropped;
+};
+
+#if CONFIG_IS_ENABLED(PROFILER)
+/**
+ * prof_start() - start sampling
+ *
+ * The sample buffer is allocated on first use. Samples are added to any
+ * already collected; use prof_reset() to discard them.
+ *
+ * Return: 0 if OK, -EALREADY if already running, -ENOMEM if the buffer
+ * cannot be allocated, other -ve value if the timer could not be started
+ */
+int prof_start(void);
+
+/**
+ * prof_stop() - stop sampling
+ *
+ * This must be called before handing over to an OS, since it disables the
+ * timer interrupt. It is safe to call when the profiler is not running.
+ */
+void prof_stop(void);
+
+/** prof_reset() - discard all samples collected so far */
+void prof_reset(void);
+
+/**
+ * prof_sample() - record a sample
+ *
+ * This is called from the timer interrupt (or signal handler on sandbox).
+ *
+ * @pc:	Program counter at the time of the interrupt
+ */
+void prof_sample(ulong pc);
+
+/**
+ * prof_get_stats() - get information about the samples collected
+ *
+ * @stats:	Returns the information
+ */
+void prof_get_stats(struct prof_stats *stats);
+
+/**
+ * prof_report() - print a flat profile
+ *
+ * Samples are grouped by function if CONFIG_KALLSYMS is enabled, else by
+ * address, and the busiest are printed first. Sampling is paused while the
+ * report is produced, and the samples are left sorted by address.
+ *
+ * @count:	Maximum number of lines to print
+ * Return: 0 if OK, -ENOENT if there are no samples, -ENOMEM if out of memory
+ */
+int prof_report(int count);
+
+/**
+ * arch_prof_start() - start the sampling timer
+ *
+ * This is provided by the architecture. The timer must call prof_sample()
+ * with the interrupted program counter @hz times a second.
+ *
+ * @hz:	Sampling rate
+ * Return: 0 if OK, -ve on error
+ */
+int arch_prof_start(uint hz);
+
+/** arch_prof_stop() - stop the sampling timer */
+void arch_prof_stop(void);
+#else
+static inline int prof_start(void)
+{
+	return -ENOSYS;
+}
+
+static inline void prof_stop(void)
+{
+}
+#endif
+
+#endif
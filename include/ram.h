@@ -7,6 +7,10 @@
 #ifndef __RAM_H
 #define __RAM_H
 
+#include <linux/bitops.h>
+#include <linux/errno.h>
+#include <linux/types.h>
+
 struct udevice;
 
 struct ram_info {
@@ -14,6 +18,56 @@ struct ram_info {
 	size_t size;
 };
 
+/* "TRAN" */
+#define RAM_TRAIN_MAGIC		0x4e415254
+#define RAM_TRAIN_HDR_VERSION	1
+
+/* The record has been changed and should be written to storage */
+#define RAM_TRAIN_F_DIRTY	BIT(0)
+
+/**
+ * struct ram_train_key - identifies the memory a training record is for
+ *
+ * A saved record is only used if all of these match the memory being set up.
+ *
+ * @chip_id:	Unique ID of the SoC, e.g. from fuses
+ * @package_id:	ID of the memory package or DIMM, and its configuration
+ * @data_rate:	Data rate in MT/s
+ * @version:	Version of the driver's training data format
+ */
+struct ram_train_key {
+	u64 chip_id;
+	u64 package_id;
+	u32 data_rate;
+	u32 version;
+};
+
+/**
+ * struct ram_train_hdr - header of a training record
+ *
+ * The record, this header followed by the driver's training data, is stored
+ * in a reserved area of the boot medium.
+ *
+ * @magic:	RAM_TRAIN_MAGIC
+ * @flags:	RAM_TRAIN_F_... flags, only used in memory; zero in storage
+ * @crc32:	CRC32 of the record from @hdr_version to the end of the data
+ * @hdr_version: RAM_TRAIN_HDR_VERSION
+ * @hdr_size:	Size of this header in bytes
+ * @data_size:	Size of the training data following the header, in bytes
+ * @reserved:	Zero
+ * @key:	Memory the data is for
+ */
+struct ram_train_hdr {
+	u32 magic;
+	u32 flags;
+	u32 crc32;
+	u16 hdr_version;
+	u16 hdr_size;
+	u32 data_size;
+	u32 reserved;
+	struct ram_train_key key;
+};
+
 struct ram_ops {
 	/**
 	 * get_info() - Get basic memory info
@@ -23,6 +77,51 @@ struct ram_ops {
 	 * @return 0 if OK, -ve on error
 	 */
 	int (*get_info)(struct udevice *dev, struct ram_info *info);
+
+	/**
+	 * get_train_key() - Identify the memory being trained
+	 *
+	 * This is optional; without it all fields of the key are zero.
+	 *
+	 * @dev:	Device to check (UCLASS_RAM)
+	 * @key:	Place to put the key
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*get_train_key)(struct udevice *dev, struct ram_train_key *key);
+
+	/**
+	 * train() - Run full memory training
+	 *
+	 * This sets up the memory from scratch and writes the parameters
+	 * found to @data, so they can be restored on the next boot.
+	 *
+	 * @dev:	Device to train (UCLASS_RAM)
+	 * @data:	Place to put the training parameters
+	 * @size:	Space available at @data in bytes
+	 * @return number of bytes written to @data, or -ve on error
+	 */
+	int (*train)(struct udevice *dev, void *data, int size);
+
+	/**
+	 * restore() - Set up the memory using saved training parameters
+	 *
+	 * @dev:	Device to set up (UCLASS_RAM)
+	 * @data:	Parameters written by train() on a previous boot
+	 * @size:	Size of @data in bytes
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*restore)(struct udevice *dev, const void *data, int size);
+
+	/**
+	 * verify() - Quickly check that restored parameters work
+	 *
+	 * This is optional. It is called after restore() succeeds; if it fails
+	 * the saved parameters are discarded and full training is run.
+	 *
+	 * @dev:	Device to check (UCLASS_RAM)
+	 * @return 0 if the memory works, -ve on error
+	 */
+	int (*verify)(struct udevice *dev);
 };
 
 #define ram_get_ops(dev)        ((struct ram_ops *)(dev)->driver->ops)
@@ -36,4 +135,90 @@ struct ram_ops {
  */
 int ram_get_info(struct udevice *dev, struct ram_info *info);
 
+#if CONFIG_IS_ENABLED(RAM_TRAIN_CACHE)
+/**
+ * ram_train() - Set up memory, using saved training results if possible
+ *
+ * This is called by RAM drivers from their probe() method. If the training
+ * cache holds a valid record whose key matches the memory, the parameters
+ * are restored and verified. Otherwise, or if that fails, the record is
+ * invalidated and full training is run, with the results put in the cache
+ * for ram_train_save() to write out.
+ *
+ * The cache is loaded from storage by ram_train_load() on first use.
+ *
+ * @dev:	Device to set up (UCLASS_RAM)
+ * Return: 0 if OK, -ENOSYS if the driver does not support training, other
+ * -ve value if training failed
+ */
+int ram_train(struct udevice *dev);
+
+/**
+ * ram_train_load() - Read the training cache from storage
+ *
+ * The record is checked and discarded if it is not valid.
+ *
+ * Return: 0 if a valid record was read, -ENOENT if there is none, -EBADMSG if
+ * the record is corrupt, other -ve value if it could not be read
+ */
+int ram_train_load(void);
+
+/**
+ * ram_train_save() - Write the training cache to storage if it has changed
+ *
+ * This may be called in SPL or, if the cache is at a fixed address which
+ * survives, from U-Boot proper once the boot medium can be written.
+ *
+ * Return: 0 if OK or nothing needed writing, -ve on error
+ */
+int ram_train_save(void);
+
+/**
+ * ram_train_invalidate() - Discard the training record
+ *
+ * The record in storage is also invalidated by the next ram_train_save().
+ */
+void ram_train_invalidate(void);
+
+/**
+ * board_ram_train_read() - Read the training record from the boot medium
+ *
+ * This is provided by the board, since the reserved area depends on how the
+ * board boots.
+ *
+ * @buf:	Place to put the record
+ * @size:	Number of bytes to read (CONFIG_RAM_TRAIN_CACHE_SIZE)
+ * Return: number of bytes read, or -ve on error
+ */
+int board_ram_train_read(void *buf, ulong size);
+
+/**
+ * board_ram_train_write() - Write the training record to the boot medium
+ *
+ * @buf:	Record to write
+ * @size:	Number of bytes to write (CONFIG_RAM_TRAIN_CACHE_SIZE)
+ * Return: 0 if OK, -ve on error
+ */
+int board_ram_train_write(const void *buf, ulong size);
+#else
+static inline int ram_train(struct udevice *dev)
+{
+	return -ENOSYS;
+}
+
+static inline int ram_train_load(void)
+{
+	return -ENOSYS;
+}
+
+static inline int ram_train_save(void)
+{
+	return 0;
+}
+
+static inline void ram_train_invalidate(void)
+{
+}
+#endif
+
 #endif
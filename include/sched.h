@@ -0,0 +1,146 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Cooperative scheduler for background tasks
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#ifndef __SCHED_H
+#define __SCHED_H
+
+#include <linux/list.h>
+#include <linux/types.h>
+
+struct sched_task;
+
+/* Return value of a task function which has more to do */
+#define SCHED_AGAIN	1
+
+/**
+ * typedef sched_func_t - Carry out the next step of a task
+ *
+ * A task is a state machine: each call should do a little work, keeping
+ * whatever it needs in @task->state and @task->ctx, and return without
+ * waiting for the hardware. It is called again after @task->period_us
+ * until it returns something other than SCHED_AGAIN.
+ *
+ * @task: Task to step
+ * Return: SCHED_AGAIN if there is more to do, 0 if the task has finished,
+ *	-ve if it failed
+ */
+typedef int (*sched_func_t)(struct sched_task *task);
+
+/**
+ * struct sched_task - A long-running operation done in steps
+ *
+ * @node: Node in the list of running tasks
+ * @name: Name of the task, for debugging
+ * @func: Function to call for each step
+ * @ctx: Context for @func
+ * @period_us: Minimum time between steps, in microseconds
+ * @state: State of the task's state machine, starting at 0
+ * @next_us: Time when the next step is due, from timer_get_us()
+ * @ret: Result of the task once it has finished
+ * @calls: Number of steps taken so far
+ * @running: true if the task has been started and has not finished
+ * @round: Last call of sched_yield() which looked at this task
+ */
+struct sched_task {
+	struct list_head node;
+	const char *name;
+	sched_func_t func;
+	void *ctx;
+	ulong period_us;
+	int state;
+	u64 next_us;
+	int ret;
+	uint calls;
+	bool running;
+	uint round;
+};
+
+/**
+ * sched_task_init() - Set up a task, ready to start
+ *
+ * @task: Task to set up
+ * @name: Name of the task, for debugging
+ * @func: Function to call for each step
+ * @ctx: Context for @func
+ * @period_us: Minimum time between steps, in microseconds
+ */
+void sched_task_init(struct sched_task *task, const char *name,
+		     sched_func_t func, void *ctx, ulong period_us);
+
+/**
+ * sched_start() - Start running a task in the background
+ *
+ * The first step is taken straight away. If that does not finish the task,
+ * further steps are taken from sched_yield(), i.e. while U-Boot is waiting
+ * for something else. If CONFIG_SCHED is not enabled, the remaining steps
+ * are taken by sched_wait() instead.
+ *
+ * @task: Task to start, set up by sched_task_init()
+ * Return: 0 if OK, -EBUSY if the task is already running, -EPERM if called
+ *	before relocation
+ */
+int sched_start(struct sched_task *task);
+
+/**
+ * sched_wait() - Wait for a task to finish
+ *
+ * Other tasks carry on running while this waits
+ *
+ * @task: Task to wait for
+ * @timeout_ms: Maximum time to wait, in milliseconds
+ * Return: result of the task (0 if OK), or -ETIMEDOUT if it has not finished,
+ *	in which case it is left running
+ */
+int sched_wait(struct sched_task *task, ulong timeout_ms);
+
+/**
+ * sched_cancel() - Stop running a task
+ *
+ * The task function is not called again. It is up to the caller to tidy up
+ * anything the task was part-way through.
+ *
+ * @task: Task to stop, which need not be running
+ */
+void sched_cancel(struct sched_task *task);
+
+/**
+ * sched_done() - Check whether a task has finished
+ *
+ * @task: Task to check
+ * Return: true if it has finished (or was never started)
+ */
+static inline bool sched_done(const struct sched_task *task)
+{
+	return !task->running;
+}
+
+#if CONFIG_IS_ENABLED(SCHED)
+/**
+ * sched_yield() - Let background tasks run
+ *
+ * This takes one step of each running task which is due, in the order the
+ * tasks were started. It is called from udelay(), polling helpers and while
+ * waiting for console input, so should be called from any other place which
+ * spins waiting for something. It does nothing if called from a task.
+ */
+void sched_yield(void);
+
+/**
+ * sched_cancel_all() - Stop all tasks, e.g. before booting an OS
+ */
+void sched_cancel_all(void);
+#else
+static inline void sched_yield(void)
+{
+}
+
+static inline void sched_cancel_all(void)
+{
+}
+#endif
+
+#endif /* __SCHED_H */
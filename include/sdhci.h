@@ -20,6 +20,7 @@
  */
 
 #define SDHCI_DMA_ADDRESS	0x00
+#define SDHCI_32BIT_BLK_CNT	SDHCI_DMA_ADDRESS	/* v4 mode */
 
 #define SDHCI_BLOCK_SIZE	0x04
 #define  SDHCI_MAKE_BLKSZ(dma, blksz) (((dma & 0x7) << 12) | (blksz & 0xFFF))
@@ -284,19 +285,42 @@ struct sdhci_ops {
 	 * Return: 0 if successful, -ve on error
 	 */
 	int	(*set_enhanced_strobe)(struct sdhci_host *host);
+
+	/**
+	 * get_tuning() - Get the result of the last tuning
+	 *
+	 * @host: SDHCI host structure
+	 * @tuning: Returns the tuning parameters, MMC_TUNING_WORDS words
+	 * Return: 0 if successful, -ve on error
+	 */
+	int	(*get_tuning)(struct sdhci_host *host, u32 *tuning);
+
+	/**
+	 * set_tuning() - Restore the result of an earlier tuning
+	 *
+	 * @host: SDHCI host structure
+	 * @tuning: Tuning parameters from get_tuning()
+	 * Return: 0 if successful, -ve on error
+	 */
+	int	(*set_tuning)(struct sdhci_host *host, const u32 *tuning);
 };
 
 #define ADMA_MAX_LEN	65532
+/* Longest descriptor in the 26-bit length mode of version 4 hosts */
+#define ADMA_MAX_LEN_26BIT	(SZ_64M - 4)
 #ifdef CONFIG_DMA_ADDR_T_64BIT
 #define ADMA_DESC_LEN	16
 #else
 #define ADMA_DESC_LEN	8
 #endif
-#define ADMA_TABLE_NO_ENTRIES (CONFIG_SYS_MMC_MAX_BLK_COUNT * \
-			       MMC_MAX_BLOCK_LEN) / ADMA_MAX_LEN
+#define ADMA_TABLE_NO_ENTRIES DIV_ROUND_UP(CONFIG_SYS_MMC_MAX_BLK_COUNT * \
+					   MMC_MAX_BLOCK_LEN, ADMA_MAX_LEN)
 
 #define ADMA_TABLE_SZ (ADMA_TABLE_NO_ENTRIES * ADMA_DESC_LEN)
 
+/* Largest transfer for a host with a 32-bit block count (128MiB) */
+#define SDHCI_V4_MAX_BLK_COUNT	(SZ_128M / MMC_MAX_BLOCK_LEN)
+
 /* Decriptor table defines */
 #define ADMA_DESC_ATTR_VALID		BIT(0)
 #define ADMA_DESC_ATTR_END		BIT(1)
@@ -345,9 +369,16 @@ struct sdhci_host {
 #define USE_ADMA	(0x1 << 1)
 #define USE_ADMA64	(0x1 << 2)
 #define USE_DMA		(USE_SDMA | USE_ADMA | USE_ADMA64)
+/*
+ * Set by a driver before sdhci_setup_cfg() if it puts the host in version 4
+ * mode with these features enabled
+ */
+#define USE_ADMA_26BIT_LEN	(0x1 << 3)	/* ADMA2 26-bit length mode */
+#define USE_32BIT_BLK_CNT	(0x1 << 4)	/* 32-bit block count */
 	dma_addr_t adma_addr;
 #if CONFIG_IS_ENABLED(MMC_SDHCI_ADMA)
 	struct sdhci_adma_desc *adma_desc_table;
+	uint adma_max_len;	/* Longest transfer for one descriptor */
 #endif
 };
 
@@ -523,4 +554,27 @@ struct sdhci_adma_desc *sdhci_adma_init(void);
 void sdhci_prepare_adma_table(struct sdhci_adma_desc *table,
 			      struct mmc_data *data, dma_addr_t addr);
 
+/**
+ * sdhci_adma_alloc() - allocate an ADMA descriptor table
+ *
+ * @entries:	Number of descriptors
+ * Return: pointer to the table, or NULL if out of memory
+ */
+struct sdhci_adma_desc *sdhci_adma_alloc(uint entries);
+
+/**
+ * sdhci_prepare_adma_table_len() - populate the ADMA table
+ *
+ * This is sdhci_prepare_adma_table() for a host which can take longer
+ * descriptors, such as one in 26-bit length mode.
+ *
+ * @table:	Pointer to the ADMA table, large enough for the transfer
+ * @data:	Pointer to MMC data
+ * @addr:	DMA address to write to or read from
+ * @max_len:	Longest transfer for one descriptor, a multiple of 4
+ */
+void sdhci_prepare_adma_table_len(struct sdhci_adma_desc *table,
+				  struct mmc_data *data, dma_addr_t addr,
+				  uint max_len);
+
 #endif /* __SDHCI_HW_H */
@@ -292,6 +292,10 @@ struct dm_serial_ops {
  * @buf:	Pointer to the RX buffer
  * @rd_ptr:	Read pointer in the RX buffer
  * @wr_ptr:	Write pointer in the RX buffer
+ *
+ * @txbuf:	Pointer to the TX buffer, NULL if output is not buffered
+ * @tx_rd:	Read pointer in the TX buffer (next character to send)
+ * @tx_wr:	Write pointer in the TX buffer
  */
 struct serial_dev_priv {
 	struct stdio_dev *sdev;
@@ -299,6 +303,10 @@ struct serial_dev_priv {
 	char *buf;
 	int rd_ptr;
 	int wr_ptr;
+
+	char *txbuf;
+	uint tx_rd;
+	uint tx_wr;
 };
 
 /* Access the serial operations for a device */
@@ -337,6 +345,37 @@ int serial_setconfig(struct udevice *dev, uint config);
  */
 int serial_getinfo(struct udevice *dev, struct serial_device_info *info);
 
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+/**
+ * serial_dev_flush() - Write out all buffered output of a serial device
+ *
+ * This waits until the TX buffer is empty and, if the driver can tell, until
+ * the UART has finished sending. It must be called before anything which
+ * stops U-Boot from running, such as a reset or jumping to an OS.
+ *
+ * @dev: Device pointer
+ * Return: 0 if OK, -ENODEV if there is no device
+ */
+int serial_dev_flush(struct udevice *dev);
+
+/**
+ * serial_flush() - Write out all buffered output of the current console UART
+ *
+ * Return: 0 if OK, -ENODEV if there is no console UART
+ */
+int serial_flush(void);
+#else
+static inline int serial_dev_flush(struct udevice *dev)
+{
+	return 0;
+}
+
+static inline int serial_flush(void)
+{
+	return 0;
+}
+#endif
+
 void atmel_serial_initialize(void);
 void mcf_serial_initialize(void);
 void mpc85xx_serial_initialize(void);
@@ -517,6 +517,37 @@ const char *spl_board_loader_name(u32 boot_device);
  */
 void __noreturn jump_to_image_linux(struct spl_image_info *spl_image);
 
+/**
+ * spl_os_fdt() - Get the devicetree to pass to an OS started from SPL
+ *
+ * In Falcon mode the devicetree prepared by the 'spl prepare' command, with
+ * the kernel command line and fixups from U-Boot proper already applied, is
+ * loaded to CONFIG_SYS_SPL_ARGS_ADDR. This is used if valid, otherwise the
+ * devicetree loaded from the FIT.
+ *
+ * @spl_image: Image which was loaded
+ * Return: devicetree to use, or NULL if there is none
+ */
+void *spl_os_fdt(struct spl_image_info *spl_image);
+
+/**
+ * spl_load_os_args() - Load the devicetree prepared for Falcon mode
+ *
+ * This reads the devicetree saved by 'spl prepare' to
+ * CONFIG_SYS_SPL_ARGS_ADDR. Only the size given in its header is read. The
+ * devicetree must fit in @max_size and must end before
+ * CONFIG_SPL_LOAD_FIT_ADDRESS, where the FIT is loaded. If there is no
+ * valid devicetree, its header is cleared so that spl_os_fdt() uses the
+ * one from the FIT.
+ *
+ * @load: Information about the device to read from
+ * @sector: Sector where the devicetree starts
+ * @max_size: Size of the area holding the devicetree, in bytes
+ * Return: 0 if OK, -ENOENT if there is no devicetree, -E2BIG if it is too
+ *	large, -EIO on a read error
+ */
+int spl_load_os_args(struct spl_load_info *load, ulong sector, ulong max_size);
+
 /**
  * jump_to_image_linux() - Jump to OP-TEE OS from SPL
  *
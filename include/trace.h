@@ -28,6 +28,16 @@ enum {
 enum trace_chunk_type {
 	TRACE_CHUNK_FUNCS,
 	TRACE_CHUNK_CALLS,
+	TRACE_CHUNK_COUNTERS,
+};
+
+/* Hardware counters sampled on function entry/exit */
+enum trace_hw_counter {
+	TRACE_HW_CYCLES,	/* CPU cycles (or nanoseconds on sandbox) */
+	TRACE_HW_INSTRET,	/* Instructions retired */
+	TRACE_HW_EVENT,		/* Implementation-defined event, e.g. misses */
+
+	TRACE_HW_COUNT,
 };
 
 /* A trace record for a function, as written to the profile output file */
@@ -36,6 +46,14 @@ struct trace_output_func {
 	uint32_t call_count;		/* Number of times called */
 };
 
+/* Per-function hardware counter totals, as written to the profile file */
+struct trace_output_counters {
+	uint32_t offset;		/* Function offset into code */
+	uint32_t call_count;		/* Number of completed calls */
+	uint64_t self[TRACE_HW_COUNT];	/* Counts excluding callees */
+	uint64_t total[TRACE_HW_COUNT];	/* Counts including callees */
+};
+
 /* A header at the start of the trace output buffer */
 struct trace_output_hdr {
 	enum trace_chunk_type type;	/* Record type */
@@ -79,6 +97,47 @@ struct trace_call {
 
 int trace_list_calls(void *buff, size_t buff_size, size_t *needed);
 
+/**
+ * trace_list_counters() - dump per-function hardware counter totals
+ *
+ * Each record in the buffer is a struct trace_output_counters. This behaves
+ * in the same way as trace_list_functions().
+ *
+ * @buff:	Buffer in which to place data, or NULL to count size
+ * @buff_size:	Size of buffer
+ * @needed:	Returns number of bytes used / needed
+ * Return: 0 if ok, -ENOSPC if the buffer is exhausted, -ENOSYS if hardware
+ * counters are not enabled
+ */
+int trace_list_counters(void *buff, size_t buff_size, size_t *needed);
+
+/**
+ * trace_print_counters() - print the functions with the highest self counts
+ *
+ * @counter:	Counter to sort by (enum trace_hw_counter)
+ * @count:	Maximum number of functions to show
+ */
+void trace_print_counters(enum trace_hw_counter counter, int count);
+
+/**
+ * trace_hw_read() - read the hardware counters
+ *
+ * This is provided by the architecture when CONFIG_TRACE_HW_COUNTERS is
+ * enabled. It is called on every traced function entry and exit, so must be
+ * cheap and must not itself be instrumented.
+ *
+ * @vals:	Returns the current value of each counter
+ */
+void trace_hw_read(uint64_t vals[TRACE_HW_COUNT]);
+
+/**
+ * trace_hw_start() - prepare the hardware counters for use
+ *
+ * This is provided by the architecture and is called once when tracing is
+ * initialised, e.g. to select the event to count.
+ */
+void trace_hw_start(void);
+
 /**
  * Turn function tracing on and off
  *
@@ -180,8 +180,32 @@ int usb_reset_root_port(struct usb_device *dev);
 #define usb_reset_root_port(dev)
 #endif
 
+/**
+ * struct usb_bulk_req - A bulk transfer queued with others
+ *
+ * @pipe:	Pipe to use, as for submit_bulk_msg()
+ * @buffer:	Buffer to send from or receive into. This should be DMA-aligned
+ * @length:	Number of bytes to transfer
+ * @act_len:	Returns the number of bytes actually transferred
+ * @status:	Returns the USB_ST_... status of the transfer, which is
+ *		USB_ST_NOT_PROC if it was not carried out
+ * @stream:	Stream to use, if set up with usb_alloc_streams(), else 0
+ * @hcpriv:	For use by the host controller driver
+ */
+struct usb_bulk_req {
+	unsigned long pipe;
+	void *buffer;
+	int length;
+	int act_len;
+	unsigned long status;
+	int stream;
+	void *hcpriv;
+};
+
 int submit_bulk_msg(struct usb_device *dev, unsigned long pipe,
 			void *buffer, int transfer_len);
+int submit_bulk_msgs(struct usb_device *dev, struct usb_bulk_req *reqs,
+		     int count);
 int submit_control_msg(struct usb_device *dev, unsigned long pipe, void *buffer,
 			int transfer_len, struct devrequest *setup);
 int submit_int_msg(struct usb_device *dev, unsigned long pipe, void *buffer,
@@ -268,6 +292,25 @@ int usb_control_msg(struct usb_device *dev, unsigned int pipe,
 			void *data, unsigned short size, int timeout);
 int usb_bulk_msg(struct usb_device *dev, unsigned int pipe,
 			void *data, int len, int *actual_length, int timeout);
+
+/**
+ * usb_bulk_msgs() - Carry out several bulk transfers together
+ *
+ * The transfers are handed to the host controller at once, where it supports
+ * this, so that it can run them back to back. Transfers on the same endpoint
+ * are carried out in order. Once one transfer fails, those after it may not
+ * be carried out. Host controllers which cannot queue transfers run them one
+ * at a time.
+ *
+ * @dev:	USB device to talk to
+ * @reqs:	Transfers to carry out
+ * @count:	Number of transfers in @reqs
+ * @timeout:	Timeout for each transfer in milliseconds
+ * Return: 0 if all transfers completed, -EIO if one failed (see the @status
+ *	of each), other -ve value on error
+ */
+int usb_bulk_msgs(struct usb_device *dev, struct usb_bulk_req *reqs, int count,
+		  int timeout);
 int usb_int_msg(struct usb_device *dev, unsigned long pipe,
 		void *buffer, int transfer_len, int interval, bool nonblock);
 int usb_lock_async(struct usb_device *dev, int lock);
@@ -707,6 +750,48 @@ struct dm_usb_ops {
 	 */
 	int (*bulk)(struct udevice *bus, struct usb_device *udev,
 		    unsigned long pipe, void *buffer, int length);
+	/**
+	 * bulk_queue() - Queue several bulk messages and wait for them all
+	 *
+	 * Transfers on the same endpoint must be carried out in the order
+	 * given. If one fails, any after it on that endpoint are dropped.
+	 * Each transfer's act_len and status are updated as for bulk().
+	 *
+	 * @reqs: Transfers to carry out
+	 * @count: Number of transfers in @reqs
+	 *
+	 * @return 0 if the transfers were processed, -ENOSPC if there is not
+	 *	   room to queue them all at once, other -ve value on error
+	 */
+	int (*bulk_queue)(struct udevice *bus, struct usb_device *udev,
+			  struct usb_bulk_req *reqs, int count);
+	/**
+	 * alloc_streams() - Set up bulk streams on some endpoints (USB 3.0)
+	 *
+	 * This is done together for all the endpoints which use streams,
+	 * after the device is configured. Each stream has its own queue of
+	 * transfers, which the device picks between.
+	 *
+	 * @pipes: Pipes of the endpoints to set up
+	 * @num_pipes: Number of pipes in @pipes
+	 * @num_streams: Number of streams wanted on each endpoint, not
+	 *	counting stream 0 which is reserved
+	 *
+	 * @return number of streams set up on each endpoint, which may be
+	 *	   fewer than @num_streams, -EBUSY if one of the endpoints
+	 *	   already has streams (nothing is changed), other -ve value on
+	 *	   error
+	 */
+	int (*alloc_streams)(struct udevice *bus, struct usb_device *udev,
+			     unsigned long *pipes, int num_pipes,
+			     int num_streams);
+	/**
+	 * free_streams() - Stop using streams on some endpoints
+	 *
+	 * Most parameters are as above.
+	 */
+	int (*free_streams)(struct udevice *bus, struct usb_device *udev,
+			    unsigned long *pipes, int num_pipes);
 	/**
 	 * interrupt() - Send an interrupt message
 	 *
@@ -852,6 +937,25 @@ bool usb_hub_is_root_hub(struct udevice *hub);
  */
 int usb_hub_scan(struct udevice *hub);
 
+/**
+ * usb_hub_defer_scan() - Queue hub ports rather than scanning them at once
+ *
+ * Hubs configured after this only power their ports and add them to the
+ * scanning list. This lets the ports of several controllers come up
+ * together, rather than waiting for each controller in turn.
+ */
+void usb_hub_defer_scan(void);
+
+/**
+ * usb_hub_run_scan() - Scan all queued hub ports
+ *
+ * This ends the deferral started by usb_hub_defer_scan() and scans the ports
+ * until each one has a device set up or has timed out.
+ *
+ * Return: 0 if OK, -ve on error
+ */
+int usb_hub_run_scan(void);
+
 /**
  * usb_scan_device() - Scan a device on a bus
  *
@@ -1007,6 +1111,35 @@ int usb_update_hub_device(struct usb_device *dev);
  */
 int usb_get_max_xfer_size(struct usb_device *dev, size_t *size);
 
+/**
+ * usb_alloc_streams() - Set up bulk streams on some endpoints of a device
+ *
+ * Transfers on the endpoints can then be put on a stream by setting the
+ * stream member of struct usb_bulk_req and calling usb_bulk_msgs().
+ *
+ * @dev:		USB device
+ * @pipes:		Pipes of the endpoints to set up
+ * @num_pipes:		Number of pipes
+ * @num_streams:	Number of streams wanted on each endpoint, not counting
+ *			stream 0 which is reserved
+ * Return: number of streams set up on each endpoint, which may be fewer than
+ * requested, -ENOSYS if the controller does not support streams, other -ve
+ * on error
+ */
+int usb_alloc_streams(struct usb_device *dev, unsigned long *pipes,
+		      int num_pipes, int num_streams);
+
+/**
+ * usb_free_streams() - Stop using bulk streams on some endpoints of a device
+ *
+ * @dev:		USB device
+ * @pipes:		Pipes of the endpoints, as passed to usb_alloc_streams()
+ * @num_pipes:		Number of pipes
+ * Return: 0 if OK, -ve on error
+ */
+int usb_free_streams(struct usb_device *dev, unsigned long *pipes,
+		     int num_pipes);
+
 /**
  * usb_emul_setup_device() - Set up a new USB device emulation
  *
@@ -1047,6 +1180,18 @@ int usb_emul_control(struct udevice *emul, struct usb_device *udev,
 int usb_emul_bulk(struct udevice *emul, struct usb_device *udev,
 		  unsigned long pipe, void *buffer, int length);
 
+/**
+ * usb_emul_bulk_queue() - Send several bulk packets to an emulator at once
+ *
+ * @emul:	Emulator device
+ * @udev:	USB device (which the emulator is causing to appear)
+ * See struct dm_usb_ops for details on other parameters
+ * Return: 0 if the transfers were processed, -ENOSYS if the emulator cannot
+ * queue them, other -ve on error
+ */
+int usb_emul_bulk_queue(struct udevice *emul, struct usb_device *udev,
+			struct usb_bulk_req *reqs, int count);
+
 /**
  * usb_emul_int() - Send an interrupt packet to an emulator
  *
@@ -0,0 +1,218 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * USB Attached SCSI (UAS) protocol
+ *
+ * Information units are as in the Linux kernel's include/linux/usb/uas.h
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#ifndef __USB_UAS_H
+#define __USB_UAS_H
+
+#include <blk.h>
+#include <linux/types.h>
+
+struct scsi_cmd;
+struct usb_device;
+struct usb_uas;
+
+/* Information unit IDs */
+enum {
+	UAS_IU_ID_COMMAND	= 0x01,
+	UAS_IU_ID_STATUS	= 0x03,
+	UAS_IU_ID_RESPONSE	= 0x04,
+	UAS_IU_ID_TASK_MGMT	= 0x05,
+	UAS_IU_ID_READ_READY	= 0x06,
+	UAS_IU_ID_WRITE_READY	= 0x07,
+};
+
+/* Pipe IDs, from the pipe usage descriptor after each endpoint */
+enum {
+	UAS_PIPE_ID_CMD		= 1,
+	UAS_PIPE_ID_STATUS	= 2,
+	UAS_PIPE_ID_DATA_IN	= 3,
+	UAS_PIPE_ID_DATA_OUT	= 4,
+};
+
+/* Response codes in a response IU */
+enum {
+	UAS_RC_TMF_COMPLETE	= 0x00,
+	UAS_RC_INVALID_IU	= 0x02,
+	UAS_RC_TMF_NOT_SUPPORTED = 0x04,
+	UAS_RC_TMF_FAILED	= 0x05,
+	UAS_RC_TMF_SUCCEEDED	= 0x08,
+	UAS_RC_INCORRECT_LUN	= 0x09,
+	UAS_RC_OVERLAPPED_TAG	= 0x0a,
+};
+
+/**
+ * struct uas_iu_header - Start of every information unit
+ *
+ * @iu_id: Information unit ID (UAS_IU_ID_...)
+ * @rsvd1: Reserved
+ * @tag: Tag of the command this is for, starting at 1
+ */
+struct uas_iu_header {
+	u8 iu_id;
+	u8 rsvd1;
+	__be16 tag;
+} __packed;
+
+/**
+ * struct uas_cmd_iu - Command information unit, sent on the command pipe
+ *
+ * @iu_id: UAS_IU_ID_COMMAND
+ * @rsvd1: Reserved
+ * @tag: Tag of the command
+ * @prio_attr: Priority and task attribute, 0 for a simple task
+ * @rsvd5: Reserved
+ * @len: Length of the CDB beyond 16 bytes, in units of four bytes
+ * @rsvd7: Reserved
+ * @lun: Logical unit number, in SAM format
+ * @cdb: SCSI command descriptor block
+ */
+struct uas_cmd_iu {
+	u8 iu_id;
+	u8 rsvd1;
+	__be16 tag;
+	u8 prio_attr;
+	u8 rsvd5;
+	u8 len;
+	u8 rsvd7;
+	u8 lun[8];
+	u8 cdb[16];
+} __packed;
+
+/**
+ * struct uas_sense_iu - Sense information unit, ending a command
+ *
+ * @iu_id: UAS_IU_ID_STATUS
+ * @rsvd1: Reserved
+ * @tag: Tag of the command
+ * @status_qual: Status qualifier
+ * @status: SCSI status of the command
+ * @rsvd7: Reserved
+ * @len: Number of bytes of sense data
+ * @sense: Sense data, if the status is CHECK CONDITION
+ */
+struct uas_sense_iu {
+	u8 iu_id;
+	u8 rsvd1;
+	__be16 tag;
+	__be16 status_qual;
+	u8 status;
+	u8 rsvd7[7];
+	__be16 len;
+	u8 sense[96];
+} __packed;
+
+/**
+ * struct uas_response_iu - Response information unit, rejecting an IU
+ *
+ * @iu_id: UAS_IU_ID_RESPONSE
+ * @rsvd1: Reserved
+ * @tag: Tag of the IU being responded to
+ * @add_response_info: Additional response information
+ * @response_code: Response code (UAS_RC_...)
+ */
+struct uas_response_iu {
+	u8 iu_id;
+	u8 rsvd1;
+	__be16 tag;
+	u8 add_response_info[3];
+	u8 response_code;
+} __packed;
+
+/**
+ * struct usb_pipe_usage_descriptor - Says which UAS pipe an endpoint is
+ *
+ * This follows the endpoint descriptor (and any SuperSpeed companion) of
+ * each endpoint of the UAS alternate setting.
+ *
+ * @bLength: Size of the descriptor (4)
+ * @bDescriptorType: USB_DT_PIPE_USAGE
+ * @bPipeID: UAS_PIPE_ID_...
+ * @Reserved: Reserved
+ */
+struct usb_pipe_usage_descriptor {
+	u8 bLength;
+	u8 bDescriptorType;
+	u8 bPipeID;
+	u8 Reserved;
+} __packed;
+
+/**
+ * usb_uas_probe() - Switch a mass-storage interface over to UAS
+ *
+ * This looks for an alternate setting of the interface using the UAS
+ * protocol, selects it and sets up streams on its pipes if the device is
+ * SuperSpeed. The device is left using Bulk-Only Transport if this fails.
+ *
+ * @udev: USB device
+ * @ifnum: Interface number
+ * @uasp: Returns the UAS state, to pass to the other functions
+ * Return: 0 if OK, -ENOENT if the interface has no UAS setting, -ENOSYS if
+ * the host controller cannot provide what UAS needs, other -ve on error
+ */
+int usb_uas_probe(struct usb_device *udev, int ifnum, struct usb_uas **uasp);
+
+/**
+ * usb_uas_stop() - Go back to Bulk-Only Transport
+ *
+ * This frees any streams, selects alternate setting 0 and frees @uas
+ *
+ * @uas: UAS state
+ */
+void usb_uas_stop(struct usb_uas *uas);
+
+/**
+ * usb_uas_free() - Free UAS state without talking to the device
+ *
+ * This is used when the device is going away
+ *
+ * @uas: UAS state, or NULL
+ */
+void usb_uas_free(struct usb_uas *uas);
+
+/**
+ * usb_uas_command() - Carry out a single SCSI command
+ *
+ * @uas: UAS state
+ * @srb: Command to carry out, with its data buffer. On a CHECK CONDITION
+ *	status the sense data is copied into @srb->sense_buf
+ * @write: true if data goes to the device, false if it comes from it
+ * Return: 0 if OK, -EREMOTEIO if the device gave a status other than GOOD,
+ * other -ve on error
+ */
+int usb_uas_command(struct usb_uas *uas, struct scsi_cmd *srb, bool write);
+
+/**
+ * usb_uas_rw() - Read or write blocks with several commands in flight
+ *
+ * The blocks are split into READ(10) or WRITE(10) commands of up to
+ * @max_blks each, which are handed to the device together, up to the queue
+ * depth at a time.
+ *
+ * @uas: UAS state
+ * @lun: Logical unit to access
+ * @write: true to write, false to read
+ * @start: First block
+ * @blkcnt: Number of blocks
+ * @blksz: Size of each block in bytes
+ * @max_blks: Maximum number of blocks for one command
+ * @buffer: Data to write or buffer to read into
+ * Return: number of blocks transferred from @start before the first error
+ */
+lbaint_t usb_uas_rw(struct usb_uas *uas, int lun, bool write, lbaint_t start,
+		    lbaint_t blkcnt, uint blksz, uint max_blks, void *buffer);
+
+/**
+ * usb_uas_reset() - Recover the pipes after an error
+ *
+ * @uas: UAS state
+ * Return: 0 if OK, -ve on error
+ */
+int usb_uas_reset(struct usb_uas *uas);
+
+#endif /* __USB_UAS_H */
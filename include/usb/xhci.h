@@ -662,6 +662,23 @@ struct xhci_ep_ctx {
 
 /* deq bitmasks */
 #define EP_CTX_CYCLE_MASK		(1 << 0)
+/* Stream Context Type - bits 3:1 of a stream context's dequeue pointer */
+#define SCT_FOR_CTX(p)			(((p) & 0x7) << 1)
+/* Primary stream array, the dequeue pointer is to a transfer ring */
+#define SCT_PRI_TR			1
+
+/**
+ * struct xhci_stream_ctx
+ * Stream context (section 6.2.4.1), one for each stream of an endpoint
+ *
+ * @stream_ring: dequeue pointer of the stream's transfer ring, with the
+ *	Stream Context Type and the Dequeue Cycle State in the low bits
+ */
+struct xhci_stream_ctx {
+	__le64	stream_ring;
+	/* offset 0x8 - 0xf reserved for HC internal use */
+	__le32	reserved[2];
+};
 
 /* reserved[0] bitmasks, MediaTek xHCI used */
 #define EP_BPKTS(p)	(((p) & 0x7f) << 0)
@@ -897,6 +914,8 @@ union xhci_trb {
 
 /* TRB type IDs */
 typedef enum {
+	/* not a TRB type: any event, for xhci_wait_for_event() */
+	TRB_NONE = 0,
 	/* bulk, interrupt, isoc scatter/gather, and control data stage */
 	TRB_NORMAL = 1,
 	/* setup stage for control transfers */
@@ -1060,6 +1079,11 @@ struct xhci_virt_ep {
 #define EP_HAS_STREAMS		(1 << 4)
 /* Transitioning the endpoint to not using streams, don't enqueue URBs */
 #define EP_GETTING_NO_STREAMS	(1 << 5)
+	/* Stream context array and a ring for each stream, if EP_HAS_STREAMS */
+	struct xhci_stream_ctx		*stream_ctx;
+	struct xhci_ring		**stream_rings;
+	/* Number of entries in the arrays, including the reserved stream 0 */
+	unsigned int			num_streams;
 };
 
 #define CTX_SIZE(_hcc) (HCC_64BYTE_CONTEXT(_hcc) ? 64 : 32)
@@ -1247,6 +1271,8 @@ void xhci_queue_command(struct xhci_ctrl *ctrl, u8 *ptr,
 			u32 slot_id, u32 ep_index, trb_type cmd);
 void xhci_acknowledge_event(struct xhci_ctrl *ctrl);
 union xhci_trb *xhci_wait_for_event(struct xhci_ctrl *ctrl, trb_type expected);
+int xhci_bulk_tx_queue(struct usb_device *udev, struct usb_bulk_req *reqs,
+		       int count);
 int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 		 int length, void *buffer);
 int xhci_ctrl_tx(struct usb_device *udev, unsigned long pipe,
@@ -1258,6 +1284,9 @@ void xhci_cleanup(struct xhci_ctrl *ctrl);
 struct xhci_ring *xhci_ring_alloc(struct xhci_ctrl *ctrl, unsigned int num_segs,
 				  bool link_trbs);
 int xhci_alloc_virt_device(struct xhci_ctrl *ctrl, unsigned int slot_id);
+void xhci_alloc_stream_rings(struct xhci_ctrl *ctrl, struct xhci_virt_ep *ep,
+			     unsigned int num_streams);
+void xhci_free_stream_rings(struct xhci_virt_ep *ep);
 int xhci_mem_init(struct xhci_ctrl *ctrl, struct xhci_hccr *hccr,
 		  struct xhci_hcor *hcor);
 
@@ -63,6 +63,8 @@ struct vring_desc_shadow {
 	u16 next;
 	/* Metadata about the descriptor. */
 	bool chain_head;
+	/* Indirect descriptor table of a chain head, or NULL */
+	struct vring_desc *indir;
 };
 
 struct vring_avail {
@@ -115,6 +117,7 @@ struct virtqueue {
 	struct vring vring;
 	struct vring_desc_shadow *vring_desc_shadow;
 	bool event;
+	bool indirect;
 	unsigned int free_head;
 	unsigned int num_added;
 	u16 last_used_idx;
@@ -185,6 +188,10 @@ struct virtio_sg;
  * Caller must ensure we don't call this with other virtqueue operations
  * at the same time (except where noted).
  *
+ * If the device supports indirect descriptors, a request with more than one
+ * scatterlist is put in a separate descriptor table and takes only one entry
+ * in the ring.
+ *
  * Returns zero or a negative error (ie. ENOSPC, ENOMEM, EIO).
  */
 int virtqueue_add(struct virtqueue *vq, struct virtio_sg *sgs[],
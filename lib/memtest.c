@@ -0,0 +1,329 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Parallel memory test engine
+ *
+ * The memory under test is split into regions which all available CPUs take
+ * from a shared queue, so that a pass over memory runs at the combined
+ * bandwidth of the CPUs rather than that of the boot CPU alone. Accesses are
+ * 64 bits wide, optionally in bursts of a whole cache line.
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#include <common.h>
+#include <cpu_func.h>
+#include <div64.h>
+#include <memtest.h>
+#include <time.h>
+#include <watchdog.h>
+#include <asm/cache.h>
+#include <linux/kernel.h>
+#include <linux/sizes.h>
+
+/* Smallest region handed to a CPU */
+#define MEMTEST_MIN_REGION	SZ_4K
+
+/* Words in a cache-line burst */
+#define MEMTEST_LINE_WORDS	8
+
+static const char *const pattern_name[MEMTEST_PATTERN_COUNT] = {
+	[MEMTEST_ADDR]		= "addr",
+	[MEMTEST_WALK_ONES]	= "walk1",
+	[MEMTEST_WALK_ZEROS]	= "walk0",
+	[MEMTEST_MOVINV]	= "movinv",
+	[MEMTEST_RANDOM]	= "random",
+};
+
+/* Number of passes over memory for each pattern */
+static const u8 pattern_passes[MEMTEST_PATTERN_COUNT] = {
+	[MEMTEST_ADDR]		= 2,
+	[MEMTEST_WALK_ONES]	= 2,
+	[MEMTEST_WALK_ZEROS]	= 2,
+	[MEMTEST_MOVINV]	= 3,
+	[MEMTEST_RANDOM]	= 2,
+};
+
+/**
+ * struct memtest_job - one pass over memory
+ *
+ * @mt:		Test being run
+ * @pat:	Pattern
+ * @pass:	Pass number within the pattern
+ * @next:	Index of the next region to hand out
+ */
+struct memtest_job {
+	struct memtest *mt;
+	enum memtest_pattern_t pat;
+	int pass;
+	uint next;
+};
+
+const char *memtest_pattern_name(enum memtest_pattern_t pat)
+{
+	if (pat >= MEMTEST_PATTERN_COUNT)
+		return "?";
+
+	return pattern_name[pat];
+}
+
+ulong memtest_mbps(u64 bytes, ulong time_us)
+{
+	if (!time_us)
+		return 0;
+
+	return lldiv(bytes, time_us);
+}
+
+static inline u64 splitmix64(u64 x)
+{
+	x += 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+
+	return x ^ (x >> 31);
+}
+
+/* The value of word @idx for a pattern; MEMTEST_MOVINV starts as @pattern */
+static __always_inline u64 memtest_value(const struct memtest *mt,
+					 enum memtest_pattern_t pat, ulong idx)
+{
+	switch (pat) {
+	case MEMTEST_ADDR:
+		return (u64)mt->addr + (u64)idx * sizeof(u64);
+	case MEMTEST_WALK_ONES:
+		return 1ULL << (idx & 63);
+	case MEMTEST_WALK_ZEROS:
+		return ~(1ULL << (idx & 63));
+	case MEMTEST_RANDOM:
+		return splitmix64(mt->seed + idx);
+	default:
+		return mt->pattern;
+	}
+}
+
+static void memtest_error(const struct memtest *mt, struct memtest_region *rg,
+			  ulong idx, u64 expect, u64 actual)
+{
+	ulong offset = idx * sizeof(u64);
+	ulong block = DIV_ROUND_UP(rg->size, MEMTEST_MAP_BITS);
+
+	if (!rg->errors++) {
+		rg->first_addr = mt->addr + offset;
+		rg->expect = expect;
+		rg->actual = actual;
+	}
+	rg->map |= 1ULL << ((offset - rg->addr) / block);
+}
+
+static __always_inline void memtest_fill(const struct memtest *mt,
+					 enum memtest_pattern_t pat,
+					 ulong first, ulong count)
+{
+	volatile u64 *ptr = mt->buf;
+	ulong idx = first, end = first + count;
+	int i;
+
+	if (mt->lines) {
+		for (; idx + MEMTEST_LINE_WORDS <= end;
+		     idx += MEMTEST_LINE_WORDS) {
+			for (i = 0; i < MEMTEST_LINE_WORDS; i++)
+				ptr[idx + i] = memtest_value(mt, pat, idx + i);
+		}
+	}
+	for (; idx < end; idx++)
+		ptr[idx] = memtest_value(mt, pat, idx);
+}
+
+static __always_inline void memtest_check(const struct memtest *mt,
+					  struct memtest_region *rg,
+					  enum memtest_pattern_t pat,
+					  ulong first, ulong count)
+{
+	volatile u64 *ptr = mt->buf;
+	ulong idx = first, end = first + count;
+	u64 val, diff;
+	int i;
+
+	if (mt->lines) {
+		u64 line[MEMTEST_LINE_WORDS];
+
+		for (; idx + MEMTEST_LINE_WORDS <= end;
+		     idx += MEMTEST_LINE_WORDS) {
+			for (i = 0; i < MEMTEST_LINE_WORDS; i++)
+				line[i] = ptr[idx + i];
+			for (diff = 0, i = 0; i < MEMTEST_LINE_WORDS; i++)
+				diff |= line[i] ^ memtest_value(mt, pat, idx + i);
+			if (!diff)
+				continue;
+			for (i = 0; i < MEMTEST_LINE_WORDS; i++) {
+				val = memtest_value(mt, pat, idx + i);
+				if (line[i] != val)
+					memtest_error(mt, rg, idx + i, val,
+						      line[i]);
+			}
+		}
+	}
+	for (; idx < end; idx++) {
+		val = memtest_value(mt, pat, idx);
+		if (ptr[idx] != val)
+			memtest_error(mt, rg, idx, val, ptr[idx]);
+	}
+}
+
+/*
+ * One half of a moving-inversions pass: check each word holds @expect and
+ * replace it with its inverse, going up through memory, or down if @down
+ */
+static void memtest_movinv(const struct memtest *mt, struct memtest_region *rg,
+			   ulong first, ulong count, u64 expect, bool down)
+{
+	volatile u64 *ptr = mt->buf;
+	ulong i, idx;
+	u64 val;
+
+	for (i = 0; i < count; i++) {
+		idx = down ? first + count - 1 - i : first + i;
+		val = ptr[idx];
+		ptr[idx] = ~expect;
+		if (val != expect)
+			memtest_error(mt, rg, idx, expect, val);
+	}
+}
+
+static void memtest_do_region(struct memtest_job *job,
+			      struct memtest_region *rg)
+{
+	struct memtest *mt = job->mt;
+	ulong first = rg->addr / sizeof(u64);
+	ulong count = rg->size / sizeof(u64);
+
+	/* Each case is expanded separately so the pattern is a constant */
+#define MEMTEST_CASE(_pat) \
+	case _pat: \
+		if (job->pass) \
+			memtest_check(mt, rg, _pat, first, count); \
+		else \
+			memtest_fill(mt, _pat, first, count); \
+		break
+
+	switch (job->pat) {
+	MEMTEST_CASE(MEMTEST_ADDR);
+	MEMTEST_CASE(MEMTEST_WALK_ONES);
+	MEMTEST_CASE(MEMTEST_WALK_ZEROS);
+	MEMTEST_CASE(MEMTEST_RANDOM);
+	case MEMTEST_MOVINV:
+		if (!job->pass)
+			memtest_fill(mt, MEMTEST_MOVINV, first, count);
+		else if (job->pass == 1)
+			memtest_movinv(mt, rg, first, count, mt->pattern, false);
+		else
+			memtest_movinv(mt, rg, first, count, ~mt->pattern, true);
+		break;
+	default:
+		break;
+	}
+#undef MEMTEST_CASE
+}
+
+static void memtest_worker(void *ctx, int cpu)
+{
+	struct memtest_job *job = ctx;
+	struct memtest *mt = job->mt;
+	uint idx;
+
+	while (1) {
+		idx = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+		if (idx >= mt->num_regions)
+			break;
+		memtest_do_region(job, &mt->region[idx]);
+		if (!cpu)
+			WATCHDOG_RESET();
+	}
+}
+
+static void memtest_split(struct memtest *mt)
+{
+	ulong size, each;
+	uint i, count;
+
+	count = clamp(mt->size / MEMTEST_MIN_REGION, 1UL,
+		      (ulong)MEMTEST_MAX_REGIONS);
+	each = ALIGN_DOWN(mt->size / count, MEMTEST_LINE_WORDS * sizeof(u64));
+	if (!each) {
+		count = 1;
+		each = mt->size;
+	}
+	for (i = 0, size = 0; i < count; i++, size += each) {
+		struct memtest_region *rg = &mt->region[i];
+
+		memset(rg, '\0', sizeof(*rg));
+		rg->addr = size;
+		rg->size = i == count - 1 ? mt->size - size : each;
+	}
+	mt->num_regions = count;
+}
+
+int memtest_run(struct memtest *mt)
+{
+	struct memtest_job job;
+	ulong start, buf, end;
+	uint i, cpus;
+	int pat, pass, ret;
+
+	mt->size = ALIGN_DOWN(mt->size, sizeof(u64));
+	if (!mt->size || ((ulong)mt->buf & (sizeof(u64) - 1)) ||
+	    !(mt->patterns & MEMTEST_ALL))
+		return -EINVAL;
+
+	memtest_split(mt);
+	cpus = arch_memtest_cpus();
+	if (mt->max_cpus)
+		cpus = min(cpus, mt->max_cpus);
+	mt->num_cpus = clamp(cpus, 1U, mt->num_regions);
+	mt->errors = 0;
+	memset(mt->stats, '\0', sizeof(mt->stats));
+
+	buf = ALIGN_DOWN((ulong)mt->buf, ARCH_DMA_MINALIGN);
+	end = ALIGN((ulong)mt->buf + mt->size, ARCH_DMA_MINALIGN);
+	job.mt = mt;
+	for (pat = 0; pat < MEMTEST_PATTERN_COUNT; pat++) {
+		if (!(mt->patterns & BIT(pat)))
+			continue;
+		job.pat = pat;
+		for (pass = 0; pass < pattern_passes[pat]; pass++) {
+			if (mt->step && mt->step(mt, pat, pass))
+				return -EINTR;
+			job.pass = pass;
+			job.next = 0;
+			start = timer_get_us();
+			ret = arch_memtest_run(memtest_worker, &job,
+					       mt->num_cpus);
+			if (ret)
+				return ret;
+
+			/* Make sure the next pass reads from memory */
+			flush_dcache_range(buf, end);
+			mt->stats[pat].time_us += timer_get_us() - start;
+			mt->stats[pat].bytes += mt->size;
+			if (pat == MEMTEST_MOVINV && pass)
+				mt->stats[pat].bytes += mt->size;
+		}
+	}
+	for (i = 0; i < mt->num_regions; i++)
+		mt->errors += mt->region[i].errors;
+
+	return 0;
+}
+
+__weak uint arch_memtest_cpus(void)
+{
+	return 1;
+}
+
+__weak int arch_memtest_run(void (*func)(void *ctx, int cpu), void *ctx,
+			    uint cpus)
+{
+	func(ctx, 0);
+
+	return 0;
+}
@@ -14,6 +14,7 @@
 #if !defined(CONFIG_PANIC_HANG)
 #include <command.h>
 #endif
+#include <serial.h>
 #include <linux/delay.h>
 
 static void panic_finish(void) __attribute__ ((noreturn));
@@ -21,6 +22,7 @@ static void panic_finish(void) __attribute__ ((noreturn));
 static void panic_finish(void)
 {
 	putc('\n');
+	serial_flush();
 #if defined(CONFIG_PANIC_HANG)
 	hang();
 #else
@@ -0,0 +1,221 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Sampling profiler
+ *
+ * A periodic timer interrupt records the interrupted program counter. The
+ * samples are only interpreted when a report is requested, so the cost
+ * while sampling is a store and an increment per tick.
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#define LOG_CATEGORY LOGC_NONE
+
+#include <common.h>
+#include <kallsyms.h>
+#include <log.h>
+#include <malloc.h>
+#include <prof.h>
+#include <sort.h>
+#include <asm/global_data.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/**
+ * struct prof_entry - total for one function (or address) in a report
+ *
+ * @addr:	Link-time address of the function, or the sample address
+ * @name:	Function name, or NULL if not known
+ * @count:	Number of samples
+ */
+struct prof_entry {
+	ulong addr;
+	const char *name;
+	uint count;
+};
+
+/* Sampler state; samples are link-time addresses */
+static struct {
+	ulong *samples;
+	uint count;
+	uint size;
+	ulong dropped;
+	bool running;
+} prof;
+
+void notrace prof_sample(ulong pc)
+{
+	if (!prof.running)
+		return;
+
+	/* Record link-time addresses, so they match System.map */
+	if (IS_ENABLED(CONFIG_SANDBOX) || (gd->flags & GD_FLG_RELOC))
+		pc -= gd->reloc_off;
+	if (prof.count < prof.size)
+		prof.samples[prof.count++] = pc;
+	else
+		prof.dropped++;
+}
+
+int prof_start(void)
+{
+	int ret;
+
+	if (prof.running)
+		return -EALREADY;
+	if (!prof.samples) {
+		prof.samples = malloc(CONFIG_PROFILER_SAMPLES *
+				      sizeof(*prof.samples));
+		if (!prof.samples)
+			return -ENOMEM;
+		prof.size = CONFIG_PROFILER_SAMPLES;
+	}
+
+	prof.running = true;
+	ret = arch_prof_start(CONFIG_PROFILER_HZ);
+	if (ret) {
+		prof.running = false;
+		return log_msg_ret("arch", ret);
+	}
+
+	return 0;
+}
+
+void prof_stop(void)
+{
+	if (!prof.running)
+		return;
+	arch_prof_stop();
+	prof.running = false;
+}
+
+void prof_reset(void)
+{
+	prof.count = 0;
+	prof.dropped = 0;
+}
+
+void prof_get_stats(struct prof_stats *stats)
+{
+	stats->running = prof.running;
+	stats->hz = CONFIG_PROFILER_HZ;
+	stats->count = prof.count;
+	stats->size = prof.size;
+	stats->dropped = prof.dropped;
+}
+
+static int h_cmp_addr(const void *v1, const void *v2)
+{
+	ulong a1 = *(const ulong *)v1, a2 = *(const ulong *)v2;
+
+	return a1 < a2 ? -1 : a1 > a2;
+}
+
+static int h_cmp_count(const void *v1, const void *v2)
+{
+	const struct prof_entry *e1 = v1, *e2 = v2;
+
+	if (e1->count != e2->count)
+		return e1->count < e2->count ? 1 : -1;
+
+	return e1->addr < e2->addr ? -1 : e1->addr > e2->addr;
+}
+
+/**
+ * group_samples() - count samples per function
+ *
+ * The samples must be sorted by address. Without a symbol table, each
+ * distinct address gets its own entry.
+ *
+ * @samples:	Sorted samples
+ * @count:	Number of samples
+ * @entries:	Returns the totals; must have space for @count entries
+ * Return: number of entries used
+ */
+static int group_samples(const ulong *samples, uint count,
+			 struct prof_entry *entries)
+{
+	const char *pos = NULL, *name = NULL, *next_name;
+	ulong addr = 0, next_addr = 0;
+	struct prof_entry *entry = NULL;
+	uint i, outside = 0;
+
+	if (IS_ENABLED(CONFIG_KALLSYMS))
+		pos = symbol_next(NULL, &next_addr, &next_name);
+
+	for (i = 0; i < count; i++) {
+		ulong pc = samples[i];
+
+		if (IS_ENABLED(CONFIG_KALLSYMS)) {
+			while (pos && next_addr <= pc) {
+				addr = next_addr;
+				name = next_name;
+				pos = symbol_next(pos, &next_addr, &next_name);
+			}
+
+			/*
+			 * Anything before the first symbol or after the last
+			 * one is outside U-Boot, e.g. in the host C library
+			 * on sandbox
+			 */
+			if (!name || !pos) {
+				outside++;
+				continue;
+			}
+		} else {
+			addr = pc;
+		}
+
+		if (!entry || entry->addr != addr) {
+			entry = entry ? entry + 1 : entries;
+			entry->addr = addr;
+			entry->name = name;
+			entry->count = 0;
+		}
+		entry->count++;
+	}
+	if (outside) {
+		entry = entry ? entry + 1 : entries;
+		entry->addr = 0;
+		entry->name = "(outside U-Boot)";
+		entry->count = outside;
+	}
+
+	return entry ? entry - entries + 1 : 0;
+}
+
+int prof_report(int count)
+{
+	struct prof_entry *entries;
+	bool running = prof.running;
+	int num, i;
+
+	if (!prof.count)
+		return -ENOENT;
+	entries = calloc(prof.count, sizeof(*entries));
+	if (!entries)
+		return -ENOMEM;
+
+	prof.running = false;
+	qsort(prof.samples, prof.count, sizeof(*prof.samples), h_cmp_addr);
+	num = group_samples(prof.samples, prof.count, entries);
+	qsort(entries, num, sizeof(*entries), h_cmp_count);
+
+	printf("%8s %7s  %s\n", "Samples", "%", "Function");
+	for (i = 0; i < num && i < count; i++) {
+		struct prof_entry *entry = &entries[i];
+		uint pct = entry->count * 1000ULL / prof.count;
+
+		printf("%8u %4u.%u%%  ", entry->count, pct / 10, pct % 10);
+		if (entry->name)
+			printf("%s\n", entry->name);
+		else
+			printf("%08lx\n", entry->addr);
+	}
+	if (num > count)
+		printf("(%d more)\n", num - count);
+	prof.running = running;
+	free(entries);
+
+	return 0;
+}
@@ -10,6 +10,7 @@
 #include <dm.h>
 #include <errno.h>
 #include <init.h>
+#include <sched.h>
 #include <spl.h>
 #include <time.h>
 #include <timer.h>
@@ -199,6 +200,7 @@ void udelay(unsigned long usec)
 
 	do {
 		WATCHDOG_RESET();
+		sched_yield();
 		kv = usec > CONFIG_WD_PERIOD ? CONFIG_WD_PERIOD : usec;
 		__udelay(kv);
 		usec -= kv;
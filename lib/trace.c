@@ -10,12 +10,36 @@
 #include <asm/global_data.h>
 #include <asm/io.h>
 #include <asm/sections.h>
+#include <linux/log2.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
 static char trace_enabled __section(".data");
 static char trace_inited __section(".data");
 
+#ifdef CONFIG_TRACE_HW_COUNTERS
+/* Deepest call level for which hardware counters are sampled */
+#define TRACE_HW_MAX_DEPTH	64
+
+/* Maximum number of table slots to probe before dropping a function */
+#define TRACE_HW_MAX_PROBE	16
+
+/* Counter totals for a single function */
+struct trace_hw_func {
+	u32 func;		/* Function site number + 1, 0 if slot unused */
+	u32 calls;		/* Number of completed calls */
+	u64 self[TRACE_HW_COUNT];
+	u64 total[TRACE_HW_COUNT];
+};
+
+/* Counter state for a function which has been entered but not exited */
+struct trace_hw_frame {
+	u32 func;		/* Function site number + 1 */
+	u64 start[TRACE_HW_COUNT];	/* Counters on entry */
+	u64 child[TRACE_HW_COUNT];	/* Counts used by callees so far */
+};
+#endif
+
 /* The header block at the start of the trace memory area */
 struct trace_hdr {
 	int func_count;		/* Total number of function call sites */
@@ -38,6 +62,18 @@ struct trace_hdr {
 	int depth;
 	int depth_limit;
 	int max_depth;
+
+#ifdef CONFIG_TRACE_HW_COUNTERS
+	/*
+	 * Hardware counter totals, hashed by function site. This and the
+	 * frame stack live at the end of the trace buffer, so that the
+	 * layout above stays compatible with the early trace buffer.
+	 */
+	struct trace_hw_func *hw_funcs;
+	uint hw_func_mask;	/* Number of entries in hw_funcs - 1 */
+	ulong hw_dropped;	/* Calls not counted as the table was full */
+	struct trace_hw_frame *hw_stack;
+#endif
 };
 
 static struct trace_hdr *hdr;	/* Pointer to start of trace buffer */
@@ -130,6 +166,86 @@ static void __attribute__((no_instrument_function)) add_textbase(void)
 	hdr->ftrace_count++;
 }
 
+#ifdef CONFIG_TRACE_HW_COUNTERS
+static struct trace_hw_func __attribute__((no_instrument_function))
+		*hw_find_func(u32 func)
+{
+	uint slot, i;
+
+	slot = (func * 2654435761U) & hdr->hw_func_mask;
+	for (i = 0; i < TRACE_HW_MAX_PROBE; i++) {
+		struct trace_hw_func *entry = &hdr->hw_funcs[slot];
+
+		if (entry->func == func)
+			return entry;
+		if (!entry->func) {
+			entry->func = func;
+			return entry;
+		}
+		slot = (slot + 1) & hdr->hw_func_mask;
+	}
+
+	return NULL;
+}
+
+static void __attribute__((no_instrument_function)) hw_enter(void *func_ptr)
+{
+	struct trace_hw_frame *frame;
+	int i;
+
+	if (!hdr->hw_funcs || hdr->depth < 0 ||
+	    hdr->depth >= TRACE_HW_MAX_DEPTH)
+		return;
+	frame = &hdr->hw_stack[hdr->depth];
+	frame->func = func_ptr_to_num(func_ptr) + 1;
+	for (i = 0; i < TRACE_HW_COUNT; i++)
+		frame->child[i] = 0;
+
+	/* Read the counters last, to leave out as much overhead as we can */
+	trace_hw_read(frame->start);
+}
+
+static void __attribute__((no_instrument_function)) hw_exit(void *func_ptr)
+{
+	struct trace_hw_frame *frame, *parent;
+	struct trace_hw_func *entry;
+	u64 now[TRACE_HW_COUNT];
+	int i;
+
+	if (!hdr->hw_funcs)
+		return;
+	trace_hw_read(now);
+	if (hdr->depth < 0 || hdr->depth >= TRACE_HW_MAX_DEPTH)
+		return;
+
+	/* Ignore exits which don't match an entry, e.g. after 'trace resume' */
+	frame = &hdr->hw_stack[hdr->depth];
+	if (frame->func != func_ptr_to_num(func_ptr) + 1)
+		return;
+	frame->func = 0;
+	parent = hdr->depth ? frame - 1 : NULL;
+
+	entry = hw_find_func(func_ptr_to_num(func_ptr) + 1);
+	if (!entry)
+		hdr->hw_dropped++;
+	else
+		entry->calls++;
+	for (i = 0; i < TRACE_HW_COUNT; i++) {
+		u64 delta = now[i] - frame->start[i];
+
+		if (entry) {
+			entry->total[i] += delta;
+			entry->self[i] += delta - frame->child[i];
+		}
+		if (parent)
+			parent->child[i] += delta;
+	}
+}
+#else
+static inline void hw_enter(void *func_ptr) {}
+static inline void hw_exit(void *func_ptr) {}
+#endif
+
 /**
  * __cyg_profile_func_enter() - record function entry
  *
@@ -154,6 +270,7 @@ void __attribute__((no_instrument_function)) __cyg_profile_func_enter(
 		} else {
 			hdr->untracked_count++;
 		}
+		hw_enter(func_ptr);
 		hdr->depth++;
 		if (hdr->depth > hdr->depth_limit)
 			hdr->max_depth = hdr->depth;
@@ -174,6 +291,7 @@ void __attribute__((no_instrument_function)) __cyg_profile_func_exit(
 		trace_swap_gd();
 		add_ftrace(func_ptr, caller, FUNCF_EXIT);
 		hdr->depth--;
+		hw_exit(func_ptr);
 		trace_swap_gd();
 	}
 }
@@ -292,6 +410,165 @@ int trace_list_calls(void *buff, size_t buff_size, size_t *needed)
 	return 0;
 }
 
+#ifdef CONFIG_TRACE_HW_COUNTERS
+int trace_list_counters(void *buff, size_t buff_size, size_t *needed)
+{
+	struct trace_output_hdr *output_hdr = NULL;
+	void *end, *ptr = buff;
+	size_t upto;
+	uint i;
+
+	if (!trace_inited || !hdr->hw_funcs)
+		return -ENOSYS;
+	end = buff ? buff + buff_size : NULL;
+
+	/* Place some header information */
+	if (ptr + sizeof(struct trace_output_hdr) < end)
+		output_hdr = ptr;
+	ptr += sizeof(struct trace_output_hdr);
+
+	/* Add the totals for each function */
+	for (i = upto = 0; i <= hdr->hw_func_mask; i++) {
+		struct trace_hw_func *entry = &hdr->hw_funcs[i];
+
+		if (!entry->func || !entry->calls)
+			continue;
+
+		if (ptr + sizeof(struct trace_output_counters) < end) {
+			struct trace_output_counters *out = ptr;
+
+			out->offset = (entry->func - 1) * FUNC_SITE_SIZE;
+			out->call_count = entry->calls;
+			memcpy(out->self, entry->self, sizeof(out->self));
+			memcpy(out->total, entry->total, sizeof(out->total));
+			upto++;
+		}
+		ptr += sizeof(struct trace_output_counters);
+	}
+
+	/* Update the header */
+	if (output_hdr) {
+		output_hdr->rec_count = upto;
+		output_hdr->type = TRACE_CHUNK_COUNTERS;
+	}
+
+	/* Work out how must of the buffer we used */
+	*needed = ptr - buff;
+	if (ptr > end)
+		return -ENOSPC;
+
+	return 0;
+}
+
+void trace_print_counters(enum trace_hw_counter counter, int count)
+{
+	struct trace_hw_func *prev = NULL;
+	int upto;
+	uint i;
+
+	if (!trace_inited || !hdr->hw_funcs) {
+		printf("Hardware counters are disabled\n");
+		return;
+	}
+	printf("%10s %15s %15s %15s %15s  %s\n", "Calls", "Cycles",
+	       "Instret", "Event", "Total cycles", "Function offset");
+
+	/*
+	 * Selection by repeated scan keeps this free of allocation; ties on
+	 * the counter are broken by table position so nothing is skipped
+	 */
+	for (upto = 0; upto < count; upto++) {
+		struct trace_hw_func *best = NULL;
+
+		for (i = 0; i <= hdr->hw_func_mask; i++) {
+			struct trace_hw_func *entry = &hdr->hw_funcs[i];
+			u64 val = entry->self[counter];
+
+			if (!entry->calls)
+				continue;
+			if (prev && (val > prev->self[counter] ||
+				     (val == prev->self[counter] &&
+				      entry <= prev)))
+				continue;
+			if (!best || val > best->self[counter])
+				best = entry;
+		}
+		if (!best)
+			break;
+		printf("%10u %15llu %15llu %15llu %15llu  %08x\n", best->calls,
+		       best->self[TRACE_HW_CYCLES],
+		       best->self[TRACE_HW_INSTRET],
+		       best->self[TRACE_HW_EVENT],
+		       best->total[TRACE_HW_CYCLES],
+		       (best->func - 1) * FUNC_SITE_SIZE);
+		prev = best;
+	}
+}
+
+/**
+ * trace_hw_size() - work out the space needed for hardware counter totals
+ *
+ * @buff_size:	Size of trace buffer
+ * Return: number of bytes to reserve at the end of the trace buffer, or 0 if
+ * there is not enough space
+ */
+static size_t __attribute__((no_instrument_function)) trace_hw_size(
+		size_t buff_size)
+{
+	size_t size;
+
+	size = rounddown_pow_of_two(CONFIG_TRACE_HW_FUNCS) *
+		sizeof(struct trace_hw_func) +
+		TRACE_HW_MAX_DEPTH * sizeof(struct trace_hw_frame);
+	if (size >= buff_size / 2) {
+		printf("trace: buffer too small for hardware counters\n");
+		return 0;
+	}
+
+	return size;
+}
+
+/**
+ * trace_hw_init() - set up the hardware counter area
+ *
+ * @area:	Pointer to area at the end of the trace buffer
+ * @size:	Size of area, as returned by trace_hw_size()
+ */
+static void __attribute__((no_instrument_function)) trace_hw_init(void *area,
+		size_t size)
+{
+	uint count = rounddown_pow_of_two(CONFIG_TRACE_HW_FUNCS);
+
+	hdr->hw_dropped = 0;
+	if (!size) {
+		hdr->hw_funcs = NULL;
+		return;
+	}
+	memset(area, '\0', size);
+	hdr->hw_funcs = area;
+	hdr->hw_func_mask = count - 1;
+	hdr->hw_stack = (struct trace_hw_frame *)(hdr->hw_funcs + count);
+	trace_hw_start();
+}
+#else
+int trace_list_counters(void *buff, size_t buff_size, size_t *needed)
+{
+	return -ENOSYS;
+}
+
+void trace_print_counters(enum trace_hw_counter counter, int count)
+{
+	printf("Hardware counters are disabled\n");
+}
+
+static inline size_t trace_hw_size(size_t buff_size)
+{
+	return 0;
+}
+
+static inline void trace_hw_init(void *area, size_t size) {}
+#endif
+
 /**
  * trace_print_stats() - print basic information about tracing
  */
@@ -325,6 +602,12 @@ void trace_print_stats(void)
 	printf("%15d call depth limit\n", hdr->depth_limit);
 	print_grouped_ull(hdr->ftrace_too_deep_count, 10);
 	puts(" calls not traced due to depth\n");
+#ifdef CONFIG_TRACE_HW_COUNTERS
+	if (hdr->hw_funcs) {
+		print_grouped_ull(hdr->hw_dropped, 10);
+		puts(" calls not counted as counter table was full\n");
+	}
+#endif
 }
 
 void __attribute__((no_instrument_function)) trace_set_enabled(int enabled)
@@ -343,7 +626,7 @@ int __attribute__((no_instrument_function)) trace_init(void *buff,
 		size_t buff_size)
 {
 	ulong func_count = gd->mon_len / FUNC_SITE_SIZE;
-	size_t needed;
+	size_t needed, hw_size;
 	int was_disabled = !trace_enabled;
 
 	trace_save_gd();
@@ -373,6 +656,8 @@ int __attribute__((no_instrument_function)) trace_init(void *buff,
 #endif
 	}
 	hdr = (struct trace_hdr *)buff;
+	hw_size = trace_hw_size(buff_size);
+	buff_size -= hw_size;
 	needed = sizeof(*hdr) + func_count * sizeof(uintptr_t);
 	if (needed > buff_size) {
 		printf("trace: buffer size %zd bytes: at least %zd needed\n",
@@ -384,6 +669,7 @@ int __attribute__((no_instrument_function)) trace_init(void *buff,
 		memset(hdr, '\0', needed);
 	hdr->func_count = func_count;
 	hdr->call_accum = (uintptr_t *)(hdr + 1);
+	trace_hw_init(buff + buff_size, hw_size);
 
 	/* Use any remaining space for the timed function trace */
 	hdr->ftrace = (struct trace_call *)(buff + needed);
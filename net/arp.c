@@ -10,6 +10,7 @@
  */
 
 #include <common.h>
+#include <bootstage.h>
 #include <env.h>
 #include <log.h>
 #include <net.h>
@@ -27,6 +28,26 @@ int		arp_wait_try;
 uchar	       *arp_tx_packet; /* THE ARP transmit packet */
 static uchar	arp_tx_packet_buf[PKTSIZE_ALIGN + PKTALIGN];
 
+#if CONFIG_IS_ENABLED(NET_ARP_CACHE)
+/**
+ * struct arp_cache_entry - An ARP reply which has been seen
+ *
+ * @ip: IP address which was looked up, 0 if the entry is not in use
+ * @ethaddr: Its MAC address
+ * @our_ethaddr: Our MAC address at the time, so that an entry is not used on
+ *	a different interface
+ * @time: get_timer() value when the reply arrived
+ */
+struct arp_cache_entry {
+	struct in_addr ip;
+	uchar ethaddr[ARP_HLEN];
+	uchar our_ethaddr[ARP_HLEN];
+	ulong time;
+};
+
+static struct arp_cache_entry arp_cache[CONFIG_NET_ARP_CACHE_SIZE];
+#endif
+
 void arp_init(void)
 {
 	/* XXX problem with bss workaround */
@@ -68,10 +89,16 @@ void arp_raw_request(struct in_addr source_ip, const uchar *target_ethaddr,
 	net_send_packet(arp_tx_packet, eth_hdr_size + ARP_HDR_SIZE);
 }
 
+/* Returns true if @ip must be reached through the gateway */
+static bool arp_via_gateway(struct in_addr ip)
+{
+	return (ip.s_addr & net_netmask.s_addr) !=
+		(net_ip.s_addr & net_netmask.s_addr);
+}
+
 void arp_request(void)
 {
-	if ((net_arp_wait_packet_ip.s_addr & net_netmask.s_addr) !=
-	    (net_ip.s_addr & net_netmask.s_addr)) {
+	if (arp_via_gateway(net_arp_wait_packet_ip)) {
 		if (net_gateway.s_addr == 0) {
 			puts("## Warning: gatewayip needed but not set\n");
 			net_arp_wait_reply_ip = net_arp_wait_packet_ip;
@@ -82,9 +109,65 @@ void arp_request(void)
 		net_arp_wait_reply_ip = net_arp_wait_packet_ip;
 	}
 
+	bootstage_start(BOOTSTAGE_ID_ACCUM_NET_ARP, "arp");
 	arp_raw_request(net_ip, net_null_ethaddr, net_arp_wait_reply_ip);
 }
 
+#if CONFIG_IS_ENABLED(NET_ARP_CACHE)
+static void arp_cache_add(struct in_addr ip, const uchar *ethaddr)
+{
+	struct arp_cache_entry *ent, *oldest = arp_cache;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(arp_cache); i++) {
+		ent = &arp_cache[i];
+		if (ent->ip.s_addr == ip.s_addr || !ent->ip.s_addr) {
+			oldest = ent;
+			break;
+		}
+		if (get_timer(ent->time) > get_timer(oldest->time))
+			oldest = ent;
+	}
+	oldest->ip = ip;
+	memcpy(oldest->ethaddr, ethaddr, ARP_HLEN);
+	memcpy(oldest->our_ethaddr, net_ethaddr, ARP_HLEN);
+	oldest->time = get_timer(0);
+}
+
+int arp_cache_lookup(struct in_addr dest, uchar *ethaddr)
+{
+	struct arp_cache_entry *ent;
+	int i;
+
+	if (arp_via_gateway(dest) && net_gateway.s_addr)
+		dest = net_gateway;
+
+	for (i = 0; i < ARRAY_SIZE(arp_cache); i++) {
+		ent = &arp_cache[i];
+		if (ent->ip.s_addr != dest.s_addr)
+			continue;
+		if (memcmp(ent->our_ethaddr, net_ethaddr, ARP_HLEN) ||
+		    get_timer(ent->time) >
+		    CONFIG_NET_ARP_CACHE_TIMEOUT * 1000UL) {
+			ent->ip.s_addr = 0;
+			break;
+		}
+		debug_cond(DEBUG_DEV_PKT, "ARP cache: %pI4 is %pM\n", &dest,
+			   ent->ethaddr);
+		memcpy(ethaddr, ent->ethaddr, ARP_HLEN);
+
+		return 0;
+	}
+
+	return -ENOENT;
+}
+
+void arp_cache_flush(void)
+{
+	memset(arp_cache, '\0', sizeof(arp_cache));
+}
+#endif
+
 int arp_timeout_check(void)
 {
 	ulong t;
@@ -197,10 +280,15 @@ void arp_receive(struct ethernet_hdr *et, struct ip_udp_hdr *ip, int len)
 				   "Got ARP REPLY, set eth addr (%pM)\n",
 				   arp->ar_data);
 
+			bootstage_accum(BOOTSTAGE_ID_ACCUM_NET_ARP);
+
 			/* save address for later use */
 			if (arp_wait_packet_ethaddr != NULL)
 				memcpy(arp_wait_packet_ethaddr,
 				       &arp->ar_sha, ARP_HLEN);
+#if CONFIG_IS_ENABLED(NET_ARP_CACHE)
+			arp_cache_add(reply_ip_addr, (uchar *)&arp->ar_sha);
+#endif
 
 			net_get_arp_handler()((uchar *)arp, 0, reply_ip_addr,
 					      0, len);
@@ -73,6 +73,32 @@ static u8 dhcp_option_overload;
 static void dhcp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			unsigned src, unsigned len);
 
+/* Time to wait for a reply to a request for the previous lease */
+#define DHCP_REBOOT_TIMEOUT_MS	1000
+#define DHCP_REBOOT_TRIES	2
+
+/**
+ * struct dhcp_lease - The lease from the last DHCP exchange
+ *
+ * This lets the next dhcp command ask for the same address straight away
+ * (the INIT-REBOOT state of RFC 2131), rather than starting over with a
+ * broadcast DHCPDISCOVER and waiting for offers. The server sends all the
+ * options again in its DHCPACK.
+ *
+ * @ethaddr: MAC address the lease is for
+ * @ip: Leased IP address, 0 if there is no lease
+ * @secs: Length of the lease in seconds
+ * @start: get_timer() value when the lease was requested
+ */
+struct dhcp_lease {
+	uchar ethaddr[ARP_HLEN];
+	struct in_addr ip;
+	u32 secs;
+	ulong start;
+};
+
+static struct dhcp_lease dhcp_lease;
+
 /* For Debug */
 #if 0
 static char *dhcpmsg2str(int type)
@@ -707,6 +733,26 @@ static int bootp_extended(u8 *e)
 }
 #endif
 
+/* Returns a new ID for a request, in network order */
+static u32 bootp_new_id(void)
+{
+	u32 bootp_id;
+
+	/*
+	 *	Bootp ID is the lower 4 bytes of our ethernet address
+	 *	plus the current time in ms.
+	 */
+	bootp_id = ((u32)net_ethaddr[2] << 24)
+		| ((u32)net_ethaddr[3] << 16)
+		| ((u32)net_ethaddr[4] << 8)
+		| (u32)net_ethaddr[5];
+	bootp_id += get_timer(0);
+	bootp_id = htonl(bootp_id);
+	bootp_add_id(bootp_id);
+
+	return bootp_id;
+}
+
 void bootp_reset(void)
 {
 	bootp_num_ids = 0;
@@ -799,17 +845,7 @@ void bootp_request(void)
 	extlen = bootp_extended((u8 *)bp->bp_vend);
 #endif
 
-	/*
-	 *	Bootp ID is the lower 4 bytes of our ethernet address
-	 *	plus the current time in ms.
-	 */
-	bootp_id = ((u32)net_ethaddr[2] << 24)
-		| ((u32)net_ethaddr[3] << 16)
-		| ((u32)net_ethaddr[4] << 8)
-		| (u32)net_ethaddr[5];
-	bootp_id += get_timer(0);
-	bootp_id = htonl(bootp_id);
-	bootp_add_id(bootp_id);
+	bootp_id = bootp_new_id();
 	net_copy_u32(&bp->bp_id, &bootp_id);
 
 	/*
@@ -974,13 +1010,20 @@ static int dhcp_message_type(unsigned char *popt)
 	return -1;
 }
 
-static void dhcp_send_request_packet(struct bootp_hdr *bp_offer)
+/**
+ * dhcp_send_request_packet() - Send a DHCPREQUEST
+ *
+ * @id: ID of the request (network order)
+ * @server_ip: Server to request from, or 0 to ask for the previous lease
+ * @requested_ip: Address to request
+ */
+static void dhcp_send_request_packet(u32 id, struct in_addr server_ip,
+				     struct in_addr requested_ip)
 {
 	uchar *pkt, *iphdr;
 	struct bootp_hdr *bp;
 	int pktlen, iplen, extlen;
 	int eth_hdr_size;
-	struct in_addr offered_ip;
 	struct in_addr zero_ip;
 	struct in_addr bcast_ip;
 
@@ -1013,20 +1056,11 @@ static void dhcp_send_request_packet(struct bootp_hdr *bp_offer)
 	memcpy(bp->bp_chaddr, net_ethaddr, 6);
 	copy_filename(bp->bp_file, net_boot_file_name, sizeof(bp->bp_file));
 
-	/*
-	 * ID is the id of the OFFER packet
-	 */
-
-	net_copy_u32(&bp->bp_id, &bp_offer->bp_id);
+	net_copy_u32(&bp->bp_id, &id);
 
-	/*
-	 * Copy options from OFFER packet if present
-	 */
-
-	/* Copy offered IP into the parameters request list */
-	net_copy_ip(&offered_ip, &bp_offer->bp_yiaddr);
+	/* Put the requested IP into the parameters request list */
 	extlen = dhcp_extended((u8 *)bp->bp_vend, DHCP_REQUEST,
-		dhcp_server_ip, offered_ip);
+		server_ip, requested_ip);
 
 	iplen = BOOTP_HDR_SIZE - OPT_FIELD_SIZE + extlen;
 	pktlen = eth_hdr_size + IP_UDP_HDR_SIZE + iplen;
@@ -1037,6 +1071,64 @@ static void dhcp_send_request_packet(struct bootp_hdr *bp_offer)
 	net_send_packet(net_tx_packet, pktlen);
 }
 
+void dhcp_lease_clear(void)
+{
+	memset(&dhcp_lease, '\0', sizeof(dhcp_lease));
+}
+
+static void dhcp_lease_save(void)
+{
+	memcpy(dhcp_lease.ethaddr, net_ethaddr, ARP_HLEN);
+	dhcp_lease.ip = net_ip;
+	dhcp_lease.secs = ntohl(dhcp_leasetime);
+	dhcp_lease.start = bootp_start;
+}
+
+/* Check whether the lease can be used again, i.e. is not yet due for renewal */
+static bool dhcp_lease_valid(void)
+{
+	if (!dhcp_lease.ip.s_addr ||
+	    memcmp(dhcp_lease.ethaddr, net_ethaddr, ARP_HLEN))
+		return false;
+
+	return get_timer(dhcp_lease.start) / 1000 < dhcp_lease.secs / 2;
+}
+
+static void dhcp_reboot_timeout_handler(void);
+
+/* Ask for the previous lease again, without a DHCPDISCOVER */
+static void dhcp_reboot_request(void)
+{
+	struct in_addr zero_ip;
+
+	bootstage_mark_name(BOOTSTAGE_ID_BOOTP_START, "bootp_start");
+	printf("DHCP request for %pI4 %d\n", &dhcp_lease.ip, ++bootp_try);
+	dhcp_state = REBOOTING;
+	net_set_udp_handler(dhcp_handler);
+	net_set_timeout_handler(DHCP_REBOOT_TIMEOUT_MS,
+				dhcp_reboot_timeout_handler);
+
+	/* RFC 2131 says the server ID must not be given in this state */
+	zero_ip.s_addr = 0;
+	dhcp_send_request_packet(bootp_new_id(), zero_ip, dhcp_lease.ip);
+}
+
+/* Forgets the lease and goes back to a full exchange */
+static void dhcp_reboot_fail(void)
+{
+	dhcp_lease_clear();
+	bootp_try = 0;
+	bootp_request();
+}
+
+static void dhcp_reboot_timeout_handler(void)
+{
+	if (bootp_try < DHCP_REBOOT_TRIES)
+		dhcp_reboot_request();
+	else
+		dhcp_reboot_fail();
+}
+
 /*
  *	Handle DHCP received packets.
  */
@@ -1044,6 +1136,8 @@ static void dhcp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			 unsigned src, unsigned len)
 {
 	struct bootp_hdr *bp = (struct bootp_hdr *)pkt;
+	struct in_addr offered_ip;
+	u32 id;
 
 	debug("DHCPHandler: got packet: (src=%d, dst=%d, len=%d) state: %d\n",
 	      src, dest, len, dhcp_state);
@@ -1055,6 +1149,13 @@ static void dhcp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 	debug("DHCPHandler: got DHCP packet: (src=%d, dst=%d, len=%d) state: "
 	      "%d\n", src, dest, len, dhcp_state);
 
+	if (dhcp_state == REBOOTING &&
+	    dhcp_message_type((u8 *)bp->bp_vend) == DHCP_NAK) {
+		printf("DHCP lease for %pI4 refused\n", &dhcp_lease.ip);
+		dhcp_reboot_fail();
+		return;
+	}
+
 	if (net_read_ip(&bp->bp_yiaddr).s_addr == 0) {
 #if defined(CONFIG_SERVERIP_FROM_PROXYDHCP)
 		store_bootp_params(bp);
@@ -1089,21 +1190,30 @@ static void dhcp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			dhcp_state = REQUESTING;
 
 			net_set_timeout_handler(5000, bootp_timeout_handler);
-			dhcp_send_request_packet(bp);
+			net_copy_u32(&id, &bp->bp_id);
+			net_copy_ip(&offered_ip, &bp->bp_yiaddr);
+			dhcp_send_request_packet(id, dhcp_server_ip,
+						 offered_ip);
 #ifdef CONFIG_SYS_BOOTFILE_PREFIX
 		}
 #endif	/* CONFIG_SYS_BOOTFILE_PREFIX */
 
 		return;
 		break;
+	case REBOOTING:
 	case REQUESTING:
-		debug("DHCP State: REQUESTING\n");
+		debug("DHCP State: %s\n",
+		      dhcp_state == REBOOTING ? "REBOOTING" : "REQUESTING");
 
 		if (dhcp_message_type((u8 *)bp->bp_vend) == DHCP_ACK) {
 			dhcp_packet_process_options(bp);
+			if (dhcp_state == REBOOTING)
+				efi_net_set_dhcp_ack(pkt, len);
 			/* Store net params from reply */
 			store_net_params(bp);
 			dhcp_state = BOUND;
+			if (CONFIG_IS_ENABLED(DHCP_LEASE_CACHE))
+				dhcp_lease_save();
 			printf("DHCP client bound to address %pI4 (%lu ms)\n",
 			       &net_ip, get_timer(bootp_start));
 			net_set_timeout_handler(0, (thand_f *)0);
@@ -1125,6 +1235,11 @@ static void dhcp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 
 void dhcp_request(void)
 {
+	dhcp_leasetime = 0;
+	if (CONFIG_IS_ENABLED(DHCP_LEASE_CACHE) && dhcp_lease_valid()) {
+		dhcp_reboot_request();
+		return;
+	}
 	bootp_request();
 }
 #endif	/* CONFIG_CMD_DHCP */
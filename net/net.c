@@ -92,11 +92,13 @@
 #include <log.h>
 #include <net.h>
 #include <net/fastboot.h>
+#include <net/tcp.h>
 #include <net/tftp.h>
 #if defined(CONFIG_CMD_PCAP)
 #include <net/pcap.h>
 #endif
 #include <net/udp.h>
+#include <net/wget.h>
 #if defined(CONFIG_LED_STATUS)
 #include <miiphy.h>
 #include <status_led.h>
@@ -200,6 +202,9 @@ static int net_check_prereq(enum proto_t protocol);
 
 static int net_try_count;
 
+/* Phase of network activity whose time is being added up, if any */
+static enum bootstage_id net_phase;
+
 int __maybe_unused net_busy_flag;
 
 /**********************************************************************/
@@ -335,6 +340,7 @@ void net_auto_load(void)
 		}
 		return;
 	}
+	net_set_phase(BOOTSTAGE_ID_ACCUM_NET_TFTP, "tftp");
 	tftp_start(TFTPGET);
 }
 
@@ -363,6 +369,8 @@ static void net_clear_handlers(void)
 static void net_cleanup_loop(void)
 {
 	net_clear_handlers();
+	if (IS_ENABLED(CONFIG_CMD_WGET))
+		wget_stop();
 }
 
 int net_init(void)
@@ -391,6 +399,15 @@ int net_init(void)
 	return net_init_loop();
 }
 
+void net_set_phase(enum bootstage_id id, const char *name)
+{
+	if (net_phase != BOOTSTAGE_ID_START)
+		bootstage_accum(net_phase);
+	net_phase = id;
+	if (id != BOOTSTAGE_ID_START)
+		bootstage_start(id, name);
+}
+
 /**********************************************************************/
 /*
  *	Main network processing loop.
@@ -457,7 +474,8 @@ restart:
 #ifdef CONFIG_CMD_TFTPPUT
 		case TFTPPUT:
 #endif
-			/* always use ARP to get server ethernet address */
+			/* look up the server's ethernet address again */
+			net_set_phase(BOOTSTAGE_ID_ACCUM_NET_TFTP, "tftp");
 			tftp_start(protocol);
 			break;
 #endif
@@ -473,6 +491,7 @@ restart:
 #endif
 #if defined(CONFIG_CMD_DHCP)
 		case DHCP:
+			net_set_phase(BOOTSTAGE_ID_ACCUM_NET_DHCP, "dhcp");
 			bootp_reset();
 			net_ip.s_addr = 0;
 			dhcp_request();		/* Basically same as BOOTP */
@@ -480,6 +499,7 @@ restart:
 #endif
 #if defined(CONFIG_CMD_BOOTP)
 		case BOOTP:
+			net_set_phase(BOOTSTAGE_ID_ACCUM_NET_DHCP, "dhcp");
 			bootp_reset();
 			net_ip.s_addr = 0;
 			bootp_request();
@@ -526,6 +546,12 @@ restart:
 		case WOL:
 			wol_start();
 			break;
+#endif
+#if defined(CONFIG_CMD_WGET)
+		case WGET:
+			net_set_phase(BOOTSTAGE_ID_ACCUM_NET_HTTP, "http");
+			wget_start();
+			break;
 #endif
 		default:
 			break;
@@ -562,6 +588,8 @@ restart:
 		WATCHDOG_RESET();
 		if (arp_timeout_check() > 0)
 			time_start = get_timer(0);
+		if (IS_ENABLED(CONFIG_PROT_TCP))
+			tcp_timeout_check();
 
 		/*
 		 *	Check the ethernet for a new packet.  The ethernet
@@ -662,6 +690,7 @@ restart:
 	}
 
 done:
+	net_set_phase(BOOTSTAGE_ID_START, NULL);
 #ifdef CONFIG_USB_KEYBOARD
 	net_busy_flag = 0;
 #endif
@@ -693,6 +722,9 @@ int net_start_again(void)
 	unsigned long retrycnt = 0;
 	int ret;
 
+	/* A stale ARP reply may be why the protocol failed */
+	arp_cache_flush();
+
 	nretry = env_get("netretry");
 	if (nretry) {
 		if (!strcmp(nretry, "yes"))
@@ -836,6 +868,9 @@ int net_send_ip_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 	/* if broadcast, make the ether address a broadcast and don't do ARP */
 	if (dest.s_addr == 0xFFFFFFFF)
 		ether = (uchar *)net_bcast_ethaddr;
+	/* otherwise the MAC address may be known from an earlier ARP reply */
+	else if (!memcmp(ether, net_null_ethaddr, 6))
+		arp_cache_lookup(dest, ether);
 
 	pkt = (uchar *)net_tx_packet;
 
@@ -847,6 +882,14 @@ int net_send_ip_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 				   payload_len);
 		pkt_hdr_size = eth_hdr_size + IP_UDP_HDR_SIZE;
 		break;
+#if defined(CONFIG_PROT_TCP)
+	case IPPROTO_TCP:
+		pkt_hdr_size = eth_hdr_size +
+			tcp_set_tcp_header(pkt + eth_hdr_size, dest, dport,
+					   sport, payload_len, action,
+					   tcp_seq_num, tcp_ack_num);
+		break;
+#endif
 	default:
 		return -EINVAL;
 	}
@@ -1256,6 +1299,10 @@ void net_process_received_packet(uchar *in_packet, int len)
 		if (ip->ip_p == IPPROTO_ICMP) {
 			receive_icmp(ip, len, src_ip, et);
 			return;
+		} else if (IS_ENABLED(CONFIG_PROT_TCP) &&
+			   ip->ip_p == IPPROTO_TCP) {
+			tcp_receive((struct ip_tcp_hdr *)ip, len);
+			return;
 		} else if (ip->ip_p != IPPROTO_UDP) {	/* Only UDP packets */
 			return;
 		}
@@ -1356,6 +1403,9 @@ static int net_check_prereq(enum proto_t protocol)
 
 #if defined(CONFIG_CMD_NFS)
 	case NFS:
+#endif
+#if defined(CONFIG_CMD_WGET)
+	case WGET:
 #endif
 		/* Fall through */
 	case TFTPGET:
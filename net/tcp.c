@@ -0,0 +1,513 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Minimal TCP client
+ *
+ * This is enough to fetch files over HTTP: U-Boot connects to a server,
+ * sends a little data and receives a lot. Received data is handed straight
+ * to the caller, which normally copies it to its final place in memory, so
+ * a large receive window can be advertised without any buffering. Data must
+ * arrive in order: a segment after a gap is dropped and the last byte
+ * received is acknowledged again, so that the server resends the missing
+ * segment (fast retransmit).
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#include <common.h>
+#include <log.h>
+#include <net.h>
+#include <time.h>
+#include <net/tcp.h>
+#include <asm/unaligned.h>
+#include <linux/errno.h>
+
+/* Retransmission timeout, doubled after each try */
+#define TCP_RTO_MS		1000
+#define TCP_MAX_TRIES		5
+
+/* Ports used for our side of connections */
+#define TCP_PORT_FIRST		49152
+#define TCP_PORT_COUNT		16384
+
+/* Connections which are not closed */
+static LIST_HEAD(tcp_conns);
+
+/* Last port used */
+static u16 tcp_port;
+
+/* Check whether sequence number @a comes after @b */
+static bool tcp_seq_after(u32 a, u32 b)
+{
+	return (s32)(a - b) > 0;
+}
+
+/* Returns the shift needed to advertise a window of TCP_WINDOW_SIZE */
+static int tcp_window_shift(void)
+{
+	int shift = 0;
+
+	while ((CONFIG_TCP_WINDOW_SIZE >> shift) > 0xffff)
+		shift++;
+
+	return min(shift, 14);
+}
+
+static struct tcp_conn *tcp_find(struct in_addr ip, int remote_port,
+				 int local_port)
+{
+	struct tcp_conn *conn;
+
+	list_for_each_entry(conn, &tcp_conns, node) {
+		if (conn->local_port == local_port &&
+		    conn->remote_port == remote_port &&
+		    conn->remote_ip.s_addr == ip.s_addr)
+			return conn;
+	}
+
+	return NULL;
+}
+
+static u16 tcp_new_port(void)
+{
+	struct tcp_conn *conn;
+	bool used;
+
+	if (!tcp_port)
+		tcp_port = TCP_PORT_FIRST + timer_get_us() % TCP_PORT_COUNT;
+	do {
+		if (++tcp_port < TCP_PORT_FIRST)
+			tcp_port = TCP_PORT_FIRST;
+		used = false;
+		list_for_each_entry(conn, &tcp_conns, node)
+			used |= conn->local_port == tcp_port;
+	} while (used);
+
+	return tcp_port;
+}
+
+uint tcp_checksum(const struct ip_tcp_hdr *ip, int tcp_len)
+{
+	struct {
+		struct in_addr src;
+		struct in_addr dst;
+		u8 zero;
+		u8 proto;
+		__be16 len;
+	} __packed pseudo;
+	uint sum;
+
+	pseudo.src = ip->ip_src;
+	pseudo.dst = ip->ip_dst;
+	pseudo.zero = 0;
+	pseudo.proto = IPPROTO_TCP;
+	pseudo.len = htons(tcp_len);
+	sum = compute_ip_checksum(&pseudo, sizeof(pseudo));
+
+	return add_ip_checksums(sizeof(pseudo), sum,
+				compute_ip_checksum((uchar *)ip + IP_HDR_SIZE,
+						    tcp_len));
+}
+
+int tcp_set_tcp_header(uchar *pkt, struct in_addr dest, int dport, int sport,
+		       int payload_len, u8 action, u32 tcp_seq_num,
+		       u32 tcp_ack_num)
+{
+	struct ip_tcp_hdr *ip = (struct ip_tcp_hdr *)pkt;
+	struct tcp_conn *conn = tcp_find(dest, dport, sport);
+	int hdr_len = TCP_HDR_SIZE;
+	ulong win = CONFIG_TCP_WINDOW_SIZE;
+
+	if (action & TCP_SYN) {
+		u8 *opt = pkt + IP_TCP_HDR_SIZE;
+
+		opt[0] = TCP_OPT_MSS;
+		opt[1] = 4;
+		put_unaligned_be16(TCP_MSS, opt + 2);
+		opt[4] = TCP_OPT_NOP;
+		opt[5] = TCP_OPT_WS;
+		opt[6] = 3;
+		opt[7] = tcp_window_shift();
+		hdr_len += TCP_SYN_OPT_SIZE;
+	} else if (conn) {
+		/* The window in a SYN is never scaled */
+		win >>= conn->rcv_wscale;
+	}
+
+	ip->tcp_src = htons(sport);
+	ip->tcp_dst = htons(dport);
+	ip->tcp_seq = htonl(tcp_seq_num);
+	ip->tcp_ack = htonl(tcp_ack_num);
+	ip->tcp_hlen = (hdr_len / 4) << 4;
+	ip->tcp_flags = action;
+	ip->tcp_win = htons(min(win, 0xffffUL));
+	ip->tcp_xsum = 0;
+	ip->tcp_urg = 0;
+	net_set_ip_header(pkt, dest, net_ip, IP_HDR_SIZE + hdr_len + payload_len,
+			  IPPROTO_TCP);
+	ip->tcp_xsum = tcp_checksum(ip, hdr_len + payload_len);
+
+	return IP_HDR_SIZE + hdr_len;
+}
+
+/* Sends a segment, acknowledging everything received so far */
+static void tcp_output(struct tcp_conn *conn, u8 flags, u32 seq,
+		       const void *data, uint len)
+{
+	uchar *pkt = net_tx_packet + net_eth_hdr_size() + IP_TCP_HDR_SIZE;
+
+	if (len)
+		memcpy(pkt, data, len);
+	if (flags & TCP_ACK)
+		conn->ack_sent = conn->rcv_nxt;
+	net_send_ip_packet(conn->ethaddr, conn->remote_ip, conn->remote_port,
+			   conn->local_port, len, IPPROTO_TCP, flags, seq,
+			   conn->rcv_nxt);
+}
+
+static void tcp_send_ack(struct tcp_conn *conn)
+{
+	tcp_output(conn, TCP_ACK, conn->snd_nxt, NULL, 0);
+}
+
+/* Sends data from the transmit buffer in segments the server accepts */
+static void tcp_output_data(struct tcp_conn *conn, uint offset, uint len,
+			    bool fin)
+{
+	uint count;
+	u8 flags;
+
+	do {
+		count = min_t(uint, len, conn->mss);
+		flags = TCP_ACK | TCP_PUSH;
+		if (fin && count == len)
+			flags |= TCP_FIN;
+		tcp_output(conn, flags, conn->snd_una + offset,
+			   conn->txbuf + offset, count);
+		offset += count;
+		len -= count;
+	} while (len);
+}
+
+static void tcp_start_timer(struct tcp_conn *conn)
+{
+	conn->timer = get_timer(0);
+}
+
+/* Takes a connection off the list, telling the owner if it still wants to know */
+static void tcp_finish(struct tcp_conn *conn, enum tcp_event event, bool notify)
+{
+	conn->state = TCP_CLOSED;
+	list_del_init(&conn->node);
+	if (notify)
+		conn->event(conn, event);
+}
+
+/* Check whether the owner of a connection has not yet closed it */
+static bool tcp_is_open(struct tcp_conn *conn)
+{
+	return conn->state == TCP_SYN_SENT || conn->state == TCP_ESTABLISHED ||
+		conn->state == TCP_CLOSE_WAIT;
+}
+
+void tcp_conn_init(struct tcp_conn *conn, tcp_rx_func_t rx,
+		   tcp_event_func_t event, void *ctx)
+{
+	memset(conn, '\0', sizeof(*conn));
+	INIT_LIST_HEAD(&conn->node);
+	conn->rx = rx;
+	conn->event = event;
+	conn->ctx = ctx;
+}
+
+void tcp_connect(struct tcp_conn *conn, struct in_addr ip, int port)
+{
+	struct tcp_conn *other;
+	u32 iss;
+
+	tcp_abort(conn);
+	conn->local_ip = net_ip;
+	conn->remote_ip = ip;
+	conn->remote_port = port;
+	conn->local_port = tcp_new_port();
+
+	/* Avoid an ARP request if another connection knows the server */
+	memset(conn->ethaddr, '\0', ARP_HLEN);
+	list_for_each_entry(other, &tcp_conns, node) {
+		if (other->remote_ip.s_addr == ip.s_addr &&
+		    !is_zero_ethaddr(other->ethaddr))
+			memcpy(conn->ethaddr, other->ethaddr, ARP_HLEN);
+	}
+
+	/* A clock ticking every 4us, as suggested by RFC 793 */
+	iss = timer_get_us() >> 2;
+	conn->snd_una = iss;
+	conn->snd_nxt = iss + 1;
+	conn->rcv_nxt = 0;
+	conn->mss = TCP_DEFAULT_MSS;
+	conn->rcv_wscale = 0;
+	conn->fin_sent = false;
+	conn->tx_len = 0;
+	conn->rto = TCP_RTO_MS;
+	conn->tries = 1;
+	conn->state = TCP_SYN_SENT;
+	list_add_tail(&conn->node, &tcp_conns);
+
+	tcp_start_timer(conn);
+	tcp_output(conn, TCP_SYN, iss, NULL, 0);
+}
+
+int tcp_send(struct tcp_conn *conn, const void *data, uint len)
+{
+	if (conn->state != TCP_ESTABLISHED && conn->state != TCP_CLOSE_WAIT)
+		return -ENOTCONN;
+	if (conn->tx_len + len > sizeof(conn->txbuf))
+		return -EAGAIN;
+
+	memcpy(conn->txbuf + conn->tx_len, data, len);
+	if (conn->snd_una == conn->snd_nxt) {
+		conn->tries = 1;
+		tcp_start_timer(conn);
+	}
+	tcp_output_data(conn, conn->tx_len, len, false);
+	conn->tx_len += len;
+	conn->snd_nxt += len;
+
+	return 0;
+}
+
+void tcp_close(struct tcp_conn *conn)
+{
+	switch (conn->state) {
+	case TCP_SYN_SENT:
+		tcp_abort(conn);
+		return;
+	case TCP_ESTABLISHED:
+		conn->state = TCP_FIN_WAIT;
+		break;
+	case TCP_CLOSE_WAIT:
+		conn->state = TCP_LAST_ACK;
+		break;
+	default:
+		return;
+	}
+
+	if (conn->snd_una == conn->snd_nxt) {
+		conn->tries = 1;
+		tcp_start_timer(conn);
+	}
+	tcp_output(conn, TCP_FIN | TCP_ACK, conn->snd_nxt, NULL, 0);
+	conn->snd_nxt++;
+	conn->fin_sent = true;
+}
+
+void tcp_abort(struct tcp_conn *conn)
+{
+	if (conn->state == TCP_CLOSED)
+		return;
+	if (!is_zero_ethaddr(conn->ethaddr))
+		tcp_output(conn, TCP_RST | TCP_ACK, conn->snd_nxt, NULL, 0);
+	tcp_finish(conn, TCP_EV_RESET, false);
+}
+
+/* Handles the options in a SYN from the server */
+static void tcp_parse_options(struct tcp_conn *conn, const u8 *opt, int len)
+{
+	bool wscale = false;
+
+	while (len > 0 && *opt != TCP_OPT_END) {
+		if (*opt == TCP_OPT_NOP) {
+			opt++;
+			len--;
+			continue;
+		}
+		if (len < 2 || opt[1] < 2 || opt[1] > len)
+			break;
+		/* Never send more than the server accepts, however small */
+		if (*opt == TCP_OPT_MSS && opt[1] == 4 &&
+		    get_unaligned_be16(opt + 2))
+			conn->mss = min_t(uint, get_unaligned_be16(opt + 2),
+					  TCP_MSS);
+		else if (*opt == TCP_OPT_WS && opt[1] == 3)
+			wscale = true;
+		len -= opt[1];
+		opt += opt[1];
+	}
+
+	/*
+	 * Our window is only scaled if the server agrees. We send so little
+	 * that the server's window does not matter.
+	 */
+	conn->rcv_wscale = wscale ? tcp_window_shift() : 0;
+}
+
+/* Handles an acknowledgement from the server */
+static void tcp_ack(struct tcp_conn *conn, u32 ack)
+{
+	uint acked;
+
+	if (!tcp_seq_after(ack, conn->snd_una) ||
+	    tcp_seq_after(ack, conn->snd_nxt))
+		return;
+
+	acked = min(ack - conn->snd_una, conn->tx_len);
+	conn->tx_len -= acked;
+	memmove(conn->txbuf, conn->txbuf + acked, conn->tx_len);
+	conn->snd_una = ack;
+	conn->rto = TCP_RTO_MS;
+	conn->tries = 1;
+	tcp_start_timer(conn);
+}
+
+void tcp_receive(struct ip_tcp_hdr *ip, int len)
+{
+	struct tcp_conn *conn;
+	int hdr_len = (ip->tcp_hlen >> 4) * 4;
+	const uchar *data;
+	u32 seq, ack;
+	uint dlen, skip;
+	u8 flags;
+
+	if (len < IP_TCP_HDR_SIZE || hdr_len < TCP_HDR_SIZE ||
+	    IP_HDR_SIZE + hdr_len > len)
+		return;
+	if (tcp_checksum(ip, len - IP_HDR_SIZE) & 0xfffe) {
+		debug("TCP bad checksum\n");
+		return;
+	}
+
+	conn = tcp_find(net_read_ip(&ip->ip_src), ntohs(ip->tcp_src),
+			ntohs(ip->tcp_dst));
+	if (!conn)
+		return;
+
+	flags = ip->tcp_flags;
+	seq = ntohl(ip->tcp_seq);
+	ack = ntohl(ip->tcp_ack);
+	data = (uchar *)ip + IP_HDR_SIZE + hdr_len;
+	dlen = len - IP_HDR_SIZE - hdr_len;
+
+	if (conn->state == TCP_SYN_SENT) {
+		if (!(flags & TCP_ACK) || ack != conn->snd_nxt)
+			return;
+		if (flags & TCP_RST) {
+			tcp_finish(conn, TCP_EV_RESET, true);
+			return;
+		}
+		if (!(flags & TCP_SYN))
+			return;
+		conn->rcv_nxt = seq + 1;
+		conn->snd_una = ack;
+		tcp_parse_options(conn, (u8 *)ip + IP_TCP_HDR_SIZE,
+				  hdr_len - TCP_HDR_SIZE);
+		conn->state = TCP_ESTABLISHED;
+		tcp_send_ack(conn);
+		conn->event(conn, TCP_EV_CONNECTED);
+		return;
+	}
+
+	/* Only accept a reset which is in sequence (RFC 5961) */
+	if (flags & TCP_RST) {
+		if (seq == conn->rcv_nxt)
+			tcp_finish(conn, TCP_EV_RESET, tcp_is_open(conn));
+		return;
+	}
+
+	/* Our ACK of the server's SYN may have been lost */
+	if (flags & TCP_SYN) {
+		tcp_send_ack(conn);
+		return;
+	}
+
+	if (flags & TCP_ACK) {
+		tcp_ack(conn, ack);
+		if (conn->state == TCP_LAST_ACK && conn->snd_una == conn->snd_nxt) {
+			tcp_finish(conn, TCP_EV_CLOSED, false);
+			return;
+		}
+	}
+	if (!dlen && !(flags & TCP_FIN))
+		return;
+
+	/* Drop anything already received */
+	if (tcp_seq_after(conn->rcv_nxt, seq)) {
+		skip = conn->rcv_nxt - seq;
+		if (skip > dlen) {
+			tcp_send_ack(conn);
+			return;
+		}
+		seq += skip;
+		data += skip;
+		dlen -= skip;
+	}
+
+	/* Ask again for anything missed */
+	if (seq != conn->rcv_nxt) {
+		tcp_send_ack(conn);
+		return;
+	}
+
+	if (dlen) {
+		conn->rcv_nxt += dlen;
+		if (conn->state == TCP_ESTABLISHED) {
+			conn->rx(conn, data, dlen);
+
+			/* The owner may have reset or reconnected */
+			if (conn->state == TCP_CLOSED ||
+			    conn->state == TCP_SYN_SENT)
+				return;
+		}
+	}
+
+	if (flags & TCP_FIN) {
+		conn->rcv_nxt++;
+		tcp_send_ack(conn);
+		switch (conn->state) {
+		case TCP_ESTABLISHED:
+			conn->state = TCP_CLOSE_WAIT;
+			conn->event(conn, TCP_EV_CLOSED);
+			break;
+		case TCP_FIN_WAIT:
+			tcp_finish(conn, TCP_EV_CLOSED, false);
+			break;
+		default:
+			break;
+		}
+	} else if (conn->ack_sent != conn->rcv_nxt) {
+		tcp_send_ack(conn);
+	}
+}
+
+void tcp_timeout_check(void)
+{
+	struct tcp_conn *conn;
+	uint len;
+
+	list_for_each_entry(conn, &tcp_conns, node) {
+		if (conn->snd_una == conn->snd_nxt ||
+		    get_timer(conn->timer) < conn->rto)
+			continue;
+
+		if (conn->tries >= TCP_MAX_TRIES) {
+			debug("TCP connection to %pI4 timed out\n",
+			      &conn->remote_ip);
+			tcp_finish(conn, TCP_EV_TIMEOUT, tcp_is_open(conn));
+
+			/* The owner may have changed the list */
+			return;
+		}
+		conn->tries++;
+		conn->rto *= 2;
+		tcp_start_timer(conn);
+
+		if (conn->state == TCP_SYN_SENT) {
+			tcp_output(conn, TCP_SYN, conn->snd_una, NULL, 0);
+			continue;
+		}
+		len = conn->tx_len;
+		if (len)
+			tcp_output_data(conn, 0, len, conn->fin_sent);
+		else if (conn->fin_sent)
+			tcp_output(conn, TCP_FIN | TCP_ACK, conn->snd_una, NULL,
+				   0);
+	}
+}
@@ -0,0 +1,696 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * HTTP/1.1 client
+ *
+ * Files are requested with GET and the body of each response is copied
+ * straight to its place in memory as it arrives. Connections are kept open
+ * afterwards, so that the next file from the same server (e.g. the kernel
+ * after the PXE configuration file) does not wait for a new connection.
+ *
+ * With more than one connection, a file is fetched as a series of byte
+ * ranges. The first range tells us the size of the file, after which the
+ * others are shared between the connections, each of which has the request
+ * for its next range queued behind the current one (pipelining), so that
+ * it is never left idle waiting for the server. If the server does not know
+ * the size, the rest of the file is asked for in one go instead.
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#include <common.h>
+#include <display_options.h>
+#include <efi_loader.h>
+#include <env.h>
+#include <image.h>
+#include <lmb.h>
+#include <log.h>
+#include <mapmem.h>
+#include <net.h>
+#include <asm/global_data.h>
+#include <net/tcp.h>
+#include <net/wget.h>
+#include <linux/ctype.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Time to wait for any data from the server */
+#define WGET_TIMEOUT_MS		10000
+
+/* Requests which can be outstanding on a connection */
+#define WGET_PIPELINE		2
+
+/* Times a connection can be made again without making progress */
+#define WGET_MAX_RETRIES	4
+
+/* Largest response header */
+#define WGET_HDR_SIZE		1024
+
+/* Longest path, so that WGET_PIPELINE requests fit in one segment */
+#define WGET_MAX_PATH		(TCP_TX_BUF_SIZE / WGET_PIPELINE - 128)
+
+/* Number of hash marks printed for a whole file */
+#define WGET_HASHES		50
+
+/**
+ * struct wget_req - A request sent to the server
+ *
+ * @start: Offset of the first byte requested
+ * @len: Number of bytes requested, 0 for the rest of the file from @start
+ */
+struct wget_req {
+	ulong start;
+	ulong len;
+};
+
+/**
+ * struct wget_conn - A connection to the server
+ *
+ * @tcp: TCP connection
+ * @req: Requests not yet answered, oldest first
+ * @nreqs: Number of requests in @req
+ * @hdr: Header of the response being received
+ * @hdr_len: Number of bytes in @hdr
+ * @in_body: true if the header has been received and the body is arriving
+ * @body_pos: Offset in the file of the next byte of the body
+ * @body_left: Bytes of the body still to come, ULONG_MAX if this is only
+ *	known when the server closes the connection
+ * @keep_alive: true if the server allows another request after this one
+ * @got_data: true if anything has been received since the connection was
+ *	made or the last response finished
+ */
+struct wget_conn {
+	struct tcp_conn tcp;
+	struct wget_req req[WGET_PIPELINE];
+	int nreqs;
+	char hdr[WGET_HDR_SIZE];
+	int hdr_len;
+	bool in_body;
+	ulong body_pos;
+	ulong body_left;
+	bool keep_alive;
+	bool got_data;
+};
+
+static struct wget_conn wget_conns[WGET_MAX_CONNS];
+
+/* true while a file is being loaded */
+static bool wget_active;
+static struct in_addr wget_server_ip;
+static int wget_server_port;
+/* Host header, e.g. "192.168.1.1:8080" */
+static char wget_host[24];
+static char wget_path[1024];
+static ulong wget_load_addr;
+static ulong wget_load_size;
+static int wget_nconns;
+/* Size of the file, valid once wget_size_known is true */
+static ulong wget_file_size;
+static bool wget_size_known;
+/* Offset of the first byte not yet requested */
+static ulong wget_next;
+/* Number of bytes stored */
+static ulong wget_received;
+static int wget_retries;
+static int wget_hashes;
+static ulong wget_time_start;
+
+static void wget_timeout_handler(void);
+
+void wget_stop(void)
+{
+	struct wget_conn *wc;
+
+	if (!wget_active)
+		return;
+	wget_active = false;
+	net_set_timeout_handler(0, NULL);
+
+	/* Anything still to come on these is of no use */
+	for (wc = wget_conns; wc < wget_conns + WGET_MAX_CONNS; wc++) {
+		if (wc->nreqs)
+			tcp_abort(&wc->tcp);
+		wc->nreqs = 0;
+	}
+}
+
+static void wget_fail(const char *msg)
+{
+	printf("\nHTTP error: %s\n", msg);
+	wget_stop();
+	net_set_state(NETLOOP_FAIL);
+}
+
+static void wget_done(void)
+{
+	struct wget_conn *wc;
+	ulong time;
+
+	wget_active = false;
+	net_set_timeout_handler(0, NULL);
+	net_boot_file_size = wget_file_size;
+
+	/* Keep connections which are open, for the next file */
+	for (wc = wget_conns; wc < wget_conns + WGET_MAX_CONNS; wc++) {
+		if (wc->tcp.state == TCP_SYN_SENT)
+			tcp_abort(&wc->tcp);
+		else if (!wc->keep_alive)
+			tcp_close(&wc->tcp);
+	}
+
+	while (wget_hashes < WGET_HASHES) {
+		putc('#');
+		wget_hashes++;
+	}
+	time = get_timer(wget_time_start);
+	if (time > 0) {
+		puts("\n\t ");	/* Line up with "Loading: " */
+		print_size(net_boot_file_size / time * 1000, "/s");
+	}
+	puts("\ndone\n");
+	if (IS_ENABLED(CONFIG_CMD_BOOTEFI))
+		efi_set_bootdev("Net", "", wget_path,
+				map_sysmem(wget_load_addr, 0),
+				net_boot_file_size);
+	net_set_state(NETLOOP_SUCCESS);
+}
+
+/* Copies part of the file to memory */
+static int wget_store(ulong offset, const uchar *src, uint len)
+{
+	void *ptr;
+
+	if (offset + len > wget_load_size) {
+		wget_fail("trying to overwrite reserved memory");
+		return -EFBIG;
+	}
+	ptr = map_sysmem(wget_load_addr + offset, len);
+	memcpy(ptr, src, len);
+	unmap_sysmem(ptr);
+	wget_received += len;
+
+	if (wget_size_known && wget_file_size) {
+		while (wget_hashes <
+		       (u64)wget_received * WGET_HASHES / wget_file_size) {
+			putc('#');
+			wget_hashes++;
+		}
+	}
+
+	return 0;
+}
+
+/* Sends the requests outstanding on a connection, after connecting */
+static int wget_send_requests(struct wget_conn *wc, int first)
+{
+	static char buf[TCP_TX_BUF_SIZE];
+	struct wget_req *req;
+	int i, len = 0;
+
+	for (i = first; i < wc->nreqs; i++) {
+		req = &wc->req[i];
+		len += snprintf(buf + len, sizeof(buf) - len,
+				"GET %s HTTP/1.1\r\nHost: %s\r\nUser-Agent: U-Boot\r\n",
+				wget_path, wget_host);
+		if (req->len && len < sizeof(buf))
+			len += snprintf(buf + len, sizeof(buf) - len,
+					"Range: bytes=%lu-%lu\r\n", req->start,
+					req->start + req->len - 1);
+		else if (req->start && len < sizeof(buf))
+			len += snprintf(buf + len, sizeof(buf) - len,
+					"Range: bytes=%lu-\r\n", req->start);
+		if (len < sizeof(buf))
+			len += snprintf(buf + len, sizeof(buf) - len, "\r\n");
+		if (len >= sizeof(buf))
+			return -E2BIG;
+	}
+
+	return tcp_send(&wc->tcp, buf, len);
+}
+
+/* Connects (again) to the server, to send the outstanding requests */
+static void wget_connect(struct wget_conn *wc)
+{
+	wc->hdr_len = 0;
+	wc->in_body = false;
+	wc->keep_alive = true;
+	tcp_connect(&wc->tcp, wget_server_ip, wget_server_port);
+}
+
+/* Check whether there is any more of the file to ask for */
+static bool wget_more(void)
+{
+	return wget_next < (wget_size_known ? wget_file_size : ULONG_MAX);
+}
+
+/* Sends as many requests on a connection as the pipeline allows */
+static void wget_fill(struct wget_conn *wc)
+{
+	struct wget_req *req;
+
+	if (!wget_active || !wget_more())
+		return;
+	if (!wget_size_known && wc->nreqs)
+		return;
+	if (wc->tcp.state == TCP_CLOSED) {
+		wget_connect(wc);
+		return;
+	}
+	if (wc->tcp.state != TCP_ESTABLISHED || !wc->keep_alive)
+		return;
+
+	/* Without the size, the rest of the file is one request */
+	if (!wget_size_known) {
+		req = &wc->req[wc->nreqs++];
+		req->start = wget_next;
+		req->len = 0;
+		if (wget_send_requests(wc, wc->nreqs - 1))
+			wc->nreqs--;
+		else
+			wget_next = ULONG_MAX;
+		return;
+	}
+
+	while (wc->nreqs < WGET_PIPELINE && wget_next < wget_file_size) {
+		req = &wc->req[wc->nreqs++];
+		req->start = wget_next;
+		req->len = min(wget_file_size - wget_next,
+			       (ulong)CONFIG_WGET_RANGE_SIZE);
+		if (wget_send_requests(wc, wc->nreqs - 1)) {
+			/* Try again when there is room */
+			wc->nreqs--;
+			break;
+		}
+		wget_next += req->len;
+	}
+}
+
+static int wget_set_size(ulong size)
+{
+	struct wget_conn *wc;
+
+	if (size > wget_load_size) {
+		wget_fail("file is too large for the memory available");
+		return -EFBIG;
+	}
+	wget_file_size = size;
+	wget_size_known = true;
+	for (wc = wget_conns; wc < wget_conns + wget_nconns; wc++)
+		wget_fill(wc);
+
+	return 0;
+}
+
+/* Works out what to do with the body of a response, from its header */
+static int wget_parse_header(struct wget_conn *wc)
+{
+	struct wget_req *req = &wc->req[0];
+	ulong len = ULONG_MAX, start = 0, end = 0, total = ULONG_MAX;
+	char *line, *next, *val, *eol;
+	bool range = false;
+	int code;
+
+	/* e.g. "HTTP/1.1 200 OK" */
+	eol = strstr(wc->hdr, "\r\n");
+	if (strncmp(wc->hdr, "HTTP/1.", 7) || eol - wc->hdr < 12) {
+		wget_fail("bad response");
+		return -EPROTO;
+	}
+	*eol = '\0';
+	wc->keep_alive = wc->hdr[7] != '0';
+	code = dectoul(wc->hdr + 9, NULL);
+
+	for (line = eol + 2; *line; line = next + 2) {
+		next = strstr(line, "\r\n");
+		*next = '\0';
+		val = strchr(line, ':');
+		if (!val)
+			continue;
+		*val++ = '\0';
+		while (isspace(*val))
+			val++;
+		if (!strcasecmp(line, "Content-Length")) {
+			len = dectoul(val, NULL);
+		} else if (!strcasecmp(line, "Content-Range") &&
+			   !strncmp(val, "bytes ", 6)) {
+			start = dectoul(val + 6, &val);
+			if (*val == '-')
+				end = dectoul(val + 1, &val);
+			/* The size is '*' if the server does not know it */
+			if (*val == '/') {
+				total = val[1] == '*' ? ULONG_MAX :
+					dectoul(val + 1, NULL);
+				range = end >= start;
+			}
+		} else if (!strcasecmp(line, "Connection")) {
+			if (!strcasecmp(val, "close"))
+				wc->keep_alive = false;
+			else if (!strcasecmp(val, "keep-alive"))
+				wc->keep_alive = true;
+		} else if (!strcasecmp(line, "Transfer-Encoding") &&
+			   strcasecmp(val, "identity")) {
+			wget_fail("transfer encoding not supported");
+			return -EPROTONOSUPPORT;
+		}
+	}
+
+	if (code == 206 && range && start == req->start &&
+	    (len == ULONG_MAX || len == end - start + 1)) {
+		len = end - start + 1;
+
+		/*
+		 * Without the size, the file ends with a range which is
+		 * shorter than asked for, or which was asked for to the end
+		 */
+		if (total == ULONG_MAX && (!req->len || len < req->len))
+			total = end + 1;
+		if (wget_size_known && total != ULONG_MAX &&
+		    total != wget_file_size) {
+			wget_fail("file changed during transfer");
+			return -ESTALE;
+		}
+	} else if (code == 416 && !wget_size_known &&
+		   (!req->start || !req->len)) {
+		/*
+		 * The last range ended the file, or even the first byte is
+		 * out of range so the file is empty. Anything more in this
+		 * response is of no use, so close the connection after it.
+		 */
+		wc->keep_alive = false;
+		if (!wget_set_size(req->start))
+			wget_done();
+		return -ERANGE;
+	} else if (code == 200 && !wget_size_known) {
+		/* The server sent the whole file, so there is nothing more to ask */
+		total = len;
+		start = 0;
+		wget_next = ULONG_MAX;
+	} else {
+		/* Show the status line, e.g. "404 Not Found" */
+		wget_fail(wc->hdr + 9);
+		return -EPROTO;
+	}
+
+	wc->in_body = true;
+	wc->body_pos = start;
+	wc->body_left = len;
+	if (len == ULONG_MAX)
+		wc->keep_alive = false;
+	if (!wget_size_known && total != ULONG_MAX)
+		return wget_set_size(total);
+
+	return 0;
+}
+
+/* Moves on to the next request on a connection, once a response is complete */
+static void wget_response_done(struct wget_conn *wc)
+{
+	wc->nreqs--;
+	memmove(wc->req, wc->req + 1, wc->nreqs * sizeof(wc->req[0]));
+	wc->hdr_len = 0;
+	wc->in_body = false;
+	wc->got_data = false;
+	wget_retries = 0;
+
+	if (wget_size_known && wget_received == wget_file_size) {
+		wget_done();
+		return;
+	}
+
+	/* Anything else sent on this connection will not be answered */
+	if (!wc->keep_alive) {
+		if (wc->nreqs || wget_more())
+			wget_connect(wc);
+		else
+			tcp_close(&wc->tcp);
+		return;
+	}
+	wget_fill(wc);
+}
+
+static void wget_rx(struct tcp_conn *tcp, const uchar *data, uint len)
+{
+	struct wget_conn *wc = container_of(tcp, struct wget_conn, tcp);
+	char *end;
+	uint count;
+
+	if (!wget_active)
+		return;
+	if (!wc->nreqs) {
+		wget_fail("unexpected data");
+		return;
+	}
+	wc->got_data = true;
+	net_set_timeout_handler(WGET_TIMEOUT_MS, wget_timeout_handler);
+
+	while (len && wget_active && tcp->state == TCP_ESTABLISHED) {
+		if (wc->in_body) {
+			count = min_t(ulong, len, wc->body_left);
+			if (wget_store(wc->body_pos, data, count))
+				return;
+			wc->body_pos += count;
+			if (wc->body_left != ULONG_MAX)
+				wc->body_left -= count;
+			if (!wc->body_left)
+				wget_response_done(wc);
+		} else {
+			/* Take the header up to and including the blank line */
+			count = min_t(uint, len, WGET_HDR_SIZE - 1 - wc->hdr_len);
+			memcpy(wc->hdr + wc->hdr_len, data, count);
+			wc->hdr[wc->hdr_len + count] = '\0';
+			end = strstr(wc->hdr, "\r\n\r\n");
+			if (end) {
+				end += 4;
+				count = end - wc->hdr - wc->hdr_len;
+				*(end - 2) = '\0';
+				wc->hdr_len = end - wc->hdr;
+				if (wget_parse_header(wc))
+					return;
+				if (!wc->body_left)
+					wget_response_done(wc);
+			} else if (wc->hdr_len + count == WGET_HDR_SIZE - 1) {
+				wget_fail("response header too long");
+				return;
+			} else {
+				wc->hdr_len += count;
+			}
+		}
+		data += count;
+		len -= count;
+	}
+}
+
+static void wget_event(struct tcp_conn *tcp, enum tcp_event event)
+{
+	struct wget_conn *wc = container_of(tcp, struct wget_conn, tcp);
+
+	if (!wget_active) {
+		/* A connection kept open for the next file has been closed */
+		if (event == TCP_EV_CLOSED)
+			tcp_close(tcp);
+		return;
+	}
+
+	switch (event) {
+	case TCP_EV_CONNECTED:
+		wc->got_data = false;
+		if (wc->nreqs && wget_send_requests(wc, 0)) {
+			wget_fail("file name too long");
+			return;
+		}
+		wget_fill(wc);
+		break;
+	case TCP_EV_CLOSED:
+		/* A body of unknown length ends when the connection closes */
+		if (wc->in_body && wc->body_left == ULONG_MAX) {
+			tcp_close(tcp);
+			if (!wget_set_size(wget_received))
+				wget_response_done(wc);
+			return;
+		}
+		if (!wc->nreqs) {
+			tcp_close(tcp);
+			return;
+		}
+		fallthrough;
+	case TCP_EV_RESET:
+		if (!wc->nreqs)
+			return;
+
+		/*
+		 * A connection kept open from the last file may have been
+		 * closed by the server in the meantime, and a server may close
+		 * the connection after a response without saying so. Try again
+		 * on a new connection if nothing was received.
+		 */
+		if (wc->got_data || wc->in_body || wc->hdr_len ||
+		    ++wget_retries > WGET_MAX_RETRIES) {
+			wget_fail("connection closed by server");
+			return;
+		}
+		wget_connect(wc);
+		break;
+	case TCP_EV_TIMEOUT:
+		if (wc->nreqs)
+			wget_fail("server not responding");
+		break;
+	}
+}
+
+static void wget_timeout_handler(void)
+{
+	wget_fail("timed out");
+}
+
+/* Works out the server, port and path from the file name */
+static int wget_parse_name(void)
+{
+	char *name = net_boot_file_name;
+	const char *path;
+	char *end;
+
+	wget_server_ip = net_server_ip;
+	wget_server_port = WGET_HTTP_PORT;
+	if (!strncmp(name, "http://", 7)) {
+		name += 7;
+		wget_server_ip = string_to_ip(name);
+		end = strpbrk(name, ":/");
+		if (end && *end == ':')
+			wget_server_port = dectoul(end + 1, &end);
+		path = end && *end == '/' ? end : "/";
+		strlcpy(wget_path, path, sizeof(wget_path));
+	} else {
+		/* Leave room for the leading '/' */
+		if (!net_parse_bootfile(&wget_server_ip, wget_path + 1,
+					sizeof(wget_path) - 1)) {
+			puts("HTTP error: no file name\n");
+			return -ENOENT;
+		}
+		if (wget_path[1] == '/')
+			memmove(wget_path, wget_path + 1,
+				strlen(wget_path + 1) + 1);
+		else
+			wget_path[0] = '/';
+	}
+	if (!wget_server_ip.s_addr || !wget_server_port) {
+		printf("HTTP error: bad server in '%s'\n", net_boot_file_name);
+		return -EINVAL;
+	}
+
+	/* A full pipeline of requests must fit in the transmit buffer */
+	if (strlen(wget_path) > WGET_MAX_PATH) {
+		puts("HTTP error: file name too long\n");
+		return -E2BIG;
+	}
+
+	if (wget_server_port == WGET_HTTP_PORT)
+		snprintf(wget_host, sizeof(wget_host), "%pI4", &wget_server_ip);
+	else
+		snprintf(wget_host, sizeof(wget_host), "%pI4:%d",
+			 &wget_server_ip, wget_server_port);
+
+	return 0;
+}
+
+/* Sets wget_load_addr and wget_load_size from image_load_addr and lmb */
+static int wget_init_load_addr(void)
+{
+#ifdef CONFIG_LMB
+	struct lmb lmb;
+	phys_size_t max_size;
+
+	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
+
+	max_size = lmb_get_free_size(&lmb, image_load_addr);
+	if (!max_size)
+		return -1;
+
+	wget_load_size = max_size;
+#else
+	wget_load_size = ULONG_MAX;
+#endif
+	wget_load_addr = image_load_addr;
+	return 0;
+}
+
+/* Check whether a connection left open by the last file can be used */
+static bool wget_can_reuse(struct wget_conn *wc)
+{
+	return wc->tcp.state == TCP_ESTABLISHED && wc->keep_alive &&
+		!wc->nreqs && wc->tcp.local_ip.s_addr == net_ip.s_addr &&
+		wc->tcp.remote_ip.s_addr == wget_server_ip.s_addr &&
+		wc->tcp.remote_port == wget_server_port;
+}
+
+void wget_start(void)
+{
+	struct wget_conn *wc;
+	const char *ep;
+	bool reused;
+	int i;
+
+	if (wget_parse_name()) {
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+
+	wget_nconns = CONFIG_WGET_CONNECTIONS;
+	ep = env_get("wgetconns");
+	if (ep)
+		wget_nconns = clamp_t(int, dectoul(ep, NULL), 1,
+				      WGET_MAX_CONNS);
+
+	printf("Using %s device\n", eth_get_name());
+	printf("HTTP from server %pI4; our IP address is %pI4\n",
+	       &wget_server_ip, &net_ip);
+	printf("Filename '%s'.", wget_path);
+	if (wget_init_load_addr()) {
+		puts("\nHTTP error: trying to overwrite reserved memory...\n");
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+	printf("\nLoad address: 0x%lx\nLoading: ", wget_load_addr);
+
+	wget_active = true;
+	wget_size_known = false;
+	wget_file_size = 0;
+	wget_next = 0;
+	wget_received = 0;
+	wget_retries = 0;
+	wget_hashes = 0;
+	wget_time_start = get_timer(0);
+	net_boot_file_size = 0;
+
+	for (i = 0, wc = wget_conns; i < WGET_MAX_CONNS; i++, wc++) {
+		reused = wc->tcp.rx && wget_can_reuse(wc);
+		if (!wc->tcp.rx)
+			tcp_conn_init(&wc->tcp, wget_rx, wget_event, NULL);
+		else if (!reused || i >= wget_nconns)
+			tcp_abort(&wc->tcp);
+		wc->nreqs = 0;
+		wc->hdr_len = 0;
+		wc->in_body = false;
+		wc->got_data = false;
+		if (reused)
+			debug("HTTP reusing connection %d\n", i);
+	}
+
+	/*
+	 * The first request finds out the size of the file. The other
+	 * connections are only made once the server's address is known.
+	 */
+	wc = &wget_conns[0];
+	wc->req[0].start = 0;
+	wc->req[0].len = wget_nconns > 1 ? CONFIG_WGET_RANGE_SIZE : 0;
+	wc->nreqs = 1;
+	wget_next = wc->req[0].len;
+	if (wc->tcp.state == TCP_ESTABLISHED) {
+		if (wget_send_requests(wc, 0)) {
+			wget_fail("file name too long");
+			return;
+		}
+	} else {
+		wget_connect(wc);
+	}
+
+	net_set_timeout_handler(WGET_TIMEOUT_MS, wget_timeout_handler);
+}
@@ -12,6 +12,8 @@
 #include <bootmeth.h>
 #include <bootstd.h>
 #include <dm.h>
+#include <env.h>
+#include <mmc.h>
 #ifdef CONFIG_SANDBOX
 #include <asm/test.h>
 #endif
@@ -207,6 +209,8 @@ BOOTSTD_TEST(bootflow_cmd_info, UT_TESTF_DM | UT_TESTF_SCAN_FDT);
 /* Check 'bootflow scan -b' to boot the first available bootdev */
 static int bootflow_scan_boot(struct unit_test_state *uts)
 {
+	/* Make sure that the scan is not skipped */
+	ut_assertok(env_set("bootflow_cache", NULL));
 	console_record_reset_enable();
 	ut_assertok(inject_response(uts));
 	ut_assertok(run_command("bootflow scan -b", 0));
@@ -323,6 +327,125 @@ static int bootflow_iter(struct unit_test_state *uts)
 }
 BOOTSTD_TEST(bootflow_iter, UT_TESTF_DM | UT_TESTF_SCAN_FDT);
 
+/* Check that a parallel scan starts all the bootdevs before the first */
+static int bootflow_iter_parallel(struct unit_test_state *uts)
+{
+	struct bootflow_iter iter;
+	struct bootflow bflow;
+	struct udevice *dev;
+	struct mmc *mmc;
+
+	bootstd_clear_glob();
+
+	/* Without the flag, mmc1 is left alone until the scan reaches it */
+	ut_asserteq(-EPROTONOSUPPORT,
+		    bootflow_scan_first(&iter, BOOTFLOWF_ALL |
+					BOOTFLOWF_SKIP_GLOBAL, &bflow));
+	ut_asserteq_str("mmc2.bootdev", iter.dev->name);
+	ut_assertok(uclass_get_device_by_name(UCLASS_MMC, "mmc1", &dev));
+	mmc = mmc_get_mmc_dev(dev);
+	ut_asserteq(0, mmc->init_in_progress);
+	ut_asserteq(0, mmc->has_init);
+	bootflow_free(&bflow);
+	bootflow_iter_uninit(&iter);
+
+	/* With it, mmc1 is powered up while mmc2 is scanned */
+	ut_asserteq(-EPROTONOSUPPORT,
+		    bootflow_scan_first(&iter, BOOTFLOWF_ALL |
+					BOOTFLOWF_SKIP_GLOBAL |
+					BOOTFLOWF_PARALLEL, &bflow));
+	ut_asserteq_str("mmc2.bootdev", iter.dev->name);
+	ut_asserteq(1, mmc->init_in_progress);
+	bootflow_free(&bflow);
+
+	/* The scan finds the same bootflow as before */
+	ut_asserteq(-EPROTONOSUPPORT, bootflow_scan_next(&iter, &bflow));
+	bootflow_free(&bflow);
+	ut_asserteq(-ENOENT, bootflow_scan_next(&iter, &bflow));
+	ut_asserteq_str("mmc1.bootdev", iter.dev->name);
+	ut_asserteq(1, mmc->has_init);
+	bootflow_free(&bflow);
+	ut_asserteq(-ENOENT, bootflow_scan_next(&iter, &bflow));
+	bootflow_free(&bflow);
+	ut_assertok(bootflow_scan_next(&iter, &bflow));
+	ut_asserteq(1, iter.part);
+	ut_asserteq_str("syslinux", iter.method->name);
+	ut_asserteq(BOOTFLOWST_READY, bflow.state);
+	bootflow_free(&bflow);
+
+	bootflow_iter_uninit(&iter);
+
+	ut_assert_console_end();
+
+	return 0;
+}
+BOOTSTD_TEST(bootflow_iter_parallel, UT_TESTF_DM | UT_TESTF_SCAN_FDT);
+
+/* Check recording a bootflow and finding it again */
+static int bootflow_cache(struct unit_test_state *uts)
+{
+	struct bootflow_iter iter;
+	struct bootflow bflow, found;
+	char rec[200];
+
+	if (!IS_ENABLED(CONFIG_BOOTSTD_CACHE))
+		return 0;
+
+	ut_assertok(env_set("bootflow_cache", NULL));
+	ut_asserteq(-ENOENT, bootflow_cache_find(&found));
+
+	bootstd_clear_glob();
+	ut_assertok(bootflow_scan_first(&iter, BOOTFLOWF_SKIP_GLOBAL, &bflow));
+	ut_asserteq_str("mmc1.bootdev.part_1", bflow.name);
+	ut_assertok(bootflow_cache_update(&bflow));
+	snprintf(rec, sizeof(rec), "mmc1.bootdev 1 syslinux %x ", bflow.size);
+	ut_assert(!strncmp(rec, env_get("bootflow_cache"), strlen(rec)));
+
+	ut_assertok(bootflow_cache_find(&found));
+	ut_asserteq_ptr(bflow.dev, found.dev);
+	ut_asserteq(1, found.part);
+	ut_asserteq_ptr(bflow.method, found.method);
+	ut_asserteq_str(bflow.fname, found.fname);
+	ut_asserteq(BOOTFLOWST_READY, found.state);
+	ut_asserteq(bflow.size, found.size);
+	ut_asserteq_mem(bflow.buf, found.buf, bflow.size);
+	bootflow_free(&found);
+
+	/* The record is dropped after a failed boot */
+	ut_assertok(bootflow_cache_clear());
+	ut_assertnull(env_get("bootflow_cache"));
+	ut_asserteq(-ENOENT, bootflow_cache_find(&found));
+	ut_assertok(bootflow_cache_clear());
+
+	/* The file has changed */
+	snprintf(rec, sizeof(rec), "mmc1.bootdev 1 syslinux %x 0 %s",
+		 bflow.size, bflow.fname);
+	ut_assertok(env_set("bootflow_cache", rec));
+	ut_asserteq(-ESTALE, bootflow_cache_find(&found));
+
+	/* The partition no longer has a bootflow */
+	snprintf(rec, sizeof(rec), "mmc1.bootdev 2 syslinux 0 0 %s",
+		 bflow.fname);
+	ut_assertok(env_set("bootflow_cache", rec));
+	ut_asserteq(-ESTALE, bootflow_cache_find(&found));
+
+	/* mmc0 is not in the bootdev order */
+	snprintf(rec, sizeof(rec), "mmc0.bootdev 1 syslinux 0 0 %s",
+		 bflow.fname);
+	ut_assertok(env_set("bootflow_cache", rec));
+	ut_asserteq(-ESTALE, bootflow_cache_find(&found));
+
+	ut_assertok(env_set("bootflow_cache", "mmc1.bootdev 1"));
+	ut_asserteq(-EINVAL, bootflow_cache_find(&found));
+
+	bootflow_free(&bflow);
+	bootflow_iter_uninit(&iter);
+	ut_assertok(env_set("bootflow_cache", NULL));
+
+	return 0;
+}
+BOOTSTD_TEST(bootflow_cache, UT_TESTF_DM | UT_TESTF_SCAN_FDT);
+
 #if defined(CONFIG_SANDBOX) && defined(CONFIG_BOOTMETH_GLOBAL)
 /* Check using the system bootdev */
 static int bootflow_system(struct unit_test_state *uts)
@@ -365,6 +488,7 @@ static int bootflow_iter_disable(struct unit_test_state *uts)
 	ut_assertok(bootstd_test_drop_bootdev_order(uts));
 
 	bootstd_clear_glob();
+	ut_assertok(env_set("bootflow_cache", NULL));
 	console_record_reset_enable();
 	ut_assertok(inject_response(uts));
 	ut_assertok(run_command("bootflow scan -lb", 0));
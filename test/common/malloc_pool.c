@@ -0,0 +1,207 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the size-class pools in front of dlmalloc
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <malloc.h>
+#include <time.h>
+#include <asm/global_data.h>
+#include <dm/root.h>
+#include <dm/uclass-internal.h>
+#include <test/common.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Check that small requests and memalign() requests use the pools */
+static int test_malloc_pool_alloc(struct unit_test_state *uts)
+{
+	struct malloc_pool_stats stats;
+	ulong mem_start, in_use;
+	u8 *ptr, *big, val;
+	int i;
+
+	mem_start = ut_check_free();
+	in_use = malloc_pool_in_use();
+
+	ptr = malloc(40);
+	ut_assertnonnull(ptr);
+	ut_assert(malloc_pool_owns(ptr));
+	ut_asserteq(48, malloc_usable_size(ptr));
+	ut_asserteq(in_use + 48, malloc_pool_in_use());
+	memset(ptr, '\xff', 48);
+
+	/* The most recently freed object comes back first, cleared by calloc */
+	free(ptr);
+	ut_asserteq(in_use, malloc_pool_in_use());
+	ut_asserteq_ptr(ptr, calloc(1, 40));
+	for (val = 0, i = 0; i < 40; i++)
+		val |= ptr[i];
+	ut_asserteq(0, val);
+
+	/* Growing within the class keeps the object, beyond it moves it */
+	ut_asserteq_ptr(ptr, realloc(ptr, 48));
+	strcpy((char *)ptr, "pool");
+	big = realloc(ptr, 1000);
+	ut_assertnonnull(big);
+	ut_assert(!malloc_pool_owns(big));
+	ut_asserteq_str("pool", (char *)big);
+	free(big);
+
+	/* DMA-aligned objects are a power of two and aligned to their size */
+	ptr = memalign(64, 100);
+	ut_assertnonnull(ptr);
+	ut_assert(malloc_pool_owns(ptr));
+	ut_asserteq(128, malloc_usable_size(ptr));
+	ut_asserteq(0, (ulong)ptr & 127);
+	free(ptr);
+
+	/* Requests larger than a page go to dlmalloc */
+	ptr = memalign(64, 8192);
+	ut_assertnonnull(ptr);
+	ut_assert(!malloc_pool_owns(ptr));
+	free(ptr);
+
+	/* Objects allocated while enabled can be freed while disabled */
+	ptr = malloc(16);
+	ut_assert(malloc_pool_set_enabled(false));
+	big = malloc(16);
+	ut_assert(!malloc_pool_owns(big));
+	free(ptr);
+	free(big);
+	ut_assert(!malloc_pool_set_enabled(true));
+
+	malloc_pool_get_stats(&stats);
+	ut_assert(stats.enabled);
+	ut_assert(stats.used_pages > 0);
+	ut_asserteq(in_use, stats.in_use);
+	ut_asserteq(0, ut_check_delta(mem_start));
+
+	return 0;
+}
+COMMON_TEST(test_malloc_pool_alloc, 0);
+
+/* Check that the heap summary adds up */
+static int test_malloc_heap_info(struct unit_test_state *uts)
+{
+	struct malloc_heap_info info;
+
+	malloc_heap_info(&info);
+	ut_asserteq(info.size, info.used + info.free);
+	ut_assert(info.largest_free <= info.free);
+	ut_assert(info.peak <= info.size);
+
+	return 0;
+}
+COMMON_TEST(test_malloc_heap_info, 0);
+
+/* Remove all devices and uclasses, as is done after each driver model test */
+static int dm_teardown(struct unit_test_state *uts)
+{
+	int id;
+
+	for (id = 0; id < UCLASS_COUNT; id++) {
+		struct uclass *uc;
+
+		uc = uclass_find(id);
+		if (uc)
+			ut_assertok(uclass_destroy(uc));
+	}
+	gd->dm_root = NULL;
+
+	return 0;
+}
+
+/**
+ * struct dm_scan_result - results of timing driver model start-up
+ *
+ * @us:		Fastest of several runs, in microseconds
+ * @devices:	Number of devices bound by the last run
+ * @pool_allocs: Number of allocations served by the pools over all runs
+ */
+struct dm_scan_result {
+	ulong us;
+	int devices;
+	ulong pool_allocs;
+};
+
+/* Get the total number of allocations served by the pools */
+static ulong pool_allocs(void)
+{
+	struct malloc_pool_stats stats;
+	ulong total = 0;
+	uint i;
+
+	malloc_pool_get_stats(&stats);
+	for (i = 0; i < stats.num_classes; i++)
+		total += stats.cls[i].allocs;
+
+	return total;
+}
+
+/**
+ * time_dm_scan() - Time a full driver model start-up
+ *
+ * @uts: Test state
+ * @pools: true to use the size-class pools, false to use only dlmalloc
+ * @res: Returns the results
+ * Return: 0 if OK, -ve on error
+ */
+static int time_dm_scan(struct unit_test_state *uts, bool pools,
+			struct dm_scan_result *res)
+{
+	ulong start, allocs, best = ULONG_MAX;
+	int uclasses;
+	int i;
+
+	malloc_pool_set_enabled(pools);
+	allocs = pool_allocs();
+	for (i = 0; i < 3; i++) {
+		ut_assertok(dm_teardown(uts));
+		start = timer_get_us();
+		ut_assertok(dm_init_and_scan(false));
+		best = min(best, timer_get_us() - start);
+	}
+	res->us = best;
+	res->pool_allocs = pool_allocs() - allocs;
+	dm_get_stats(&res->devices, &uclasses);
+
+	return 0;
+}
+
+/* Compare dm_init_and_scan() with and without the pools */
+static int test_malloc_pool_dm_bench(struct unit_test_state *uts)
+{
+	struct dm_scan_result heap, pool;
+	struct malloc_pool_stats before, after;
+	int ret;
+
+	malloc_pool_get_stats(&before);
+	ret = time_dm_scan(uts, false, &heap);
+	if (!ret)
+		ret = time_dm_scan(uts, true, &pool);
+	malloc_pool_set_enabled(true);
+	ut_assertok(ret);
+	malloc_pool_get_stats(&after);
+	ut_assert(after.in_use > before.in_use);
+
+	/* Both runs bind the same devices and the pools only serve one */
+	ut_assert(heap.devices > 0);
+	ut_asserteq(heap.devices, pool.devices);
+	ut_asserteq(0, heap.pool_allocs);
+	ut_assert(pool.pool_allocs >= pool.devices);
+	ut_assert(heap.us > 0);
+	ut_assert(pool.us > 0);
+
+	printf("dm_init_and_scan(): %d devices, dlmalloc %lu us, ",
+	       pool.devices, heap.us);
+	printf("pools %lu us\n", pool.us);
+
+	return 0;
+}
+COMMON_TEST(test_malloc_pool_dm_bench, UT_TESTF_DM | UT_TESTF_LIVE_TREE);
@@ -0,0 +1,149 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit tests for the cooperative scheduler
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#include <common.h>
+#include <sched.h>
+#include <time.h>
+#include <linux/delay.h>
+#include <test/common.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Keeps going until it has been called @ctx times */
+static int h_count(struct sched_task *task)
+{
+	ulong limit = (ulong)task->ctx;
+
+	return task->calls < limit ? SCHED_AGAIN : 0;
+}
+
+/* Check that each task gets a step on each yield */
+static int test_sched_fair(struct unit_test_state *uts)
+{
+	struct sched_task task[3];
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(task); i++) {
+		sched_task_init(&task[i], "count", h_count, (void *)10UL, 0);
+		ut_assertok(sched_start(&task[i]));
+		ut_asserteq(1, task[i].calls);
+	}
+	ut_asserteq(-EBUSY, sched_start(&task[0]));
+
+	for (i = 0; i < 4; i++)
+		sched_yield();
+	for (i = 0; i < ARRAY_SIZE(task); i++) {
+		ut_asserteq(5, task[i].calls);
+		ut_assert(!sched_done(&task[i]));
+	}
+
+	for (i = 0; i < ARRAY_SIZE(task); i++) {
+		ut_assertok(sched_wait(&task[i], 1000));
+		ut_asserteq(10, task[i].calls);
+		ut_assert(sched_done(&task[i]));
+	}
+
+	return 0;
+}
+COMMON_TEST(test_sched_fair, 0);
+
+/* Check that a task is not stepped before its period is up */
+static int test_sched_period(struct unit_test_state *uts)
+{
+	struct sched_task task;
+
+	sched_task_init(&task, "slow", h_count, (void *)2UL, 1000 * 1000);
+	ut_assertok(sched_start(&task));
+	sched_yield();
+	udelay(10);
+	ut_asserteq(1, task.calls);
+
+	/* Only one more step is needed, so the wait is about one period */
+	ut_asserteq(-ETIMEDOUT, sched_wait(&task, 10));
+	ut_assertok(sched_wait(&task, 2000));
+	ut_asserteq(2, task.calls);
+
+	return 0;
+}
+COMMON_TEST(test_sched_period, 0);
+
+/* Waits and yields from within a step, which must not step other tasks */
+static int h_nest(struct sched_task *task)
+{
+	struct sched_task *other = task->ctx;
+	uint calls = other->calls;
+
+	sched_yield();
+	udelay(10);
+	if (other->calls != calls)
+		return -EDEADLK;
+
+	return task->calls < 3 ? SCHED_AGAIN : 0;
+}
+
+static int test_sched_nest(struct unit_test_state *uts)
+{
+	struct sched_task task, other;
+
+	sched_task_init(&other, "count", h_count, (void *)100UL, 0);
+	sched_task_init(&task, "nest", h_nest, &other, 0);
+	ut_assertok(sched_start(&other));
+	ut_assertok(sched_start(&task));
+	ut_assertok(sched_wait(&task, 1000));
+	ut_asserteq(3, task.calls);
+
+	sched_cancel(&other);
+	ut_assert(sched_done(&other));
+
+	return 0;
+}
+COMMON_TEST(test_sched_nest, 0);
+
+/* Fails on the second step */
+static int h_fail(struct sched_task *task)
+{
+	return task->calls < 2 ? SCHED_AGAIN : -EIO;
+}
+
+/* Never finishes */
+static int h_forever(struct sched_task *task)
+{
+	return SCHED_AGAIN;
+}
+
+/* Check that errors are reported and that tasks can be cancelled */
+static int test_sched_errors(struct unit_test_state *uts)
+{
+	struct sched_task task;
+
+	sched_task_init(&task, "fail", h_fail, NULL, 0);
+	ut_assertok(sched_start(&task));
+	ut_asserteq(-EIO, sched_wait(&task, 1000));
+	ut_asserteq(2, task.calls);
+
+	sched_task_init(&task, "forever", h_forever, NULL, 0);
+	ut_assertok(sched_start(&task));
+	ut_asserteq(-ETIMEDOUT, sched_wait(&task, 10));
+	ut_assert(!sched_done(&task));
+
+	sched_cancel(&task);
+	ut_assert(sched_done(&task));
+	ut_asserteq(-ECANCELED, sched_wait(&task, 10));
+
+	/* A cancelled task is not stepped again */
+	task.calls = 0;
+	sched_yield();
+	ut_asserteq(0, task.calls);
+
+	/* ...but can be restarted */
+	ut_assertok(sched_start(&task));
+	sched_cancel_all();
+	ut_assert(sched_done(&task));
+
+	return 0;
+}
+COMMON_TEST(test_sched_errors, 0);
@@ -10,13 +10,16 @@
 #include <dm.h>
 #include <env.h>
 #include <fdtdec.h>
+#include <image.h>
 #include <log.h>
 #include <malloc.h>
+#include <mapmem.h>
 #include <net.h>
 #include <asm/eth.h>
 #include <dm/test.h>
 #include <dm/device-internal.h>
 #include <dm/uclass-internal.h>
+#include <net/dhcp.h>
 #include <test/test.h>
 #include <test/ut.h>
 
@@ -460,3 +463,315 @@ static int dm_test_eth_async_ping_reply(struct unit_test_state *uts)
 }
 
 DM_TEST(dm_test_eth_async_ping_reply, UT_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(DHCP_LEASE_CACHE)
+/* Number of DHCP messages of each type sent */
+static int sb_dhcp_count[DHCP_RELEASE + 1];
+
+static int sb_with_dhcp_count_handler(struct udevice *dev, void *packet,
+				      unsigned int len)
+{
+	struct ethernet_hdr *eth = packet;
+	struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
+	struct bootp_hdr *bp = (void *)ip + IP_UDP_HDR_SIZE;
+
+	/* The message type is always the first option */
+	if (ntohs(eth->et_protlen) == PROT_IP && ip->ip_p == IPPROTO_UDP &&
+	    ntohs(ip->udp_dst) == 67 && bp->bp_vend[4] == 53 &&
+	    bp->bp_vend[6] <= DHCP_RELEASE)
+		sb_dhcp_count[(int)bp->bp_vend[6]]++;
+
+	sandbox_eth_dhcp_req_to_reply(dev, packet, len);
+	sandbox_eth_arp_req_to_reply(dev, packet, len);
+	sandbox_eth_ping_req_to_reply(dev, packet, len);
+
+	return 0;
+}
+
+static int dm_test_eth_dhcp_lease(struct unit_test_state *uts)
+{
+	struct eth_sandbox_priv *priv;
+	struct udevice *dev;
+
+	ut_assertok(uclass_get_device_by_name(UCLASS_ETH, "eth@10002000",
+					      &dev));
+	priv = dev_get_priv(dev);
+	memset(sb_dhcp_count, '\0', sizeof(sb_dhcp_count));
+	sandbox_eth_set_tx_handler(dev_seq(dev), sb_with_dhcp_count_handler);
+	env_set("ethact", "eth@10002000");
+	env_set("autoload", "no");
+	dhcp_lease_clear();
+
+	/* The first time goes through the whole exchange */
+	ut_assertok(net_loop(DHCP));
+	ut_asserteq(1, sb_dhcp_count[DHCP_DISCOVER]);
+	ut_asserteq(1, sb_dhcp_count[DHCP_REQUEST]);
+	ut_asserteq(string_to_ip("1.1.2.10").s_addr, net_ip.s_addr);
+
+	/* The second time asks for the same lease straight away */
+	ut_assertok(net_loop(DHCP));
+	ut_asserteq(1, sb_dhcp_count[DHCP_DISCOVER]);
+	ut_asserteq(2, sb_dhcp_count[DHCP_REQUEST]);
+	ut_asserteq(string_to_ip("1.1.2.10").s_addr, net_ip.s_addr);
+
+	/* If the server refuses the lease, start again */
+	priv->dhcp_ipaddr = string_to_ip("1.1.2.11");
+	ut_assertok(net_loop(DHCP));
+	ut_asserteq(2, sb_dhcp_count[DHCP_DISCOVER]);
+	ut_asserteq(4, sb_dhcp_count[DHCP_REQUEST]);
+	ut_asserteq(string_to_ip("1.1.2.11").s_addr, net_ip.s_addr);
+
+	/* Once the lease is half over, go through the whole exchange again */
+	timer_test_add_offset(3600 / 2 * 1000);
+	ut_assertok(net_loop(DHCP));
+	ut_asserteq(3, sb_dhcp_count[DHCP_DISCOVER]);
+	ut_asserteq(5, sb_dhcp_count[DHCP_REQUEST]);
+
+	dhcp_lease_clear();
+	priv->dhcp_ipaddr = string_to_ip("1.1.2.10");
+	env_set("autoload", NULL);
+	sandbox_eth_set_tx_handler(dev_seq(dev), NULL);
+
+	return 0;
+}
+DM_TEST(dm_test_eth_dhcp_lease, UT_TESTF_SCAN_FDT);
+#endif
+
+#if CONFIG_IS_ENABLED(NET_ARP_CACHE)
+static int dm_test_eth_arp_cache(struct unit_test_state *uts)
+{
+	uchar ethaddr[ARP_HLEN];
+	struct in_addr ip = string_to_ip("1.1.2.2");
+	struct eth_sandbox_priv *priv;
+	struct udevice *dev;
+
+	ut_assertok(uclass_get_device_by_name(UCLASS_ETH, "eth@10002000",
+					      &dev));
+	priv = dev_get_priv(dev);
+	env_set("ethact", "eth@10002000");
+	arp_cache_flush();
+	ut_asserteq(-ENOENT, arp_cache_lookup(ip, ethaddr));
+
+	/* The reply to the ARP request for a ping is remembered */
+	net_ping_ip = ip;
+	ut_assertok(net_loop(PING));
+	ut_assertok(arp_cache_lookup(ip, ethaddr));
+	ut_asserteq_mem(priv->fake_host_hwaddr, ethaddr, ARP_HLEN);
+
+	/* ...so a packet to that address can be sent without waiting */
+	memset(ethaddr, '\0', ARP_HLEN);
+	ut_assertok(eth_init());
+	ut_assertok(net_send_udp_packet(ethaddr, ip, 1234, 1235, 0));
+	ut_asserteq_mem(priv->fake_host_hwaddr, ethaddr, ARP_HLEN);
+	eth_halt();
+
+	/* Replies are forgotten after a while */
+	timer_test_add_offset((CONFIG_NET_ARP_CACHE_TIMEOUT + 1) * 1000);
+	ut_asserteq(-ENOENT, arp_cache_lookup(ip, ethaddr));
+
+	ut_assertok(net_loop(PING));
+	ut_assertok(arp_cache_lookup(ip, ethaddr));
+	arp_cache_flush();
+	ut_asserteq(-ENOENT, arp_cache_lookup(ip, ethaddr));
+
+	return 0;
+}
+DM_TEST(dm_test_eth_arp_cache, UT_TESTF_SCAN_FDT);
+#endif
+
+#if CONFIG_IS_ENABLED(CMD_WGET)
+#define SB_WGET_ADDR	0x1000000
+
+/* Loads a file from the mock HTTP server and checks that it all arrived */
+static int sb_wget_check(struct unit_test_state *uts, const char *name,
+			 ulong size)
+{
+	uchar *buf;
+	ulong i;
+
+	buf = map_sysmem(SB_WGET_ADDR, size);
+	for (i = 0; i < size; i++)
+		buf[i] = ~sandbox_eth_http_byte(i);
+	image_load_addr = SB_WGET_ADDR;
+	copy_filename(net_boot_file_name, name, sizeof(net_boot_file_name));
+	ut_asserteq(size, net_loop(WGET));
+	for (i = 0; i < size && buf[i] == sandbox_eth_http_byte(i); i++)
+		;
+	ut_asserteq(size, i);
+	unmap_sysmem(buf);
+
+	return 0;
+}
+
+/* Gets the mock HTTP server ready, as if it had just started */
+static struct eth_sandbox_priv *sb_wget_setup(struct unit_test_state *uts)
+{
+	struct udevice *dev;
+	struct eth_sandbox_priv *priv;
+
+	if (uclass_get_device_by_name(UCLASS_ETH, "eth@10002000", &dev))
+		return NULL;
+	priv = dev_get_priv(dev);
+	memset(priv->http_conns, '\0', sizeof(priv->http_conns));
+	priv->http_syns = 0;
+	priv->http_reqs = 0;
+	env_set("ethact", "eth@10002000");
+
+	return priv;
+}
+
+static int dm_test_eth_wget(struct unit_test_state *uts)
+{
+	struct eth_sandbox_priv *priv;
+
+	priv = sb_wget_setup(uts);
+	ut_assertnonnull(priv);
+
+	ut_assertok(sb_wget_check(uts, "http://1.1.2.2/sandbox.img",
+				  priv->http_file_size));
+	ut_asserteq(1, priv->http_syns);
+	ut_asserteq(1, priv->http_reqs);
+
+	/* The connection is kept open for the next file */
+	env_set("serverip", "1.1.2.2");
+	ut_assertok(sb_wget_check(uts, "sandbox.img", priv->http_file_size));
+	ut_asserteq(1, priv->http_syns);
+	ut_asserteq(2, priv->http_reqs);
+
+	/* A missing file is an error */
+	copy_filename(net_boot_file_name, "http://1.1.2.2/missing",
+		      sizeof(net_boot_file_name));
+	ut_assert(net_loop(WGET) < 0);
+	ut_asserteq(3, priv->http_reqs);
+
+	/* If the server forgets the connection, a new one is made */
+	ut_assertok(sb_wget_check(uts, "1.1.2.2:/sandbox.img",
+				  priv->http_file_size));
+	memset(priv->http_conns, '\0', sizeof(priv->http_conns));
+	ut_assertok(sb_wget_check(uts, "1.1.2.2:/sandbox.img",
+				  priv->http_file_size));
+	ut_asserteq(3, priv->http_syns);
+	ut_asserteq(5, priv->http_reqs);
+
+	/* A server which closes the connection after each file */
+	priv->http_keep_alive = false;
+	ut_assertok(sb_wget_check(uts, "http://1.1.2.2/sandbox.img",
+				  priv->http_file_size));
+	ut_assertok(sb_wget_check(uts, "http://1.1.2.2/sandbox.img",
+				  priv->http_file_size));
+	ut_asserteq(4, priv->http_syns);
+	ut_asserteq(7, priv->http_reqs);
+	priv->http_keep_alive = true;
+	env_set("serverip", NULL);
+
+	return 0;
+}
+DM_TEST(dm_test_eth_wget, UT_TESTF_SCAN_FDT);
+
+static int dm_test_eth_wget_ranges(struct unit_test_state *uts)
+{
+	struct eth_sandbox_priv *priv;
+	ulong size = 0x280000;
+
+	priv = sb_wget_setup(uts);
+	ut_assertnonnull(priv);
+	priv->http_file_size = size;
+	env_set("wgetconns", "4");
+
+	/* The file is loaded in ranges, over several connections */
+	ut_assertok(sb_wget_check(uts, "http://1.1.2.2/sandbox.img", size));
+	ut_asserteq(DIV_ROUND_UP(size, CONFIG_WGET_RANGE_SIZE),
+		    priv->http_reqs);
+	ut_assert(priv->http_syns > 1);
+
+	/* A server without range support sends the whole file at once */
+	priv->http_ranges = false;
+	priv->http_reqs = 0;
+	ut_assertok(sb_wget_check(uts, "http://1.1.2.2/sandbox.img", size));
+	ut_asserteq(1, priv->http_reqs);
+
+	priv->http_ranges = true;
+
+	/*
+	 * A server which does not know the size: the rest of the file is
+	 * asked for after the first range, unless that is short
+	 */
+	priv->http_unknown_size = true;
+	priv->http_reqs = 0;
+	ut_assertok(sb_wget_check(uts, "http://1.1.2.2/sandbox.img", size));
+	ut_asserteq(2, priv->http_reqs);
+
+	/* If the file ends with the first range, the second is refused */
+	priv->http_file_size = CONFIG_WGET_RANGE_SIZE;
+	ut_assertok(sb_wget_check(uts, "http://1.1.2.2/sandbox.img",
+				  CONFIG_WGET_RANGE_SIZE));
+	priv->http_file_size = 0x1234;
+	priv->http_reqs = 0;
+	ut_assertok(sb_wget_check(uts, "http://1.1.2.2/sandbox.img", 0x1234));
+	ut_asserteq(1, priv->http_reqs);
+	priv->http_unknown_size = false;
+
+	/* Even the first range of an empty file is refused */
+	priv->http_file_size = 0;
+	priv->http_reqs = 0;
+	ut_assertok(sb_wget_check(uts, "http://1.1.2.2/sandbox.img", 0));
+	ut_asserteq(1, priv->http_reqs);
+
+	/* Requests are split to suit a server which takes small segments */
+	priv->http_file_size = size;
+	priv->http_mss = 64;
+	priv->http_max_seg = 0;
+	memset(priv->http_conns, '\0', sizeof(priv->http_conns));
+	ut_assertok(sb_wget_check(uts, "http://1.1.2.2/sandbox.img", size));
+	ut_asserteq(64, priv->http_max_seg);
+	priv->http_mss = 0;
+
+	env_set("wgetconns", NULL);
+
+	return 0;
+}
+DM_TEST(dm_test_eth_wget_ranges, UT_TESTF_SCAN_FDT);
+
+/* Test that segments which are lost or out of order are sent again */
+static int dm_test_eth_wget_lossy(struct unit_test_state *uts)
+{
+	struct eth_sandbox_priv *priv;
+	ulong size = 0x40000;
+
+	priv = sb_wget_setup(uts);
+	ut_assertnonnull(priv);
+	priv->http_file_size = size;
+	priv->http_dupacks = 0;
+	priv->http_rexmits = 0;
+	priv->http_max_wnd = 0;
+
+	/* The client asks again for what is missing with duplicate ACKs */
+	priv->http_drop = 7;
+	ut_assertok(sb_wget_check(uts, "http://1.1.2.2/sandbox.img", size));
+	ut_assert(priv->http_dupacks >= 3);
+	ut_assert(priv->http_rexmits > 0);
+	priv->http_drop = 0;
+
+	/* A segment after a gap is dropped, so that must be sent again too */
+	priv->http_dupacks = 0;
+	priv->http_rexmits = 0;
+	priv->http_reorder = 5;
+	ut_assertok(sb_wget_check(uts, "http://1.1.2.2/sandbox.img", size));
+	ut_assert(priv->http_dupacks > 0);
+	ut_assert(priv->http_rexmits > 0);
+	priv->http_reorder = 0;
+
+	/* A lost request is sent again when the client's timer expires */
+	priv->http_lose_reqs = 1;
+	ut_assertok(sb_wget_check(uts, "http://1.1.2.2/sandbox.img", size));
+	ut_asserteq(0, priv->http_lose_reqs);
+
+	/* The window is scaled, so it can be larger than 64KB */
+	ut_asserteq(CONFIG_TCP_WINDOW_SIZE, priv->http_max_wnd);
+
+	priv->http_file_size = 0x1234;
+
+	return 0;
+}
+DM_TEST(dm_test_eth_wget_lossy, UT_TESTF_SCAN_FDT);
+#endif
@@ -9,6 +9,9 @@
 #include <log.h>
 #include <miiphy.h>
 #include <misc.h>
+#include <phy.h>
+#include <sched.h>
+#include <time.h>
 #include <dm/test.h>
 #include <test/test.h>
 #include <test/ut.h>
@@ -56,3 +59,77 @@ static int dm_test_mdio(struct unit_test_state *uts)
 }
 
 DM_TEST(dm_test_mdio, UT_TESTF_SCAN_FDT);
+
+static int mdio_test_startups;
+
+static int mdio_test_phy_startup(struct phy_device *phydev)
+{
+	mdio_test_startups++;
+
+	return 0;
+}
+
+static struct phy_driver mdio_test_phy_driver = {
+	.name = "test",
+	.startup = mdio_test_phy_startup,
+};
+
+/* Test waiting for auto-negotiation in the background */
+static int dm_test_mdio_phy_aneg(struct unit_test_state *uts)
+{
+	struct mdio_perdev_priv *pdata;
+	struct phy_device phydev;
+	struct mii_dev *bus;
+	struct udevice *dev;
+
+	ut_assertok(uclass_get_device_by_name(UCLASS_MDIO, "mdio-test", &dev));
+	pdata = dev_get_uclass_priv(dev);
+	bus = pdata->mii_bus;
+	ut_assertnonnull(bus);
+
+	memset(&phydev, '\0', sizeof(phydev));
+	phydev.bus = bus;
+	phydev.addr = SANDBOX_PHY_ADDR;
+	phydev.dev = dev;
+	phydev.drv = &mdio_test_phy_driver;
+	phydev.autoneg = AUTONEG_ENABLE;
+	mdio_test_startups = 0;
+
+	/* Auto-negotiation is still going, so the task keeps polling */
+	ut_assertok(dm_mdio_write(dev, SANDBOX_PHY_ADDR, MDIO_DEVAD_NONE,
+				  MII_BMSR, 0));
+	ut_assertok(phy_aneg_start(&phydev));
+	ut_assert(!sched_done(&phydev.aneg_task));
+	ut_asserteq(-EBUSY, phy_aneg_start(&phydev));
+
+	/* The task leaves the bus alone while it is in use */
+	ut_assertok(dm_mdio_write(dev, SANDBOX_PHY_ADDR, MDIO_DEVAD_NONE,
+				  MII_BMSR, BMSR_ANEGCOMPLETE));
+	bus->busy = true;
+	timer_test_add_offset(100);
+	sched_yield();
+	ut_assert(!sched_done(&phydev.aneg_task));
+
+	bus->busy = false;
+	timer_test_add_offset(100);
+	sched_yield();
+	ut_assert(sched_done(&phydev.aneg_task));
+	ut_asserteq(0, mdio_test_startups);
+
+	/* Waiting only reads the link state now */
+	ut_assertok(phy_aneg_wait(&phydev));
+	ut_asserteq(1, mdio_test_startups);
+
+	/* Shutting down the PHY stops the task */
+	ut_assertok(dm_mdio_write(dev, SANDBOX_PHY_ADDR, MDIO_DEVAD_NONE,
+				  MII_BMSR, 0));
+	ut_assertok(phy_aneg_start(&phydev));
+	ut_assert(!sched_done(&phydev.aneg_task));
+	ut_assertok(phy_shutdown(&phydev));
+	ut_assert(sched_done(&phydev.aneg_task));
+	ut_asserteq(-ECANCELED, phydev.aneg_task.ret);
+
+	return 0;
+}
+
+DM_TEST(dm_test_mdio_phy_aneg, UT_TESTF_SCAN_FDT);
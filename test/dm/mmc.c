@@ -4,12 +4,23 @@
  */
 
 #include <common.h>
+#include <bloblist.h>
+#include <command.h>
 #include <dm.h>
+#include <malloc.h>
+#include <mapmem.h>
 #include <mmc.h>
 #include <part.h>
+#include <time.h>
+#include <asm/global_data.h>
+#include <asm/test.h>
+#include <dm/device-internal.h>
 #include <dm/test.h>
 #include <test/test.h>
 #include <test/ut.h>
+#include <u-boot/crc.h>
+
+DECLARE_GLOBAL_DATA_PTR;
 
 /*
  * Basic test of the mmc uclass. We could expand this by implementing an MMC
@@ -49,6 +60,372 @@ static int dm_test_mmc_blk(struct unit_test_state *uts)
 	ut_asserteq(2, blk_dread(dev_desc, 0, 2, read));
 	ut_asserteq_mem(write, read, sizeof(write));
 
+	/* The card is an SD card, which has no TRIM */
+	ut_asserteq(-ENOTSUPP, mmc_trim(dev_desc, 0, 2));
+
 	return 0;
 }
 DM_TEST(dm_test_mmc_blk, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(MMC_WRITE_DEFER_BUSY)
+/* Test that a write returns while the card is still programming the data */
+static int dm_test_mmc_write_busy(struct unit_test_state *uts)
+{
+	char write[1024], read[1024];
+	struct blk_desc *desc;
+	struct udevice *dev;
+	struct mmc *mmc;
+	uint errs;
+	int i;
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	mmc = mmc_get_mmc_dev(dev);
+	desc = mmc_get_blk_desc(mmc);
+	sandbox_mmc_set_write_busy(dev, 3);
+	for (i = 0; i < sizeof(write); i++)
+		write[i] = i;
+
+	ut_asserteq(2, blk_dwrite(desc, 0, 2, write));
+	ut_asserteq(3, sandbox_mmc_get_write_busy(dev, &errs));
+
+	/* The next command waits for the card to be ready */
+	ut_asserteq(2, blk_dread(desc, 0, 2, read));
+	ut_asserteq_mem(write, read, sizeof(write));
+	ut_asserteq(0, sandbox_mmc_get_write_busy(dev, &errs));
+	ut_asserteq(0, errs);
+
+	/* Back-to-back writes */
+	ut_asserteq(2, blk_dwrite(desc, 2, 2, write));
+	ut_asserteq(2, blk_dwrite(desc, 4, 2, write));
+	ut_asserteq(3, sandbox_mmc_get_write_busy(dev, &errs));
+	ut_assertok(mmc_wait_write_done(mmc));
+	ut_asserteq(0, sandbox_mmc_get_write_busy(dev, &errs));
+	ut_asserteq(0, errs);
+
+	/* Cards are waited for before a reset or booting an OS */
+	ut_asserteq(2, blk_dwrite(desc, 6, 2, write));
+	ut_asserteq(3, sandbox_mmc_get_write_busy(dev, &errs));
+	ut_assertok(mmc_wait_writes_done());
+	ut_asserteq(0, sandbox_mmc_get_write_busy(dev, &errs));
+
+	/* ...and when the device is removed */
+	ut_asserteq(2, blk_dwrite(desc, 8, 2, write));
+	ut_assert(mmc->write_busy);
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	ut_assert(!mmc->write_busy);
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_write_busy, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+#endif
+
+/* Test that large reads are split only where the host needs it */
+static int dm_test_mmc_xfer(struct unit_test_state *uts)
+{
+	const lbaint_t count = 2048;
+	struct blk_desc *desc;
+	struct udevice *dev;
+	struct mmc *mmc;
+	uint xfers, errs;
+	void *buf;
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	mmc = mmc_get_mmc_dev(dev);
+	desc = mmc_get_blk_desc(mmc);
+	ut_assert(desc->lba >= count);
+	buf = malloc(count * desc->blksz);
+	ut_assertnonnull(buf);
+#if CONFIG_IS_ENABLED(MMC_XFER_HISTOGRAM)
+	memset(mmc->xfer_hist, '\0', sizeof(mmc->xfer_hist));
+#endif
+
+	/* The whole 1MiB card is read with a single command */
+	xfers = sandbox_mmc_get_xfers(dev, &errs);
+	ut_asserteq(count, blk_dread(desc, 0, count, buf));
+	ut_asserteq(xfers + 1, sandbox_mmc_get_xfers(dev, &errs));
+	ut_asserteq(0, errs);
+
+	/* A host with a smaller limit needs several */
+	sandbox_mmc_set_b_max(dev, 300);
+	ut_asserteq(count, blk_dread(desc, 0, count, buf));
+	ut_asserteq(xfers + 8, sandbox_mmc_get_xfers(dev, &errs));
+	ut_asserteq(0, errs);
+	sandbox_mmc_set_b_max(dev, U32_MAX);
+
+#if CONFIG_IS_ENABLED(MMC_XFER_HISTOGRAM)
+	ut_asserteq(1, mmc->xfer_hist[7]);	/* 248 blocks */
+	ut_asserteq(6, mmc->xfer_hist[8]);	/* 300 blocks */
+	ut_asserteq(1, mmc->xfer_hist[11]);	/* 2048 blocks */
+#endif
+	free(buf);
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_xfer, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Test transfers longer than SET_BLOCK_COUNT can give, on a larger card */
+static int dm_test_mmc_xfer_large(struct unit_test_state *uts)
+{
+	const lbaint_t count = 0x10000 + 0x100;
+	struct blk_desc *desc;
+	struct udevice *dev;
+	uint xfers, errs;
+	u8 *buf;
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	sandbox_mmc_set_size(dev, 33);
+	ut_assertok(device_probe(dev));
+	desc = mmc_get_blk_desc(mmc_get_mmc_dev(dev));
+	ut_asserteq(33 << 11, desc->lba);
+
+	/* The buffer is too large for malloc(), so use sandbox RAM */
+	buf = map_sysmem(0x1000000, count * desc->blksz);
+	memset(buf, '\xa5', count * desc->blksz);
+
+	/* A write of this size is open-ended and ended by CMD12 */
+	xfers = sandbox_mmc_get_xfers(dev, &errs);
+	ut_asserteq(count, blk_dwrite(desc, 0, count, buf));
+	ut_asserteq(xfers + 1, sandbox_mmc_get_xfers(dev, &errs));
+	ut_asserteq(0, errs);
+
+	/*
+	 * b_max does not limit the read, so it is a single transfer which is
+	 * open-ended too
+	 */
+	memset(buf, '\0', count * desc->blksz);
+	ut_asserteq(count, blk_dread(desc, 0, count, buf));
+	ut_asserteq(xfers + 2, sandbox_mmc_get_xfers(dev, &errs));
+	ut_asserteq(0, errs);
+	ut_asserteq(0xa5, buf[0]);
+	ut_asserteq(0xa5, buf[count * desc->blksz - 1]);
+	unmap_sysmem(buf);
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_xfer_large, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(MMC_MODE_FALLBACK)
+/* Test falling back to a slower bus mode after read errors */
+static int dm_test_mmc_fall_back(struct unit_test_state *uts)
+{
+	struct blk_desc *desc;
+	struct udevice *dev;
+	struct mmc *mmc;
+	char buf[1024];
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	mmc = mmc_get_mmc_dev(dev);
+	desc = mmc_get_blk_desc(mmc);
+
+	/* Set the card up again, now that it supports high speed */
+	sandbox_mmc_set_high_speed(dev, true, 0);
+	if (CONFIG_IS_ENABLED(MMC_STATE_CACHE))
+		mmc_cache_drop(mmc);
+	mmc->has_init = 0;
+	ut_assertok(mmc_init(mmc));
+	ut_asserteq(SD_HS, mmc->selected_mode);
+	ut_asserteq(2, blk_dread(desc, 100, 2, buf));
+
+	/* A block which the card cannot read does not change the mode */
+	sandbox_mmc_set_ecc_error(dev, 150);
+	ut_asserteq(0, blk_dread(desc, 150, 2, buf));
+	ut_asserteq(SD_HS, mmc->selected_mode);
+	ut_asserteq(0, mmc->bad_caps);
+	sandbox_mmc_set_ecc_error(dev, 0);
+
+	/* Reads which fail at 50MHz are tried again at 25MHz */
+	sandbox_mmc_set_high_speed(dev, true, 25000000);
+	ut_asserteq(2, blk_dread(desc, 200, 2, buf));
+	ut_asserteq(MMC_LEGACY, mmc->selected_mode);
+	ut_asserteq(MMC_CAP(SD_HS), mmc->bad_caps);
+
+	/* Setting the card up again does not use the bad mode */
+	mmc->has_init = 0;
+	ut_assertok(mmc_init(mmc));
+	ut_asserteq(MMC_LEGACY, mmc->selected_mode);
+	ut_asserteq(2, blk_dread(desc, 300, 2, buf));
+
+	/* With no slower mode to try, the read fails */
+	sandbox_mmc_set_high_speed(dev, true, 1);
+	ut_asserteq(0, blk_dread(desc, 400, 2, buf));
+
+	/* A different card can use the mode again */
+	sandbox_mmc_set_high_speed(dev, true, 0);
+	if (CONFIG_IS_ENABLED(MMC_STATE_CACHE))
+		mmc_cache_drop(mmc);
+	mmc->cid[2] ^= 1;
+	mmc->has_init = 0;
+	ut_assertok(mmc_init(mmc));
+	ut_asserteq(0, mmc->bad_caps);
+	ut_asserteq(SD_HS, mmc->selected_mode);
+
+	/* So can the same card when it is set up again by a command */
+	sandbox_mmc_set_high_speed(dev, true, 25000000);
+	ut_asserteq(2, blk_dread(desc, 500, 2, buf));
+	ut_asserteq(MMC_CAP(SD_HS), mmc->bad_caps);
+	sandbox_mmc_set_high_speed(dev, true, 0);
+	if (CONFIG_IS_ENABLED(MMC_STATE_CACHE))
+		mmc_cache_drop(mmc);
+	ut_assertok(run_commandf("mmc dev %d", desc->devnum));
+	ut_asserteq(0, mmc->bad_caps);
+	ut_asserteq(SD_HS, mmc->selected_mode);
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_fall_back, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+#endif
+
+/* Test using a card which an earlier phase has set up */
+static int dm_test_mmc_handoff(struct unit_test_state *uts)
+{
+	struct bloblist_hdr *old_bloblist;
+	char buf[1024], list[0x400] __aligned(BLOBLIST_ALIGN);
+	struct mmc_cmd cmd = { .cmdidx = MMC_CMD_GO_IDLE_STATE };
+	struct blk_desc *desc;
+	struct mmc_state st;
+	struct udevice *dev;
+	struct mmc *mmc;
+	lbaint_t lba;
+	uint idents;
+	int i;
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	mmc = mmc_get_mmc_dev(dev);
+	desc = mmc_get_blk_desc(mmc);
+	lba = desc->lba;
+	for (i = 0; i < sizeof(buf); i++)
+		buf[i] = i;
+	ut_asserteq(2, blk_dwrite(desc, 0, 2, buf));
+
+	ut_assertok(mmc_state_save(mmc, &st));
+	ut_asserteq(mmc->selected_mode, st.mode);
+	ut_asserteq(mmc->bus_width, st.bus_width);
+	ut_asserteq(mmc->rca, st.rca);
+	ut_asserteq_64(mmc->capacity_user, st.capacity_user);
+
+	/* The card is still in the transfer state, so is used as it is */
+	idents = sandbox_mmc_get_idents(dev);
+	mmc->has_init = 0;
+	mmc->capacity_user = 0;
+	desc->lba = 0;
+	ut_assertok(mmc_state_restore(mmc, &st));
+	ut_asserteq(1, mmc->has_init);
+	ut_asserteq(lba, desc->lba);
+	ut_asserteq(idents, sandbox_mmc_get_idents(dev));
+	memset(buf, '\0', sizeof(buf));
+	ut_asserteq(2, blk_dread(desc, 0, 2, buf));
+	for (i = 0; i < sizeof(buf); i++)
+		ut_asserteq((char)i, buf[i]);
+
+	/* Hand the card off through the bloblist; the record is used once */
+	old_bloblist = gd->bloblist;
+	ut_assertok(bloblist_new(map_to_sysmem(list), sizeof(list), 0));
+	ut_assertok(mmc_handoff_save());
+	mmc->has_init = 0;
+	ut_assertok(mmc_init(mmc));
+	ut_asserteq(idents, sandbox_mmc_get_idents(dev));
+	mmc->has_init = 0;
+	ut_assertok(mmc_init(mmc));
+	ut_asserteq(idents + 1, sandbox_mmc_get_idents(dev));
+
+	/* A card which has been reset is set up from scratch */
+	ut_assertok(mmc_handoff_save());
+	ut_assertok(mmc_send_cmd(mmc, &cmd, NULL));
+	mmc->has_init = 0;
+	ut_assertok(mmc_init(mmc));
+	ut_asserteq(idents + 2, sandbox_mmc_get_idents(dev));
+	ut_asserteq(lba, desc->lba);
+	gd->bloblist = old_bloblist;
+
+	ut_assertok(mmc_send_cmd(mmc, &cmd, NULL));
+	mmc->has_init = 0;
+	ut_asserteq(-EIO, mmc_state_restore(mmc, &st));
+	ut_assertok(mmc_init(mmc));
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_handoff, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(MMC_STATE_CACHE)
+/* Emulated time taken by each command */
+#define MMC_TEST_CMD_MS		10
+
+/* Emulate a reboot: the card is reset and the cache read again */
+static int mmc_reboot(struct unit_test_state *uts, struct mmc *mmc,
+		      int expect_load, ulong *msp)
+{
+	struct mmc_cmd cmd = { .cmdidx = MMC_CMD_GO_IDLE_STATE };
+	ulong start;
+
+	ut_assertok(mmc_send_cmd(mmc, &cmd, NULL));
+	mmc->has_init = 0;
+	ut_asserteq(expect_load, mmc_cache_load());
+	start = get_timer(0);
+	ut_assertok(mmc_init(mmc));
+	*msp = get_timer(start);
+
+	return 0;
+}
+
+/* Test that the set-up of a card is cached, checked and dropped */
+static int dm_test_mmc_cache(struct unit_test_state *uts)
+{
+	struct mmc_cache *store = sandbox_mmc_cache_storage();
+	struct mmc_state *st = &store->dev[0].state;
+	struct blk_desc *desc;
+	struct udevice *dev;
+	ulong full_ms, ms;
+	struct mmc *mmc;
+	lbaint_t lba;
+	uint idents;
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	mmc = mmc_get_mmc_dev(dev);
+	desc = mmc_get_blk_desc(mmc);
+	lba = desc->lba;
+	sandbox_mmc_set_latency(dev, MMC_TEST_CMD_MS);
+
+	/* Cold boot with nothing saved: full set-up, then the state is saved */
+	memset(store, '\0', sizeof(*store));
+	ut_assertok(mmc_reboot(uts, mmc, -ENOENT, &full_ms));
+	ut_asserteq(MMC_CACHE_MAGIC, store->magic);
+	ut_asserteq(dev_seq(dev), store->dev[0].seq);
+	ut_asserteq_mem(mmc->cid, st->cid, sizeof(st->cid));
+	ut_asserteq(mmc->selected_mode, st->mode);
+	ut_asserteq(mmc->bus_width, st->bus_width);
+	ut_asserteq(lba, desc->lba);
+
+	/* The next boot goes straight to the saved mode, with fewer commands */
+	ut_assertok(mmc_reboot(uts, mmc, 0, &ms));
+	ut_assert(ms + 5 * MMC_TEST_CMD_MS <= full_ms);
+	ut_asserteq(lba, desc->lba);
+
+	/* Another card in the same slot is set up from scratch */
+	st->cid[0] ^= 1;
+	store->crc32 = crc32(0, (uchar *)store->dev, sizeof(store->dev));
+	ut_assertok(mmc_reboot(uts, mmc, 0, &ms));
+	ut_assert(ms + 5 * MMC_TEST_CMD_MS > full_ms);
+	ut_asserteq_mem(mmc->cid, st->cid, sizeof(st->cid));
+
+	/* If the saved mode does not work, the card is set up again */
+	idents = sandbox_mmc_get_idents(dev);
+	st->mode = SD_HS;
+	store->crc32 = crc32(0, (uchar *)store->dev, sizeof(store->dev));
+	ut_assertok(mmc_reboot(uts, mmc, 0, &ms));
+	ut_asserteq(idents + 2, sandbox_mmc_get_idents(dev));
+	ut_asserteq(mmc->selected_mode, st->mode);
+	ut_asserteq(lba, desc->lba);
+
+	/* A corrupt cache is ignored */
+	store->crc32 ^= 1;
+	ut_assertok(mmc_reboot(uts, mmc, -EBADMSG, &ms));
+	ut_assert(ms + 5 * MMC_TEST_CMD_MS > full_ms);
+	ut_asserteq(store->crc32,
+		    crc32(0, (uchar *)store->dev, sizeof(store->dev)));
+	sandbox_mmc_set_latency(dev, 0);
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_cache, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+#endif
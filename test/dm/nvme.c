@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the NVMe driver, using the sandbox controller
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <dm.h>
+#include <malloc.h>
+#include <asm/test.h>
+#include <dm/test.h>
+#include <dm/uclass-internal.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Blocks in each transfer, which the controller splits into 8 commands */
+#define TEST_BLOCKS	128
+
+static int setup_nvme(struct unit_test_state *uts, struct udevice **devp,
+		      struct blk_desc **descp)
+{
+	struct udevice *blk;
+
+	sandbox_set_enable_memio(true);
+	ut_assertok(uclass_first_device_err(UCLASS_NVME, devp));
+	ut_assertok(device_find_first_child_by_uclass(*devp, UCLASS_BLK, &blk));
+	*descp = dev_get_uclass_plat(blk);
+	ut_asserteq(512, (*descp)->blksz);
+
+	return 0;
+}
+
+/* Write a pattern to the start of the namespace and set up a buffer for it */
+static int write_pattern(struct unit_test_state *uts, struct blk_desc *desc,
+			 char **bufp, char **expectp)
+{
+	char *buf, *expect;
+	int i;
+
+	/* Use a buffer which is not page-aligned, so PRP lists are needed */
+	buf = malloc(TEST_BLOCKS * 512 + 8);
+	expect = malloc(TEST_BLOCKS * 512);
+	ut_assertnonnull(buf);
+	ut_assertnonnull(expect);
+	for (i = 0; i < TEST_BLOCKS * 512; i++)
+		expect[i] = i / 512 + i;
+	memcpy(buf + 8, expect, TEST_BLOCKS * 512);
+	ut_asserteq(TEST_BLOCKS, blk_dwrite(desc, 0, TEST_BLOCKS, buf + 8));
+	*bufp = buf;
+	*expectp = expect;
+
+	return 0;
+}
+
+/* Test keeping several commands in flight, completing in any order */
+static int dm_test_nvme_batch(struct unit_test_state *uts)
+{
+	struct blk_desc *desc;
+	struct udevice *dev;
+	char *buf, *expect;
+	uint max, errs;
+
+	ut_assertok(setup_nvme(uts, &dev, &desc));
+	ut_assertok(write_pattern(uts, desc, &buf, &expect));
+
+	/* All 8 commands are sent before any of them completes */
+	sandbox_nvme_set_reorder(dev, 8);
+	memset(buf, '\0', TEST_BLOCKS * 512 + 8);
+	ut_asserteq(TEST_BLOCKS, blk_dread(desc, 0, TEST_BLOCKS, buf + 8));
+	ut_asserteq_mem(expect, buf + 8, TEST_BLOCKS * 512);
+	ut_asserteq(0, sandbox_nvme_get_inflight(dev, &max, &errs));
+	ut_asserteq(8, max);
+	ut_asserteq(0, errs);
+
+	free(expect);
+	free(buf);
+	sandbox_set_enable_memio(false);
+
+	return 0;
+}
+DM_TEST(dm_test_nvme_batch, UT_TESTF_SCAN_FDT);
+
+/* Test that a controller limit on the queue depth is kept to */
+static int dm_test_nvme_max_depth(struct unit_test_state *uts)
+{
+	struct blk_desc *desc;
+	struct udevice *dev;
+	char *buf, *expect;
+	uint max, errs;
+
+	ut_assertok(uclass_find_first_device(UCLASS_NVME, &dev));
+	ut_assertnonnull(dev);
+	sandbox_nvme_set_max_depth(dev, 4);
+	ut_assertok(setup_nvme(uts, &dev, &desc));
+	ut_assertok(write_pattern(uts, desc, &buf, &expect));
+
+	/* The I/O queue was created, so commands still go out in batches */
+	sandbox_nvme_set_reorder(dev, 2);
+	memset(buf, '\0', TEST_BLOCKS * 512 + 8);
+	ut_asserteq(TEST_BLOCKS, blk_dread(desc, 0, TEST_BLOCKS, buf + 8));
+	ut_asserteq_mem(expect, buf + 8, TEST_BLOCKS * 512);
+	ut_asserteq(0, sandbox_nvme_get_inflight(dev, &max, &errs));
+	ut_asserteq(2, max);
+	ut_asserteq(0, errs);
+
+	free(expect);
+	free(buf);
+	sandbox_set_enable_memio(false);
+
+	return 0;
+}
+DM_TEST(dm_test_nvme_max_depth, UT_TESTF_SCAN_FDT);
+
+/* Test a command which times out, without reusing its ID until it is done */
+static int dm_test_nvme_timeout(struct unit_test_state *uts)
+{
+	struct blk_desc *desc;
+	struct udevice *dev;
+	char *buf, *expect;
+	uint max, errs;
+
+	ut_assertok(setup_nvme(uts, &dev, &desc));
+	ut_assertok(write_pattern(uts, desc, &buf, &expect));
+
+	/* The blocks before the third command are reported as read */
+	sandbox_nvme_set_hang(dev, 3);
+	ut_asserteq(32, blk_dread(desc, 0, TEST_BLOCKS, buf + 8));
+	ut_asserteq_mem(expect, buf + 8, 32 * 512);
+	ut_asserteq(1, sandbox_nvme_get_inflight(dev, &max, &errs));
+
+	/* Its command ID is not used while the controller still has it */
+	memset(buf, '\0', TEST_BLOCKS * 512 + 8);
+	ut_asserteq(TEST_BLOCKS, blk_dread(desc, 0, TEST_BLOCKS, buf + 8));
+	ut_asserteq_mem(expect, buf + 8, TEST_BLOCKS * 512);
+	ut_asserteq(1, sandbox_nvme_get_inflight(dev, &max, &errs));
+	ut_asserteq(0, errs);
+
+	/* Once it completes late, its slot is freed by the next transfer */
+	sandbox_nvme_set_hang(dev, 0);
+	memset(buf, '\0', TEST_BLOCKS * 512 + 8);
+	ut_asserteq(TEST_BLOCKS, blk_dread(desc, 0, TEST_BLOCKS, buf + 8));
+	ut_asserteq_mem(expect, buf + 8, TEST_BLOCKS * 512);
+	ut_asserteq(0, sandbox_nvme_get_inflight(dev, &max, &errs));
+	ut_asserteq(0, errs);
+
+	free(expect);
+	free(buf);
+	sandbox_set_enable_memio(false);
+
+	return 0;
+}
+DM_TEST(dm_test_nvme_timeout, UT_TESTF_SCAN_FDT);
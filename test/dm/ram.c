@@ -6,8 +6,12 @@
 #include <common.h>
 #include <dm.h>
 #include <ram.h>
+#include <time.h>
 #include <asm/global_data.h>
+#include <asm/test.h>
+#include <dm/device-internal.h>
 #include <dm/test.h>
+#include <dm/uclass-internal.h>
 #include <test/test.h>
 #include <test/ut.h>
 
@@ -27,3 +31,91 @@ static int dm_test_ram_base(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_ram_base, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(RAM_TRAIN_CACHE)
+/* Emulate a reboot: remove the device, reload the cache and probe again */
+static int ram_reboot(struct unit_test_state *uts, struct udevice *dev,
+		      int expect_load, ulong *msp)
+{
+	ulong start, busy;
+
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	ut_asserteq(expect_load, ram_train_load());
+	busy = sandbox_ram_get_busy_ms(dev);
+	start = get_timer(0);
+	ut_assertok(device_probe(dev));
+	*msp = get_timer(start) + sandbox_ram_get_busy_ms(dev) - busy;
+
+	return 0;
+}
+
+/* Test that training results are cached, checked and invalidated */
+static int dm_test_ram_train(struct unit_test_state *uts)
+{
+	u8 *store = sandbox_ram_train_storage();
+	struct ram_train_hdr *hdr = (struct ram_train_hdr *)store;
+	uint trains, restores;
+	struct udevice *dev;
+	ulong ms;
+
+	/* Cold boot with nothing saved: full training, which is slow */
+	memset(store, '\0', CONFIG_RAM_TRAIN_CACHE_SIZE);
+	ut_asserteq(-ENOENT, ram_train_load());
+	ut_assertok(uclass_find_first_device(UCLASS_RAM, &dev));
+	ut_assertnonnull(dev);
+	ut_assertok(ram_reboot(uts, dev, -ENOENT, &ms));
+	ut_assert(ms >= 300);
+	sandbox_ram_get_train_counts(dev, &trains, &restores);
+	ut_asserteq(1, trains);
+	ut_asserteq(0, restores);
+	ut_assertok(ram_train_save());
+	ut_asserteq(RAM_TRAIN_MAGIC, hdr->magic);
+	ut_asserteq(0, hdr->flags);
+	ut_asserteq_64(0x123456789abc, hdr->key.chip_id);
+	ut_asserteq(3200, hdr->key.data_rate);
+
+	/* The next boot restores the saved parameters and skips training */
+	ut_assertok(ram_reboot(uts, dev, 0, &ms));
+	ut_assert(ms < 300);
+	sandbox_ram_get_train_counts(dev, &trains, &restores);
+	ut_asserteq(1, trains);
+	ut_asserteq(1, restores);
+
+	/* Nothing has changed, so nothing is written */
+	store[CONFIG_RAM_TRAIN_CACHE_SIZE - 1] = 0xa5;
+	ut_assertok(ram_train_save());
+	ut_asserteq(0xa5, store[CONFIG_RAM_TRAIN_CACHE_SIZE - 1]);
+
+	/* A different data rate needs training again */
+	sandbox_ram_set_train(dev, 4266, false);
+	ut_assertok(ram_reboot(uts, dev, 0, &ms));
+	sandbox_ram_get_train_counts(dev, &trains, &restores);
+	ut_asserteq(2, trains);
+	ut_asserteq(1, restores);
+	ut_assertok(ram_train_save());
+	ut_asserteq(4266, hdr->key.data_rate);
+
+	/* A corrupt record is discarded */
+	store[sizeof(*hdr) + 10] ^= 0xff;
+	ut_assertok(ram_reboot(uts, dev, -EBADMSG, &ms));
+	sandbox_ram_get_train_counts(dev, &trains, &restores);
+	ut_asserteq(3, trains);
+	ut_assertok(ram_train_save());
+
+	/* So is one which fails the quick check after being restored */
+	sandbox_ram_set_train(dev, 4266, true);
+	ut_assertok(ram_reboot(uts, dev, 0, &ms));
+	sandbox_ram_get_train_counts(dev, &trains, &restores);
+	ut_asserteq(4, trains);
+	ut_asserteq(2, restores);
+
+	/* An invalidated record is cleared from storage */
+	ram_train_invalidate();
+	ut_assertok(ram_train_save());
+	ut_asserteq(0, hdr->magic);
+	ut_asserteq(-ENOENT, ram_train_load());
+
+	return 0;
+}
+DM_TEST(dm_test_ram_train, UT_TESTF_SCAN_FDT);
+#endif
@@ -21,7 +21,7 @@ static int dm_test_serial(struct unit_test_state *uts)
 	int i;
 	struct serial_device_info info_serial = {0};
 	struct udevice *dev_serial;
-	size_t start, putc_written;
+	size_t start, putc_written, flush_start;
 
 	uint value_serial;
 
@@ -85,6 +85,15 @@ static int dm_test_serial(struct unit_test_state *uts)
 	ut_asserteq(putc_written - start,
 		    sandbox_serial_written() - putc_written);
 
+	/* Buffered output must all have reached the driver after a flush */
+	sandbox_serial_endisable(false);
+	flush_start = sandbox_serial_written();
+	serial_puts(test_message);
+	ut_assertok(serial_flush());
+	sandbox_serial_endisable(true);
+	ut_asserteq(putc_written - start,
+		    sandbox_serial_written() - flush_start);
+
 	return 0;
 }
 
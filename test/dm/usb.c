@@ -6,12 +6,15 @@
 #include <common.h>
 #include <console.h>
 #include <dm.h>
+#include <malloc.h>
 #include <part.h>
 #include <usb.h>
 #include <asm/io.h>
 #include <asm/state.h>
 #include <asm/test.h>
 #include <dm/device-internal.h>
+#include <dm/lists.h>
+#include <dm/root.h>
 #include <dm/test.h>
 #include <dm/uclass-internal.h>
 #include <test/test.h>
@@ -63,6 +66,237 @@ static int dm_test_usb_flash(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_usb_flash, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
 
+/* test that storage commands are queued once the device is ready */
+static int dm_test_usb_flash_queue(struct unit_test_state *uts)
+{
+	struct blk_desc *dev_desc;
+	struct usb_device *udev;
+	struct udevice *dev;
+	char cmp[1024];
+	int queues;
+
+	state_set_skip_delays(true);
+	ut_assertok(usb_init());
+	ut_assertok(uclass_get_device(UCLASS_MASS_STORAGE, 0, &dev));
+	ut_assertok(blk_get_device_by_str("usb", "0", &dev_desc));
+	udev = dev_get_parent_priv(dev);
+	queues = sandbox_usb_get_bulk_queues(udev->controller_dev);
+	ut_assert(queues > 0);
+
+	/* A read needs a single queue of command, data and status */
+	memset(cmp, '\0', sizeof(cmp));
+	ut_asserteq(2, blk_dread(dev_desc, 0, 2, cmp));
+	ut_assertok(strcmp(cmp, "this is a test"));
+	ut_asserteq(queues + 1,
+		    sandbox_usb_get_bulk_queues(udev->controller_dev));
+	ut_assertok(usb_stop());
+
+	return 0;
+}
+DM_TEST(dm_test_usb_flash_queue, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* test recovering from a stall in the status phase of queued transfers */
+static int dm_test_usb_flash_queue_stall(struct unit_test_state *uts)
+{
+	struct blk_desc *dev_desc;
+	struct usb_device *udev;
+	struct udevice *emul, *dev;
+	char cmp[1024];
+	int queues;
+
+	state_set_skip_delays(true);
+	ut_assertok(usb_init());
+	ut_assertok(uclass_get_device(UCLASS_MASS_STORAGE, 0, &dev));
+	ut_assertok(blk_get_device_by_str("usb", "0", &dev_desc));
+	ut_assertok(uclass_find_device_by_name(UCLASS_USB_EMUL, "flash-stick@0",
+					       &emul));
+	udev = dev_get_parent_priv(dev);
+	queues = sandbox_usb_get_bulk_queues(udev->controller_dev);
+
+	/* The status is read again once the stall is cleared */
+	sandbox_flash_stall_status(emul);
+	memset(cmp, '\0', sizeof(cmp));
+	ut_asserteq(2, blk_dread(dev_desc, 0, 2, cmp));
+	ut_assertok(strcmp(cmp, "this is a test"));
+	ut_asserteq(1, sandbox_flash_get_stalls(emul));
+	ut_asserteq(queues + 1,
+		    sandbox_usb_get_bulk_queues(udev->controller_dev));
+
+	/* The next read is queued as normal */
+	memset(cmp, '\0', sizeof(cmp));
+	ut_asserteq(2, blk_dread(dev_desc, 0, 2, cmp));
+	ut_assertok(strcmp(cmp, "this is a test"));
+	ut_asserteq(1, sandbox_flash_get_stalls(emul));
+	ut_asserteq(queues + 2,
+		    sandbox_usb_get_bulk_queues(udev->controller_dev));
+	ut_assertok(usb_stop());
+
+	return 0;
+}
+DM_TEST(dm_test_usb_flash_queue_stall, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(USB_UAS)
+/* test that a flash stick offering UAS is used with several commands queued */
+static int dm_test_usb_flash_uas(struct unit_test_state *uts)
+{
+	struct blk_desc *dev_desc;
+	struct udevice *emul, *dev;
+	char *buf;
+
+	ut_assertok(uclass_find_device_by_name(UCLASS_USB_EMUL, "flash-stick@0",
+					       &emul));
+	ut_assertok(sandbox_flash_set_uas(emul, true, false));
+	state_set_skip_delays(true);
+	ut_assertok(usb_init());
+	ut_assertok(uclass_get_device(UCLASS_MASS_STORAGE, 0, &dev));
+	ut_assertok(blk_get_device_by_str("usb", "0", &dev_desc));
+
+	/* This needs three READ(10) commands of at most 240 blocks */
+	buf = calloc(600, 512);
+	ut_assertnonnull(buf);
+	ut_asserteq(600, blk_dread(dev_desc, 0, 600, buf));
+	ut_assertok(strcmp(buf, "this is a test"));
+	ut_asserteq(3, sandbox_flash_get_uas_max_inflight(emul));
+	free(buf);
+	ut_assertok(usb_stop());
+	ut_assertok(sandbox_flash_set_uas(emul, false, false));
+
+	return 0;
+}
+DM_TEST(dm_test_usb_flash_uas, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* test falling back to Bulk-Only Transport if UAS does not work */
+static int dm_test_usb_flash_uas_broken(struct unit_test_state *uts)
+{
+	struct blk_desc *dev_desc;
+	struct udevice *emul, *dev;
+	char cmp[1024];
+
+	ut_assertok(uclass_find_device_by_name(UCLASS_USB_EMUL, "flash-stick@0",
+					       &emul));
+	ut_assertok(sandbox_flash_set_uas(emul, true, true));
+	state_set_skip_delays(true);
+	ut_assertok(usb_init());
+	ut_assertok(uclass_get_device(UCLASS_MASS_STORAGE, 0, &dev));
+	ut_assertok(blk_get_device_by_str("usb", "0", &dev_desc));
+
+	memset(cmp, '\0', sizeof(cmp));
+	ut_asserteq(2, blk_dread(dev_desc, 0, 2, cmp));
+	ut_assertok(strcmp(cmp, "this is a test"));
+	ut_assertok(usb_stop());
+	ut_assertok(sandbox_flash_set_uas(emul, false, false));
+
+	return 0;
+}
+DM_TEST(dm_test_usb_flash_uas_broken, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* test that a SuperSpeed UAS stick is used with streams, a tag on each */
+static int dm_test_usb_flash_uas_streams(struct unit_test_state *uts)
+{
+	struct blk_desc *dev_desc;
+	struct usb_device *udev;
+	struct udevice *emul, *dev;
+	u32 mask;
+	char *buf;
+	int queues;
+
+	ut_assertok(uclass_find_device_by_name(UCLASS_USB_EMUL, "flash-stick@0",
+					       &emul));
+	ut_assertok(sandbox_flash_set_uas(emul, true, false));
+	ut_assertok(sandbox_flash_set_super_speed(emul, true));
+	state_set_skip_delays(true);
+	ut_assertok(usb_init());
+	ut_assertok(uclass_get_device(UCLASS_MASS_STORAGE, 0, &dev));
+	ut_assertok(blk_get_device_by_str("usb", "0", &dev_desc));
+	udev = dev_get_parent_priv(dev);
+	ut_asserteq(USB_SPEED_SUPER, udev->speed);
+
+	/* The status, data-in and data-out endpoints have streams */
+	mask = BIT(usb_pipe_ep_index(usb_rcvbulkpipe(udev, 2))) |
+		BIT(usb_pipe_ep_index(usb_rcvbulkpipe(udev, 3))) |
+		BIT(usb_pipe_ep_index(usb_sndbulkpipe(udev, 4)));
+	ut_asserteq(mask, sandbox_usb_get_streams(udev->controller_dev, udev));
+
+	/*
+	 * The three READ(10) commands go in a single queue and the device
+	 * finishes them last first
+	 */
+	queues = sandbox_usb_get_bulk_queues(udev->controller_dev);
+	buf = calloc(600, 512);
+	ut_assertnonnull(buf);
+	ut_asserteq(600, blk_dread(dev_desc, 0, 600, buf));
+	ut_assertok(strcmp(buf, "this is a test"));
+	ut_asserteq(3, sandbox_flash_get_uas_max_inflight(emul));
+	ut_asserteq(queues + 1,
+		    sandbox_usb_get_bulk_queues(udev->controller_dev));
+	free(buf);
+	ut_assertok(usb_stop());
+	ut_assertok(sandbox_flash_set_super_speed(emul, false));
+	ut_assertok(sandbox_flash_set_uas(emul, false, false));
+
+	return 0;
+}
+DM_TEST(dm_test_usb_flash_uas_streams,
+	UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* test that removing a UAS device puts it back to Bulk-Only Transport */
+static int dm_test_usb_flash_uas_remove(struct unit_test_state *uts)
+{
+	struct udevice *emul, *dev;
+
+	ut_assertok(uclass_find_device_by_name(UCLASS_USB_EMUL, "flash-stick@0",
+					       &emul));
+	ut_assertok(sandbox_flash_set_uas(emul, true, false));
+	state_set_skip_delays(true);
+	ut_assertok(usb_init());
+	ut_assertok(uclass_get_device(UCLASS_MASS_STORAGE, 0, &dev));
+	ut_asserteq(1, sandbox_flash_get_altsetting(emul));
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	ut_asserteq(0, sandbox_flash_get_altsetting(emul));
+	ut_assertok(usb_stop());
+	ut_assertok(sandbox_flash_set_uas(emul, false, false));
+
+	return 0;
+}
+DM_TEST(dm_test_usb_flash_uas_remove, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+#endif
+
+/* test that streams are set up on all the endpoints asked for, or none */
+static int dm_test_usb_streams(struct unit_test_state *uts)
+{
+	struct usb_device *udev;
+	struct udevice *bus, *dev;
+	unsigned long pipes[3];
+	u32 mask;
+
+	state_set_skip_delays(true);
+	ut_assertok(usb_init());
+	ut_assertok(uclass_get_device(UCLASS_MASS_STORAGE, 0, &dev));
+	udev = dev_get_parent_priv(dev);
+	bus = udev->controller_dev;
+	pipes[0] = usb_rcvbulkpipe(udev, 1);
+	pipes[1] = usb_sndbulkpipe(udev, 2);
+	pipes[2] = usb_rcvbulkpipe(udev, 3);
+	mask = BIT(usb_pipe_ep_index(pipes[0])) |
+		BIT(usb_pipe_ep_index(pipes[1]));
+
+	ut_asserteq(4, usb_alloc_streams(udev, pipes, 2, 4));
+	ut_asserteq(mask, sandbox_usb_get_streams(bus, udev));
+
+	/* One of the endpoints already has streams, so nothing changes */
+	ut_asserteq(-EBUSY, usb_alloc_streams(udev, pipes + 1, 2, 4));
+	ut_asserteq(mask, sandbox_usb_get_streams(bus, udev));
+
+	ut_assertok(usb_free_streams(udev, pipes, 2));
+	ut_asserteq(0, sandbox_usb_get_streams(bus, udev));
+	ut_asserteq(4, usb_alloc_streams(udev, pipes + 1, 2, 4));
+	ut_assertok(usb_free_streams(udev, pipes + 1, 2));
+	ut_assertok(usb_stop());
+
+	return 0;
+}
+DM_TEST(dm_test_usb_streams, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
 /* test that we can handle multiple storage devices */
 static int dm_test_usb_multi(struct unit_test_state *uts)
 {
@@ -79,6 +313,38 @@ static int dm_test_usb_multi(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_usb_multi, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
 
+/* test that the ports of a hub are brought up together */
+static int dm_test_usb_hub_timing(struct unit_test_state *uts)
+{
+	struct udevice *bus, *dev;
+	ulong start, elapsed;
+
+	/*
+	 * The hub on usb@3 has four devices, each connecting 300ms after its
+	 * port is powered and then needing a 10ms reset. Resets on a bus go
+	 * one at a time (20ms each) but the connection delays should overlap,
+	 * well short of the 1.2 seconds it would take to do each port in turn.
+	 * With delays skipped the clock only moves on when USB waits.
+	 */
+	ut_assertok(device_bind_driver_to_node(dm_root(), "usb_sandbox",
+					       "usb@3", ofnode_path("/usb@3"),
+					       &bus));
+	state_set_skip_delays(true);
+	start = get_timer(0);
+	ut_assertok(usb_init());
+	elapsed = get_timer(start);
+
+	/* Three flash sticks on usb@1 and four on usb@3 */
+	ut_assertok(uclass_get_device(UCLASS_MASS_STORAGE, 6, &dev));
+	ut_asserteq_ptr(bus, dev_get_parent(dev_get_parent(dev)));
+	ut_assert(elapsed >= 300 + 4 * 20);
+	ut_assert(elapsed < 600);
+	ut_assertok(usb_stop());
+
+	return 0;
+}
+DM_TEST(dm_test_usb_hub_timing, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
 /* test that we have an associated ofnode with the usb device */
 static int dm_test_usb_fdt_node(struct unit_test_state *uts)
 {
@@ -4,10 +4,14 @@
  */
 
 #include <common.h>
+#include <blk.h>
 #include <dm.h>
 #include <virtio_types.h>
 #include <virtio.h>
+#include <virtio_ring.h>
+#include <asm/test.h>
 #include <dm/device-internal.h>
+#include <dm/lists.h>
 #include <dm/root.h>
 #include <dm/test.h>
 #include <dm/uclass-internal.h>
@@ -31,3 +35,171 @@ static int dm_test_virtio_missing_ops(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_virtio_missing_ops, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Test the virtio ring with indirect descriptors */
+static int dm_test_virtio_ring_indirect(struct unit_test_state *uts)
+{
+	struct udevice *bus, *dev;
+	struct virtio_dev_priv *uc_priv;
+	struct vring_desc *indir;
+	struct virtqueue *vq;
+	struct virtio_sg sg[3];
+	struct virtio_sg *sgs[3];
+	unsigned int len;
+	u8 buffer[3][32];
+	int i;
+
+	ut_assertok(uclass_first_device(UCLASS_VIRTIO, &bus));
+	ut_assertok(device_find_first_child(bus, &dev));
+	ut_assertnonnull(dev);
+	uc_priv = dev_get_uclass_priv(bus);
+	uc_priv->vdev = dev;
+
+	for (i = 0; i < 3; i++) {
+		sg[i].addr = buffer[i];
+		sg[i].length = sizeof(buffer[i]);
+		sgs[i] = &sg[i];
+	}
+
+	/* pretend that the device offered indirect descriptors */
+	__virtio_set_bit(bus, VIRTIO_RING_F_INDIRECT_DESC);
+	ut_assertok(virtio_find_vqs(dev, 1, &vq));
+	ut_asserteq(true, vq->indirect);
+
+	/* a chain of three takes a single entry in the ring */
+	ut_assertok(virtqueue_add(vq, sgs, 1, 2));
+	ut_asserteq(3, vq->num_free);
+	ut_asserteq(VRING_DESC_F_INDIRECT,
+		    virtio16_to_cpu(dev, vq->vring.desc[0].flags));
+	ut_asserteq(3 * sizeof(struct vring_desc),
+		    virtio32_to_cpu(dev, vq->vring.desc[0].len));
+	indir = (struct vring_desc *)(uintptr_t)
+		virtio64_to_cpu(dev, vq->vring.desc[0].addr);
+	ut_asserteq_ptr(buffer[1], (void *)(uintptr_t)
+			virtio64_to_cpu(dev, indir[1].addr));
+	ut_asserteq(VRING_DESC_F_NEXT, virtio16_to_cpu(dev, indir[0].flags));
+	ut_asserteq(VRING_DESC_F_NEXT | VRING_DESC_F_WRITE,
+		    virtio16_to_cpu(dev, indir[1].flags));
+	ut_asserteq(VRING_DESC_F_WRITE, virtio16_to_cpu(dev, indir[2].flags));
+
+	/* so four of them fit in a ring of four */
+	for (i = 0; i < 3; i++)
+		ut_assertok(virtqueue_add(vq, sgs, 1, 2));
+	ut_asserteq(0, vq->num_free);
+	ut_asserteq(-ENOSPC, virtqueue_add(vq, sgs, 1, 2));
+
+	/* the first buffer is handed back and the entry freed */
+	vq->vring.used->idx = 1;
+	vq->vring.used->ring[0].id = 0;
+	vq->vring.used->ring[0].len = 64;
+	ut_asserteq_ptr(buffer, virtqueue_get_buf(vq, &len));
+	ut_asserteq(64, len);
+	ut_asserteq(1, vq->num_free);
+	ut_assertok(virtio_del_vqs(dev));
+	__virtio_clear_bit(bus, VIRTIO_RING_F_INDIRECT_DESC);
+
+	return 0;
+}
+DM_TEST(dm_test_virtio_ring_indirect, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Test that event indices suppress needless notifications */
+static int dm_test_virtio_ring_event(struct unit_test_state *uts)
+{
+	struct udevice *bus, *dev;
+	struct virtio_dev_priv *uc_priv;
+	struct virtqueue *vq;
+	struct virtio_sg sg;
+	struct virtio_sg *sgs[] = { &sg };
+	u8 buffer[32];
+	uint start;
+
+	ut_assertok(uclass_first_device(UCLASS_VIRTIO, &bus));
+	ut_assertok(device_find_first_child(bus, &dev));
+	ut_assertnonnull(dev);
+	uc_priv = dev_get_uclass_priv(bus);
+	uc_priv->vdev = dev;
+	sg.addr = buffer;
+	sg.length = sizeof(buffer);
+
+	/* pretend that the device offered event indices */
+	__virtio_set_bit(bus, VIRTIO_RING_F_EVENT_IDX);
+	ut_assertok(virtio_find_vqs(dev, 1, &vq));
+	ut_asserteq(true, vq->event);
+	start = sandbox_virtio_get_notifies(bus);
+
+	/* the device asks to hear about the first buffer */
+	vring_avail_event(&vq->vring) = cpu_to_virtio16(dev, 0);
+	ut_assertok(virtqueue_add(vq, sgs, 0, 1));
+	virtqueue_kick(vq);
+	ut_asserteq(start + 1, sandbox_virtio_get_notifies(bus));
+
+	/* it has not got to that yet, so is not told about the next two */
+	ut_assertok(virtqueue_add(vq, sgs, 0, 1));
+	ut_assertok(virtqueue_add(vq, sgs, 0, 1));
+	virtqueue_kick(vq);
+	ut_asserteq(start + 1, sandbox_virtio_get_notifies(bus));
+
+	/* once it asks for the fourth, a kick notifies it again */
+	vring_avail_event(&vq->vring) = cpu_to_virtio16(dev, 3);
+	ut_assertok(virtqueue_add(vq, sgs, 0, 1));
+	virtqueue_kick(vq);
+	ut_asserteq(start + 2, sandbox_virtio_get_notifies(bus));
+	ut_assertok(virtio_del_vqs(dev));
+	__virtio_clear_bit(bus, VIRTIO_RING_F_EVENT_IDX);
+
+	return 0;
+}
+DM_TEST(dm_test_virtio_ring_event, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Test splitting block transfers into requests, and a request which fails */
+static int dm_test_virtio_blk(struct unit_test_state *uts)
+{
+	u8 write[16 * 512], read[16 * 512];
+	struct udevice *bus, *dev;
+	struct blk_desc *desc;
+	uint start, errs;
+	int i;
+
+	ut_assertok(device_bind_driver(dm_root(), "virtio-sandbox-blk",
+				       "sandbox_virtio_blk", &bus));
+	ut_assertok(device_probe(bus));
+	ut_assertok(device_find_first_child(bus, &dev));
+	ut_assertnonnull(dev);
+	ut_assertok(device_probe(dev));
+	desc = dev_get_uclass_plat(dev);
+	ut_asserteq(64, desc->lba);
+
+	/*
+	 * The device takes two 1KB segments in each request, so this needs
+	 * four requests of four blocks. Each has four descriptors, but with
+	 * indirect descriptors they all fit in the ring and go in one batch.
+	 */
+	for (i = 0; i < sizeof(write); i++)
+		write[i] = i / 512 + i;
+	start = sandbox_virtio_get_notifies(bus);
+	ut_asserteq(16, blk_dwrite(desc, 8, 16, write));
+	ut_asserteq(4, sandbox_virtio_blk_get_reqs(bus, &errs));
+	ut_asserteq(0, errs);
+	ut_asserteq(start + 1, sandbox_virtio_get_notifies(bus));
+
+	/* The last request of a transfer may be shorter */
+	memset(read, '\0', sizeof(read));
+	ut_asserteq(10, blk_dread(desc, 8, 10, read));
+	ut_asserteq(7, sandbox_virtio_blk_get_reqs(bus, &errs));
+	ut_asserteq(0, errs);
+	ut_asserteq_mem(write, read, 10 * 512);
+
+	/* The other requests of a transfer still complete after a failure */
+	sandbox_virtio_blk_set_fail(bus, 13);
+	ut_asserteq(-EIO, blk_dread(desc, 8, 16, read));
+	ut_asserteq(11, sandbox_virtio_blk_get_reqs(bus, &errs));
+	ut_asserteq(0, errs);
+
+	sandbox_virtio_blk_set_fail(bus, -1);
+	memset(read, '\0', sizeof(read));
+	ut_asserteq(16, blk_dread(desc, 8, 16, read));
+	ut_asserteq_mem(write, read, sizeof(write));
+
+	return 0;
+}
+DM_TEST(dm_test_virtio_blk, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
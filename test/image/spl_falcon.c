@@ -0,0 +1,136 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for Falcon-mode boot from SPL
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <spl.h>
+#include <test/ut.h>
+#include <linux/libfdt.h>
+#include <linux/sizes.h>
+
+/* Declare a new SPL test */
+#define SPL_TEST(_name, _flags)		UNIT_TEST(_name, _flags, spl_test)
+
+/* Block size of the emulated args partition */
+#define ARGS_BLKSZ	512
+
+/**
+ * struct args_medium - emulated partition holding the prepared devicetree
+ *
+ * @data: Contents of the partition
+ * @reads: Number of blocks read so far
+ * @fail: true to fail all reads
+ */
+struct args_medium {
+	char data[SZ_8K];
+	ulong reads;
+	bool fail;
+};
+
+static ulong read_args(struct spl_load_info *load, ulong sector, ulong count,
+		       void *buf)
+{
+	struct args_medium *medium = load->priv;
+
+	if (medium->fail ||
+	    (sector + count) * load->bl_len > sizeof(medium->data))
+		return 0;
+	memcpy(buf, medium->data + sector * load->bl_len,
+	       count * load->bl_len);
+	medium->reads += count;
+
+	return count;
+}
+
+/* Check that a devicetree left by 'spl prepare' is preferred to the FIT's */
+static int spl_test_os_fdt(struct unit_test_state *uts)
+{
+	struct spl_image_info image;
+	char fit_fdt[256];
+	void *args;
+
+	memset(&image, '\0', sizeof(image));
+	args = map_sysmem(CONFIG_SYS_SPL_ARGS_ADDR, SZ_4K);
+	memset(args, '\0', sizeof(struct fdt_header));
+
+	/* Nothing prepared and no devicetree in the FIT */
+	ut_assertnull(spl_os_fdt(&image));
+
+	/* Nothing prepared, so the FIT's devicetree is used */
+	ut_assertok(fdt_create_empty_tree(fit_fdt, sizeof(fit_fdt)));
+	image.fdt_addr = fit_fdt;
+	ut_asserteq_ptr(fit_fdt, spl_os_fdt(&image));
+
+	/* A prepared devicetree takes precedence */
+	ut_assertok(fdt_create_empty_tree(args, SZ_4K));
+	ut_asserteq_ptr(args, spl_os_fdt(&image));
+
+	/* ...unless it is corrupt */
+	fdt_set_magic(args, 0);
+	ut_asserteq_ptr(fit_fdt, spl_os_fdt(&image));
+
+	memset(args, '\0', sizeof(struct fdt_header));
+	unmap_sysmem(args);
+
+	return 0;
+}
+SPL_TEST(spl_test_os_fdt, 0);
+
+/* Check loading the devicetree left by 'spl prepare' */
+static int spl_test_os_args(struct unit_test_state *uts)
+{
+	struct args_medium *medium;
+	struct spl_load_info load;
+	struct spl_image_info image;
+	char fit_fdt[256];
+	void *args;
+
+	medium = calloc(1, sizeof(*medium));
+	ut_assertnonnull(medium);
+	memset(&load, '\0', sizeof(load));
+	load.priv = medium;
+	load.bl_len = ARGS_BLKSZ;
+	load.read = read_args;
+	memset(&image, '\0', sizeof(image));
+	ut_assertok(fdt_create_empty_tree(fit_fdt, sizeof(fit_fdt)));
+	image.fdt_addr = fit_fdt;
+	args = map_sysmem(CONFIG_SYS_SPL_ARGS_ADDR, SZ_8K);
+
+	/* Only the blocks covering the devicetree are read */
+	ut_assertok(fdt_create_empty_tree(medium->data, 3 * ARGS_BLKSZ - 8));
+	ut_assertok(spl_load_os_args(&load, 0, sizeof(medium->data)));
+	ut_asserteq(1 + 3, medium->reads);
+	ut_asserteq_mem(medium->data, args, 3 * ARGS_BLKSZ - 8);
+	ut_asserteq_ptr(args, spl_os_fdt(&image));
+
+	/* A size larger than the partition is refused */
+	ut_asserteq(-E2BIG, spl_load_os_args(&load, 0, 2 * ARGS_BLKSZ));
+	ut_asserteq_ptr(fit_fdt, spl_os_fdt(&image));
+
+	/* ...as is one which does not fit the medium at all */
+	fdt_set_totalsize(medium->data, 0x7fffffff);
+	ut_asserteq(-E2BIG, spl_load_os_args(&load, 0, sizeof(medium->data)));
+	ut_asserteq_ptr(fit_fdt, spl_os_fdt(&image));
+
+	/* Nothing prepared */
+	memset(medium->data, '\0', sizeof(medium->data));
+	ut_asserteq(-ENOENT, spl_load_os_args(&load, 0, sizeof(medium->data)));
+	ut_asserteq_ptr(fit_fdt, spl_os_fdt(&image));
+
+	/* A read error leaves no devicetree behind */
+	ut_assertok(fdt_create_empty_tree(medium->data, ARGS_BLKSZ));
+	medium->fail = true;
+	ut_asserteq(-EIO, spl_load_os_args(&load, 0, sizeof(medium->data)));
+	ut_asserteq_ptr(fit_fdt, spl_os_fdt(&image));
+
+	unmap_sysmem(args);
+	free(medium);
+
+	return 0;
+}
+SPL_TEST(spl_test_os_args, 0);
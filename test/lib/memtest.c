@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the parallel memory test engine
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#include <common.h>
+#include <memtest.h>
+#include <os.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+#include <linux/sizes.h>
+
+#define TEST_SIZE	SZ_1M
+#define TEST_ADDR	0x40000000
+
+/* Offset of the word corrupted by inject_step(), in region 4 */
+#define BAD_OFFSET	0x12340
+
+static void setup(struct memtest *mt, void *buf)
+{
+	memset(mt, '\0', sizeof(*mt));
+	mt->buf = buf;
+	mt->addr = TEST_ADDR;
+	mt->size = TEST_SIZE;
+	mt->patterns = MEMTEST_ALL;
+	mt->pattern = 0x0123456789abcdefULL;
+	mt->seed = 42;
+}
+
+/* Check that all patterns pass on good memory, using all host CPUs */
+static int lib_test_memtest(struct unit_test_state *uts)
+{
+	struct memtest *mt;
+	void *buf;
+
+	mt = calloc(1, sizeof(*mt));
+	ut_assertnonnull(mt);
+	buf = os_malloc(TEST_SIZE);
+	ut_assertnonnull(buf);
+
+	setup(mt, buf);
+	ut_assertok(memtest_run(mt));
+	ut_asserteq(0, mt->errors);
+	ut_asserteq(MEMTEST_MAX_REGIONS, mt->num_regions);
+	ut_asserteq(min(os_num_cpus(), (uint)MEMTEST_MAX_REGIONS),
+		    mt->num_cpus);
+	ut_asserteq(TEST_SIZE * 2, mt->stats[MEMTEST_ADDR].bytes);
+	ut_asserteq(TEST_SIZE * 5, mt->stats[MEMTEST_MOVINV].bytes);
+
+	setup(mt, buf);
+	mt->lines = true;
+	mt->max_cpus = 2;
+	ut_assertok(memtest_run(mt));
+	ut_asserteq(0, mt->errors);
+	ut_assert(mt->num_cpus <= 2);
+
+	/* Moving inversions leaves the original pattern behind */
+	setup(mt, buf);
+	mt->patterns = BIT(MEMTEST_MOVINV);
+	ut_assertok(memtest_run(mt));
+	ut_asserteq_64(mt->pattern, *(u64 *)buf);
+	ut_asserteq(0, mt->stats[MEMTEST_ADDR].bytes);
+
+	/* Bad parameters */
+	setup(mt, buf + 4);
+	ut_asserteq(-EINVAL, memtest_run(mt));
+	setup(mt, buf);
+	mt->patterns = 0;
+	ut_asserteq(-EINVAL, memtest_run(mt));
+
+	os_free(buf);
+	free(mt);
+
+	return 0;
+}
+LIB_TEST(lib_test_memtest, 0);
+
+/* Flip a bit between writing and checking the walking-ones pattern */
+static int inject_step(struct memtest *mt, enum memtest_pattern_t pat,
+		       int pass)
+{
+	if (pat == MEMTEST_WALK_ONES && pass == 1)
+		*(u64 *)(mt->buf + BAD_OFFSET) ^= 1ULL << 63;
+
+	return 0;
+}
+
+static int abort_step(struct memtest *mt, enum memtest_pattern_t pat,
+		      int pass)
+{
+	return pat == MEMTEST_MOVINV ? -EINTR : 0;
+}
+
+/* Check that errors are recorded against the right region and block */
+static int lib_test_memtest_error(struct unit_test_state *uts)
+{
+	struct memtest_region *rg;
+	struct memtest *mt;
+	u64 expect;
+	void *buf;
+	uint i;
+
+	mt = calloc(1, sizeof(*mt));
+	ut_assertnonnull(mt);
+	buf = os_malloc(TEST_SIZE);
+	ut_assertnonnull(buf);
+
+	setup(mt, buf);
+	mt->step = inject_step;
+	ut_assertok(memtest_run(mt));
+	ut_asserteq(1, mt->errors);
+
+	/* Regions are 16KB, so each block in the error map is 256 bytes */
+	rg = &mt->region[4];
+	ut_asserteq(0x10000, rg->addr);
+	ut_asserteq(0x4000, rg->size);
+	ut_asserteq(1, rg->errors);
+	ut_asserteq_64(1ULL << ((BAD_OFFSET - 0x10000) / 0x100), rg->map);
+	ut_asserteq(TEST_ADDR + BAD_OFFSET, rg->first_addr);
+	expect = 1ULL << ((BAD_OFFSET / 8) & 63);
+	ut_asserteq_64(expect, rg->expect);
+	ut_asserteq_64(expect ^ 1ULL << 63, rg->actual);
+	for (i = 0; i < mt->num_regions; i++) {
+		if (i != 4)
+			ut_asserteq(0, mt->region[i].errors);
+	}
+
+	/* The step function can stop the test */
+	setup(mt, buf);
+	mt->step = abort_step;
+	ut_asserteq(-EINTR, memtest_run(mt));
+	ut_assert(mt->stats[MEMTEST_WALK_ZEROS].bytes);
+	ut_asserteq(0, mt->stats[MEMTEST_MOVINV].bytes);
+
+	os_free(buf);
+	free(mt);
+
+	return 0;
+}
+LIB_TEST(lib_test_memtest_error, 0);
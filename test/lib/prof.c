@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the sampling profiler
+ *
+ * Copyright (c) 2023 Spacemit, Inc
+ */
+
+#include <common.h>
+#include <prof.h>
+#include <time.h>
+#include <linux/delay.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Check that samples are taken while U-Boot is busy */
+static int lib_test_prof(struct unit_test_state *uts)
+{
+	struct prof_stats stats;
+	ulong start;
+
+	prof_reset();
+	ut_assertok(prof_start());
+	ut_asserteq(-EALREADY, prof_start());
+
+	/* Sandbox samples CPU time, so spin rather than sleeping */
+	start = get_timer(0);
+	do {
+		prof_get_stats(&stats);
+	} while (stats.count < 10 && get_timer(start) < 5000);
+	prof_stop();
+
+	prof_get_stats(&stats);
+	ut_assert(!stats.running);
+	ut_assert(stats.count >= 10);
+	ut_asserteq(CONFIG_PROFILER_HZ, stats.hz);
+
+	/* No more samples should arrive once stopped */
+	start = stats.count;
+	mdelay(20);
+	prof_get_stats(&stats);
+	ut_asserteq(start, stats.count);
+
+	console_record_reset_enable();
+	ut_assertok(prof_report(5));
+	ut_assert_nextline(" Samples       %%  Function");
+
+	prof_reset();
+	ut_asserteq(-ENOENT, prof_report(5));
+
+	return 0;
+}
+LIB_TEST(lib_test_prof, UT_TESTF_CONSOLE_REC);
@@ -0,0 +1,103 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Copyright (c) 2023 Spacemit, Inc
+ *
+ * Test the log ring, which formats records only when they are read
+ */
+
+#include <common.h>
+#include <console.h>
+#include <efi_api.h>
+#include <asm/global_data.h>
+#include <linux/libfdt.h>
+#include <linux/sizes.h>
+#include <test/log.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Read the next line of the ring dump and check it ends with @expect */
+static int check_ring_line(struct unit_test_state *uts, const char *expect)
+{
+	int len, elen = strlen(expect);
+
+	len = console_record_readline(uts->actual_str, sizeof(uts->actual_str));
+	ut_assert(len >= elen);
+	ut_asserteq_str(expect, uts->actual_str + len - elen);
+
+	return 0;
+}
+
+static int log_test_ring(struct unit_test_state *uts)
+{
+	efi_guid_t guid = EFI_GLOBAL_VARIABLE_GUID;
+	char str[] = "stack";
+
+	log_ring_clear();
+	log(LOGC_ARCH, LOGL_DEBUG, "int %d str %s hex %5lx star %*d\n", -12,
+	    str, 0xabcUL, 4, 7);
+	strcpy(str, "gone");
+	log(LOGC_EFI, LOGL_INFO, "ll %llu size %zu pct %% ptr %p\n",
+	    0x123456789ULL, (size_t)42, (void *)0x1000);
+	log(LOGC_EFI, LOGL_WARNING, "guid %pUl\n", &guid);
+
+	/* Records above the ring's level are not kept */
+	log(LOGC_ARCH, LOGL_DEBUG_IO, "not kept\n");
+
+	console_record_reset_enable();
+	ut_assertok(log_ring_dump());
+	gd->flags &= ~GD_FLG_RECORD;
+	ut_assertok(check_ring_line(uts,
+				    "DEBUG.arch int -12 str stack hex   abc star    7"));
+	ut_assertok(check_ring_line(uts,
+				    "INFO.efi ll 4886718345 size 42 pct % ptr 0000000000001000"));
+	ut_assertok(check_ring_line(uts,
+				    "WARNING.efi guid 8be4df61-93ca-11d2-aa0d-00e098032b8c"));
+	ut_assertok(ut_check_console_end(uts));
+
+	console_record_reset_enable();
+	ut_assertok(log_ring_stats());
+	gd->flags &= ~GD_FLG_RECORD;
+	ut_assertok(ut_check_skipline(uts));
+	ut_assertok(ut_check_skipline(uts));
+	ut_assertok(ut_check_console_linen(uts, "arch "));
+	ut_assertok(ut_check_console_linen(uts, "efi "));
+	ut_assertok(ut_check_console_end(uts));
+
+	return 0;
+}
+LOG_TEST(log_test_ring);
+
+/* Hand the log to the OS in @blob and get the name of the node holding it */
+static int ring_fdt_node(struct unit_test_state *uts, void *blob,
+			 const char **namep)
+{
+	int node;
+
+	ut_assertok(fdt_create_empty_tree(blob, SZ_4K));
+	ut_assertok(log_ring_fdt_fixup(blob));
+	node = fdt_node_offset_by_compatible(blob, -1, "u-boot,log");
+	ut_assert(node >= 0);
+	*namep = fdt_get_name(blob, node, NULL);
+	ut_assertnonnull(*namep);
+
+	return 0;
+}
+
+static int log_test_ring_fdt(struct unit_test_state *uts)
+{
+	char blob1[SZ_4K], blob2[SZ_4K];
+	const char *name1, *name2;
+
+	log_ring_clear();
+	log(LOGC_ARCH, LOGL_INFO, "hand over\n");
+
+	/* Each fixup, e.g. from a repeated bootm, reuses the same buffer */
+	ut_assertok(ring_fdt_node(uts, blob1, &name1));
+	ut_assertok(ring_fdt_node(uts, blob2, &name2));
+	ut_asserteq_str(name1, name2);
+
+	return 0;
+}
+LOG_TEST(log_test_ring_fdt);
@@ -8,6 +8,7 @@
 #include <console.h>
 #include <dm.h>
 #include <event.h>
+#include <sched.h>
 #include <dm/root.h>
 #include <dm/test.h>
 #include <dm/uclass-internal.h>
@@ -262,6 +263,11 @@ static int test_pre_run(struct unit_test_state *uts, struct unit_test *test)
  */
 static int test_post_run(struct unit_test_state *uts, struct unit_test *test)
 {
+	/*
+	 * A test which fails part-way may leave tasks on its stack running,
+	 * so stop them before the stack is reused
+	 */
+	sched_cancel_all();
 	ut_unsilence_console(uts);
 	if (test->flags & UT_TESTF_DM)
 		ut_assertok(dm_test_post_run(uts));
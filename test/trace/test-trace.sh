@@ -10,6 +10,18 @@ TRACE_OPT="FTRACE=1"
 BASE="$(dirname $0)/.."
 . $BASE/common.sh
 
+# Build sandbox with tracing and the per-function hardware counters
+build_trace_uboot() {
+	echo "Build sandbox"
+	OPTS="O=${OUTPUT_DIR} ${TRACE_OPT}"
+	echo ${OPTS}
+	make ${OPTS} sandbox_config
+	./scripts/config --file ${OUTPUT_DIR}/.config -e TRACE \
+		-e TRACE_HW_COUNTERS
+	make ${OPTS} olddefconfig
+	make ${OPTS} -s -j$(nproc)
+}
+
 run_trace() {
 	echo "Run trace"
 	./${OUTPUT_DIR}/u-boot <<END
@@ -23,6 +35,8 @@ trace resume
 hash sha256 0 10000
 trace pause
 trace stats
+trace top 5
+trace hwlist
 reset
 END
 }
@@ -52,12 +66,26 @@ check_results() {
 	if [ "${counts}" != "1 1 0 1 " ]; then
 		fail "trace collection error: ${counts}"
 	fi
+
+	# 'trace top' shows five functions. A function's own cycles cannot
+	# exceed its total including callees.
+	top="$(tr -d '\r' <${tmp} | awk \
+		'/Total cycles/ { rows = 5; next } \
+		rows && NF == 6 { rows--; n++; if ($2 > $5) bad++ } \
+		END { printf "%d %d", n, bad }')"
+	if [ "${top}" != "5 0" ]; then
+		fail "hardware counter error: ${top}"
+	fi
+
+	if ! grep -q "Counter list dumped to" ${tmp}; then
+		fail "hardware counter list error"
+	fi
 }
 
 echo "Simple trace test / sanity check using sandbox"
 echo
 tmp="$(tempfile)"
-build_uboot "${TRACE_OPT}"
+build_trace_uboot
 run_trace >${tmp}
 check_results ${tmp}
 rm ${tmp}
@@ -32,6 +32,10 @@ struct func_info {
 	unsigned long code_size;
 	unsigned long call_count;
 	unsigned flags;
+	/* hardware counter totals, if present in the profile data */
+	unsigned long hw_calls;
+	uint64_t hw_self[TRACE_HW_COUNT];
+	uint64_t hw_total[TRACE_HW_COUNT];
 	/* the section this function is in */
 	struct objsection_info *objsection;
 };
@@ -57,6 +61,13 @@ struct trace_call *call_list;
 int call_count;
 int verbose;	/* Verbosity level 0=none, 1=warn, 2=notice, 3=info, 4=debug */
 unsigned long text_offset;		/* text address of first function */
+int hw_func_count;	/* Number of functions with hardware counter totals */
+
+static const char *const hw_counter_names[TRACE_HW_COUNT] = {
+	[TRACE_HW_CYCLES]	= "cycles",
+	[TRACE_HW_INSTRET]	= "instret",
+	[TRACE_HW_EVENT]	= "event",
+};
 
 static void outf(int level, const char *fmt, ...)
 		__attribute__ ((format (__printf__, 2, 3)));
@@ -85,8 +96,10 @@ static void usage(void)
 		"\n"
 		"Commands\n"
 		"   dump-ftrace\t\tDump out textual data in ftrace format\n"
+		"   dump-counters\tDump functions by hardware counter totals\n"
 		"\n"
 		"Options:\n"
+		"   -c <counter>\tCounter to sort by (cycles, instret, event)\n"
 		"   -m <map>\tSpecify Systen.map file\n"
 		"   -t <trace>\tSpecific trace data file (from U-Boot)\n"
 		"   -v <0-4>\tSpecify verbosity\n");
@@ -226,6 +239,51 @@ static int read_calls(FILE *fin, size_t count)
 	return 0;
 }
 
+static int read_funcs(FILE *fin, size_t count, int *not_found)
+{
+	struct trace_output_func rec;
+	struct func_info *func;
+	int i;
+
+	notice("function count: %zu\n", count);
+	for (i = 0; i < count; i++) {
+		if (read_data(fin, &rec, sizeof(rec)))
+			return 1;
+		func = find_func_by_offset(rec.offset);
+		if (!func) {
+			(*not_found)++;
+			continue;
+		}
+		func->call_count = rec.call_count;
+	}
+	return 0;
+}
+
+static int read_counters(FILE *fin, size_t count, int *not_found)
+{
+	struct trace_output_counters rec;
+	struct func_info *func;
+	int i;
+
+	notice("counter count: %zu\n", count);
+	for (i = 0; i < count; i++) {
+		if (read_data(fin, &rec, sizeof(rec)))
+			return 1;
+		func = find_func_by_offset(rec.offset);
+		if (!func) {
+			warn("Cannot find function at %lx\n",
+			     text_offset + rec.offset);
+			(*not_found)++;
+			continue;
+		}
+		func->hw_calls = rec.call_count;
+		memcpy(func->hw_self, rec.self, sizeof(func->hw_self));
+		memcpy(func->hw_total, rec.total, sizeof(func->hw_total));
+		hw_func_count++;
+	}
+	return 0;
+}
+
 static int read_profile(FILE *fin, int *not_found)
 {
 	struct trace_output_hdr hdr;
@@ -242,13 +300,23 @@ static int read_profile(FILE *fin, int *not_found)
 
 		switch (hdr.type) {
 		case TRACE_CHUNK_FUNCS:
-			/* Ignored at present */
+			if (read_funcs(fin, hdr.rec_count, not_found))
+				return 1;
 			break;
 
 		case TRACE_CHUNK_CALLS:
 			if (read_calls(fin, hdr.rec_count))
 				return 1;
 			break;
+
+		case TRACE_CHUNK_COUNTERS:
+			if (read_counters(fin, hdr.rec_count, not_found))
+				return 1;
+			break;
+
+		default:
+			error("Unknown chunk type %d\n", hdr.type);
+			return 1;
 		}
 	}
 	return 0;
@@ -532,6 +600,69 @@ static int make_ftrace(void)
 	return 0;
 }
 
+static enum trace_hw_counter sort_counter;
+
+static int h_cmp_counter(const void *v1, const void *v2)
+{
+	const struct func_info *f1 = *(const struct func_info **)v1;
+	const struct func_info *f2 = *(const struct func_info **)v2;
+	uint64_t c1 = f1->hw_self[sort_counter];
+	uint64_t c2 = f2->hw_self[sort_counter];
+
+	return c1 < c2 ? 1 : c1 > c2 ? -1 : 0;
+}
+
+/*
+ * Print one line per function with hardware counter totals, highest first.
+ * 'self' excludes time spent in callees; 'total' includes it.
+ */
+static int make_counters(void)
+{
+	struct func_info **list;
+	uint64_t sum = 0;
+	int i, upto;
+
+	if (!hw_func_count) {
+		error("No hardware counter data in profile (use 'trace hwlist')\n");
+		return 1;
+	}
+	list = calloc(hw_func_count, sizeof(*list));
+	if (!list) {
+		error("Cannot allocate counter list\n");
+		return 1;
+	}
+	for (i = upto = 0; i < func_count && upto < hw_func_count; i++) {
+		struct func_info *func = &func_list[i];
+
+		if (!func->hw_calls || !(func->flags & FUNCF_TRACE))
+			continue;
+		list[upto++] = func;
+		sum += func->hw_self[sort_counter];
+	}
+	qsort(list, upto, sizeof(*list), h_cmp_counter);
+
+	printf("# sorted by self %s\n", hw_counter_names[sort_counter]);
+	printf("%6s %10s %15s %15s %15s %15s %15s  %s\n", "%self", "calls",
+	       "self-cycles", "self-instret", "self-event", "total-cycles",
+	       "total-instret", "function");
+	for (i = 0; i < upto; i++) {
+		struct func_info *func = list[i];
+		uint64_t val = func->hw_self[sort_counter];
+
+		printf("%6.2f %10lu %15llu %15llu %15llu %15llu %15llu  %s\n",
+		       sum ? val * 100.0 / sum : 0.0, func->hw_calls,
+		       (unsigned long long)func->hw_self[TRACE_HW_CYCLES],
+		       (unsigned long long)func->hw_self[TRACE_HW_INSTRET],
+		       (unsigned long long)func->hw_self[TRACE_HW_EVENT],
+		       (unsigned long long)func->hw_total[TRACE_HW_CYCLES],
+		       (unsigned long long)func->hw_total[TRACE_HW_INSTRET],
+		       func->name);
+	}
+	free(list);
+
+	return 0;
+}
+
 static int prof_tool(int argc, char *const argv[],
 		     const char *prof_fname, const char *map_fname,
 		     const char *trace_config_fname)
@@ -552,6 +683,8 @@ static int prof_tool(int argc, char *const argv[],
 
 		if (0 == strcmp(cmd, "dump-ftrace"))
 			err = make_ftrace();
+		else if (0 == strcmp(cmd, "dump-counters"))
+			err = make_counters();
 		else
 			warn("Unknown command '%s'\n", cmd);
 	}
@@ -567,8 +700,19 @@ int main(int argc, char *argv[])
 	int opt;
 
 	verbose = 2;
-	while ((opt = getopt(argc, argv, "m:p:t:v:")) != -1) {
+	while ((opt = getopt(argc, argv, "c:m:p:t:v:")) != -1) {
 		switch (opt) {
+		case 'c':
+			for (sort_counter = 0; sort_counter < TRACE_HW_COUNT;
+			     sort_counter++) {
+				if (!strcmp(optarg,
+					    hw_counter_names[sort_counter]))
+					break;
+			}
+			if (sort_counter == TRACE_HW_COUNT)
+				usage();
+			break;
+
 		case 'm':
 			map_fname = optarg;
 			break;